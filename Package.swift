@@ -60,6 +60,8 @@ let package = Package(
                       "spirv_cross.cpp",
                       "spirv_cross_c.cpp",
                       "spirv_cross_parsed_ir.cpp",
+                      "spirv_cross_reflection_view.cpp",
+                      "spirv_cross_serialized_ir.cpp",
                       "spirv_cross_util.cpp",
                       "spirv_glsl.cpp",
                       "spirv_hlsl.cpp",
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+
+# Copyright 2015-2021 Arm Limited
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+# Builds SPIR-V for the regression test shaders, so spirv-cross-bench can run over them.
+# Writes one .spv per shader into the output folder, and corpus.txt listing each of them
+# with the backend its folder is tested against. With --spirv-cross, shaders which the CLI
+# fails to compile for that backend are left out.
+
+import sys
+import os
+import os.path
+import subprocess
+import argparse
+import multiprocessing
+
+FOLDERS = [
+    ('shaders', 'glsl'), ('shaders-no-opt', 'glsl'),
+    ('shaders-msl', 'msl'), ('shaders-msl-no-opt', 'msl'),
+    ('shaders-hlsl', 'hlsl'), ('shaders-hlsl-no-opt', 'hlsl'),
+    ('shaders-ue4', 'msl'), ('shaders-ue4-no-opt', 'msl'),
+    ('shaders-reflection', 'reflect'),
+]
+
+# Same environments as test_shaders.py.
+def spirv_environment(shader):
+    if '.spv16.' in shader:
+        return ('spv1.6', 'spirv1.6')
+    elif '.spv14.' in shader:
+        return ('vulkan1.1spv1.4', 'spirv1.4')
+    else:
+        return ('vulkan1.1', 'vulkan1.1')
+
+# Must match the options spirv-cross-bench compiles with.
+def backend_arguments(shader, backend):
+    if backend == 'glsl':
+        return ['--vulkan-semantics'] if '.vk.' in shader else []
+    elif backend == 'hlsl':
+        return ['--hlsl', '--shader-model', '60' if '.sm6' in shader else '50']
+    elif backend == 'msl':
+        return ['--msl', '--msl-version', '20300'] + (['--msl-ios'] if '.ios.' in shader else [])
+    else:
+        return ['--reflect']
+
+def run_quietly(cmd):
+    try:
+        subprocess.check_call(cmd, stdout = subprocess.DEVNULL, stderr = subprocess.DEVNULL)
+        return True
+    except (subprocess.CalledProcessError, OSError):
+        return False
+
+def build_shader(item):
+    shader, backend, spirv_path, paths = item
+    spirv_env, glslang_env = spirv_environment(shader)
+
+    if '.asm.' in shader:
+        cmd = [paths.spirv_as, '--preserve-numeric-ids', '--target-env', spirv_env, '-o', spirv_path, shader]
+    else:
+        cmd = [paths.glslang, '--amb', '--target-env', glslang_env, '-V', '-o', spirv_path, shader]
+
+    if not run_quietly(cmd) or not os.path.isfile(spirv_path) or os.path.getsize(spirv_path) == 0:
+        return None
+
+    if paths.spirv_cross:
+        cmd = [paths.spirv_cross, spirv_path, '--output', os.devnull] + backend_arguments(shader, backend)
+        if not run_quietly(cmd):
+            return None
+
+    return backend + ' ' + os.path.abspath(spirv_path)
+
+def main():
+    parser = argparse.ArgumentParser(description = 'Build SPIR-V for the regression test shaders.')
+    parser.add_argument('output',
+            help = 'Folder to write SPIR-V files and corpus.txt into.')
+    parser.add_argument('--glslang',
+            default = 'glslangValidator',
+            help = 'Explicit path to glslangValidator')
+    parser.add_argument('--spirv-as',
+            default = 'spirv-as',
+            help = 'Explicit path to spirv-as')
+    parser.add_argument('--spirv-cross',
+            default = '',
+            help = 'Check that each shader compiles with this spirv-cross binary')
+    paths = parser.parse_args()
+
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    items = []
+    for folder, backend in FOLDERS:
+        base = os.path.join(root, folder)
+        for dirpath, _, files in os.walk(base):
+            for f in sorted(files):
+                if f.startswith('.'):
+                    continue
+                shader = os.path.join(dirpath, f)
+                rel = os.path.relpath(shader, root)
+                spirv_path = os.path.join(paths.output, rel + '.spv')
+                os.makedirs(os.path.dirname(spirv_path), exist_ok = True)
+                items.append((shader, backend, spirv_path, paths))
+
+    pool = multiprocessing.Pool(multiprocessing.cpu_count())
+    results = pool.map(build_shader, items)
+    pool.close()
+    pool.join()
+
+    built = [line for line in results if line]
+    with open(os.path.join(paths.output, 'corpus.txt'), 'w') as f:
+        for line in built:
+            f.write(line + '\n')
+
+    print('Built {} of {} shaders.'.format(len(built), len(items)))
+
+if __name__ == '__main__':
+    main()
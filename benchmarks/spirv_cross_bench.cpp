@@ -0,0 +1,611 @@
+/*
+ * Copyright 2015-2021 Arm Limited
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures parsing, IR copies, reflection analysis and compile() for each backend,
+// over a corpus of SPIR-V files and over generated modules of increasing size.
+//
+// spirv-cross-bench [--corpus=<list file>] [Google Benchmark flags]
+//
+// Each line of the list file is a backend (glsl, hlsl, msl or reflect) and a .spv path,
+// see build_bench_corpus.py. Corpus shaders are only compiled for the backend they are listed with.
+// Use --benchmark_out=<file> --benchmark_out_format=json for machine readable results.
+
+#include "spirv_cpp.hpp"
+#include "spirv_glsl.hpp"
+#include "spirv_hlsl.hpp"
+#include "spirv_msl.hpp"
+#include "spirv_parser.hpp"
+#include "spirv_reflect.hpp"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace SPIRV_CROSS_NAMESPACE;
+using namespace std;
+
+// Tracks live heap bytes, so each benchmark can report its peak memory use.
+static atomic<size_t> live_bytes;
+static atomic<size_t> peak_bytes;
+
+// Keeps the size in front of each allocation, padded to keep the alignment malloc gives.
+static const size_t allocation_header = 2 * sizeof(void *) > sizeof(size_t) ? 2 * sizeof(void *) : sizeof(size_t);
+
+static void *tracked_allocate(size_t size) SPIRV_CROSS_NOEXCEPT
+{
+	auto *block = static_cast<char *>(malloc(size + allocation_header));
+	if (!block)
+		return nullptr;
+
+	memcpy(block, &size, sizeof(size));
+	size_t live = live_bytes.fetch_add(size) + size;
+	size_t peak = peak_bytes.load();
+	while (live > peak && !peak_bytes.compare_exchange_weak(peak, live))
+		;
+	return block + allocation_header;
+}
+
+static void tracked_free(void *ptr) SPIRV_CROSS_NOEXCEPT
+{
+	if (!ptr)
+		return;
+
+	auto *block = static_cast<char *>(ptr) - allocation_header;
+	size_t size;
+	memcpy(&size, block, sizeof(size));
+	live_bytes.fetch_sub(size);
+	free(block);
+}
+
+void *operator new(size_t size)
+{
+	void *ptr = tracked_allocate(size);
+	if (!ptr)
+		throw bad_alloc();
+	return ptr;
+}
+
+void *operator new(size_t size, const nothrow_t &) SPIRV_CROSS_NOEXCEPT
+{
+	return tracked_allocate(size);
+}
+
+void operator delete(void *ptr) SPIRV_CROSS_NOEXCEPT
+{
+	tracked_free(ptr);
+}
+
+void operator delete(void *ptr, const nothrow_t &) SPIRV_CROSS_NOEXCEPT
+{
+	tracked_free(ptr);
+}
+
+// Peak heap use while a benchmark runs, on top of what was live when it started.
+struct PeakMemoryScope
+{
+	PeakMemoryScope()
+	    : baseline(live_bytes.load())
+	{
+		peak_bytes = baseline;
+	}
+
+	void report(benchmark::State &state) const
+	{
+		state.counters["peak_bytes"] = double(peak_bytes.load() - baseline);
+	}
+
+	size_t baseline;
+};
+
+enum Backend
+{
+	BackendGLSL,
+	BackendHLSL,
+	BackendMSL,
+	BackendCPP,
+	BackendReflect,
+	BackendCount
+};
+
+static const char *backend_names[BackendCount] = { "GLSL", "HLSL", "MSL", "CPP", "Reflect" };
+static const char *backend_tags[BackendCount] = { "glsl", "hlsl", "msl", "cpp", "reflect" };
+
+struct Shader
+{
+	string path;
+	Backend backend;
+	vector<uint32_t> words;
+	unique_ptr<ParsedIR> ir;
+};
+
+static vector<Shader> corpus;
+
+// Shaders of the corpus listed for each backend, which compiled when the corpus was loaded.
+static vector<const Shader *> compilable[BackendCount];
+
+static unique_ptr<Compiler> create_compiler(Backend backend, const ParsedIR &ir, const string &path)
+{
+	switch (backend)
+	{
+	case BackendGLSL:
+	{
+		unique_ptr<CompilerGLSL> compiler(new CompilerGLSL(ir));
+		auto opts = compiler->get_common_options();
+		opts.vulkan_semantics = path.find(".vk.") != string::npos;
+		compiler->set_common_options(opts);
+		return unique_ptr<Compiler>(move(compiler));
+	}
+
+	case BackendHLSL:
+	{
+		unique_ptr<CompilerHLSL> compiler(new CompilerHLSL(ir));
+		auto opts = compiler->get_hlsl_options();
+		opts.shader_model = path.find(".sm6") != string::npos ? 60 : 50;
+		compiler->set_hlsl_options(opts);
+		return unique_ptr<Compiler>(move(compiler));
+	}
+
+	case BackendMSL:
+	{
+		unique_ptr<CompilerMSL> compiler(new CompilerMSL(ir));
+		auto opts = compiler->get_msl_options();
+		opts.set_msl_version(2, 3);
+		opts.platform = path.find(".ios.") != string::npos ? CompilerMSL::Options::iOS : CompilerMSL::Options::macOS;
+		compiler->set_msl_options(opts);
+		return unique_ptr<Compiler>(move(compiler));
+	}
+
+	case BackendCPP:
+		return unique_ptr<Compiler>(new CompilerCPP(ir));
+
+	default:
+		return unique_ptr<Compiler>(new CompilerReflection(ir));
+	}
+}
+
+static bool read_file(const string &path, vector<uint32_t> &words)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file) / sizeof(uint32_t);
+	rewind(file);
+
+	words.resize(len);
+	bool ok = len > 0 && fread(words.data(), sizeof(uint32_t), len, file) == size_t(len);
+	fclose(file);
+	return ok;
+}
+
+static void load_corpus(const string &list_path)
+{
+	ifstream list(list_path);
+	if (!list)
+	{
+		fprintf(stderr, "Failed to open corpus list %s.\n", list_path.c_str());
+		exit(EXIT_FAILURE);
+	}
+
+	string line;
+	while (getline(list, line))
+	{
+		auto split = line.find(' ');
+		if (split == string::npos)
+			continue;
+
+		auto tag = line.substr(0, split);
+		auto path = line.substr(split + 1);
+		int backend = 0;
+		while (backend < BackendCount && tag != backend_tags[backend])
+			backend++;
+		if (backend == BackendCount)
+		{
+			fprintf(stderr, "Unknown backend %s for %s.\n", tag.c_str(), path.c_str());
+			continue;
+		}
+
+		Shader shader;
+		shader.path = path;
+		shader.backend = Backend(backend);
+		if (!read_file(path, shader.words))
+		{
+			fprintf(stderr, "Failed to read %s.\n", path.c_str());
+			continue;
+		}
+
+		try
+		{
+			Parser parser(shader.words);
+			parser.parse();
+			shader.ir.reset(new ParsedIR(move(parser.get_parsed_ir())));
+		}
+		catch (const exception &e)
+		{
+			fprintf(stderr, "Skipping %s, failed to parse: %s\n", path.c_str(), e.what());
+			continue;
+		}
+
+		corpus.push_back(move(shader));
+	}
+
+	for (auto &shader : corpus)
+	{
+		try
+		{
+			create_compiler(shader.backend, *shader.ir, shader.path)->compile();
+			compilable[shader.backend].push_back(&shader);
+		}
+		catch (const exception &e)
+		{
+			fprintf(stderr, "Not compiling %s, failed to compile: %s\n", shader.path.c_str(), e.what());
+		}
+	}
+
+	fprintf(stderr, "Loaded %u shaders.\n", unsigned(corpus.size()));
+	for (int backend = 0; backend < BackendCount; backend++)
+		fprintf(stderr, "  %u compile for %s.\n", unsigned(compilable[backend].size()), backend_names[backend]);
+}
+
+static void report_throughput(benchmark::State &state, size_t shader_count, size_t word_count)
+{
+	state.counters["shaders"] = benchmark::Counter(double(shader_count), benchmark::Counter::kIsIterationInvariantRate);
+	state.counters["words"] = benchmark::Counter(double(word_count), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+static size_t count_words(const vector<const Shader *> &shaders)
+{
+	size_t words = 0;
+	for (auto *shader : shaders)
+		words += shader->words.size();
+	return words;
+}
+
+static vector<const Shader *> all_shaders()
+{
+	vector<const Shader *> shaders;
+	for (auto &shader : corpus)
+		shaders.push_back(&shader);
+	return shaders;
+}
+
+static void bench_parse(benchmark::State &state, vector<const Shader *> shaders)
+{
+	PeakMemoryScope memory;
+	for (auto _ : state)
+	{
+		for (auto *shader : shaders)
+		{
+			Parser parser(shader->words.data(), shader->words.size());
+			parser.parse();
+			benchmark::DoNotOptimize(parser.get_parsed_ir().ids.size());
+		}
+	}
+	memory.report(state);
+	report_throughput(state, shaders.size(), count_words(shaders));
+}
+
+static void bench_copy_ir(benchmark::State &state, vector<const Shader *> shaders)
+{
+	PeakMemoryScope memory;
+	for (auto _ : state)
+	{
+		for (auto *shader : shaders)
+		{
+			ParsedIR ir(*shader->ir);
+			benchmark::DoNotOptimize(ir.ids.size());
+		}
+	}
+	memory.report(state);
+	report_throughput(state, shaders.size(), count_words(shaders));
+}
+
+// Reflection queries which walk the whole module, on compilers constructed up front.
+static void bench_analyze(benchmark::State &state, vector<const Shader *> shaders)
+{
+	vector<unique_ptr<Compiler>> compilers;
+	for (auto *shader : shaders)
+		compilers.emplace_back(new Compiler(*shader->ir));
+
+	PeakMemoryScope memory;
+	for (auto _ : state)
+	{
+		for (auto &compiler : compilers)
+		{
+			auto active = compiler->get_active_interface_variables();
+			auto resources = compiler->get_shader_resources(active);
+			auto constants = compiler->get_specialization_constants();
+			benchmark::DoNotOptimize(resources.uniform_buffers.size() + constants.size());
+		}
+	}
+	memory.report(state);
+	report_throughput(state, shaders.size(), count_words(shaders));
+}
+
+// Constructing the compiler is not timed, it copies the IR, which bench_copy_ir measures.
+static void bench_compile(benchmark::State &state, Backend backend, vector<const Shader *> shaders)
+{
+	PeakMemoryScope memory;
+	for (auto _ : state)
+	{
+		for (auto *shader : shaders)
+		{
+			state.PauseTiming();
+			auto compiler = create_compiler(backend, *shader->ir, shader->path);
+			state.ResumeTiming();
+			benchmark::DoNotOptimize(compiler->compile());
+		}
+	}
+	memory.report(state);
+	report_throughput(state, shaders.size(), count_words(shaders));
+}
+
+// Builds a compute shader with many functions, each a chain of conditional read-modify-writes
+// spread over a number of storage buffers. Scales the number of IDs, blocks and resources independently.
+class SyntheticModule
+{
+public:
+	SyntheticModule(uint32_t functions, uint32_t statements, uint32_t buffers);
+
+	const vector<uint32_t> &get_words() const
+	{
+		return words;
+	}
+
+private:
+	enum
+	{
+		TypeVoid = 1,
+		TypeFunction,
+		TypeFloat,
+		TypeInt,
+		TypeBool,
+		TypeArray,
+		TypeBlock,
+		TypeBlockPointer,
+		TypeFloatPointer,
+		ConstantZero,
+		ConstantTwo,
+		MainFunction,
+		FirstDynamicID
+	};
+
+	void op(spv::Op opcode, std::initializer_list<uint32_t> operands);
+	void op_name(uint32_t id, const string &name);
+	void op_entry_point(uint32_t id, const char *name);
+
+	vector<uint32_t> words;
+	uint32_t bound = FirstDynamicID;
+};
+
+void SyntheticModule::op(spv::Op opcode, std::initializer_list<uint32_t> operands)
+{
+	words.push_back(uint32_t(operands.size() + 1) << 16 | opcode);
+	words.insert(words.end(), operands.begin(), operands.end());
+}
+
+static void append_string(vector<uint32_t> &words, const string &str)
+{
+	size_t word_count = str.size() / 4 + 1;
+	size_t offset = words.size();
+	words.resize(offset + word_count);
+	memcpy(&words[offset], str.c_str(), str.size());
+}
+
+void SyntheticModule::op_name(uint32_t id, const string &name)
+{
+	size_t offset = words.size();
+	words.push_back(spv::OpName);
+	words.push_back(id);
+	append_string(words, name);
+	words[offset] |= uint32_t(words.size() - offset) << 16;
+}
+
+void SyntheticModule::op_entry_point(uint32_t id, const char *name)
+{
+	size_t offset = words.size();
+	words.push_back(spv::OpEntryPoint);
+	words.push_back(spv::ExecutionModelGLCompute);
+	words.push_back(id);
+	append_string(words, name);
+	words[offset] |= uint32_t(words.size() - offset) << 16;
+}
+
+SyntheticModule::SyntheticModule(uint32_t functions, uint32_t statements, uint32_t buffers)
+{
+	const uint32_t num_indices = 16;
+	const uint32_t ids_per_statement = 6;
+
+	uint32_t buffer_ids = bound;
+	bound += buffers;
+	uint32_t index_ids = bound;
+	bound += num_indices;
+	uint32_t function_ids = bound;
+	bound += functions * (2 + statements * ids_per_statement);
+	uint32_t call_ids = bound;
+	bound += functions + 1;
+
+	words = { spv::MagicNumber, 0x10000, 0, 0, 0 };
+	op(spv::OpCapability, { spv::CapabilityShader });
+	op(spv::OpMemoryModel, { spv::AddressingModelLogical, spv::MemoryModelGLSL450 });
+	op_entry_point(MainFunction, "main");
+	op(spv::OpExecutionMode, { MainFunction, spv::ExecutionModeLocalSize, 64, 1, 1 });
+
+	for (uint32_t f = 0; f < functions; f++)
+		op_name(function_ids + f * (2 + statements * ids_per_statement), "func" + to_string(f));
+
+	op(spv::OpDecorate, { TypeArray, spv::DecorationArrayStride, 4 });
+	op(spv::OpMemberDecorate, { TypeBlock, 0, spv::DecorationOffset, 0 });
+	op(spv::OpDecorate, { TypeBlock, spv::DecorationBufferBlock });
+	for (uint32_t b = 0; b < buffers; b++)
+	{
+		op(spv::OpDecorate, { buffer_ids + b, spv::DecorationDescriptorSet, 0 });
+		op(spv::OpDecorate, { buffer_ids + b, spv::DecorationBinding, b });
+	}
+
+	op(spv::OpTypeVoid, { TypeVoid });
+	op(spv::OpTypeFunction, { TypeFunction, TypeVoid });
+	op(spv::OpTypeFloat, { TypeFloat, 32 });
+	op(spv::OpTypeInt, { TypeInt, 32, 1 });
+	op(spv::OpTypeBool, { TypeBool });
+	op(spv::OpTypeRuntimeArray, { TypeArray, TypeFloat });
+	op(spv::OpTypeStruct, { TypeBlock, TypeArray });
+	op(spv::OpTypePointer, { TypeBlockPointer, spv::StorageClassUniform, TypeBlock });
+	op(spv::OpTypePointer, { TypeFloatPointer, spv::StorageClassUniform, TypeFloat });
+	op(spv::OpConstant, { TypeInt, ConstantZero, 0 });
+	op(spv::OpConstant, { TypeFloat, ConstantTwo, 0x40000000 });
+	for (uint32_t i = 0; i < num_indices; i++)
+		op(spv::OpConstant, { TypeInt, index_ids + i, i });
+	for (uint32_t b = 0; b < buffers; b++)
+		op(spv::OpVariable, { TypeBlockPointer, buffer_ids + b, spv::StorageClassUniform });
+
+	uint32_t id = function_ids;
+	for (uint32_t f = 0; f < functions; f++)
+	{
+		op(spv::OpFunction, { TypeVoid, id++, spv::FunctionControlMaskNone, TypeFunction });
+		op(spv::OpLabel, { id++ });
+		for (uint32_t s = 0; s < statements; s++)
+		{
+			uint32_t ptr = id++, value = id++, scaled = id++, cond = id++, then_block = id++, merge_block = id++;
+			op(spv::OpAccessChain,
+			   { TypeFloatPointer, ptr, buffer_ids + (f + s) % buffers, ConstantZero, index_ids + s % num_indices });
+			op(spv::OpLoad, { TypeFloat, value, ptr });
+			op(spv::OpFMul, { TypeFloat, scaled, value, ConstantTwo });
+			op(spv::OpFOrdGreaterThan, { TypeBool, cond, scaled, ConstantTwo });
+			op(spv::OpSelectionMerge, { merge_block, spv::SelectionControlMaskNone });
+			op(spv::OpBranchConditional, { cond, then_block, merge_block });
+			op(spv::OpLabel, { then_block });
+			op(spv::OpStore, { ptr, scaled });
+			op(spv::OpBranch, { merge_block });
+			op(spv::OpLabel, { merge_block });
+		}
+		op(spv::OpReturn, {});
+		op(spv::OpFunctionEnd, {});
+	}
+
+	op(spv::OpFunction, { TypeVoid, MainFunction, spv::FunctionControlMaskNone, TypeFunction });
+	op(spv::OpLabel, { call_ids + functions });
+	for (uint32_t f = 0; f < functions; f++)
+		op(spv::OpFunctionCall, { TypeVoid, call_ids + f, function_ids + f * (2 + statements * ids_per_statement) });
+	op(spv::OpReturn, {});
+	op(spv::OpFunctionEnd, {});
+
+	words[3] = bound;
+}
+
+static void bench_synthetic_parse(benchmark::State &state)
+{
+	SyntheticModule module(uint32_t(state.range(0)), uint32_t(state.range(1)), uint32_t(state.range(2)));
+	auto &words = module.get_words();
+
+	PeakMemoryScope memory;
+	for (auto _ : state)
+	{
+		Parser parser(words.data(), words.size());
+		parser.parse();
+		benchmark::DoNotOptimize(parser.get_parsed_ir().ids.size());
+	}
+	memory.report(state);
+	report_throughput(state, 1, words.size());
+}
+
+static void bench_synthetic_compile(benchmark::State &state, Backend backend)
+{
+	SyntheticModule module(uint32_t(state.range(0)), uint32_t(state.range(1)), uint32_t(state.range(2)));
+	auto &words = module.get_words();
+	Parser parser(words.data(), words.size());
+	parser.parse();
+	auto &ir = parser.get_parsed_ir();
+
+	PeakMemoryScope memory;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		auto compiler = create_compiler(backend, ir, "");
+		state.ResumeTiming();
+		benchmark::DoNotOptimize(compiler->compile());
+	}
+	memory.report(state);
+	report_throughput(state, 1, words.size());
+}
+
+static void add_synthetic_sizes(benchmark::internal::Benchmark *bench)
+{
+	bench->ArgNames({ "functions", "statements", "buffers" });
+	bench->Args({ 8, 64, 4 });
+	bench->Args({ 64, 64, 4 });
+	bench->Args({ 64, 512, 4 });
+	bench->Args({ 64, 64, 256 });
+	bench->Unit(benchmark::kMillisecond);
+}
+
+static void register_benchmarks()
+{
+	if (!corpus.empty())
+	{
+		auto shaders = all_shaders();
+		benchmark::RegisterBenchmark("Corpus/Parse", bench_parse, shaders)->Unit(benchmark::kMillisecond);
+		benchmark::RegisterBenchmark("Corpus/CopyIR", bench_copy_ir, shaders)->Unit(benchmark::kMillisecond);
+		benchmark::RegisterBenchmark("Corpus/Analyze", bench_analyze, shaders)->Unit(benchmark::kMillisecond);
+		for (int backend = 0; backend < BackendCount; backend++)
+		{
+			if (compilable[backend].empty())
+				continue;
+			auto name = string("Corpus/Compile/") + backend_names[backend];
+			benchmark::RegisterBenchmark(name.c_str(), bench_compile, Backend(backend), compilable[backend])
+			    ->Unit(benchmark::kMillisecond);
+		}
+	}
+
+	add_synthetic_sizes(benchmark::RegisterBenchmark("Synthetic/Parse", bench_synthetic_parse));
+	for (int backend = 0; backend < BackendCount; backend++)
+	{
+		auto name = string("Synthetic/Compile/") + backend_names[backend];
+		add_synthetic_sizes(benchmark::RegisterBenchmark(name.c_str(), bench_synthetic_compile, Backend(backend)));
+	}
+}
+
+int main(int argc, char **argv)
+{
+	// Strip our own arguments before Google Benchmark sees them.
+	const char *corpus_prefix = "--corpus=";
+	int out_argc = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], corpus_prefix, strlen(corpus_prefix)) == 0)
+			load_corpus(argv[i] + strlen(corpus_prefix));
+		else
+			argv[out_argc++] = argv[i];
+	}
+	argc = out_argc;
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return EXIT_FAILURE;
+
+	register_benchmarks();
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return EXIT_SUCCESS;
+}
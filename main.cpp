@@ -22,6 +22,7 @@
  */
 
 #include "spirv_cpp.hpp"
+#include "spirv_cross_serialized_ir.hpp"
 #include "spirv_cross_util.hpp"
 #include "spirv_glsl.hpp"
 #include "spirv_hlsl.hpp"
@@ -29,12 +30,17 @@
 #include "spirv_parser.hpp"
 #include "spirv_reflect.hpp"
 #include <algorithm>
+#include <cctype>
 #include <cstdio>
 #include <cstring>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -279,6 +285,21 @@ static bool write_string_to_file(const char *path, const char *string)
 	return true;
 }
 
+// Compiled output may be binary, e.g. CBOR reflection, so write all of it rather than stopping at a NUL byte.
+static bool write_output_to_file(const char *path, const string &output, bool binary)
+{
+	FILE *file = fopen(path, binary ? "wb" : "w");
+	if (!file)
+	{
+		fprintf(stderr, "Failed to write file: %s\n", path);
+		return false;
+	}
+
+	bool ok = fwrite(output.data(), 1, output.size(), file) == output.size();
+	fclose(file);
+	return ok;
+}
+
 #if defined(__clang__) || defined(__GNUC__)
 #pragma GCC diagnostic pop
 #elif defined(_MSC_VER)
@@ -587,6 +608,81 @@ static void print_capabilities_and_extensions(const Compiler &compiler)
 	fprintf(stderr, "============\n\n");
 }
 
+static void print_resource_costs(const ResourceCostReport &report)
+{
+	fprintf(stderr, "Resource costs\n");
+	fprintf(stderr, "==============\n");
+	fprintf(stderr, "Workgroup memory: %u bytes\n", report.workgroup_memory_size);
+	fprintf(stderr, "Backend workgroup memory: %u bytes\n", report.backend_workgroup_memory_size);
+	fprintf(stderr, "Local arrays: %u bytes\n", report.local_array_size);
+	fprintf(stderr, "Hoisted temporaries: %u\n", report.hoisted_temporary_count);
+	fprintf(stderr, "Forced temporaries: %u\n", report.forced_temporary_count);
+	fprintf(stderr, "Loops: %u\n", report.loop_count);
+	for (auto &helper : report.helper_functions)
+		fprintf(stderr, "Helper function: %s\n", helper.c_str());
+	fprintf(stderr, "==============\n\n");
+}
+
+static void print_memory_statistics(const char *title, const Compiler::MemoryStatistics &stats)
+{
+	static const char *const pool_names[TypeCount] = {
+		"None", "Type", "Variable", "Constant", "Function", "FunctionPrototype", "Block",
+		"Extension", "Expression", "ConstantOp", "CombinedImageSampler", "AccessChain", "Undef", "String",
+	};
+
+	fprintf(stderr, "Memory statistics %s\n", title);
+	fprintf(stderr, "============\n");
+	for (int i = 0; i < TypeCount; i++)
+	{
+		auto &pool = stats.pools[i];
+		if (pool.reserved_bytes)
+			fprintf(stderr, "Pool %s: %llu objects, %zu bytes live, %zu bytes reserved\n", pool_names[i],
+			        static_cast<unsigned long long>(pool.live_objects), pool.live_bytes, pool.reserved_bytes);
+	}
+	fprintf(stderr, "Meta: %zu entries, %zu bytes\n", stats.meta_count, stats.meta_bytes);
+	fprintf(stderr, "SPIR-V: %zu bytes%s\n", stats.spirv_bytes, stats.spirv_borrowed ? " (borrowed)" : "");
+	fprintf(stderr, "Expression strings: %zu bytes\n", stats.expression_string_bytes);
+	fprintf(stderr, "Output blocks: %zu\n", stats.output_block_count);
+	fprintf(stderr, "============\n\n");
+}
+
+static void print_descriptor_heap_slots(const Compiler &compiler, bool is_hlsl)
+{
+	auto &slots = compiler.get_descriptor_heap_slots();
+	if (slots.empty())
+		return;
+
+	fprintf(stderr, "Descriptor heap slots\n");
+	fprintf(stderr, "=====================\n");
+	for (auto &slot : slots)
+	{
+		fprintf(stderr, "ID %03u (%s): set = %u, binding = %u -> ", uint32_t(slot.id),
+		        compiler.get_name(slot.id).c_str(), slot.desc_set, slot.binding);
+		if (is_hlsl)
+			fprintf(stderr, "%s, index %u\n", slot.sampler_heap ? "SamplerDescriptorHeap" : "ResourceDescriptorHeap", slot.index);
+		else
+			fprintf(stderr, "heap binding %u, index %u\n", slot.heap_binding, slot.index);
+	}
+	fprintf(stderr, "=====================\n\n");
+}
+
+static void print_lowered_luts(const Compiler &compiler, bool is_hlsl)
+{
+	auto &luts = compiler.get_lowered_luts();
+	if (luts.empty())
+		return;
+
+	fprintf(stderr, "Lowered lookup tables\n");
+	fprintf(stderr, "=====================\n");
+	for (auto &lut : luts)
+	{
+		fprintf(stderr, "ID %03u (%s): %s = %u, %s = %u, %zu bytes\n", uint32_t(lut.constant),
+		        compiler.get_name(lut.constant).c_str(), is_hlsl ? "space" : "set", lut.desc_set,
+		        is_hlsl ? "register" : "binding", lut.binding, lut.data.size());
+	}
+	fprintf(stderr, "=====================\n\n");
+}
+
 struct PLSArg
 {
 	PlsFormat format;
@@ -633,6 +729,8 @@ struct CLIArguments
 	bool set_msl_version = false;
 	bool set_es = false;
 	bool dump_resources = false;
+	bool dump_resource_costs = false;
+	bool dump_memory_statistics = false;
 	bool force_temporary = false;
 	bool flatten_ubo = false;
 	bool fixup = false;
@@ -656,6 +754,7 @@ struct CLIArguments
 	bool msl_dispatch_base = false;
 	bool msl_decoration_binding = false;
 	bool msl_force_active_argument_buffer_resources = false;
+	bool msl_argument_buffers_stable_layout = false;
 	bool msl_force_native_arrays = false;
 	bool msl_enable_frag_depth_builtin = true;
 	bool msl_enable_frag_stencil_ref_builtin = true;
@@ -664,6 +763,8 @@ struct CLIArguments
 	bool msl_raw_buffer_tese_input = false;
 	bool msl_multi_patch_workgroup = false;
 	bool msl_vertex_for_tessellation = false;
+	bool msl_pack_tessellation_buffers = false;
+	bool msl_pack_tessellation_buffers_half = false;
 	uint32_t msl_additional_fixed_sample_mask = 0xffffffff;
 	bool msl_arrayed_subpass_input = false;
 	uint32_t msl_r32ui_linear_texture_alignment = 4;
@@ -676,12 +777,21 @@ struct CLIArguments
 	bool msl_manual_helper_invocation_updates = true;
 	bool msl_check_discarded_frag_stores = false;
 	bool msl_sample_dref_lod_array_as_grad = false;
+	bool msl_relaxed_precision_as_16bit = false;
 	bool msl_runtime_array_rich_descriptor = false;
 	const char *msl_combined_sampler_suffix = nullptr;
+	const char *msl_spv_function_library = nullptr;
+	const char *msl_spv_function_library_output = nullptr;
 	bool glsl_emit_push_constant_as_ubo = false;
 	bool glsl_emit_ubo_as_plain_uniforms = false;
 	bool glsl_force_flattened_io_blocks = false;
 	uint32_t glsl_ovr_multiview_view_count = 0;
+	bool glsl_minify = false;
+	bool glsl_descriptor_heap = false;
+	uint32_t glsl_descriptor_heap_set = 0;
+	uint32_t glsl_lut_buffer_min_size = 0;
+	uint32_t glsl_lut_buffer_set = 0;
+	uint32_t glsl_lut_buffer_binding = 0;
 	SmallVector<pair<uint32_t, uint32_t>> glsl_ext_framebuffer_fetch;
 	bool glsl_ext_framebuffer_fetch_noncoherent = false;
 	bool vulkan_glsl_disable_ext_samplerless_texture_functions = false;
@@ -689,6 +799,7 @@ struct CLIArguments
 	bool enable_storage_image_qualifier_deduction = true;
 	bool force_zero_initialized_variables = false;
 	bool relax_nan_checks = false;
+	uint32_t common_subexpression_min_cost = 0;
 	uint32_t force_recompile_max_debug_iterations = 3;
 	SmallVector<uint32_t> msl_discrete_descriptor_sets;
 	SmallVector<uint32_t> msl_device_argument_buffers;
@@ -702,6 +813,7 @@ struct CLIArguments
 	SmallVector<string> extensions;
 	SmallVector<VariableTypeRemap> variable_type_remaps;
 	SmallVector<InterfaceVariableRename> interface_variable_renames;
+	SmallVector<pair<uint32_t, uint32_t>> specialization_constant_values;
 	SmallVector<HLSLVertexAttributeRemap> hlsl_attr_remap;
 	SmallVector<HLSLVertexAttributeRemapNamed> hlsl_attr_remap_named;
 	SmallVector<std::pair<uint32_t, uint32_t>> masked_stage_outputs;
@@ -734,12 +846,29 @@ struct CLIArguments
 	bool hlsl_enable_16bit_types = false;
 	bool hlsl_flatten_matrix_vertex_input_semantics = false;
 	bool hlsl_preserve_structured_buffers = false;
+	bool hlsl_relaxed_precision_as_16bit = false;
+	uint32_t hlsl_root_constant_promotion_budget = 0;
+	bool hlsl_descriptor_heap = false;
+	uint32_t hlsl_descriptor_heap_index_register = 0;
+	uint32_t hlsl_descriptor_heap_index_space = 0;
+	uint32_t hlsl_lut_buffer_min_size = 0;
+	uint32_t hlsl_lut_buffer_register = 0;
+	uint32_t hlsl_lut_buffer_space = 0;
 	HLSLBindingFlags hlsl_binding_flags = 0;
 	bool vulkan_semantics = false;
 	bool flatten_multidimensional_arrays = false;
 	bool use_420pack_extension = true;
 	bool remove_unused = false;
+	bool remove_unreachable = false;
 	bool combined_samplers_inherit_bindings = false;
+
+	const char *batch = nullptr;
+	uint32_t batch_threads = 0;
+	uint32_t threads = 0;
+	const char *profile = nullptr;
+	const char *serialize_ir = nullptr;
+	double compile_budget_seconds = 0.0;
+	uint32_t compile_budget_work = 0;
 };
 
 static void print_version()
@@ -759,7 +888,7 @@ static void print_help_backend()
 	        "\t[--vulkan-semantics] or [-V]:\n\t\tEmit Vulkan GLSL instead of plain GLSL. Makes use of Vulkan-only features to match SPIR-V.\n"
 	        "\t[--msl]:\n\t\tEmit Metal Shading Language (MSL).\n"
 	        "\t[--hlsl]:\n\t\tEmit HLSL.\n"
-	        "\t[--reflect]:\n\t\tEmit JSON reflection.\n"
+	        "\t[--reflect [json|json-compact|cbor]]:\n\t\tEmit reflection, as indented JSON by default.\n"
 	        "\t[--cpp]:\n\t\tDEPRECATED. Emits C++ code.\n"
 	);
 	// clang-format on
@@ -781,6 +910,8 @@ static void print_help_glsl()
 	                "\t[--extension ext]:\n\t\tAdd #extension string of your choosing to GLSL output.\n"
 	                "\t\tUseful if you use variable name remapping to something that requires an extension unknown to SPIRV-Cross.\n"
 	                "\t[--remove-unused-variables]:\n\t\tDo not emit interface variables which are not statically accessed by the shader.\n"
+	                "\t[--remove-unreachable]:\n\t\tRemove functions, global variables and types which the entry point does not reach\n"
+	                "\t\tbefore compiling. Only the selected entry point can be compiled.\n"
 	                "\t[--separate-shader-objects]:\n\t\tRedeclare gl_PerVertex blocks to be suitable for desktop GL separate shader objects.\n"
 	                "\t[--glsl-emit-push-constant-as-ubo]:\n\t\tInstead of a plain uniform of struct for push constants, emit a UBO block instead.\n"
 	                "\t[--glsl-emit-ubo-as-plain-uniforms]:\n\t\tInstead of emitting UBOs, emit them as plain uniform structs.\n"
@@ -810,6 +941,12 @@ static void print_help_glsl()
 	                "\t\tPrimary use case is supporting external samplers in ESSL for video rendering on Android where you could remap a texture to a YUV one.\n"
 	                "\t[--glsl-force-flattened-io-blocks]:\n\t\tAlways flatten I/O blocks and structs.\n"
 	                "\t[--glsl-ovr-multiview-view-count count]:\n\t\tIn GL_OVR_multiview2, specify layout(num_views).\n"
+	                "\t[--glsl-minify]:\n\t\tEmit compact GLSL without indentation, comments or redundant whitespace,\n"
+	                "\t\tand give locals, temporaries and functions the shortest unused names.\n"
+	                "\t[--glsl-descriptor-heap <set>]:\n\t\tVulkan GLSL: index resources out of runtime arrays in descriptor set <set>,\n"
+	                "\t\twith the indices in a push constant block. With --dump-resources, the heap slots are printed.\n"
+	                "\t[--glsl-lut-buffer <min-size> <set> <binding>]:\n\t\tDeclare constant lookup tables of at least <min-size> bytes as readonly buffers\n"
+	                "\t\tfrom <binding> in <set> onwards. With --dump-resources, the tables are printed.\n"
 	);
 	// clang-format on
 }
@@ -842,6 +979,13 @@ static void print_help_hlsl()
 	                "\t[--hlsl-enable-16bit-types]:\n\t\tEnables native use of half/int16_t/uint16_t and ByteAddressBuffer interaction with these types. Requires SM 6.2.\n"
 	                "\t[--hlsl-flatten-matrix-vertex-input-semantics]:\n\t\tEmits matrix vertex inputs with input semantics as if they were independent vectors, e.g. TEXCOORD{2,3,4} rather than matrix form TEXCOORD2_{0,1,2}.\n"
 	                "\t[--hlsl-preserve-structured-buffers]:\n\t\tEmit SturucturedBuffer<T> rather than ByteAddressBuffer. Requires UserTypeGOOGLE to be emitted. Intended for DXC roundtrips.\n"
+	                "\t[--hlsl-relaxed-precision-as-16bit]:\n\t\tComputes RelaxedPrecision float arithmetic as min16float, or half with --hlsl-enable-16bit-types.\n"
+	                "\t[--hlsl-root-constant-promotion-budget <dwords>]:\n\t\tPromotes small cbuffers to root constants until they use up <dwords> 32-bit values.\n"
+	                "\t\tWith --dump-resources, the matching root signature parameters are printed.\n"
+	                "\t[--hlsl-descriptor-heap <register> <space>]:\n\t\tSM 6.6: load resources from ResourceDescriptorHeap and SamplerDescriptorHeap,\n"
+	                "\t\twith the indices in a cbuffer at b<register> in <space>. With --dump-resources, the heap slots are printed.\n"
+	                "\t[--hlsl-lut-buffer <min-size> <register> <space>]:\n\t\tDeclare constant lookup tables of at least <min-size> bytes as StructuredBuffers\n"
+	                "\t\tfrom t<register> in <space> onwards. With --dump-resources, the tables are printed.\n"
 	);
 	// clang-format on
 }
@@ -893,6 +1037,8 @@ static void print_help_msl()
 	                "\t\tHowever, if the shader author knows of binding limitations, this option will avoid the need for reflection on Metal side.\n"
 	                "\t[--msl-force-active-argument-buffer-resources]:\n\t\tAlways emit resources which are part of argument buffers.\n"
 	                "\t\tThis makes sure that similar shaders with same resource declarations can share the argument buffer as declaring an argument buffer implies an ABI.\n"
+	                "\t[--msl-argument-buffers-stable-layout]:\n\t\tWith Tier 2 argument buffers, pad unused resources so [[id(N)]] is always at byte offset 8 * N.\n"
+	                "\t\tShaders sharing a descriptor set can then share one directly written argument buffer.\n"
 	                "\t[--msl-force-native-arrays]:\n\t\tRather than implementing array types as a templated value type ala std::array<T>, use plain, native arrays.\n"
 	                "\t\tThis will lead to worse code-gen, but can work around driver bugs on certain driver revisions of certain Intel-based Macbooks where template arrays break.\n"
 	                "\t[--msl-disable-frag-depth-builtin]:\n\t\tDisables FragDepth output. Useful if pipeline does not enable depth, as pipeline creation might otherwise fail.\n"
@@ -926,6 +1072,10 @@ static void print_help_msl()
 	                "\t\tIn a future version of SPIRV-Cross, this will become the default.\n"
 	                "\t[--msl-vertex-for-tessellation]:\n\t\tWhen handling a vertex shader, marks it as one that will be used with a new-style tessellation control shader.\n"
 	                "\t\tThe vertex shader is output to MSL as a compute kernel which outputs vertices to the buffer in the order they are received, rather than in index order as with --msl-capture-output normally.\n"
+	                "\t[--msl-pack-tessellation-buffers]:\n\t\tTightly pack vectors in buffers which tessellation stages exchange data through, i.e. captured output, "
+	                "multi-patch workgroup input and raw buffer tessellation evaluation input.\n"
+	                "\t\tAll stages which share a buffer must use this option.\n"
+	                "\t[--msl-pack-tessellation-buffers-half]:\n\t\tWith --msl-pack-tessellation-buffers, also store RelaxedPrecision float variables as half.\n"
 	                "\t[--msl-additional-fixed-sample-mask <mask>]:\n"
 	                "\t\tSet an additional fixed sample mask. If the shader outputs a sample mask, then the final sample mask will be a bitwise AND of the two.\n"
 	                "\t[--msl-arrayed-subpass-input]:\n\t\tAssume that images of dimension SubpassData have multiple layers. Layered input attachments are accessed relative to BuiltInLayer.\n"
@@ -956,7 +1106,10 @@ static void print_help_msl()
 	                "\t\tSome Metal devices have a bug where the level() argument to\n"
 	                "\t\tdepth2d_array<T>::sample_compare() in a fragment shader is biased by some\n"
 	                "\t\tunknown amount. This prevents the bias from being added.\n"
-	                "\t[--msl-combined-sampler-suffix <suffix>]:\n\t\tUses a custom suffix for combined samplers.\n");
+	                "\t[--msl-relaxed-precision-as-16bit]:\n\t\tComputes RelaxedPrecision float arithmetic as half.\n"
+	                "\t[--msl-combined-sampler-suffix <suffix>]:\n\t\tUses a custom suffix for combined samplers.\n"
+	                "\t[--msl-spv-function-library <header>]:\n\t\tIncludes helper functions from <header> instead of emitting them into the shader.\n"
+	                "\t[--msl-spv-function-library-output <path>]:\n\t\tWrites a header declaring the helper functions this shader uses to <path>.\n");
 	// clang-format on
 }
 
@@ -971,6 +1124,8 @@ static void print_help_common()
 	                "\t[--rename-entry-point <old> <new> <stage>]:\n\t\tRenames an entry point from what is declared in SPIR-V to code output.\n"
 	                "\t\tMostly relevant for HLSL or MSL.\n"
 	                "\t[--rename-interface-variable <in|out> <location> <new_variable_name>]:\n\t\tRename an interface variable based on location decoration.\n"
+	                "\t[--specialize-constant <spec id> <value>]:\n\t\tCompiles with the specialization constant set to the raw 32-bit value.\n"
+	                "\t\tSpecialization constant expressions are folded and dead branches removed.\n"
 	                "\t[--force-zero-initialized-variables]:\n\t\tForces temporary variables to be initialized to zero.\n"
 	                "\t\tCan be useful in environments where compilers do not allow potentially uninitialized variables.\n"
 	                "\t\tThis usually comes up with Phi temporaries.\n"
@@ -984,6 +1139,8 @@ static void print_help_common()
 	                "\t\tIf a stage output variable with matching builtin is active, "
 	                "optimize away the variable if it can affect cross-stage linking correctness.\n"
 	                "\t[--relax-nan-checks]:\n\t\tRelax NaN checks for N{Clamp,Min,Max} and ordered vs. unordered compare instructions.\n"
+	                "\t[--eliminate-common-subexpressions <min cost>]:\n\t\tCompute expressions of at least <min cost> operations which a block repeats\n"
+	                "\t\tonce into a temporary.\n"
 	);
 	// clang-format on
 }
@@ -1017,6 +1174,20 @@ static void print_help()
 	                "\t[SPIR-V file] (- is stdin)\n"
 	                "\t[--output <output path>]: If not provided, prints output to stdout.\n"
 	                "\t[--dump-resources]:\n\t\tPrints a basic reflection of the SPIR-V module along with other output.\n"
+	                "\t[--dump-resource-costs]:\n\t\tPrints the estimated GPU resource costs of the compiled entry point along with other output.\n"
+	                "\t[--dump-memory-statistics]:\n\t\tPrints the memory held by the IR before and after compiling.\n"
+	                "\t\tWith --reflect, reports the costs which do not depend on a backend in the JSON of each entry point instead.\n"
+	                "\t[--batch <manifest>]:\n\t\tCompiles every entry of a manifest file (- is stdin) on a thread pool.\n"
+	                "\t\tEach line holds the arguments for one entry, e.g. \"shader.spv --output shader.metal --msl\",\n"
+	                "\t\twhich are applied on top of the arguments given on the command line.\n"
+	                "\t\tFailures are reported per entry once all entries have been processed.\n"
+	                "\t[--batch-threads <count>]:\n\t\tNumber of threads used for --batch. Defaults to the number of hardware threads.\n"
+	                "\t[--threads <count>]:\n\t\tNumber of threads used for parsing function bodies and per-function analysis within one compile. Defaults to 1.\n"
+	                "\t[--profile <path>]:\n\t\tWrites wall time, IR allocations and force-recompile counts of each compiler pass as JSON.\n"
+	                "\t\tWith --iterations, the last iteration is reported. In --batch mode, give it per entry.\n"
+	                "\t[--serialize-ir <path>]:\n\t\tWrites the parsed IR to <path>. Giving such a file as input loads it instead of parsing SPIR-V.\n"
+	                "\t[--compile-budget <seconds> <work>]:\n\t\tFails compilation which takes longer than <seconds> or more than <work> instructions\n"
+	                "\t\tanalyzed and emitted. 0 means no limit.\n"
 	                "\t[--help]:\n\t\tPrints this help message.\n"
 	);
 	// clang-format on
@@ -1029,6 +1200,31 @@ static void print_help()
 	print_help_obscure();
 }
 
+// Usage errors found while setting up a compile. A --batch run records them per entry,
+// a single-file run prints them on their own, as it did before --batch existed.
+struct CLIError : runtime_error
+{
+	CLIError(const string &message, bool show_help_)
+	    : runtime_error(message)
+	    , show_help(show_help_)
+	{
+	}
+
+	bool show_help;
+};
+
+[[noreturn]] static void cli_error(const string &message, bool show_help = false)
+{
+#ifdef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+	fprintf(stderr, "%s\n", message.c_str());
+	if (show_help)
+		print_help();
+	exit(EXIT_FAILURE);
+#else
+	throw CLIError(message, show_help);
+#endif
+}
+
 static bool remap_generic(Compiler &compiler, const SmallVector<Resource> &resources, const Remap &remap)
 {
 	auto itr =
@@ -1168,26 +1364,126 @@ static HLSLBindingFlags hlsl_resource_type_to_flag(const std::string &arg)
 	}
 }
 
-static string compile_iteration(const CLIArguments &args, std::vector<uint32_t> spirv_file)
+// The HLSL and MSL backends carry their own copy of the common GLSL options,
+// so apply the command line to whichever options struct the backend uses.
+template <typename CommonOptions>
+static void apply_common_options(CommonOptions &opts, const CLIArguments &args)
+{
+	if (args.set_version)
+		opts.version = args.version;
+	if (args.set_es)
+		opts.es = args.es;
+	opts.force_temporary = args.force_temporary;
+	opts.separate_shader_objects = args.sso;
+	opts.flatten_multidimensional_arrays = args.flatten_multidimensional_arrays;
+	opts.enable_420pack_extension = args.use_420pack_extension;
+	opts.vulkan_semantics = args.vulkan_semantics;
+	opts.vertex.fixup_clipspace = args.fixup;
+	opts.vertex.flip_vert_y = args.yflip;
+	opts.vertex.support_nonzero_base_instance = args.support_nonzero_baseinstance;
+	opts.emit_push_constant_as_uniform_buffer = args.glsl_emit_push_constant_as_ubo;
+	opts.emit_uniform_buffer_as_plain_uniforms = args.glsl_emit_ubo_as_plain_uniforms;
+	opts.force_flattened_io_blocks = args.glsl_force_flattened_io_blocks;
+	opts.ovr_multiview_view_count = args.glsl_ovr_multiview_view_count;
+	opts.emit_line_directives = args.emit_line_directives;
+	opts.enable_storage_image_qualifier_deduction = args.enable_storage_image_qualifier_deduction;
+	opts.force_zero_initialized_variables = args.force_zero_initialized_variables;
+	opts.relax_nan_checks = args.relax_nan_checks;
+	opts.common_subexpression_min_cost = args.common_subexpression_min_cost;
+	opts.force_recompile_max_debug_iterations = args.force_recompile_max_debug_iterations;
+}
+
+template <typename Backend>
+static void set_common_options(Backend &compiler, const CLIArguments &args)
+{
+	if (!args.set_version && !compiler.get_common_options().version)
+	{
+		cli_error("Didn't specify GLSL version and SPIR-V did not specify language.", true);
+	}
+
+	auto opts = compiler.get_common_options();
+	apply_common_options(opts, args);
+	compiler.set_common_options(opts);
+}
+
+static void run_work_stealing(size_t job_count, unsigned thread_count, const function<void(size_t)> &job);
+
+// Spreads independent per-function work over thread_count threads.
+static CompilerTaskRunner make_task_runner(unsigned thread_count)
 {
+	return [thread_count](uint32_t count, const function<void(uint32_t)> &task) {
+		exception_ptr error;
+		mutex error_lock;
+		run_work_stealing(count, std::min<unsigned>(thread_count, count), [&](size_t index) {
+			try
+			{
+				task(uint32_t(index));
+			}
+			catch (...)
+			{
+				lock_guard<mutex> holder(error_lock);
+				if (!error)
+					error = current_exception();
+			}
+		});
+
+		if (error)
+			rethrow_exception(error);
+	};
+}
+
+// Loads the input, which is either SPIR-V or IR written by --serialize-ir.
+static ParsedIR parse_input(const CLIArguments &args, vector<uint32_t> spirv_file)
+{
+	ParsedIR ir;
+	size_t size = spirv_file.size() * sizeof(uint32_t);
+	if (is_serialized_ir(spirv_file.data(), size))
+	{
+		deserialize_parsed_ir(ir, spirv_file.data(), size);
+		return ir;
+	}
+
 	Parser spirv_parser(std::move(spirv_file));
+	if (args.threads > 1)
+		spirv_parser.set_task_runner(make_task_runner(args.threads));
 	spirv_parser.parse();
+	ir = std::move(spirv_parser.get_parsed_ir());
 
-	unique_ptr<CompilerGLSL> compiler;
+	if (args.serialize_ir)
+	{
+		auto blob = serialize_parsed_ir(ir);
+		if (!write_output_to_file(args.serialize_ir, string(blob.begin(), blob.end()), true))
+			THROW("Failed to write serialized IR.");
+	}
+
+	return ir;
+}
+
+static string compile_iteration(const CLIArguments &args, std::vector<uint32_t> spirv_file,
+                                vector<CompilerPassProfile> *profile)
+{
+	auto parsed_ir = parse_input(args, std::move(spirv_file));
+
+	unique_ptr<Compiler> compiler;
+	CompilerGLSL *glsl_comp = nullptr;
+	CompilerHLSL *hlsl_comp = nullptr;
+	CompilerMSL *msl_comp = nullptr;
 	bool combined_image_samplers = false;
 	bool build_dummy_sampler = false;
 
 	if (args.cpp)
 	{
-		compiler.reset(new CompilerCPP(std::move(spirv_parser.get_parsed_ir())));
+		auto *cpp_comp = new CompilerCPP(std::move(parsed_ir));
+		compiler.reset(cpp_comp);
+		glsl_comp = cpp_comp;
 		if (args.cpp_interface_name)
-			static_cast<CompilerCPP *>(compiler.get())->set_interface_name(args.cpp_interface_name);
+			cpp_comp->set_interface_name(args.cpp_interface_name);
 	}
 	else if (args.msl)
 	{
-		compiler.reset(new CompilerMSL(std::move(spirv_parser.get_parsed_ir())));
+		msl_comp = new CompilerMSL(std::move(parsed_ir));
+		compiler.reset(msl_comp);
 
-		auto *msl_comp = static_cast<CompilerMSL *>(compiler.get());
 		auto msl_opts = msl_comp->get_msl_options();
 		if (args.set_msl_version)
 			msl_opts.msl_version = args.msl_version;
@@ -1211,6 +1507,7 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 		msl_opts.dispatch_base = args.msl_dispatch_base;
 		msl_opts.enable_decoration_binding = args.msl_decoration_binding;
 		msl_opts.force_active_argument_buffer_resources = args.msl_force_active_argument_buffer_resources;
+		msl_opts.argument_buffers_stable_layout = args.msl_argument_buffers_stable_layout;
 		msl_opts.force_native_arrays = args.msl_force_native_arrays;
 		msl_opts.enable_frag_depth_builtin = args.msl_enable_frag_depth_builtin;
 		msl_opts.enable_frag_stencil_ref_builtin = args.msl_enable_frag_stencil_ref_builtin;
@@ -1219,6 +1516,8 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 		msl_opts.raw_buffer_tese_input = args.msl_raw_buffer_tese_input;
 		msl_opts.multi_patch_workgroup = args.msl_multi_patch_workgroup;
 		msl_opts.vertex_for_tessellation = args.msl_vertex_for_tessellation;
+		msl_opts.pack_tessellation_buffers = args.msl_pack_tessellation_buffers;
+		msl_opts.pack_tessellation_buffers_relaxed_precision_as_half = args.msl_pack_tessellation_buffers_half;
 		msl_opts.additional_fixed_sample_mask = args.msl_additional_fixed_sample_mask;
 		msl_opts.arrayed_subpass_input = args.msl_arrayed_subpass_input;
 		msl_opts.r32ui_linear_texture_alignment = args.msl_r32ui_linear_texture_alignment;
@@ -1231,6 +1530,7 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 		msl_opts.manual_helper_invocation_updates = args.msl_manual_helper_invocation_updates;
 		msl_opts.check_discarded_frag_stores = args.msl_check_discarded_frag_stores;
 		msl_opts.sample_dref_lod_array_as_grad = args.msl_sample_dref_lod_array_as_grad;
+		msl_opts.relaxed_precision_as_16bit = args.msl_relaxed_precision_as_16bit;
 		msl_opts.ios_support_base_vertex_instance = true;
 		msl_opts.runtime_array_rich_descriptor = args.msl_runtime_array_rich_descriptor;
 		msl_comp->set_msl_options(msl_opts);
@@ -1249,15 +1549,21 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 			msl_comp->add_msl_shader_output(v);
 		if (args.msl_combined_sampler_suffix)
 			msl_comp->set_combined_sampler_suffix(args.msl_combined_sampler_suffix);
+		if (args.msl_spv_function_library)
+			msl_comp->set_spv_function_library_include(args.msl_spv_function_library);
 	}
 	else if (args.hlsl)
-		compiler.reset(new CompilerHLSL(std::move(spirv_parser.get_parsed_ir())));
+	{
+		hlsl_comp = new CompilerHLSL(std::move(parsed_ir));
+		compiler.reset(hlsl_comp);
+	}
 	else
 	{
 		combined_image_samplers = !args.vulkan_semantics;
 		if (!args.vulkan_semantics || args.vulkan_glsl_disable_ext_samplerless_texture_functions)
 			build_dummy_sampler = true;
-		compiler.reset(new CompilerGLSL(std::move(spirv_parser.get_parsed_ir())));
+		glsl_comp = new CompilerGLSL(std::move(parsed_ir));
+		compiler.reset(glsl_comp);
 	}
 
 	if (!args.variable_type_remaps.empty())
@@ -1300,8 +1606,7 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 
 			if (entry_point.empty())
 			{
-				fprintf(stderr, "Could not find an entry point with stage: %s\n", args.entry_stage.c_str());
-				exit(EXIT_FAILURE);
+				cli_error(join("Could not find an entry point with stage: ", args.entry_stage));
 			}
 		}
 		else
@@ -1319,9 +1624,7 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 
 			if (!exists)
 			{
-				fprintf(stderr, "Could not find an entry point %s with stage: %s\n", entry_point.c_str(),
-				        args.entry_stage.c_str());
-				exit(EXIT_FAILURE);
+				cli_error(join("Could not find an entry point ", entry_point, " with stage: ", args.entry_stage));
 			}
 		}
 	}
@@ -1341,64 +1644,49 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 
 		if (stage_count == 0)
 		{
-			fprintf(stderr, "There is no entry point with name: %s\n", entry_point.c_str());
-			exit(EXIT_FAILURE);
+			cli_error(join("There is no entry point with name: ", entry_point));
 		}
 		else if (stage_count > 1)
 		{
-			fprintf(stderr, "There is more than one entry point with name: %s. Use --stage.\n", entry_point.c_str());
-			exit(EXIT_FAILURE);
+			cli_error(join("There is more than one entry point with name: ", entry_point, ". Use --stage."));
 		}
 	}
 
 	if (!entry_point.empty())
 		compiler->set_entry_point(entry_point, model);
 
-	if (!args.set_version && !compiler->get_common_options().version)
+	if (glsl_comp)
+		set_common_options(*glsl_comp, args);
+	else if (hlsl_comp)
+		set_common_options(*hlsl_comp, args);
+	else if (msl_comp)
+		set_common_options(*msl_comp, args);
+
+	if (glsl_comp)
 	{
-		fprintf(stderr, "Didn't specify GLSL version and SPIR-V did not specify language.\n");
-		print_help();
-		exit(EXIT_FAILURE);
+		for (auto &fetch : args.glsl_ext_framebuffer_fetch)
+			glsl_comp->remap_ext_framebuffer_fetch(fetch.first, fetch.second, !args.glsl_ext_framebuffer_fetch_noncoherent);
+
+		auto glsl_opts = glsl_comp->get_common_options();
+		glsl_opts.minify = args.glsl_minify;
+		glsl_opts.descriptor_heap_indexing = args.glsl_descriptor_heap;
+		glsl_opts.descriptor_heap_set = args.glsl_descriptor_heap_set;
+		glsl_opts.lut_buffer_min_size = args.glsl_lut_buffer_min_size;
+		glsl_opts.lut_buffer_set = args.glsl_lut_buffer_set;
+		glsl_opts.lut_buffer_binding = args.glsl_lut_buffer_binding;
+		glsl_comp->set_common_options(glsl_opts);
 	}
 
-	CompilerGLSL::Options opts = compiler->get_common_options();
-	if (args.set_version)
-		opts.version = args.version;
-	if (args.set_es)
-		opts.es = args.es;
-	opts.force_temporary = args.force_temporary;
-	opts.separate_shader_objects = args.sso;
-	opts.flatten_multidimensional_arrays = args.flatten_multidimensional_arrays;
-	opts.enable_420pack_extension = args.use_420pack_extension;
-	opts.vulkan_semantics = args.vulkan_semantics;
-	opts.vertex.fixup_clipspace = args.fixup;
-	opts.vertex.flip_vert_y = args.yflip;
-	opts.vertex.support_nonzero_base_instance = args.support_nonzero_baseinstance;
-	opts.emit_push_constant_as_uniform_buffer = args.glsl_emit_push_constant_as_ubo;
-	opts.emit_uniform_buffer_as_plain_uniforms = args.glsl_emit_ubo_as_plain_uniforms;
-	opts.force_flattened_io_blocks = args.glsl_force_flattened_io_blocks;
-	opts.ovr_multiview_view_count = args.glsl_ovr_multiview_view_count;
-	opts.emit_line_directives = args.emit_line_directives;
-	opts.enable_storage_image_qualifier_deduction = args.enable_storage_image_qualifier_deduction;
-	opts.force_zero_initialized_variables = args.force_zero_initialized_variables;
-	opts.relax_nan_checks = args.relax_nan_checks;
-	opts.force_recompile_max_debug_iterations = args.force_recompile_max_debug_iterations;
-	compiler->set_common_options(opts);
-
-	for (auto &fetch : args.glsl_ext_framebuffer_fetch)
-		compiler->remap_ext_framebuffer_fetch(fetch.first, fetch.second, !args.glsl_ext_framebuffer_fetch_noncoherent);
-
 	// Set HLSL specific options.
-	if (args.hlsl)
+	if (hlsl_comp)
 	{
-		auto *hlsl = static_cast<CompilerHLSL *>(compiler.get());
+		auto *hlsl = hlsl_comp;
 		auto hlsl_opts = hlsl->get_hlsl_options();
 		if (args.set_shader_model)
 		{
 			if (args.shader_model < 30)
 			{
-				fprintf(stderr, "Shader model earlier than 30 (3.0) not supported.\n");
-				exit(EXIT_FAILURE);
+				cli_error("Shader model earlier than 30 (3.0) not supported.");
 			}
 
 			hlsl_opts.shader_model = args.shader_model;
@@ -1427,6 +1715,14 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 		hlsl_opts.enable_16bit_types = args.hlsl_enable_16bit_types;
 		hlsl_opts.flatten_matrix_vertex_input_semantics = args.hlsl_flatten_matrix_vertex_input_semantics;
 		hlsl_opts.preserve_structured_buffers = args.hlsl_preserve_structured_buffers;
+		hlsl_opts.relaxed_precision_as_16bit = args.hlsl_relaxed_precision_as_16bit;
+		hlsl_opts.root_constant_promotion_dword_budget = args.hlsl_root_constant_promotion_budget;
+		hlsl_opts.descriptor_heap_indexing = args.hlsl_descriptor_heap;
+		hlsl_opts.descriptor_heap_index_register = args.hlsl_descriptor_heap_index_register;
+		hlsl_opts.descriptor_heap_index_space = args.hlsl_descriptor_heap_index_space;
+		hlsl_opts.lut_buffer_min_size = args.hlsl_lut_buffer_min_size;
+		hlsl_opts.lut_buffer_register = args.hlsl_lut_buffer_register;
+		hlsl_opts.lut_buffer_space = args.hlsl_lut_buffer_space;
 		hlsl->set_hlsl_options(hlsl_opts);
 		hlsl->set_resource_binding_flags(args.hlsl_binding_flags);
 		if (args.hlsl_base_vertex_index_explicit_binding)
@@ -1448,6 +1744,9 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 		}
 	}
 
+	if (args.remove_unreachable)
+		compiler->remove_unreachable_ids();
+
 	ShaderResources res;
 	if (args.remove_unused)
 	{
@@ -1461,17 +1760,30 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 	if (args.flatten_ubo)
 	{
 		for (auto &ubo : res.uniform_buffers)
-			compiler->flatten_buffer_block(ubo.id);
+		{
+			if (glsl_comp)
+				glsl_comp->flatten_buffer_block(ubo.id);
+			else if (hlsl_comp)
+				hlsl_comp->flatten_buffer_block(ubo.id);
+		}
 		for (auto &ubo : res.push_constant_buffers)
-			compiler->flatten_buffer_block(ubo.id);
+		{
+			if (glsl_comp)
+				glsl_comp->flatten_buffer_block(ubo.id);
+			else if (hlsl_comp)
+				hlsl_comp->flatten_buffer_block(ubo.id);
+		}
 	}
 
-	auto pls_inputs = remap_pls(args.pls_in, res.stage_inputs, &res.subpass_inputs);
-	auto pls_outputs = remap_pls(args.pls_out, res.stage_outputs, nullptr);
-	compiler->remap_pixel_local_storage(std::move(pls_inputs), std::move(pls_outputs));
+	if (glsl_comp)
+	{
+		auto pls_inputs = remap_pls(args.pls_in, res.stage_inputs, &res.subpass_inputs);
+		auto pls_outputs = remap_pls(args.pls_out, res.stage_outputs, nullptr);
+		glsl_comp->remap_pixel_local_storage(std::move(pls_inputs), std::move(pls_outputs));
 
-	for (auto &ext : args.extensions)
-		compiler->require_extension(ext);
+		for (auto &ext : args.extensions)
+			glsl_comp->require_extension(ext);
+	}
 
 	for (auto &remap : args.remaps)
 	{
@@ -1483,6 +1795,9 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 			continue;
 	}
 
+	for (auto &spec : args.specialization_constant_values)
+		compiler->set_specialization_constant_value(spec.first, spec.second);
+
 	for (auto &rename : args.interface_variable_renames)
 	{
 		if (rename.storageClass == StorageClassInput)
@@ -1493,8 +1808,7 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 			                                            rename.variable_name);
 		else
 		{
-			fprintf(stderr, "error at --rename-interface-variable <in|out> ...\n");
-			exit(EXIT_FAILURE);
+			cli_error("error at --rename-interface-variable <in|out> ...");
 		}
 	}
 
@@ -1512,16 +1826,13 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 		}
 	}
 
-	if (args.hlsl)
-	{
-		auto *hlsl_compiler = static_cast<CompilerHLSL *>(compiler.get());
-		hlsl_compiler->remap_num_workgroups_builtin();
-	}
+	if (hlsl_comp)
+		hlsl_comp->remap_num_workgroups_builtin();
 
-	if (args.hlsl)
+	if (hlsl_comp)
 	{
 		for (auto &remap : args.hlsl_attr_remap)
-			static_cast<CompilerHLSL *>(compiler.get())->add_vertex_attribute_remap(remap);
+			hlsl_comp->add_vertex_attribute_remap(remap);
 
 		for (auto &named_remap : args.hlsl_attr_remap_named)
 		{
@@ -1535,13 +1846,36 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 					compiler->get_decoration(itr->id, DecorationLocation),
 					named_remap.semantic,
 				};
-				static_cast<CompilerHLSL *>(compiler.get())->add_vertex_attribute_remap(remap);
+				hlsl_comp->add_vertex_attribute_remap(remap);
 			}
 		}
 	}
 
+	if (profile)
+		compiler->set_profile_callback([profile](const CompilerPassProfile &pass) { profile->push_back(pass); });
+	if (args.threads > 1)
+		compiler->set_task_runner(make_task_runner(args.threads));
+
+	CompileBudget budget;
+	budget.max_seconds = args.compile_budget_seconds;
+	budget.max_work = args.compile_budget_work;
+	compiler->set_compile_budget(budget);
+
+	if (args.dump_memory_statistics)
+		print_memory_statistics("before compile", compiler->get_memory_statistics());
+
 	auto ret = compiler->compile();
 
+	if (args.dump_memory_statistics)
+		print_memory_statistics("after compile", compiler->get_memory_statistics());
+
+	if (msl_comp && args.msl_spv_function_library_output)
+	{
+		auto library = msl_comp->emit_spv_function_library(msl_comp->get_spv_function_implementations());
+		if (!write_output_to_file(args.msl_spv_function_library_output, library, false))
+			THROW("Failed to write helper function library.");
+	}
+
 	if (args.dump_resources)
 	{
 		compiler->update_active_builtins();
@@ -1549,16 +1883,20 @@ static string compile_iteration(const CLIArguments &args, std::vector<uint32_t>
 		print_push_constant_resources(*compiler, res.push_constant_buffers);
 		print_spec_constants(*compiler);
 		print_capabilities_and_extensions(*compiler);
+		if (hlsl_comp && !hlsl_comp->get_promoted_root_constants().empty())
+			fprintf(stderr, "Root constants: %s\n\n", hlsl_comp->get_promoted_root_constants_root_signature().c_str());
+		print_descriptor_heap_slots(*compiler, hlsl_comp != nullptr);
+		print_lowered_luts(*compiler, hlsl_comp != nullptr);
 	}
 
+	if (args.dump_resource_costs)
+		print_resource_costs(compiler->get_resource_cost_report());
+
 	return ret;
 }
 
-static int main_inner(int argc, char *argv[])
+static void add_cli_callbacks(CLICallbacks &cbs, CLIArguments &args)
 {
-	CLIArguments args;
-	CLICallbacks cbs;
-
 	cbs.add("--help", [](CLIParser &parser) {
 		print_help();
 		parser.end();
@@ -1581,6 +1919,8 @@ static int main_inner(int argc, char *argv[])
 		args.set_version = true;
 	});
 	cbs.add("--dump-resources", [&args](CLIParser &) { args.dump_resources = true; });
+	cbs.add("--dump-resource-costs", [&args](CLIParser &) { args.dump_resource_costs = true; });
+	cbs.add("--dump-memory-statistics", [&args](CLIParser &) { args.dump_memory_statistics = true; });
 	cbs.add("--force-temporary", [&args](CLIParser &) { args.force_temporary = true; });
 	cbs.add("--flatten-ubo", [&args](CLIParser &) { args.flatten_ubo = true; });
 	cbs.add("--fixup-clipspace", [&args](CLIParser &) { args.fixup = true; });
@@ -1594,6 +1934,16 @@ static int main_inner(int argc, char *argv[])
 	cbs.add("--glsl-emit-ubo-as-plain-uniforms", [&args](CLIParser &) { args.glsl_emit_ubo_as_plain_uniforms = true; });
 	cbs.add("--glsl-force-flattened-io-blocks", [&args](CLIParser &) { args.glsl_force_flattened_io_blocks = true; });
 	cbs.add("--glsl-ovr-multiview-view-count", [&args](CLIParser &parser) { args.glsl_ovr_multiview_view_count = parser.next_uint(); });
+	cbs.add("--glsl-minify", [&args](CLIParser &) { args.glsl_minify = true; });
+	cbs.add("--glsl-descriptor-heap", [&args](CLIParser &parser) {
+		args.glsl_descriptor_heap = true;
+		args.glsl_descriptor_heap_set = parser.next_uint();
+	});
+	cbs.add("--glsl-lut-buffer", [&args](CLIParser &parser) {
+		args.glsl_lut_buffer_min_size = parser.next_uint();
+		args.glsl_lut_buffer_set = parser.next_uint();
+		args.glsl_lut_buffer_binding = parser.next_uint();
+	});
 	cbs.add("--glsl-remap-ext-framebuffer-fetch", [&args](CLIParser &parser) {
 		uint32_t input_index = parser.next_uint();
 		uint32_t color_attachment = parser.next_uint();
@@ -1629,6 +1979,19 @@ static int main_inner(int argc, char *argv[])
 	cbs.add("--hlsl-flatten-matrix-vertex-input-semantics",
 	        [&args](CLIParser &) { args.hlsl_flatten_matrix_vertex_input_semantics = true; });
 	cbs.add("--hlsl-preserve-structured-buffers", [&args](CLIParser &) { args.hlsl_preserve_structured_buffers = true; });
+	cbs.add("--hlsl-relaxed-precision-as-16bit", [&args](CLIParser &) { args.hlsl_relaxed_precision_as_16bit = true; });
+	cbs.add("--hlsl-root-constant-promotion-budget",
+	        [&args](CLIParser &parser) { args.hlsl_root_constant_promotion_budget = parser.next_uint(); });
+	cbs.add("--hlsl-descriptor-heap", [&args](CLIParser &parser) {
+		args.hlsl_descriptor_heap = true;
+		args.hlsl_descriptor_heap_index_register = parser.next_uint();
+		args.hlsl_descriptor_heap_index_space = parser.next_uint();
+	});
+	cbs.add("--hlsl-lut-buffer", [&args](CLIParser &parser) {
+		args.hlsl_lut_buffer_min_size = parser.next_uint();
+		args.hlsl_lut_buffer_register = parser.next_uint();
+		args.hlsl_lut_buffer_space = parser.next_uint();
+	});
 	cbs.add("--vulkan-semantics", [&args](CLIParser &) { args.vulkan_semantics = true; });
 	cbs.add("-V", [&args](CLIParser &) { args.vulkan_semantics = true; });
 	cbs.add("--flatten-multidimensional-arrays", [&args](CLIParser &) { args.flatten_multidimensional_arrays = true; });
@@ -1665,6 +2028,8 @@ static int main_inner(int argc, char *argv[])
 	cbs.add("--msl-decoration-binding", [&args](CLIParser &) { args.msl_decoration_binding = true; });
 	cbs.add("--msl-force-active-argument-buffer-resources",
 	        [&args](CLIParser &) { args.msl_force_active_argument_buffer_resources = true; });
+	cbs.add("--msl-argument-buffers-stable-layout",
+	        [&args](CLIParser &) { args.msl_argument_buffers_stable_layout = true; });
 	cbs.add("--msl-inline-uniform-block", [&args](CLIParser &parser) {
 		args.msl_argument_buffers = true;
 		// Make sure next_uint() is called in-order.
@@ -1769,6 +2134,9 @@ static int main_inner(int argc, char *argv[])
 	cbs.add("--msl-raw-buffer-tese-input", [&args](CLIParser &) { args.msl_raw_buffer_tese_input = true; });
 	cbs.add("--msl-multi-patch-workgroup", [&args](CLIParser &) { args.msl_multi_patch_workgroup = true; });
 	cbs.add("--msl-vertex-for-tessellation", [&args](CLIParser &) { args.msl_vertex_for_tessellation = true; });
+	cbs.add("--msl-pack-tessellation-buffers", [&args](CLIParser &) { args.msl_pack_tessellation_buffers = true; });
+	cbs.add("--msl-pack-tessellation-buffers-half",
+	        [&args](CLIParser &) { args.msl_pack_tessellation_buffers_half = true; });
 	cbs.add("--msl-additional-fixed-sample-mask",
 	        [&args](CLIParser &parser) { args.msl_additional_fixed_sample_mask = parser.next_hex_uint(); });
 	cbs.add("--msl-arrayed-subpass-input", [&args](CLIParser &) { args.msl_arrayed_subpass_input = true; });
@@ -1787,9 +2155,14 @@ static int main_inner(int argc, char *argv[])
 	cbs.add("--msl-check-discarded-frag-stores", [&args](CLIParser &) { args.msl_check_discarded_frag_stores = true; });
 	cbs.add("--msl-sample-dref-lod-array-as-grad",
 	        [&args](CLIParser &) { args.msl_sample_dref_lod_array_as_grad = true; });
+	cbs.add("--msl-relaxed-precision-as-16bit", [&args](CLIParser &) { args.msl_relaxed_precision_as_16bit = true; });
 	cbs.add("--msl-combined-sampler-suffix", [&args](CLIParser &parser) {
 		args.msl_combined_sampler_suffix = parser.next_string();
 	});
+	cbs.add("--msl-spv-function-library",
+	        [&args](CLIParser &parser) { args.msl_spv_function_library = parser.next_string(); });
+	cbs.add("--msl-spv-function-library-output",
+	        [&args](CLIParser &parser) { args.msl_spv_function_library_output = parser.next_string(); });
 	cbs.add("--msl-runtime-array-rich-descriptor",
 	        [&args](CLIParser &) { args.msl_runtime_array_rich_descriptor = true; });
 	cbs.add("--extension", [&args](CLIParser &parser) { args.extensions.push_back(parser.next_string()); });
@@ -1828,6 +2201,12 @@ static int main_inner(int argc, char *argv[])
 		args.variable_type_remaps.push_back({ std::move(var_name), std::move(new_type) });
 	});
 
+	cbs.add("--specialize-constant", [&args](CLIParser &parser) {
+		uint32_t spec_id = parser.next_uint();
+		uint32_t value = parser.next_uint();
+		args.specialization_constant_values.push_back({ spec_id, value });
+	});
+
 	cbs.add("--rename-interface-variable", [&args](CLIParser &parser) {
 		StorageClass cls = StorageClassMax;
 		string clsStr = parser.next_string();
@@ -1861,6 +2240,7 @@ static int main_inner(int argc, char *argv[])
 	});
 
 	cbs.add("--remove-unused-variables", [&args](CLIParser &) { args.remove_unused = true; });
+	cbs.add("--remove-unreachable", [&args](CLIParser &) { args.remove_unreachable = true; });
 	cbs.add("--combined-samplers-inherit-bindings",
 	        [&args](CLIParser &) { args.combined_samplers_inherit_bindings = true; });
 
@@ -1885,10 +2265,7 @@ static int main_inner(int argc, char *argv[])
 		else if (builtin == "ClipDistance")
 			masked_builtin = BuiltInClipDistance;
 		else
-		{
-			print_help();
-			exit(EXIT_FAILURE);
-		}
+			THROW("Invalid builtin for --mask-stage-output-builtin.");
 		args.masked_stage_builtins.push_back(masked_builtin);
 	});
 
@@ -1897,10 +2274,281 @@ static int main_inner(int argc, char *argv[])
 	});
 
 	cbs.add("--relax-nan-checks", [&](CLIParser &) { args.relax_nan_checks = true; });
+	cbs.add("--eliminate-common-subexpressions", [&](CLIParser &parser) {
+		args.common_subexpression_min_cost = parser.next_uint();
+	});
+
+	cbs.add("--batch", [&args](CLIParser &parser) { args.batch = parser.next_string(); });
+	cbs.add("--batch-threads", [&args](CLIParser &parser) { args.batch_threads = parser.next_uint(); });
+	cbs.add("--threads", [&args](CLIParser &parser) { args.threads = parser.next_uint(); });
+	cbs.add("--profile", [&args](CLIParser &parser) { args.profile = parser.next_string(); });
+	cbs.add("--serialize-ir", [&args](CLIParser &parser) { args.serialize_ir = parser.next_string(); });
+	cbs.add("--compile-budget", [&args](CLIParser &parser) {
+		args.compile_budget_seconds = parser.next_double();
+		args.compile_budget_work = parser.next_uint();
+	});
 
 	cbs.default_handler = [&args](const char *value) { args.input = value; };
 	cbs.add("-", [&args](CLIParser &) { args.input = "-"; });
 	cbs.error_handler = [] { print_help(); };
+}
+
+static bool write_profile(const char *path, const vector<CompilerPassProfile> &profile)
+{
+	string json = "{\n\t\"passes\": [";
+	for (size_t i = 0; i < profile.size(); i++)
+	{
+		auto &pass = profile[i];
+		char line[512];
+		snprintf(line, sizeof(line),
+		         "%s\n\t\t{ \"name\": \"%s\", \"seconds\": %.9f, \"allocations\": %llu, \"passes\": %u, "
+		         "\"force_recompiles\": %u }",
+		         i ? "," : "", pass.name, pass.seconds, static_cast<unsigned long long>(pass.allocations),
+		         pass.passes, pass.force_recompiles);
+		json += line;
+	}
+	json += "\n\t]\n}\n";
+	return write_string_to_file(path, json.c_str());
+}
+
+static string compile_spirv(const CLIArguments &args, vector<uint32_t> spirv_file)
+{
+	// Special case reflection because it has little to do with the path followed by code-outputting compilers
+	if (!args.reflect.empty())
+	{
+		CompilerReflection compiler(parse_input(args, std::move(spirv_file)));
+		compiler.set_format(args.reflect);
+		compiler.set_emit_resource_costs(args.dump_resource_costs);
+		return compiler.compile();
+	}
+
+	string compiled_output;
+	vector<CompilerPassProfile> profile;
+	auto *profile_target = args.profile ? &profile : nullptr;
+
+	if (args.iterations == 1)
+		compiled_output = compile_iteration(args, std::move(spirv_file), profile_target);
+	else
+	{
+		for (unsigned i = 0; i < args.iterations; i++)
+		{
+			profile.clear();
+			compiled_output = compile_iteration(args, spirv_file, profile_target);
+		}
+	}
+
+	if (args.profile && !write_profile(args.profile, profile))
+		THROW("Failed to write profile.");
+
+	return compiled_output;
+}
+
+// Runs jobs [0, job_count) on thread_count threads.
+// Jobs are dealt out round-robin up front, and a thread which runs out of its own jobs steals from the others.
+static void run_work_stealing(size_t job_count, unsigned thread_count, const function<void(size_t)> &job)
+{
+	struct Queue
+	{
+		mutex lock;
+		deque<size_t> jobs;
+	};
+
+	vector<unique_ptr<Queue>> queues;
+	for (unsigned i = 0; i < thread_count; i++)
+		queues.emplace_back(new Queue);
+	for (size_t i = 0; i < job_count; i++)
+		queues[i % thread_count]->jobs.push_back(i);
+
+	auto worker = [&](unsigned index) {
+		for (;;)
+		{
+			size_t next = job_count;
+
+			// Work from the back of our own queue, steal from the front of others.
+			for (unsigned i = 0; i < thread_count && next == job_count; i++)
+			{
+				auto &queue = *queues[(index + i) % thread_count];
+				lock_guard<mutex> holder{ queue.lock };
+				if (!queue.jobs.empty())
+				{
+					if (i == 0)
+					{
+						next = queue.jobs.back();
+						queue.jobs.pop_back();
+					}
+					else
+					{
+						next = queue.jobs.front();
+						queue.jobs.pop_front();
+					}
+				}
+			}
+
+			// Jobs are never added after startup, so empty queues everywhere means we're done.
+			if (next == job_count)
+				break;
+
+			job(next);
+		}
+	};
+
+	vector<thread> threads;
+	for (unsigned i = 1; i < thread_count; i++)
+		threads.emplace_back(worker, i);
+	worker(0);
+	for (auto &t : threads)
+		t.join();
+}
+
+static bool read_batch_manifest(const char *path, vector<vector<string>> &entries)
+{
+	FILE *file = path[0] == '-' && path[1] == '\0' ? stdin : fopen(path, "r");
+	if (!file)
+	{
+		fprintf(stderr, "Failed to open batch manifest: %s\n", path);
+		return false;
+	}
+
+	// One entry per line. Arguments are separated by whitespace and can be quoted with "".
+	// Empty lines and lines starting with # are ignored.
+	string line;
+	int c;
+	do
+	{
+		c = fgetc(file);
+		if (c != '\n' && c != EOF)
+		{
+			line += char(c);
+			continue;
+		}
+
+		vector<string> tokens;
+		size_t i = 0;
+		while (i < line.size())
+		{
+			if (isspace(static_cast<unsigned char>(line[i])))
+			{
+				i++;
+				continue;
+			}
+
+			tokens.emplace_back();
+			auto &token = tokens.back();
+			bool quoted = false;
+			for (; i < line.size() && (quoted || !isspace(static_cast<unsigned char>(line[i]))); i++)
+			{
+				if (line[i] == '"')
+					quoted = !quoted;
+				else
+					token += line[i];
+			}
+		}
+
+		if (!tokens.empty() && tokens.front()[0] != '#')
+			entries.push_back(std::move(tokens));
+		line.clear();
+	} while (c != EOF);
+
+	if (file != stdin)
+		fclose(file);
+	return true;
+}
+
+static int main_batch(const CLIArguments &base_args)
+{
+	if (base_args.input || base_args.output || base_args.profile || base_args.serialize_ir)
+	{
+		fprintf(stderr, "Input, output, profile and serialized IR must be given per entry in the --batch manifest.\n");
+		return EXIT_FAILURE;
+	}
+
+	vector<vector<string>> manifest;
+	if (!read_batch_manifest(base_args.batch, manifest))
+		return EXIT_FAILURE;
+
+	struct BatchEntry
+	{
+		vector<string> tokens;
+		CLIArguments args;
+		string error;
+	};
+
+	// Entries must not move once parsed, the arguments point into their tokens.
+	vector<unique_ptr<BatchEntry>> entries;
+	for (auto &tokens : manifest)
+	{
+		entries.emplace_back(new BatchEntry);
+		auto &entry = *entries.back();
+		entry.tokens = std::move(tokens);
+		entry.args = base_args;
+		entry.args.batch = nullptr;
+
+		vector<char *> entry_argv;
+		for (auto &token : entry.tokens)
+			entry_argv.push_back(&token[0]);
+
+		CLICallbacks cbs;
+		add_cli_callbacks(cbs, entry.args);
+		cbs.error_handler = [] {};
+		CLIParser parser{ std::move(cbs), int(entry_argv.size()), entry_argv.data() };
+		if (!parser.parse() || parser.ended_state)
+			entry.error = "Invalid arguments.";
+		else if (!entry.args.input)
+			entry.error = "Didn't specify input file.";
+		else if (!entry.args.output)
+			entry.error = "Didn't specify output file.";
+	}
+
+	unsigned thread_count = base_args.batch_threads;
+	if (!thread_count)
+		thread_count = std::max(thread::hardware_concurrency(), 1u);
+	thread_count = unsigned(std::min<size_t>(thread_count, std::max<size_t>(entries.size(), 1)));
+
+	run_work_stealing(entries.size(), thread_count, [&](size_t index) {
+		auto &entry = *entries[index];
+		if (!entry.error.empty())
+			return;
+
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+		try
+#endif
+		{
+			auto spirv_file = read_spirv_file(entry.args.input);
+			if (spirv_file.empty())
+				entry.error = "Failed to read SPIR-V file.";
+			else if (!write_output_to_file(entry.args.output, compile_spirv(entry.args, std::move(spirv_file)),
+			                               entry.args.reflect == "cbor"))
+				entry.error = "Failed to write output file.";
+		}
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+		catch (const std::exception &e)
+		{
+			entry.error = e.what();
+		}
+#endif
+	});
+
+	size_t failed = 0;
+	for (auto &entry : entries)
+	{
+		if (!entry->error.empty())
+		{
+			fprintf(stderr, "%s: %s\n", entry->args.input ? entry->args.input : entry->tokens.front().c_str(),
+			        entry->error.c_str());
+			failed++;
+		}
+	}
+
+	if (failed)
+		fprintf(stderr, "%u of %u batch entries failed.\n", unsigned(failed), unsigned(entries.size()));
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int main_inner(int argc, char *argv[])
+{
+	CLIArguments args;
+	CLICallbacks cbs;
+	add_cli_callbacks(cbs, args);
 
 	CLIParser parser{ std::move(cbs), argc - 1, argv + 1 };
 	if (!parser.parse())
@@ -1908,6 +2556,9 @@ static int main_inner(int argc, char *argv[])
 	else if (parser.ended_state)
 		return EXIT_SUCCESS;
 
+	if (args.batch)
+		return main_batch(args);
+
 	if (!args.input)
 	{
 		fprintf(stderr, "Didn't specify input file.\n");
@@ -1919,36 +2570,27 @@ static int main_inner(int argc, char *argv[])
 	if (spirv_file.empty())
 		return EXIT_FAILURE;
 
-	// Special case reflection because it has little to do with the path followed by code-outputting compilers
-	if (!args.reflect.empty())
+	string compiled_output;
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+	try
+#endif
 	{
-		Parser spirv_parser(std::move(spirv_file));
-		spirv_parser.parse();
-
-		CompilerReflection compiler(std::move(spirv_parser.get_parsed_ir()));
-		compiler.set_format(args.reflect);
-		auto json = compiler.compile();
-		if (args.output)
-			write_string_to_file(args.output, json.c_str());
-		else
-			printf("%s", json.c_str());
-		return EXIT_SUCCESS;
+		compiled_output = compile_spirv(args, std::move(spirv_file));
 	}
-
-	string compiled_output;
-
-	if (args.iterations == 1)
-		compiled_output = compile_iteration(args, std::move(spirv_file));
-	else
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+	catch (const CLIError &e)
 	{
-		for (unsigned i = 0; i < args.iterations; i++)
-			compiled_output = compile_iteration(args, spirv_file);
+		fprintf(stderr, "%s\n", e.what());
+		if (e.show_help)
+			print_help();
+		return EXIT_FAILURE;
 	}
+#endif
 
 	if (args.output)
-		write_string_to_file(args.output, compiled_output.c_str());
+		write_output_to_file(args.output, compiled_output, args.reflect == "cbor");
 	else
-		printf("%s", compiled_output.c_str());
+		fwrite(compiled_output.data(), 1, compiled_output.size(), stdout);
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,29 @@
+StructuredBuffer<float> _20 : register(t0);
+static const float _22[2] = { 1.0f, 2.0f };
+
+static float FragColor;
+static int vIndex;
+
+struct SPIRV_Cross_Input
+{
+    nointerpolation int vIndex : TEXCOORD0;
+};
+
+struct SPIRV_Cross_Output
+{
+    float FragColor : SV_Target0;
+};
+
+void frag_main()
+{
+    FragColor = (_20[vIndex] + _20[vIndex]) + _22[vIndex & 1];
+}
+
+SPIRV_Cross_Output main(SPIRV_Cross_Input stage_input)
+{
+    vIndex = stage_input.vIndex;
+    frag_main();
+    SPIRV_Cross_Output stage_output;
+    stage_output.FragColor = FragColor;
+    return stage_output;
+}
@@ -0,0 +1,45 @@
+struct UBO_1
+{
+    float4 scale;
+};
+
+cbuffer SPIRV_Cross_DescriptorHeapIndices_Block : register(b0, space1)
+{
+    uint SPIRV_Cross_DescriptorHeapIndices_ubo : packoffset(c0);
+    uint SPIRV_Cross_DescriptorHeapIndices_uTexture : packoffset(c0.y);
+    uint SPIRV_Cross_DescriptorHeapIndices_uSampler : packoffset(c0.z);
+    uint SPIRV_Cross_DescriptorHeapIndices_uCombined : packoffset(c0.w);
+    uint SPIRV_Cross_DescriptorHeapIndices_uCombined_sampler : packoffset(c1);
+};
+
+static float4 FragColor;
+static float2 vUV;
+
+struct SPIRV_Cross_Input
+{
+    float2 vUV : TEXCOORD0;
+};
+
+struct SPIRV_Cross_Output
+{
+    float4 FragColor : SV_Target0;
+};
+
+void frag_main()
+{
+    ConstantBuffer<UBO_1> ubo = ResourceDescriptorHeap[SPIRV_Cross_DescriptorHeapIndices_ubo];
+    Texture2D<float4> uTexture = ResourceDescriptorHeap[SPIRV_Cross_DescriptorHeapIndices_uTexture];
+    SamplerState uSampler = SamplerDescriptorHeap[SPIRV_Cross_DescriptorHeapIndices_uSampler];
+    Texture2D<float4> uCombined = ResourceDescriptorHeap[SPIRV_Cross_DescriptorHeapIndices_uCombined];
+    SamplerState _uCombined_sampler = SamplerDescriptorHeap[SPIRV_Cross_DescriptorHeapIndices_uCombined_sampler];
+    FragColor = (uTexture.Sample(uSampler, vUV) * ubo.scale) + uCombined.Sample(_uCombined_sampler, vUV);
+}
+
+SPIRV_Cross_Output main(SPIRV_Cross_Input stage_input)
+{
+    vUV = stage_input.vUV;
+    frag_main();
+    SPIRV_Cross_Output stage_output;
+    stage_output.FragColor = FragColor;
+    return stage_output;
+}
@@ -0,0 +1,35 @@
+static float4 FragColor;
+static float4 vColor;
+static float vScale;
+
+struct SPIRV_Cross_Input
+{
+    float4 vColor : TEXCOORD0;
+    float vScale : TEXCOORD1;
+};
+
+struct SPIRV_Cross_Output
+{
+    float4 FragColor : SV_Target0;
+};
+
+float4 shade(float4 color, float scale)
+{
+    min16float4 _33 = min16float4(color);
+    return float4(clamp((_33 * min16float(scale)) + _33, min16float(0.0).xxxx, min16float(1.0).xxxx));
+}
+
+void frag_main()
+{
+    FragColor = shade(vColor, vScale);
+}
+
+SPIRV_Cross_Output main(SPIRV_Cross_Input stage_input)
+{
+    vColor = stage_input.vColor;
+    vScale = stage_input.vScale;
+    frag_main();
+    SPIRV_Cross_Output stage_output;
+    stage_output.FragColor = FragColor;
+    return stage_output;
+}
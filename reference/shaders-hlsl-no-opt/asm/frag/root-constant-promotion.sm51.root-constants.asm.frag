@@ -0,0 +1,38 @@
+cbuffer Small : register(b0, space0)
+{
+    float4 small_a : packoffset(c0);
+    float4 small_b : packoffset(c1);
+};
+
+cbuffer Large : register(b1, space0)
+{
+    float4 large_m[16] : packoffset(c0);
+};
+
+
+static float4 FragColor;
+static int vIndex;
+
+struct SPIRV_Cross_Input
+{
+    nointerpolation int vIndex : TEXCOORD0;
+};
+
+struct SPIRV_Cross_Output
+{
+    float4 FragColor : SV_Target0;
+};
+
+void frag_main()
+{
+    FragColor = (small_a * large_m[vIndex]) + small_b;
+}
+
+SPIRV_Cross_Output main(SPIRV_Cross_Input stage_input)
+{
+    vIndex = stage_input.vIndex;
+    frag_main();
+    SPIRV_Cross_Output stage_output;
+    stage_output.FragColor = FragColor;
+    return stage_output;
+}
@@ -1,10 +1,9 @@
 static const float _23[1] = { 0.0f };
-static const float _24[1] = { 0.0f };
 
 static float4 gl_Position = 0.0f.xxxx;
 static float gl_PointSize = 0.0f;
 static float gl_ClipDistance[1] = _23;
-static float gl_CullDistance[1] = _24;
+static float gl_CullDistance[1] = _23;
 struct SPIRV_Cross_Output
 {
     float4 gl_Position : SV_Position;
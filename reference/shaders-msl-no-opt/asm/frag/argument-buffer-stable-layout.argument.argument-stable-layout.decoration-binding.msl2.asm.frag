@@ -0,0 +1,38 @@
+#include <metal_stdlib>
+#include <simd/simd.h>
+
+using namespace metal;
+
+struct UBO
+{
+    float4 scale;
+};
+
+struct spvDescriptorSetBuffer0
+{
+    constant uint* _m0_pad [[id(0)]][3];
+    texture2d<float> uTexture [[id(3)]];
+    sampler uSampler [[id(4)]];
+    constant uint* _m5_pad [[id(5)]];
+    array<texture2d<float>, 2> uTextures [[id(6)]];
+    constant uint* _m8_pad [[id(8)]];
+    constant UBO* ubo [[id(9)]];
+};
+
+struct main0_out
+{
+    float4 FragColor [[color(0)]];
+};
+
+struct main0_in
+{
+    float2 vUV [[user(locn0)]];
+};
+
+fragment main0_out main0(main0_in in [[stage_in]], constant spvDescriptorSetBuffer0& spvDescriptorSet0 [[buffer(0)]])
+{
+    main0_out out = {};
+    out.FragColor = (spvDescriptorSet0.uTexture.sample(spvDescriptorSet0.uSampler, in.vUV) * (*spvDescriptorSet0.ubo).scale) + spvDescriptorSet0.uTextures[1].sample(spvDescriptorSet0.uSampler, in.vUV);
+    return out;
+}
+
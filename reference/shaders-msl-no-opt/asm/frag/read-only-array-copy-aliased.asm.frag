@@ -0,0 +1,79 @@
+#pragma clang diagnostic ignored "-Wmissing-prototypes"
+#pragma clang diagnostic ignored "-Wmissing-braces"
+
+#include <metal_stdlib>
+#include <simd/simd.h>
+
+using namespace metal;
+
+template<typename T, size_t Num>
+struct spvUnsafeArray
+{
+    T elements[Num ? Num : 1];
+    
+    thread T& operator [] (size_t pos) thread
+    {
+        return elements[pos];
+    }
+    constexpr const thread T& operator [] (size_t pos) const thread
+    {
+        return elements[pos];
+    }
+    
+    device T& operator [] (size_t pos) device
+    {
+        return elements[pos];
+    }
+    constexpr const device T& operator [] (size_t pos) const device
+    {
+        return elements[pos];
+    }
+    
+    constexpr const constant T& operator [] (size_t pos) const constant
+    {
+        return elements[pos];
+    }
+    
+    threadgroup T& operator [] (size_t pos) threadgroup
+    {
+        return elements[pos];
+    }
+    constexpr const threadgroup T& operator [] (size_t pos) const threadgroup
+    {
+        return elements[pos];
+    }
+};
+
+constant spvUnsafeArray<float4, 2> _35 = spvUnsafeArray<float4, 2>({ float4(1.0), float4(1.0) });
+constant spvUnsafeArray<float4, 2> _36 = spvUnsafeArray<float4, 2>({ float4(2.0), float4(2.0) });
+
+struct main0_out
+{
+    float4 FragColor [[color(0)]];
+};
+
+static inline __attribute__((always_inline))
+float4 f(spvUnsafeArray<float4, 2> k, spvUnsafeArray<float4, 2> a, thread spvUnsafeArray<float4, 2>& g)
+{
+    g[0] = float4(5.0);
+    return a[0] + k[0];
+}
+
+static inline __attribute__((always_inline))
+float4 h(thread const spvUnsafeArray<float4, 2>& p, thread spvUnsafeArray<float4, 2>& g)
+{
+    spvUnsafeArray<float4, 2> tmp = p;
+    g[0] = float4(2.0);
+    return tmp[0];
+}
+
+fragment main0_out main0()
+{
+    main0_out out = {};
+    spvUnsafeArray<float4, 2> g = spvUnsafeArray<float4, 2>({ float4(1.0), float4(1.0) });
+    float4 _38 = f(_36, g, g);
+    float4 _39 = h(g, g);
+    out.FragColor = _38 + _39;
+    return out;
+}
+
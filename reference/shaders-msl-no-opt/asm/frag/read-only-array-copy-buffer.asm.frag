@@ -0,0 +1,32 @@
+#include <metal_stdlib>
+#include <simd/simd.h>
+
+using namespace metal;
+
+struct UBO
+{
+    float4 colors[4];
+};
+
+struct SSBO
+{
+    float4 weights[4];
+};
+
+struct main0_out
+{
+    float4 FragColor [[color(0)]];
+};
+
+struct main0_in
+{
+    int vIndex [[user(locn0)]];
+};
+
+fragment main0_out main0(main0_in in [[stage_in]], constant UBO& ubo [[buffer(0)]], const device SSBO& ssbo [[buffer(1)]])
+{
+    main0_out out = {};
+    out.FragColor = ubo.colors[in.vIndex] * ssbo.weights[in.vIndex];
+    return out;
+}
+
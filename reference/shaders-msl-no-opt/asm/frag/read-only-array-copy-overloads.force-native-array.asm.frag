@@ -0,0 +1,60 @@
+#pragma clang diagnostic ignored "-Wmissing-prototypes"
+
+#include <metal_stdlib>
+#include <simd/simd.h>
+
+using namespace metal;
+
+struct UBO
+{
+    float4 colors[4];
+};
+
+struct SSBO
+{
+    float4 weights[4];
+};
+
+constant float4 _67[4] = { float4(0.0, 0.0, 0.0, 1.0), float4(1.0, 0.0, 0.0, 1.0), float4(0.0, 1.0, 0.0, 1.0), float4(0.0, 0.0, 1.0, 1.0) };
+
+struct main0_out
+{
+    float4 FragColor [[color(0)]];
+};
+
+struct main0_in
+{
+    int vIndex [[user(locn0)]];
+    float4 vColor [[user(locn1)]];
+};
+
+static inline __attribute__((always_inline))
+float4 lookup(constant float4 (&tbl)[4], int idx)
+{
+    return tbl[idx];
+}
+
+static inline __attribute__((always_inline))
+float4 lookup(const device float4 (&tbl)[4], int idx)
+{
+    return tbl[idx];
+}
+
+static inline __attribute__((always_inline))
+float4 lookup(thread const float4 (&tbl)[4], int idx)
+{
+    return tbl[idx];
+}
+
+fragment main0_out main0(main0_in in [[stage_in]], constant UBO& ubo [[buffer(0)]], const device SSBO& ssbo [[buffer(1)]])
+{
+    main0_out out = {};
+    float4 local[4];
+    local[0] = in.vColor;
+    local[1] = lookup(_67, in.vIndex);
+    local[2] = lookup(ubo.colors, in.vIndex);
+    local[3] = lookup(ssbo.weights, in.vIndex);
+    out.FragColor = lookup(local, in.vIndex);
+    return out;
+}
+
@@ -0,0 +1,32 @@
+#pragma clang diagnostic ignored "-Wmissing-prototypes"
+
+#include <metal_stdlib>
+#include <simd/simd.h>
+
+using namespace metal;
+
+struct main0_out
+{
+    float4 FragColor [[color(0)]];
+};
+
+struct main0_in
+{
+    float4 vColor [[user(locn0)]];
+    float vScale [[user(locn1)]];
+};
+
+static inline __attribute__((always_inline))
+float4 shade(float4 color, float scale)
+{
+    half4 _33 = half4(color);
+    return float4(clamp((_33 * half(scale)) + _33, half4(half(0.0)), half4(half(1.0))));
+}
+
+fragment main0_out main0(main0_in in [[stage_in]])
+{
+    main0_out out = {};
+    out.FragColor = shade(in.vColor, in.vScale);
+    return out;
+}
+
@@ -58,15 +58,13 @@ struct main0_in
 };
 
 static inline __attribute__((always_inline))
-float4 consume_constant_arrays2(spvUnsafeArray<float4, 4> positions, spvUnsafeArray<float4, 4> positions2, thread int& Index1, thread int& Index2)
+float4 consume_constant_arrays2(constant spvUnsafeArray<float4, 4>& positions, thread const spvUnsafeArray<float4, 4>& positions2, thread int& Index1, thread int& Index2)
 {
-    spvUnsafeArray<float4, 4> indexable = positions;
-    spvUnsafeArray<float4, 4> indexable_1 = positions2;
-    return indexable[Index1] + indexable_1[Index2];
+    return positions[Index1] + positions2[Index2];
 }
 
 static inline __attribute__((always_inline))
-float4 consume_constant_arrays(spvUnsafeArray<float4, 4> positions, spvUnsafeArray<float4, 4> positions2, thread int& Index1, thread int& Index2)
+float4 consume_constant_arrays(constant spvUnsafeArray<float4, 4>& positions, thread const spvUnsafeArray<float4, 4>& positions2, thread int& Index1, thread int& Index2)
 {
     return consume_constant_arrays2(positions, positions2, Index1, Index2);
 }
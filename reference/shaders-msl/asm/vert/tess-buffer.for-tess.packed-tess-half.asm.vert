@@ -0,0 +1,39 @@
+#pragma clang diagnostic ignored "-Wmissing-prototypes"
+
+#include <metal_stdlib>
+#include <simd/simd.h>
+
+using namespace metal;
+
+struct main0_out
+{
+    packed_half3 vNormal;
+    packed_float4 vColor;
+    packed_half2 vUV;
+    float4 gl_Position;
+};
+
+struct main0_in
+{
+    float4 pos [[attribute(0)]];
+    float3 nrm [[attribute(1)]];
+};
+
+static inline __attribute__((always_inline))
+void write_uv(thread float4& pos, device packed_half2& vUV)
+{
+    vUV = half2(pos.xy);
+    vUV = half2(float2(vUV) + pos.xy);
+}
+
+kernel void main0(main0_in in [[stage_in]], uint3 gl_GlobalInvocationID [[thread_position_in_grid]], uint3 spvStageInputSize [[grid_size]], device main0_out* spvOut [[buffer(28)]])
+{
+    device main0_out& out = spvOut[gl_GlobalInvocationID.y * spvStageInputSize.x + gl_GlobalInvocationID.x];
+    if (any(gl_GlobalInvocationID >= spvStageInputSize))
+        return;
+    out.gl_Position = in.pos;
+    out.vNormal = half3(in.nrm);
+    out.vColor = in.pos;
+    write_uv(in.pos, out.vUV);
+}
+
@@ -0,0 +1,15 @@
+#version 450
+
+layout(location = 0) out vec4 FragColor0;
+layout(location = 1) out vec4 FragColor1;
+layout(location = 0) in vec4 vA;
+layout(location = 1) in vec4 vB;
+layout(location = 2) in vec4 vC;
+
+void main()
+{
+    vec4 _15 = sqrt((vA * vB) + vC);
+    FragColor0 = _15 + (vA - vB);
+    FragColor1 = _15 * (vA - vB);
+}
+
@@ -0,0 +1,17 @@
+#version 450
+
+layout(binding = 0, std430) readonly buffer SPIRV_Cross_LUT0
+{
+    float _20[8];
+};
+
+const float _22[2] = float[](1.0, 2.0);
+
+layout(location = 0) out float FragColor;
+layout(location = 0) flat in int vIndex;
+
+void main()
+{
+    FragColor = (_20[vIndex] + _20[vIndex]) + _22[vIndex & 1];
+}
+
@@ -0,0 +1,27 @@
+#version 450
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 0) in vec4 vIn;
+vec4 _30[2] = vec4[](vec4(1.0), vec4(1.0));
+
+vec4 _33(vec4 _43[2])
+{
+    _30[0] = vec4(5.0);
+    return _43[0];
+}
+
+vec4 _35()
+{
+    return _30[0];
+}
+
+void main()
+{
+    vec4 _31[2] = _30;
+    vec4 _34 = _33(_31);
+    vec4 _36 = _35();
+    _30[0] = vec4(1.0);
+    vec4 _39 = vIn * vIn;
+    FragColor = ((_39 + _39) + _34) + _36;
+}
+
@@ -0,0 +1,11 @@
+#version 450
+
+layout(location = 0) out vec4 FragColor;
+layout(location = 0) in vec4 vA;
+layout(location = 1) in vec4 vB;
+
+void main()
+{
+    FragColor += ((((((((((((((((((((((((((((((((((((((((vA * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB) * vec4(2.0)) + vB);
+}
+
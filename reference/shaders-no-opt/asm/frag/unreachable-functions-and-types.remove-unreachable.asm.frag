@@ -0,0 +1,14 @@
+#version 450
+
+layout(binding = 0, std140) uniform UBO
+{
+    vec4 color;
+} ubo;
+
+layout(location = 0) out vec4 FragColor;
+
+void main()
+{
+    FragColor = ubo.color;
+}
+
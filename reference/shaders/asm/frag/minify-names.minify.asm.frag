@@ -0,0 +1,2 @@
+#version 450
+layout(binding=0,std140)uniform UBO{float uFactor;}ubo;layout(location=0)in vec4 vColor;layout(location=0)out vec4 FragColor;vec4 e;vec4 a(vec4 b,float c){vec4 d=b*c;return d+b;}void main(){vec4 f=vColor;vec4 g=f;float h=ubo.uFactor;e=a(g,h);FragColor=e;}
@@ -0,0 +1,68 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vIndex
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %lut "lut"
+               OpName %lut_copy "lut_copy"
+               OpName %small "small"
+               OpName %FragColor "FragColor"
+               OpName %vIndex "vIndex"
+               OpDecorate %FragColor Location 0
+               OpDecorate %vIndex Flat
+               OpDecorate %vIndex Location 0
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+        %int = OpTypeInt 32 1
+       %uint = OpTypeInt 32 0
+     %uint_8 = OpConstant %uint 8
+     %uint_2 = OpConstant %uint 2
+%_arr_float_uint_8 = OpTypeArray %float %uint_8
+%_arr_float_uint_2 = OpTypeArray %float %uint_2
+%_ptr_Function__arr_float_uint_8 = OpTypePointer Function %_arr_float_uint_8
+%_ptr_Function__arr_float_uint_2 = OpTypePointer Function %_arr_float_uint_2
+%_ptr_Function_float = OpTypePointer Function %float
+    %float_1 = OpConstant %float 1
+    %float_2 = OpConstant %float 2
+    %float_3 = OpConstant %float 3
+    %float_4 = OpConstant %float 4
+    %float_5 = OpConstant %float 5
+    %float_6 = OpConstant %float 6
+    %float_7 = OpConstant %float 7
+    %float_8 = OpConstant %float 8
+         %20 = OpConstantComposite %_arr_float_uint_8 %float_1 %float_2 %float_3 %float_4 %float_5 %float_6 %float_7 %float_8
+         %21 = OpConstantComposite %_arr_float_uint_8 %float_1 %float_2 %float_3 %float_4 %float_5 %float_6 %float_7 %float_8
+         %22 = OpConstantComposite %_arr_float_uint_2 %float_1 %float_2
+%_ptr_Output_float = OpTypePointer Output %float
+  %FragColor = OpVariable %_ptr_Output_float Output
+%_ptr_Input_int = OpTypePointer Input %int
+     %vIndex = OpVariable %_ptr_Input_int Input
+      %int_1 = OpConstant %int 1
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+        %lut = OpVariable %_ptr_Function__arr_float_uint_8 Function
+   %lut_copy = OpVariable %_ptr_Function__arr_float_uint_8 Function
+      %small = OpVariable %_ptr_Function__arr_float_uint_2 Function
+               OpStore %lut %20
+               OpStore %lut_copy %21
+               OpStore %small %22
+         %30 = OpLoad %int %vIndex
+         %31 = OpAccessChain %_ptr_Function_float %lut %30
+         %32 = OpLoad %float %31
+         %33 = OpAccessChain %_ptr_Function_float %lut_copy %30
+         %34 = OpLoad %float %33
+         %35 = OpBitwiseAnd %int %30 %int_1
+         %36 = OpAccessChain %_ptr_Function_float %small %35
+         %37 = OpLoad %float %36
+         %38 = OpFAdd %float %32 %34
+         %39 = OpFAdd %float %38 %37
+               OpStore %FragColor %39
+               OpReturn
+               OpFunctionEnd
@@ -0,0 +1,61 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 40
+; Schema: 0
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vColor %vScale
+               OpExecutionMode %main OriginUpperLeft
+               OpSource ESSL 310
+               OpName %main "main"
+               OpName %shade "shade"
+               OpName %color "color"
+               OpName %scale "scale"
+               OpName %FragColor "FragColor"
+               OpName %vColor "vColor"
+               OpName %vScale "vScale"
+               OpDecorate %FragColor RelaxedPrecision
+               OpDecorate %FragColor Location 0
+               OpDecorate %vColor RelaxedPrecision
+               OpDecorate %vColor Location 0
+               OpDecorate %vScale Location 1
+               OpDecorate %color RelaxedPrecision
+               OpDecorate %20 RelaxedPrecision
+               OpDecorate %21 RelaxedPrecision
+               OpDecorate %22 RelaxedPrecision
+               OpDecorate %30 RelaxedPrecision
+               OpDecorate %31 RelaxedPrecision
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+         %10 = OpTypeFunction %v4float %v4float %float
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+%_ptr_Input_v4float = OpTypePointer Input %v4float
+     %vColor = OpVariable %_ptr_Input_v4float Input
+%_ptr_Input_float = OpTypePointer Input %float
+     %vScale = OpVariable %_ptr_Input_float Input
+    %float_0 = OpConstant %float 0
+    %float_1 = OpConstant %float 1
+         %23 = OpConstantComposite %v4float %float_0 %float_0 %float_0 %float_0
+         %24 = OpConstantComposite %v4float %float_1 %float_1 %float_1 %float_1
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+         %30 = OpLoad %v4float %vColor
+         %32 = OpLoad %float %vScale
+         %31 = OpFunctionCall %v4float %shade %30 %32
+               OpStore %FragColor %31
+               OpReturn
+               OpFunctionEnd
+      %shade = OpFunction %v4float None %10
+      %color = OpFunctionParameter %v4float
+      %scale = OpFunctionParameter %float
+         %11 = OpLabel
+         %20 = OpVectorTimesScalar %v4float %color %scale
+         %21 = OpFAdd %v4float %20 %color
+         %22 = OpExtInst %v4float %1 FClamp %21 %23 %24
+               OpReturnValue %22
+               OpFunctionEnd
@@ -0,0 +1,70 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vIndex
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %Small "Small"
+               OpMemberName %Small 0 "a"
+               OpMemberName %Small 1 "b"
+               OpMemberName %Small 2 "unused"
+               OpName %small "small"
+               OpName %Large "Large"
+               OpMemberName %Large 0 "m"
+               OpName %large "large"
+               OpName %FragColor "FragColor"
+               OpName %vIndex "vIndex"
+               OpDecorate %FragColor Location 0
+               OpDecorate %vIndex Flat
+               OpDecorate %vIndex Location 0
+               OpMemberDecorate %Small 0 Offset 0
+               OpMemberDecorate %Small 1 Offset 16
+               OpMemberDecorate %Small 2 Offset 32
+               OpDecorate %Small Block
+               OpDecorate %small DescriptorSet 0
+               OpDecorate %small Binding 0
+               OpDecorate %_arr_v4float_uint_16 ArrayStride 16
+               OpMemberDecorate %Large 0 Offset 0
+               OpDecorate %Large Block
+               OpDecorate %large DescriptorSet 0
+               OpDecorate %large Binding 1
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+        %int = OpTypeInt 32 1
+       %uint = OpTypeInt 32 0
+    %uint_16 = OpConstant %uint 16
+      %Small = OpTypeStruct %v4float %v4float %v4float
+%_arr_v4float_uint_16 = OpTypeArray %v4float %uint_16
+      %Large = OpTypeStruct %_arr_v4float_uint_16
+%_ptr_Uniform_Small = OpTypePointer Uniform %Small
+      %small = OpVariable %_ptr_Uniform_Small Uniform
+%_ptr_Uniform_Large = OpTypePointer Uniform %Large
+      %large = OpVariable %_ptr_Uniform_Large Uniform
+%_ptr_Uniform_v4float = OpTypePointer Uniform %v4float
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+%_ptr_Input_int = OpTypePointer Input %int
+     %vIndex = OpVariable %_ptr_Input_int Input
+      %int_0 = OpConstant %int 0
+      %int_1 = OpConstant %int 1
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+         %20 = OpAccessChain %_ptr_Uniform_v4float %small %int_0
+         %21 = OpLoad %v4float %20
+         %22 = OpAccessChain %_ptr_Uniform_v4float %small %int_1
+         %23 = OpLoad %v4float %22
+         %24 = OpLoad %int %vIndex
+         %25 = OpAccessChain %_ptr_Uniform_v4float %large %int_0 %24
+         %26 = OpLoad %v4float %25
+         %27 = OpFMul %v4float %21 %26
+         %28 = OpFAdd %v4float %27 %23
+               OpStore %FragColor %28
+               OpReturn
+               OpFunctionEnd
@@ -0,0 +1,77 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 49
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor
+               OpExecutionMode %main OriginUpperLeft
+               OpName %main "main"
+               OpName %FragColor "FragColor"
+               OpName %f "f"
+               OpName %k "k"
+               OpName %a "a"
+               OpName %g "g"
+               OpName %h "h"
+               OpName %p "p"
+               OpName %tmp "tmp"
+               OpDecorate %FragColor Location 0
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+       %uint = OpTypeInt 32 0
+     %uint_2 = OpConstant %uint 2
+%_arr_v4float_uint_2 = OpTypeArray %v4float %uint_2
+%_ptr_Private__arr_v4float_uint_2 = OpTypePointer Private %_arr_v4float_uint_2
+%_ptr_Private_v4float = OpTypePointer Private %v4float
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+         %fn = OpTypeFunction %v4float %_arr_v4float_uint_2 %_arr_v4float_uint_2
+       %fn_h = OpTypeFunction %v4float %_ptr_Private__arr_v4float_uint_2
+%_ptr_Function__arr_v4float_uint_2 = OpTypePointer Function %_arr_v4float_uint_2
+%_ptr_Function_v4float = OpTypePointer Function %v4float
+        %int = OpTypeInt 32 1
+      %int_0 = OpConstant %int 0
+    %float_1 = OpConstant %float 1
+    %float_2 = OpConstant %float 2
+    %float_5 = OpConstant %float 5
+       %one4 = OpConstantComposite %v4float %float_1 %float_1 %float_1 %float_1
+       %two4 = OpConstantComposite %v4float %float_2 %float_2 %float_2 %float_2
+      %five4 = OpConstantComposite %v4float %float_5 %float_5 %float_5 %float_5
+       %init = OpConstantComposite %_arr_v4float_uint_2 %one4 %one4
+   %constArr = OpConstantComposite %_arr_v4float_uint_2 %two4 %two4
+          %g = OpVariable %_ptr_Private__arr_v4float_uint_2 Private %init
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+         %gl = OpLoad %_arr_v4float_uint_2 %g
+          %r = OpFunctionCall %v4float %f %constArr %gl
+         %r2 = OpFunctionCall %v4float %h %g
+        %res = OpFAdd %v4float %r %r2
+               OpStore %FragColor %res
+               OpReturn
+               OpFunctionEnd
+          %f = OpFunction %v4float None %fn
+          %k = OpFunctionParameter %_arr_v4float_uint_2
+          %a = OpFunctionParameter %_arr_v4float_uint_2
+         %10 = OpLabel
+         %ac = OpAccessChain %_ptr_Private_v4float %g %int_0
+               OpStore %ac %five4
+         %a0 = OpCompositeExtract %v4float %a 0
+         %k0 = OpCompositeExtract %v4float %k 0
+        %sum = OpFAdd %v4float %a0 %k0
+               OpReturnValue %sum
+               OpFunctionEnd
+          %h = OpFunction %v4float None %fn_h
+          %p = OpFunctionParameter %_ptr_Private__arr_v4float_uint_2
+         %11 = OpLabel
+        %tmp = OpVariable %_ptr_Function__arr_v4float_uint_2 Function
+         %pl = OpLoad %_arr_v4float_uint_2 %p
+               OpStore %tmp %pl
+        %hac = OpAccessChain %_ptr_Private_v4float %g %int_0
+               OpStore %hac %two4
+        %tac = OpAccessChain %_ptr_Function_v4float %tmp %int_0
+         %t0 = OpLoad %v4float %tac
+               OpReturnValue %t0
+               OpFunctionEnd
@@ -0,0 +1,90 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vIndex
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %UBO "UBO"
+               OpMemberName %UBO 0 "colors"
+               OpName %ubo "ubo"
+               OpName %SSBO "SSBO"
+               OpMemberName %SSBO 0 "weights"
+               OpName %ssbo "ssbo"
+               OpName %colors "colors"
+               OpName %weights "weights"
+               OpName %FragColor "FragColor"
+               OpName %vIndex "vIndex"
+               OpDecorate %_arr_v4float_uint_4_0 ArrayStride 16
+               OpMemberDecorate %UBO 0 Offset 0
+               OpDecorate %UBO Block
+               OpDecorate %ubo DescriptorSet 0
+               OpDecorate %ubo Binding 0
+               OpDecorate %_arr_v4float_uint_4_1 ArrayStride 16
+               OpMemberDecorate %SSBO 0 NonWritable
+               OpMemberDecorate %SSBO 0 Offset 0
+               OpDecorate %SSBO BufferBlock
+               OpDecorate %ssbo NonWritable
+               OpDecorate %ssbo DescriptorSet 0
+               OpDecorate %ssbo Binding 1
+               OpDecorate %FragColor Location 0
+               OpDecorate %vIndex Flat
+               OpDecorate %vIndex Location 0
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+        %int = OpTypeInt 32 1
+       %uint = OpTypeInt 32 0
+     %uint_4 = OpConstant %uint 4
+      %int_0 = OpConstant %int 0
+%_arr_v4float_uint_4 = OpTypeArray %v4float %uint_4
+%_ptr_Function__arr_v4float_uint_4 = OpTypePointer Function %_arr_v4float_uint_4
+%_ptr_Function_v4float = OpTypePointer Function %v4float
+%_arr_v4float_uint_4_0 = OpTypeArray %v4float %uint_4
+        %UBO = OpTypeStruct %_arr_v4float_uint_4_0
+%_ptr_Uniform_UBO = OpTypePointer Uniform %UBO
+        %ubo = OpVariable %_ptr_Uniform_UBO Uniform
+%_ptr_Uniform__arr_v4float_uint_4_0 = OpTypePointer Uniform %_arr_v4float_uint_4_0
+%_arr_v4float_uint_4_1 = OpTypeArray %v4float %uint_4
+       %SSBO = OpTypeStruct %_arr_v4float_uint_4_1
+%_ptr_Uniform_SSBO = OpTypePointer Uniform %SSBO
+       %ssbo = OpVariable %_ptr_Uniform_SSBO Uniform
+%_ptr_Uniform__arr_v4float_uint_4_1 = OpTypePointer Uniform %_arr_v4float_uint_4_1
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+%_ptr_Input_int = OpTypePointer Input %int
+     %vIndex = OpVariable %_ptr_Input_int Input
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+     %colors = OpVariable %_ptr_Function__arr_v4float_uint_4 Function
+    %weights = OpVariable %_ptr_Function__arr_v4float_uint_4 Function
+         %20 = OpAccessChain %_ptr_Uniform__arr_v4float_uint_4_0 %ubo %int_0
+         %21 = OpLoad %_arr_v4float_uint_4_0 %20
+         %22 = OpCompositeExtract %v4float %21 0
+         %23 = OpCompositeExtract %v4float %21 1
+         %24 = OpCompositeExtract %v4float %21 2
+         %25 = OpCompositeExtract %v4float %21 3
+         %26 = OpCompositeConstruct %_arr_v4float_uint_4 %22 %23 %24 %25
+               OpStore %colors %26
+         %30 = OpAccessChain %_ptr_Uniform__arr_v4float_uint_4_1 %ssbo %int_0
+         %31 = OpLoad %_arr_v4float_uint_4_1 %30
+         %32 = OpCompositeExtract %v4float %31 0
+         %33 = OpCompositeExtract %v4float %31 1
+         %34 = OpCompositeExtract %v4float %31 2
+         %35 = OpCompositeExtract %v4float %31 3
+         %36 = OpCompositeConstruct %_arr_v4float_uint_4 %32 %33 %34 %35
+               OpStore %weights %36
+         %40 = OpLoad %int %vIndex
+         %41 = OpAccessChain %_ptr_Function_v4float %colors %40
+         %42 = OpLoad %v4float %41
+         %43 = OpAccessChain %_ptr_Function_v4float %weights %40
+         %44 = OpLoad %v4float %43
+         %45 = OpFMul %v4float %42 %44
+               OpStore %FragColor %45
+               OpReturn
+               OpFunctionEnd
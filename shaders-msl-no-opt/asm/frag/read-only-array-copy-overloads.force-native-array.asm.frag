@@ -0,0 +1,129 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 90
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vIndex %vColor
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %lookup "lookup"
+               OpName %tbl "tbl"
+               OpName %idx "idx"
+               OpName %UBO "UBO"
+               OpMemberName %UBO 0 "colors"
+               OpName %ubo "ubo"
+               OpName %SSBO "SSBO"
+               OpMemberName %SSBO 0 "weights"
+               OpName %ssbo "ssbo"
+               OpName %local "local"
+               OpName %param "param"
+               OpName %param_0 "param"
+               OpName %param_1 "param"
+               OpName %FragColor "FragColor"
+               OpName %vIndex "vIndex"
+               OpName %vColor "vColor"
+               OpDecorate %_arr_v4float_uint_4_0 ArrayStride 16
+               OpMemberDecorate %UBO 0 Offset 0
+               OpDecorate %UBO Block
+               OpDecorate %ubo DescriptorSet 0
+               OpDecorate %ubo Binding 0
+               OpDecorate %_arr_v4float_uint_4_1 ArrayStride 16
+               OpMemberDecorate %SSBO 0 NonWritable
+               OpMemberDecorate %SSBO 0 Offset 0
+               OpDecorate %SSBO BufferBlock
+               OpDecorate %ssbo NonWritable
+               OpDecorate %ssbo DescriptorSet 0
+               OpDecorate %ssbo Binding 1
+               OpDecorate %FragColor Location 0
+               OpDecorate %vIndex Flat
+               OpDecorate %vIndex Location 0
+               OpDecorate %vColor Location 1
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+        %int = OpTypeInt 32 1
+       %uint = OpTypeInt 32 0
+     %uint_4 = OpConstant %uint 4
+      %int_0 = OpConstant %int 0
+      %int_1 = OpConstant %int 1
+      %int_2 = OpConstant %int 2
+      %int_3 = OpConstant %int 3
+%_arr_v4float_uint_4 = OpTypeArray %v4float %uint_4
+%_ptr_Function__arr_v4float_uint_4 = OpTypePointer Function %_arr_v4float_uint_4
+%_ptr_Function_v4float = OpTypePointer Function %v4float
+         %11 = OpTypeFunction %v4float %_ptr_Function__arr_v4float_uint_4 %int
+    %float_0 = OpConstant %float 0
+    %float_1 = OpConstant %float 1
+         %c0 = OpConstantComposite %v4float %float_0 %float_0 %float_0 %float_1
+         %c1 = OpConstantComposite %v4float %float_1 %float_0 %float_0 %float_1
+         %c2 = OpConstantComposite %v4float %float_0 %float_1 %float_0 %float_1
+         %c3 = OpConstantComposite %v4float %float_0 %float_0 %float_1 %float_1
+      %table = OpConstantComposite %_arr_v4float_uint_4 %c0 %c1 %c2 %c3
+%_arr_v4float_uint_4_0 = OpTypeArray %v4float %uint_4
+        %UBO = OpTypeStruct %_arr_v4float_uint_4_0
+%_ptr_Uniform_UBO = OpTypePointer Uniform %UBO
+        %ubo = OpVariable %_ptr_Uniform_UBO Uniform
+%_ptr_Uniform__arr_v4float_uint_4_0 = OpTypePointer Uniform %_arr_v4float_uint_4_0
+%_arr_v4float_uint_4_1 = OpTypeArray %v4float %uint_4
+       %SSBO = OpTypeStruct %_arr_v4float_uint_4_1
+%_ptr_Uniform_SSBO = OpTypePointer Uniform %SSBO
+       %ssbo = OpVariable %_ptr_Uniform_SSBO Uniform
+%_ptr_Uniform__arr_v4float_uint_4_1 = OpTypePointer Uniform %_arr_v4float_uint_4_1
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+%_ptr_Input_int = OpTypePointer Input %int
+     %vIndex = OpVariable %_ptr_Input_int Input
+%_ptr_Input_v4float = OpTypePointer Input %v4float
+     %vColor = OpVariable %_ptr_Input_v4float Input
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+      %param = OpVariable %_ptr_Function__arr_v4float_uint_4 Function
+    %param_0 = OpVariable %_ptr_Function__arr_v4float_uint_4 Function
+    %param_1 = OpVariable %_ptr_Function__arr_v4float_uint_4 Function
+      %local = OpVariable %_ptr_Function__arr_v4float_uint_4 Function
+         %19 = OpLoad %int %vIndex
+               OpStore %param %table
+         %20 = OpFunctionCall %v4float %lookup %param %19
+         %21 = OpAccessChain %_ptr_Uniform__arr_v4float_uint_4_0 %ubo %int_0
+         %22 = OpLoad %_arr_v4float_uint_4_0 %21
+         %23 = OpCompositeExtract %v4float %22 0
+         %24 = OpCompositeExtract %v4float %22 1
+         %25 = OpCompositeExtract %v4float %22 2
+         %26 = OpCompositeExtract %v4float %22 3
+         %27 = OpCompositeConstruct %_arr_v4float_uint_4 %23 %24 %25 %26
+               OpStore %param_0 %27
+         %28 = OpFunctionCall %v4float %lookup %param_0 %19
+         %30 = OpAccessChain %_ptr_Uniform__arr_v4float_uint_4_1 %ssbo %int_0
+         %31 = OpLoad %_arr_v4float_uint_4_1 %30
+         %32 = OpCompositeExtract %v4float %31 0
+         %33 = OpCompositeExtract %v4float %31 1
+         %34 = OpCompositeExtract %v4float %31 2
+         %35 = OpCompositeExtract %v4float %31 3
+         %36 = OpCompositeConstruct %_arr_v4float_uint_4 %32 %33 %34 %35
+               OpStore %param_1 %36
+         %37 = OpFunctionCall %v4float %lookup %param_1 %19
+         %40 = OpLoad %v4float %vColor
+         %41 = OpAccessChain %_ptr_Function_v4float %local %int_0
+               OpStore %41 %40
+         %42 = OpAccessChain %_ptr_Function_v4float %local %int_1
+               OpStore %42 %20
+         %43 = OpAccessChain %_ptr_Function_v4float %local %int_2
+               OpStore %43 %28
+         %44 = OpAccessChain %_ptr_Function_v4float %local %int_3
+               OpStore %44 %37
+         %45 = OpFunctionCall %v4float %lookup %local %19
+               OpStore %FragColor %45
+               OpReturn
+               OpFunctionEnd
+     %lookup = OpFunction %v4float None %11
+        %tbl = OpFunctionParameter %_ptr_Function__arr_v4float_uint_4
+        %idx = OpFunctionParameter %int
+         %60 = OpLabel
+         %61 = OpAccessChain %_ptr_Function_v4float %tbl %idx
+         %62 = OpLoad %v4float %61
+               OpReturnValue %62
+               OpFunctionEnd
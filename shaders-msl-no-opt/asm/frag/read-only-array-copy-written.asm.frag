@@ -0,0 +1,59 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 40
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vIndex
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %lookup "lookup"
+               OpName %tbl "tbl"
+               OpName %idx "idx"
+               OpName %copy "copy"
+               OpName %FragColor "FragColor"
+               OpName %vIndex "vIndex"
+               OpDecorate %FragColor Location 0
+               OpDecorate %vIndex Flat
+               OpDecorate %vIndex Location 0
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+        %int = OpTypeInt 32 1
+       %uint = OpTypeInt 32 0
+     %uint_4 = OpConstant %uint 4
+%_arr_float_uint_4 = OpTypeArray %float %uint_4
+%_ptr_Function__arr_float_uint_4 = OpTypePointer Function %_arr_float_uint_4
+%_ptr_Function_float = OpTypePointer Function %float
+         %11 = OpTypeFunction %float %_ptr_Function__arr_float_uint_4 %int
+    %float_1 = OpConstant %float 1
+    %float_2 = OpConstant %float 2
+    %float_3 = OpConstant %float 3
+    %float_4 = OpConstant %float 4
+      %table = OpConstantComposite %_arr_float_uint_4 %float_1 %float_2 %float_3 %float_4
+      %int_0 = OpConstant %int 0
+%_ptr_Output_float = OpTypePointer Output %float
+  %FragColor = OpVariable %_ptr_Output_float Output
+%_ptr_Input_int = OpTypePointer Input %int
+     %vIndex = OpVariable %_ptr_Input_int Input
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+       %copy = OpVariable %_ptr_Function__arr_float_uint_4 Function
+               OpStore %copy %table
+         %22 = OpAccessChain %_ptr_Function_float %copy %int_0
+               OpStore %22 %float_4
+         %20 = OpLoad %int %vIndex
+         %21 = OpFunctionCall %float %lookup %copy %20
+               OpStore %FragColor %21
+               OpReturn
+               OpFunctionEnd
+     %lookup = OpFunction %float None %11
+        %tbl = OpFunctionParameter %_ptr_Function__arr_float_uint_4
+        %idx = OpFunctionParameter %int
+         %30 = OpLabel
+         %31 = OpAccessChain %_ptr_Function_float %tbl %idx
+         %32 = OpLoad %float %31
+               OpReturnValue %32
+               OpFunctionEnd
@@ -0,0 +1,60 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Vertex %main "main" %gl_Position %pos %nrm %vNormal %vColor %vUV
+               OpName %main "main"
+               OpName %write_uv_ "write_uv("
+               OpName %pos "pos"
+               OpName %nrm "nrm"
+               OpName %vNormal "vNormal"
+               OpName %vColor "vColor"
+               OpName %vUV "vUV"
+               OpDecorate %gl_Position BuiltIn Position
+               OpDecorate %pos Location 0
+               OpDecorate %nrm Location 1
+               OpDecorate %vNormal Location 0
+               OpDecorate %vNormal RelaxedPrecision
+               OpDecorate %vColor Location 1
+               OpDecorate %vUV Location 2
+               OpDecorate %vUV RelaxedPrecision
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v2float = OpTypeVector %float 2
+    %v3float = OpTypeVector %float 3
+    %v4float = OpTypeVector %float 4
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+%_ptr_Output_v3float = OpTypePointer Output %v3float
+%_ptr_Output_v2float = OpTypePointer Output %v2float
+%_ptr_Input_v4float = OpTypePointer Input %v4float
+%_ptr_Input_v3float = OpTypePointer Input %v3float
+%gl_Position = OpVariable %_ptr_Output_v4float Output
+        %pos = OpVariable %_ptr_Input_v4float Input
+        %nrm = OpVariable %_ptr_Input_v3float Input
+    %vNormal = OpVariable %_ptr_Output_v3float Output
+     %vColor = OpVariable %_ptr_Output_v4float Output
+        %vUV = OpVariable %_ptr_Output_v2float Output
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+         %10 = OpLoad %v4float %pos
+               OpStore %gl_Position %10
+         %11 = OpLoad %v3float %nrm
+               OpStore %vNormal %11
+               OpStore %vColor %10
+         %12 = OpFunctionCall %void %write_uv_
+               OpReturn
+               OpFunctionEnd
+  %write_uv_ = OpFunction %void None %3
+         %20 = OpLabel
+         %21 = OpLoad %v4float %pos
+         %22 = OpVectorShuffle %v2float %21 %21 0 1
+               OpStore %vUV %22
+         %23 = OpLoad %v2float %vUV
+         %24 = OpFAdd %v2float %23 %22
+               OpStore %vUV %24
+               OpReturn
+               OpFunctionEnd
@@ -0,0 +1,52 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 40
+; Schema: 0
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor0 %FragColor1 %vA %vB %vC
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %FragColor0 "FragColor0"
+               OpName %FragColor1 "FragColor1"
+               OpName %vA "vA"
+               OpName %vB "vB"
+               OpName %vC "vC"
+               OpDecorate %FragColor0 Location 0
+               OpDecorate %FragColor1 Location 1
+               OpDecorate %vA Location 0
+               OpDecorate %vB Location 1
+               OpDecorate %vC Location 2
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+ %FragColor0 = OpVariable %_ptr_Output_v4float Output
+ %FragColor1 = OpVariable %_ptr_Output_v4float Output
+%_ptr_Input_v4float = OpTypePointer Input %v4float
+         %vA = OpVariable %_ptr_Input_v4float Input
+         %vB = OpVariable %_ptr_Input_v4float Input
+         %vC = OpVariable %_ptr_Input_v4float Input
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+         %10 = OpLoad %v4float %vA
+         %11 = OpLoad %v4float %vB
+         %12 = OpLoad %v4float %vC
+         %13 = OpFMul %v4float %10 %11
+         %14 = OpFAdd %v4float %13 %12
+         %15 = OpExtInst %v4float %1 Sqrt %14
+         %16 = OpFMul %v4float %10 %11
+         %17 = OpFAdd %v4float %16 %12
+         %18 = OpExtInst %v4float %1 Sqrt %17
+         %19 = OpFSub %v4float %10 %11
+         %20 = OpFSub %v4float %10 %11
+         %21 = OpFAdd %v4float %15 %19
+         %22 = OpFMul %v4float %18 %20
+               OpStore %FragColor0 %21
+               OpStore %FragColor1 %22
+               OpReturn
+               OpFunctionEnd
@@ -0,0 +1,71 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vUV
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %UBO "UBO"
+               OpMemberName %UBO 0 "scale"
+               OpName %ubo "ubo"
+               OpName %uTexture "uTexture"
+               OpName %uSampler "uSampler"
+               OpName %uCombined "uCombined"
+               OpName %FragColor "FragColor"
+               OpName %vUV "vUV"
+               OpDecorate %FragColor Location 0
+               OpDecorate %vUV Location 0
+               OpMemberDecorate %UBO 0 Offset 0
+               OpDecorate %UBO Block
+               OpDecorate %ubo DescriptorSet 0
+               OpDecorate %ubo Binding 0
+               OpDecorate %uTexture DescriptorSet 0
+               OpDecorate %uTexture Binding 1
+               OpDecorate %uSampler DescriptorSet 0
+               OpDecorate %uSampler Binding 2
+               OpDecorate %uCombined DescriptorSet 1
+               OpDecorate %uCombined Binding 0
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v2float = OpTypeVector %float 2
+    %v4float = OpTypeVector %float 4
+        %UBO = OpTypeStruct %v4float
+%_ptr_Uniform_UBO = OpTypePointer Uniform %UBO
+        %ubo = OpVariable %_ptr_Uniform_UBO Uniform
+        %int = OpTypeInt 32 1
+      %int_0 = OpConstant %int 0
+%_ptr_Uniform_v4float = OpTypePointer Uniform %v4float
+         %10 = OpTypeImage %float 2D 0 0 0 1 Unknown
+%_ptr_UniformConstant_10 = OpTypePointer UniformConstant %10
+   %uTexture = OpVariable %_ptr_UniformConstant_10 UniformConstant
+         %11 = OpTypeSampler
+%_ptr_UniformConstant_11 = OpTypePointer UniformConstant %11
+   %uSampler = OpVariable %_ptr_UniformConstant_11 UniformConstant
+         %12 = OpTypeSampledImage %10
+%_ptr_UniformConstant_12 = OpTypePointer UniformConstant %12
+  %uCombined = OpVariable %_ptr_UniformConstant_12 UniformConstant
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+%_ptr_Input_v2float = OpTypePointer Input %v2float
+        %vUV = OpVariable %_ptr_Input_v2float Input
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+         %20 = OpLoad %10 %uTexture
+         %21 = OpLoad %11 %uSampler
+         %22 = OpSampledImage %12 %20 %21
+         %23 = OpLoad %v2float %vUV
+         %24 = OpImageSampleImplicitLod %v4float %22 %23
+         %25 = OpLoad %12 %uCombined
+         %26 = OpImageSampleImplicitLod %v4float %25 %23
+         %27 = OpAccessChain %_ptr_Uniform_v4float %ubo %int_0
+         %28 = OpLoad %v4float %27
+         %29 = OpFMul %v4float %24 %28
+         %30 = OpFAdd %v4float %29 %26
+               OpStore %FragColor %30
+               OpReturn
+               OpFunctionEnd
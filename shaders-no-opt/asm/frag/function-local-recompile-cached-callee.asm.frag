@@ -0,0 +1,73 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 49
+; Schema: 0
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vIn
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %FragColor "FragColor"
+               OpName %vIn "vIn"
+               OpDecorate %FragColor Location 0
+               OpDecorate %vIn Location 0
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+       %uint = OpTypeInt 32 0
+     %uint_2 = OpConstant %uint 2
+%_arr_v4float_uint_2 = OpTypeArray %v4float %uint_2
+%_ptr_Function__arr_v4float_uint_2 = OpTypePointer Function %_arr_v4float_uint_2
+%_ptr_Private__arr_v4float_uint_2 = OpTypePointer Private %_arr_v4float_uint_2
+%_ptr_Function_v4float = OpTypePointer Function %v4float
+%_ptr_Private_v4float = OpTypePointer Private %v4float
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+%_ptr_Input_v4float = OpTypePointer Input %v4float
+         %fn = OpTypeFunction %v4float %_ptr_Function__arr_v4float_uint_2
+       %fn_h = OpTypeFunction %v4float
+        %int = OpTypeInt 32 1
+      %int_0 = OpConstant %int 0
+    %float_1 = OpConstant %float 1
+    %float_5 = OpConstant %float 5
+       %one4 = OpConstantComposite %v4float %float_1 %float_1 %float_1 %float_1
+      %five4 = OpConstantComposite %v4float %float_5 %float_5 %float_5 %float_5
+       %init = OpConstantComposite %_arr_v4float_uint_2 %one4 %one4
+          %g = OpVariable %_ptr_Private__arr_v4float_uint_2 Private %init
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+        %vIn = OpVariable %_ptr_Input_v4float Input
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+      %param = OpVariable %_ptr_Function__arr_v4float_uint_2 Function
+         %gl = OpLoad %_arr_v4float_uint_2 %g
+               OpStore %param %gl
+          %r = OpFunctionCall %v4float %f %param
+         %r2 = OpFunctionCall %v4float %h
+        %gac = OpAccessChain %_ptr_Private_v4float %g %int_0
+               OpStore %gac %one4
+        %vin = OpLoad %v4float %vIn
+         %t0 = OpFMul %v4float %vin %vin
+         %t1 = OpFAdd %v4float %t0 %t0
+         %t3 = OpFAdd %v4float %t1 %r
+         %t2 = OpFAdd %v4float %t3 %r2
+               OpStore %FragColor %t2
+               OpReturn
+               OpFunctionEnd
+          %f = OpFunction %v4float None %fn
+          %a = OpFunctionParameter %_ptr_Function__arr_v4float_uint_2
+         %10 = OpLabel
+         %ac = OpAccessChain %_ptr_Private_v4float %g %int_0
+               OpStore %ac %five4
+        %ac2 = OpAccessChain %_ptr_Function_v4float %a %int_0
+          %v = OpLoad %v4float %ac2
+               OpReturnValue %v
+               OpFunctionEnd
+          %h = OpFunction %v4float None %fn_h
+         %11 = OpLabel
+        %hac = OpAccessChain %_ptr_Private_v4float %g %int_0
+         %hv = OpLoad %v4float %hac
+               OpReturnValue %hv
+               OpFunctionEnd
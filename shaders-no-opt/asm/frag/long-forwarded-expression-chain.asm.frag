@@ -0,0 +1,76 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 200
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor %vA %vB
+               OpExecutionMode %main OriginUpperLeft
+               OpName %main "main"
+               OpName %FragColor "FragColor"
+               OpName %vA "vA"
+               OpName %vB "vB"
+               OpDecorate %FragColor Location 0
+               OpDecorate %vA Location 0
+               OpDecorate %vB Location 1
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+%_ptr_Input_v4float = OpTypePointer Input %v4float
+         %vA = OpVariable %_ptr_Input_v4float Input
+         %vB = OpVariable %_ptr_Input_v4float Input
+    %float_2 = OpConstant %float 2
+      %scale = OpConstantComposite %v4float %float_2 %float_2 %float_2 %float_2
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+        %x0 = OpLoad %v4float %vA
+        %b = OpLoad %v4float %vB
+        %x1 = OpFMul %v4float %x0 %scale
+        %x2 = OpFAdd %v4float %x1 %b
+        %x3 = OpFMul %v4float %x2 %scale
+        %x4 = OpFAdd %v4float %x3 %b
+        %x5 = OpFMul %v4float %x4 %scale
+        %x6 = OpFAdd %v4float %x5 %b
+        %x7 = OpFMul %v4float %x6 %scale
+        %x8 = OpFAdd %v4float %x7 %b
+        %x9 = OpFMul %v4float %x8 %scale
+        %x10 = OpFAdd %v4float %x9 %b
+        %x11 = OpFMul %v4float %x10 %scale
+        %x12 = OpFAdd %v4float %x11 %b
+        %x13 = OpFMul %v4float %x12 %scale
+        %x14 = OpFAdd %v4float %x13 %b
+        %x15 = OpFMul %v4float %x14 %scale
+        %x16 = OpFAdd %v4float %x15 %b
+        %x17 = OpFMul %v4float %x16 %scale
+        %x18 = OpFAdd %v4float %x17 %b
+        %x19 = OpFMul %v4float %x18 %scale
+        %x20 = OpFAdd %v4float %x19 %b
+        %x21 = OpFMul %v4float %x20 %scale
+        %x22 = OpFAdd %v4float %x21 %b
+        %x23 = OpFMul %v4float %x22 %scale
+        %x24 = OpFAdd %v4float %x23 %b
+        %x25 = OpFMul %v4float %x24 %scale
+        %x26 = OpFAdd %v4float %x25 %b
+        %x27 = OpFMul %v4float %x26 %scale
+        %x28 = OpFAdd %v4float %x27 %b
+        %x29 = OpFMul %v4float %x28 %scale
+        %x30 = OpFAdd %v4float %x29 %b
+        %x31 = OpFMul %v4float %x30 %scale
+        %x32 = OpFAdd %v4float %x31 %b
+        %x33 = OpFMul %v4float %x32 %scale
+        %x34 = OpFAdd %v4float %x33 %b
+        %x35 = OpFMul %v4float %x34 %scale
+        %x36 = OpFAdd %v4float %x35 %b
+        %x37 = OpFMul %v4float %x36 %scale
+        %x38 = OpFAdd %v4float %x37 %b
+        %x39 = OpFMul %v4float %x38 %scale
+        %x40 = OpFAdd %v4float %x39 %b
+        %old = OpLoad %v4float %FragColor
+        %sum = OpFAdd %v4float %old %x40
+               OpStore %FragColor %sum
+               OpReturn
+               OpFunctionEnd
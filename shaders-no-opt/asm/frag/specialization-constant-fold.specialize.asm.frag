@@ -0,0 +1,47 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+               OpCapability Int64
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %LIMIT "LIMIT"
+               OpName %SCALE "SCALE"
+               OpName %FragColor "FragColor"
+               OpDecorate %FragColor Location 0
+               OpDecorate %LIMIT SpecId 0
+               OpDecorate %SCALE SpecId 1
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+        %int = OpTypeInt 32 1
+       %long = OpTypeInt 64 1
+       %bool = OpTypeBool
+      %int_5 = OpConstant %int 5
+      %LIMIT = OpSpecConstant %long 10
+      %SCALE = OpSpecConstant %int 2
+      %limit = OpSpecConstantOp %int SConvert %LIMIT
+     %scaled = OpSpecConstantOp %int IMul %limit %SCALE
+       %cond = OpSpecConstantOp %bool SGreaterThan %scaled %int_5
+%_ptr_Output_float = OpTypePointer Output %float
+  %FragColor = OpVariable %_ptr_Output_float Output
+    %float_0 = OpConstant %float 0
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+               OpSelectionMerge %merge None
+               OpBranchConditional %cond %then %else
+       %then = OpLabel
+         %20 = OpConvertSToF %float %scaled
+               OpStore %FragColor %20
+               OpBranch %merge
+       %else = OpLabel
+               OpStore %FragColor %float_0
+               OpBranch %merge
+      %merge = OpLabel
+               OpReturn
+               OpFunctionEnd
@@ -0,0 +1,70 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %FragColor
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %dead "dead"
+               OpName %dead_leaf "dead_leaf"
+               OpName %Dead "Dead"
+               OpMemberName %Dead 0 "value"
+               OpName %dead_private "dead_private"
+               OpName %UBO "UBO"
+               OpMemberName %UBO 0 "color"
+               OpName %ubo "ubo"
+               OpName %DeadUBO "DeadUBO"
+               OpMemberName %DeadUBO 0 "unused"
+               OpName %dead_ubo "dead_ubo"
+               OpName %FragColor "FragColor"
+               OpDecorate %FragColor Location 0
+               OpMemberDecorate %UBO 0 Offset 0
+               OpDecorate %UBO Block
+               OpDecorate %ubo DescriptorSet 0
+               OpDecorate %ubo Binding 0
+               OpMemberDecorate %DeadUBO 0 Offset 0
+               OpDecorate %DeadUBO Block
+               OpDecorate %dead_ubo DescriptorSet 0
+               OpDecorate %dead_ubo Binding 1
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+        %int = OpTypeInt 32 1
+      %int_0 = OpConstant %int 0
+       %Dead = OpTypeStruct %v4float
+%_ptr_Private_Dead = OpTypePointer Private %Dead
+%dead_private = OpVariable %_ptr_Private_Dead Private
+%_ptr_Private_v4float = OpTypePointer Private %v4float
+         %15 = OpTypeFunction %v4float
+        %UBO = OpTypeStruct %v4float
+%_ptr_Uniform_UBO = OpTypePointer Uniform %UBO
+        %ubo = OpVariable %_ptr_Uniform_UBO Uniform
+    %DeadUBO = OpTypeStruct %v4float
+%_ptr_Uniform_DeadUBO = OpTypePointer Uniform %DeadUBO
+   %dead_ubo = OpVariable %_ptr_Uniform_DeadUBO Uniform
+%_ptr_Uniform_v4float = OpTypePointer Uniform %v4float
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+         %20 = OpAccessChain %_ptr_Uniform_v4float %ubo %int_0
+         %21 = OpLoad %v4float %20
+               OpStore %FragColor %21
+               OpReturn
+               OpFunctionEnd
+       %dead = OpFunction %v4float None %15
+         %30 = OpLabel
+         %31 = OpFunctionCall %v4float %dead_leaf
+               OpReturnValue %31
+               OpFunctionEnd
+  %dead_leaf = OpFunction %v4float None %15
+         %40 = OpLabel
+         %41 = OpAccessChain %_ptr_Private_v4float %dead_private %int_0
+         %42 = OpLoad %v4float %41
+               OpReturnValue %42
+               OpFunctionEnd
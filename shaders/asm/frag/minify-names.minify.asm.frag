@@ -0,0 +1,81 @@
+; SPIR-V
+; Version: 1.0
+; Generator: Khronos Glslang Reference Front End; 10
+; Bound: 60
+; Schema: 0
+               OpCapability Shader
+          %1 = OpExtInstImport "GLSL.std.450"
+               OpMemoryModel Logical GLSL450
+               OpEntryPoint Fragment %main "main" %vColor %FragColor
+               OpExecutionMode %main OriginUpperLeft
+               OpSource GLSL 450
+               OpName %main "main"
+               OpName %scale_vf4_f1_ "scale(vf4;f1;"
+               OpName %value "value"
+               OpName %factor "factor"
+               OpName %scaled "scaled"
+               OpName %accumulator "accumulator"
+               OpName %vColor "vColor"
+               OpName %FragColor "FragColor"
+               OpName %UBO "UBO"
+               OpMemberName %UBO 0 "uFactor"
+               OpName %ubo "ubo"
+               OpName %color "color"
+               OpName %param "param"
+               OpName %param_0 "param"
+               OpDecorate %vColor Location 0
+               OpDecorate %FragColor Location 0
+               OpMemberDecorate %UBO 0 Offset 0
+               OpDecorate %UBO Block
+               OpDecorate %ubo DescriptorSet 0
+               OpDecorate %ubo Binding 0
+       %void = OpTypeVoid
+          %3 = OpTypeFunction %void
+      %float = OpTypeFloat 32
+    %v4float = OpTypeVector %float 4
+%_ptr_Function_v4float = OpTypePointer Function %v4float
+%_ptr_Function_float = OpTypePointer Function %float
+         %10 = OpTypeFunction %v4float %_ptr_Function_v4float %_ptr_Function_float
+%_ptr_Private_v4float = OpTypePointer Private %v4float
+%accumulator = OpVariable %_ptr_Private_v4float Private
+%_ptr_Input_v4float = OpTypePointer Input %v4float
+     %vColor = OpVariable %_ptr_Input_v4float Input
+%_ptr_Output_v4float = OpTypePointer Output %v4float
+  %FragColor = OpVariable %_ptr_Output_v4float Output
+        %UBO = OpTypeStruct %float
+%_ptr_Uniform_UBO = OpTypePointer Uniform %UBO
+        %ubo = OpVariable %_ptr_Uniform_UBO Uniform
+        %int = OpTypeInt 32 1
+      %int_0 = OpConstant %int 0
+%_ptr_Uniform_float = OpTypePointer Uniform %float
+       %main = OpFunction %void None %3
+          %5 = OpLabel
+      %color = OpVariable %_ptr_Function_v4float Function
+      %param = OpVariable %_ptr_Function_v4float Function
+    %param_0 = OpVariable %_ptr_Function_float Function
+         %20 = OpLoad %v4float %vColor
+               OpStore %color %20
+         %21 = OpLoad %v4float %color
+               OpStore %param %21
+         %22 = OpAccessChain %_ptr_Uniform_float %ubo %int_0
+         %23 = OpLoad %float %22
+               OpStore %param_0 %23
+         %24 = OpFunctionCall %v4float %scale_vf4_f1_ %param %param_0
+               OpStore %accumulator %24
+         %25 = OpLoad %v4float %accumulator
+               OpStore %FragColor %25
+               OpReturn
+               OpFunctionEnd
+%scale_vf4_f1_ = OpFunction %v4float None %10
+      %value = OpFunctionParameter %_ptr_Function_v4float
+     %factor = OpFunctionParameter %_ptr_Function_float
+         %13 = OpLabel
+     %scaled = OpVariable %_ptr_Function_v4float Function
+         %30 = OpLoad %v4float %value
+         %31 = OpLoad %float %factor
+         %32 = OpVectorTimesScalar %v4float %30 %31
+               OpStore %scaled %32
+         %33 = OpLoad %v4float %scaled
+         %34 = OpFAdd %v4float %33 %30
+               OpReturnValue %34
+               OpFunctionEnd
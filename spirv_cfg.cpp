@@ -32,46 +32,148 @@ namespace SPIRV_CROSS_NAMESPACE
 {
 CFG::CFG(Compiler &compiler_, const SPIRFunction &func_)
     : compiler(compiler_)
-    , func(func_)
+    , func_id(func_.self)
 {
+	build_id_range();
 	build_post_order_visit_order();
+	build_edges();
 	build_immediate_dominators();
 }
 
-uint32_t CFG::find_common_dominator(uint32_t a, uint32_t b) const
+uint32_t CFG::intersect_dominators(uint32_t a, uint32_t b) const
 {
+	// Post-order indices of dominators are always higher than the blocks they dominate.
 	while (a != b)
 	{
-		if (get_visit_order(a) < get_visit_order(b))
-			a = get_immediate_dominator(a);
-		else
-			b = get_immediate_dominator(b);
+		while (a < b)
+			a = immediate_dominators[a];
+		while (b < a)
+			b = immediate_dominators[b];
 	}
 	return a;
 }
 
+uint32_t CFG::find_common_dominator(uint32_t a, uint32_t b) const
+{
+	uint32_t index_a = get_block_index(a);
+	uint32_t index_b = get_block_index(b);
+	assert(index_a != InvalidIndex && index_b != InvalidIndex);
+	if (index_a == InvalidIndex || index_b == InvalidIndex)
+		return 0;
+	return post_order[intersect_dominators(index_a, index_b)];
+}
+
+const SPIRFunction &CFG::get_function() const
+{
+	return compiler.get<SPIRFunction>(func_id);
+}
+
+void CFG::build_id_range()
+{
+	auto &func = get_function();
+	// Cover every block of the function and every branch target, so lookups never fall outside the range.
+	uint32_t lo = func.entry_block;
+	uint32_t hi = func.entry_block;
+	const auto expand = [&](uint32_t id) {
+		if (id)
+		{
+			lo = std::min(lo, id);
+			hi = std::max(hi, id);
+		}
+	};
+
+	for (auto block_id : func.blocks)
+	{
+		expand(block_id);
+		auto &block = compiler.get<SPIRBlock>(block_id);
+		expand(block.next_block);
+		expand(block.merge_block);
+		expand(block.true_block);
+		expand(block.false_block);
+		expand(block.default_block);
+		expand(block.continue_block);
+		if (block.terminator == SPIRBlock::MultiSelect)
+			for (auto &target : compiler.get_case_list(block))
+				expand(target.block);
+	}
+
+	id_base = lo;
+	size_t count = hi - lo + 1;
+	visit_order.resize(count);
+	for (auto &v : visit_order)
+		v = -1;
+	pending_preceding_edges.resize(count);
+	pending_succeeding_edges.resize(count);
+}
+
+void CFG::build_edges()
+{
+	// Flatten the edge lists into arrays indexed by post-order index.
+	size_t count = post_order.size();
+	preceding_offsets.reserve(count + 1);
+	succeeding_offsets.reserve(count + 1);
+
+	for (auto block : post_order)
+	{
+		preceding_offsets.push_back(uint32_t(preceding_edges.size()));
+		succeeding_offsets.push_back(uint32_t(succeeding_edges.size()));
+		for (auto edge : pending_preceding_edges[block - id_base])
+			preceding_edges.push_back(edge);
+		for (auto edge : pending_succeeding_edges[block - id_base])
+			succeeding_edges.push_back(edge);
+	}
+
+	preceding_offsets.push_back(uint32_t(preceding_edges.size()));
+	succeeding_offsets.push_back(uint32_t(succeeding_edges.size()));
+
+	pending_preceding_edges.clear();
+	pending_succeeding_edges.clear();
+}
+
 void CFG::build_immediate_dominators()
 {
-	// Traverse the post-order in reverse and build up the immediate dominator tree.
+	// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+	// Iterate over the blocks in reverse post-order until the dominator tree is stable.
+	// Back edges are never recorded in the CFG, so this converges on the first pass,
+	// and the second pass only confirms it.
+	size_t count = post_order.size();
 	immediate_dominators.clear();
-	immediate_dominators[func.entry_block] = func.entry_block;
+	immediate_dominators.resize(count);
+	for (auto &dom : immediate_dominators)
+		dom = InvalidIndex;
 
-	for (auto i = post_order.size(); i; i--)
-	{
-		uint32_t block = post_order[i - 1];
-		auto &pred = preceding_edges[block];
-		if (pred.empty()) // This is for the entry block, but we've already set up the dominators.
-			continue;
+	if (count == 0)
+		return;
 
-		for (auto &edge : pred)
+	uint32_t entry_index = uint32_t(count - 1);
+	immediate_dominators[entry_index] = entry_index;
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (uint32_t i = entry_index; i; i--)
 		{
-			if (immediate_dominators[block])
+			uint32_t index = i - 1;
+			uint32_t new_dominator = InvalidIndex;
+
+			for (auto edge : get_edges(preceding_offsets, preceding_edges, index))
 			{
-				assert(immediate_dominators[edge]);
-				immediate_dominators[block] = find_common_dominator(immediate_dominators[block], edge);
+				uint32_t pred = get_block_index(edge);
+				if (immediate_dominators[pred] == InvalidIndex)
+					continue;
+
+				if (new_dominator == InvalidIndex)
+					new_dominator = pred;
+				else
+					new_dominator = intersect_dominators(pred, new_dominator);
+			}
+
+			if (new_dominator != immediate_dominators[index])
+			{
+				immediate_dominators[index] = new_dominator;
+				changed = true;
 			}
-			else
-				immediate_dominators[block] = edge;
 		}
 	}
 }
@@ -80,15 +182,13 @@ bool CFG::is_back_edge(uint32_t to) const
 {
 	// We have a back edge if the visit order is set with the temporary magic value 0.
 	// Crossing edges will have already been recorded with a visit order.
-	auto itr = visit_order.find(to);
-	return itr != end(visit_order) && itr->second.get() == 0;
+	return visit_order[to - id_base] == 0;
 }
 
 bool CFG::has_visited_forward_edge(uint32_t to) const
 {
 	// If > 0, we have visited the edge already, and this is not a back edge branch.
-	auto itr = visit_order.find(to);
-	return itr != end(visit_order) && itr->second.get() > 0;
+	return visit_order[to - id_base] > 0;
 }
 
 bool CFG::post_order_visit(uint32_t block_id)
@@ -102,7 +202,7 @@ bool CFG::post_order_visit(uint32_t block_id)
 		return false;
 
 	// Block back-edges from recursively revisiting ourselves.
-	visit_order[block_id].get() = 0;
+	visit_order[block_id - id_base] = 0;
 
 	auto &block = compiler.get<SPIRBlock>(block_id);
 
@@ -167,14 +267,10 @@ bool CFG::post_order_visit(uint32_t block_id)
 		// all coming from same scope, so be more conservative in this case.
 		// Adding fake branches unconditionally breaks parameter preservation analysis,
 		// which looks at how variables are accessed through the CFG.
-		auto pred_itr = preceding_edges.find(block.next_block);
-		if (pred_itr != end(preceding_edges))
+		auto &pred = pending_preceding_edges[block.next_block - id_base];
+		if (!pred.empty())
 		{
-			auto &pred = pred_itr->second;
-			auto succ_itr = succeeding_edges.find(block_id);
-			size_t num_succeeding_edges = 0;
-			if (succ_itr != end(succeeding_edges))
-				num_succeeding_edges = succ_itr->second.size();
+			size_t num_succeeding_edges = pending_succeeding_edges[block_id - id_base].size();
 
 			if (block.terminator == SPIRBlock::MultiSelect && num_succeeding_edges == 1)
 			{
@@ -184,8 +280,7 @@ bool CFG::post_order_visit(uint32_t block_id)
 				// to have a dominator be inside the block.
 				// Only case this can go wrong is if we have 2 or more edges from block header and
 				// 2 or more edges to merge block, and still have dominator be inside a case label.
-				if (!pred.empty())
-					add_branch(block_id, block.next_block);
+				add_branch(block_id, block.next_block);
 			}
 			else
 			{
@@ -202,16 +297,15 @@ bool CFG::post_order_visit(uint32_t block_id)
 	}
 
 	// Then visit ourselves. Start counting at one, to let 0 be a magic value for testing back vs. crossing edges.
-	visit_order[block_id].get() = ++visit_count;
+	visit_order[block_id - id_base] = int(++visit_count);
 	post_order.push_back(block_id);
 	return true;
 }
 
 void CFG::build_post_order_visit_order()
 {
-	uint32_t block = func.entry_block;
+	uint32_t block = get_function().entry_block;
 	visit_count = 0;
-	visit_order.clear();
 	post_order.clear();
 	post_order_visit(block);
 }
@@ -223,18 +317,16 @@ void CFG::add_branch(uint32_t from, uint32_t to)
 		if (itr == end(l))
 			l.push_back(value);
 	};
-	add_unique(preceding_edges[to], from);
-	add_unique(succeeding_edges[from], to);
+	add_unique(pending_preceding_edges[to - id_base], from);
+	add_unique(pending_succeeding_edges[from - id_base], to);
 }
 
 uint32_t CFG::find_loop_dominator(uint32_t block_id) const
 {
 	while (block_id != SPIRBlock::NoDominator)
 	{
-		auto itr = preceding_edges.find(block_id);
-		if (itr == end(preceding_edges))
-			return SPIRBlock::NoDominator;
-		if (itr->second.empty())
+		auto preds = get_preceding_edges(block_id);
+		if (preds.empty())
 			return SPIRBlock::NoDominator;
 
 		uint32_t pred_block_id = SPIRBlock::NoDominator;
@@ -243,7 +335,7 @@ uint32_t CFG::find_loop_dominator(uint32_t block_id) const
 		// If we are a merge block, go directly to the header block.
 		// Only consider a loop dominator if we are branching from inside a block to a loop header.
 		// NOTE: In the CFG we forced an edge from header to merge block always to support variable scopes properly.
-		for (auto &pred : itr->second)
+		for (auto pred : preds)
 		{
 			auto &pred_block = compiler.get<SPIRBlock>(pred);
 			if (pred_block.merge == SPIRBlock::MergeLoop && pred_block.merge_block == ID(block_id))
@@ -262,7 +354,7 @@ uint32_t CFG::find_loop_dominator(uint32_t block_id) const
 		// No merge block means we can just pick any edge. Loop headers dominate the inner loop, so any path we
 		// take will lead there.
 		if (pred_block_id == SPIRBlock::NoDominator)
-			pred_block_id = itr->second.front();
+			pred_block_id = preds.front();
 
 		block_id = pred_block_id;
 
@@ -290,12 +382,12 @@ bool CFG::node_terminates_control_flow_in_sub_graph(BlockID from, BlockID to) co
 
 	while (to != from)
 	{
-		auto pred_itr = preceding_edges.find(to);
-		if (pred_itr == end(preceding_edges))
+		auto preds = get_preceding_edges(to);
+		if (preds.empty())
 			return false;
 
 		DominatorBuilder builder(*this);
-		for (auto &edge : pred_itr->second)
+		for (auto edge : preds)
 			builder.add_block(edge);
 
 		uint32_t dominator = builder.get_dominator();
@@ -45,65 +45,107 @@ public:
 		return compiler;
 	}
 
-	const SPIRFunction &get_function() const
+	const SPIRFunction &get_function() const;
+
+	// A view of the edges of one block, stored contiguously as block IDs.
+	struct EdgeRange
 	{
-		return func;
-	}
+		const uint32_t *begin() const
+		{
+			return first;
+		}
+
+		const uint32_t *end() const
+		{
+			return last;
+		}
+
+		size_t size() const
+		{
+			return size_t(last - first);
+		}
+
+		bool empty() const
+		{
+			return first == last;
+		}
+
+		uint32_t front() const
+		{
+			assert(!empty());
+			return *first;
+		}
+
+		const uint32_t *first;
+		const uint32_t *last;
+	};
 
 	uint32_t get_immediate_dominator(uint32_t block) const
 	{
-		auto itr = immediate_dominators.find(block);
-		if (itr != std::end(immediate_dominators))
-			return itr->second;
-		else
+		uint32_t index = get_block_index(block);
+		if (index == InvalidIndex)
 			return 0;
+		return post_order[immediate_dominators[index]];
 	}
 
 	bool is_reachable(uint32_t block) const
 	{
-		return visit_order.count(block) != 0;
+		return get_block_index(block) != InvalidIndex;
 	}
 
 	uint32_t get_visit_order(uint32_t block) const
 	{
-		auto itr = visit_order.find(block);
-		assert(itr != std::end(visit_order));
-		int v = itr->second.get();
-		assert(v > 0);
-		return uint32_t(v);
+		uint32_t index = get_block_index(block);
+		assert(index != InvalidIndex);
+		return index + 1;
 	}
 
 	uint32_t find_common_dominator(uint32_t a, uint32_t b) const;
 
-	const SmallVector<uint32_t> &get_preceding_edges(uint32_t block) const
+	EdgeRange get_preceding_edges(uint32_t block) const
 	{
-		auto itr = preceding_edges.find(block);
-		if (itr != std::end(preceding_edges))
-			return itr->second;
-		else
-			return empty_vector;
+		return get_edges(preceding_offsets, preceding_edges, get_block_index(block));
 	}
 
-	const SmallVector<uint32_t> &get_succeeding_edges(uint32_t block) const
+	EdgeRange get_succeeding_edges(uint32_t block) const
 	{
-		auto itr = succeeding_edges.find(block);
-		if (itr != std::end(succeeding_edges))
-			return itr->second;
-		else
-			return empty_vector;
+		return get_edges(succeeding_offsets, succeeding_edges, get_block_index(block));
 	}
 
+	// Calls op on every block reachable from block in depth-first order, visiting each block once.
+	// Successors of a block are only visited if op returns true.
 	template <typename Op>
-	void walk_from(std::unordered_set<uint32_t> &seen_blocks, uint32_t block, const Op &op) const
+	void walk_from(uint32_t block, const Op &op) const
 	{
-		if (seen_blocks.count(block))
+		uint32_t index = get_block_index(block);
+		if (index == InvalidIndex)
+		{
+			// Not part of the CFG, so there are no edges to follow.
+			op(block);
 			return;
-		seen_blocks.insert(block);
+		}
 
-		if (op(block))
+		SmallVector<uint64_t> seen_blocks;
+		seen_blocks.resize((post_order.size() + 63) / 64);
+		SmallVector<uint32_t> stack = { index };
+
+		while (!stack.empty())
 		{
-			for (auto b : get_succeeding_edges(block))
-				walk_from(seen_blocks, b, op);
+			index = stack.back();
+			stack.pop_back();
+
+			uint64_t mask = 1ull << (index & 63);
+			if (seen_blocks[index / 64] & mask)
+				continue;
+			seen_blocks[index / 64] |= mask;
+
+			if (!op(post_order[index]))
+				continue;
+
+			// Push in reverse so successors are visited in edge order.
+			auto succ = get_edges(succeeding_offsets, succeeding_edges, index);
+			for (auto itr = succ.end(); itr != succ.begin();)
+				stack.push_back(get_block_index(*--itr));
 		}
 	}
 
@@ -112,32 +154,58 @@ public:
 	bool node_terminates_control_flow_in_sub_graph(BlockID from, BlockID to) const;
 
 private:
-	struct VisitOrder
+	enum : uint32_t
 	{
-		int &get()
-		{
-			return v;
-		}
-
-		const int &get() const
-		{
-			return v;
-		}
-
-		int v = -1;
+		InvalidIndex = ~0u
 	};
 
 	Compiler &compiler;
-	const SPIRFunction &func;
-	std::unordered_map<uint32_t, SmallVector<uint32_t>> preceding_edges;
-	std::unordered_map<uint32_t, SmallVector<uint32_t>> succeeding_edges;
-	std::unordered_map<uint32_t, uint32_t> immediate_dominators;
-	std::unordered_map<uint32_t, VisitOrder> visit_order;
+	// Looked up on use rather than referenced, so the CFG stays valid when the compiler's IR is restored
+	// from the same module, see Compiler::reset_for_recompile().
+	uint32_t func_id;
+
+	// Reachable blocks are numbered densely by their post-order index, the visit order minus one.
+	// Block IDs of a function are allocated close together, so the lookup goes through a flat
+	// array covering the range of IDs used by the function.
+	uint32_t id_base = 0;
+	SmallVector<int> visit_order;
 	SmallVector<uint32_t> post_order;
-	SmallVector<uint32_t> empty_vector;
+
+	// Edges of block index i are edges[offsets[i]] up to edges[offsets[i + 1]].
+	SmallVector<uint32_t> preceding_offsets;
+	SmallVector<uint32_t> preceding_edges;
+	SmallVector<uint32_t> succeeding_offsets;
+	SmallVector<uint32_t> succeeding_edges;
+
+	// Indexed by post-order index, holds the post-order index of the immediate dominator.
+	SmallVector<uint32_t> immediate_dominators;
+
+	// Only used while building the CFG, indexed by ID relative to id_base.
+	SmallVector<SmallVector<uint32_t>> pending_preceding_edges;
+	SmallVector<SmallVector<uint32_t>> pending_succeeding_edges;
+
+	uint32_t get_block_index(uint32_t block) const
+	{
+		uint32_t slot = block - id_base;
+		if (slot >= visit_order.size() || visit_order[slot] <= 0)
+			return InvalidIndex;
+		return uint32_t(visit_order[slot] - 1);
+	}
+
+	static EdgeRange get_edges(const SmallVector<uint32_t> &offsets, const SmallVector<uint32_t> &edges,
+	                           uint32_t index)
+	{
+		if (index == InvalidIndex)
+			return { nullptr, nullptr };
+		return { edges.data() + offsets[index], edges.data() + offsets[index + 1] };
+	}
+
+	uint32_t intersect_dominators(uint32_t a, uint32_t b) const;
 
 	void add_branch(uint32_t from, uint32_t to);
+	void build_id_range();
 	void build_post_order_visit_order();
+	void build_edges();
 	void build_immediate_dominators();
 	bool post_order_visit(uint32_t block);
 	uint32_t visit_count = 0;
@@ -81,7 +81,7 @@ public:
 		if (bit < 64)
 			return (lower & (1ull << bit)) != 0;
 		else
-			return higher.count(bit) != 0;
+			return std::binary_search(std::begin(higher), std::end(higher), bit);
 	}
 
 	inline void set(uint32_t bit)
@@ -89,7 +89,11 @@ public:
 		if (bit < 64)
 			lower |= 1ull << bit;
 		else
-			higher.insert(bit);
+		{
+			auto itr = std::lower_bound(std::begin(higher), std::end(higher), bit);
+			if (itr == std::end(higher) || *itr != bit)
+				higher.insert(itr, bit);
+		}
 	}
 
 	inline void clear(uint32_t bit)
@@ -97,7 +101,11 @@ public:
 		if (bit < 64)
 			lower &= ~(1ull << bit);
 		else
-			higher.erase(bit);
+		{
+			auto itr = std::lower_bound(std::begin(higher), std::end(higher), bit);
+			if (itr != std::end(higher) && *itr == bit)
+				higher.erase(itr);
+		}
 	}
 
 	inline uint64_t get_lower() const
@@ -114,18 +122,24 @@ public:
 	inline void merge_and(const Bitset &other)
 	{
 		lower &= other.lower;
-		std::unordered_set<uint32_t> tmp_set;
+
+		// Both sides are sorted, so intersect in place.
+		size_t count = 0;
+		auto other_itr = std::begin(other.higher);
 		for (auto &v : higher)
-			if (other.higher.count(v) != 0)
-				tmp_set.insert(v);
-		higher = std::move(tmp_set);
+		{
+			other_itr = std::lower_bound(other_itr, std::end(other.higher), v);
+			if (other_itr != std::end(other.higher) && *other_itr == v)
+				higher[count++] = v;
+		}
+		higher.resize(count);
 	}
 
 	inline void merge_or(const Bitset &other)
 	{
 		lower |= other.lower;
 		for (auto &v : other.higher)
-			higher.insert(v);
+			set(v);
 	}
 
 	inline bool operator==(const Bitset &other) const
@@ -136,11 +150,7 @@ public:
 		if (higher.size() != other.higher.size())
 			return false;
 
-		for (auto &v : higher)
-			if (other.higher.count(v) == 0)
-				return false;
-
-		return true;
+		return std::equal(std::begin(higher), std::end(higher), std::begin(other.higher));
 	}
 
 	inline bool operator!=(const Bitset &other) const
@@ -158,18 +168,8 @@ public:
 				op(i);
 		}
 
-		if (higher.empty())
-			return;
-
-		// Need to enforce an order here for reproducible results,
-		// but hitting this path should happen extremely rarely, so having this slow path is fine.
-		SmallVector<uint32_t> bits;
-		bits.reserve(higher.size());
+		// Kept sorted, so the order is reproducible.
 		for (auto &v : higher)
-			bits.push_back(v);
-		std::sort(std::begin(bits), std::end(bits));
-
-		for (auto &v : bits)
 			op(v);
 	}
 
@@ -180,10 +180,98 @@ public:
 
 private:
 	// The most common bits to set are all lower than 64,
-	// so optimize for this case. Bits spilling outside 64 go into a slower data structure.
-	// In almost all cases, higher data structure will not be used.
+	// so optimize for this case. Bits spilling outside 64 go into a small sorted array,
+	// which lives inline for the handful of high decorations and builtins a typical ID carries,
+	// so neither lookups nor copies hash or allocate.
 	uint64_t lower = 0;
-	std::unordered_set<uint32_t> higher;
+	SmallVector<uint32_t, 4> higher;
+};
+
+// A fixed universe of bits, such as the blocks of a function, stored as plain words.
+// Set operations are straight loops over the words, which compilers vectorize,
+// and which makes it suitable for dataflow over many sets at once.
+// The set grows as bits are set, and missing words read as zero.
+class DenseBitset
+{
+public:
+	inline bool get(uint32_t bit) const
+	{
+		uint32_t word = bit / 64;
+		return word < words.size() && (words[word] & (1ull << (bit & 63))) != 0;
+	}
+
+	inline void set(uint32_t bit)
+	{
+		uint32_t word = bit / 64;
+		if (word >= words.size())
+			words.resize(word + 1);
+		words[word] |= 1ull << (bit & 63);
+	}
+
+	// Returns true if any bits were added.
+	inline bool merge_or(const DenseBitset &other)
+	{
+		if (other.words.size() > words.size())
+			words.resize(other.words.size());
+
+		uint64_t changed = 0;
+		for (size_t i = 0; i < other.words.size(); i++)
+		{
+			uint64_t merged = words[i] | other.words[i];
+			changed |= merged ^ words[i];
+			words[i] = merged;
+		}
+		return changed != 0;
+	}
+
+	inline void merge_and_not(const DenseBitset &other)
+	{
+		size_t count = std::min(words.size(), other.words.size());
+		for (size_t i = 0; i < count; i++)
+			words[i] &= ~other.words[i];
+	}
+
+	inline bool intersects(const DenseBitset &other) const
+	{
+		size_t count = std::min(words.size(), other.words.size());
+		uint64_t common = 0;
+		for (size_t i = 0; i < count; i++)
+			common |= words[i] & other.words[i];
+		return common != 0;
+	}
+
+	inline uint32_t count() const
+	{
+		uint32_t bits = 0;
+		for (auto w : words)
+			for (; w; w &= w - 1)
+				bits++;
+		return bits;
+	}
+
+	inline bool empty() const
+	{
+		for (auto w : words)
+			if (w)
+				return false;
+		return true;
+	}
+
+	// Bits are visited in increasing order.
+	template <typename Op>
+	void for_each_bit(const Op &op) const
+	{
+		for (size_t i = 0; i < words.size(); i++)
+		{
+			uint64_t w = words[i];
+			for (uint32_t bit = 0; w; bit++, w >>= 1)
+				if (w & 1)
+					op(uint32_t(i * 64 + bit));
+		}
+	}
+
+private:
+	SmallVector<uint64_t, 2> words;
 };
 
 // Helper template to avoid lots of nasty string temporary munging.
@@ -295,6 +383,72 @@ inline std::string convert_to_string(double t, char locale_radix_point)
 	return buf;
 }
 
+// A set of names in use. For each base name which had to be made unique, it also remembers how many
+// suffixes are known to be taken, so resolving many collisions on one name does not probe every suffix again.
+// Names are never removed except by clear(), so the count stays valid.
+class NameCache
+{
+public:
+	using const_iterator = std::unordered_set<std::string>::const_iterator;
+
+	std::pair<const_iterator, bool> insert(const std::string &name)
+	{
+		return names.insert(name);
+	}
+
+	template <typename Iterator>
+	void insert(Iterator first, Iterator last)
+	{
+		names.insert(first, last);
+	}
+
+	const_iterator find(const std::string &name) const
+	{
+		return names.find(name);
+	}
+
+	size_t count(const std::string &name) const
+	{
+		return names.count(name);
+	}
+
+	const_iterator begin() const
+	{
+		return names.begin();
+	}
+
+	const_iterator end() const
+	{
+		return names.end();
+	}
+
+	bool empty() const
+	{
+		return names.empty();
+	}
+
+	size_t size() const
+	{
+		return names.size();
+	}
+
+	void clear()
+	{
+		names.clear();
+		taken_suffixes.clear();
+	}
+
+	// Suffixes 1 through the returned count of base are all in the set.
+	uint32_t &taken_suffix_count(const std::string &base)
+	{
+		return taken_suffixes[base];
+	}
+
+private:
+	std::unordered_set<std::string> names;
+	std::unordered_map<std::string, uint32_t> taken_suffixes;
+};
+
 template <typename T>
 struct ValueSaver
 {
@@ -324,14 +478,15 @@ struct ValueSaver
 #pragma warning(pop)
 #endif
 
+// Kept at 8 bytes since blocks store one per instruction and are walked by every pass.
+// The word count is implied by length, which fits in 16 bits like the SPIR-V word count it comes from.
 struct Instruction
 {
 	uint16_t op = 0;
-	uint16_t count = 0;
+	uint16_t length = 0;
 	// If offset is 0 (not a valid offset into the instruction stream),
 	// we have an instruction stream which is embedded in the object.
 	uint32_t offset = 0;
-	uint32_t length = 0;
 
 	inline bool is_embedded() const
 	{
@@ -438,24 +593,19 @@ using BlockID = TypedID<TypeBlock>;
 using ID = TypedID<TypeNone>;
 
 // Helper for Variant interface.
+// Not polymorphic. Objects are always destroyed and copied through their typed ObjectPool,
+// which Variant selects from its Types tag, so no vtable pointer is stored per object.
 struct IVariant
 {
-	virtual ~IVariant() = default;
-	virtual IVariant *clone(ObjectPoolBase *pool) = 0;
 	ID self = 0;
 
 protected:
 	IVariant() = default;
+	~IVariant() = default;
 	IVariant(const IVariant&) = default;
 	IVariant &operator=(const IVariant&) = default;
 };
 
-#define SPIRV_CROSS_DECLARE_CLONE(T)                                \
-	IVariant *clone(ObjectPoolBase *pool) override                  \
-	{                                                               \
-		return static_cast<ObjectPool<T> *>(pool)->allocate(*this); \
-	}
-
 struct SPIRUndef : IVariant
 {
 	enum
@@ -468,8 +618,6 @@ struct SPIRUndef : IVariant
 	{
 	}
 	TypeID basetype;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRUndef)
 };
 
 struct SPIRString : IVariant
@@ -485,8 +633,6 @@ struct SPIRString : IVariant
 	}
 
 	std::string str;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRString)
 };
 
 // This type is only used by backends which need to access the combined image and sampler IDs separately after
@@ -506,8 +652,6 @@ struct SPIRCombinedImageSampler : IVariant
 	TypeID combined_type;
 	VariableID image;
 	VariableID sampler;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRCombinedImageSampler)
 };
 
 struct SPIRConstantOp : IVariant
@@ -529,8 +673,6 @@ struct SPIRConstantOp : IVariant
 	spv::Op opcode;
 	SmallVector<uint32_t> arguments;
 	TypeID basetype;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRConstantOp)
 };
 
 struct SPIRType : IVariant
@@ -622,9 +764,7 @@ struct SPIRType : IVariant
 	TypeID parent_type = 0;
 
 	// Used in backends to avoid emitting members with conflicting names.
-	std::unordered_set<std::string> member_name_cache;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRType)
+	NameCache member_name_cache;
 };
 
 struct SPIRExtension : IVariant
@@ -654,7 +794,6 @@ struct SPIRExtension : IVariant
 	}
 
 	Extension ext;
-	SPIRV_CROSS_DECLARE_CLONE(SPIRExtension)
 };
 
 // SPIREntryPoint is not a variant since its IDs are used to decorate OpFunction,
@@ -741,8 +880,6 @@ struct SPIRExpression : IVariant
 
 	// The expression was emitted at a certain scope. Lets us track when an expression read means multiple reads.
 	uint32_t emitted_loop_level = 0;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRExpression)
 };
 
 struct SPIRFunctionPrototype : IVariant
@@ -759,8 +896,6 @@ struct SPIRFunctionPrototype : IVariant
 
 	TypeID return_type;
 	SmallVector<uint32_t> parameter_types;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRFunctionPrototype)
 };
 
 struct SPIRBlock : IVariant
@@ -911,8 +1046,6 @@ struct SPIRBlock : IVariant
 	// sub-group-like operations.
 	// Make sure that we only use these expressions in the original block.
 	SmallVector<ID> invalidate_expressions;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRBlock)
 };
 
 struct SPIRFunction : IVariant
@@ -1012,8 +1145,6 @@ struct SPIRFunction : IVariant
 	bool active = false;
 	bool flush_undeclared = true;
 	bool do_combined_parameters = true;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRFunction)
 };
 
 struct SPIRAccessChain : IVariant
@@ -1053,8 +1184,6 @@ struct SPIRAccessChain : IVariant
 	// By reading this expression, we implicitly read these expressions as well.
 	// Used by access chain Store and Load since we read multiple expressions in this case.
 	SmallVector<ID> implied_read_expressions;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRAccessChain)
 };
 
 struct SPIRVariable : IVariant
@@ -1111,8 +1240,6 @@ struct SPIRVariable : IVariant
 	bool loop_variable_enable = false;
 
 	SPIRFunction::Parameter *parameter = nullptr;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRVariable)
 };
 
 struct SPIRConstant : IVariant
@@ -1206,6 +1333,50 @@ struct SPIRConstant : IVariant
 		return u.f32;
 	}
 
+	// Rounds to nearest even, like OpFConvert.
+	static inline uint16_t f32_to_f16(float f32_value)
+	{
+		union
+		{
+			float f32;
+			uint32_t u32;
+		} u;
+		u.f32 = f32_value;
+
+		uint32_t s = (u.u32 >> 16) & 0x8000u;
+		int e = int((u.u32 >> 23) & 0xff) - 127 + 15;
+		uint32_t m = u.u32 & 0x7fffffu;
+
+		// Inf and NaN.
+		if (((u.u32 >> 23) & 0xff) == 0xff)
+			return uint16_t(s | 0x7c00u | (m ? 0x200u : 0u));
+
+		if (e >= 31)
+			return uint16_t(s | 0x7c00u);
+
+		if (e <= 0)
+		{
+			// Denormal, or flushed to zero.
+			if (e < -10)
+				return uint16_t(s);
+			m |= 0x800000u;
+			uint32_t shift = uint32_t(14 - e);
+			uint32_t h = m >> shift;
+			uint32_t rem = m & ((1u << shift) - 1);
+			uint32_t halfway = 1u << (shift - 1);
+			if (rem > halfway || (rem == halfway && (h & 1)))
+				h++;
+			return uint16_t(s | h);
+		}
+
+		// A carry out of the mantissa correctly bumps the exponent, up to infinity.
+		uint32_t h = s | (uint32_t(e) << 10) | (m >> 13);
+		uint32_t rem = m & 0x1fffu;
+		if (rem > 0x1000u || (rem == 0x1000u && (h & 1)))
+			h++;
+		return uint16_t(h);
+	}
+
 	inline uint32_t specialization_constant_id(uint32_t col, uint32_t row) const
 	{
 		return m.c[col].id[row];
@@ -1398,8 +1569,6 @@ struct SPIRConstant : IVariant
 	// to still be able to specialize the value by supplying corresponding
 	// preprocessor directives before compiling the shader.
 	std::string specialization_constant_macro_name;
-
-	SPIRV_CROSS_DECLARE_CLONE(SPIRConstant)
 };
 
 // Variants have a very specific allocation scheme.
@@ -1461,13 +1630,16 @@ public:
 #endif
 		if (this != &other)
 		{
-			if (holder)
-				group->pools[type]->deallocate_opaque(holder);
-
-			if (other.holder)
-				holder = other.holder->clone(group->pools[other.type].get());
+			// Copying over an object of the same type reuses its storage, e.g. when Compiler::reset_for_recompile()
+			// restores the IR.
+			if (holder && other.holder && type == other.type)
+				assign_holder(holder, other.holder, type);
 			else
-				holder = nullptr;
+			{
+				if (holder)
+					group->pools[type]->deallocate_opaque(holder);
+				holder = other.holder ? clone_holder(other.holder, other.type) : nullptr;
+			}
 
 			type = other.type;
 			allow_type_rewrite = other.allow_type_rewrite;
@@ -1550,6 +1722,88 @@ public:
 	}
 
 private:
+	template <typename T>
+	IVariant *clone_as(const IVariant *src)
+	{
+		return static_cast<ObjectPool<T> &>(*group->pools[T::type]).allocate(*static_cast<const T *>(src));
+	}
+
+	IVariant *clone_holder(const IVariant *src, Types src_type)
+	{
+		switch (src_type)
+		{
+		case TypeType:
+			return clone_as<SPIRType>(src);
+		case TypeVariable:
+			return clone_as<SPIRVariable>(src);
+		case TypeConstant:
+			return clone_as<SPIRConstant>(src);
+		case TypeFunction:
+			return clone_as<SPIRFunction>(src);
+		case TypeFunctionPrototype:
+			return clone_as<SPIRFunctionPrototype>(src);
+		case TypeBlock:
+			return clone_as<SPIRBlock>(src);
+		case TypeExtension:
+			return clone_as<SPIRExtension>(src);
+		case TypeExpression:
+			return clone_as<SPIRExpression>(src);
+		case TypeConstantOp:
+			return clone_as<SPIRConstantOp>(src);
+		case TypeCombinedImageSampler:
+			return clone_as<SPIRCombinedImageSampler>(src);
+		case TypeAccessChain:
+			return clone_as<SPIRAccessChain>(src);
+		case TypeUndef:
+			return clone_as<SPIRUndef>(src);
+		case TypeString:
+			return clone_as<SPIRString>(src);
+		default:
+			SPIRV_CROSS_THROW("Cannot clone variant of unknown type.");
+		}
+	}
+
+	template <typename T>
+	static void assign_as(IVariant *dst, const IVariant *src)
+	{
+		*static_cast<T *>(dst) = *static_cast<const T *>(src);
+	}
+
+	static void assign_holder(IVariant *dst, const IVariant *src, Types src_type)
+	{
+		switch (src_type)
+		{
+		case TypeType:
+			return assign_as<SPIRType>(dst, src);
+		case TypeVariable:
+			return assign_as<SPIRVariable>(dst, src);
+		case TypeConstant:
+			return assign_as<SPIRConstant>(dst, src);
+		case TypeFunction:
+			return assign_as<SPIRFunction>(dst, src);
+		case TypeFunctionPrototype:
+			return assign_as<SPIRFunctionPrototype>(dst, src);
+		case TypeBlock:
+			return assign_as<SPIRBlock>(dst, src);
+		case TypeExtension:
+			return assign_as<SPIRExtension>(dst, src);
+		case TypeExpression:
+			return assign_as<SPIRExpression>(dst, src);
+		case TypeConstantOp:
+			return assign_as<SPIRConstantOp>(dst, src);
+		case TypeCombinedImageSampler:
+			return assign_as<SPIRCombinedImageSampler>(dst, src);
+		case TypeAccessChain:
+			return assign_as<SPIRAccessChain>(dst, src);
+		case TypeUndef:
+			return assign_as<SPIRUndef>(dst, src);
+		case TypeString:
+			return assign_as<SPIRString>(dst, src);
+		default:
+			SPIRV_CROSS_THROW("Cannot copy variant of unknown type.");
+		}
+	}
+
 	ObjectPoolGroup *group = nullptr;
 	IVariant *holder = nullptr;
 	Types type = TypeNone;
@@ -309,8 +309,18 @@ void CompilerCPP::emit_resources()
 		statement("");
 }
 
+void CompilerCPP::reset_for_recompile()
+{
+	CompilerCPP fresh{ ParsedIR() };
+	fresh.options = options;
+	fresh.keep_state_for_recompile(*this);
+	*this = std::move(fresh);
+}
+
 string CompilerCPP::compile()
 {
+	CompileBudgetTracker::Scope budget_scope(compile_budget);
+	save_recompile_snapshot();
 	ir.fixup_reserved_names();
 
 	// Do not deal with ES-isms like precision, older extensions and such.
@@ -328,11 +338,17 @@ string CompilerCPP::compile()
 	backend.explicit_struct_type = true;
 	backend.use_initializer_list = true;
 
-	fixup_type_alias();
-	reorder_type_alias();
-	build_function_control_flow_graphs_and_analyze();
-	update_active_builtins();
-
+	profile_pass("specialize_constants", [&] { specialize_constants(); });
+	profile_pass("fixup_type_alias", [&] { fixup_type_alias(); });
+	profile_pass("reorder_type_alias", [&] { reorder_type_alias(); });
+	if (options.common_subexpression_min_cost)
+		profile_pass("eliminate_common_subexpressions",
+		             [&] { eliminate_common_subexpressions(options.common_subexpression_min_cost); });
+	profile_pass("build_function_control_flow_graphs_and_analyze",
+	             [&] { build_function_control_flow_graphs_and_analyze(); });
+	profile_pass("update_active_builtins", [&] { update_active_builtins(); });
+
+	PassProfiler emit_profiler(*this, "emit");
 	uint32_t pass_count = 0;
 	do
 	{
@@ -349,6 +365,7 @@ string CompilerCPP::compile()
 
 		pass_count++;
 	} while (is_forcing_recompilation());
+	emit_profiler.finish(pass_count);
 
 	// Match opening scope of emit_header().
 	end_scope_decl();
@@ -361,7 +378,7 @@ string CompilerCPP::compile()
 	// Entry point in CPP is always main() for the time being.
 	get_entry_point().name = "main";
 
-	return buffer.str();
+	return finish_output(buffer);
 }
 
 void CompilerCPP::emit_c_linkage()
@@ -53,6 +53,7 @@ public:
 	}
 
 	std::string compile() override;
+	void reset_for_recompile() override;
 
 	// Sets a custom symbol name that can override
 	// spirv_cross_get_interface.
@@ -65,6 +66,9 @@ public:
 	}
 
 private:
+	// Only move-assigned by reset_for_recompile().
+	CompilerCPP &operator=(CompilerCPP &&other) = default;
+
 	void emit_header() override;
 	void emit_c_linkage();
 	void emit_function_prototype(SPIRFunction &func, const Bitset &return_flags) override;
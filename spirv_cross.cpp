@@ -27,7 +27,9 @@
 #include "spirv_common.hpp"
 #include "spirv_parser.hpp"
 #include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <set>
 #include <utility>
 
 using namespace std;
@@ -75,6 +77,316 @@ string Compiler::compile()
 	return "";
 }
 
+void Compiler::compile_to(OutputSink &sink)
+{
+	ValueSaver<OutputSink *> sink_saver(output_sink);
+	output_sink = &sink;
+	auto source = compile();
+
+	// Backends which do not emit through finish_output() return their output as usual.
+	if (output_sink)
+	{
+		output_sink = nullptr;
+		sink.write(source.data(), source.size());
+	}
+}
+
+SmallVector<string> Compiler::compile_all_entry_points(const std::function<void(const EntryPoint &entry)> &setup,
+                                                       SmallVector<ResourceCostReport> *reports)
+{
+	SmallVector<string> sources;
+	compile_all_entry_points_to(setup, [&](const EntryPoint &, string &source) {
+		sources.push_back(std::move(source));
+		if (reports)
+			reports->push_back(get_resource_cost_report());
+	});
+	return sources;
+}
+
+void Compiler::compile_all_entry_points_to(const std::function<void(const EntryPoint &entry)> &setup,
+                                           const std::function<void(const EntryPoint &entry, string &source)> &output)
+{
+	auto entry_points = get_entry_points_and_stages();
+
+	// Every entry point starts from the IR saved by the first compile(), which also keeps the CFGs between them.
+	bool first = true;
+	for (auto &entry : entry_points)
+	{
+		if (!first)
+			reset_for_recompile();
+		first = false;
+		set_entry_point(entry.name, entry.execution_model);
+		if (setup)
+			setup(entry);
+		auto source = compile();
+		output(entry, source);
+	}
+}
+
+ResourceCostReport Compiler::get_resource_cost_report() const
+{
+	ResourceCostReport report;
+	get_module_resource_costs(ir.default_entry_point, report);
+	report.hoisted_temporary_count = uint32_t(hoisted_temporaries.size());
+	report.forced_temporary_count = uint32_t(forced_temporaries.size());
+	append_backend_resource_costs(report);
+	return report;
+}
+
+const SmallVector<DescriptorHeapSlot> &Compiler::get_descriptor_heap_slots() const
+{
+	return descriptor_heap_slots;
+}
+
+const SmallVector<LoweredLUT> &Compiler::get_lowered_luts() const
+{
+	return lowered_luts;
+}
+
+VariableID Compiler::add_uint_block_variable(const string &name, const SmallVector<string> &member_names,
+                                             StorageClass storage)
+{
+	uint32_t offset = ir.increase_bound_by(4);
+
+	uint32_t uint_type_id = offset;
+	uint32_t block_type_id = offset + 1;
+	uint32_t block_pointer_type_id = offset + 2;
+	uint32_t variable_id = offset + 3;
+
+	SPIRType uint_type;
+	uint_type.basetype = SPIRType::UInt;
+	uint_type.width = 32;
+	set<SPIRType>(uint_type_id, uint_type);
+
+	SPIRType block_type;
+	block_type.basetype = SPIRType::Struct;
+	set<SPIRType>(block_type_id, block_type);
+	set_decoration(block_type_id, DecorationBlock);
+	ir.meta[block_type_id].decoration.alias = join(name, "_Block");
+	for (uint32_t i = 0; i < uint32_t(member_names.size()); i++)
+	{
+		get<SPIRType>(block_type_id).member_types.push_back(uint_type_id);
+		set_member_decoration(block_type_id, i, DecorationOffset, i * 4);
+		// Bypass set_member_name() so the names are not sanitized on a later compile.
+		ir.meta[block_type_id].members[i].alias = member_names[i];
+	}
+
+	SPIRType block_pointer_type = get<SPIRType>(block_type_id);
+	block_pointer_type.pointer = true;
+	block_pointer_type.storage = storage;
+	block_pointer_type.parent_type = block_type_id;
+	auto &ptr_type = set<SPIRType>(block_pointer_type_id, block_pointer_type);
+
+	// Preserve self.
+	ptr_type.self = block_type_id;
+
+	set<SPIRVariable>(variable_id, block_pointer_type_id, storage);
+	ir.meta[variable_id].decoration.alias = name;
+	add_active_interface_variable(variable_id);
+	return variable_id;
+}
+
+void Compiler::get_module_resource_costs(FunctionID entry_point, ResourceCostReport &report) const
+{
+	unordered_set<uint32_t> referenced;
+	ReachableIDsHandler handler(referenced);
+	traverse_all_reachable_opcodes(get<SPIRFunction>(entry_point), handler);
+	referenced.insert(entry_point);
+
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t self, const SPIRFunction &func) {
+		if (!referenced.count(self))
+			return;
+
+		for (auto block : func.blocks)
+			if (get<SPIRBlock>(block).merge == SPIRBlock::MergeLoop)
+				report.loop_count++;
+	});
+
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t self, const SPIRVariable &var) {
+		if (!referenced.count(self))
+			return;
+
+		auto &type = get_variable_data_type(var);
+		if (var.storage == StorageClassWorkgroup)
+			report.workgroup_memory_size += get_estimated_type_size(type);
+		else if ((var.storage == StorageClassFunction || var.storage == StorageClassPrivate) && !type.array.empty())
+			report.local_array_size += get_estimated_type_size(type);
+	});
+}
+
+Compiler::MemoryStatistics Compiler::get_memory_statistics() const
+{
+	MemoryStatistics stats;
+	static_cast<IRMemoryStatistics &>(stats) = ir.get_memory_statistics();
+	stats.output_block_count = get_output_block_count();
+	return stats;
+}
+
+void Compiler::append_backend_resource_costs(ResourceCostReport &) const
+{
+}
+
+void Compiler::append_polyfill_costs(ResourceCostReport &report, uint32_t polyfills, uint32_t relaxed_polyfills)
+{
+	// In the order of the Polyfill bits.
+	static const char *const polyfill_names[] = {
+		"Transpose2x2",   "Transpose3x3",     "Transpose4x4",     "Determinant2x2",   "Determinant3x3",
+		"Determinant4x4", "MatrixInverse2x2", "MatrixInverse3x3", "MatrixInverse4x4",
+	};
+
+	for (uint32_t i = 0; i < uint32_t(sizeof(polyfill_names) / sizeof(polyfill_names[0])); i++)
+	{
+		if (polyfills & (1u << i))
+			report.helper_functions.push_back(polyfill_names[i]);
+		if (relaxed_polyfills & (1u << i))
+			report.helper_functions.push_back(join(polyfill_names[i], "Relaxed"));
+	}
+}
+
+uint32_t Compiler::get_estimated_type_size(const SPIRType &type) const
+{
+	uint32_t size, alignment;
+	get_estimated_type_layout(type, size, alignment);
+	return size;
+}
+
+void Compiler::get_estimated_type_layout(const SPIRType &type, uint32_t &size, uint32_t &alignment) const
+{
+	if (type_is_top_level_pointer(type))
+	{
+		size = 8;
+		alignment = 8;
+	}
+	else if (!type.array.empty())
+	{
+		get_estimated_type_layout(get<SPIRType>(type.parent_type), size, alignment);
+		uint32_t array_size =
+		    type.array_size_literal.back() ? type.array.back() : evaluate_constant_u32(type.array.back());
+		size = ((size + alignment - 1) & ~(alignment - 1)) * array_size;
+	}
+	else if (type.basetype == SPIRType::Struct)
+	{
+		size = 0;
+		alignment = 1;
+		for (auto &member : type.member_types)
+		{
+			uint32_t member_size, member_alignment;
+			get_estimated_type_layout(get<SPIRType>(member), member_size, member_alignment);
+			size = ((size + member_alignment - 1) & ~(member_alignment - 1)) + member_size;
+			alignment = max(alignment, member_alignment);
+		}
+		size = (size + alignment - 1) & ~(alignment - 1);
+	}
+	else if (type_is_opaque_value(type) || type.basetype == SPIRType::Void)
+	{
+		size = 0;
+		alignment = 1;
+	}
+	else
+	{
+		// Booleans have no defined size, assume they are stored as 32-bit.
+		uint32_t scalar_size = type.basetype == SPIRType::Boolean ? 4 : max(type.width / 8, 1u);
+		alignment = scalar_size * (type.vecsize == 3 ? 4 : type.vecsize);
+		size = alignment * type.columns;
+	}
+}
+
+string Compiler::finish_output(const StringStream<> &stream)
+{
+	if (!output_sink)
+		return stream.str();
+
+	auto *sink = output_sink;
+	output_sink = nullptr;
+	stream.for_each_chunk([sink](const char *data, size_t size) { sink->write(data, size); });
+	return "";
+}
+
+string Compiler::finish_output(string source)
+{
+	if (!output_sink)
+		return source;
+
+	auto *sink = output_sink;
+	output_sink = nullptr;
+	sink->write(source.data(), source.size());
+	return "";
+}
+
+void Compiler::reset_for_recompile()
+{
+	Compiler fresh{ ParsedIR() };
+	fresh.keep_state_for_recompile(*this);
+	*this = std::move(fresh);
+}
+
+void Compiler::reset_for_hot_reload(const ParsedIR &ir_)
+{
+	hot_reload_ir = &ir_;
+	reset_for_recompile();
+}
+
+void Compiler::save_recompile_snapshot()
+{
+	if (!recompile_snapshot)
+		recompile_snapshot.reset(new ParsedIR(ir));
+}
+
+void Compiler::keep_state_for_recompile(Compiler &previous)
+{
+	profile_callback = std::move(previous.profile_callback);
+	task_runner = std::move(previous.task_runner);
+	compile_budget = previous.compile_budget;
+
+	auto *hot_reload_source = previous.hot_reload_ir;
+	previous.hot_reload_ir = nullptr;
+
+	// A function parses to the same IR as long as it and the global section keep their words.
+	if (hot_reload_source)
+	{
+		auto &previous_spirv = previous.recompile_snapshot ? previous.recompile_snapshot->spirv : previous.ir.spirv;
+		SPIRVModuleDiff diff;
+		if (diff_spirv_modules(previous_spirv, hot_reload_source->spirv, diff))
+			for (size_t i = 0; i < diff.functions.size(); i++)
+				if (diff.previous_begin[i] != 0)
+					hot_reload_unchanged_functions.insert(diff.functions[i].id);
+	}
+
+	// Copying into the objects the previous compile() worked on reuses their storage.
+	// The next compile() saves the hot reloaded module.
+	ir = std::move(previous.ir);
+	if (hot_reload_source)
+		ir = *hot_reload_source;
+	else if (previous.recompile_snapshot)
+	{
+		recompile_snapshot = std::move(previous.recompile_snapshot);
+		ir = *recompile_snapshot;
+	}
+	parse_fixup();
+
+	// The CFGs reference the previous compiler, which is the object this state is moved into.
+	// They were built from the saved IR, or from the IR before the first compile(), which has the same control flow.
+	// Compilation only alters control flow when specializing constants, otherwise they still describe the restored IR.
+	if (previous.specialized_control_flow)
+		return;
+
+	if (hot_reload_source)
+	{
+		for (auto id : hot_reload_unchanged_functions)
+		{
+			auto itr = previous.function_cfgs.find(id);
+			if (itr != end(previous.function_cfgs))
+				function_cfgs[id] = std::move(itr->second);
+		}
+	}
+	else
+	{
+		function_cfgs = std::move(previous.function_cfgs);
+		found_active_builtins = previous.found_active_builtins;
+		found_active_builtins.reusable = true;
+	}
+}
+
 bool Compiler::variable_storage_is_aliased(const SPIRVariable &v)
 {
 	auto &type = get<SPIRType>(v.basetype);
@@ -246,6 +558,10 @@ string Compiler::to_name(uint32_t id, bool allow_alias) const
 
 bool Compiler::function_is_pure(const SPIRFunction &func)
 {
+	auto reused_itr = reused_functions.find(func.self);
+	if (reused_itr != end(reused_functions))
+		return reused_itr->second.pure;
+
 	for (auto block : func.blocks)
 	{
 		if (!block_is_pure(get<SPIRBlock>(block)))
@@ -259,7 +575,7 @@ bool Compiler::function_is_pure(const SPIRFunction &func)
 	return true;
 }
 
-void Compiler::register_global_read_dependencies(const SPIRBlock &block, uint32_t id)
+void Compiler::collect_global_reads(const SPIRBlock &block, SmallVector<VariableID> &reads)
 {
 	for (auto &i : block.ops)
 	{
@@ -271,7 +587,7 @@ void Compiler::register_global_read_dependencies(const SPIRBlock &block, uint32_
 		case OpFunctionCall:
 		{
 			uint32_t func = ops[2];
-			register_global_read_dependencies(get<SPIRFunction>(func), id);
+			collect_global_reads(get<SPIRFunction>(func), reads);
 			break;
 		}
 
@@ -286,7 +602,7 @@ void Compiler::register_global_read_dependencies(const SPIRBlock &block, uint32_
 
 				// InputTargets are immutable.
 				if (type.basetype != SPIRType::Image && type.image.dim != DimSubpassData)
-					var->dependees.push_back(id);
+					reads.push_back(var->self);
 			}
 			break;
 		}
@@ -297,10 +613,26 @@ void Compiler::register_global_read_dependencies(const SPIRBlock &block, uint32_
 	}
 }
 
-void Compiler::register_global_read_dependencies(const SPIRFunction &func, uint32_t id)
+void Compiler::collect_global_reads(const SPIRFunction &func, SmallVector<VariableID> &reads)
 {
+	auto reused_itr = reused_functions.find(func.self);
+	if (reused_itr != end(reused_functions))
+	{
+		auto &reused_reads = reused_itr->second.global_reads;
+		reads.insert(reads.end(), reused_reads.begin(), reused_reads.end());
+		return;
+	}
+
 	for (auto block : func.blocks)
-		register_global_read_dependencies(get<SPIRBlock>(block), id);
+		collect_global_reads(get<SPIRBlock>(block), reads);
+}
+
+void Compiler::register_global_read_dependencies(const SPIRFunction &func, uint32_t id)
+{
+	SmallVector<VariableID> reads;
+	collect_global_reads(func, reads);
+	for (auto var : reads)
+		get<SPIRVariable>(var).dependees.push_back(id);
 }
 
 SPIRVariable *Compiler::maybe_get_backing_variable(uint32_t chain)
@@ -583,13 +915,25 @@ bool Compiler::is_builtin_type(const SPIRType &type) const
 }
 
 bool Compiler::is_builtin_variable(const SPIRVariable &var) const
+{
+	return is_builtin_variable(ir, var);
+}
+
+bool Compiler::is_builtin_variable(const ParsedIR &ir, const SPIRVariable &var)
 {
 	auto *m = ir.find_meta(var.self);
 
 	if (var.compat_builtin || (m && m->decoration.builtin))
 		return true;
-	else
-		return is_builtin_type(get<SPIRType>(var.basetype));
+
+	// We can have builtin structs as well. If one member of a struct is builtin, the struct must also be builtin.
+	auto *type_meta = ir.find_meta(ir.get<SPIRType>(var.basetype).self);
+	if (type_meta)
+		for (auto &memb : type_meta->members)
+			if (memb.builtin)
+				return true;
+
+	return false;
 }
 
 bool Compiler::is_member_builtin(const SPIRType &type, uint32_t index, BuiltIn *builtin) const
@@ -667,7 +1011,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 		args += 3;
 		for (uint32_t i = 0; i < count; i++)
 		{
-			auto *var = compiler.maybe_get<SPIRVariable>(args[i]);
+			auto *var = ir.maybe_get<SPIRVariable>(args[i]);
 			if (var && storage_class_is_interface(var->storage))
 				variables.insert(args[i]);
 		}
@@ -684,7 +1028,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 		args += 3;
 		for (uint32_t i = 0; i < count; i++)
 		{
-			auto *var = compiler.maybe_get<SPIRVariable>(args[i]);
+			auto *var = ir.maybe_get<SPIRVariable>(args[i]);
 			if (var && storage_class_is_interface(var->storage))
 				variables.insert(args[i]);
 		}
@@ -701,7 +1045,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 		args += 2;
 		for (uint32_t i = 0; i < count; i += 2)
 		{
-			auto *var = compiler.maybe_get<SPIRVariable>(args[i]);
+			auto *var = ir.maybe_get<SPIRVariable>(args[i]);
 			if (var && storage_class_is_interface(var->storage))
 				variables.insert(args[i]);
 		}
@@ -721,11 +1065,11 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 		if (length < 2)
 			return false;
 
-		auto *var = compiler.maybe_get<SPIRVariable>(args[0]);
+		auto *var = ir.maybe_get<SPIRVariable>(args[0]);
 		if (var && storage_class_is_interface(var->storage))
 			variables.insert(args[0]);
 
-		var = compiler.maybe_get<SPIRVariable>(args[1]);
+		var = ir.maybe_get<SPIRVariable>(args[1]);
 		if (var && storage_class_is_interface(var->storage))
 			variables.insert(args[1]);
 		break;
@@ -735,7 +1079,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 	{
 		if (length < 3)
 			return false;
-		auto &extension_set = compiler.get<SPIRExtension>(args[2]);
+		auto &extension_set = ir.get<SPIRExtension>(args[2]);
 		switch (extension_set.ext)
 		{
 		case SPIRExtension::GLSL:
@@ -748,7 +1092,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 			case GLSLstd450InterpolateAtSample:
 			case GLSLstd450InterpolateAtOffset:
 			{
-				auto *var = compiler.maybe_get<SPIRVariable>(args[4]);
+				auto *var = ir.maybe_get<SPIRVariable>(args[4]);
 				if (var && storage_class_is_interface(var->storage))
 					variables.insert(args[4]);
 				break;
@@ -757,7 +1101,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 			case GLSLstd450Modf:
 			case GLSLstd450Fract:
 			{
-				auto *var = compiler.maybe_get<SPIRVariable>(args[5]);
+				auto *var = ir.maybe_get<SPIRVariable>(args[5]);
 				if (var && storage_class_is_interface(var->storage))
 					variables.insert(args[5]);
 				break;
@@ -781,7 +1125,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 			{
 			case InterpolateAtVertexAMD:
 			{
-				auto *var = compiler.maybe_get<SPIRVariable>(args[4]);
+				auto *var = ir.maybe_get<SPIRVariable>(args[4]);
 				if (var && storage_class_is_interface(var->storage))
 					variables.insert(args[4]);
 				break;
@@ -829,7 +1173,7 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 
 	if (variable)
 	{
-		auto *var = compiler.maybe_get<SPIRVariable>(variable);
+		auto *var = ir.maybe_get<SPIRVariable>(variable);
 		if (var && storage_class_is_interface(var->storage))
 			variables.insert(variable);
 	}
@@ -838,24 +1182,8 @@ bool Compiler::InterfaceVariableAccessHandler::handle(Op opcode, const uint32_t
 
 unordered_set<VariableID> Compiler::get_active_interface_variables() const
 {
-	// Traverse the call graph and find all interface variables which are in use.
 	unordered_set<VariableID> variables;
-	InterfaceVariableAccessHandler handler(*this, variables);
-	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
-
-	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
-		if (var.storage != StorageClassOutput)
-			return;
-		if (!interface_variable_exists_in_entry_point(var.self))
-			return;
-
-		// An output variable which is just declared (but uninitialized) might be read by subsequent stages
-		// so we should force-enable these outputs,
-		// since compilation will fail if a subsequent stage attempts to read from the variable in question.
-		// Also, make sure we preserve output variables which are only initialized, but never accessed by any code.
-		if (var.initializer != ID(0) || get_execution_model() != ExecutionModelFragment)
-			variables.insert(var.self);
-	});
+	collect_active_interface_variables(ir, get_entry_point(), nullptr, variables, &compile_budget);
 
 	// If we needed to create one, we'll need it.
 	if (dummy_sampler_id)
@@ -870,143 +1198,740 @@ void Compiler::set_enabled_interface_variables(std::unordered_set<VariableID> ac
 	check_active_interface_variables = true;
 }
 
-ShaderResources Compiler::get_shader_resources(const unordered_set<VariableID> *active_variables) const
+// Number of memory operands starting with the mask at args[mask_index].
+static uint32_t memory_operand_count(const uint32_t *args, uint32_t length, uint32_t mask_index)
 {
-	ShaderResources res;
+	if (mask_index >= length)
+		return 0;
 
-	bool ssbo_instance_name = reflection_ssbo_instance_name_is_significant();
+	uint32_t mask = args[mask_index];
+	uint32_t count = 1;
+	if (mask & MemoryAccessAlignedMask)
+		count++;
+	if (mask & MemoryAccessMakePointerAvailableMask)
+		count++;
+	if (mask & MemoryAccessMakePointerVisibleMask)
+		count++;
+	return count;
+}
 
-	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
-		auto &type = this->get<SPIRType>(var.basetype);
+// Whether args[index] is the memory operand mask starting at args[mask_index] or the alignment following it.
+// The scopes which may follow are IDs.
+static bool is_literal_memory_operand(const uint32_t *args, uint32_t length, uint32_t mask_index, uint32_t index)
+{
+	if (mask_index >= length)
+		return false;
+	return index == mask_index || (index == mask_index + 1 && (args[mask_index] & MemoryAccessAlignedMask) != 0);
+}
 
-		// It is possible for uniform storage classes to be passed as function parameters, so detect
-		// that. To detect function parameters, check of StorageClass of variable is function scope.
-		if (var.storage == StorageClassFunction || !type.pointer)
-			return;
+// Whether the operand args[index] of an instruction in a function body is a literal rather than an ID.
+// Only the operand positions of opcodes listed here are known, any other operand counts as an ID.
+static bool is_literal_operand(Op op, const uint32_t *args, uint32_t length, uint32_t index)
+{
+	switch (op)
+	{
+	case OpLine:
+		return index >= 1;
 
-		if (active_variables && active_variables->find(var.self) == end(*active_variables))
-			return;
+	case OpExtInst:
+	case OpArrayLength:
+		return index == 3;
 
-		// In SPIR-V 1.4 and up, every global must be present in the entry point interface list,
-		// not just IO variables.
-		bool active_in_entry_point = true;
-		if (ir.get_spirv_version() < 0x10400)
-		{
-			if (var.storage == StorageClassInput || var.storage == StorageClassOutput)
-				active_in_entry_point = interface_variable_exists_in_entry_point(var.self);
-		}
-		else
-			active_in_entry_point = interface_variable_exists_in_entry_point(var.self);
+	case OpCompositeExtract:
+		return index >= 3;
 
-		if (!active_in_entry_point)
-			return;
+	case OpCompositeInsert:
+	case OpVectorShuffle:
+		return index >= 4;
 
-		bool is_builtin = is_builtin_variable(var);
+	case OpLoad:
+	case OpCopyMemorySized:
+		return is_literal_memory_operand(args, length, 3, index);
 
-		if (is_builtin)
-		{
-			if (var.storage != StorageClassInput && var.storage != StorageClassOutput)
-				return;
+	case OpStore:
+		return is_literal_memory_operand(args, length, 2, index);
 
-			auto &list = var.storage == StorageClassInput ? res.builtin_inputs : res.builtin_outputs;
-			BuiltInResource resource;
+	case OpCopyMemory:
+		// The source may have memory operands of its own after those of the target.
+		return is_literal_memory_operand(args, length, 2, index) ||
+		       is_literal_memory_operand(args, length, 2 + memory_operand_count(args, length, 2), index);
 
-			if (has_decoration(type.self, DecorationBlock))
-			{
-				resource.resource = { var.self, var.basetype, type.self,
-				                      get_remapped_declared_block_name(var.self, false) };
+	// The image operands following the mask are IDs.
+	case OpImageWrite:
+		return index == 3;
 
-				for (uint32_t i = 0; i < uint32_t(type.member_types.size()); i++)
-				{
-					resource.value_type_id = type.member_types[i];
-					resource.builtin = BuiltIn(get_member_decoration(type.self, i, DecorationBuiltIn));
-					list.push_back(resource);
-				}
-			}
-			else
-			{
-				bool strip_array =
-						!has_decoration(var.self, DecorationPatch) && (
-								get_execution_model() == ExecutionModelTessellationControl ||
-								(get_execution_model() == ExecutionModelTessellationEvaluation &&
-								 var.storage == StorageClassInput));
+	case OpImageSampleImplicitLod:
+	case OpImageSampleExplicitLod:
+	case OpImageSampleProjImplicitLod:
+	case OpImageSampleProjExplicitLod:
+	case OpImageFetch:
+	case OpImageRead:
+	case OpImageSparseSampleImplicitLod:
+	case OpImageSparseSampleExplicitLod:
+	case OpImageSparseSampleProjImplicitLod:
+	case OpImageSparseSampleProjExplicitLod:
+	case OpImageSparseFetch:
+	case OpImageSparseRead:
+		return index == 4;
 
-				resource.resource = { var.self, var.basetype, type.self, get_name(var.self) };
+	case OpImageSampleDrefImplicitLod:
+	case OpImageSampleDrefExplicitLod:
+	case OpImageSampleProjDrefImplicitLod:
+	case OpImageSampleProjDrefExplicitLod:
+	case OpImageGather:
+	case OpImageDrefGather:
+	case OpImageSparseSampleDrefImplicitLod:
+	case OpImageSparseSampleDrefExplicitLod:
+	case OpImageSparseSampleProjDrefImplicitLod:
+	case OpImageSparseSampleProjDrefExplicitLod:
+	case OpImageSparseGather:
+	case OpImageSparseDrefGather:
+		return index == 5;
+
+	// The group operation follows the scope.
+	case OpGroupIAdd:
+	case OpGroupFAdd:
+	case OpGroupFMin:
+	case OpGroupUMin:
+	case OpGroupSMin:
+	case OpGroupFMax:
+	case OpGroupUMax:
+	case OpGroupSMax:
+	case OpGroupNonUniformBallotBitCount:
+	case OpGroupNonUniformIAdd:
+	case OpGroupNonUniformFAdd:
+	case OpGroupNonUniformIMul:
+	case OpGroupNonUniformFMul:
+	case OpGroupNonUniformSMin:
+	case OpGroupNonUniformUMin:
+	case OpGroupNonUniformFMin:
+	case OpGroupNonUniformSMax:
+	case OpGroupNonUniformUMax:
+	case OpGroupNonUniformFMax:
+	case OpGroupNonUniformBitwiseAnd:
+	case OpGroupNonUniformBitwiseOr:
+	case OpGroupNonUniformBitwiseXor:
+	case OpGroupNonUniformLogicalAnd:
+	case OpGroupNonUniformLogicalOr:
+	case OpGroupNonUniformLogicalXor:
+	case OpGroupIAddNonUniformAMD:
+	case OpGroupFAddNonUniformAMD:
+	case OpGroupFMinNonUniformAMD:
+	case OpGroupUMinNonUniformAMD:
+	case OpGroupSMinNonUniformAMD:
+	case OpGroupFMaxNonUniformAMD:
+	case OpGroupUMaxNonUniformAMD:
+	case OpGroupSMaxNonUniformAMD:
+	case OpGroupFMulKHR:
+	case OpGroupBitwiseAndKHR:
+	case OpGroupBitwiseOrKHR:
+	case OpGroupBitwiseXorKHR:
+	case OpGroupLogicalAndKHR:
+	case OpGroupLogicalOrKHR:
+	case OpGroupLogicalXorKHR:
+		return index == 3;
 
-				if (strip_array && !type.array.empty())
-					resource.value_type_id = get_variable_data_type(var).parent_type;
-				else
-					resource.value_type_id = get_variable_data_type_id(var);
+	default:
+		return false;
+	}
+}
 
-				assert(resource.value_type_id);
+bool Compiler::ReachableIDsHandler::handle(Op opcode, const uint32_t *args, uint32_t length)
+{
+	for (uint32_t i = 0; i < length; i++)
+		if (!is_literal_operand(opcode, args, length, i))
+			ids.insert(args[i]);
+	return true;
+}
 
-				resource.builtin = BuiltIn(get_decoration(var.self, DecorationBuiltIn));
-				list.push_back(std::move(resource));
-			}
-			return;
-		}
+bool Compiler::ReachableIDsHandler::handle_terminator(const SPIRBlock &block)
+{
+	// Terminators and phis are not stored as instructions of the block.
+	ids.insert(block.condition);
+	ids.insert(block.return_value);
+	for (auto &phi : block.phi_variables)
+		ids.insert(phi.local_variable);
+	return true;
+}
 
-		// Input
+RemovedIDs Compiler::remove_unreachable_ids()
+{
+	unordered_set<uint32_t> referenced;
+	ReachableIDsHandler handler(referenced);
+	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
+	referenced.insert(ir.default_entry_point);
+
+	RemovedIDs removed;
+	SmallVector<ID> dead;
+
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t self, const SPIRFunction &func) {
+		if (referenced.count(self))
+			return;
+
+		removed.functions.push_back(self);
+		dead.push_back(self);
+		for (auto &arg : func.arguments)
+			dead.push_back(arg.id);
+		for (auto var : func.local_variables)
+			dead.push_back(var);
+		for (auto block : func.blocks)
+			dead.push_back(block);
+	});
+
+	// Interface variables are also kept if they are part of the interface without being accessed.
+	// Combined image samplers are only referred to by the compiler, not by the SPIR-V.
+	auto active = get_active_interface_variables();
+	for (auto &combined : combined_image_samplers)
+		active.insert(combined.combined_id);
+
+	unordered_set<uint32_t> kept;
+	SmallVector<uint32_t> pending;
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t self, const SPIRVariable &var) {
+		if (var.storage == StorageClassFunction)
+			return;
+		if (referenced.count(self) || active.count(self))
+			pending.push_back(self);
+	});
+
+	// Global variables may be initialized with pointers to other global variables.
+	while (!pending.empty())
+	{
+		uint32_t id = pending.back();
+		pending.pop_back();
+		if (!kept.insert(id).second)
+			continue;
+
+		auto *initializer = maybe_get<SPIRVariable>(get<SPIRVariable>(id).initializer);
+		if (initializer && initializer->storage != StorageClassFunction)
+			pending.push_back(initializer->self);
+	}
+
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t self, const SPIRVariable &var) {
+		if (var.storage != StorageClassFunction && !kept.count(self))
+		{
+			removed.variables.push_back(self);
+			dead.push_back(self);
+		}
+	});
+
+	unordered_set<uint32_t> dead_set(begin(dead), end(dead));
+	const auto is_dead = [&](uint32_t id) { return dead_set.count(id) != 0; };
+	const auto prune = [&](SmallVector<uint32_t> &ids) { ids.erase(remove_if(begin(ids), end(ids), is_dead), end(ids)); };
+
+	for (auto itr = begin(ir.entry_points); itr != end(ir.entry_points);)
+	{
+		if (is_dead(itr->first))
+		{
+			itr = ir.entry_points.erase(itr);
+			continue;
+		}
+
+		auto &interface = itr->second.interface_variables;
+		interface.erase(remove_if(begin(interface), end(interface), is_dead), end(interface));
+		++itr;
+	}
+
+	prune(global_variables);
+	prune(aliased_variables);
+	ir.remove_ids(dead);
+	dead.clear();
+
+	// Types are kept when anything left refers to them, directly or through other types.
+	kept.clear();
+	const auto keep_type = [&](uint32_t id) {
+		if (ir.ids[id].get_type() == TypeType && kept.insert(id).second)
+			pending.push_back(id);
+	};
+
+	for (auto id : referenced)
+		if (id < ir.ids.size())
+			keep_type(id);
+
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) { keep_type(var.basetype); });
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, const SPIRConstant &c) { keep_type(c.constant_type); });
+	ir.for_each_typed_id<SPIRConstantOp>([&](uint32_t, const SPIRConstantOp &op) { keep_type(op.basetype); });
+	ir.for_each_typed_id<SPIRUndef>([&](uint32_t, const SPIRUndef &undef) { keep_type(undef.basetype); });
+
+	unordered_set<uint32_t> kept_prototypes;
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t, const SPIRFunction &func) {
+		keep_type(func.return_type);
+		for (auto &arg : func.arguments)
+			keep_type(arg.type);
+
+		if (kept_prototypes.insert(func.function_type).second)
+		{
+			auto &prototype = get<SPIRFunctionPrototype>(func.function_type);
+			keep_type(prototype.return_type);
+			for (auto type : prototype.parameter_types)
+				keep_type(type);
+		}
+	});
+
+	while (!pending.empty())
+	{
+		auto &type = get<SPIRType>(pending.back());
+		pending.pop_back();
+
+		keep_type(type.self);
+		keep_type(type.parent_type);
+		keep_type(type.type_alias);
+		keep_type(type.image.type);
+		for (auto member : type.member_types)
+			keep_type(member);
+	}
+
+	ir.for_each_typed_id<SPIRType>([&](uint32_t self, const SPIRType &) {
+		if (!kept.count(self))
+		{
+			removed.types.push_back(self);
+			dead.push_back(self);
+		}
+	});
+
+	ir.for_each_typed_id<SPIRFunctionPrototype>([&](uint32_t self, const SPIRFunctionPrototype &) {
+		if (!kept_prototypes.count(self))
+			dead.push_back(self);
+	});
+
+	ir.remove_ids(dead);
+	return removed;
+}
+
+void Compiler::mask_stage_output_by_location(uint32_t, uint32_t)
+{
+	SPIRV_CROSS_THROW("Masking stage outputs is not supported by this backend.");
+}
+
+void Compiler::mask_stage_output_by_builtin(BuiltIn)
+{
+	SPIRV_CROSS_THROW("Masking stage outputs is not supported by this backend.");
+}
+
+void Compiler::stage_interface_relocated(StorageClass, const unordered_map<uint32_t, uint32_t> &)
+{
+}
+
+uint32_t Compiler::get_stage_varying_location_count(const SPIRType &type) const
+{
+	uint32_t count;
+	if (type.basetype == SPIRType::Struct)
+	{
+		count = 0;
+		for (auto &mbr_type : type.member_types)
+			count += get_stage_varying_location_count(get<SPIRType>(mbr_type));
+	}
+	else
+	{
+		count = type.columns > 1 ? type.columns : 1;
+		// 64-bit vectors with more than two components take two locations.
+		if (type.width == 64 && type.vecsize > 2)
+			count *= 2;
+	}
+
+	for (uint32_t i = 0; i < uint32_t(type.array.size()); i++)
+		count *= type.array_size_literal[i] ? type.array[i] : evaluate_constant_u32(type.array[i]);
+
+	return count;
+}
+
+SmallVector<Compiler::StageVarying> Compiler::get_stage_varyings(StorageClass storage) const
+{
+	// Per-vertex varyings of these stages are arrays indexed by the vertex.
+	auto model = get_execution_model();
+	bool arrayed;
+	if (storage == StorageClassInput)
+	{
+		arrayed = model == ExecutionModelTessellationControl || model == ExecutionModelTessellationEvaluation ||
+		          model == ExecutionModelGeometry;
+	}
+	else
+		arrayed = model == ExecutionModelTessellationControl || model == ExecutionModelMeshEXT;
+
+	SmallVector<StageVarying> varyings;
+	for (auto &id : get_entry_point().interface_variables)
+	{
+		auto &var = get<SPIRVariable>(id);
+		if (var.storage != storage || is_builtin_variable(var))
+			continue;
+
+		bool strip_array = arrayed && (model == ExecutionModelMeshEXT || !has_decoration(var.self, DecorationPatch));
+		auto &type = strip_array ? get_variable_element_type(var) : get_variable_data_type(var);
+
+		StageVarying varying;
+		varying.var = var.self;
+		bool has_location = has_decoration(var.self, DecorationLocation);
+		uint32_t location = get_decoration(var.self, DecorationLocation);
+
+		if (has_decoration(type.self, DecorationBlock))
+		{
+			for (uint32_t i = 0; i < uint32_t(type.member_types.size()); i++)
+			{
+				if (has_member_decoration(type.self, i, DecorationLocation))
+				{
+					location = get_member_decoration(type.self, i, DecorationLocation);
+					has_location = true;
+				}
+
+				if (!has_location)
+					SPIRV_CROSS_THROW("Stage varyings need locations to be linked.");
+
+				uint32_t count = get_stage_varying_location_count(get<SPIRType>(type.member_types[i]));
+				for (uint32_t j = 0; j < count; j++)
+					varying.locations.push_back(location++);
+			}
+		}
+		else
+		{
+			if (!has_location)
+				SPIRV_CROSS_THROW("Stage varyings need locations to be linked.");
+
+			uint32_t count = get_stage_varying_location_count(type);
+			for (uint32_t j = 0; j < count; j++)
+				varying.locations.push_back(location + j);
+		}
+
+		varyings.push_back(std::move(varying));
+	}
+
+	return varyings;
+}
+
+void Compiler::link_stage_outputs(Compiler &downstream, bool pack_locations)
+{
+	auto outputs = get_stage_varyings(StorageClassOutput);
+	auto inputs = downstream.get_stage_varyings(StorageClassInput);
+	auto active_inputs = downstream.get_active_interface_variables();
+	bool is_tesc = get_execution_model() == ExecutionModelTessellationControl;
+
+	// Varyings are linked if downstream reads them, if they cannot be masked,
+	// or if they share a location with a linked varying.
+	std::set<uint32_t> linked_locations;
+	SmallVector<bool> output_linked(outputs.size());
+	SmallVector<bool> input_linked(inputs.size());
+
+	const auto link = [&](const StageVarying &varying, SmallVector<bool> &linked, size_t index) {
+		linked[index] = true;
+		linked_locations.insert(varying.locations.begin(), varying.locations.end());
+	};
+
+	for (size_t i = 0; i < inputs.size(); i++)
+		if (active_inputs.count(inputs[i].var))
+			link(inputs[i], input_linked, i);
+
+	for (size_t i = 0; i < outputs.size(); i++)
+	{
+		auto &var = get<SPIRVariable>(outputs[i].var);
+		if (has_decoration(get_variable_data_type(var).self, DecorationBlock) ||
+		    (is_tesc && !has_decoration(var.self, DecorationPatch)))
+		{
+			link(outputs[i], output_linked, i);
+		}
+	}
+
+	const auto link_overlapping = [&](const SmallVector<StageVarying> &varyings, SmallVector<bool> &linked) -> bool {
+		bool changed = false;
+		for (size_t i = 0; i < varyings.size(); i++)
+		{
+			if (linked[i])
+				continue;
+
+			for (auto location : varyings[i].locations)
+			{
+				if (linked_locations.count(location))
+				{
+					link(varyings[i], linked, i);
+					changed = true;
+					break;
+				}
+			}
+		}
+		return changed;
+	};
+
+	for (;;)
+	{
+		bool changed = link_overlapping(outputs, output_linked);
+		changed = link_overlapping(inputs, input_linked) || changed;
+		if (!changed)
+			break;
+	}
+
+	if (pack_locations)
+	{
+		// Whatever is not linked goes past the linked varyings. Each varying is either linked or not as a whole,
+		// so consecutive locations of one stay consecutive.
+		std::set<uint32_t> other_locations;
+		for (size_t i = 0; i < outputs.size(); i++)
+			if (!output_linked[i])
+				other_locations.insert(outputs[i].locations.begin(), outputs[i].locations.end());
+		for (size_t i = 0; i < inputs.size(); i++)
+			if (!input_linked[i])
+				other_locations.insert(inputs[i].locations.begin(), inputs[i].locations.end());
+
+		unordered_map<uint32_t, uint32_t> new_locations;
+		uint32_t next_location = 0;
+		for (auto *locations : { &linked_locations, &other_locations })
+		{
+			for (auto location : *locations)
+			{
+				if (location != next_location)
+					new_locations[location] = next_location;
+				next_location++;
+			}
+		}
+
+		const auto relocate = [&](Compiler &compiler, const SmallVector<StageVarying> &varyings) {
+			for (auto &varying : varyings)
+			{
+				auto &type = compiler.get_variable_data_type(compiler.get<SPIRVariable>(varying.var));
+				auto relocate_decoration = [&](uint32_t location) {
+					auto itr = new_locations.find(location);
+					return itr != new_locations.end() ? itr->second : location;
+				};
+
+				if (compiler.has_decoration(varying.var, DecorationLocation))
+				{
+					compiler.set_decoration(varying.var, DecorationLocation,
+					                        relocate_decoration(compiler.get_decoration(varying.var, DecorationLocation)));
+				}
+
+				if (compiler.has_decoration(type.self, DecorationBlock))
+				{
+					for (uint32_t i = 0; i < uint32_t(type.member_types.size()); i++)
+					{
+						if (compiler.has_member_decoration(type.self, i, DecorationLocation))
+						{
+							compiler.set_member_decoration(
+							    type.self, i, DecorationLocation,
+							    relocate_decoration(compiler.get_member_decoration(type.self, i, DecorationLocation)));
+						}
+					}
+				}
+			}
+		};
+
+		relocate(*this, outputs);
+		relocate(downstream, inputs);
+		stage_interface_relocated(StorageClassOutput, new_locations);
+		downstream.stage_interface_relocated(StorageClassInput, new_locations);
+	}
+
+	for (size_t i = 0; i < outputs.size(); i++)
+	{
+		if (!output_linked[i])
+		{
+			mask_stage_output_by_location(get_decoration(outputs[i].var, DecorationLocation),
+			                              get_decoration(outputs[i].var, DecorationComponent));
+		}
+	}
+}
+
+void Compiler::GlobalVariableIndex::build(const ParsedIR &ir)
+{
+	if (built)
+		return;
+
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
+		// It is possible for uniform storage classes to be passed as function parameters, so detect
+		// that. To detect function parameters, check of StorageClass of variable is function scope.
+		if (var.storage == StorageClassFunction || !ir.get<SPIRType>(var.basetype).pointer)
+			return;
+
+		variables.push_back(var.self);
+		by_storage[var.storage].push_back(var.self);
+	});
+
+	built = true;
+}
+
+const SmallVector<VariableID> &Compiler::GlobalVariableIndex::get(StorageClass storage) const
+{
+	static const SmallVector<VariableID> empty;
+	auto itr = by_storage.find(storage);
+	return itr != end(by_storage) ? itr->second : empty;
+}
+
+void Compiler::collect_active_interface_variables(const ParsedIR &ir, const SPIREntryPoint &entry,
+                                                  const GlobalVariableIndex *index,
+                                                  unordered_set<VariableID> &variables, CompileBudgetTracker *budget)
+{
+	// Traverse the call graph and find all interface variables which are in use.
+	InterfaceVariableAccessHandler handler(ir, variables);
+	handler.budget = budget;
+	traverse_all_reachable_opcodes(ir, ir.get<SPIRFunction>(entry.self), handler);
+
+	const auto add_output = [&](uint32_t, const SPIRVariable &var) {
+		if (var.storage != StorageClassOutput)
+			return;
+		if (!interface_variable_exists_in_entry_point(ir, entry, var))
+			return;
+
+		// An output variable which is just declared (but uninitialized) might be read by subsequent stages
+		// so we should force-enable these outputs,
+		// since compilation will fail if a subsequent stage attempts to read from the variable in question.
+		// Also, make sure we preserve output variables which are only initialized, but never accessed by any code.
+		if (var.initializer != ID(0) || entry.model != ExecutionModelFragment)
+			variables.insert(var.self);
+	};
+
+	if (index)
+	{
+		for (auto id : index->get(StorageClassOutput))
+			add_output(id, ir.get<SPIRVariable>(id));
+	}
+	else
+		ir.for_each_typed_id<SPIRVariable>(add_output);
+}
+
+ShaderResources Compiler::get_shader_resources(const unordered_set<VariableID> *active_variables) const
+{
+	return get_shader_resources(ir, get_entry_point(), nullptr, active_variables,
+	                            [this](const SPIRVariable &var, bool prefer_instance_name) {
+		                            return get_remapped_declared_block_name(var.self, prefer_instance_name);
+	                            });
+}
+
+ShaderResources Compiler::get_shader_resources(const ParsedIR &ir, const SPIREntryPoint &entry,
+                                               const GlobalVariableIndex *index,
+                                               const unordered_set<VariableID> *active_variables,
+                                               const BlockNameCallback &get_block_name)
+{
+	ShaderResources res;
+
+	bool ssbo_instance_name = reflection_ssbo_instance_name_is_significant(ir, index);
+	auto execution_model = entry.model;
+
+	const auto add_resource = [&](uint32_t, const SPIRVariable &var) {
+		auto &type = ir.get<SPIRType>(var.basetype);
+
+		// It is possible for uniform storage classes to be passed as function parameters, so detect
+		// that. To detect function parameters, check of StorageClass of variable is function scope.
+		if (var.storage == StorageClassFunction || !type.pointer)
+			return;
+
+		if (active_variables && active_variables->find(var.self) == end(*active_variables))
+			return;
+
+		// In SPIR-V 1.4 and up, every global must be present in the entry point interface list,
+		// not just IO variables.
+		bool active_in_entry_point = true;
+		if (ir.get_spirv_version() < 0x10400)
+		{
+			if (var.storage == StorageClassInput || var.storage == StorageClassOutput)
+				active_in_entry_point = interface_variable_exists_in_entry_point(ir, entry, var);
+		}
+		else
+			active_in_entry_point = interface_variable_exists_in_entry_point(ir, entry, var);
+
+		if (!active_in_entry_point)
+			return;
+
+		bool is_builtin = is_builtin_variable(ir, var);
+
+		if (is_builtin)
+		{
+			if (var.storage != StorageClassInput && var.storage != StorageClassOutput)
+				return;
+
+			auto &list = var.storage == StorageClassInput ? res.builtin_inputs : res.builtin_outputs;
+			BuiltInResource resource;
+
+			if (ir.has_decoration(type.self, DecorationBlock))
+			{
+				resource.resource = { var.self, var.basetype, type.self,
+				                      get_block_name(var, false) };
+
+				for (uint32_t i = 0; i < uint32_t(type.member_types.size()); i++)
+				{
+					resource.value_type_id = type.member_types[i];
+					resource.builtin = BuiltIn(ir.get_member_decoration(type.self, i, DecorationBuiltIn));
+					list.push_back(resource);
+				}
+			}
+			else
+			{
+				bool strip_array =
+						!ir.has_decoration(var.self, DecorationPatch) && (
+								execution_model == ExecutionModelTessellationControl ||
+								(execution_model == ExecutionModelTessellationEvaluation &&
+								 var.storage == StorageClassInput));
+
+				resource.resource = { var.self, var.basetype, type.self, ir.get_name(var.self) };
+
+				if (strip_array && !type.array.empty())
+					resource.value_type_id = ir.get<SPIRType>(get_variable_data_type_id(ir, var)).parent_type;
+				else
+					resource.value_type_id = get_variable_data_type_id(ir, var);
+
+				assert(resource.value_type_id);
+
+				resource.builtin = BuiltIn(ir.get_decoration(var.self, DecorationBuiltIn));
+				list.push_back(std::move(resource));
+			}
+			return;
+		}
+
+		// Input
 		if (var.storage == StorageClassInput)
 		{
-			if (has_decoration(type.self, DecorationBlock))
+			if (ir.has_decoration(type.self, DecorationBlock))
 			{
 				res.stage_inputs.push_back(
 						{ var.self, var.basetype, type.self,
-						  get_remapped_declared_block_name(var.self, false) });
+						  get_block_name(var, false) });
 			}
 			else
-				res.stage_inputs.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+				res.stage_inputs.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 		}
 		// Subpass inputs
 		else if (var.storage == StorageClassUniformConstant && type.image.dim == DimSubpassData)
 		{
-			res.subpass_inputs.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+			res.subpass_inputs.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 		}
 		// Outputs
 		else if (var.storage == StorageClassOutput)
 		{
-			if (has_decoration(type.self, DecorationBlock))
+			if (ir.has_decoration(type.self, DecorationBlock))
 			{
 				res.stage_outputs.push_back(
-						{ var.self, var.basetype, type.self, get_remapped_declared_block_name(var.self, false) });
+						{ var.self, var.basetype, type.self, get_block_name(var, false) });
 			}
 			else
-				res.stage_outputs.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+				res.stage_outputs.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 		}
 		// UBOs
-		else if (type.storage == StorageClassUniform && has_decoration(type.self, DecorationBlock))
+		else if (type.storage == StorageClassUniform && ir.has_decoration(type.self, DecorationBlock))
 		{
 			res.uniform_buffers.push_back(
-			    { var.self, var.basetype, type.self, get_remapped_declared_block_name(var.self, false) });
+			    { var.self, var.basetype, type.self, get_block_name(var, false) });
 		}
 		// Old way to declare SSBOs.
-		else if (type.storage == StorageClassUniform && has_decoration(type.self, DecorationBufferBlock))
+		else if (type.storage == StorageClassUniform && ir.has_decoration(type.self, DecorationBufferBlock))
 		{
 			res.storage_buffers.push_back(
-			    { var.self, var.basetype, type.self, get_remapped_declared_block_name(var.self, ssbo_instance_name) });
+			    { var.self, var.basetype, type.self, get_block_name(var, ssbo_instance_name) });
 		}
 		// Modern way to declare SSBOs.
 		else if (type.storage == StorageClassStorageBuffer)
 		{
 			res.storage_buffers.push_back(
-			    { var.self, var.basetype, type.self, get_remapped_declared_block_name(var.self, ssbo_instance_name) });
+			    { var.self, var.basetype, type.self, get_block_name(var, ssbo_instance_name) });
 		}
 		// Push constant blocks
 		else if (type.storage == StorageClassPushConstant)
 		{
 			// There can only be one push constant block, but keep the vector in case this restriction is lifted
 			// in the future.
-			res.push_constant_buffers.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+			res.push_constant_buffers.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 		}
 		else if (type.storage == StorageClassShaderRecordBufferKHR)
 		{
-			res.shader_record_buffers.push_back({ var.self, var.basetype, type.self, get_remapped_declared_block_name(var.self, ssbo_instance_name) });
+			res.shader_record_buffers.push_back({ var.self, var.basetype, type.self, get_block_name(var, ssbo_instance_name) });
 		}
 		// Atomic counters
 		else if (type.storage == StorageClassAtomicCounter)
 		{
-			res.atomic_counters.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+			res.atomic_counters.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 		}
 		else if (type.storage == StorageClassUniformConstant)
 		{
@@ -1015,37 +1940,45 @@ ShaderResources Compiler::get_shader_resources(const unordered_set<VariableID> *
 				// Images
 				if (type.image.sampled == 2)
 				{
-					res.storage_images.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+					res.storage_images.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 				}
 				// Separate images
 				else if (type.image.sampled == 1)
 				{
-					res.separate_images.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+					res.separate_images.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 				}
 			}
 			// Separate samplers
 			else if (type.basetype == SPIRType::Sampler)
 			{
-				res.separate_samplers.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+				res.separate_samplers.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 			}
 			// Textures
 			else if (type.basetype == SPIRType::SampledImage)
 			{
-				res.sampled_images.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+				res.sampled_images.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 			}
 			// Acceleration structures
 			else if (type.basetype == SPIRType::AccelerationStructure)
 			{
-				res.acceleration_structures.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+				res.acceleration_structures.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 			}
 			else
 			{
-				res.gl_plain_uniforms.push_back({ var.self, var.basetype, type.self, get_name(var.self) });
+				res.gl_plain_uniforms.push_back({ var.self, var.basetype, type.self, ir.get_name(var.self) });
 			}
 		}
-	});
+	};
 
-	return res;
+	if (index)
+	{
+		for (auto id : index->variables)
+			add_resource(id, ir.get<SPIRVariable>(id));
+	}
+	else
+		ir.for_each_typed_id<SPIRVariable>(add_resource);
+
+	return res;
 }
 
 bool Compiler::type_is_block_like(const SPIRType &type) const
@@ -1106,8 +2039,7 @@ void Compiler::parse_fixup()
 	}
 }
 
-void Compiler::update_name_cache(unordered_set<string> &cache_primary, const unordered_set<string> &cache_secondary,
-                                 string &name)
+void Compiler::update_name_cache(NameCache &cache_primary, const NameCache &cache_secondary, string &name)
 {
 	if (name.empty())
 		return;
@@ -1149,17 +2081,33 @@ void Compiler::update_name_cache(unordered_set<string> &cache_primary, const uno
 		use_linked_underscore = false;
 	}
 
-	// If there is a collision (very rare),
-	// keep tacking on extra identifier until it's unique.
-	do
+	// If there is a collision, keep tacking on extra identifier until it's unique.
+	// Suffixes which are known to be taken in the primary cache are skipped, which gives the same name
+	// as probing from 1. Names only taken in the secondary cache do not count, as it may differ between calls.
+	uint32_t &taken = cache_primary.taken_suffix_count(tmpname);
+	counter = taken;
+	bool contiguous = true;
+	for (;;)
 	{
 		counter++;
 		name = tmpname + (use_linked_underscore ? "_" : "") + convert_to_string(counter);
-	} while (find_name(name));
+		if (cache_primary.find(name) != end(cache_primary))
+		{
+			if (contiguous)
+				taken = counter;
+		}
+		else if (&cache_primary != &cache_secondary && cache_secondary.find(name) != end(cache_secondary))
+			contiguous = false;
+		else
+			break;
+	}
+
 	insert_name(name);
+	if (contiguous)
+		taken = counter;
 }
 
-void Compiler::update_name_cache(unordered_set<string> &cache, string &name)
+void Compiler::update_name_cache(NameCache &cache, string &name)
 {
 	update_name_cache(cache, cache, name);
 }
@@ -1207,10 +2155,17 @@ const SPIRType &Compiler::get_pointee_type(uint32_t type_id) const
 }
 
 uint32_t Compiler::get_variable_data_type_id(const SPIRVariable &var) const
+{
+	return get_variable_data_type_id(ir, var);
+}
+
+uint32_t Compiler::get_variable_data_type_id(const ParsedIR &ir, const SPIRVariable &var)
 {
 	if (var.phi_variable)
 		return var.basetype;
-	return get_pointee_type_id(var.basetype);
+
+	auto &type = ir.get<SPIRType>(var.basetype);
+	return type.pointer ? uint32_t(type.parent_type) : uint32_t(var.basetype);
 }
 
 SPIRType &Compiler::get_variable_data_type(const SPIRVariable &var)
@@ -1316,8 +2271,27 @@ void Compiler::set_decoration(ID id, Decoration decoration, uint32_t argument)
 	ir.set_decoration(id, decoration, argument);
 }
 
+// Only these extended decorations feed into struct layouts, e.g. packing in MSL.
+static bool extended_decoration_affects_layout(ExtendedDecorations decoration)
+{
+	switch (decoration)
+	{
+	case SPIRVCrossDecorationPhysicalTypeID:
+	case SPIRVCrossDecorationPhysicalTypePacked:
+	case SPIRVCrossDecorationPaddingTarget:
+	case SPIRVCrossDecorationExplicitOffset:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
 void Compiler::set_extended_decoration(uint32_t id, ExtendedDecorations decoration, uint32_t value)
 {
+	if (ir.ids[id].get_type() == TypeType && extended_decoration_affects_layout(decoration))
+		ir.invalidate_type_layouts();
+
 	auto &dec = ir.meta[id].decoration;
 	dec.extended.flags.set(decoration);
 	dec.extended.values[decoration] = value;
@@ -1326,6 +2300,8 @@ void Compiler::set_extended_decoration(uint32_t id, ExtendedDecorations decorati
 void Compiler::set_extended_member_decoration(uint32_t type, uint32_t index, ExtendedDecorations decoration,
                                               uint32_t value)
 {
+	if (extended_decoration_affects_layout(decoration))
+		ir.invalidate_type_layouts();
 	ir.meta[type].members.resize(max(ir.meta[type].members.size(), size_t(index) + 1));
 	auto &dec = ir.meta[type].members[index];
 	dec.extended.flags.set(decoration);
@@ -1402,6 +2378,9 @@ bool Compiler::has_extended_member_decoration(uint32_t type, uint32_t index, Ext
 
 void Compiler::unset_extended_decoration(uint32_t id, ExtendedDecorations decoration)
 {
+	if (ir.ids[id].get_type() == TypeType && extended_decoration_affects_layout(decoration))
+		ir.invalidate_type_layouts();
+
 	auto &dec = ir.meta[id].decoration;
 	dec.extended.flags.clear(decoration);
 	dec.extended.values[decoration] = 0;
@@ -1409,6 +2388,8 @@ void Compiler::unset_extended_decoration(uint32_t id, ExtendedDecorations decora
 
 void Compiler::unset_extended_member_decoration(uint32_t type, uint32_t index, ExtendedDecorations decoration)
 {
+	if (extended_decoration_affects_layout(decoration))
+		ir.invalidate_type_layouts();
 	ir.meta[type].members.resize(max(ir.meta[type].members.size(), size_t(index) + 1));
 	auto &dec = ir.meta[type].members[index];
 	dec.extended.flags.clear(decoration);
@@ -1765,6 +2746,18 @@ const SmallVector<SPIRBlock::Case> &Compiler::get_case_list(const SPIRBlock &blo
 }
 
 bool Compiler::traverse_all_reachable_opcodes(const SPIRBlock &block, OpcodeHandler &handler) const
+{
+	handler.budget = &compile_budget;
+	return traverse_all_reachable_opcodes(ir, block, handler);
+}
+
+bool Compiler::traverse_all_reachable_opcodes(const SPIRFunction &func, OpcodeHandler &handler) const
+{
+	handler.budget = &compile_budget;
+	return traverse_all_reachable_opcodes(ir, func, handler);
+}
+
+bool Compiler::traverse_all_reachable_opcodes(const ParsedIR &ir, const SPIRBlock &block, OpcodeHandler &handler)
 {
 	handler.set_current_block(block);
 	handler.rearm_current_block(block);
@@ -1774,20 +2767,23 @@ bool Compiler::traverse_all_reachable_opcodes(const SPIRBlock &block, OpcodeHand
 	// inside dead blocks ...
 	for (auto &i : block.ops)
 	{
-		auto ops = stream(i);
+		auto ops = stream(ir, i);
 		auto op = static_cast<Op>(i.op);
 
+		if (handler.budget)
+			handler.budget->check();
+
 		if (!handler.handle(op, ops, i.length))
 			return false;
 
 		if (op == OpFunctionCall)
 		{
-			auto &func = get<SPIRFunction>(ops[2]);
-			if (handler.follow_function_call(func))
+			auto &func = ir.get<SPIRFunction>(ops[2]);
+			if (handler.enter_function(func))
 			{
 				if (!handler.begin_function_scope(ops, i.length))
 					return false;
-				if (!traverse_all_reachable_opcodes(get<SPIRFunction>(ops[2]), handler))
+				if (!traverse_all_reachable_opcodes(ir, ir.get<SPIRFunction>(ops[2]), handler))
 					return false;
 				if (!handler.end_function_scope(ops, i.length))
 					return false;
@@ -1803,321 +2799,139 @@ bool Compiler::traverse_all_reachable_opcodes(const SPIRBlock &block, OpcodeHand
 	return true;
 }
 
-bool Compiler::traverse_all_reachable_opcodes(const SPIRFunction &func, OpcodeHandler &handler) const
+bool Compiler::traverse_all_reachable_opcodes(const ParsedIR &ir, const SPIRFunction &func, OpcodeHandler &handler)
 {
 	for (auto block : func.blocks)
-		if (!traverse_all_reachable_opcodes(get<SPIRBlock>(block), handler))
+		if (!traverse_all_reachable_opcodes(ir, ir.get<SPIRBlock>(block), handler))
 			return false;
 
 	return true;
 }
 
-uint32_t Compiler::type_struct_member_offset(const SPIRType &type, uint32_t index) const
+Compiler::OpcodeHandlerGroup::OpcodeHandlerGroup(std::initializer_list<OpcodeHandler *> handlers_)
 {
-	auto *type_meta = ir.find_meta(type.self);
-	if (type_meta)
-	{
-		// Decoration must be set in valid SPIR-V, otherwise throw.
-		auto &dec = type_meta->members[index];
-		if (dec.decoration_flags.get(DecorationOffset))
-			return dec.offset;
-		else
-			SPIRV_CROSS_THROW("Struct member does not have Offset set.");
-	}
-	else
-		SPIRV_CROSS_THROW("Struct member does not have Offset set.");
+	for (auto *handler : handlers_)
+		members.push_back({ handler, 0, false, false });
 }
 
-uint32_t Compiler::type_struct_member_array_stride(const SPIRType &type, uint32_t index) const
+bool Compiler::OpcodeHandlerGroup::any_unfinished() const
 {
-	auto *type_meta = ir.find_meta(type.member_types[index]);
-	if (type_meta)
-	{
-		// Decoration must be set in valid SPIR-V, otherwise throw.
-		// ArrayStride is part of the array type not OpMemberDecorate.
-		auto &dec = type_meta->decoration;
-		if (dec.decoration_flags.get(DecorationArrayStride))
-			return dec.array_stride;
-		else
-			SPIRV_CROSS_THROW("Struct member does not have ArrayStride set.");
-	}
-	else
-		SPIRV_CROSS_THROW("Struct member does not have ArrayStride set.");
+	for (auto &member : members)
+		if (!member.finished)
+			return true;
+	return false;
 }
 
-uint32_t Compiler::type_struct_member_matrix_stride(const SPIRType &type, uint32_t index) const
+bool Compiler::OpcodeHandlerGroup::handle(Op opcode, const uint32_t *args, uint32_t length)
 {
-	auto *type_meta = ir.find_meta(type.self);
-	if (type_meta)
-	{
-		// Decoration must be set in valid SPIR-V, otherwise throw.
-		// MatrixStride is part of OpMemberDecorate.
-		auto &dec = type_meta->members[index];
-		if (dec.decoration_flags.get(DecorationMatrixStride))
-			return dec.matrix_stride;
-		else
-			SPIRV_CROSS_THROW("Struct member does not have MatrixStride set.");
-	}
-	else
-		SPIRV_CROSS_THROW("Struct member does not have MatrixStride set.");
+	for (auto &member : members)
+		if (is_live(member) && !member.handler->handle(opcode, args, length))
+			member.finished = true;
+	return any_unfinished();
 }
 
-size_t Compiler::get_declared_struct_size(const SPIRType &type) const
+bool Compiler::OpcodeHandlerGroup::handle_terminator(const SPIRBlock &block)
 {
-	if (type.member_types.empty())
-		SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
+	for (auto &member : members)
+		if (is_live(member) && !member.handler->handle_terminator(block))
+			member.finished = true;
+	return any_unfinished();
+}
 
-	// Offsets can be declared out of order, so we need to deduce the actual size
-	// based on last member instead.
-	uint32_t member_index = 0;
-	size_t highest_offset = 0;
-	for (uint32_t i = 0; i < uint32_t(type.member_types.size()); i++)
+bool Compiler::OpcodeHandlerGroup::follow_function_call(const SPIRFunction &func)
+{
+	bool any_follows = false;
+	for (auto &member : members)
 	{
-		size_t offset = type_struct_member_offset(type, i);
-		if (offset > highest_offset)
-		{
-			highest_offset = offset;
-			member_index = i;
-		}
+		member.follows_call = is_live(member) && member.handler->enter_function(func);
+		any_follows = any_follows || member.follows_call;
 	}
-
-	size_t size = get_declared_struct_member_size(type, member_index);
-	return highest_offset + size;
+	return any_follows;
 }
 
-size_t Compiler::get_declared_struct_size_runtime_array(const SPIRType &type, size_t array_size) const
+void Compiler::OpcodeHandlerGroup::set_current_block(const SPIRBlock &block)
 {
-	if (type.member_types.empty())
-		SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
-
-	size_t size = get_declared_struct_size(type);
-	auto &last_type = get<SPIRType>(type.member_types.back());
-	if (!last_type.array.empty() && last_type.array_size_literal[0] && last_type.array[0] == 0) // Runtime array
-		size += array_size * type_struct_member_array_stride(type, uint32_t(type.member_types.size() - 1));
+	for (auto &member : members)
+		if (is_live(member))
+			member.handler->set_current_block(block);
+}
 
-	return size;
+void Compiler::OpcodeHandlerGroup::rearm_current_block(const SPIRBlock &block)
+{
+	for (auto &member : members)
+		if (is_live(member))
+			member.handler->rearm_current_block(block);
 }
 
-uint32_t Compiler::evaluate_spec_constant_u32(const SPIRConstantOp &spec) const
+bool Compiler::OpcodeHandlerGroup::begin_function_scope(const uint32_t *args, uint32_t length)
 {
-	auto &result_type = get<SPIRType>(spec.basetype);
-	if (result_type.basetype != SPIRType::UInt && result_type.basetype != SPIRType::Int &&
-	    result_type.basetype != SPIRType::Boolean)
+	// Handlers which did not follow the call sit out the callee, including everything it calls in turn.
+	for (auto &member : members)
 	{
-		SPIRV_CROSS_THROW(
-		    "Only 32-bit integers and booleans are currently supported when evaluating specialization constants.\n");
-	}
-
-	if (!is_scalar(result_type))
-		SPIRV_CROSS_THROW("Spec constant evaluation must be a scalar.\n");
-
-	uint32_t value = 0;
-
-	const auto eval_u32 = [&](uint32_t id) -> uint32_t {
-		auto &type = expression_type(id);
-		if (type.basetype != SPIRType::UInt && type.basetype != SPIRType::Int && type.basetype != SPIRType::Boolean)
-		{
-			SPIRV_CROSS_THROW("Only 32-bit integers and booleans are currently supported when evaluating "
-			                  "specialization constants.\n");
-		}
-
-		if (!is_scalar(type))
-			SPIRV_CROSS_THROW("Spec constant evaluation must be a scalar.\n");
-		if (const auto *c = this->maybe_get<SPIRConstant>(id))
-			return c->scalar();
-		else
-			return evaluate_spec_constant_u32(this->get<SPIRConstantOp>(id));
-	};
-
-#define binary_spec_op(op, binary_op)                                              \
-	case Op##op:                                                                   \
-		value = eval_u32(spec.arguments[0]) binary_op eval_u32(spec.arguments[1]); \
-		break
-#define binary_spec_op_cast(op, binary_op, type)                                                         \
-	case Op##op:                                                                                         \
-		value = uint32_t(type(eval_u32(spec.arguments[0])) binary_op type(eval_u32(spec.arguments[1]))); \
-		break
-
-	// Support the basic opcodes which are typically used when computing array sizes.
-	switch (spec.opcode)
-	{
-		binary_spec_op(IAdd, +);
-		binary_spec_op(ISub, -);
-		binary_spec_op(IMul, *);
-		binary_spec_op(BitwiseAnd, &);
-		binary_spec_op(BitwiseOr, |);
-		binary_spec_op(BitwiseXor, ^);
-		binary_spec_op(LogicalAnd, &);
-		binary_spec_op(LogicalOr, |);
-		binary_spec_op(ShiftLeftLogical, <<);
-		binary_spec_op(ShiftRightLogical, >>);
-		binary_spec_op_cast(ShiftRightArithmetic, >>, int32_t);
-		binary_spec_op(LogicalEqual, ==);
-		binary_spec_op(LogicalNotEqual, !=);
-		binary_spec_op(IEqual, ==);
-		binary_spec_op(INotEqual, !=);
-		binary_spec_op(ULessThan, <);
-		binary_spec_op(ULessThanEqual, <=);
-		binary_spec_op(UGreaterThan, >);
-		binary_spec_op(UGreaterThanEqual, >=);
-		binary_spec_op_cast(SLessThan, <, int32_t);
-		binary_spec_op_cast(SLessThanEqual, <=, int32_t);
-		binary_spec_op_cast(SGreaterThan, >, int32_t);
-		binary_spec_op_cast(SGreaterThanEqual, >=, int32_t);
-#undef binary_spec_op
-#undef binary_spec_op_cast
-
-	case OpLogicalNot:
-		value = uint32_t(!eval_u32(spec.arguments[0]));
-		break;
-
-	case OpNot:
-		value = ~eval_u32(spec.arguments[0]);
-		break;
-
-	case OpSNegate:
-		value = uint32_t(-int32_t(eval_u32(spec.arguments[0])));
-		break;
-
-	case OpSelect:
-		value = eval_u32(spec.arguments[0]) ? eval_u32(spec.arguments[1]) : eval_u32(spec.arguments[2]);
-		break;
+		if (member.finished)
+			continue;
 
-	case OpUMod:
-	{
-		uint32_t a = eval_u32(spec.arguments[0]);
-		uint32_t b = eval_u32(spec.arguments[1]);
-		if (b == 0)
-			SPIRV_CROSS_THROW("Undefined behavior in UMod, b == 0.\n");
-		value = a % b;
-		break;
+		if (member.suspended_depth != 0 || !member.follows_call)
+			member.suspended_depth++;
+		else if (!member.handler->begin_function_scope(args, length))
+			member.finished = true;
 	}
+	return any_unfinished();
+}
 
-	case OpSRem:
+bool Compiler::OpcodeHandlerGroup::end_function_scope(const uint32_t *args, uint32_t length)
+{
+	for (auto &member : members)
 	{
-		auto a = int32_t(eval_u32(spec.arguments[0]));
-		auto b = int32_t(eval_u32(spec.arguments[1]));
-		if (b == 0)
-			SPIRV_CROSS_THROW("Undefined behavior in SRem, b == 0.\n");
-		value = a % b;
-		break;
+		if (member.finished)
+			continue;
+
+		if (member.suspended_depth != 0)
+			member.suspended_depth--;
+		else if (!member.handler->end_function_scope(args, length))
+			member.finished = true;
 	}
+	return any_unfinished();
+}
 
-	case OpSMod:
-	{
-		auto a = int32_t(eval_u32(spec.arguments[0]));
-		auto b = int32_t(eval_u32(spec.arguments[1]));
-		if (b == 0)
-			SPIRV_CROSS_THROW("Undefined behavior in SMod, b == 0.\n");
-		auto v = a % b;
+uint32_t Compiler::type_struct_member_offset(const SPIRType &type, uint32_t index) const
+{
+	return ir.type_struct_member_offset(type, index);
+}
 
-		// Makes sure we match the sign of b, not a.
-		if ((b < 0 && v > 0) || (b > 0 && v < 0))
-			v += b;
-		value = v;
-		break;
-	}
+uint32_t Compiler::type_struct_member_array_stride(const SPIRType &type, uint32_t index) const
+{
+	return ir.type_struct_member_array_stride(type, index);
+}
 
-	case OpUDiv:
-	{
-		uint32_t a = eval_u32(spec.arguments[0]);
-		uint32_t b = eval_u32(spec.arguments[1]);
-		if (b == 0)
-			SPIRV_CROSS_THROW("Undefined behavior in UDiv, b == 0.\n");
-		value = a / b;
-		break;
-	}
+uint32_t Compiler::type_struct_member_matrix_stride(const SPIRType &type, uint32_t index) const
+{
+	return ir.type_struct_member_matrix_stride(type, index);
+}
 
-	case OpSDiv:
-	{
-		auto a = int32_t(eval_u32(spec.arguments[0]));
-		auto b = int32_t(eval_u32(spec.arguments[1]));
-		if (b == 0)
-			SPIRV_CROSS_THROW("Undefined behavior in SDiv, b == 0.\n");
-		value = a / b;
-		break;
-	}
+size_t Compiler::get_declared_struct_size(const SPIRType &type) const
+{
+	return ir.get_declared_struct_size(type);
+}
 
-	default:
-		SPIRV_CROSS_THROW("Unsupported spec constant opcode for evaluation.\n");
-	}
+size_t Compiler::get_declared_struct_size_runtime_array(const SPIRType &type, size_t array_size) const
+{
+	return ir.get_declared_struct_size_runtime_array(type, array_size);
+}
 
-	return value;
+uint32_t Compiler::evaluate_spec_constant_u32(const SPIRConstantOp &spec) const
+{
+	return ir.evaluate_spec_constant_u32(spec);
 }
 
 uint32_t Compiler::evaluate_constant_u32(uint32_t id) const
 {
-	if (const auto *c = maybe_get<SPIRConstant>(id))
-		return c->scalar();
-	else
-		return evaluate_spec_constant_u32(get<SPIRConstantOp>(id));
+	return ir.evaluate_constant_u32(id);
 }
 
 size_t Compiler::get_declared_struct_member_size(const SPIRType &struct_type, uint32_t index) const
 {
-	if (struct_type.member_types.empty())
-		SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
-
-	auto &flags = get_member_decoration_bitset(struct_type.self, index);
-	auto &type = get<SPIRType>(struct_type.member_types[index]);
-
-	switch (type.basetype)
-	{
-	case SPIRType::Unknown:
-	case SPIRType::Void:
-	case SPIRType::Boolean: // Bools are purely logical, and cannot be used for externally visible types.
-	case SPIRType::AtomicCounter:
-	case SPIRType::Image:
-	case SPIRType::SampledImage:
-	case SPIRType::Sampler:
-		SPIRV_CROSS_THROW("Querying size for object with opaque size.");
-
-	default:
-		break;
-	}
-
-	if (type.pointer && type.storage == StorageClassPhysicalStorageBuffer)
-	{
-		// Check if this is a top-level pointer type, and not an array of pointers.
-		if (type.pointer_depth > get<SPIRType>(type.parent_type).pointer_depth)
-			return 8;
-	}
-
-	if (!type.array.empty())
-	{
-		// For arrays, we can use ArrayStride to get an easy check.
-		bool array_size_literal = type.array_size_literal.back();
-		uint32_t array_size = array_size_literal ? type.array.back() : evaluate_constant_u32(type.array.back());
-		return type_struct_member_array_stride(struct_type, index) * array_size;
-	}
-	else if (type.basetype == SPIRType::Struct)
-	{
-		return get_declared_struct_size(type);
-	}
-	else
-	{
-		unsigned vecsize = type.vecsize;
-		unsigned columns = type.columns;
-
-		// Vectors.
-		if (columns == 1)
-		{
-			size_t component_size = type.width / 8;
-			return vecsize * component_size;
-		}
-		else
-		{
-			uint32_t matrix_stride = type_struct_member_matrix_stride(struct_type, index);
-
-			// Per SPIR-V spec, matrices must be tightly packed and aligned up for vec3 accesses.
-			if (flags.get(DecorationRowMajor))
-				return matrix_stride * vecsize;
-			else if (flags.get(DecorationColMajor))
-				return matrix_stride * columns;
-			else
-				SPIRV_CROSS_THROW("Either row-major or column-major must be declared for matrices.");
-		}
-	}
+	return ir.get_declared_struct_member_size(struct_type, index);
 }
 
 bool Compiler::BufferAccessHandler::handle(Op opcode, const uint32_t *args, uint32_t length)
@@ -2136,15 +2950,15 @@ bool Compiler::BufferAccessHandler::handle(Op opcode, const uint32_t *args, uint
 
 	// Don't bother traversing the entire access chain tree yet.
 	// If we access a struct member, assume we access the entire member.
-	uint32_t index = compiler.get<SPIRConstant>(args[ptr_chain ? 4 : 3]).scalar();
+	uint32_t index = ir.get<SPIRConstant>(args[ptr_chain ? 4 : 3]).scalar();
 
 	// Seen this index already.
 	if (seen.find(index) != end(seen))
 		return true;
 	seen.insert(index);
 
-	auto &type = compiler.expression_type(id);
-	uint32_t offset = compiler.type_struct_member_offset(type, index);
+	auto &type = ir.get<SPIRType>(ir.get<SPIRVariable>(id).basetype);
+	uint32_t offset = ir.type_struct_member_offset(type, index);
 
 	size_t range;
 	// If we have another member in the struct, deduce the range by looking at the next member.
@@ -2154,12 +2968,12 @@ bool Compiler::BufferAccessHandler::handle(Op opcode, const uint32_t *args, uint
 	// very large amounts of padding, but that's not really a big deal.
 	if (index + 1 < type.member_types.size())
 	{
-		range = compiler.type_struct_member_offset(type, index + 1) - offset;
+		range = ir.type_struct_member_offset(type, index + 1) - offset;
 	}
 	else
 	{
 		// No padding, so just deduce it from the size of the member directly.
-		range = compiler.get_declared_struct_member_size(type, index);
+		range = ir.get_declared_struct_member_size(type, index);
 	}
 
 	ranges.push_back({ index, offset, range });
@@ -2169,7 +2983,7 @@ bool Compiler::BufferAccessHandler::handle(Op opcode, const uint32_t *args, uint
 SmallVector<BufferRange> Compiler::get_active_buffer_ranges(VariableID id) const
 {
 	SmallVector<BufferRange> ranges;
-	BufferAccessHandler handler(*this, ranges, id);
+	BufferAccessHandler handler(ir, ranges, id);
 	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
 	return ranges;
 }
@@ -2572,8 +3386,12 @@ SPIREntryPoint &Compiler::get_entry_point()
 
 bool Compiler::interface_variable_exists_in_entry_point(uint32_t id) const
 {
-	auto &var = get<SPIRVariable>(id);
+	return interface_variable_exists_in_entry_point(ir, get_entry_point(), get<SPIRVariable>(id));
+}
 
+bool Compiler::interface_variable_exists_in_entry_point(const ParsedIR &ir, const SPIREntryPoint &execution,
+                                                        const SPIRVariable &var)
+{
 	if (ir.get_spirv_version() < 0x10400)
 	{
 		if (var.storage != StorageClassInput && var.storage != StorageClassOutput &&
@@ -2590,8 +3408,7 @@ bool Compiler::interface_variable_exists_in_entry_point(uint32_t id) const
 
 	// In SPIR-V 1.4 and later, all global resource variables must be present.
 
-	auto &execution = get_entry_point();
-	return find(begin(execution.interface_variables), end(execution.interface_variables), VariableID(id)) !=
+	return find(begin(execution.interface_variables), end(execution.interface_variables), VariableID(var.self)) !=
 	       end(execution.interface_variables);
 }
 
@@ -3111,1455 +3928,3254 @@ const SPIRConstant &Compiler::get_constant(ConstantID id) const
 	return get<SPIRConstant>(id);
 }
 
-static bool exists_unaccessed_path_to_return(const CFG &cfg, uint32_t block, const unordered_set<uint32_t> &blocks,
-                                             unordered_set<uint32_t> &visit_cache)
+void Compiler::set_specialization_constant_value(uint32_t constant_id, uint64_t value)
 {
-	// This block accesses the variable.
-	if (blocks.find(block) != end(blocks))
-		return false;
-
-	// We are at the end of the CFG.
-	if (cfg.get_succeeding_edges(block).empty())
-		return true;
-
-	// If any of our successors have a path to the end, there exists a path from block.
-	for (auto &succ : cfg.get_succeeding_edges(block))
-	{
-		if (visit_cache.count(succ) == 0)
-		{
-			if (exists_unaccessed_path_to_return(cfg, succ, blocks, visit_cache))
-				return true;
-			visit_cache.insert(succ);
-		}
-	}
-
-	return false;
+	specialization_constant_values[constant_id] = value;
 }
 
-void Compiler::analyze_parameter_preservation(
-    SPIRFunction &entry, const CFG &cfg, const unordered_map<uint32_t, unordered_set<uint32_t>> &variable_to_blocks,
-    const unordered_map<uint32_t, unordered_set<uint32_t>> &complete_write_blocks)
+void Compiler::clear_specialization_constant_values()
 {
-	for (auto &arg : entry.arguments)
-	{
-		// Non-pointers are always inputs.
-		auto &type = get<SPIRType>(arg.type);
-		if (!type.pointer)
-			continue;
-
-		// Opaque argument types are always in
-		bool potential_preserve;
-		switch (type.basetype)
-		{
-		case SPIRType::Sampler:
-		case SPIRType::Image:
-		case SPIRType::SampledImage:
-		case SPIRType::AtomicCounter:
-			potential_preserve = false;
-			break;
-
-		default:
-			potential_preserve = true;
-			break;
-		}
-
-		if (!potential_preserve)
-			continue;
+	specialization_constant_values.clear();
+}
 
-		auto itr = variable_to_blocks.find(arg.id);
-		if (itr == end(variable_to_blocks))
-		{
-			// Variable is never accessed.
-			continue;
-		}
+static uint64_t width_mask(uint32_t width)
+{
+	return width >= 64 ? ~0ull : ((1ull << width) - 1ull);
+}
 
-		// We have accessed a variable, but there was no complete writes to that variable.
-		// We deduce that we must preserve the argument.
-		itr = complete_write_blocks.find(arg.id);
-		if (itr == end(complete_write_blocks))
-		{
-			arg.read_count++;
-			continue;
-		}
+static uint64_t sign_extend(uint64_t value, uint32_t width)
+{
+	if (width >= 64)
+		return value;
+	value &= width_mask(width);
+	if (value & (1ull << (width - 1)))
+		value |= ~width_mask(width);
+	return value;
+}
 
-		// If there is a path through the CFG where no block completely writes to the variable, the variable will be in an undefined state
-		// when the function returns. We therefore need to implicitly preserve the variable in case there are writers in the function.
-		// Major case here is if a function is
-		// void foo(int &var) { if (cond) var = 10; }
-		// Using read/write counts, we will think it's just an out variable, but it really needs to be inout,
-		// because if we don't write anything whatever we put into the function must return back to the caller.
-		unordered_set<uint32_t> visit_cache;
-		if (exists_unaccessed_path_to_return(cfg, entry.entry_block, itr->second, visit_cache))
-			arg.read_count++;
-	}
+static bool type_is_integral_or_bool(const SPIRType &type)
+{
+	return type.basetype == SPIRType::Boolean || type_is_integral(type);
 }
 
-Compiler::AnalyzeVariableScopeAccessHandler::AnalyzeVariableScopeAccessHandler(Compiler &compiler_,
-                                                                               SPIRFunction &entry_)
-    : compiler(compiler_)
-    , entry(entry_)
+static uint64_t read_constant_component(const SPIRConstant &c, const SPIRType &type, uint32_t index)
 {
+	if (type.basetype == SPIRType::Boolean)
+		return c.scalar(0, index) != 0;
+	else if (type.width == 64)
+		return c.scalar_u64(0, index);
+	else
+		return c.scalar(0, index) & width_mask(type.width);
 }
 
-bool Compiler::AnalyzeVariableScopeAccessHandler::follow_function_call(const SPIRFunction &)
+// Narrow values are stored as 32-bit words, sign-extended for signed types, like in SPIR-V literals.
+static void write_constant_component(SPIRConstant &c, const SPIRType &type, uint32_t index, uint64_t value)
 {
-	// Only analyze within this function.
-	return false;
+	if (type.basetype == SPIRType::Boolean)
+		c.m.c[0].r[index].u32 = value != 0;
+	else if (type.width == 64)
+		c.m.c[0].r[index].u64 = value;
+	else if (type.basetype == SPIRType::SByte || type.basetype == SPIRType::Short)
+		c.m.c[0].r[index].u32 = uint32_t(sign_extend(value, type.width));
+	else
+		c.m.c[0].r[index].u32 = uint32_t(value & width_mask(type.width));
 }
 
-void Compiler::AnalyzeVariableScopeAccessHandler::set_current_block(const SPIRBlock &block)
+bool Compiler::fold_specialization_constant_op(const SPIRConstantOp &op)
 {
-	current_block = &block;
+	auto &result_type = get<SPIRType>(op.basetype);
+	if (!result_type.array.empty() || result_type.basetype == SPIRType::Struct)
+		return false;
 
-	// If we're branching to a block which uses OpPhi, in GLSL
-	// this will be a variable write when we branch,
-	// so we need to track access to these variables as well to
-	// have a complete picture.
-	const auto test_phi = [this, &block](uint32_t to) {
-		auto &next = compiler.get<SPIRBlock>(to);
-		for (auto &phi : next.phi_variables)
-		{
-			if (phi.parent == block.self)
-			{
-				accessed_variables_to_block[phi.function_variable].insert(block.self);
-				// Phi variables are also accessed in our target branch block.
-				accessed_variables_to_block[phi.function_variable].insert(next.self);
+	// Every operand which is an ID must already be a regular constant.
+	const auto operand = [&](uint32_t index) -> const SPIRConstant * {
+		if (index >= op.arguments.size())
+			return nullptr;
+		auto *c = maybe_get<SPIRConstant>(op.arguments[index]);
+		return c && !c->specialization ? c : nullptr;
+	};
 
-				notify_variable_access(phi.local_variable, block.self);
-			}
-		}
-	};
+	SPIRConstant result(op.basetype);
+	result.m.columns = 1;
+	result.m.c[0].vecsize = result_type.vecsize;
 
-	switch (block.terminator)
+	switch (op.opcode)
 	{
-	case SPIRBlock::Direct:
-		notify_variable_access(block.condition, block.self);
-		test_phi(block.next_block);
-		break;
+	case OpCompositeExtract:
+	{
+		auto *c = operand(0);
+		if (!c)
+			return false;
 
-	case SPIRBlock::Select:
-		notify_variable_access(block.condition, block.self);
-		test_phi(block.true_block);
-		test_phi(block.false_block);
+		size_t i = 1;
+		while (i < op.arguments.size() && !c->subconstants.empty())
+		{
+			if (op.arguments[i] >= c->subconstants.size())
+				return false;
+			c = maybe_get<SPIRConstant>(c->subconstants[op.arguments[i++]]);
+			if (!c || c->specialization)
+				return false;
+		}
+
+		size_t remaining = op.arguments.size() - i;
+		if (remaining == 0)
+		{
+			result.m = c->m;
+			result.subconstants = c->subconstants;
+		}
+		else if (c->m.columns > 1 && remaining <= 2)
+		{
+			uint32_t col = op.arguments[i];
+			if (col >= c->m.columns)
+				return false;
+			if (remaining == 1)
+				result.m.c[0] = c->m.c[col];
+			else if (op.arguments[i + 1] < c->m.c[col].vecsize)
+				result.m.c[0].r[0] = c->m.c[col].r[op.arguments[i + 1]];
+			else
+				return false;
+		}
+		else if (c->m.columns == 1 && remaining == 1 && op.arguments[i] < c->m.c[0].vecsize)
+			result.m.c[0].r[0] = c->m.c[0].r[op.arguments[i]];
+		else
+			return false;
 		break;
+	}
 
-	case SPIRBlock::MultiSelect:
+	case OpCompositeInsert:
 	{
-		notify_variable_access(block.condition, block.self);
-		auto &cases = compiler.get_case_list(block);
-		for (auto &target : cases)
-			test_phi(target.block);
-		if (block.default_block)
-			test_phi(block.default_block);
+		auto *object = operand(0);
+		auto *c = operand(1);
+		if (!object || !c || !c->subconstants.empty() || !object->subconstants.empty())
+			return false;
+
+		result.m = c->m;
+		if (op.arguments.size() == 3 && c->m.columns == 1 && op.arguments[2] < c->m.c[0].vecsize)
+			result.m.c[0].r[op.arguments[2]] = object->m.c[0].r[0];
+		else if (op.arguments.size() == 3 && op.arguments[2] < c->m.columns)
+			result.m.c[op.arguments[2]] = object->m.c[0];
+		else if (op.arguments.size() == 4 && op.arguments[2] < c->m.columns &&
+		         op.arguments[3] < c->m.c[op.arguments[2]].vecsize)
+			result.m.c[op.arguments[2]].r[op.arguments[3]] = object->m.c[0].r[0];
+		else
+			return false;
 		break;
 	}
 
-	default:
+	case OpVectorShuffle:
+	{
+		auto *a = operand(0);
+		auto *b = operand(1);
+		if (!a || !b || !a->subconstants.empty() || !b->subconstants.empty() || a->m.columns != 1 ||
+		    b->m.columns != 1 || op.arguments.size() - 2 != result_type.vecsize)
+			return false;
+
+		for (uint32_t i = 0; i < result_type.vecsize; i++)
+		{
+			uint32_t component = op.arguments[i + 2];
+			if (component < a->m.c[0].vecsize)
+				result.m.c[0].r[i] = a->m.c[0].r[component];
+			else if (component - a->m.c[0].vecsize < b->m.c[0].vecsize)
+				result.m.c[0].r[i] = b->m.c[0].r[component - a->m.c[0].vecsize];
+			else
+				return false;
+		}
 		break;
 	}
-}
 
-void Compiler::AnalyzeVariableScopeAccessHandler::notify_variable_access(uint32_t id, uint32_t block)
-{
-	if (id == 0)
-		return;
+	default:
+	{
+		// Everything else is evaluated component by component on integers and booleans.
+		if (!type_is_integral_or_bool(result_type) || result_type.columns != 1)
+			return false;
 
-	// Access chains used in multiple blocks mean hoisting all the variables used to construct the access chain as not all backends can use pointers.
-	auto itr = rvalue_forward_children.find(id);
-	if (itr != end(rvalue_forward_children))
-		for (auto child_id : itr->second)
-			notify_variable_access(child_id, block);
+		const SPIRConstant *args[3] = {};
+		const SPIRType *arg_types[3] = {};
+		if (op.arguments.empty() || op.arguments.size() > 3)
+			return false;
 
-	if (id_is_phi_variable(id))
-		accessed_variables_to_block[id].insert(block);
-	else if (id_is_potential_temporary(id))
-		accessed_temporaries_to_block[id].insert(block);
-}
+		for (uint32_t i = 0; i < op.arguments.size(); i++)
+		{
+			args[i] = operand(i);
+			if (!args[i] || !args[i]->subconstants.empty())
+				return false;
+			arg_types[i] = &get<SPIRType>(args[i]->constant_type);
+			if (!type_is_integral_or_bool(*arg_types[i]) || arg_types[i]->columns != 1)
+				return false;
+		}
 
-bool Compiler::AnalyzeVariableScopeAccessHandler::id_is_phi_variable(uint32_t id) const
-{
-	if (id >= compiler.get_current_id_bound())
-		return false;
-	auto *var = compiler.maybe_get<SPIRVariable>(id);
-	return var && var->phi_variable;
-}
+		uint32_t width = result_type.basetype == SPIRType::Boolean ? 1 : result_type.width;
 
-bool Compiler::AnalyzeVariableScopeAccessHandler::id_is_potential_temporary(uint32_t id) const
-{
-	if (id >= compiler.get_current_id_bound())
-		return false;
+		for (uint32_t i = 0; i < result_type.vecsize; i++)
+		{
+			uint64_t a = 0, b = 0, c = 0;
+			uint32_t a_width = arg_types[0]->width;
+			a = read_constant_component(*args[0], *arg_types[0], arg_types[0]->vecsize > 1 ? i : 0);
+			if (args[1])
+				b = read_constant_component(*args[1], *arg_types[1], arg_types[1]->vecsize > 1 ? i : 0);
+			if (args[2])
+				c = read_constant_component(*args[2], *arg_types[2], arg_types[2]->vecsize > 1 ? i : 0);
+
+			auto sa = int64_t(sign_extend(a, a_width));
+			auto sb = int64_t(args[1] ? sign_extend(b, arg_types[1]->width) : 0);
+			uint64_t value = 0;
+
+#define unsigned_spec_op(op, unsigned_op) \
+	case Op##op:                          \
+		value = a unsigned_op b;          \
+		break
+#define signed_spec_op(op, signed_op) \
+	case Op##op:                      \
+		value = sa signed_op sb;      \
+		break
 
-	// Temporaries are not created before we start emitting code.
-	return compiler.ir.ids[id].empty() || (compiler.ir.ids[id].get_type() == TypeExpression);
-}
+			switch (op.opcode)
+			{
+				unsigned_spec_op(IAdd, +);
+				unsigned_spec_op(ISub, -);
+				unsigned_spec_op(IMul, *);
+				unsigned_spec_op(BitwiseAnd, &);
+				unsigned_spec_op(BitwiseOr, |);
+				unsigned_spec_op(BitwiseXor, ^);
+				unsigned_spec_op(LogicalAnd, &&);
+				unsigned_spec_op(LogicalOr, ||);
+				unsigned_spec_op(LogicalEqual, ==);
+				unsigned_spec_op(LogicalNotEqual, !=);
+				unsigned_spec_op(IEqual, ==);
+				unsigned_spec_op(INotEqual, !=);
+				unsigned_spec_op(ULessThan, <);
+				unsigned_spec_op(ULessThanEqual, <=);
+				unsigned_spec_op(UGreaterThan, >);
+				unsigned_spec_op(UGreaterThanEqual, >=);
+				signed_spec_op(SLessThan, <);
+				signed_spec_op(SLessThanEqual, <=);
+				signed_spec_op(SGreaterThan, >);
+				signed_spec_op(SGreaterThanEqual, >=);
+#undef unsigned_spec_op
+#undef signed_spec_op
+
+			case OpLogicalNot:
+				value = !a;
+				break;
 
-bool Compiler::AnalyzeVariableScopeAccessHandler::handle_terminator(const SPIRBlock &block)
-{
-	switch (block.terminator)
-	{
-	case SPIRBlock::Return:
-		if (block.return_value)
-			notify_variable_access(block.return_value, block.self);
-		break;
+			case OpNot:
+				value = ~a;
+				break;
 
-	case SPIRBlock::Select:
-	case SPIRBlock::MultiSelect:
-		notify_variable_access(block.condition, block.self);
-		break;
+			case OpSNegate:
+				value = 0ull - a;
+				break;
 
-	default:
+			case OpSelect:
+				value = a ? b : c;
+				break;
+
+			case OpUConvert:
+				value = a;
+				break;
+
+			case OpSConvert:
+				value = uint64_t(sa);
+				break;
+
+			case OpShiftLeftLogical:
+			case OpShiftRightLogical:
+			case OpShiftRightArithmetic:
+				// Shifting by the width or more is undefined, so leave it to the driver.
+				if (b >= width)
+					return false;
+				if (op.opcode == OpShiftLeftLogical)
+					value = a << b;
+				else if (op.opcode == OpShiftRightLogical)
+					value = a >> b;
+				else
+					value = uint64_t(sa >> b);
+				break;
+
+			case OpUDiv:
+			case OpUMod:
+				if (b == 0)
+					return false;
+				value = op.opcode == OpUDiv ? a / b : a % b;
+				break;
+
+			case OpSDiv:
+			case OpSRem:
+			case OpSMod:
+			{
+				// Division by zero and overflow are undefined, so leave those to the driver.
+				if (sb == 0 || (sb == -1 && uint64_t(sa) == sign_extend(1ull << (a_width - 1), a_width)))
+					return false;
+
+				if (op.opcode == OpSDiv)
+					value = uint64_t(sa / sb);
+				else
+				{
+					auto v = sa % sb;
+					// SMod matches the sign of b, not a.
+					if (op.opcode == OpSMod && ((sb < 0 && v > 0) || (sb > 0 && v < 0)))
+						v += sb;
+					value = uint64_t(v);
+				}
+				break;
+			}
+
+			default:
+				return false;
+			}
+
+			write_constant_component(result, result_type, i, value);
+		}
 		break;
 	}
+	}
 
+	uint32_t id = op.self;
+	ir.ids[id].set_allow_type_rewrite();
+	set<SPIRConstant>(id, result);
 	return true;
 }
 
-bool Compiler::AnalyzeVariableScopeAccessHandler::handle(spv::Op op, const uint32_t *args, uint32_t length)
+bool Compiler::prune_specialized_branches(SPIRFunction &func)
 {
-	// Keep track of the types of temporaries, so we can hoist them out as necessary.
-	uint32_t result_type, result_id;
-	if (compiler.instruction_to_result_type(result_type, result_id, op, args, length))
-	{
-		// For some opcodes, we will need to override the result id.
-		// If we need to hoist the temporary, the temporary type is the input, not the result.
-		// FIXME: This will likely break with OpCopyObject + hoisting, but we'll have to
-		// solve it if we ever get there ...
-		if (op == OpConvertUToAccelerationStructureKHR)
+	const auto reachable_blocks = [&]() {
+		unordered_set<uint32_t> reachable;
+		SmallVector<uint32_t> stack = { func.entry_block };
+		const auto push = [&](uint32_t target) {
+			if (target && reachable.insert(target).second)
+				stack.push_back(target);
+		};
+
+		reachable.insert(func.entry_block);
+		while (!stack.empty())
 		{
-			auto itr = result_id_to_type.find(args[2]);
-			if (itr != result_id_to_type.end())
-				result_type = itr->second;
+			auto &block = get<SPIRBlock>(stack.back());
+			stack.pop_back();
+
+			// Merge and continue targets of live constructs stay, since the constructs are emitted around them.
+			push(block.next_block);
+			push(block.merge_block);
+			push(block.continue_block);
+			if (block.terminator == SPIRBlock::Select)
+			{
+				push(block.true_block);
+				push(block.false_block);
+			}
+			else if (block.terminator == SPIRBlock::MultiSelect)
+			{
+				push(block.default_block);
+				for (auto &c : get_case_list(block))
+					push(c.block);
+			}
 		}
+		return reachable;
+	};
 
-		result_id_to_type[result_id] = result_type;
-	}
+	const auto known_constant = [&](uint32_t id) -> const SPIRConstant * {
+		auto *c = maybe_get<SPIRConstant>(id);
+		return c && !c->specialization && c->subconstants.empty() ? c : nullptr;
+	};
 
-	switch (op)
-	{
-	case OpStore:
-	{
-		if (length < 2)
-			return false;
+	auto reachable_before = reachable_blocks();
+	bool pruned = false;
+	uint32_t selector_id = 0;
+	SmallVector<uint32_t> block_like_headers;
 
-		ID ptr = args[0];
-		auto *var = compiler.maybe_get_backing_variable(ptr);
+	for (auto block_id : func.blocks)
+	{
+		auto &block = get<SPIRBlock>(block_id);
+		if (block.merge != SPIRBlock::MergeSelection)
+			continue;
 
-		// If we store through an access chain, we have a partial write.
-		if (var)
+		if (block.terminator == SPIRBlock::Select)
 		{
-			accessed_variables_to_block[var->self].insert(current_block->self);
-			if (var->self == ptr)
-				complete_write_variables_to_block[var->self].insert(current_block->self);
+			auto *c = known_constant(block.condition);
+			if (!c)
+				continue;
+
+			uint32_t taken = c->scalar() != 0 ? block.true_block : block.false_block;
+			if (taken == block.next_block)
+			{
+				block.condition = 0;
+				block.true_block = 0;
+				block.false_block = 0;
+				block.merge = SPIRBlock::MergeNone;
+				block.terminator = SPIRBlock::Direct;
+			}
 			else
-				partial_write_variables_to_block[var->self].insert(current_block->self);
+			{
+				// The taken branch might still break out to the merge block, so keep a construct for it,
+				// the same way the parser handles selections which branch to the same block either way.
+				if (!selector_id)
+				{
+					selector_id = ir.increase_bound_by(2);
+
+					SPIRType type;
+					type.basetype = SPIRType::Int;
+					type.width = 32;
+					set<SPIRType>(selector_id, type);
+					set<SPIRConstant>(selector_id + 1, selector_id);
+				}
+
+				block.condition = selector_id + 1;
+				block.default_block = taken;
+				block.terminator = SPIRBlock::MultiSelect;
+				ir.block_meta[block.next_block] &= ~ParsedIR::BLOCK_META_SELECTION_MERGE_BIT;
+				ir.block_meta[block.next_block] |= ParsedIR::BLOCK_META_MULTISELECT_MERGE_BIT;
+				block_like_headers.push_back(block_id);
+			}
+			pruned = true;
 		}
+		else if (block.terminator == SPIRBlock::MultiSelect && (!block.cases_32bit.empty() || !block.cases_64bit.empty()))
+		{
+			auto *c = known_constant(block.condition);
+			if (!c)
+				continue;
 
-		// args[0] might be an access chain we have to track use of.
-		notify_variable_access(args[0], current_block->self);
-		// Might try to store a Phi variable here.
-		notify_variable_access(args[1], current_block->self);
-		break;
+			auto &type = get<SPIRType>(c->constant_type);
+			uint64_t value = (type.width == 64 ? c->scalar_u64() : c->scalar()) & width_mask(type.width);
+			uint32_t taken = block.default_block;
+			for (auto &label : get_case_list(block))
+			{
+				if ((label.value & width_mask(type.width)) == value)
+				{
+					taken = label.block;
+					break;
+				}
+			}
+
+			// With no cases left, the switch is emitted as a plain block, or not at all if it only reaches the merge.
+			block.cases_32bit.clear();
+			block.cases_64bit.clear();
+			block.default_block = taken;
+			if (taken != block.next_block)
+				block_like_headers.push_back(block_id);
+			pruned = true;
+		}
 	}
 
-	case OpAccessChain:
-	case OpInBoundsAccessChain:
-	case OpPtrAccessChain:
+	if (!pruned)
+		return false;
+
+	// Calls from blocks which can no longer execute must not keep their functions alive.
+	auto reachable_after = reachable_blocks();
+	for (auto block_id : reachable_before)
 	{
-		if (length < 3)
-			return false;
+		if (reachable_after.count(block_id))
+			continue;
 
-		// Access chains used in multiple blocks mean hoisting all the variables used to construct the access chain as not all backends can use pointers.
-		uint32_t ptr = args[2];
-		auto *var = compiler.maybe_get<SPIRVariable>(ptr);
-		if (var)
+		auto &block = get<SPIRBlock>(block_id);
+		block.ops.clear();
+		block.terminator = SPIRBlock::Unreachable;
+		block.merge = SPIRBlock::MergeNone;
+		block.condition = 0;
+		block.return_value = 0;
+	}
+
+	// A construct is only needed if the taken branch breaks out to the merge block in more than one place.
+	// Otherwise the merge block can follow the branch directly.
+	unordered_map<uint32_t, uint32_t> merge_predecessors;
+	for (auto header : block_like_headers)
+		merge_predecessors[get<SPIRBlock>(header).next_block] = 0;
+
+	for (auto block_id : reachable_after)
+	{
+		auto &block = get<SPIRBlock>(block_id);
+		const auto count = [&](uint32_t target) {
+			auto itr = merge_predecessors.find(target);
+			if (itr != end(merge_predecessors))
+				itr->second++;
+		};
+
+		if (block.terminator == SPIRBlock::Direct)
+			count(block.next_block);
+		else if (block.terminator == SPIRBlock::Select)
 		{
-			accessed_variables_to_block[var->self].insert(current_block->self);
-			rvalue_forward_children[args[1]].insert(var->self);
+			count(block.true_block);
+			count(block.false_block);
 		}
-
-		// args[2] might be another access chain we have to track use of.
-		for (uint32_t i = 2; i < length; i++)
+		else if (block.terminator == SPIRBlock::MultiSelect)
 		{
-			notify_variable_access(args[i], current_block->self);
-			rvalue_forward_children[args[1]].insert(args[i]);
+			count(block.default_block);
+			for (auto &c : get_case_list(block))
+				count(c.block);
 		}
+	}
 
-		// Also keep track of the access chain pointer itself.
-		// In exceptionally rare cases, we can end up with a case where
-		// the access chain is generated in the loop body, but is consumed in continue block.
-		// This means we need complex loop workarounds, and we must detect this via CFG analysis.
-		notify_variable_access(args[1], current_block->self);
-
-		// The result of an access chain is a fixed expression and is not really considered a temporary.
-		auto &e = compiler.set<SPIRExpression>(args[1], "", args[0], true);
-		auto *backing_variable = compiler.maybe_get_backing_variable(ptr);
-		e.loaded_from = backing_variable ? VariableID(backing_variable->self) : VariableID(0);
+	for (auto header : block_like_headers)
+	{
+		auto &block = get<SPIRBlock>(header);
+		auto &merge_meta = ir.block_meta[block.next_block];
+		const ParsedIR::BlockMetaFlags selection_merge_bits =
+		    ParsedIR::BLOCK_META_SELECTION_MERGE_BIT | ParsedIR::BLOCK_META_MULTISELECT_MERGE_BIT;
+		if (merge_predecessors[block.next_block] > 1 || (merge_meta & ~selection_merge_bits) != 0)
+			continue;
 
-		// Other backends might use SPIRAccessChain for this later.
-		compiler.ir.ids[args[1]].set_allow_type_rewrite();
-		access_chain_expressions.insert(args[1]);
-		break;
+		merge_meta &= ~selection_merge_bits;
+		block.next_block = block.default_block;
+		block.default_block = 0;
+		block.condition = 0;
+		block.true_block = 0;
+		block.false_block = 0;
+		block.merge = SPIRBlock::MergeNone;
+		block.terminator = SPIRBlock::Direct;
 	}
 
-	case OpCopyMemory:
-	{
-		if (length < 2)
-			return false;
+	return true;
+}
 
-		ID lhs = args[0];
-		ID rhs = args[1];
-		auto *var = compiler.maybe_get_backing_variable(lhs);
+void Compiler::specialize_constants()
+{
+	if (specialization_constant_values.empty())
+		return;
 
-		// If we store through an access chain, we have a partial write.
-		if (var)
+	// Constants are declared before their uses, so one pass in declaration order folds whole expression trees.
+	// Turning a constant op into a constant appends it to the ID lists, so iterate over a copy.
+	auto declaration_order = ir.ids_for_constant_undef_or_type;
+	for (auto id : declaration_order)
+	{
+		if (auto *op = maybe_get<SPIRConstantOp>(id))
 		{
-			accessed_variables_to_block[var->self].insert(current_block->self);
-			if (var->self == lhs)
-				complete_write_variables_to_block[var->self].insert(current_block->self);
-			else
-				partial_write_variables_to_block[var->self].insert(current_block->self);
+			fold_specialization_constant_op(*op);
+			continue;
 		}
 
-		// args[0:1] might be access chains we have to track use of.
-		for (uint32_t i = 0; i < 2; i++)
-			notify_variable_access(args[i], current_block->self);
+		auto *c = maybe_get<SPIRConstant>(id);
+		if (!c || !c->specialization)
+			continue;
 
-		var = compiler.maybe_get_backing_variable(rhs);
-		if (var)
-			accessed_variables_to_block[var->self].insert(current_block->self);
-		break;
-	}
+		if (c->subconstants.empty() && c->m.columns == 1 && c->m.c[0].vecsize == 1 &&
+		    has_decoration(c->self, DecorationSpecId))
+		{
+			auto itr = specialization_constant_values.find(get_decoration(c->self, DecorationSpecId));
+			if (itr != end(specialization_constant_values))
+			{
+				write_constant_component(*c, get<SPIRType>(c->constant_type), 0, itr->second);
+				c->specialization = false;
+			}
+			continue;
+		}
 
-	case OpCopyObject:
-	{
-		if (length < 3)
-			return false;
+		// Composites stay specialization constants until every element they are built from is known.
+		bool known = true;
+		for (auto sub : c->subconstants)
+		{
+			auto *sub_c = maybe_get<SPIRConstant>(sub);
+			if (!sub_c || sub_c->specialization)
+				known = false;
+		}
 
-		auto *var = compiler.maybe_get_backing_variable(args[2]);
-		if (var)
-			accessed_variables_to_block[var->self].insert(current_block->self);
+		for (uint32_t col = 0; col < c->m.columns; col++)
+		{
+			if (c->m.id[col])
+			{
+				auto *column = maybe_get<SPIRConstant>(c->m.id[col]);
+				if (!column || column->specialization)
+					known = false;
+				else
+				{
+					c->m.c[col] = column->m.c[0];
+					c->m.id[col] = 0;
+				}
+			}
 
-		// Might be an access chain which we have to keep track of.
-		notify_variable_access(args[1], current_block->self);
-		if (access_chain_expressions.count(args[2]))
-			access_chain_expressions.insert(args[1]);
+			for (uint32_t row = 0; row < c->m.c[col].vecsize; row++)
+			{
+				if (c->m.c[col].id[row])
+				{
+					auto *element = maybe_get<SPIRConstant>(c->m.c[col].id[row]);
+					if (!element || element->specialization)
+						known = false;
+					else
+					{
+						c->m.c[col].r[row] = element->m.c[0].r[0];
+						c->m.c[col].id[row] = 0;
+					}
+				}
+			}
+		}
 
-		// Might try to copy a Phi variable here.
-		notify_variable_access(args[2], current_block->self);
-		break;
+		if (known)
+			c->specialization = false;
 	}
 
-	case OpLoad:
-	{
-		if (length < 3)
-			return false;
-		uint32_t ptr = args[2];
-		auto *var = compiler.maybe_get_backing_variable(ptr);
-		if (var)
-			accessed_variables_to_block[var->self].insert(current_block->self);
-
-		// Loaded value is a temporary.
-		notify_variable_access(args[1], current_block->self);
+	const auto remove_duplicates = [](SmallVector<ID> &ids) {
+		unordered_set<uint32_t> seen;
+		ids.erase(remove_if(begin(ids), end(ids), [&](ID id) { return !seen.insert(id).second; }), end(ids));
+	};
+	remove_duplicates(ir.ids_for_constant_undef_or_type);
+	remove_duplicates(ir.ids_for_constant_or_variable);
 
-		// Might be an access chain we have to track use of.
-		notify_variable_access(args[2], current_block->self);
+	// Array sizes which are now known become literals.
+	ir.for_each_typed_id<SPIRType>([&](uint32_t, SPIRType &type) {
+		for (size_t i = 0; i < type.array.size(); i++)
+		{
+			if (type.array_size_literal[i])
+				continue;
+			auto *c = maybe_get<SPIRConstant>(type.array[i]);
+			if (c && !c->specialization)
+			{
+				type.array[i] = c->scalar();
+				type.array_size_literal[i] = true;
+			}
+		}
+	});
+	ir.invalidate_type_layouts();
 
-		// If we're loading an opaque type we cannot lower it to a temporary,
-		// we must defer access of args[2] until it's used.
-		auto &type = compiler.get<SPIRType>(args[0]);
-		if (compiler.type_is_opaque_value(type))
-			rvalue_forward_children[args[1]].insert(args[2]);
-		break;
+	for (auto &entry : ir.entry_points)
+	{
+		auto &wg = entry.second.workgroup_size;
+		if (wg.constant)
+		{
+			auto &c = get<SPIRConstant>(wg.constant);
+			wg.x = c.scalar(0, 0);
+			wg.y = c.scalar(0, 1);
+			wg.z = c.scalar(0, 2);
+		}
 	}
 
-	case OpFunctionCall:
-	{
-		if (length < 3)
-			return false;
+	// Pruning can add a selector constant, so iterate over a copy.
+	auto functions = ir.ids_for_type[TypeFunction];
+	for (auto func : functions)
+		if (prune_specialized_branches(get<SPIRFunction>(func)))
+			specialized_control_flow = true;
+}
 
-		// Return value may be a temporary.
-		if (compiler.get_type(args[0]).basetype != SPIRType::Void)
-			notify_variable_access(args[1], current_block->self);
+unordered_set<uint32_t> Compiler::get_types_referenced_after_specialization() const
+{
+	unordered_set<uint32_t> referenced;
+	ReachableIDsHandler handler(referenced);
+	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
+	referenced.insert(ir.default_entry_point);
 
-		length -= 3;
-		args += 3;
+	// Specialization constants and global variables are always declared,
+	// regular constants only where something refers to them.
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t self, const SPIRConstant &c) {
+		if (c.specialization)
+			referenced.insert(self);
+	});
+	ir.for_each_typed_id<SPIRConstantOp>([&](uint32_t self, const SPIRConstantOp &) { referenced.insert(self); });
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t self, const SPIRVariable &var) {
+		if (var.storage != StorageClassFunction)
+			referenced.insert(self);
+	});
 
-		for (uint32_t i = 0; i < length; i++)
-		{
-			auto *var = compiler.maybe_get_backing_variable(args[i]);
-			if (var)
-			{
-				accessed_variables_to_block[var->self].insert(current_block->self);
-				// Assume we can get partial writes to this variable.
-				partial_write_variables_to_block[var->self].insert(current_block->self);
-			}
+	unordered_set<uint32_t> types;
+	SmallVector<uint32_t> pending_types;
+	const auto keep_type = [&](uint32_t id) {
+		if (id < ir.ids.size() && ir.ids[id].get_type() == TypeType && types.insert(id).second)
+			pending_types.push_back(id);
+	};
 
-			// Cannot easily prove if argument we pass to a function is completely written.
-			// Usually, functions write to a dummy variable,
-			// which is then copied to in full to the real argument.
+	unordered_set<uint32_t> seen;
+	SmallVector<uint32_t> pending;
+	for (auto id : referenced)
+		pending.push_back(id);
+	while (!pending.empty())
+	{
+		uint32_t id = pending.back();
+		pending.pop_back();
+		if (id >= ir.ids.size() || !seen.insert(id).second)
+			continue;
 
-			// Might try to copy a Phi variable here.
-			notify_variable_access(args[i], current_block->self);
-		}
-		break;
-	}
+		switch (ir.ids[id].get_type())
+		{
+		case TypeType:
+			keep_type(id);
+			break;
 
-	case OpSelect:
-	{
-		// In case of variable pointers, we might access a variable here.
-		// We cannot prove anything about these accesses however.
-		for (uint32_t i = 1; i < length; i++)
+		case TypeConstant:
 		{
-			if (i >= 3)
+			auto &c = get<SPIRConstant>(id);
+			keep_type(c.constant_type);
+			for (auto sub : c.subconstants)
+				pending.push_back(sub);
+			for (uint32_t col = 0; col < c.columns(); col++)
 			{
-				auto *var = compiler.maybe_get_backing_variable(args[i]);
-				if (var)
-				{
-					accessed_variables_to_block[var->self].insert(current_block->self);
-					// Assume we can get partial writes to this variable.
-					partial_write_variables_to_block[var->self].insert(current_block->self);
-				}
+				pending.push_back(c.specialization_constant_id(col));
+				for (uint32_t row = 0; row < c.vector_size(); row++)
+					pending.push_back(c.specialization_constant_id(col, row));
 			}
+			break;
+		}
 
-			// Might try to copy a Phi variable here.
-			notify_variable_access(args[i], current_block->self);
+		case TypeConstantOp:
+		{
+			auto &op = get<SPIRConstantOp>(id);
+			keep_type(op.basetype);
+			pending.insert(end(pending), begin(op.arguments), end(op.arguments));
+			break;
 		}
-		break;
-	}
 
-	case OpExtInst:
-	{
-		for (uint32_t i = 4; i < length; i++)
-			notify_variable_access(args[i], current_block->self);
-		notify_variable_access(args[1], current_block->self);
+		case TypeUndef:
+			keep_type(get<SPIRUndef>(id).basetype);
+			break;
 
-		uint32_t extension_set = args[2];
-		if (compiler.get<SPIRExtension>(extension_set).ext == SPIRExtension::GLSL)
+		case TypeVariable:
 		{
-			auto op_450 = static_cast<GLSLstd450>(args[3]);
-			switch (op_450)
-			{
-			case GLSLstd450Modf:
-			case GLSLstd450Frexp:
-			{
-				uint32_t ptr = args[5];
-				auto *var = compiler.maybe_get_backing_variable(ptr);
-				if (var)
-				{
-					accessed_variables_to_block[var->self].insert(current_block->self);
-					if (var->self == ptr)
-						complete_write_variables_to_block[var->self].insert(current_block->self);
-					else
-						partial_write_variables_to_block[var->self].insert(current_block->self);
-				}
-				break;
-			}
+			auto &var = get<SPIRVariable>(id);
+			keep_type(var.basetype);
+			pending.push_back(var.initializer);
+			break;
+		}
 
-			default:
-				break;
-			}
+		case TypeFunction:
+		{
+			auto &func = get<SPIRFunction>(id);
+			keep_type(func.return_type);
+			for (auto &arg : func.arguments)
+				keep_type(arg.type);
+			break;
+		}
+
+		default:
+			break;
 		}
-		break;
 	}
 
-	case OpArrayLength:
-		// Only result is a temporary.
-		notify_variable_access(args[1], current_block->self);
-		break;
+	while (!pending_types.empty())
+	{
+		auto &type = get<SPIRType>(pending_types.back());
+		pending_types.pop_back();
 
-	case OpLine:
-	case OpNoLine:
-		// Uses literals, but cannot be a phi variable or temporary, so ignore.
-		break;
+		keep_type(type.parent_type);
+		keep_type(type.type_alias);
+		keep_type(type.image.type);
+		for (auto member : type.member_types)
+			keep_type(member);
+	}
 
-		// Atomics shouldn't be able to access function-local variables.
-		// Some GLSL builtins access a pointer.
+	return types;
+}
 
-	case OpCompositeInsert:
-	case OpVectorShuffle:
-		// Specialize for opcode which contains literals.
-		for (uint32_t i = 1; i < 4; i++)
-			notify_variable_access(args[i], current_block->self);
-		break;
+void Compiler::analyze_parameter_preservation(SPIRFunction &entry, const CFG &cfg,
+                                              const AnalyzeVariableScopeAccessHandler &handler)
+{
+	// Arguments which are written completely in some blocks, and need to know if the writes cover every path.
+	SmallVector<SPIRFunction::Parameter *> candidates;
+	// Indexed by block index, the candidates which are completely written in that block.
+	SmallVector<DenseBitset> complete_writes(entry.blocks.size());
 
-	case OpCompositeExtract:
-		// Specialize for opcode which contains literals.
-		for (uint32_t i = 1; i < 3; i++)
-			notify_variable_access(args[i], current_block->self);
-		break;
+	for (auto &arg : entry.arguments)
+	{
+		// Non-pointers are always inputs.
+		auto &type = get<SPIRType>(arg.type);
+		if (!type.pointer)
+			continue;
 
-	case OpImageWrite:
-		for (uint32_t i = 0; i < length; i++)
+		// Opaque argument types are always in
+		bool potential_preserve;
+		switch (type.basetype)
 		{
-			// Argument 3 is a literal.
-			if (i != 3)
-				notify_variable_access(args[i], current_block->self);
+		case SPIRType::Sampler:
+		case SPIRType::Image:
+		case SPIRType::SampledImage:
+		case SPIRType::AtomicCounter:
+			potential_preserve = false;
+			break;
+
+		default:
+			potential_preserve = true;
+			break;
 		}
-		break;
 
-	case OpImageSampleImplicitLod:
-	case OpImageSampleExplicitLod:
-	case OpImageSparseSampleImplicitLod:
-	case OpImageSparseSampleExplicitLod:
-	case OpImageSampleProjImplicitLod:
-	case OpImageSampleProjExplicitLod:
-	case OpImageSparseSampleProjImplicitLod:
-	case OpImageSparseSampleProjExplicitLod:
-	case OpImageFetch:
-	case OpImageSparseFetch:
-	case OpImageRead:
-	case OpImageSparseRead:
-		for (uint32_t i = 1; i < length; i++)
+		if (!potential_preserve)
+			continue;
+
+		if (handler.accessed_variables_to_block.find(arg.id) == end(handler.accessed_variables_to_block))
 		{
-			// Argument 4 is a literal.
-			if (i != 4)
-				notify_variable_access(args[i], current_block->self);
+			// Variable is never accessed.
+			continue;
 		}
-		break;
 
-	case OpImageSampleDrefImplicitLod:
-	case OpImageSampleDrefExplicitLod:
-	case OpImageSparseSampleDrefImplicitLod:
-	case OpImageSparseSampleDrefExplicitLod:
-	case OpImageSampleProjDrefImplicitLod:
-	case OpImageSampleProjDrefExplicitLod:
-	case OpImageSparseSampleProjDrefImplicitLod:
-	case OpImageSparseSampleProjDrefExplicitLod:
-	case OpImageGather:
-	case OpImageSparseGather:
-	case OpImageDrefGather:
-	case OpImageSparseDrefGather:
-		for (uint32_t i = 1; i < length; i++)
+		// We have accessed a variable, but there was no complete writes to that variable.
+		// We deduce that we must preserve the argument.
+		auto itr = handler.complete_write_variables_to_block.find(arg.id);
+		if (itr == end(handler.complete_write_variables_to_block))
 		{
-			// Argument 5 is a literal.
-			if (i != 5)
-				notify_variable_access(args[i], current_block->self);
+			arg.read_count++;
+			continue;
 		}
-		break;
 
-	default:
-	{
-		// Rather dirty way of figuring out where Phi variables are used.
-		// As long as only IDs are used, we can scan through instructions and try to find any evidence that
-		// the ID of a variable has been used.
-		// There are potential false positives here where a literal is used in-place of an ID,
-		// but worst case, it does not affect the correctness of the compile.
-		// Exhaustive analysis would be better here, but it's not worth it for now.
-		for (uint32_t i = 0; i < length; i++)
-			notify_variable_access(args[i], current_block->self);
-		break;
+		uint32_t candidate = uint32_t(candidates.size());
+		candidates.push_back(&arg);
+		itr->second.for_each_bit([&](uint32_t block) { complete_writes[block].set(candidate); });
 	}
+
+	if (candidates.empty())
+		return;
+
+	// If there is a path through the CFG where no block completely writes to the variable, the variable will be in an undefined state
+	// when the function returns. We therefore need to implicitly preserve the variable in case there are writers in the function.
+	// Major case here is if a function is
+	// void foo(int &var) { if (cond) var = 10; }
+	// Using read/write counts, we will think it's just an out variable, but it really needs to be inout,
+	// because if we don't write anything whatever we put into the function must return back to the caller.
+
+	// Forward dataflow for all candidates at once: a candidate is unwritten in a block
+	// if the block can be reached from the entry without passing a block which writes the candidate.
+	SmallVector<uint32_t> blocks;
+	for (uint32_t i = 0; i < uint32_t(entry.blocks.size()); i++)
+		if (cfg.is_reachable(entry.blocks[i]))
+			blocks.push_back(i);
+
+	// Visit in reverse post-order, so only loops need more than one pass.
+	sort(begin(blocks), end(blocks), [&](uint32_t a, uint32_t b) {
+		return cfg.get_visit_order(entry.blocks[a]) > cfg.get_visit_order(entry.blocks[b]);
+	});
+
+	SmallVector<DenseBitset> unwritten(entry.blocks.size());
+	uint32_t entry_index = handler.get_block_index(entry.entry_block);
+	for (uint32_t i = 0; i < uint32_t(candidates.size()); i++)
+		unwritten[entry_index].set(i);
+	unwritten[entry_index].merge_and_not(complete_writes[entry_index]);
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (auto block : blocks)
+		{
+			for (auto succ : cfg.get_succeeding_edges(entry.blocks[block]))
+			{
+				uint32_t succ_index = handler.get_block_index(succ);
+				DenseBitset reached = unwritten[block];
+				reached.merge_and_not(complete_writes[succ_index]);
+				if (unwritten[succ_index].merge_or(reached))
+					changed = true;
+			}
+		}
 	}
-	return true;
+
+	// Blocks without successors are the end of the CFG.
+	DenseBitset unwritten_at_return;
+	for (auto block : blocks)
+		if (cfg.get_succeeding_edges(entry.blocks[block]).empty())
+			unwritten_at_return.merge_or(unwritten[block]);
+
+	unwritten_at_return.for_each_bit([&](uint32_t candidate) { candidates[candidate]->read_count++; });
 }
 
-Compiler::StaticExpressionAccessHandler::StaticExpressionAccessHandler(Compiler &compiler_, uint32_t variable_id_)
+Compiler::AnalyzeVariableScopeAccessHandler::AnalyzeVariableScopeAccessHandler(Compiler &compiler_,
+                                                                               SPIRFunction &entry_)
     : compiler(compiler_)
-    , variable_id(variable_id_)
+    , entry(entry_)
 {
+	// Block IDs of a function are allocated close together, so a flat array covers them.
+	if (entry.blocks.empty())
+		return;
+
+	auto range = minmax_element(begin(entry.blocks), end(entry.blocks));
+	block_id_base = *range.first;
+	block_id_to_index.resize(*range.second - block_id_base + 1);
+	for (auto &index : block_id_to_index)
+		index = ~0u;
+	for (uint32_t i = 0; i < uint32_t(entry.blocks.size()); i++)
+		block_id_to_index[entry.blocks[i] - block_id_base] = i;
 }
 
-bool Compiler::StaticExpressionAccessHandler::follow_function_call(const SPIRFunction &)
+uint32_t Compiler::AnalyzeVariableScopeAccessHandler::get_block_index(uint32_t block) const
 {
-	return false;
+	uint32_t slot = block - block_id_base;
+	if (slot >= block_id_to_index.size() || block_id_to_index[slot] == ~0u)
+		SPIRV_CROSS_THROW("Block is not part of the function.");
+	return block_id_to_index[slot];
 }
 
-bool Compiler::StaticExpressionAccessHandler::handle(spv::Op op, const uint32_t *args, uint32_t length)
+bool Compiler::AnalyzeVariableScopeAccessHandler::follow_function_call(const SPIRFunction &)
 {
-	switch (op)
-	{
-	case OpStore:
-		if (length < 2)
-			return false;
-		if (args[0] == variable_id)
+	// Only analyze within this function.
+	return false;
+}
+
+void Compiler::AnalyzeVariableScopeAccessHandler::set_current_block(const SPIRBlock &block)
+{
+	current_block = &block;
+	current_block_index = get_block_index(block.self);
+
+	// If we're branching to a block which uses OpPhi, in GLSL
+	// this will be a variable write when we branch,
+	// so we need to track access to these variables as well to
+	// have a complete picture.
+	const auto test_phi = [this, &block](uint32_t to) {
+		auto &next = compiler.get<SPIRBlock>(to);
+		for (auto &phi : next.phi_variables)
 		{
-			static_expression = args[1];
-			write_count++;
+			if (phi.parent == block.self)
+			{
+				accessed_variables_to_block[phi.function_variable].set(current_block_index);
+				// Phi variables are also accessed in our target branch block.
+				accessed_variables_to_block[phi.function_variable].set(get_block_index(next.self));
+
+				notify_variable_access(phi.local_variable, current_block_index);
+			}
 		}
+	};
+
+	switch (block.terminator)
+	{
+	case SPIRBlock::Direct:
+		notify_variable_access(block.condition, current_block_index);
+		test_phi(block.next_block);
 		break;
 
-	case OpLoad:
-		if (length < 3)
-			return false;
-		if (args[2] == variable_id && static_expression == 0) // Tried to read from variable before it was initialized.
-			return false;
+	case SPIRBlock::Select:
+		notify_variable_access(block.condition, current_block_index);
+		test_phi(block.true_block);
+		test_phi(block.false_block);
 		break;
 
-	case OpAccessChain:
-	case OpInBoundsAccessChain:
-	case OpPtrAccessChain:
-		if (length < 3)
-			return false;
-		if (args[2] == variable_id) // If we try to access chain our candidate variable before we store to it, bail.
-			return false;
+	case SPIRBlock::MultiSelect:
+	{
+		notify_variable_access(block.condition, current_block_index);
+		auto &cases = compiler.get_case_list(block);
+		for (auto &target : cases)
+			test_phi(target.block);
+		if (block.default_block)
+			test_phi(block.default_block);
 		break;
+	}
 
 	default:
 		break;
 	}
-
-	return true;
 }
 
-void Compiler::find_function_local_luts(SPIRFunction &entry, const AnalyzeVariableScopeAccessHandler &handler,
-                                        bool single_function)
+void Compiler::AnalyzeVariableScopeAccessHandler::notify_variable_access(uint32_t id, uint32_t block_index)
 {
-	auto &cfg = *function_cfgs.find(entry.self)->second;
-
-	// For each variable which is statically accessed.
-	for (auto &accessed_var : handler.accessed_variables_to_block)
-	{
-		auto &blocks = accessed_var.second;
-		auto &var = get<SPIRVariable>(accessed_var.first);
-		auto &type = expression_type(accessed_var.first);
-
-		// Only consider function local variables here.
-		// If we only have a single function in our CFG, private storage is also fine,
-		// since it behaves like a function local variable.
-		bool allow_lut = var.storage == StorageClassFunction || (single_function && var.storage == StorageClassPrivate);
-		if (!allow_lut)
-			continue;
-
-		// We cannot be a phi variable.
-		if (var.phi_variable)
-			continue;
-
-		// Only consider arrays here.
-		if (type.array.empty())
-			continue;
-
-		// If the variable has an initializer, make sure it is a constant expression.
-		uint32_t static_constant_expression = 0;
-		if (var.initializer)
-		{
-			if (ir.ids[var.initializer].get_type() != TypeConstant)
-				continue;
-			static_constant_expression = var.initializer;
-
-			// There can be no stores to this variable, we have now proved we have a LUT.
-			if (handler.complete_write_variables_to_block.count(var.self) != 0 ||
-			    handler.partial_write_variables_to_block.count(var.self) != 0)
-				continue;
-		}
-		else
-		{
-			// We can have one, and only one write to the variable, and that write needs to be a constant.
+	if (id == 0)
+		return;
 
-			// No partial writes allowed.
-			if (handler.partial_write_variables_to_block.count(var.self) != 0)
-				continue;
+	// Access chains used in multiple blocks mean hoisting all the variables used to construct the access chain as not all backends can use pointers.
+	auto itr = rvalue_forward_children.find(id);
+	if (itr != end(rvalue_forward_children))
+		for (auto child_id : itr->second)
+			notify_variable_access(child_id, block_index);
 
-			auto itr = handler.complete_write_variables_to_block.find(var.self);
+	if (id_is_phi_variable(id))
+		accessed_variables_to_block[id].set(block_index);
+	else if (id_is_potential_temporary(id))
+		accessed_temporaries_to_block[id].set(block_index);
+}
 
-			// No writes?
-			if (itr == end(handler.complete_write_variables_to_block))
-				continue;
+bool Compiler::AnalyzeVariableScopeAccessHandler::id_is_phi_variable(uint32_t id) const
+{
+	if (id >= compiler.get_current_id_bound())
+		return false;
+	auto *var = compiler.maybe_get<SPIRVariable>(id);
+	return var && var->phi_variable;
+}
 
-			// We write to the variable in more than one block.
-			auto &write_blocks = itr->second;
-			if (write_blocks.size() != 1)
-				continue;
+bool Compiler::AnalyzeVariableScopeAccessHandler::id_is_potential_temporary(uint32_t id) const
+{
+	if (id >= compiler.get_current_id_bound())
+		return false;
 
-			// The write needs to happen in the dominating block.
-			DominatorBuilder builder(cfg);
-			for (auto &block : blocks)
-				builder.add_block(block);
-			uint32_t dominator = builder.get_dominator();
+	// Temporaries are not created before we start emitting code.
+	return compiler.ir.ids[id].empty() || (compiler.ir.ids[id].get_type() == TypeExpression);
+}
 
-			// The complete write happened in a branch or similar, cannot deduce static expression.
-			if (write_blocks.count(dominator) == 0)
-				continue;
+bool Compiler::AnalyzeVariableScopeAccessHandler::handle_terminator(const SPIRBlock &block)
+{
+	switch (block.terminator)
+	{
+	case SPIRBlock::Return:
+		if (block.return_value)
+			notify_variable_access(block.return_value, current_block_index);
+		break;
 
-			// Find the static expression for this variable.
-			StaticExpressionAccessHandler static_expression_handler(*this, var.self);
-			traverse_all_reachable_opcodes(get<SPIRBlock>(dominator), static_expression_handler);
+	case SPIRBlock::Select:
+	case SPIRBlock::MultiSelect:
+		notify_variable_access(block.condition, current_block_index);
+		break;
 
-			// We want one, and exactly one write
-			if (static_expression_handler.write_count != 1 || static_expression_handler.static_expression == 0)
-				continue;
+	default:
+		break;
+	}
 
-			// Is it a constant expression?
-			if (ir.ids[static_expression_handler.static_expression].get_type() != TypeConstant)
-				continue;
+	return true;
+}
 
-			// We found a LUT!
-			static_constant_expression = static_expression_handler.static_expression;
+bool Compiler::AnalyzeVariableScopeAccessHandler::handle(spv::Op op, const uint32_t *args, uint32_t length)
+{
+	// Keep track of the types of temporaries, so we can hoist them out as necessary.
+	uint32_t result_type, result_id;
+	if (compiler.instruction_to_result_type(result_type, result_id, op, args, length))
+	{
+		// For some opcodes, we will need to override the result id.
+		// If we need to hoist the temporary, the temporary type is the input, not the result.
+		// FIXME: This will likely break with OpCopyObject + hoisting, but we'll have to
+		// solve it if we ever get there ...
+		if (op == OpConvertUToAccelerationStructureKHR)
+		{
+			auto itr = result_id_to_type.find(args[2]);
+			if (itr != result_id_to_type.end())
+				result_type = itr->second;
 		}
 
-		get<SPIRConstant>(static_constant_expression).is_used_as_lut = true;
-		var.static_expression = static_constant_expression;
-		var.statically_assigned = true;
-		var.remapped_variable = true;
+		result_id_to_type[result_id] = result_type;
 	}
-}
 
-void Compiler::analyze_variable_scope(SPIRFunction &entry, AnalyzeVariableScopeAccessHandler &handler)
-{
-	// First, we map out all variable access within a function.
-	// Essentially a map of block -> { variables accessed in the basic block }
-	traverse_all_reachable_opcodes(entry, handler);
+	switch (op)
+	{
+	case OpStore:
+	{
+		if (length < 2)
+			return false;
 
-	auto &cfg = *function_cfgs.find(entry.self)->second;
+		ID ptr = args[0];
+		auto *var = compiler.maybe_get_backing_variable(ptr);
 
-	// Analyze if there are parameters which need to be implicitly preserved with an "in" qualifier.
-	analyze_parameter_preservation(entry, cfg, handler.accessed_variables_to_block,
-	                               handler.complete_write_variables_to_block);
+		// If we store through an access chain, we have a partial write.
+		if (var)
+		{
+			accessed_variables_to_block[var->self].set(current_block_index);
+			if (var->self == ptr)
+				complete_write_variables_to_block[var->self].set(current_block_index);
+			else
+				partial_write_variables_to_block[var->self].set(current_block_index);
+		}
 
-	unordered_map<uint32_t, uint32_t> potential_loop_variables;
+		// args[0] might be an access chain we have to track use of.
+		notify_variable_access(args[0], current_block_index);
+		// Might try to store a Phi variable here.
+		notify_variable_access(args[1], current_block_index);
+		break;
+	}
 
-	// Find the loop dominator block for each block.
-	for (auto &block_id : entry.blocks)
+	case OpAccessChain:
+	case OpInBoundsAccessChain:
+	case OpPtrAccessChain:
 	{
-		auto &block = get<SPIRBlock>(block_id);
+		if (length < 3)
+			return false;
 
-		auto itr = ir.continue_block_to_loop_header.find(block_id);
-		if (itr != end(ir.continue_block_to_loop_header) && itr->second != block_id)
+		// Access chains used in multiple blocks mean hoisting all the variables used to construct the access chain as not all backends can use pointers.
+		uint32_t ptr = args[2];
+		auto *var = compiler.maybe_get<SPIRVariable>(ptr);
+		if (var)
 		{
-			// Continue block might be unreachable in the CFG, but we still like to know the loop dominator.
-			// Edge case is when continue block is also the loop header, don't set the dominator in this case.
-			block.loop_dominator = itr->second;
+			accessed_variables_to_block[var->self].set(current_block_index);
+			rvalue_forward_children[args[1]].insert(var->self);
 		}
-		else
+
+		// args[2] might be another access chain we have to track use of.
+		for (uint32_t i = 2; i < length; i++)
 		{
-			uint32_t loop_dominator = cfg.find_loop_dominator(block_id);
-			if (loop_dominator != block_id)
-				block.loop_dominator = loop_dominator;
-			else
-				block.loop_dominator = SPIRBlock::NoDominator;
+			notify_variable_access(args[i], current_block_index);
+			rvalue_forward_children[args[1]].insert(args[i]);
 		}
-	}
 
-	// For each variable which is statically accessed.
-	for (auto &var : handler.accessed_variables_to_block)
-	{
-		// Only deal with variables which are considered local variables in this function.
-		if (find(begin(entry.local_variables), end(entry.local_variables), VariableID(var.first)) ==
-		    end(entry.local_variables))
-			continue;
+		// Also keep track of the access chain pointer itself.
+		// In exceptionally rare cases, we can end up with a case where
+		// the access chain is generated in the loop body, but is consumed in continue block.
+		// This means we need complex loop workarounds, and we must detect this via CFG analysis.
+		notify_variable_access(args[1], current_block_index);
 
-		DominatorBuilder builder(cfg);
-		auto &blocks = var.second;
-		auto &type = expression_type(var.first);
-		BlockID potential_continue_block = 0;
+		// The result of an access chain is a fixed expression and is not really considered a temporary.
+		auto &e = compiler.set<SPIRExpression>(args[1], "", args[0], true);
+		auto *backing_variable = compiler.maybe_get_backing_variable(ptr);
+		e.loaded_from = backing_variable ? VariableID(backing_variable->self) : VariableID(0);
 
-		// Figure out which block is dominating all accesses of those variables.
-		for (auto &block : blocks)
-		{
-			// If we're accessing a variable inside a continue block, this variable might be a loop variable.
-			// We can only use loop variables with scalars, as we cannot track static expressions for vectors.
-			if (is_continue(block))
-			{
-				// Potentially awkward case to check for.
-				// We might have a variable inside a loop, which is touched by the continue block,
-				// but is not actually a loop variable.
-				// The continue block is dominated by the inner part of the loop, which does not make sense in high-level
-				// language output because it will be declared before the body,
-				// so we will have to lift the dominator up to the relevant loop header instead.
-				builder.add_block(ir.continue_block_to_loop_header[block]);
+		// Other backends might use SPIRAccessChain for this later.
+		compiler.ir.ids[args[1]].set_allow_type_rewrite();
+		access_chain_expressions.insert(args[1]);
+		break;
+	}
 
-				// Arrays or structs cannot be loop variables.
-				if (type.vecsize == 1 && type.columns == 1 && type.basetype != SPIRType::Struct && type.array.empty())
-				{
-					// The variable is used in multiple continue blocks, this is not a loop
-					// candidate, signal that by setting block to -1u.
-					if (potential_continue_block == 0)
-						potential_continue_block = block;
-					else
-						potential_continue_block = ~(0u);
-				}
-			}
+	case OpCopyMemory:
+	{
+		if (length < 2)
+			return false;
 
-			builder.add_block(block);
+		ID lhs = args[0];
+		ID rhs = args[1];
+		auto *var = compiler.maybe_get_backing_variable(lhs);
+
+		// If we store through an access chain, we have a partial write.
+		if (var)
+		{
+			accessed_variables_to_block[var->self].set(current_block_index);
+			if (var->self == lhs)
+				complete_write_variables_to_block[var->self].set(current_block_index);
+			else
+				partial_write_variables_to_block[var->self].set(current_block_index);
 		}
 
-		builder.lift_continue_block_dominator();
+		// args[0:1] might be access chains we have to track use of.
+		for (uint32_t i = 0; i < 2; i++)
+			notify_variable_access(args[i], current_block_index);
 
-		// Add it to a per-block list of variables.
-		BlockID dominating_block = builder.get_dominator();
+		var = compiler.maybe_get_backing_variable(rhs);
+		if (var)
+			accessed_variables_to_block[var->self].set(current_block_index);
+		break;
+	}
 
-		if (dominating_block && potential_continue_block != 0 && potential_continue_block != ~0u)
-		{
-			auto &inner_block = get<SPIRBlock>(dominating_block);
+	case OpCopyObject:
+	{
+		if (length < 3)
+			return false;
 
-			BlockID merge_candidate = 0;
+		auto *var = compiler.maybe_get_backing_variable(args[2]);
+		if (var)
+			accessed_variables_to_block[var->self].set(current_block_index);
 
-			// Analyze the dominator. If it lives in a different loop scope than the candidate continue
-			// block, reject the loop variable candidate.
-			if (inner_block.merge == SPIRBlock::MergeLoop)
-				merge_candidate = inner_block.merge_block;
-			else if (inner_block.loop_dominator != SPIRBlock::NoDominator)
-				merge_candidate = get<SPIRBlock>(inner_block.loop_dominator).merge_block;
+		// Might be an access chain which we have to keep track of.
+		notify_variable_access(args[1], current_block_index);
+		if (access_chain_expressions.count(args[2]))
+			access_chain_expressions.insert(args[1]);
 
-			if (merge_candidate != 0 && cfg.is_reachable(merge_candidate))
+		// Might try to copy a Phi variable here.
+		notify_variable_access(args[2], current_block_index);
+		break;
+	}
+
+	case OpLoad:
+	{
+		if (length < 3)
+			return false;
+		uint32_t ptr = args[2];
+		auto *var = compiler.maybe_get_backing_variable(ptr);
+		if (var)
+			accessed_variables_to_block[var->self].set(current_block_index);
+
+		// Loaded value is a temporary.
+		notify_variable_access(args[1], current_block_index);
+
+		// Might be an access chain we have to track use of.
+		notify_variable_access(args[2], current_block_index);
+
+		// If we're loading an opaque type we cannot lower it to a temporary,
+		// we must defer access of args[2] until it's used.
+		auto &type = compiler.get<SPIRType>(args[0]);
+		if (compiler.type_is_opaque_value(type))
+			rvalue_forward_children[args[1]].insert(args[2]);
+		break;
+	}
+
+	case OpFunctionCall:
+	{
+		if (length < 3)
+			return false;
+
+		// Return value may be a temporary.
+		if (compiler.get_type(args[0]).basetype != SPIRType::Void)
+			notify_variable_access(args[1], current_block_index);
+
+		length -= 3;
+		args += 3;
+
+		for (uint32_t i = 0; i < length; i++)
+		{
+			auto *var = compiler.maybe_get_backing_variable(args[i]);
+			if (var)
 			{
-				// If the merge block has a higher post-visit order, we know that continue candidate
-				// cannot reach the merge block, and we have two separate scopes.
-				if (!cfg.is_reachable(potential_continue_block) ||
-				    cfg.get_visit_order(merge_candidate) > cfg.get_visit_order(potential_continue_block))
-				{
-					potential_continue_block = 0;
-				}
+				accessed_variables_to_block[var->self].set(current_block_index);
+				// Assume we can get partial writes to this variable.
+				partial_write_variables_to_block[var->self].set(current_block_index);
 			}
-		}
 
-		if (potential_continue_block != 0 && potential_continue_block != ~0u)
-			potential_loop_variables[var.first] = potential_continue_block;
+			// Cannot easily prove if argument we pass to a function is completely written.
+			// Usually, functions write to a dummy variable,
+			// which is then copied to in full to the real argument.
 
-		// For variables whose dominating block is inside a loop, there is a risk that these variables
-		// actually need to be preserved across loop iterations. We can express this by adding
-		// a "read" access to the loop header.
-		// In the dominating block, we must see an OpStore or equivalent as the first access of an OpVariable.
-		// Should that fail, we look for the outermost loop header and tack on an access there.
-		// Phi nodes cannot have this problem.
-		if (dominating_block)
+			// Might try to copy a Phi variable here.
+			notify_variable_access(args[i], current_block_index);
+		}
+		break;
+	}
+
+	case OpSelect:
+	{
+		// In case of variable pointers, we might access a variable here.
+		// We cannot prove anything about these accesses however.
+		for (uint32_t i = 1; i < length; i++)
 		{
-			auto &variable = get<SPIRVariable>(var.first);
-			if (!variable.phi_variable)
+			if (i >= 3)
 			{
-				auto *block = &get<SPIRBlock>(dominating_block);
-				bool preserve = may_read_undefined_variable_in_block(*block, var.first);
-				if (preserve)
+				auto *var = compiler.maybe_get_backing_variable(args[i]);
+				if (var)
 				{
-					// Find the outermost loop scope.
-					while (block->loop_dominator != BlockID(SPIRBlock::NoDominator))
-						block = &get<SPIRBlock>(block->loop_dominator);
-
-					if (block->self != dominating_block)
-					{
-						builder.add_block(block->self);
-						dominating_block = builder.get_dominator();
-					}
+					accessed_variables_to_block[var->self].set(current_block_index);
+					// Assume we can get partial writes to this variable.
+					partial_write_variables_to_block[var->self].set(current_block_index);
 				}
 			}
-		}
 
-		// If all blocks here are dead code, this will be 0, so the variable in question
-		// will be completely eliminated.
-		if (dominating_block)
-		{
-			auto &block = get<SPIRBlock>(dominating_block);
-			block.dominated_variables.push_back(var.first);
-			get<SPIRVariable>(var.first).dominator = dominating_block;
+			// Might try to copy a Phi variable here.
+			notify_variable_access(args[i], current_block_index);
 		}
+		break;
 	}
 
-	for (auto &var : handler.accessed_temporaries_to_block)
+	case OpExtInst:
 	{
-		auto itr = handler.result_id_to_type.find(var.first);
+		for (uint32_t i = 4; i < length; i++)
+			notify_variable_access(args[i], current_block_index);
+		notify_variable_access(args[1], current_block_index);
 
-		if (itr == end(handler.result_id_to_type))
+		uint32_t extension_set = args[2];
+		if (compiler.get<SPIRExtension>(extension_set).ext == SPIRExtension::GLSL)
 		{
-			// We found a false positive ID being used, ignore.
-			// This should probably be an assert.
-			continue;
+			auto op_450 = static_cast<GLSLstd450>(args[3]);
+			switch (op_450)
+			{
+			case GLSLstd450Modf:
+			case GLSLstd450Frexp:
+			{
+				uint32_t ptr = args[5];
+				auto *var = compiler.maybe_get_backing_variable(ptr);
+				if (var)
+				{
+					accessed_variables_to_block[var->self].set(current_block_index);
+					if (var->self == ptr)
+						complete_write_variables_to_block[var->self].set(current_block_index);
+					else
+						partial_write_variables_to_block[var->self].set(current_block_index);
+				}
+				break;
+			}
+
+			default:
+				break;
+			}
 		}
+		break;
+	}
 
-		// There is no point in doing domination analysis for opaque types.
-		auto &type = get<SPIRType>(itr->second);
-		if (type_is_opaque_value(type))
-			continue;
+	case OpArrayLength:
+		// Only result is a temporary.
+		notify_variable_access(args[1], current_block_index);
+		break;
 
-		DominatorBuilder builder(cfg);
-		bool force_temporary = false;
-		bool used_in_header_hoisted_continue_block = false;
+	case OpLine:
+	case OpNoLine:
+		// Uses literals, but cannot be a phi variable or temporary, so ignore.
+		break;
 
-		// Figure out which block is dominating all accesses of those temporaries.
-		auto &blocks = var.second;
-		for (auto &block : blocks)
-		{
-			builder.add_block(block);
+		// Atomics shouldn't be able to access function-local variables.
+		// Some GLSL builtins access a pointer.
 
-			if (blocks.size() != 1 && is_continue(block))
-			{
-				// The risk here is that inner loop can dominate the continue block.
-				// Any temporary we access in the continue block must be declared before the loop.
-				// This is moot for complex loops however.
-				auto &loop_header_block = get<SPIRBlock>(ir.continue_block_to_loop_header[block]);
-				assert(loop_header_block.merge == SPIRBlock::MergeLoop);
-				builder.add_block(loop_header_block.self);
-				used_in_header_hoisted_continue_block = true;
-			}
-		}
+	case OpCompositeInsert:
+	case OpVectorShuffle:
+		// Specialize for opcode which contains literals.
+		for (uint32_t i = 1; i < 4; i++)
+			notify_variable_access(args[i], current_block_index);
+		break;
 
-		uint32_t dominating_block = builder.get_dominator();
+	case OpCompositeExtract:
+		// Specialize for opcode which contains literals.
+		for (uint32_t i = 1; i < 3; i++)
+			notify_variable_access(args[i], current_block_index);
+		break;
 
-		if (blocks.size() != 1 && is_single_block_loop(dominating_block))
+	case OpImageWrite:
+		for (uint32_t i = 0; i < length; i++)
 		{
-			// Awkward case, because the loop header is also the continue block,
-			// so hoisting to loop header does not help.
-			force_temporary = true;
+			// Argument 3 is a literal.
+			if (i != 3)
+				notify_variable_access(args[i], current_block_index);
 		}
+		break;
 
-		if (dominating_block)
-		{
+	case OpImageSampleImplicitLod:
+	case OpImageSampleExplicitLod:
+	case OpImageSparseSampleImplicitLod:
+	case OpImageSparseSampleExplicitLod:
+	case OpImageSampleProjImplicitLod:
+	case OpImageSampleProjExplicitLod:
+	case OpImageSparseSampleProjImplicitLod:
+	case OpImageSparseSampleProjExplicitLod:
+	case OpImageFetch:
+	case OpImageSparseFetch:
+	case OpImageRead:
+	case OpImageSparseRead:
+		for (uint32_t i = 1; i < length; i++)
+		{
+			// Argument 4 is a literal.
+			if (i != 4)
+				notify_variable_access(args[i], current_block_index);
+		}
+		break;
+
+	case OpImageSampleDrefImplicitLod:
+	case OpImageSampleDrefExplicitLod:
+	case OpImageSparseSampleDrefImplicitLod:
+	case OpImageSparseSampleDrefExplicitLod:
+	case OpImageSampleProjDrefImplicitLod:
+	case OpImageSampleProjDrefExplicitLod:
+	case OpImageSparseSampleProjDrefImplicitLod:
+	case OpImageSparseSampleProjDrefExplicitLod:
+	case OpImageGather:
+	case OpImageSparseGather:
+	case OpImageDrefGather:
+	case OpImageSparseDrefGather:
+		for (uint32_t i = 1; i < length; i++)
+		{
+			// Argument 5 is a literal.
+			if (i != 5)
+				notify_variable_access(args[i], current_block_index);
+		}
+		break;
+
+	default:
+	{
+		// Rather dirty way of figuring out where Phi variables are used.
+		// As long as only IDs are used, we can scan through instructions and try to find any evidence that
+		// the ID of a variable has been used.
+		// There are potential false positives here where a literal is used in-place of an ID,
+		// but worst case, it does not affect the correctness of the compile.
+		// Exhaustive analysis would be better here, but it's not worth it for now.
+		for (uint32_t i = 0; i < length; i++)
+			notify_variable_access(args[i], current_block_index);
+		break;
+	}
+	}
+	return true;
+}
+
+Compiler::StaticExpressionAccessHandler::StaticExpressionAccessHandler(Compiler &compiler_, uint32_t variable_id_)
+    : compiler(compiler_)
+    , variable_id(variable_id_)
+{
+}
+
+bool Compiler::StaticExpressionAccessHandler::follow_function_call(const SPIRFunction &)
+{
+	return false;
+}
+
+bool Compiler::StaticExpressionAccessHandler::handle(spv::Op op, const uint32_t *args, uint32_t length)
+{
+	switch (op)
+	{
+	case OpStore:
+		if (length < 2)
+			return false;
+		if (args[0] == variable_id)
+		{
+			static_expression = args[1];
+			write_count++;
+		}
+		break;
+
+	case OpLoad:
+		if (length < 3)
+			return false;
+		if (args[2] == variable_id && static_expression == 0) // Tried to read from variable before it was initialized.
+			return false;
+		break;
+
+	case OpAccessChain:
+	case OpInBoundsAccessChain:
+	case OpPtrAccessChain:
+		if (length < 3)
+			return false;
+		if (args[2] == variable_id) // If we try to access chain our candidate variable before we store to it, bail.
+			return false;
+		break;
+
+	default:
+		break;
+	}
+
+	return true;
+}
+
+void Compiler::find_function_local_luts(SPIRFunction &entry, const AnalyzeVariableScopeAccessHandler &handler,
+                                        bool single_function)
+{
+	auto &cfg = *function_cfgs.find(entry.self)->second;
+
+	// For each variable which is statically accessed.
+	for (auto &accessed_var : handler.accessed_variables_to_block)
+	{
+		auto &blocks = accessed_var.second;
+		auto &var = get<SPIRVariable>(accessed_var.first);
+		auto &type = expression_type(accessed_var.first);
+
+		// Only consider function local variables here.
+		// If we only have a single function in our CFG, private storage is also fine,
+		// since it behaves like a function local variable.
+		bool allow_lut = var.storage == StorageClassFunction || (single_function && var.storage == StorageClassPrivate);
+		if (!allow_lut)
+			continue;
+
+		// We cannot be a phi variable.
+		if (var.phi_variable)
+			continue;
+
+		// Only consider arrays here.
+		if (type.array.empty())
+			continue;
+
+		// If the variable has an initializer, make sure it is a constant expression.
+		uint32_t static_constant_expression = 0;
+		if (var.initializer)
+		{
+			if (ir.ids[var.initializer].get_type() != TypeConstant)
+				continue;
+			static_constant_expression = var.initializer;
+
+			// There can be no stores to this variable, we have now proved we have a LUT.
+			if (handler.complete_write_variables_to_block.count(var.self) != 0 ||
+			    handler.partial_write_variables_to_block.count(var.self) != 0)
+				continue;
+		}
+		else
+		{
+			// We can have one, and only one write to the variable, and that write needs to be a constant.
+
+			// No partial writes allowed.
+			if (handler.partial_write_variables_to_block.count(var.self) != 0)
+				continue;
+
+			auto itr = handler.complete_write_variables_to_block.find(var.self);
+
+			// No writes?
+			if (itr == end(handler.complete_write_variables_to_block))
+				continue;
+
+			// We write to the variable in more than one block.
+			auto &write_blocks = itr->second;
+			if (write_blocks.count() != 1)
+				continue;
+
+			// The write needs to happen in the dominating block.
+			DominatorBuilder builder(cfg);
+			blocks.for_each_bit([&](uint32_t block) { builder.add_block(handler.get_block_id(block)); });
+			uint32_t dominator = builder.get_dominator();
+
+			// The complete write happened in a branch or similar, cannot deduce static expression.
+			if (!dominator || !write_blocks.get(handler.get_block_index(dominator)))
+				continue;
+
+			// Find the static expression for this variable.
+			StaticExpressionAccessHandler static_expression_handler(*this, var.self);
+			traverse_all_reachable_opcodes(get<SPIRBlock>(dominator), static_expression_handler);
+
+			// We want one, and exactly one write
+			if (static_expression_handler.write_count != 1 || static_expression_handler.static_expression == 0)
+				continue;
+
+			// Is it a constant expression?
+			if (ir.ids[static_expression_handler.static_expression].get_type() != TypeConstant)
+				continue;
+
+			// We found a LUT!
+			static_constant_expression = static_expression_handler.static_expression;
+		}
+
+		// Functions, or entry points, which use identical tables share one declaration.
+		static_constant_expression = get_canonical_constant(static_constant_expression);
+		get<SPIRConstant>(static_constant_expression).is_used_as_lut = true;
+		var.static_expression = static_constant_expression;
+		var.statically_assigned = true;
+		var.remapped_variable = true;
+	}
+}
+
+uint64_t Compiler::hash_constant_contents(const SPIRConstant &c) const
+{
+	Hasher h;
+	h.u32(c.constant_type);
+
+	for (auto &elem : c.subconstants)
+	{
+		auto *subc = maybe_get<SPIRConstant>(elem);
+		if (subc && !subc->specialization)
+		{
+			uint64_t sub_hash = hash_constant_contents(*subc);
+			h.u32(uint32_t(sub_hash));
+			h.u32(uint32_t(sub_hash >> 32));
+		}
+		else
+			h.u32(elem);
+	}
+
+	if (c.subconstants.empty())
+	{
+		for (uint32_t col = 0; col < c.columns(); col++)
+		{
+			for (uint32_t row = 0; row < c.vector_size(); row++)
+			{
+				uint64_t value = c.scalar_u64(col, row);
+				h.u32(uint32_t(value));
+				h.u32(uint32_t(value >> 32));
+				h.u32(c.specialization_constant_id(col, row));
+			}
+		}
+	}
+
+	return h.get();
+}
+
+bool Compiler::constants_have_equal_contents(const SPIRConstant &a, const SPIRConstant &b) const
+{
+	if (a.self == b.self)
+		return true;
+
+	if (a.constant_type != b.constant_type || a.specialization || b.specialization ||
+	    a.subconstants.size() != b.subconstants.size())
+		return false;
+
+	for (size_t i = 0; i < a.subconstants.size(); i++)
+	{
+		uint32_t elem_a = a.subconstants[i];
+		uint32_t elem_b = b.subconstants[i];
+		if (elem_a == elem_b)
+			continue;
+
+		// Anything but constants, such as undefs and spec constant ops, is only equal to itself.
+		auto *sub_a = maybe_get<SPIRConstant>(elem_a);
+		auto *sub_b = maybe_get<SPIRConstant>(elem_b);
+		if (!sub_a || !sub_b || !constants_have_equal_contents(*sub_a, *sub_b))
+			return false;
+	}
+
+	if (a.subconstants.empty())
+	{
+		if (a.columns() != b.columns() || a.vector_size() != b.vector_size())
+			return false;
+
+		for (uint32_t col = 0; col < a.columns(); col++)
+		{
+			for (uint32_t row = 0; row < a.vector_size(); row++)
+			{
+				if (a.scalar_u64(col, row) != b.scalar_u64(col, row) ||
+				    a.specialization_constant_id(col, row) != b.specialization_constant_id(col, row))
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool Compiler::constant_is_scalar_table(const SPIRConstant &c) const
+{
+	auto &type = get<SPIRType>(c.constant_type);
+	if (!type_is_top_level_array(type))
+		return false;
+
+	auto &elem_type = get<SPIRType>(type.parent_type);
+	if (!is_scalar(elem_type) || !elem_type.array.empty() || elem_type.pointer ||
+	    elem_type.basetype == SPIRType::Boolean)
+		return false;
+
+	for (auto elem : c.subconstants)
+	{
+		auto *subc = maybe_get<SPIRConstant>(elem);
+		if (!subc || subc->specialization || !subc->subconstants.empty())
+			return false;
+	}
+
+	return true;
+}
+
+void Compiler::find_duplicate_constants()
+{
+	duplicate_constants.clear();
+
+	// Constants are bucketed by a hash of their contents,
+	// so only constants which are likely to be identical are compared.
+	unordered_map<uint64_t, SmallVector<uint32_t>> constants_by_hash;
+
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, const SPIRConstant &c) {
+		if (c.specialization || c.subconstants.empty())
+			return;
+
+		auto &type = get<SPIRType>(c.constant_type);
+		if (type.basetype != SPIRType::Struct && !type_is_top_level_array(type))
+			return;
+
+		auto &bucket = constants_by_hash[hash_constant_contents(c)];
+		for (auto candidate : bucket)
+		{
+			if (constants_have_equal_contents(get<SPIRConstant>(candidate), c))
+			{
+				duplicate_constants[c.self] = candidate;
+				return;
+			}
+		}
+		bucket.push_back(c.self);
+	});
+}
+
+const LoweredLUT *Compiler::find_lowered_lut(uint32_t constant) const
+{
+	for (auto &lut : lowered_luts)
+		if (lut.constant == constant)
+			return &lut;
+	return nullptr;
+}
+
+void Compiler::lower_luts_to_buffers(uint32_t min_size, uint32_t desc_set, uint32_t binding)
+{
+	lowered_luts.clear();
+	if (min_size == 0)
+		return;
+
+	// Tables of arrays of 32-bit scalars, which can be indexed out of a tightly packed buffer.
+	unordered_set<uint32_t> candidates;
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, const SPIRConstant &c) {
+		if (!c.is_used_as_lut || c.specialization)
+			return;
+
+		auto &type = get<SPIRType>(c.constant_type);
+		if (type.array.size() != 1 || !type.array_size_literal.back() || type.pointer)
+			return;
+
+		auto &elem_type = get<SPIRType>(type.parent_type);
+		if (!is_scalar(elem_type) || elem_type.width != 32 || !elem_type.array.empty() ||
+		    (elem_type.basetype != SPIRType::Float && elem_type.basetype != SPIRType::Int &&
+		     elem_type.basetype != SPIRType::UInt))
+			return;
+
+		if (c.subconstants.size() * sizeof(uint32_t) < min_size)
+			return;
+
+		for (auto elem : c.subconstants)
+		{
+			auto *subc = maybe_get<SPIRConstant>(elem);
+			if (!subc || subc->specialization)
+				return;
+		}
+
+		candidates.insert(c.self);
+	});
+
+	if (candidates.empty())
+		return;
+
+	// The variables which were remapped to the tables.
+	unordered_map<uint32_t, uint32_t> lut_variables;
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
+		if (var.statically_assigned && var.remapped_variable && candidates.count(var.static_expression))
+			lut_variables[var.self] = var.static_expression;
+	});
+
+	// A buffer can only stand in for the table where it is indexed. Any other reference to the table,
+	// or to a variable remapped to it, keeps the table inline. IDs are not told apart from literals here,
+	// which only errs on the side of keeping tables inline.
+	const auto reject = [&](uint32_t id) {
+		auto itr = lut_variables.find(id);
+		candidates.erase(itr != end(lut_variables) ? itr->second : get_canonical_constant(id));
+	};
+
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
+		if (var.initializer && lut_variables.count(var.self) == 0)
+			reject(var.initializer);
+	});
+
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, const SPIRConstant &c) {
+		for (auto elem : c.subconstants)
+			reject(elem);
+	});
+
+	ir.for_each_typed_id<SPIRConstantOp>([&](uint32_t, const SPIRConstantOp &op) {
+		for (auto arg : op.arguments)
+			reject(arg);
+	});
+
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t, const SPIRFunction &func) {
+		for (auto block_id : func.blocks)
+		{
+			auto &block = get<SPIRBlock>(block_id);
+			for (auto &instr : block.ops)
+			{
+				auto *ops = stream(instr);
+				auto op = static_cast<Op>(instr.op);
+				uint32_t first = 0;
+
+				if ((op == OpAccessChain || op == OpInBoundsAccessChain) && instr.length >= 3 &&
+				    lut_variables.count(ops[2]))
+				{
+					first = 3;
+				}
+				else if (op == OpStore && instr.length >= 2 && lut_variables.count(ops[0]) &&
+				         lut_variables[ops[0]] == get_canonical_constant(ops[1]))
+				{
+					first = 2;
+				}
+
+				for (uint32_t i = first; i < instr.length; i++)
+					reject(ops[i]);
+			}
+
+			reject(block.return_value);
+			for (auto &phi : block.phi_variables)
+				reject(phi.local_variable);
+		}
+	});
+
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, const SPIRConstant &c) {
+		if (candidates.count(c.self) == 0)
+			return;
+
+		LoweredLUT lut;
+		lut.constant = c.self;
+		lut.desc_set = desc_set;
+		lut.binding = binding++;
+		lut.data.resize(c.subconstants.size() * sizeof(uint32_t));
+		for (size_t i = 0; i < c.subconstants.size(); i++)
+		{
+			uint32_t value = get<SPIRConstant>(c.subconstants[i]).scalar();
+			memcpy(lut.data.data() + i * sizeof(uint32_t), &value, sizeof(value));
+		}
+		lowered_luts.push_back(std::move(lut));
+	});
+}
+
+void Compiler::analyze_variable_scope(SPIRFunction &entry, AnalyzeVariableScopeAccessHandler &handler)
+{
+	// First, we map out all variable access within a function.
+	// Essentially a map of block -> { variables accessed in the basic block }
+	traverse_all_reachable_opcodes(entry, handler);
+
+	auto &cfg = *function_cfgs.find(entry.self)->second;
+
+	// Analyze if there are parameters which need to be implicitly preserved with an "in" qualifier.
+	analyze_parameter_preservation(entry, cfg, handler);
+
+	unordered_map<uint32_t, uint32_t> potential_loop_variables;
+
+	// Find the loop dominator block for each block.
+	for (auto &block_id : entry.blocks)
+	{
+		auto &block = get<SPIRBlock>(block_id);
+
+		auto itr = ir.continue_block_to_loop_header.find(block_id);
+		if (itr != end(ir.continue_block_to_loop_header) && itr->second != block_id)
+		{
+			// Continue block might be unreachable in the CFG, but we still like to know the loop dominator.
+			// Edge case is when continue block is also the loop header, don't set the dominator in this case.
+			block.loop_dominator = itr->second;
+		}
+		else
+		{
+			uint32_t loop_dominator = cfg.find_loop_dominator(block_id);
+			if (loop_dominator != block_id)
+				block.loop_dominator = loop_dominator;
+			else
+				block.loop_dominator = SPIRBlock::NoDominator;
+		}
+	}
+
+	// For each variable which is statically accessed.
+	for (auto &var : handler.accessed_variables_to_block)
+	{
+		// Only deal with variables which are considered local variables in this function.
+		if (find(begin(entry.local_variables), end(entry.local_variables), VariableID(var.first)) ==
+		    end(entry.local_variables))
+			continue;
+
+		DominatorBuilder builder(cfg);
+		auto &blocks = var.second;
+		auto &type = expression_type(var.first);
+		BlockID potential_continue_block = 0;
+
+		// Figure out which block is dominating all accesses of those variables.
+		blocks.for_each_bit([&](uint32_t block_index) {
+			BlockID block = handler.get_block_id(block_index);
+
+			// If we're accessing a variable inside a continue block, this variable might be a loop variable.
+			// We can only use loop variables with scalars, as we cannot track static expressions for vectors.
+			if (is_continue(block))
+			{
+				// Potentially awkward case to check for.
+				// We might have a variable inside a loop, which is touched by the continue block,
+				// but is not actually a loop variable.
+				// The continue block is dominated by the inner part of the loop, which does not make sense in high-level
+				// language output because it will be declared before the body,
+				// so we will have to lift the dominator up to the relevant loop header instead.
+				builder.add_block(ir.continue_block_to_loop_header[block]);
+
+				// Arrays or structs cannot be loop variables.
+				if (type.vecsize == 1 && type.columns == 1 && type.basetype != SPIRType::Struct && type.array.empty())
+				{
+					// The variable is used in multiple continue blocks, this is not a loop
+					// candidate, signal that by setting block to -1u.
+					if (potential_continue_block == 0)
+						potential_continue_block = block;
+					else
+						potential_continue_block = ~(0u);
+				}
+			}
+
+			builder.add_block(block);
+		});
+
+		builder.lift_continue_block_dominator();
+
+		// Add it to a per-block list of variables.
+		BlockID dominating_block = builder.get_dominator();
+
+		if (dominating_block && potential_continue_block != 0 && potential_continue_block != ~0u)
+		{
+			auto &inner_block = get<SPIRBlock>(dominating_block);
+
+			BlockID merge_candidate = 0;
+
+			// Analyze the dominator. If it lives in a different loop scope than the candidate continue
+			// block, reject the loop variable candidate.
+			if (inner_block.merge == SPIRBlock::MergeLoop)
+				merge_candidate = inner_block.merge_block;
+			else if (inner_block.loop_dominator != SPIRBlock::NoDominator)
+				merge_candidate = get<SPIRBlock>(inner_block.loop_dominator).merge_block;
+
+			if (merge_candidate != 0 && cfg.is_reachable(merge_candidate))
+			{
+				// If the merge block has a higher post-visit order, we know that continue candidate
+				// cannot reach the merge block, and we have two separate scopes.
+				if (!cfg.is_reachable(potential_continue_block) ||
+				    cfg.get_visit_order(merge_candidate) > cfg.get_visit_order(potential_continue_block))
+				{
+					potential_continue_block = 0;
+				}
+			}
+		}
+
+		if (potential_continue_block != 0 && potential_continue_block != ~0u)
+			potential_loop_variables[var.first] = potential_continue_block;
+
+		// For variables whose dominating block is inside a loop, there is a risk that these variables
+		// actually need to be preserved across loop iterations. We can express this by adding
+		// a "read" access to the loop header.
+		// In the dominating block, we must see an OpStore or equivalent as the first access of an OpVariable.
+		// Should that fail, we look for the outermost loop header and tack on an access there.
+		// Phi nodes cannot have this problem.
+		if (dominating_block)
+		{
+			auto &variable = get<SPIRVariable>(var.first);
+			if (!variable.phi_variable)
+			{
+				auto *block = &get<SPIRBlock>(dominating_block);
+				bool preserve = may_read_undefined_variable_in_block(*block, var.first);
+				if (preserve)
+				{
+					// Find the outermost loop scope.
+					while (block->loop_dominator != BlockID(SPIRBlock::NoDominator))
+						block = &get<SPIRBlock>(block->loop_dominator);
+
+					if (block->self != dominating_block)
+					{
+						builder.add_block(block->self);
+						dominating_block = builder.get_dominator();
+					}
+				}
+			}
+		}
+
+		// If all blocks here are dead code, this will be 0, so the variable in question
+		// will be completely eliminated.
+		if (dominating_block)
+		{
+			auto &block = get<SPIRBlock>(dominating_block);
+			block.dominated_variables.push_back(var.first);
+			get<SPIRVariable>(var.first).dominator = dominating_block;
+		}
+	}
+
+	for (auto &var : handler.accessed_temporaries_to_block)
+	{
+		auto itr = handler.result_id_to_type.find(var.first);
+
+		if (itr == end(handler.result_id_to_type))
+		{
+			// We found a false positive ID being used, ignore.
+			// This should probably be an assert.
+			continue;
+		}
+
+		// There is no point in doing domination analysis for opaque types.
+		auto &type = get<SPIRType>(itr->second);
+		if (type_is_opaque_value(type))
+			continue;
+
+		DominatorBuilder builder(cfg);
+		bool force_temporary = false;
+		bool used_in_header_hoisted_continue_block = false;
+
+		// Figure out which block is dominating all accesses of those temporaries.
+		auto &blocks = var.second;
+		uint32_t block_count = blocks.count();
+		blocks.for_each_bit([&](uint32_t block_index) {
+			uint32_t block = handler.get_block_id(block_index);
+			builder.add_block(block);
+
+			if (block_count != 1 && is_continue(block))
+			{
+				// The risk here is that inner loop can dominate the continue block.
+				// Any temporary we access in the continue block must be declared before the loop.
+				// This is moot for complex loops however.
+				auto &loop_header_block = get<SPIRBlock>(ir.continue_block_to_loop_header[block]);
+				assert(loop_header_block.merge == SPIRBlock::MergeLoop);
+				builder.add_block(loop_header_block.self);
+				used_in_header_hoisted_continue_block = true;
+			}
+		});
+
+		uint32_t dominating_block = builder.get_dominator();
+
+		if (block_count != 1 && is_single_block_loop(dominating_block))
+		{
+			// Awkward case, because the loop header is also the continue block,
+			// so hoisting to loop header does not help.
+			force_temporary = true;
+		}
+
+		if (dominating_block)
+		{
 			// If we touch a variable in the dominating block, this is the expected setup.
 			// SPIR-V normally mandates this, but we have extra cases for temporary use inside loops.
-			bool first_use_is_dominator = blocks.count(dominating_block) != 0;
+			bool first_use_is_dominator = blocks.get(handler.get_block_index(dominating_block));
+
+			if (!first_use_is_dominator || force_temporary)
+			{
+				if (handler.access_chain_expressions.count(var.first))
+				{
+					// Exceptionally rare case.
+					// We cannot declare temporaries of access chains (except on MSL perhaps with pointers).
+					// Rather than do that, we force the indexing expressions to be declared in the right scope by
+					// tracking their usage to that end. There is no temporary to hoist.
+					// However, we still need to observe declaration order of the access chain.
+
+					if (used_in_header_hoisted_continue_block)
+					{
+						// For this scenario, we used an access chain inside a continue block where we also registered an access to header block.
+						// This is a problem as we need to declare an access chain properly first with full definition.
+						// We cannot use temporaries for these expressions,
+						// so we must make sure the access chain is declared ahead of time.
+						// Force a complex for loop to deal with this.
+						// TODO: Out-of-order declaring for loops where continue blocks are emitted last might be another option.
+						auto &loop_header_block = get<SPIRBlock>(dominating_block);
+						assert(loop_header_block.merge == SPIRBlock::MergeLoop);
+						loop_header_block.complex_continue = true;
+					}
+				}
+				else
+				{
+					// This should be very rare, but if we try to declare a temporary inside a loop,
+					// and that temporary is used outside the loop as well (spirv-opt inliner likes this)
+					// we should actually emit the temporary outside the loop.
+					hoisted_temporaries.insert(var.first);
+					forced_temporaries.insert(var.first);
+
+					auto &block_temporaries = get<SPIRBlock>(dominating_block).declare_temporary;
+					block_temporaries.emplace_back(handler.result_id_to_type[var.first], var.first);
+				}
+			}
+			else if (block_count > 1)
+			{
+				// Keep track of the temporary as we might have to declare this temporary.
+				// This can happen if the loop header dominates a temporary, but we have a complex fallback loop.
+				// In this case, the header is actually inside the for (;;) {} block, and we have problems.
+				// What we need to do is hoist the temporaries outside the for (;;) {} block in case the header block
+				// declares the temporary.
+				auto &block_temporaries = get<SPIRBlock>(dominating_block).potential_declare_temporary;
+				block_temporaries.emplace_back(handler.result_id_to_type[var.first], var.first);
+			}
+		}
+	}
+
+	// Now, try to analyze whether or not these variables are actually loop variables.
+	unordered_map<uint32_t, DenseBitset> blocks_after_merge;
+	for (auto &loop_variable : potential_loop_variables)
+	{
+		auto &var = get<SPIRVariable>(loop_variable.first);
+		auto dominator = var.dominator;
+		BlockID block = loop_variable.second;
+
+		// The variable was accessed in multiple continue blocks, ignore.
+		if (block == BlockID(~(0u)) || block == BlockID(0))
+			continue;
+
+		// Dead code.
+		if (dominator == ID(0))
+			continue;
+
+		BlockID header = 0;
+
+		// Find the loop header for this block if we are a continue block.
+		{
+			auto itr = ir.continue_block_to_loop_header.find(block);
+			if (itr != end(ir.continue_block_to_loop_header))
+			{
+				header = itr->second;
+			}
+			else if (get<SPIRBlock>(block).continue_block == block)
+			{
+				// Also check for self-referential continue block.
+				header = block;
+			}
+		}
+
+		assert(header);
+		auto &header_block = get<SPIRBlock>(header);
+		auto &blocks = handler.accessed_variables_to_block[loop_variable.first];
+
+		// If a loop variable is not used before the loop, it's probably not a loop variable.
+		bool has_accessed_variable = blocks.get(handler.get_block_index(header));
+
+		// Now, there are two conditions we need to meet for the variable to be a loop variable.
+		// 1. The dominating block must have a branch-free path to the loop header,
+		// this way we statically know which expression should be part of the loop variable initializer.
+
+		// Walk from the dominator, if there is one straight edge connecting
+		// dominator and loop header, we statically know the loop initializer.
+		bool static_loop_init = true;
+		while (dominator != header)
+		{
+			if (blocks.get(handler.get_block_index(dominator)))
+				has_accessed_variable = true;
+
+			auto succ = cfg.get_succeeding_edges(dominator);
+			if (succ.size() != 1)
+			{
+				static_loop_init = false;
+				break;
+			}
+
+			auto pred = cfg.get_preceding_edges(succ.front());
+			if (pred.size() != 1 || pred.front() != dominator)
+			{
+				static_loop_init = false;
+				break;
+			}
+
+			dominator = succ.front();
+		}
+
+		if (!static_loop_init || !has_accessed_variable)
+			continue;
+
+		// The second condition we need to meet is that no access after the loop
+		// merge can occur. Walk the CFG to see if we find anything.
+
+		// Loops are usually shared by several candidates, so the blocks past a merge are only found once.
+		auto &after_merge = blocks_after_merge[header_block.merge_block];
+		if (after_merge.empty())
+		{
+			cfg.walk_from(header_block.merge_block, [&](uint32_t walk_block) -> bool {
+				after_merge.set(handler.get_block_index(walk_block));
+				return true;
+			});
+		}
+
+		// We found a block which accesses the variable outside the loop.
+		if (after_merge.intersects(blocks))
+			continue;
+
+		// We have a loop variable.
+		header_block.loop_variables.push_back(loop_variable.first);
+		// Need to sort here as variables come from an unordered container, and pushing stuff in wrong order
+		// will break reproducability in regression runs.
+		sort(begin(header_block.loop_variables), end(header_block.loop_variables));
+		get<SPIRVariable>(loop_variable.first).loop_variable = true;
+	}
+}
+
+bool Compiler::may_read_undefined_variable_in_block(const SPIRBlock &block, uint32_t var)
+{
+	for (auto &op : block.ops)
+	{
+		auto *ops = stream(op);
+		switch (op.op)
+		{
+		case OpStore:
+		case OpCopyMemory:
+			if (ops[0] == var)
+				return false;
+			break;
 
-			if (!first_use_is_dominator || force_temporary)
-			{
-				if (handler.access_chain_expressions.count(var.first))
-				{
-					// Exceptionally rare case.
-					// We cannot declare temporaries of access chains (except on MSL perhaps with pointers).
-					// Rather than do that, we force the indexing expressions to be declared in the right scope by
-					// tracking their usage to that end. There is no temporary to hoist.
-					// However, we still need to observe declaration order of the access chain.
+		case OpAccessChain:
+		case OpInBoundsAccessChain:
+		case OpPtrAccessChain:
+			// Access chains are generally used to partially read and write. It's too hard to analyze
+			// if all constituents are written fully before continuing, so just assume it's preserved.
+			// This is the same as the parameter preservation analysis.
+			if (ops[2] == var)
+				return true;
+			break;
 
-					if (used_in_header_hoisted_continue_block)
-					{
-						// For this scenario, we used an access chain inside a continue block where we also registered an access to header block.
-						// This is a problem as we need to declare an access chain properly first with full definition.
-						// We cannot use temporaries for these expressions,
-						// so we must make sure the access chain is declared ahead of time.
-						// Force a complex for loop to deal with this.
-						// TODO: Out-of-order declaring for loops where continue blocks are emitted last might be another option.
-						auto &loop_header_block = get<SPIRBlock>(dominating_block);
-						assert(loop_header_block.merge == SPIRBlock::MergeLoop);
-						loop_header_block.complex_continue = true;
-					}
-				}
-				else
-				{
-					// This should be very rare, but if we try to declare a temporary inside a loop,
-					// and that temporary is used outside the loop as well (spirv-opt inliner likes this)
-					// we should actually emit the temporary outside the loop.
-					hoisted_temporaries.insert(var.first);
-					forced_temporaries.insert(var.first);
+		case OpSelect:
+			// Variable pointers.
+			// We might read before writing.
+			if (ops[3] == var || ops[4] == var)
+				return true;
+			break;
 
-					auto &block_temporaries = get<SPIRBlock>(dominating_block).declare_temporary;
-					block_temporaries.emplace_back(handler.result_id_to_type[var.first], var.first);
-				}
-			}
-			else if (blocks.size() > 1)
+		case OpPhi:
+		{
+			// Variable pointers.
+			// We might read before writing.
+			if (op.length < 2)
+				break;
+
+			uint32_t count = op.length - 2;
+			for (uint32_t i = 0; i < count; i += 2)
+				if (ops[i + 2] == var)
+					return true;
+			break;
+		}
+
+		case OpCopyObject:
+		case OpLoad:
+			if (ops[2] == var)
+				return true;
+			break;
+
+		case OpFunctionCall:
+		{
+			if (op.length < 3)
+				break;
+
+			// May read before writing.
+			uint32_t count = op.length - 3;
+			for (uint32_t i = 0; i < count; i++)
+				if (ops[i + 3] == var)
+					return true;
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	// Not accessed somehow, at least not in a usual fashion.
+	// It's likely accessed in a branch, so assume we must preserve.
+	return true;
+}
+
+Bitset Compiler::get_buffer_block_flags(VariableID id) const
+{
+	return ir.get_buffer_block_flags(get<SPIRVariable>(id));
+}
+
+bool Compiler::get_common_basic_type(const SPIRType &type, SPIRType::BaseType &base_type)
+{
+	if (type.basetype == SPIRType::Struct)
+	{
+		base_type = SPIRType::Unknown;
+		for (auto &member_type : type.member_types)
+		{
+			SPIRType::BaseType member_base;
+			if (!get_common_basic_type(get<SPIRType>(member_type), member_base))
+				return false;
+
+			if (base_type == SPIRType::Unknown)
+				base_type = member_base;
+			else if (base_type != member_base)
+				return false;
+		}
+		return true;
+	}
+	else
+	{
+		base_type = type.basetype;
+		return true;
+	}
+}
+
+void Compiler::ActiveBuiltinHandler::handle_builtin(const SPIRType &type, BuiltIn builtin,
+                                                    const Bitset &decoration_flags)
+{
+	// If used, we will need to explicitly declare a new array size for these builtins.
+
+	if (builtin == BuiltInClipDistance)
+	{
+		if (!type.array_size_literal[0])
+			SPIRV_CROSS_THROW("Array size for ClipDistance must be a literal.");
+		uint32_t array_size = type.array[0];
+		if (array_size == 0)
+			SPIRV_CROSS_THROW("Array size for ClipDistance must not be unsized.");
+		compiler.clip_distance_count = array_size;
+	}
+	else if (builtin == BuiltInCullDistance)
+	{
+		if (!type.array_size_literal[0])
+			SPIRV_CROSS_THROW("Array size for CullDistance must be a literal.");
+		uint32_t array_size = type.array[0];
+		if (array_size == 0)
+			SPIRV_CROSS_THROW("Array size for CullDistance must not be unsized.");
+		compiler.cull_distance_count = array_size;
+	}
+	else if (builtin == BuiltInPosition)
+	{
+		if (decoration_flags.get(DecorationInvariant))
+			compiler.position_invariant = true;
+	}
+}
+
+void Compiler::ActiveBuiltinHandler::add_if_builtin(uint32_t id, bool allow_blocks)
+{
+	// Only handle plain variables here.
+	// Builtins which are part of a block are handled in AccessChain.
+	// If allow_blocks is used however, this is to handle initializers of blocks,
+	// which implies that all members are written to.
+
+	auto *var = compiler.maybe_get<SPIRVariable>(id);
+	auto *m = compiler.ir.find_meta(id);
+	if (var && m)
+	{
+		auto &type = compiler.get<SPIRType>(var->basetype);
+		auto &decorations = m->decoration;
+		auto &flags = type.storage == StorageClassInput ?
+		              compiler.active_input_builtins : compiler.active_output_builtins;
+		if (decorations.builtin)
+		{
+			flags.set(decorations.builtin_type);
+			handle_builtin(type, decorations.builtin_type, decorations.decoration_flags);
+		}
+		else if (allow_blocks && compiler.has_decoration(type.self, DecorationBlock))
+		{
+			uint32_t member_count = uint32_t(type.member_types.size());
+			for (uint32_t i = 0; i < member_count; i++)
 			{
-				// Keep track of the temporary as we might have to declare this temporary.
-				// This can happen if the loop header dominates a temporary, but we have a complex fallback loop.
-				// In this case, the header is actually inside the for (;;) {} block, and we have problems.
-				// What we need to do is hoist the temporaries outside the for (;;) {} block in case the header block
-				// declares the temporary.
-				auto &block_temporaries = get<SPIRBlock>(dominating_block).potential_declare_temporary;
-				block_temporaries.emplace_back(handler.result_id_to_type[var.first], var.first);
+				if (compiler.has_member_decoration(type.self, i, DecorationBuiltIn))
+				{
+					auto &member_type = compiler.get<SPIRType>(type.member_types[i]);
+					BuiltIn builtin = BuiltIn(compiler.get_member_decoration(type.self, i, DecorationBuiltIn));
+					flags.set(builtin);
+					handle_builtin(member_type, builtin, compiler.get_member_decoration_bitset(type.self, i));
+				}
 			}
 		}
 	}
+}
+
+void Compiler::ActiveBuiltinHandler::add_if_builtin(uint32_t id)
+{
+	add_if_builtin(id, false);
+}
+
+void Compiler::ActiveBuiltinHandler::add_if_builtin_or_block(uint32_t id)
+{
+	add_if_builtin(id, true);
+}
+
+bool Compiler::ActiveBuiltinHandler::handle(spv::Op opcode, const uint32_t *args, uint32_t length)
+{
+	switch (opcode)
+	{
+	case OpStore:
+		if (length < 1)
+			return false;
+
+		add_if_builtin(args[0]);
+		break;
+
+	case OpCopyMemory:
+		if (length < 2)
+			return false;
+
+		add_if_builtin(args[0]);
+		add_if_builtin(args[1]);
+		break;
+
+	case OpCopyObject:
+	case OpLoad:
+		if (length < 3)
+			return false;
+
+		add_if_builtin(args[2]);
+		break;
+
+	case OpSelect:
+		if (length < 5)
+			return false;
+
+		add_if_builtin(args[3]);
+		add_if_builtin(args[4]);
+		break;
+
+	case OpPhi:
+	{
+		if (length < 2)
+			return false;
+
+		uint32_t count = length - 2;
+		args += 2;
+		for (uint32_t i = 0; i < count; i += 2)
+			add_if_builtin(args[i]);
+		break;
+	}
+
+	case OpFunctionCall:
+	{
+		if (length < 3)
+			return false;
 
-	unordered_set<uint32_t> seen_blocks;
+		uint32_t count = length - 3;
+		args += 3;
+		for (uint32_t i = 0; i < count; i++)
+			add_if_builtin(args[i]);
+		break;
+	}
 
-	// Now, try to analyze whether or not these variables are actually loop variables.
-	for (auto &loop_variable : potential_loop_variables)
+	case OpAccessChain:
+	case OpInBoundsAccessChain:
+	case OpPtrAccessChain:
 	{
-		auto &var = get<SPIRVariable>(loop_variable.first);
-		auto dominator = var.dominator;
-		BlockID block = loop_variable.second;
+		if (length < 4)
+			return false;
 
-		// The variable was accessed in multiple continue blocks, ignore.
-		if (block == BlockID(~(0u)) || block == BlockID(0))
-			continue;
+		// Only consider global variables, cannot consider variables in functions yet, or other
+		// access chains as they have not been created yet.
+		auto *var = compiler.maybe_get<SPIRVariable>(args[2]);
+		if (!var)
+			break;
 
-		// Dead code.
-		if (dominator == ID(0))
-			continue;
+		// Required if we access chain into builtins like gl_GlobalInvocationID.
+		add_if_builtin(args[2]);
 
-		BlockID header = 0;
+		// Start traversing type hierarchy at the proper non-pointer types.
+		auto *type = &compiler.get_variable_data_type(*var);
 
-		// Find the loop header for this block if we are a continue block.
+		auto &flags =
+		    var->storage == StorageClassInput ? compiler.active_input_builtins : compiler.active_output_builtins;
+
+		uint32_t count = length - 3;
+		args += 3;
+		for (uint32_t i = 0; i < count; i++)
 		{
-			auto itr = ir.continue_block_to_loop_header.find(block);
-			if (itr != end(ir.continue_block_to_loop_header))
+			// Pointers
+			if (opcode == OpPtrAccessChain && i == 0)
 			{
-				header = itr->second;
+				type = &compiler.get<SPIRType>(type->parent_type);
+				continue;
 			}
-			else if (get<SPIRBlock>(block).continue_block == block)
+
+			// Arrays
+			if (!type->array.empty())
 			{
-				// Also check for self-referential continue block.
-				header = block;
+				type = &compiler.get<SPIRType>(type->parent_type);
+			}
+			// Structs
+			else if (type->basetype == SPIRType::Struct)
+			{
+				uint32_t index = compiler.get<SPIRConstant>(args[i]).scalar();
+
+				if (index < uint32_t(compiler.ir.meta[type->self].members.size()))
+				{
+					auto &decorations = compiler.ir.meta[type->self].members[index];
+					if (decorations.builtin)
+					{
+						flags.set(decorations.builtin_type);
+						handle_builtin(compiler.get<SPIRType>(type->member_types[index]), decorations.builtin_type,
+						               decorations.decoration_flags);
+					}
+				}
+
+				type = &compiler.get<SPIRType>(type->member_types[index]);
+			}
+			else
+			{
+				// No point in traversing further. We won't find any extra builtins.
+				break;
 			}
 		}
+		break;
+	}
 
-		assert(header);
-		auto &header_block = get<SPIRBlock>(header);
-		auto &blocks = handler.accessed_variables_to_block[loop_variable.first];
+	default:
+		break;
+	}
 
-		// If a loop variable is not used before the loop, it's probably not a loop variable.
-		bool has_accessed_variable = blocks.count(header) != 0;
+	return true;
+}
 
-		// Now, there are two conditions we need to meet for the variable to be a loop variable.
-		// 1. The dominating block must have a branch-free path to the loop header,
-		// this way we statically know which expression should be part of the loop variable initializer.
+void Compiler::update_active_builtins()
+{
+	if (reuse_active_builtins())
+		return;
 
-		// Walk from the dominator, if there is one straight edge connecting
-		// dominator and loop header, we statically know the loop initializer.
-		bool static_loop_init = true;
-		while (dominator != header)
-		{
-			if (blocks.count(dominator) != 0)
-				has_accessed_variable = true;
+	reset_active_builtins();
+	ActiveBuiltinHandler handler(*this);
+	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
+	finalize_active_builtins(handler);
+}
 
-			auto &succ = cfg.get_succeeding_edges(dominator);
-			if (succ.size() != 1)
-			{
-				static_loop_init = false;
-				break;
-			}
+void Compiler::reset_active_builtins()
+{
+	active_input_builtins.reset();
+	active_output_builtins.reset();
+	cull_distance_count = 0;
+	clip_distance_count = 0;
+}
 
-			auto &pred = cfg.get_preceding_edges(succ.front());
-			if (pred.size() != 1 || pred.front() != dominator)
-			{
-				static_loop_init = false;
-				break;
-			}
+void Compiler::finalize_active_builtins(ActiveBuiltinHandler &handler)
+{
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
+		if (var.storage != StorageClassOutput)
+			return;
+		if (!interface_variable_exists_in_entry_point(var.self))
+			return;
 
-			dominator = succ.front();
-		}
+		// Also, make sure we preserve output variables which are only initialized, but never accessed by any code.
+		if (var.initializer != ID(0))
+			handler.add_if_builtin_or_block(var.self);
+	});
 
-		if (!static_loop_init || !has_accessed_variable)
-			continue;
+	found_active_builtins.entry_point = ir.default_entry_point;
+	found_active_builtins.input = active_input_builtins;
+	found_active_builtins.output = active_output_builtins;
+	found_active_builtins.clip_distance_count = clip_distance_count;
+	found_active_builtins.cull_distance_count = cull_distance_count;
+	found_active_builtins.position_invariant = position_invariant;
+	found_active_builtins.reusable = false;
+}
 
-		// The second condition we need to meet is that no access after the loop
-		// merge can occur. Walk the CFG to see if we find anything.
+bool Compiler::reuse_active_builtins()
+{
+	auto &found = found_active_builtins;
+	if (!found.reusable || found.entry_point != ir.default_entry_point)
+		return false;
 
-		seen_blocks.clear();
-		cfg.walk_from(seen_blocks, header_block.merge_block, [&](uint32_t walk_block) -> bool {
-			// We found a block which accesses the variable outside the loop.
-			if (blocks.find(walk_block) != end(blocks))
-				static_loop_init = false;
-			return true;
-		});
+	active_input_builtins = found.input;
+	active_output_builtins = found.output;
+	clip_distance_count = found.clip_distance_count;
+	cull_distance_count = found.cull_distance_count;
+	position_invariant = found.position_invariant;
+	return true;
+}
 
-		if (!static_loop_init)
-			continue;
+// Returns whether this shader uses a builtin of the storage class
+bool Compiler::has_active_builtin(BuiltIn builtin, StorageClass storage) const
+{
+	const Bitset *flags;
+	switch (storage)
+	{
+	case StorageClassInput:
+		flags = &active_input_builtins;
+		break;
+	case StorageClassOutput:
+		flags = &active_output_builtins;
+		break;
 
-		// We have a loop variable.
-		header_block.loop_variables.push_back(loop_variable.first);
-		// Need to sort here as variables come from an unordered container, and pushing stuff in wrong order
-		// will break reproducability in regression runs.
-		sort(begin(header_block.loop_variables), end(header_block.loop_variables));
-		get<SPIRVariable>(loop_variable.first).loop_variable = true;
+	default:
+		return false;
 	}
+	return flags->get(builtin);
 }
 
-bool Compiler::may_read_undefined_variable_in_block(const SPIRBlock &block, uint32_t var)
+void Compiler::update_active_builtins_and_analyze_image_and_sampler_usage()
 {
-	for (auto &op : block.ops)
+	if (reuse_active_builtins())
 	{
-		auto *ops = stream(op);
-		switch (op.op)
-		{
-		case OpStore:
-		case OpCopyMemory:
-			if (ops[0] == var)
-				return false;
-			break;
+		analyze_image_and_sampler_usage();
+		return;
+	}
 
-		case OpAccessChain:
-		case OpInBoundsAccessChain:
-		case OpPtrAccessChain:
-			// Access chains are generally used to partially read and write. It's too hard to analyze
-			// if all constituents are written fully before continuing, so just assume it's preserved.
-			// This is the same as the parameter preservation analysis.
-			if (ops[2] == var)
-				return true;
-			break;
+	reset_active_builtins();
+	ActiveBuiltinHandler builtin_handler(*this);
+	CombinedImageSamplerDrefHandler dref_handler(*this);
+	OpcodeHandlerGroup group({ &builtin_handler, &dref_handler });
+	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), group);
 
-		case OpSelect:
-			// Variable pointers.
-			// We might read before writing.
-			if (ops[3] == var || ops[4] == var)
-				return true;
-			break;
+	finalize_active_builtins(builtin_handler);
+	analyze_image_and_sampler_usage(dref_handler.dref_combined_samplers);
+}
 
-		case OpPhi:
-		{
-			// Variable pointers.
-			// We might read before writing.
-			if (op.length < 2)
-				break;
+void Compiler::analyze_image_and_sampler_usage()
+{
+	CombinedImageSamplerDrefHandler dref_handler(*this);
+	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), dref_handler);
+	analyze_image_and_sampler_usage(dref_handler.dref_combined_samplers);
+}
 
-			uint32_t count = op.length - 2;
-			for (uint32_t i = 0; i < count; i += 2)
-				if (ops[i + 2] == var)
-					return true;
-			break;
-		}
+void Compiler::analyze_image_and_sampler_usage(const unordered_set<uint32_t> &dref_combined_samplers)
+{
+	CombinedImageSamplerUsageHandler handler(*this, dref_combined_samplers);
+	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
 
-		case OpCopyObject:
-		case OpLoad:
-			if (ops[2] == var)
-				return true;
-			break;
+	// Need to run this traversal twice. First time, we propagate any comparison sampler usage from leaf functions
+	// down to main().
+	// In the second pass, we can propagate up forced depth state coming from main() up into leaf functions.
+	handler.dependency_hierarchy.clear();
+	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
 
-		case OpFunctionCall:
-		{
-			if (op.length < 3)
-				break;
+	comparison_ids = std::move(handler.comparison_ids);
+	need_subpass_input = handler.need_subpass_input;
+	need_subpass_input_ms = handler.need_subpass_input_ms;
 
-			// May read before writing.
-			uint32_t count = op.length - 3;
-			for (uint32_t i = 0; i < count; i++)
-				if (ops[i + 3] == var)
-					return true;
-			break;
-		}
+	// Forward information from separate images and samplers into combined image samplers.
+	for (auto &combined : combined_image_samplers)
+		if (comparison_ids.count(combined.sampler_id))
+			comparison_ids.insert(combined.combined_id);
+}
+
+bool Compiler::CombinedImageSamplerDrefHandler::handle(spv::Op opcode, const uint32_t *args, uint32_t)
+{
+	// Mark all sampled images which are used with Dref.
+	switch (opcode)
+	{
+	case OpImageSampleDrefExplicitLod:
+	case OpImageSampleDrefImplicitLod:
+	case OpImageSampleProjDrefExplicitLod:
+	case OpImageSampleProjDrefImplicitLod:
+	case OpImageSparseSampleProjDrefImplicitLod:
+	case OpImageSparseSampleDrefImplicitLod:
+	case OpImageSparseSampleProjDrefExplicitLod:
+	case OpImageSparseSampleDrefExplicitLod:
+	case OpImageDrefGather:
+	case OpImageSparseDrefGather:
+		dref_combined_samplers.insert(args[2]);
+		return true;
 
-		default:
-			break;
-		}
+	default:
+		break;
 	}
 
-	// Not accessed somehow, at least not in a usual fashion.
-	// It's likely accessed in a branch, so assume we must preserve.
 	return true;
 }
 
-Bitset Compiler::get_buffer_block_flags(VariableID id) const
+const CFG &Compiler::get_cfg_for_current_function() const
 {
-	return ir.get_buffer_block_flags(get<SPIRVariable>(id));
+	assert(current_function);
+	return get_cfg_for_function(current_function->self);
 }
 
-bool Compiler::get_common_basic_type(const SPIRType &type, SPIRType::BaseType &base_type)
+const CFG &Compiler::get_cfg_for_function(uint32_t id) const
 {
-	if (type.basetype == SPIRType::Struct)
+	auto cfg_itr = function_cfgs.find(id);
+	assert(cfg_itr != end(function_cfgs));
+	assert(cfg_itr->second);
+	return *cfg_itr->second;
+}
+
+// Returns whether op computes its result from its operands alone, without side effects.
+// id_operands is set to the number of ID operands following the result ID, any further operands are literals.
+static bool opcode_is_pure(Op op, uint32_t length, uint32_t &id_operands)
+{
+	switch (op)
 	{
-		base_type = SPIRType::Unknown;
-		for (auto &member_type : type.member_types)
-		{
-			SPIRType::BaseType member_base;
-			if (!get_common_basic_type(get<SPIRType>(member_type), member_base))
-				return false;
+	case OpSNegate:
+	case OpFNegate:
+	case OpIAdd:
+	case OpFAdd:
+	case OpISub:
+	case OpFSub:
+	case OpIMul:
+	case OpFMul:
+	case OpUDiv:
+	case OpSDiv:
+	case OpFDiv:
+	case OpUMod:
+	case OpSRem:
+	case OpSMod:
+	case OpFRem:
+	case OpFMod:
+	case OpVectorTimesScalar:
+	case OpMatrixTimesScalar:
+	case OpVectorTimesMatrix:
+	case OpMatrixTimesVector:
+	case OpMatrixTimesMatrix:
+	case OpOuterProduct:
+	case OpDot:
+	case OpTranspose:
+	case OpShiftRightLogical:
+	case OpShiftRightArithmetic:
+	case OpShiftLeftLogical:
+	case OpBitwiseOr:
+	case OpBitwiseXor:
+	case OpBitwiseAnd:
+	case OpNot:
+	case OpBitFieldInsert:
+	case OpBitFieldSExtract:
+	case OpBitFieldUExtract:
+	case OpBitReverse:
+	case OpBitCount:
+	case OpAny:
+	case OpAll:
+	case OpIsNan:
+	case OpIsInf:
+	case OpLogicalEqual:
+	case OpLogicalNotEqual:
+	case OpLogicalOr:
+	case OpLogicalAnd:
+	case OpLogicalNot:
+	case OpSelect:
+	case OpIEqual:
+	case OpINotEqual:
+	case OpUGreaterThan:
+	case OpSGreaterThan:
+	case OpUGreaterThanEqual:
+	case OpSGreaterThanEqual:
+	case OpULessThan:
+	case OpSLessThan:
+	case OpULessThanEqual:
+	case OpSLessThanEqual:
+	case OpFOrdEqual:
+	case OpFUnordEqual:
+	case OpFOrdNotEqual:
+	case OpFUnordNotEqual:
+	case OpFOrdLessThan:
+	case OpFUnordLessThan:
+	case OpFOrdGreaterThan:
+	case OpFUnordGreaterThan:
+	case OpFOrdLessThanEqual:
+	case OpFUnordLessThanEqual:
+	case OpFOrdGreaterThanEqual:
+	case OpFUnordGreaterThanEqual:
+	case OpConvertFToU:
+	case OpConvertFToS:
+	case OpConvertSToF:
+	case OpConvertUToF:
+	case OpUConvert:
+	case OpSConvert:
+	case OpFConvert:
+	case OpBitcast:
+	case OpQuantizeToF16:
+	case OpCompositeConstruct:
+	case OpVectorExtractDynamic:
+	case OpVectorInsertDynamic:
+	case OpAccessChain:
+	case OpInBoundsAccessChain:
+		id_operands = length - 2;
+		return true;
 
-			if (base_type == SPIRType::Unknown)
-				base_type = member_base;
-			else if (base_type != member_base)
-				return false;
-		}
+	case OpCompositeExtract:
+		id_operands = 1;
 		return true;
-	}
-	else
-	{
-		base_type = type.basetype;
+
+	case OpVectorShuffle:
+	case OpCompositeInsert:
+		id_operands = 2;
 		return true;
+
+	default:
+		return false;
 	}
 }
 
-void Compiler::ActiveBuiltinHandler::handle_builtin(const SPIRType &type, BuiltIn builtin,
-                                                    const Bitset &decoration_flags)
+void Compiler::eliminate_common_subexpressions(uint32_t min_cost)
 {
-	// If used, we will need to explicitly declare a new array size for these builtins.
+	const auto type_is_value = [&](uint32_t type_id) {
+		auto &type = get<SPIRType>(type_id);
+		if (type.pointer || !type.array.empty())
+			return false;
+		return type.basetype == SPIRType::Boolean || type_is_integral(type) || type_is_floating_point(type);
+	};
 
-	if (builtin == BuiltInClipDistance)
-	{
-		if (!type.array_size_literal[0])
-			SPIRV_CROSS_THROW("Array size for ClipDistance must be a literal.");
-		uint32_t array_size = type.array[0];
-		if (array_size == 0)
-			SPIRV_CROSS_THROW("Array size for ClipDistance must not be unsized.");
-		compiler.clip_distance_count = array_size;
-	}
-	else if (builtin == BuiltInCullDistance)
-	{
-		if (!type.array_size_literal[0])
-			SPIRV_CROSS_THROW("Array size for CullDistance must be a literal.");
-		uint32_t array_size = type.array[0];
-		if (array_size == 0)
-			SPIRV_CROSS_THROW("Array size for CullDistance must not be unsized.");
-		compiler.cull_distance_count = array_size;
-	}
-	else if (builtin == BuiltInPosition)
+	struct Candidate
 	{
-		if (decoration_flags.get(DecorationInvariant))
-			compiler.position_invariant = true;
-	}
-}
+		uint32_t key_offset;
+		uint32_t key_length;
+		uint32_t id;
+	};
 
-void Compiler::ActiveBuiltinHandler::add_if_builtin(uint32_t id, bool allow_blocks)
-{
-	// Only handle plain variables here.
-	// Builtins which are part of a block are handled in AccessChain.
-	// If allow_blocks is used however, this is to handle initializers of blocks,
-	// which implies that all members are written to.
+	// IDs of results which compute the same value as an earlier result, mapped to that result.
+	unordered_map<uint32_t, uint32_t> equivalent;
+	const auto canonical = [&](uint32_t id) -> uint32_t {
+		auto itr = equivalent.find(id);
+		return itr != end(equivalent) ? itr->second : id;
+	};
 
-	auto *var = compiler.maybe_get<SPIRVariable>(id);
-	auto *m = compiler.ir.find_meta(id);
-	if (var && m)
+	SmallVector<uint32_t> key;
+	SmallVector<uint32_t> keys;
+	unordered_map<uint64_t, SmallVector<Candidate>> candidates;
+	unordered_map<uint32_t, uint32_t> costs;
+	// Variables which access chains point into.
+	unordered_map<uint32_t, uint32_t> pointer_roots;
+
+	// Duplicates which can be rewritten to a copy of the original result.
+	struct Rewrite
 	{
-		auto &type = compiler.get<SPIRType>(var->basetype);
-		auto &decorations = m->decoration;
-		auto &flags = type.storage == StorageClassInput ?
-		              compiler.active_input_builtins : compiler.active_output_builtins;
-		if (decorations.builtin)
-		{
-			flags.set(decorations.builtin_type);
-			handle_builtin(type, decorations.builtin_type, decorations.decoration_flags);
-		}
-		else if (allow_blocks && compiler.has_decoration(type.self, DecorationBlock))
+		Instruction *instruction;
+		uint32_t id;
+		uint32_t original;
+	};
+	SmallVector<Rewrite> rewrites;
+	unordered_set<uint32_t> rewrite_ids;
+	unordered_set<const Instruction *> rewrite_instructions;
+
+	ir.for_each_typed_id<SPIRBlock>([&](uint32_t, SPIRBlock &block) {
+		keys.clear();
+		candidates.clear();
+		costs.clear();
+
+		// Loads only compute the same value until memory may have been written.
+		uint32_t memory_epoch = 0;
+
+		for (auto &i : block.ops)
 		{
-			uint32_t member_count = uint32_t(type.member_types.size());
-			for (uint32_t i = 0; i < member_count; i++)
+			auto op = static_cast<Op>(i.op);
+			auto *ops = stream(i);
+			uint32_t id_operands = 0;
+			bool pure = opcode_is_pure(op, i.length, id_operands);
+
+			// The extended instruction number is the only literal operand.
+			bool ext_inst = op == OpExtInst && i.length >= 4 && get<SPIRExtension>(ops[2]).ext == SPIRExtension::GLSL;
+			if (ext_inst)
 			{
-				if (compiler.has_member_decoration(type.self, i, DecorationBuiltIn))
+				// These write to or read through a pointer operand.
+				auto glsl_op = static_cast<GLSLstd450>(ops[3]);
+				pure = glsl_op != GLSLstd450Modf && glsl_op != GLSLstd450Frexp &&
+				       glsl_op != GLSLstd450InterpolateAtCentroid && glsl_op != GLSLstd450InterpolateAtSample &&
+				       glsl_op != GLSLstd450InterpolateAtOffset;
+				id_operands = i.length - 2;
+			}
+
+			bool load = op == OpLoad && i.length == 3;
+			if (load)
+			{
+				auto root = pointer_roots.find(ops[2]);
+				uint32_t var = root != end(pointer_roots) ? root->second : ops[2];
+				load = !has_decoration(var, DecorationVolatile);
+			}
+
+			if (!pure && !load)
+			{
+				if (op != OpLine && op != OpNoLine && op != OpNop)
+					memory_epoch++;
+				continue;
+			}
+
+			if (i.length < 2 + id_operands)
+				continue;
+
+			uint32_t result_type = ops[0];
+			uint32_t id = ops[1];
+			bool pointer = get<SPIRType>(result_type).pointer;
+			if (!pointer && !type_is_value(result_type))
+				continue;
+
+			if (op == OpAccessChain || op == OpInBoundsAccessChain)
+			{
+				auto root = pointer_roots.find(ops[2]);
+				pointer_roots[id] = root != end(pointer_roots) ? root->second : ops[2];
+			}
+
+			const auto is_id_operand = [&](uint32_t j) {
+				return ext_inst ? j != 3 : j < 2 + (load ? 1 : id_operands);
+			};
+
+			key.clear();
+			key.push_back(i.op);
+			key.push_back(result_type);
+			if (load)
+				key.push_back(memory_epoch);
+
+			uint32_t cost = 1;
+			for (uint32_t j = 2; j < i.length; j++)
+			{
+				if (!is_id_operand(j))
 				{
-					auto &member_type = compiler.get<SPIRType>(type.member_types[i]);
-					BuiltIn builtin = BuiltIn(compiler.get_member_decoration(type.self, i, DecorationBuiltIn));
-					flags.set(builtin);
-					handle_builtin(member_type, builtin, compiler.get_member_decoration_bitset(type.self, i));
+					key.push_back(ops[j]);
+					continue;
 				}
-			}
-		}
-	}
-}
 
-void Compiler::ActiveBuiltinHandler::add_if_builtin(uint32_t id)
-{
-	add_if_builtin(id, false);
-}
+				uint32_t operand = canonical(ops[j]);
+				key.push_back(operand);
+				auto itr = costs.find(operand);
+				if (itr != end(costs))
+					cost += itr->second;
+			}
+			costs[id] = cost;
 
-void Compiler::ActiveBuiltinHandler::add_if_builtin_or_block(uint32_t id)
-{
-	add_if_builtin(id, true);
-}
+			Hasher h;
+			for (auto word : key)
+				h.u32(word);
+			auto &bucket = candidates[h.get()];
 
-bool Compiler::ActiveBuiltinHandler::handle(spv::Op opcode, const uint32_t *args, uint32_t length)
-{
-	switch (opcode)
-	{
-	case OpStore:
-		if (length < 1)
-			return false;
+			auto itr = find_if(begin(bucket), end(bucket), [&](const Candidate &c) {
+				return c.key_length == key.size() && equal(begin(key), end(key), begin(keys) + c.key_offset) &&
+				       get_decoration_bitset(c.id) == get_decoration_bitset(id);
+			});
 
-		add_if_builtin(args[0]);
-		break;
+			if (itr == end(bucket))
+			{
+				bucket.push_back({ uint32_t(keys.size()), uint32_t(key.size()), id });
+				keys.insert(end(keys), begin(key), end(key));
+				continue;
+			}
 
-	case OpCopyMemory:
-		if (length < 2)
-			return false;
+			uint32_t original = itr->id;
+			equivalent[id] = original;
 
-		add_if_builtin(args[0]);
-		add_if_builtin(args[1]);
-		break;
+			// Pointers cannot be bound to temporaries, but loads through equivalent pointers can still be shared.
+			if (pointer || cost < min_cost)
+				continue;
 
-	case OpCopyObject:
-	case OpLoad:
-		if (length < 3)
-			return false;
+			rewrites.push_back({ &i, id, original });
+			rewrite_ids.insert(id);
+			rewrite_instructions.insert(&i);
+		}
+	});
 
-		add_if_builtin(args[2]);
-		break;
+	// A duplicate which is only read by other rewritten duplicates is dead once they are rewritten,
+	// so binding its original to a temporary would only split up the expression.
+	// Every word which matches a duplicate counts as a read, which at worst keeps a rewrite.
+	unordered_set<uint32_t> read_ids;
+	const auto mark_read = [&](uint32_t id) {
+		if (rewrite_ids.count(id))
+			read_ids.insert(id);
+	};
 
-	case OpSelect:
-		if (length < 5)
-			return false;
+	ir.for_each_typed_id<SPIRBlock>([&](uint32_t, const SPIRBlock &block) {
+		for (auto &i : block.ops)
+		{
+			if (rewrite_instructions.count(&i))
+				continue;
+			auto *ops = stream(i);
+			for (uint32_t j = 0; j < i.length; j++)
+				mark_read(ops[j]);
+		}
 
-		add_if_builtin(args[3]);
-		add_if_builtin(args[4]);
-		break;
+		for (auto &phi : block.phi_variables)
+			mark_read(phi.local_variable);
+		mark_read(block.condition);
+		mark_read(block.return_value);
+	});
 
-	case OpPhi:
+	for (auto &rewrite : rewrites)
 	{
-		if (length < 2)
-			return false;
+		if (!read_ids.count(rewrite.id))
+			continue;
 
-		uint32_t count = length - 2;
-		args += 2;
-		for (uint32_t i = 0; i < count; i += 2)
-			add_if_builtin(args[i]);
-		break;
+		// Turn the instruction into a copy of the original result, which is bound to a temporary.
+		auto &i = *rewrite.instruction;
+		auto *words = stream_mutable(i);
+		words[2] = rewrite.original;
+		i.op = OpCopyObject;
+		i.length = 3;
+		common_subexpressions.insert(rewrite.id);
+		forced_temporaries.insert(rewrite.original);
 	}
+}
 
-	case OpFunctionCall:
+// Operations which lower_relaxed_precision_to_16bit() can compute in 16-bit.
+// Every floating point ID operand has the same component type as the result,
+// so narrowing all of them yields a well-typed 16-bit instruction.
+static bool opcode_has_16bit_form(Op op, const uint32_t *ops, uint32_t length, uint32_t &first_operand,
+                                  uint32_t &operand_count)
+{
+	first_operand = 2;
+	operand_count = length - 2;
+
+	switch (op)
 	{
-		if (length < 3)
-			return false;
+	case OpFAdd:
+	case OpFSub:
+	case OpFMul:
+	case OpFDiv:
+	case OpFMod:
+	case OpFRem:
+	case OpFNegate:
+	case OpVectorTimesScalar:
+	case OpDot:
+	case OpCompositeConstruct:
+	case OpCopyObject:
+	case OpSelect:
+		return true;
 
-		uint32_t count = length - 3;
-		args += 3;
-		for (uint32_t i = 0; i < count; i++)
-			add_if_builtin(args[i]);
-		break;
-	}
+	case OpCompositeExtract:
+		operand_count = 1;
+		return true;
 
-	case OpAccessChain:
-	case OpInBoundsAccessChain:
-	case OpPtrAccessChain:
+	case OpVectorShuffle:
+		operand_count = 2;
+		return true;
+
+	case OpExtInst:
 	{
-		if (length < 4)
+		first_operand = 4;
+		operand_count = length - 4;
+		switch (static_cast<GLSLstd450>(ops[3]))
+		{
+		case GLSLstd450FAbs:
+		case GLSLstd450FSign:
+		case GLSLstd450Floor:
+		case GLSLstd450Ceil:
+		case GLSLstd450Fract:
+		case GLSLstd450Trunc:
+		case GLSLstd450Round:
+		case GLSLstd450RoundEven:
+		case GLSLstd450Sqrt:
+		case GLSLstd450InverseSqrt:
+		case GLSLstd450Sin:
+		case GLSLstd450Cos:
+		case GLSLstd450Exp:
+		case GLSLstd450Exp2:
+		case GLSLstd450Log:
+		case GLSLstd450Log2:
+		case GLSLstd450Pow:
+		case GLSLstd450FMin:
+		case GLSLstd450FMax:
+		case GLSLstd450FClamp:
+		case GLSLstd450FMix:
+		case GLSLstd450Step:
+		case GLSLstd450SmoothStep:
+		case GLSLstd450Fma:
+		case GLSLstd450Length:
+		case GLSLstd450Distance:
+		case GLSLstd450Cross:
+		case GLSLstd450Normalize:
+		case GLSLstd450Reflect:
+		case GLSLstd450FaceForward:
+			return true;
+
+		default:
 			return false;
+		}
+	}
 
-		// Only consider global variables, cannot consider variables in functions yet, or other
-		// access chains as they have not been created yet.
-		auto *var = compiler.maybe_get<SPIRVariable>(args[2]);
-		if (!var)
-			break;
+	default:
+		return false;
+	}
+}
 
-		// Required if we access chain into builtins like gl_GlobalInvocationID.
-		add_if_builtin(args[2]);
+void Compiler::lower_relaxed_precision_to_16bit()
+{
+	const auto type_is_narrowable = [&](uint32_t type_id) {
+		auto &type = get<SPIRType>(type_id);
+		return type.basetype == SPIRType::Float && type.width == 32 && !type.pointer && type.array.empty() &&
+		       type.columns == 1;
+	};
 
-		// Start traversing type hierarchy at the proper non-pointer types.
-		auto *type = &compiler.get_variable_data_type(*var);
+	// Types of everything an instruction can consume.
+	unordered_map<uint32_t, uint32_t> value_types;
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t id, SPIRConstant &c) { value_types[id] = c.constant_type; });
+	ir.for_each_typed_id<SPIRConstantOp>([&](uint32_t id, SPIRConstantOp &c) { value_types[id] = c.basetype; });
+	ir.for_each_typed_id<SPIRUndef>([&](uint32_t id, SPIRUndef &u) { value_types[id] = u.basetype; });
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t id, SPIRVariable &var) { value_types[id] = var.basetype; });
+
+	unordered_set<uint32_t> relaxed_pointers;
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t id, SPIRVariable &) {
+		if (has_decoration(id, DecorationRelaxedPrecision))
+			relaxed_pointers.insert(id);
+	});
 
-		auto &flags =
-		    var->storage == StorageClassInput ? compiler.active_input_builtins : compiler.active_output_builtins;
+	// Values which only need 16-bit precision, and the instructions which will compute them in 16-bit.
+	unordered_set<uint32_t> relaxed;
+	unordered_set<uint32_t> lowered;
 
-		uint32_t count = length - 3;
-		args += 3;
-		for (uint32_t i = 0; i < count; i++)
+	// Functions list their blocks in dominance order, so operands are always seen before their uses.
+	// Parameters keep their 32-bit types, and are narrowed in the blocks which compute with them.
+	SmallVector<BlockID> blocks;
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t, SPIRFunction &func) {
+		blocks.insert(end(blocks), begin(func.blocks), end(func.blocks));
+		for (auto &arg : func.arguments)
 		{
-			// Pointers
-			if (opcode == OpPtrAccessChain && i == 0)
+			value_types[arg.id] = arg.type;
+			if (has_decoration(arg.id, DecorationRelaxedPrecision))
 			{
-				type = &compiler.get<SPIRType>(type->parent_type);
-				continue;
+				if (get<SPIRType>(arg.type).pointer)
+					relaxed_pointers.insert(arg.id);
+				else
+					relaxed.insert(arg.id);
 			}
+		}
+	});
+	// Results of other instructions which lowered instructions consume.
+	unordered_set<uint32_t> narrowed_results;
 
-			// Arrays
-			if (!type->array.empty())
-			{
-				type = &compiler.get<SPIRType>(type->parent_type);
-			}
-			// Structs
-			else if (type->basetype == SPIRType::Struct)
-			{
-				uint32_t index = compiler.get<SPIRConstant>(args[i]).scalar();
+	for (auto block_id : blocks)
+	{
+		for (auto &i : get<SPIRBlock>(block_id).ops)
+		{
+			auto op = static_cast<Op>(i.op);
+			auto *ops = stream(i);
+			bool has_result = false, has_result_type = false;
+			HasResultAndType(op, &has_result, &has_result_type);
+			if (!has_result || !has_result_type || i.length < 2)
+				continue;
 
-				if (index < uint32_t(compiler.ir.meta[type->self].members.size()))
+			uint32_t result_type = ops[0];
+			uint32_t id = ops[1];
+			value_types[id] = result_type;
+
+			if (has_decoration(id, DecorationRelaxedPrecision))
+				relaxed.insert(id);
+
+			if ((op == OpAccessChain || op == OpInBoundsAccessChain) && i.length >= 3)
+			{
+				// Struct members can be relaxed too, even when the block as a whole is not.
+				bool relaxed_pointer = relaxed_pointers.count(ops[2]) != 0;
+				auto type_itr = value_types.find(ops[2]);
+				auto *type = type_itr != end(value_types) ? &get<SPIRType>(get_pointee_type_id(type_itr->second)) :
+				                                            nullptr;
+				for (uint32_t j = 3; j < i.length && type && !relaxed_pointer; j++)
 				{
-					auto &decorations = compiler.ir.meta[type->self].members[index];
-					if (decorations.builtin)
+					if (type->basetype == SPIRType::Struct)
 					{
-						flags.set(decorations.builtin_type);
-						handle_builtin(compiler.get<SPIRType>(type->member_types[index]), decorations.builtin_type,
-						               decorations.decoration_flags);
+						auto *index = maybe_get<SPIRConstant>(ops[j]);
+						if (!index || index->scalar() >= type->member_types.size())
+							break;
+						relaxed_pointer = has_member_decoration(type->self, index->scalar(), DecorationRelaxedPrecision);
+						type = &get<SPIRType>(type->member_types[index->scalar()]);
 					}
+					else
+						type = type->parent_type ? &get<SPIRType>(type->parent_type) : nullptr;
 				}
 
-				type = &compiler.get<SPIRType>(type->member_types[index]);
+				if (relaxed_pointer || relaxed.count(id))
+					relaxed_pointers.insert(id);
+				continue;
 			}
-			else
+
+			if (op == OpLoad && i.length >= 3 && relaxed_pointers.count(ops[2]))
+				relaxed.insert(id);
+
+			if (op == OpExtInst && get<SPIRExtension>(ops[2]).ext != SPIRExtension::GLSL)
+				continue;
+
+			uint32_t first_operand, operand_count;
+			if (!type_is_narrowable(result_type) ||
+			    !opcode_has_16bit_form(op, ops, i.length, first_operand, operand_count))
+				continue;
+
+			bool lowerable = true;
+			bool has_relaxed_operand = false;
+			bool has_non_relaxed_operand = false;
+			for (uint32_t j = first_operand; j < first_operand + operand_count && lowerable; j++)
 			{
-				// No point in traversing further. We won't find any extra builtins.
-				break;
+				auto type_itr = value_types.find(ops[j]);
+				if (type_itr == end(value_types))
+				{
+					lowerable = false;
+					break;
+				}
+
+				auto &type = get<SPIRType>(type_itr->second);
+				if (type.basetype != SPIRType::Float)
+					continue;
+
+				lowerable = type_is_narrowable(type_itr->second);
+				if (relaxed.count(ops[j]))
+					has_relaxed_operand = true;
+				else if (ir.ids[ops[j]].get_type() != TypeConstant)
+					has_non_relaxed_operand = true;
 			}
+
+			if (!lowerable)
+				continue;
+
+			// Moving relaxed values around keeps them relaxed, like loads through relaxed pointers.
+			bool moves_data = op == OpCopyObject || op == OpCompositeExtract || op == OpVectorShuffle ||
+			                  op == OpCompositeConstruct;
+			if (moves_data && has_relaxed_operand && !has_non_relaxed_operand)
+				relaxed.insert(id);
+
+			if (!relaxed.count(id))
+				continue;
+
+			lowered.insert(id);
+			for (uint32_t j = first_operand; j < first_operand + operand_count; j++)
+				if (!lowered.count(ops[j]))
+					narrowed_results.insert(ops[j]);
 		}
-		break;
 	}
 
-	default:
-		break;
-	}
+	if (lowered.empty())
+		return;
 
-	return true;
-}
+	// Lowered results only need to be widened back to 32-bit where something else reads them.
+	// Not every word is an ID, but widening a value which is never read is harmless.
+	unordered_set<uint32_t> widened;
+	for (auto block_id : blocks)
+	{
+		auto &block = get<SPIRBlock>(block_id);
+		for (auto &i : block.ops)
+		{
+			auto op = static_cast<Op>(i.op);
+			auto *ops = stream(i);
+			bool has_result = false, has_result_type = false;
+			HasResultAndType(op, &has_result, &has_result_type);
 
-void Compiler::update_active_builtins()
-{
-	active_input_builtins.reset();
-	active_output_builtins.reset();
-	cull_distance_count = 0;
-	clip_distance_count = 0;
-	ActiveBuiltinHandler handler(*this);
-	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
+			uint32_t first_word = has_result ? (has_result_type ? 2 : 1) : 0;
+			uint32_t first_operand = 0, operand_count = 0;
+			if (has_result && has_result_type && i.length >= 2 && lowered.count(ops[1]))
+				opcode_has_16bit_form(op, ops, i.length, first_operand, operand_count);
 
-	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
-		if (var.storage != StorageClassOutput)
-			return;
-		if (!interface_variable_exists_in_entry_point(var.self))
-			return;
+			for (uint32_t j = first_word; j < i.length; j++)
+				if ((j < first_operand || j >= first_operand + operand_count) && lowered.count(ops[j]))
+					widened.insert(ops[j]);
+		}
 
-		// Also, make sure we preserve output variables which are only initialized, but never accessed by any code.
-		if (var.initializer != ID(0))
-			handler.add_if_builtin_or_block(var.self);
-	});
-}
+		widened.insert(block.condition);
+		widened.insert(block.return_value);
+		for (auto &phi : block.phi_variables)
+			widened.insert(phi.local_variable);
+	}
+
+	unordered_map<uint32_t, uint32_t> half_types;
+	const auto half_type_of = [&](uint32_t type_id) -> uint32_t {
+		auto itr = half_types.find(type_id);
+		if (itr != end(half_types))
+			return itr->second;
+
+		SPIRType type = get<SPIRType>(type_id);
+		type.basetype = SPIRType::Half;
+		type.width = 16;
+		type.type_alias = 0;
+		uint32_t half_type_id = ir.increase_bound_by(1);
+		type.self = half_type_id;
+		set<SPIRType>(half_type_id, type);
+		half_types[type_id] = half_type_id;
+		return half_type_id;
+	};
 
-// Returns whether this shader uses a builtin of the storage class
-bool Compiler::has_active_builtin(BuiltIn builtin, StorageClass storage) const
-{
-	const Bitset *flags;
-	switch (storage)
+	const auto emit_convert = [&](SmallVector<Instruction> &ops, uint32_t result_type, uint32_t id,
+	                              uint32_t operand) {
+		const uint32_t words[] = { (4u << 16) | OpFConvert, result_type, id, operand };
+		Instruction instr;
+		instr.op = OpFConvert;
+		instr.offset = uint32_t(ir.spirv.size() + 1);
+		instr.length = 3;
+		ir.spirv.append(words, 4);
+		ops.push_back(instr);
+	};
+
+	// 16-bit copies of values. Lowered instructions compute their copy directly,
+	// and widen it into the original ID for everything else.
+	unordered_map<uint32_t, uint32_t> half_ids;
+
+	// Constants are converted up front, so they are emitted as 16-bit literals.
+	const auto narrow_constant = [&](uint32_t id, uint32_t type_id) -> uint32_t {
+		auto *c = maybe_get<SPIRConstant>(id);
+		if (!c || c->specialization || !c->subconstants.empty())
+			return 0;
+		for (uint32_t row = 0; row < c->vector_size(); row++)
+			if (c->specialization_constant_id(0, row))
+				return 0;
+
+		SPIRConstant half_constant = *c;
+		uint32_t half_type = half_type_of(type_id);
+		uint32_t half_id = ir.increase_bound_by(1);
+		half_constant.constant_type = half_type;
+		half_constant.self = half_id;
+		for (uint32_t row = 0; row < half_constant.vector_size(); row++)
+			half_constant.m.c[0].r[row].u32 = SPIRConstant::f32_to_f16(c->scalar_f32(0, row));
+		set<SPIRConstant>(half_id, half_constant);
+		half_ids[id] = half_id;
+		return half_id;
+	};
+	// Constants and values defined outside the block are narrowed once per block.
+	unordered_map<uint32_t, uint32_t> block_half_ids;
+
+	for (auto block_id : blocks)
 	{
-	case StorageClassInput:
-		flags = &active_input_builtins;
-		break;
-	case StorageClassOutput:
-		flags = &active_output_builtins;
-		break;
+		auto &block = get<SPIRBlock>(block_id);
+		block_half_ids.clear();
+		SmallVector<Instruction> rewritten;
+		rewritten.reserve(block.ops.size());
 
-	default:
-		return false;
-	}
-	return flags->get(builtin);
-}
+		for (auto &i : block.ops)
+		{
+			auto op = static_cast<Op>(i.op);
+			auto *ops = stream(i);
+			bool has_result = false, has_result_type = false;
+			HasResultAndType(op, &has_result, &has_result_type);
+			uint32_t id = has_result && has_result_type && i.length >= 2 ? ops[1] : 0;
 
-void Compiler::analyze_image_and_sampler_usage()
-{
-	CombinedImageSamplerDrefHandler dref_handler(*this);
-	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), dref_handler);
+			if (!id || !lowered.count(id))
+			{
+				rewritten.push_back(i);
+				if (id && narrowed_results.count(id) && type_is_narrowable(ops[0]))
+				{
+					uint32_t half_id = ir.increase_bound_by(1);
+					half_ids[id] = half_id;
+					emit_convert(rewritten, half_type_of(ops[0]), half_id, id);
+				}
+				continue;
+			}
 
-	CombinedImageSamplerUsageHandler handler(*this, dref_handler.dref_combined_samplers);
-	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
+			uint32_t first_operand, operand_count;
+			opcode_has_16bit_form(op, ops, i.length, first_operand, operand_count);
 
-	// Need to run this traversal twice. First time, we propagate any comparison sampler usage from leaf functions
-	// down to main().
-	// In the second pass, we can propagate up forced depth state coming from main() up into leaf functions.
-	handler.dependency_hierarchy.clear();
-	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
+			// Appending conversions to the stream invalidates ops.
+			SmallVector<uint32_t> words;
+			words.insert(end(words), ops, ops + i.length);
+			uint32_t result_type = words[0];
 
-	comparison_ids = std::move(handler.comparison_ids);
-	need_subpass_input = handler.need_subpass_input;
-	need_subpass_input_ms = handler.need_subpass_input_ms;
+			for (uint32_t j = first_operand; j < first_operand + operand_count; j++)
+			{
+				uint32_t &operand = words[j];
+				uint32_t operand_type = value_types[operand];
+				if (get<SPIRType>(operand_type).basetype != SPIRType::Float)
+					continue;
 
-	// Forward information from separate images and samplers into combined image samplers.
-	for (auto &combined : combined_image_samplers)
-		if (comparison_ids.count(combined.sampler_id))
-			comparison_ids.insert(combined.combined_id);
-}
+				auto itr = half_ids.find(operand);
+				if (itr != end(half_ids))
+				{
+					operand = itr->second;
+					continue;
+				}
 
-bool Compiler::CombinedImageSamplerDrefHandler::handle(spv::Op opcode, const uint32_t *args, uint32_t)
-{
-	// Mark all sampled images which are used with Dref.
-	switch (opcode)
-	{
-	case OpImageSampleDrefExplicitLod:
-	case OpImageSampleDrefImplicitLod:
-	case OpImageSampleProjDrefExplicitLod:
-	case OpImageSampleProjDrefImplicitLod:
-	case OpImageSparseSampleProjDrefImplicitLod:
-	case OpImageSparseSampleDrefImplicitLod:
-	case OpImageSparseSampleProjDrefExplicitLod:
-	case OpImageSparseSampleDrefExplicitLod:
-	case OpImageDrefGather:
-	case OpImageSparseDrefGather:
-		dref_combined_samplers.insert(args[2]);
-		return true;
+				uint32_t half_constant = narrow_constant(operand, operand_type);
+				if (half_constant)
+				{
+					operand = half_constant;
+					continue;
+				}
 
-	default:
-		break;
-	}
+				auto &half_id = block_half_ids[operand];
+				if (!half_id)
+				{
+					half_id = ir.increase_bound_by(1);
+					emit_convert(rewritten, half_type_of(operand_type), half_id, operand);
+				}
+				operand = half_id;
+			}
 
-	return true;
-}
+			uint32_t half_type = half_type_of(result_type);
+			uint32_t half_id = ir.increase_bound_by(1);
+			half_ids[id] = half_id;
 
-const CFG &Compiler::get_cfg_for_current_function() const
-{
-	assert(current_function);
-	return get_cfg_for_function(current_function->self);
-}
+			// The 16-bit value is the one declared in the output, so let it take over the name.
+			ir.meta[half_id] = ir.meta[id];
+			ir.meta[id].decoration.alias.clear();
 
-const CFG &Compiler::get_cfg_for_function(uint32_t id) const
-{
-	auto cfg_itr = function_cfgs.find(id);
-	assert(cfg_itr != end(function_cfgs));
-	assert(cfg_itr->second);
-	return *cfg_itr->second;
+			words[0] = half_type;
+			words[1] = half_id;
+			copy(begin(words), end(words), stream_mutable(i));
+			rewritten.push_back(i);
+			if (widened.count(id))
+				emit_convert(rewritten, result_type, id, half_id);
+		}
+
+		block.ops = std::move(rewritten);
+	}
 }
 
 void Compiler::build_function_control_flow_graphs_and_analyze()
 {
 	CFGBuilder handler(*this);
-	handler.function_cfgs[ir.default_entry_point].reset(new CFG(*this, get<SPIRFunction>(ir.default_entry_point)));
+	handler.function_cfgs[ir.default_entry_point] = nullptr;
 	traverse_all_reachable_opcodes(get<SPIRFunction>(ir.default_entry_point), handler);
+
+	// CFGs kept by reset_for_recompile() are still valid, unless specialization changed the control flow.
+	auto previous_cfgs = std::move(function_cfgs);
+	if (specialized_control_flow)
+		previous_cfgs.clear();
 	function_cfgs = std::move(handler.function_cfgs);
 	bool single_function = function_cfgs.size() <= 1;
+	find_duplicate_constants();
+
+	// Building a CFG only reads the IR, so every function can be built independently.
+	SmallVector<uint32_t> functions;
+	SmallVector<std::unique_ptr<CFG>> cfgs;
+	functions.reserve(function_cfgs.size());
+	for (auto &f : function_cfgs)
+	{
+		auto itr = previous_cfgs.find(f.first);
+		if (itr != end(previous_cfgs) && itr->second)
+			f.second = std::move(itr->second);
+		else
+			functions.push_back(f.first);
+	}
+	cfgs.resize(functions.size());
+
+	run_tasks(uint32_t(functions.size()),
+	          [&](uint32_t i) { cfgs[i].reset(new CFG(*this, get<SPIRFunction>(functions[i]))); });
+
+	for (size_t i = 0; i < functions.size(); i++)
+		function_cfgs[functions[i]] = std::move(cfgs[i]);
 
 	for (auto &f : function_cfgs)
 	{
@@ -4611,9 +7227,10 @@ bool Compiler::CFGBuilder::handle(spv::Op, const uint32_t *, uint32_t)
 
 bool Compiler::CFGBuilder::follow_function_call(const SPIRFunction &func)
 {
+	// The CFGs themselves are built once all reachable functions are known.
 	if (function_cfgs.find(func.self) == end(function_cfgs))
 	{
-		function_cfgs[func.self].reset(new CFG(compiler, func));
+		function_cfgs[func.self] = nullptr;
 		return true;
 	}
 	else
@@ -4818,6 +7435,11 @@ std::string Compiler::get_remapped_declared_block_name(uint32_t id, bool fallbac
 }
 
 bool Compiler::reflection_ssbo_instance_name_is_significant() const
+{
+	return reflection_ssbo_instance_name_is_significant(ir, nullptr);
+}
+
+bool Compiler::reflection_ssbo_instance_name_is_significant(const ParsedIR &ir, const GlobalVariableIndex *index)
 {
 	if (ir.source.known)
 	{
@@ -4831,13 +7453,13 @@ bool Compiler::reflection_ssbo_instance_name_is_significant() const
 	bool aliased_ssbo_types = false;
 
 	// If we don't have any OpSource information, we need to perform some shaky heuristics.
-	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
-		auto &type = this->get<SPIRType>(var.basetype);
+	const auto check_ssbo = [&](uint32_t, const SPIRVariable &var) {
+		auto &type = ir.get<SPIRType>(var.basetype);
 		if (!type.pointer || var.storage == StorageClassFunction)
 			return;
 
 		bool ssbo = var.storage == StorageClassStorageBuffer ||
-		            (var.storage == StorageClassUniform && has_decoration(type.self, DecorationBufferBlock));
+		            (var.storage == StorageClassUniform && ir.has_decoration(type.self, DecorationBufferBlock));
 
 		if (ssbo)
 		{
@@ -4846,7 +7468,16 @@ bool Compiler::reflection_ssbo_instance_name_is_significant() const
 			else
 				ssbo_type_ids.insert(type.self);
 		}
-	});
+	};
+
+	if (index)
+	{
+		for (auto storage : { StorageClassUniform, StorageClassStorageBuffer })
+			for (auto id : index->get(storage))
+				check_ssbo(id, ir.get<SPIRVariable>(id));
+	}
+	else
+		ir.for_each_typed_id<SPIRVariable>(check_ssbo);
 
 	// If the block name is aliased, assume we have HLSL-style UAV declarations.
 	return aliased_ssbo_types;
@@ -4949,6 +7580,8 @@ bool Compiler::type_is_opaque_value(const SPIRType &type) const
 void Compiler::force_recompile()
 {
 	is_force_recompile = true;
+	is_force_recompile_full = true;
+	force_recompile_count++;
 }
 
 void Compiler::force_recompile_guarantee_forward_progress()
@@ -4957,17 +7590,140 @@ void Compiler::force_recompile_guarantee_forward_progress()
 	is_force_recompile_forward_progress = true;
 }
 
+void Compiler::force_function_recompile()
+{
+	// Outside a function body we cannot know who depends on the invalidated state.
+	if (!current_function)
+		is_force_recompile_full = true;
+	is_force_recompile = true;
+	force_recompile_count++;
+}
+
+void Compiler::force_function_recompile_guarantee_forward_progress()
+{
+	force_function_recompile();
+	is_force_recompile_forward_progress = true;
+}
+
 bool Compiler::is_forcing_recompilation() const
 {
 	return is_force_recompile;
 }
 
+bool Compiler::is_forcing_full_recompilation() const
+{
+	return is_force_recompile_full;
+}
+
 void Compiler::clear_force_recompile()
 {
 	is_force_recompile = false;
+	is_force_recompile_full = false;
 	is_force_recompile_forward_progress = false;
 }
 
+static uint64_t get_time_ns()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+	                    std::chrono::steady_clock::now().time_since_epoch())
+	                    .count());
+}
+
+Compiler::PassProfiler::PassProfiler(Compiler &compiler_, const char *name_)
+    : compiler(compiler_)
+    , name(name_)
+    , active(bool(compiler_.profile_callback))
+{
+	// Pass boundaries are where running out of the budget is noticed at the latest.
+	compiler.compile_budget.poll();
+
+	if (active)
+	{
+		start_allocations = compiler.ir.get_allocation_count();
+		start_force_recompiles = compiler.force_recompile_count;
+		start_ns = get_time_ns();
+	}
+}
+
+Compiler::PassProfiler::~PassProfiler()
+{
+	finish();
+}
+
+void Compiler::PassProfiler::finish(uint32_t passes)
+{
+	if (!active)
+		return;
+	active = false;
+
+	CompilerPassProfile profile = {};
+	profile.name = name;
+	profile.seconds = double(get_time_ns() - start_ns) * 1e-9;
+	profile.allocations = compiler.ir.get_allocation_count() - start_allocations;
+	profile.passes = passes;
+	profile.force_recompiles = compiler.force_recompile_count - start_force_recompiles;
+	compiler.profile_callback(profile);
+}
+
+void Compiler::CompileBudgetTracker::set(const CompileBudget &budget_)
+{
+	budget = budget_;
+	enabled = budget.max_seconds > 0.0 || budget.max_work != 0 || budget.cancel != nullptr;
+	active = enabled && scope_depth != 0;
+}
+
+Compiler::CompileBudgetTracker::Scope::Scope(CompileBudgetTracker &tracker_)
+    : tracker(tracker_)
+{
+	// Does not poll, so that the destructor always runs. The first pass polls right away.
+	if (tracker.scope_depth++ != 0)
+		return;
+
+	tracker.active = tracker.enabled;
+	tracker.work = 0;
+	tracker.next_poll = 0;
+	tracker.deadline_ns =
+	    tracker.budget.max_seconds > 0.0 ? get_time_ns() + uint64_t(tracker.budget.max_seconds * 1e9) : 0;
+}
+
+Compiler::CompileBudgetTracker::Scope::~Scope()
+{
+	if (--tracker.scope_depth == 0)
+		tracker.active = false;
+}
+
+void Compiler::CompileBudgetTracker::poll()
+{
+	if (!active)
+		return;
+
+	if (budget.cancel && budget.cancel->load(std::memory_order_relaxed))
+		SPIRV_CROSS_CANCEL("Compilation was cancelled.");
+	if (budget.max_work != 0 && work > budget.max_work)
+		SPIRV_CROSS_CANCEL("Compilation exceeded its work budget.");
+	if (deadline_ns != 0 && get_time_ns() > deadline_ns)
+		SPIRV_CROSS_CANCEL("Compilation exceeded its time budget.");
+
+	// Reading the clock is much more expensive than counting.
+	const uint64_t poll_interval = 1024;
+	next_poll = work + poll_interval;
+	if (budget.max_work != 0 && budget.max_work < next_poll)
+		next_poll = budget.max_work + 1;
+}
+
+void Compiler::run_tasks(uint32_t count, const std::function<void(uint32_t)> &task) const
+{
+	if (task_runner && count > 1)
+	{
+		task_runner(count, task);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < count; i++)
+			task(i);
+	}
+}
+
 Compiler::PhysicalStorageBufferPointerHandler::PhysicalStorageBufferPointerHandler(Compiler &compiler_)
     : compiler(compiler_)
 {
@@ -30,6 +30,7 @@
 #include "spirv.hpp"
 #include "spirv_cfg.hpp"
 #include "spirv_cross_parsed_ir.hpp"
+#include <atomic>
 
 namespace SPIRV_CROSS_NAMESPACE
 {
@@ -154,11 +155,107 @@ struct EntryPoint
 	spv::ExecutionModel execution_model;
 };
 
+// What Compiler::remove_unreachable_ids() removed from the IR.
+struct RemovedIDs
+{
+	SmallVector<FunctionID> functions;
+	SmallVector<VariableID> variables;
+	SmallVector<TypeID> types;
+};
+
+// Statistics for one pass of Compiler::compile(), see Compiler::set_profile_callback().
+struct CompilerPassProfile
+{
+	// Name of the pass, e.g. "update_active_builtins" or "emit".
+	const char *name;
+	// Wall time spent in the pass.
+	double seconds;
+	// Number of IR objects (types, expressions, variables, ...) allocated while the pass ran.
+	uint64_t allocations;
+	// Number of times the pass ran. Only emission is repeated, when a force-recompile was requested.
+	uint32_t passes;
+	// Number of force-recompile requests made while the pass ran.
+	uint32_t force_recompiles;
+};
+
+using CompilerProfileCallback = std::function<void(const CompilerPassProfile &profile)>;
+
+// Estimated resource costs of a compiled entry point, see Compiler::get_resource_cost_report().
+// Sizes are in bytes, laid out like std430 except that 3-component vectors take the space of 4 components.
+struct ResourceCostReport
+{
+	// Workgroup variables accessed by the entry point.
+	uint32_t workgroup_memory_size = 0;
+	// Workgroup memory the backend declares on top of the workgroup variables,
+	// e.g. the per-patch storage of MSL tessellation control shaders with multi_patch_workgroup.
+	uint32_t backend_workgroup_memory_size = 0;
+	// Function and Private variables of array type accessed by the entry point.
+	uint32_t local_array_size = 0;
+	uint32_t hoisted_temporary_count = 0;
+	uint32_t forced_temporary_count = 0;
+	// Loops in the functions the entry point calls, including itself, counting each function once.
+	uint32_t loop_count = 0;
+	// Helper functions and polyfills the backend emitted, e.g. "Inverse4x4".
+	SmallVector<std::string> helper_functions;
+};
+
+// Where a resource ended up when the backend indexes descriptors out of a heap instead of binding them,
+// see CompilerHLSL::Options::descriptor_heap_indexing and CompilerGLSL::Options::descriptor_heap_indexing.
+// The application writes the heap index of the resource bound at desc_set/binding to the 32-bit word index
+// of the index block the backend declares.
+struct DescriptorHeapSlot
+{
+	VariableID id;
+	uint32_t desc_set;
+	uint32_t binding;
+	// HLSL: the slot indexes SamplerDescriptorHeap rather than ResourceDescriptorHeap.
+	// Combined image samplers take one slot for each heap.
+	bool sampler_heap;
+	// GLSL: binding of the runtime array the resource is indexed from in the heap descriptor set.
+	uint32_t heap_binding;
+	uint32_t index;
+};
+
+// A constant lookup table which the backend declared as a read-only buffer instead of inline literals,
+// see CompilerGLSL::Options::lut_buffer_min_size and CompilerHLSL::Options::lut_buffer_min_size.
+// The application binds a buffer holding data at desc_set/binding, which is a register and space in HLSL.
+struct LoweredLUT
+{
+	ConstantID constant;
+	uint32_t desc_set;
+	uint32_t binding;
+	// The elements of the table, tightly packed 32-bit values in host byte order.
+	std::vector<uint8_t> data;
+};
+
+// Limits how much one call to Compiler::compile() may do, see Compiler::set_compile_budget().
+struct CompileBudget
+{
+	// Wall clock time compile() may take. 0 means no limit.
+	double max_seconds = 0.0;
+	// Work compile() may do, counted as instructions visited by analysis passes and instructions emitted,
+	// over every pass forced by recompilation. 0 means no limit.
+	uint64_t max_work = 0;
+	// compile() stops soon after another thread sets the flag. The flag is only read.
+	const std::atomic<bool> *cancel = nullptr;
+};
+
+// Receives the output of Compiler::compile_to() in pieces, in order.
+class OutputSink
+{
+public:
+	virtual ~OutputSink() = default;
+	virtual void write(const char *data, size_t size) = 0;
+};
+
+class ReflectionView;
+
 class Compiler
 {
 public:
 	friend class CFG;
 	friend class DominatorBuilder;
+	friend class ReflectionView;
 
 	// The constructor takes a buffer of SPIR-V words and parses it.
 	// It will create its own parser, parse the SPIR-V and move the parsed IR
@@ -168,6 +265,8 @@ public:
 
 	// This is more modular. We can also consume a ParsedIR structure directly, either as a move, or copy.
 	// With copy, we can reuse the same parsed IR for multiple Compiler instances.
+	// The copy never modifies the source IR and shares its SPIR-V words, so Compiler instances can be constructed
+	// from the same ParsedIR concurrently and then compile on separate threads.
 	explicit Compiler(const ParsedIR &ir);
 	explicit Compiler(ParsedIR &&ir);
 
@@ -178,6 +277,66 @@ public:
 	// Sub-classes actually implement this.
 	virtual std::string compile();
 
+	// Like compile(), but writes the output to sink straight from the buffers it was emitted into,
+	// without building a string for it. Only the final output is written, after any recompilation passes,
+	// so nothing reaches the sink if compilation fails.
+	void compile_to(OutputSink &sink);
+
+	// Compiles every entry point of the module, and returns one output per get_entry_points_and_stages() entry,
+	// in the same order. Has to be called instead of compile().
+	// Each entry point is compiled like reset_for_recompile() followed by set_entry_point() and compile(),
+	// so decorations and names set through the API before the call apply to every entry point.
+	// Backend specific remapping such as resource bindings is reset for each entry point,
+	// so set it up in setup, which is called once the entry point is selected.
+	// Control flow graphs of functions reachable from several entry points are only built once.
+	// If reports is not null, it receives get_resource_cost_report() for each entry point, in the same order.
+	SmallVector<std::string> compile_all_entry_points(const std::function<void(const EntryPoint &entry)> &setup = {},
+	                                                  SmallVector<ResourceCostReport> *reports = nullptr);
+
+	// Like compile_all_entry_points(), but passes each output to output as soon as its entry point has compiled,
+	// instead of holding every output until the end. The compiler state, e.g. get_resource_cost_report(),
+	// belongs to that entry point while output runs. The string is released once output returns.
+	void compile_all_entry_points_to(const std::function<void(const EntryPoint &entry)> &setup,
+	                                 const std::function<void(const EntryPoint &entry, std::string &source)> &output);
+
+	// Estimates what the entry point compiled by the last compile() costs on the GPU,
+	// e.g. to flag shaders which are likely to run at low occupancy before they are tested on a device.
+	// Has to be called after compile().
+	ResourceCostReport get_resource_cost_report() const;
+
+	// Resources the last compile() indexes out of a descriptor heap, if the backend was asked to.
+	const SmallVector<DescriptorHeapSlot> &get_descriptor_heap_slots() const;
+
+	// Lookup tables the last compile() declared as buffers, if the backend was asked to.
+	const SmallVector<LoweredLUT> &get_lowered_luts() const;
+
+	// Returns the compiler to the state it had when compile() was first called, so that it can compile again,
+	// e.g. with different options, without constructing a new compiler.
+	// The first compile() saves the IR as it was, including the entry point, decorations and names set through the API,
+	// and this restores it into the objects the previous compile() left behind, reusing their storage.
+	// Options of the backend, the profile callback, the task runner and the compile budget are kept,
+	// and control flow graphs and active builtins found by the previous compile() are reused.
+	// Backend specific remapping such as resource bindings is reset and has to be set up again.
+	// Before the first compile(), the IR is kept as it is.
+	virtual void reset_for_recompile();
+
+	// Like reset_for_recompile(), but restores ir instead of the IR saved by the first compile().
+	// ir may be a later version of the module, e.g. from Parser::parse_incremental() when a shader is hot reloaded,
+	// so decorations and names set through the API are reset as well.
+	// Functions which are defined by exactly the same words as before, see diff_spirv_modules(),
+	// keep what the previous compile() derived from them, which for GLSL includes their code if it is emitted
+	// the same way again. That only holds if the compiler is set up exactly as for the previous compile(),
+	// with the same entry point, decorations, names and remapping,
+	// otherwise the output would not match a fresh compile.
+	void reset_for_hot_reload(const ParsedIR &ir);
+
+	// The IR as it is now, including decorations, names and constants set through the API.
+	// Before the first compile(), it can be given to serialize_parsed_ir(), e.g. to key a cache of compiled output.
+	const ParsedIR &get_ir() const
+	{
+		return ir;
+	}
+
 	// Gets the identifier (OpName) of an ID. If not defined, an empty string will be returned.
 	const std::string &get_name(ID id) const;
 
@@ -300,6 +459,32 @@ public:
 	// Once set, compile() will only consider the set in active_variables.
 	void set_enabled_interface_variables(std::unordered_set<VariableID> active_variables);
 
+	// Removes functions which the current entry point never calls, global variables which it never accesses,
+	// and types which nothing left refers to from the IR, so that they are neither analyzed nor declared.
+	// Interface variables which get_active_interface_variables() reports are kept, as are all constants,
+	// since specialization constants are part of the interface.
+	// Other entry points are removed along with their functions, so only the current entry point can be compiled
+	// afterwards. This must be called before compile(), and after build_combined_image_samplers() if used.
+	RemovedIDs remove_unreachable_ids();
+
+	// If a stage output is not consumed by the next stage, it can be masked, either by location and component,
+	// or by builtin. A masked output is not emitted in the stage output interface, but rather treated as a private
+	// variable, so that the backend compiler can drop its computation.
+	// Backends which do not support this throw.
+	virtual void mask_stage_output_by_location(uint32_t location, uint32_t component);
+	virtual void mask_stage_output_by_builtin(spv::BuiltIn builtin);
+
+	// Links the stage output interface of the current entry point to the inputs of downstream,
+	// the compiler for the next stage of the pipeline with its entry point set.
+	// Outputs at locations which downstream does not statically read,
+	// see get_active_interface_variables(), are masked with mask_stage_output_by_location().
+	// If pack_locations is true, the varyings which are still linked are moved to the lowest locations,
+	// keeping their order, and everything else is moved past them, on both sides of the interface.
+	// Builtins are neither masked nor moved. I/O blocks and per-vertex outputs of tessellation control shaders
+	// are never masked. Both sides must match by location.
+	// This should be called before anything else keyed by location is set up on either compiler.
+	void link_stage_outputs(Compiler &downstream, bool pack_locations);
+
 	// Query shader resources, use ids with reflection interface to modify or query binding points, etc.
 	ShaderResources get_shader_resources() const;
 
@@ -461,6 +646,16 @@ public:
 	SPIRConstant &get_constant(ConstantID id);
 	const SPIRConstant &get_constant(ConstantID id) const;
 
+	// Supplies the final value of the specialization constant with SpecId constant_id,
+	// as it would be given in VkSpecializationInfo, i.e. the raw bits of the value. Booleans are true if non-zero.
+	// On compile(), such constants become regular constants, specialization constant expressions
+	// which only depend on regular constants are folded, the work group size is resolved to literals where possible,
+	// and branches of selections and switches which can no longer be taken are removed.
+	// Unlike modifying the constant through get_constant(), the output does not depend on a specialization
+	// mechanism of the target language anymore.
+	void set_specialization_constant_value(uint32_t constant_id, uint64_t value);
+	void clear_specialization_constant_values();
+
 	uint32_t get_current_id_bound() const
 	{
 		return uint32_t(ir.ids.size());
@@ -540,8 +735,46 @@ public:
 		return position_invariant;
 	}
 
+	// If set, compile() reports each analysis pass and the emission loop to the callback as they complete.
+	// Useful to find out which pass is slow for a particular shader. When unset, no timing is done.
+	void set_profile_callback(CompilerProfileCallback cb)
+	{
+		profile_callback = std::move(cb);
+	}
+
+	// Bounds each compile() so that a pathological shader cannot hold on to a worker of a compile service.
+	// The budget is checked between passes, while analysis passes traverse opcodes and while instructions are emitted.
+	// When it runs out, compile() throws CompilerCancelledError and the compiler has to be reset before reuse.
+	void set_compile_budget(const CompileBudget &budget)
+	{
+		compile_budget.set(budget);
+	}
+
+	// If set, compile() hands work which is independent per function to the runner instead of doing it serially.
+	// Currently this covers building the control flow graph and dominator tree of each function.
+	// The output does not depend on the runner or on the order in which it runs the tasks.
+	void set_task_runner(CompilerTaskRunner runner)
+	{
+		task_runner = std::move(runner);
+	}
+
+	struct MemoryStatistics : IRMemoryStatistics
+	{
+		// Heap blocks of the output stream, kept from the last compile() until the next one.
+		size_t output_block_count = 0;
+	};
+
+	// Snapshot of the memory held by the compiler's IR and output, to track footprint regressions.
+	// Before compile() this describes the parsed IR, afterwards it includes everything compilation added to it.
+	MemoryStatistics get_memory_statistics() const;
+
 protected:
 	const uint32_t *stream(const Instruction &instr) const
+	{
+		return stream(ir, instr);
+	}
+
+	static const uint32_t *stream(const ParsedIR &ir, const Instruction &instr)
 	{
 		// If we're not going to use any arguments, just return nullptr.
 		// We want to avoid case where we return an out of range pointer
@@ -563,11 +796,26 @@ protected:
 		}
 	}
 
-	uint32_t *stream_mutable(const Instruction &instr) const
+	// The words may be shared with other copies of the IR, so make them private before handing out write access.
+	uint32_t *stream_mutable(const Instruction &instr)
 	{
+		if (!instr.is_embedded() && instr.length)
+			ir.spirv.mutable_data();
 		return const_cast<uint32_t *>(stream(instr));
 	}
 
+	// Only move-assigned by reset_for_recompile(), which replaces the whole compiler state at once.
+	Compiler &operator=(Compiler &&other) = default;
+	// Takes over the IR and what stays valid of previous, which is then left to be replaced.
+	void keep_state_for_recompile(Compiler &previous);
+	// Called first by compile(), saves the IR for reset_for_recompile() unless an earlier compile() did.
+	void save_recompile_snapshot();
+	std::unique_ptr<const ParsedIR> recompile_snapshot;
+	// Set on the previous compiler for the duration of reset_for_hot_reload().
+	const ParsedIR *hot_reload_ir = nullptr;
+	// Functions which reset_for_hot_reload() found unchanged since the previous compile().
+	std::unordered_set<uint32_t> hot_reload_unchanged_functions;
+
 	ParsedIR ir;
 	// Marks variables which have global scope and variables which can alias with other variables
 	// (SSBO, image load store, etc)
@@ -649,6 +897,7 @@ protected:
 
 	// Gets the ID of the SPIR-V type underlying a variable.
 	uint32_t get_variable_data_type_id(const SPIRVariable &var) const;
+	static uint32_t get_variable_data_type_id(const ParsedIR &ir, const SPIRVariable &var);
 
 	// Gets the SPIR-V type underlying a variable.
 	SPIRType &get_variable_data_type(const SPIRVariable &var);
@@ -675,6 +924,7 @@ protected:
 
 	virtual std::string to_name(uint32_t id, bool allow_alias = true) const;
 	bool is_builtin_variable(const SPIRVariable &var) const;
+	static bool is_builtin_variable(const ParsedIR &ir, const SPIRVariable &var);
 	bool is_builtin_type(const SPIRType &type) const;
 	bool is_hidden_variable(const SPIRVariable &var, bool include_builtins = false) const;
 	bool is_immutable(uint32_t id) const;
@@ -727,20 +977,29 @@ protected:
 	void flush_control_dependent_expressions(uint32_t block);
 	void flush_all_atomic_capable_variables();
 	void flush_all_aliased_variables();
-	void register_global_read_dependencies(const SPIRBlock &func, uint32_t id);
 	void register_global_read_dependencies(const SPIRFunction &func, uint32_t id);
+	void collect_global_reads(const SPIRBlock &block, SmallVector<VariableID> &reads);
+	void collect_global_reads(const SPIRFunction &func, SmallVector<VariableID> &reads);
 	std::unordered_set<uint32_t> invalid_expressions;
 
-	void update_name_cache(std::unordered_set<std::string> &cache, std::string &name);
+	void update_name_cache(NameCache &cache, std::string &name);
 
 	// A variant which takes two sets of names. The secondary is only used to verify there are no collisions,
 	// but the set is not updated when we have found a new name.
 	// Used primarily when adding block interface names.
-	void update_name_cache(std::unordered_set<std::string> &cache_primary,
-	                       const std::unordered_set<std::string> &cache_secondary, std::string &name);
+	void update_name_cache(NameCache &cache_primary, const NameCache &cache_secondary, std::string &name);
 
 	bool function_is_pure(const SPIRFunction &func);
 	bool block_is_pure(const SPIRBlock &block);
+	// Functions whose code was reused from an earlier pass or from before reset_for_hot_reload() instead of being
+	// emitted again in this pass. Their expressions and access chains may have been reset since, so
+	// function_is_pure() and register_global_read_dependencies() use what was recorded when they were emitted.
+	struct ReusedFunction
+	{
+		bool pure = false;
+		SmallVector<VariableID> global_reads;
+	};
+	std::unordered_map<uint32_t, ReusedFunction> reused_functions;
 
 	bool execution_is_branchless(const SPIRBlock &from, const SPIRBlock &to) const;
 	bool execution_is_direct_branch(const SPIRBlock &from, const SPIRBlock &to) const;
@@ -749,10 +1008,94 @@ protected:
 
 	void force_recompile();
 	void force_recompile_guarantee_forward_progress();
+	// Like force_recompile(), but only state owned by the function currently being emitted was invalidated.
+	// Backends which cache emitted functions between passes may keep functions which were already complete.
+	void force_function_recompile();
+	void force_function_recompile_guarantee_forward_progress();
 	void clear_force_recompile();
 	bool is_forcing_recompilation() const;
+	bool is_forcing_full_recompilation() const;
 	bool is_force_recompile = false;
+	bool is_force_recompile_full = false;
 	bool is_force_recompile_forward_progress = false;
+	uint32_t force_recompile_count = 0;
+
+	CompilerProfileCallback profile_callback;
+
+	// Backends return finish_output() of their emission buffer from compile().
+	// During compile_to(), the buffer is written to output_sink instead of being copied to a string.
+	// The string overload is for output which was rewritten after emission, e.g. minified.
+	std::string finish_output(const StringStream<> &stream);
+	std::string finish_output(std::string source);
+	OutputSink *output_sink = nullptr;
+	CompilerTaskRunner task_runner;
+	void run_tasks(uint32_t count, const std::function<void(uint32_t index)> &task) const;
+
+	// Measures a pass of compile() from construction until finish() or destruction,
+	// and reports it to the profile callback, if any.
+	class PassProfiler
+	{
+	public:
+		PassProfiler(Compiler &compiler, const char *name);
+		~PassProfiler();
+		void finish(uint32_t passes = 1);
+
+	private:
+		Compiler &compiler;
+		const char *name;
+		bool active;
+		uint64_t start_ns = 0;
+		uint64_t start_allocations = 0;
+		uint32_t start_force_recompiles = 0;
+	};
+
+	// Counts the work done by compile() and throws CompilerCancelledError once the CompileBudget runs out.
+	// Only polls the clock and the cancellation flag every so often, so check() is cheap enough for inner loops.
+	class CompileBudgetTracker
+	{
+	public:
+		void set(const CompileBudget &budget);
+		void poll();
+
+		inline void check()
+		{
+			if (active && ++work >= next_poll)
+				poll();
+		}
+
+		// The budget only applies while a Scope is alive, i.e. for the duration of compile(),
+		// so reflection queries made after compile() returns or throws are not counted or cancelled.
+		// A nested scope belongs to the outermost one.
+		class Scope
+		{
+		public:
+			explicit Scope(CompileBudgetTracker &tracker);
+			~Scope();
+			Scope(const Scope &) = delete;
+			void operator=(const Scope &) = delete;
+
+		private:
+			CompileBudgetTracker &tracker;
+		};
+
+	private:
+		CompileBudget budget;
+		bool enabled = false;
+		bool active = false;
+		uint32_t scope_depth = 0;
+		uint64_t work = 0;
+		uint64_t next_poll = 0;
+		uint64_t deadline_ns = 0;
+	};
+	// Traversals of the const analysis passes count against it too.
+	mutable CompileBudgetTracker compile_budget;
+
+	template <typename Op>
+	void profile_pass(const char *name, const Op &op)
+	{
+		PassProfiler profiler(*this, name);
+		op();
+	}
 
 	bool block_is_noop(const SPIRBlock &block) const;
 	bool block_is_loop_candidate(const SPIRBlock &block, SPIRBlock::Method method) const;
@@ -767,6 +1110,66 @@ protected:
 	// variable is part of that entry points interface.
 	bool interface_variable_exists_in_entry_point(uint32_t id) const;
 
+	// Called by link_stage_outputs() once the stage inputs or outputs have been moved, with the new location
+	// of each one which moved, so that backends can move what they keep by location.
+	virtual void stage_interface_relocated(spv::StorageClass storage,
+	                                       const std::unordered_map<uint32_t, uint32_t> &new_locations);
+
+	struct StageVarying
+	{
+		VariableID var;
+		// Each location the variable takes, in order.
+		SmallVector<uint32_t> locations;
+	};
+	SmallVector<StageVarying> get_stage_varyings(spv::StorageClass storage) const;
+	uint32_t get_stage_varying_location_count(const SPIRType &type) const;
+
+	// Adds the parts of ResourceCostReport which only depend on the SPIR-V of entry_point, not on the compiled output.
+	void get_module_resource_costs(FunctionID entry_point, ResourceCostReport &report) const;
+	// Lets backends add the helper functions they emitted and memory they declared on their own
+	// to get_resource_cost_report().
+	virtual void append_backend_resource_costs(ResourceCostReport &report) const;
+	// Adds the matrix polyfills, given as the Polyfill bits which the GLSL, HLSL and MSL backends share.
+	static void append_polyfill_costs(ResourceCostReport &report, uint32_t polyfills, uint32_t relaxed_polyfills);
+	// For get_memory_statistics().
+	virtual size_t get_output_block_count() const
+	{
+		return 0;
+	}
+	// Size of type as estimated for ResourceCostReport.
+	uint32_t get_estimated_type_size(const SPIRType &type) const;
+
+	SmallVector<DescriptorHeapSlot> descriptor_heap_slots;
+
+	SmallVector<LoweredLUT> lowered_luts;
+	// Lowers lookup tables of arrays of 32-bit scalars which are at least min_size bytes to buffers,
+	// binding them from binding onwards. Tables which are used other than by indexing stay inline.
+	void lower_luts_to_buffers(uint32_t min_size, uint32_t desc_set, uint32_t binding);
+	const LoweredLUT *find_lowered_lut(uint32_t constant) const;
+
+	// Composite constants with the same type and contents as a constant of a lower ID, mapped to that constant.
+	// Backends declare only the latter, so identical tables are emitted once.
+	std::unordered_map<uint32_t, uint32_t> duplicate_constants;
+	void find_duplicate_constants();
+	uint64_t hash_constant_contents(const SPIRConstant &c) const;
+	bool constants_have_equal_contents(const SPIRConstant &a, const SPIRConstant &b) const;
+	bool constant_is_duplicate(uint32_t id) const
+	{
+		return duplicate_constants.count(id) != 0;
+	}
+	uint32_t get_canonical_constant(uint32_t id) const
+	{
+		auto itr = duplicate_constants.find(id);
+		return itr != end(duplicate_constants) ? itr->second : id;
+	}
+	// True for arrays of scalars other than booleans, whose elements are all plain constants.
+	bool constant_is_scalar_table(const SPIRConstant &c) const;
+
+	// Adds a Block struct of tightly packed 32-bit uints and a variable of it in storage,
+	// used to pass descriptor heap indices to the shader.
+	VariableID add_uint_block_variable(const std::string &name, const SmallVector<std::string> &member_names,
+	                                   spv::StorageClass storage);
+
 	SmallVector<CombinedImageSampler> combined_image_samplers;
 
 	void remap_variable_type_name(const SPIRType &type, const std::string &var_name, std::string &type_name) const
@@ -792,6 +1195,9 @@ protected:
 			return true;
 		}
 
+		// Set by the Compiler traversing opcodes, checked for every instruction.
+		CompileBudgetTracker *budget = nullptr;
+
 		virtual bool follow_function_call(const SPIRFunction &)
 		{
 			return true;
@@ -817,20 +1223,76 @@ protected:
 		{
 			return true;
 		}
+
+		// Return true if the handler only accumulates state which does not depend on the call site,
+		// e.g. a set of accessed IDs. Each function is then only traversed once instead of once per call.
+		virtual bool traverse_functions_once() const
+		{
+			return false;
+		}
+
+		// Decides whether the traversal descends into func, honoring traverse_functions_once().
+		bool enter_function(const SPIRFunction &func)
+		{
+			if (!follow_function_call(func))
+				return false;
+			return !traverse_functions_once() || traversed_functions.insert(func.self).second;
+		}
+
+	private:
+		std::unordered_set<uint32_t> traversed_functions;
+	};
+
+	// Runs several independent handlers in one traversal.
+	// Every handler observes exactly the callbacks it would have seen traversing on its own:
+	// a handler which returns false stops receiving callbacks while the others carry on,
+	// and a handler which declines a function call does not see the callee.
+	struct OpcodeHandlerGroup : OpcodeHandler
+	{
+		explicit OpcodeHandlerGroup(std::initializer_list<OpcodeHandler *> handlers_);
+
+		bool handle(spv::Op opcode, const uint32_t *args, uint32_t length) override;
+		bool handle_terminator(const SPIRBlock &block) override;
+		bool follow_function_call(const SPIRFunction &func) override;
+		void set_current_block(const SPIRBlock &block) override;
+		void rearm_current_block(const SPIRBlock &block) override;
+		bool begin_function_scope(const uint32_t *args, uint32_t length) override;
+		bool end_function_scope(const uint32_t *args, uint32_t length) override;
+
+	private:
+		struct Member
+		{
+			OpcodeHandler *handler;
+			// Number of enclosing function calls this handler did not follow.
+			uint32_t suspended_depth;
+			bool finished;
+			bool follows_call;
+		};
+		SmallVector<Member> members;
+
+		bool is_live(const Member &member) const
+		{
+			return !member.finished && member.suspended_depth == 0;
+		}
+		bool any_unfinished() const;
 	};
 
 	struct BufferAccessHandler : OpcodeHandler
 	{
-		BufferAccessHandler(const Compiler &compiler_, SmallVector<BufferRange> &ranges_, uint32_t id_)
-		    : compiler(compiler_)
+		BufferAccessHandler(const ParsedIR &ir_, SmallVector<BufferRange> &ranges_, uint32_t id_)
+		    : ir(ir_)
 		    , ranges(ranges_)
 		    , id(id_)
 		{
 		}
 
 		bool handle(spv::Op opcode, const uint32_t *args, uint32_t length) override;
+		bool traverse_functions_once() const override
+		{
+			return true;
+		}
 
-		const Compiler &compiler;
+		const ParsedIR &ir;
 		SmallVector<BufferRange> &ranges;
 		uint32_t id;
 
@@ -839,18 +1301,41 @@ protected:
 
 	struct InterfaceVariableAccessHandler : OpcodeHandler
 	{
-		InterfaceVariableAccessHandler(const Compiler &compiler_, std::unordered_set<VariableID> &variables_)
-		    : compiler(compiler_)
+		InterfaceVariableAccessHandler(const ParsedIR &ir_, std::unordered_set<VariableID> &variables_)
+		    : ir(ir_)
 		    , variables(variables_)
 		{
 		}
 
 		bool handle(spv::Op opcode, const uint32_t *args, uint32_t length) override;
+		bool traverse_functions_once() const override
+		{
+			return true;
+		}
 
-		const Compiler &compiler;
+		const ParsedIR &ir;
 		std::unordered_set<VariableID> &variables;
 	};
 
+	// Collects every ID used as an operand. Literal operands are skipped where the opcode is known to have them,
+	// any other operand counts as an ID, so this errs on the side of keeping IDs.
+	struct ReachableIDsHandler : OpcodeHandler
+	{
+		explicit ReachableIDsHandler(std::unordered_set<uint32_t> &ids_)
+		    : ids(ids_)
+		{
+		}
+
+		bool handle(spv::Op opcode, const uint32_t *args, uint32_t length) override;
+		bool handle_terminator(const SPIRBlock &block) override;
+		bool traverse_functions_once() const override
+		{
+			return true;
+		}
+
+		std::unordered_set<uint32_t> &ids;
+	};
+
 	struct CombinedImageSamplerHandler : OpcodeHandler
 	{
 		CombinedImageSamplerHandler(Compiler &compiler_)
@@ -894,6 +1379,10 @@ protected:
 		}
 
 		bool handle(spv::Op opcode, const uint32_t *args, uint32_t length) override;
+		bool traverse_functions_once() const override
+		{
+			return true;
+		}
 		Compiler &compiler;
 
 		void handle_builtin(const SPIRType &type, spv::BuiltIn builtin, const Bitset &decoration_flags);
@@ -902,13 +1391,48 @@ protected:
 		void add_if_builtin(uint32_t id, bool allow_blocks);
 	};
 
+	void reset_active_builtins();
+	void finalize_active_builtins(ActiveBuiltinHandler &handler);
+
 	bool traverse_all_reachable_opcodes(const SPIRBlock &block, OpcodeHandler &handler) const;
 	bool traverse_all_reachable_opcodes(const SPIRFunction &block, OpcodeHandler &handler) const;
+	// Traversals which only need the module, usable without a Compiler.
+	static bool traverse_all_reachable_opcodes(const ParsedIR &ir, const SPIRBlock &block, OpcodeHandler &handler);
+	static bool traverse_all_reachable_opcodes(const ParsedIR &ir, const SPIRFunction &func, OpcodeHandler &handler);
 	// This must be an ordered data structure so we always pick the same type aliases.
 	SmallVector<uint32_t> global_struct_cache;
 
 	ShaderResources get_shader_resources(const std::unordered_set<VariableID> *active_variables) const;
 
+	// Global variables, i.e. all variables which are not in Function storage, in ID order and by storage class.
+	// Function-local variables make up most of the variables in large modules, and none of them are relevant
+	// for reflection, so ReflectionView keeps this to not look at them for every query.
+	struct GlobalVariableIndex
+	{
+		SmallVector<VariableID> variables;
+		std::unordered_map<uint32_t, SmallVector<VariableID>> by_storage;
+		bool built = false;
+
+		void build(const ParsedIR &ir);
+		const SmallVector<VariableID> &get(spv::StorageClass storage) const;
+	};
+
+	// Reflection which only needs the module and an entry point, shared with ReflectionView.
+	// Block names are reported through a callback, since a Compiler reports the names its backend declared.
+	// If index is null, all variables of the module are visited instead.
+	using BlockNameCallback = std::function<std::string(const SPIRVariable &var, bool prefer_instance_name)>;
+	static ShaderResources get_shader_resources(const ParsedIR &ir, const SPIREntryPoint &entry,
+	                                            const GlobalVariableIndex *index,
+	                                            const std::unordered_set<VariableID> *active_variables,
+	                                            const BlockNameCallback &get_block_name);
+	static void collect_active_interface_variables(const ParsedIR &ir, const SPIREntryPoint &entry,
+	                                               const GlobalVariableIndex *index,
+	                                               std::unordered_set<VariableID> &variables,
+	                                               CompileBudgetTracker *budget);
+	static bool reflection_ssbo_instance_name_is_significant(const ParsedIR &ir, const GlobalVariableIndex *index);
+	static bool interface_variable_exists_in_entry_point(const ParsedIR &ir, const SPIREntryPoint &entry,
+	                                                     const SPIRVariable &var);
+
 	VariableTypeRemapCallback variable_remap_callback;
 
 	bool get_common_basic_type(const SPIRType &type, SPIRType::BaseType &base_type);
@@ -918,6 +1442,12 @@ protected:
 	std::unordered_set<uint32_t> suppressed_usage_tracking;
 	std::unordered_set<uint32_t> hoisted_temporaries;
 	std::unordered_set<uint32_t> forced_invariant_temporaries;
+	// Results which eliminate_common_subexpressions() turned into copies of an identical result bound to a temporary.
+	std::unordered_set<uint32_t> common_subexpressions;
+	void eliminate_common_subexpressions(uint32_t min_cost);
+	// Computes RelaxedPrecision float arithmetic on 16-bit copies of its operands,
+	// converting back to 32-bit wherever the result is consumed at full precision.
+	void lower_relaxed_precision_to_16bit();
 
 	Bitset active_input_builtins;
 	Bitset active_output_builtins;
@@ -925,10 +1455,20 @@ protected:
 	uint32_t cull_distance_count = 0;
 	bool position_invariant = false;
 
-	void analyze_parameter_preservation(
-	    SPIRFunction &entry, const CFG &cfg,
-	    const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &variable_to_blocks,
-	    const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &complete_write_blocks);
+	// What update_active_builtins() found for an entry point, before backends add the builtins they need.
+	// Kept by reset_for_recompile(), so that compiling again does not look for them again.
+	struct ActiveBuiltins
+	{
+		FunctionID entry_point = 0;
+		Bitset input;
+		Bitset output;
+		uint32_t clip_distance_count = 0;
+		uint32_t cull_distance_count = 0;
+		bool position_invariant = false;
+		bool reusable = false;
+	};
+	ActiveBuiltins found_active_builtins;
+	bool reuse_active_builtins();
 
 	// If a variable ID or parameter ID is found in this set, a sampler is actually a shadow/comparison sampler.
 	// SPIR-V does not support this distinction, so we must keep track of this information outside the type system.
@@ -945,6 +1485,10 @@ protected:
 	uint32_t dummy_sampler_id = 0;
 
 	void analyze_image_and_sampler_usage();
+	void analyze_image_and_sampler_usage(const std::unordered_set<uint32_t> &dref_combined_samplers);
+	// Equivalent to update_active_builtins() followed by analyze_image_and_sampler_usage(),
+	// but their first walks over the call tree are independent, so they share one traversal.
+	void update_active_builtins_and_analyze_image_and_sampler_usage();
 
 	struct CombinedImageSamplerDrefHandler : OpcodeHandler
 	{
@@ -953,6 +1497,10 @@ protected:
 		{
 		}
 		bool handle(spv::Op opcode, const uint32_t *args, uint32_t length) override;
+		bool traverse_functions_once() const override
+		{
+			return true;
+		}
 
 		Compiler &compiler;
 		std::unordered_set<uint32_t> dref_combined_samplers;
@@ -981,6 +1529,15 @@ protected:
 		void add_dependency(uint32_t dst, uint32_t src);
 	};
 
+	std::unordered_map<uint32_t, uint64_t> specialization_constant_values;
+	// Set if specialize_constants() changed control flow, which makes CFGs of the unspecialized module stale.
+	bool specialized_control_flow = false;
+	void specialize_constants();
+	// Types which anything still declared or reachable refers to, once specialize_constants() folded the module.
+	std::unordered_set<uint32_t> get_types_referenced_after_specialization() const;
+	bool fold_specialization_constant_op(const SPIRConstantOp &op);
+	bool prune_specialized_branches(SPIRFunction &func);
+
 	void build_function_control_flow_graphs_and_analyze();
 	std::unordered_map<uint32_t, std::unique_ptr<CFG>> function_cfgs;
 	const CFG &get_cfg_for_current_function() const;
@@ -1003,24 +1560,36 @@ protected:
 		bool follow_function_call(const SPIRFunction &) override;
 		void set_current_block(const SPIRBlock &block) override;
 
-		void notify_variable_access(uint32_t id, uint32_t block);
+		void notify_variable_access(uint32_t id, uint32_t block_index);
 		bool id_is_phi_variable(uint32_t id) const;
 		bool id_is_potential_temporary(uint32_t id) const;
 		bool handle(spv::Op op, const uint32_t *args, uint32_t length) override;
 		bool handle_terminator(const SPIRBlock &block) override;
 
+		// Blocks are tracked by their index in entry.blocks, so the sets of blocks below are dense bitsets.
+		uint32_t get_block_index(uint32_t block) const;
+		uint32_t get_block_id(uint32_t index) const
+		{
+			return entry.blocks[index];
+		}
+
 		Compiler &compiler;
 		SPIRFunction &entry;
-		std::unordered_map<uint32_t, std::unordered_set<uint32_t>> accessed_variables_to_block;
-		std::unordered_map<uint32_t, std::unordered_set<uint32_t>> accessed_temporaries_to_block;
+		std::unordered_map<uint32_t, DenseBitset> accessed_variables_to_block;
+		std::unordered_map<uint32_t, DenseBitset> accessed_temporaries_to_block;
 		std::unordered_map<uint32_t, uint32_t> result_id_to_type;
-		std::unordered_map<uint32_t, std::unordered_set<uint32_t>> complete_write_variables_to_block;
-		std::unordered_map<uint32_t, std::unordered_set<uint32_t>> partial_write_variables_to_block;
+		std::unordered_map<uint32_t, DenseBitset> complete_write_variables_to_block;
+		std::unordered_map<uint32_t, DenseBitset> partial_write_variables_to_block;
 		std::unordered_set<uint32_t> access_chain_expressions;
 		// Access chains used in multiple blocks mean hoisting all the variables used to construct the access chain as not all backends can use pointers.
 		// This is also relevant when forwarding opaque objects since we cannot lower these to temporaries.
 		std::unordered_map<uint32_t, std::unordered_set<uint32_t>> rvalue_forward_children;
 		const SPIRBlock *current_block = nullptr;
+		uint32_t current_block_index = 0;
+
+		// Maps block IDs relative to block_id_base to indices in entry.blocks.
+		uint32_t block_id_base = 0;
+		SmallVector<uint32_t> block_id_to_index;
 	};
 
 	struct StaticExpressionAccessHandler : OpcodeHandler
@@ -1063,6 +1632,8 @@ protected:
 	std::unordered_map<uint32_t, PhysicalBlockMeta> physical_storage_type_to_alignment;
 
 	void analyze_variable_scope(SPIRFunction &function, AnalyzeVariableScopeAccessHandler &handler);
+	void analyze_parameter_preservation(SPIRFunction &entry, const CFG &cfg,
+	                                    const AnalyzeVariableScopeAccessHandler &handler);
 	void find_function_local_luts(SPIRFunction &function, const AnalyzeVariableScopeAccessHandler &handler,
 	                              bool single_function);
 	bool may_read_undefined_variable_in_block(const SPIRBlock &block, uint32_t var);
@@ -1171,6 +1742,8 @@ private:
 	// Used only to implement the old deprecated get_entry_point() interface.
 	const SPIREntryPoint &get_first_entry_point(const std::string &name) const;
 	SPIREntryPoint &get_first_entry_point(const std::string &name);
+
+	void get_estimated_type_layout(const SPIRType &type, uint32_t &size, uint32_t &alignment) const;
 };
 } // namespace SPIRV_CROSS_NAMESPACE
 
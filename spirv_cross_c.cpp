@@ -45,10 +45,27 @@
 #include "gitversion.h"
 #endif
 
+#include "spirv_cross_serialized_ir.hpp"
 #include "spirv_parser.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <stdio.h>
 #include <string.h>
+#include <thread>
+
+#ifdef _WIN32
+#include <process.h>
+#define spvc_getpid _getpid
+#else
+#include <unistd.h>
+#define spvc_getpid getpid
+#endif
 
 // clang-format off
 
@@ -70,8 +87,18 @@
 		(context)->report_error(e.what());  \
 		return (error);                     \
 	}
+
+// For functions which compile, so that running out of the budget is told apart from unsupported SPIR-V.
+#define SPVC_END_COMPILE_SCOPE(context)    \
+	catch (const CompilerCancelledError &e) \
+	{                                       \
+		(context)->report_error(e.what());  \
+		return SPVC_ERROR_CANCELLED;        \
+	}                                       \
+	SPVC_END_SAFE_SCOPE(context, SPVC_ERROR_UNSUPPORTED_SPIRV)
 #else
 #define SPVC_END_SAFE_SCOPE(context, error)
+#define SPVC_END_COMPILE_SCOPE(context)
 #endif
 
 using namespace std;
@@ -109,6 +136,183 @@ static inline std::unique_ptr<T> spvc_allocate(Ts &&... ts)
 	return std::unique_ptr<T>(new T(std::forward<Ts>(ts)...));
 }
 
+// The threads jobs run on if the context has no job scheduler. Tasks are run in the order they were scheduled.
+struct WorkerPool
+{
+	explicit WorkerPool(unsigned count)
+	{
+		SPVC_BEGIN_SAFE_SCOPE
+		{
+			for (unsigned i = 0; i < count; i++)
+				threads.emplace_back([this] { run(); });
+		}
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+		catch (...)
+		{
+			stop();
+			throw;
+		}
+#endif
+	}
+
+	~WorkerPool()
+	{
+		stop();
+	}
+
+	void schedule(spvc_job_task task, void *task_data)
+	{
+		{
+			std::lock_guard<std::mutex> holder{ lock };
+			tasks.push_back({ task, task_data });
+		}
+		cond.notify_one();
+	}
+
+	void run()
+	{
+		for (;;)
+		{
+			std::pair<spvc_job_task, void *> task;
+			{
+				std::unique_lock<std::mutex> holder{ lock };
+				cond.wait(holder, [this] { return dying || !tasks.empty(); });
+				if (tasks.empty())
+					return;
+				task = tasks.front();
+				tasks.pop_front();
+			}
+			task.first(task.second);
+		}
+	}
+
+	// Lets the threads finish the tasks which were scheduled, and joins them.
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> holder{ lock };
+			dying = true;
+		}
+		cond.notify_all();
+		for (auto &thread : threads)
+			thread.join();
+		threads.clear();
+	}
+
+	std::mutex lock;
+	std::condition_variable cond;
+	std::deque<std::pair<spvc_job_task, void *>> tasks;
+	bool dying = false;
+	std::vector<std::thread> threads;
+};
+
+// Accumulates a key over everything which can affect the output of spvc_compiler_compile,
+// for the compilation cache. Two independent 64-bit hashes make accidental collisions negligible.
+struct spvc_cache_key
+{
+	uint64_t h0 = 0xcbf29ce484222325ull;
+	uint64_t h1 = 0x9e3779b97f4a7c15ull;
+
+	spvc_cache_key &add(const void *data, size_t size)
+	{
+		auto *bytes = static_cast<const uint8_t *>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			h0 = (h0 ^ bytes[i]) * 0x100000001b3ull;
+			h1 = (((h1 << 5) | (h1 >> 59)) ^ bytes[i]) * 0xff51afd7ed558ccdull;
+		}
+		return *this;
+	}
+
+	spvc_cache_key &add_string(const char *str)
+	{
+		// Include the terminator so consecutive strings cannot alias.
+		return str ? add(str, strlen(str) + 1) : add_value(uint8_t(0xff));
+	}
+
+	template <typename T>
+	spvc_cache_key &add_value(const T &value)
+	{
+		return add(&value, sizeof(value));
+	}
+
+	// Structs are hashed field by field, since padding bytes are not necessarily equal for equal structs.
+	spvc_cache_key &add_fields(const spvc_hlsl_root_constants &v)
+	{
+		return add_value(v.start).add_value(v.end).add_value(v.binding).add_value(v.space);
+	}
+
+	spvc_cache_key &add_fields(const spvc_hlsl_resource_binding &v)
+	{
+		add_value(v.stage).add_value(v.desc_set).add_value(v.binding);
+		for (auto &mapping : { v.cbv, v.uav, v.srv, v.sampler })
+			add_value(mapping.register_space).add_value(mapping.register_binding);
+		return *this;
+	}
+
+	spvc_cache_key &add_fields(const spvc_msl_vertex_attribute &v)
+	{
+		return add_value(v.location).add_value(v.format).add_value(v.builtin);
+	}
+
+	spvc_cache_key &add_fields(const spvc_msl_shader_interface_var &v)
+	{
+		return add_value(v.location).add_value(v.format).add_value(v.builtin).add_value(v.vecsize);
+	}
+
+	spvc_cache_key &add_fields(const spvc_msl_shader_interface_var_2 &v)
+	{
+		return add_value(v.location).add_value(v.format).add_value(v.builtin).add_value(v.vecsize).add_value(v.rate);
+	}
+
+	spvc_cache_key &add_fields(const spvc_msl_resource_binding &v)
+	{
+		return add_value(v.stage).add_value(v.desc_set).add_value(v.binding).add_value(v.msl_buffer)
+		    .add_value(v.msl_texture).add_value(v.msl_sampler);
+	}
+
+	spvc_cache_key &add_fields(const spvc_msl_constexpr_sampler &v)
+	{
+		return add_value(v.coord).add_value(v.min_filter).add_value(v.mag_filter).add_value(v.mip_filter)
+		    .add_value(v.s_address).add_value(v.t_address).add_value(v.r_address).add_value(v.compare_func)
+		    .add_value(v.border_color).add_value(v.lod_clamp_min).add_value(v.lod_clamp_max)
+		    .add_value(v.max_anisotropy).add_value(v.compare_enable).add_value(v.lod_clamp_enable)
+		    .add_value(v.anisotropy_enable);
+	}
+
+	spvc_cache_key &add_fields(const spvc_msl_sampler_ycbcr_conversion &v)
+	{
+		add_value(v.planes).add_value(v.resolution).add_value(v.chroma_filter).add_value(v.x_chroma_offset)
+		    .add_value(v.y_chroma_offset);
+		for (auto &swizzle : v.swizzle)
+			add_value(swizzle);
+		return add_value(v.ycbcr_model).add_value(v.ycbcr_range).add_value(v.bpc);
+	}
+
+	template <typename T>
+	spvc_cache_key &add_pointee(const T *value)
+	{
+		return value ? add_fields(*value) : add_value(uint8_t(0xff));
+	}
+
+	template <typename T>
+	spvc_cache_key &add_array(const T *values, size_t count)
+	{
+		add_value(count);
+		for (size_t i = 0; i < count; i++)
+			add_fields(values[i]);
+		return *this;
+	}
+
+	std::string to_string() const
+	{
+		char hex[33];
+		snprintf(hex, sizeof(hex), "%016llx%016llx", static_cast<unsigned long long>(h0),
+		         static_cast<unsigned long long>(h1));
+		return hex;
+	}
+};
+
 struct spvc_context_s
 {
 	string last_error;
@@ -118,8 +322,39 @@ struct spvc_context_s
 	spvc_error_callback callback = nullptr;
 	void *callback_userdata = nullptr;
 	void report_error(std::string msg);
+
+	// Parsed IR and compilers hold their own references to the arena, so it stays alive as long as they do.
+	std::shared_ptr<MemoryArena> arena;
+	bool arena_enabled = false;
+	spvc_allocate_callback arena_allocate_cb = nullptr;
+	spvc_free_callback arena_free_cb = nullptr;
+	void *arena_userdata = nullptr;
+
+	// If not empty, compilers created from this context look up and store their output here.
+	std::string cache_directory;
+
+	// For spvc_compiler_compile_async. The lock protects the number of running jobs and whether jobs are complete.
+	spvc_job_scheduler job_scheduler = nullptr;
+	void *job_scheduler_userdata = nullptr;
+	std::mutex job_lock;
+	std::condition_variable job_cond;
+	size_t running_jobs = 0;
+	void wait_for_jobs();
+	// Started by the first job if there is no job scheduler. Declared last, so that it is destroyed first.
+	std::unique_ptr<WorkerPool> worker_pool;
+
+	~spvc_context_s()
+	{
+		wait_for_jobs();
+	}
 };
 
+void spvc_context_s::wait_for_jobs()
+{
+	std::unique_lock<std::mutex> holder{ job_lock };
+	job_cond.wait(holder, [this] { return running_jobs == 0; });
+}
+
 void spvc_context_s::report_error(std::string msg)
 {
 	last_error = std::move(msg);
@@ -145,17 +380,197 @@ struct spvc_parsed_ir_s : ScratchMemoryAllocation
 	ParsedIR parsed;
 };
 
+struct spvc_compiler_s;
+static spvc_result spvc_compiler_resolve_cached_compile(spvc_compiler compiler);
+
+// Owns the compiler. A compile served from the cache leaves the compiler as it was before compiling,
+// so any access through the handle compiles for real first, and nothing answers from stale state.
+class spvc_compiler_handle
+{
+public:
+	explicit spvc_compiler_handle(spvc_compiler owner_)
+	    : owner(owner_)
+	{
+	}
+
+	Compiler *get()
+	{
+		if (needs_compile)
+		{
+			needs_compile = false;
+			spvc_compiler_resolve_cached_compile(owner);
+		}
+		return compiler.get();
+	}
+
+	Compiler *operator->()
+	{
+		return get();
+	}
+
+	Compiler &operator*()
+	{
+		return *get();
+	}
+
+	void reset(Compiler *new_compiler)
+	{
+		compiler.reset(new_compiler);
+		needs_compile = false;
+	}
+
+	// The source was read from the cache instead.
+	void defer_compile()
+	{
+		needs_compile = true;
+	}
+
+	// For paths which compile or reset the compiler themselves, and replace a deferred compile.
+	Compiler &skip_deferred_compile()
+	{
+		needs_compile = false;
+		return *compiler;
+	}
+
+	// Reads the state the next compile starts from, without compiling.
+	const Compiler &peek() const
+	{
+		return *compiler;
+	}
+
+private:
+	spvc_compiler owner;
+	unique_ptr<Compiler> compiler;
+	bool needs_compile = false;
+};
+
 struct spvc_compiler_s : ScratchMemoryAllocation
 {
 	spvc_context context = nullptr;
-	unique_ptr<Compiler> compiler;
+	spvc_compiler_handle compiler{ this };
 	spvc_backend backend = SPVC_BACKEND_NONE;
+
+	// The cache key is derived from this and the current state by spvc_compiler_get_cache_path.
+	// Holds the SPIRV-Cross revision and the backend.
+	spvc_cache_key base_key;
+	// Options set through spvc_compiler_options, which the option structs of the compiler were made from.
+	// The structs themselves cannot be hashed, as their padding bytes are not necessarily equal for equal options.
+	std::map<spvc_compiler_option, unsigned> option_values;
+	// Remapping state of the backend which lives outside the IR and cannot be read back from the compiler,
+	// e.g. resource bindings. Setters of such state add their arguments here.
+	spvc_cache_key remap_key;
+	// Only set if the cache was enabled when the compiler was created. Cleared once the compiler compiles for real,
+	// since it then holds state derived by the compile which the key does not capture.
+	bool cacheable = false;
+	// Checked by the compiler as part of its budget, see spvc_compiler_set_cancelled.
+	std::atomic<bool> cancelled{ false };
+	// Set from spvc_compiler_compile_async until the job is complete.
+	std::atomic<bool> compiling{ false };
+};
+
+struct spvc_job_s : ScratchMemoryAllocation
+{
+	spvc_context context = nullptr;
+	spvc_compiler compiler = nullptr;
+	spvc_job_callback callback = nullptr;
+	void *userdata = nullptr;
+	// Resolved when the job is created, as the cache directory of the context may change while it runs.
+	std::string cache_path;
+
+	// Written by the thread of the job before finished is set.
+	spvc_result result = SPVC_SUCCESS;
+	std::string source;
+	std::string error;
+	void report_error(std::string msg)
+	{
+		error = std::move(msg);
+	}
+
+	// Set once the job has compiled, before the callback.
+	std::atomic<bool> finished{ false };
+	// Set once the callback has returned, under the job lock of the context.
+	bool complete = false;
 };
 
+// Called by spvc_compiler_handle. Failures are reported to the context, as the access which triggered the compile
+// may not return an error. The compile succeeded when the cache entry was written, so only cancellation
+// or the budget can fail it.
+static spvc_result spvc_compiler_resolve_cached_compile(spvc_compiler compiler)
+{
+	compiler->cacheable = false;
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		compiler->compiler.skip_deferred_compile().compile();
+	}
+	SPVC_END_COMPILE_SCOPE(compiler->context)
+	return SPVC_SUCCESS;
+}
+
+// Derives the key from everything which affects the output: the IR, which holds the names, decorations,
+// entry points, execution modes and constants set through the API, the options, and the remapping state.
+// Only reads the state, so that compiling again after a hit without changes hits again.
+static bool spvc_compiler_get_cache_key(spvc_compiler compiler, spvc_cache_key &key)
+{
+	if (!compiler->cacheable)
+		return false;
+
+	key = compiler->base_key;
+	auto ir = serialize_parsed_ir(compiler->compiler.peek().get_ir());
+	key.add_value(ir.size()).add(ir.data(), ir.size());
+	key.add_value(compiler->option_values.size());
+	for (auto &option : compiler->option_values)
+		key.add_value(option.first).add_value(option.second);
+	key.add_value(compiler->remap_key.h0).add_value(compiler->remap_key.h1);
+	return true;
+}
+
+static bool read_cache_file(const std::string &path, std::string &data)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	rewind(file);
+
+	bool ok = len > 0;
+	if (ok)
+	{
+		data.resize(size_t(len));
+		ok = fread(&data[0], 1, data.size(), file) == data.size();
+	}
+
+	fclose(file);
+	return ok;
+}
+
+static void write_cache_file(const std::string &path, const std::string &data)
+{
+	// Write to a temporary first, so concurrent readers never observe a partially written entry.
+	// The name has to be unique among all processes and threads which share the cache directory.
+	static std::atomic<uint32_t> temp_counter;
+	char suffix[48];
+	snprintf(suffix, sizeof(suffix), ".%ld.%u.tmp", static_cast<long>(spvc_getpid()),
+	         static_cast<unsigned>(temp_counter.fetch_add(1, std::memory_order_relaxed)));
+	std::string tmp_path = path + suffix;
+
+	FILE *file = fopen(tmp_path.c_str(), "wb");
+	if (!file)
+		return;
+
+	bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+	ok = fclose(file) == 0 && ok;
+	if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0)
+		remove(tmp_path.c_str());
+}
+
 struct spvc_compiler_options_s : ScratchMemoryAllocation
 {
 	spvc_context context = nullptr;
 	uint32_t backend_flags = 0;
+	// The option values of the compiler the defaults were read from, updated by every option set.
+	std::map<spvc_compiler_option, unsigned> option_values;
 #if SPIRV_CROSS_C_API_GLSL
 	CompilerGLSL::Options glsl;
 #endif
@@ -167,6 +582,41 @@ struct spvc_compiler_options_s : ScratchMemoryAllocation
 #endif
 };
 
+#if SPIRV_CROSS_C_API_GLSL && (SPIRV_CROSS_C_API_HLSL || SPIRV_CROSS_C_API_MSL)
+// HLSL and MSL carry their own copy of the common GLSL options, so translate member-wise.
+template <typename Dst, typename Src>
+static Dst convert_common_options(const Src &src)
+{
+	Dst dst;
+	dst.version = src.version;
+	dst.es = src.es;
+	dst.force_temporary = src.force_temporary;
+	dst.force_recompile_max_debug_iterations = src.force_recompile_max_debug_iterations;
+	dst.vulkan_semantics = src.vulkan_semantics;
+	dst.separate_shader_objects = src.separate_shader_objects;
+	dst.flatten_multidimensional_arrays = src.flatten_multidimensional_arrays;
+	dst.enable_420pack_extension = src.enable_420pack_extension;
+	dst.emit_push_constant_as_uniform_buffer = src.emit_push_constant_as_uniform_buffer;
+	dst.emit_uniform_buffer_as_plain_uniforms = src.emit_uniform_buffer_as_plain_uniforms;
+	dst.emit_line_directives = src.emit_line_directives;
+	dst.enable_storage_image_qualifier_deduction = src.enable_storage_image_qualifier_deduction;
+	dst.force_zero_initialized_variables = src.force_zero_initialized_variables;
+	dst.force_flattened_io_blocks = src.force_flattened_io_blocks;
+	dst.relax_nan_checks = src.relax_nan_checks;
+	dst.common_subexpression_min_cost = src.common_subexpression_min_cost;
+	dst.enable_row_major_load_workaround = src.enable_row_major_load_workaround;
+	dst.ovr_multiview_view_count = src.ovr_multiview_view_count;
+	dst.vertex.fixup_clipspace = src.vertex.fixup_clipspace;
+	dst.vertex.flip_vert_y = src.vertex.flip_vert_y;
+	dst.vertex.support_nonzero_base_instance = src.vertex.support_nonzero_base_instance;
+	dst.fragment.default_float_precision =
+	    static_cast<decltype(dst.fragment.default_float_precision)>(src.fragment.default_float_precision);
+	dst.fragment.default_int_precision =
+	    static_cast<decltype(dst.fragment.default_int_precision)>(src.fragment.default_int_precision);
+	return dst;
+}
+#endif
+
 struct spvc_set_s : ScratchMemoryAllocation
 {
 	std::unordered_set<VariableID> set;
@@ -201,6 +651,12 @@ struct spvc_resources_s : ScratchMemoryAllocation
 	SmallVector<spvc_reflected_builtin_resource> builtin_inputs;
 	SmallVector<spvc_reflected_builtin_resource> builtin_outputs;
 
+	// All resource names, back to back, so reflection does not need one allocation per resource.
+	// Sized up front, since the lists point into it.
+	std::unique_ptr<char[]> names;
+	size_t names_offset = 0;
+	const char *copy_name(const std::string &name);
+
 	bool copy_resources(SmallVector<spvc_reflected_resource> &outputs, const SmallVector<Resource> &inputs);
 	bool copy_resources(SmallVector<spvc_reflected_builtin_resource> &outputs, const SmallVector<BuiltInResource> &inputs);
 	bool copy_resources(const ShaderResources &resources);
@@ -223,7 +679,56 @@ void spvc_context_destroy(spvc_context context)
 
 void spvc_context_release_allocations(spvc_context context)
 {
+	context->wait_for_jobs();
 	context->allocations.clear();
+
+	// Nothing refers to the arena anymore, so this frees all of its chunks.
+	// A fresh arena is created on the next parse.
+	context->arena.reset();
+}
+
+size_t spvc_context_get_allocation_count(spvc_context context)
+{
+	return context->allocations.size();
+}
+
+void spvc_context_set_compilation_cache(spvc_context context, const char *directory)
+{
+	context->cache_directory = directory ? directory : "";
+}
+
+spvc_result spvc_context_set_job_scheduler(spvc_context context, spvc_job_scheduler scheduler, void *userdata)
+{
+	std::lock_guard<std::mutex> holder{ context->job_lock };
+	if (context->running_jobs != 0)
+	{
+		context->report_error("Cannot change the job scheduler while jobs are running.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	context->job_scheduler = scheduler;
+	context->job_scheduler_userdata = userdata;
+	// The threads are idle, and a new pool is started if the default is restored.
+	// Workers never take the lock once they have finished their last job, so joining them here is safe.
+	if (scheduler)
+		context->worker_pool.reset();
+	return SPVC_SUCCESS;
+}
+
+spvc_result spvc_context_enable_memory_arena(spvc_context context, spvc_allocate_callback allocate_cb,
+                                             spvc_free_callback free_cb, void *userdata)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		// IR parsed earlier keeps the arena it was created with.
+		context->arena = std::make_shared<MemoryArena>(allocate_cb, free_cb, userdata);
+		context->arena_enabled = true;
+		context->arena_allocate_cb = allocate_cb;
+		context->arena_free_cb = free_cb;
+		context->arena_userdata = userdata;
+	}
+	SPVC_END_SAFE_SCOPE(context, SPVC_ERROR_OUT_OF_MEMORY)
+	return SPVC_SUCCESS;
 }
 
 const char *spvc_context_get_last_error_string(spvc_context context)
@@ -237,9 +742,58 @@ SPVC_PUBLIC_API void spvc_context_set_error_callback(spvc_context context, spvc_
 	context->callback_userdata = userdata;
 }
 
+static spvc_result spvc_context_parse_spirv_internal(spvc_context context, const SpvId *spirv, size_t word_count,
+                                                     bool borrow, spvc_parsed_ir *parsed_ir)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		std::unique_ptr<spvc_parsed_ir_s> pir(new (std::nothrow) spvc_parsed_ir_s);
+		if (!pir)
+		{
+			context->report_error("Out of memory.");
+			return SPVC_ERROR_OUT_OF_MEMORY;
+		}
+
+		pir->context = context;
+		Parser parser(spirv, word_count, borrow);
+		if (context->arena_enabled)
+		{
+			if (!context->arena)
+				context->arena = std::make_shared<MemoryArena>(context->arena_allocate_cb, context->arena_free_cb,
+				                                               context->arena_userdata);
+			parser.get_parsed_ir().set_memory_arena(context->arena);
+		}
+		parser.parse();
+		pir->parsed = std::move(parser.get_parsed_ir());
+		*parsed_ir = pir.get();
+		context->allocations.push_back(std::move(pir));
+	}
+	SPVC_END_SAFE_SCOPE(context, SPVC_ERROR_INVALID_SPIRV)
+	return SPVC_SUCCESS;
+}
+
 spvc_result spvc_context_parse_spirv(spvc_context context, const SpvId *spirv, size_t word_count,
                                      spvc_parsed_ir *parsed_ir)
 {
+	return spvc_context_parse_spirv_internal(context, spirv, word_count, false, parsed_ir);
+}
+
+spvc_result spvc_context_parse_spirv_borrowed(spvc_context context, const SpvId *spirv, size_t word_count,
+                                              spvc_parsed_ir *parsed_ir)
+{
+	return spvc_context_parse_spirv_internal(context, spirv, word_count, true, parsed_ir);
+}
+
+spvc_result spvc_context_parse_spirv_incremental(spvc_context context, const SpvId *spirv, size_t word_count,
+                                                 spvc_parsed_ir previous, spvc_parsed_ir *parsed_ir)
+{
+	// Another compiler may have taken ownership of the IR.
+	if (previous->parsed.ids.empty())
+	{
+		context->report_error("Previous parsed IR is no longer available.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
 	SPVC_BEGIN_SAFE_SCOPE
 	{
 		std::unique_ptr<spvc_parsed_ir_s> pir(new (std::nothrow) spvc_parsed_ir_s);
@@ -251,7 +805,14 @@ spvc_result spvc_context_parse_spirv(spvc_context context, const SpvId *spirv, s
 
 		pir->context = context;
 		Parser parser(spirv, word_count);
-		parser.parse();
+		if (context->arena_enabled)
+		{
+			if (!context->arena)
+				context->arena = std::make_shared<MemoryArena>(context->arena_allocate_cb, context->arena_free_cb,
+				                                               context->arena_userdata);
+			parser.get_parsed_ir().set_memory_arena(context->arena);
+		}
+		parser.parse_incremental(previous->parsed);
 		pir->parsed = std::move(parser.get_parsed_ir());
 		*parsed_ir = pir.get();
 		context->allocations.push_back(std::move(pir));
@@ -260,6 +821,49 @@ spvc_result spvc_context_parse_spirv(spvc_context context, const SpvId *spirv, s
 	return SPVC_SUCCESS;
 }
 
+spvc_result spvc_context_parse_serialized_ir(spvc_context context, const void *data, size_t size, spvc_bool borrow,
+                                             spvc_parsed_ir *parsed_ir)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		std::unique_ptr<spvc_parsed_ir_s> pir(new (std::nothrow) spvc_parsed_ir_s);
+		if (!pir)
+		{
+			context->report_error("Out of memory.");
+			return SPVC_ERROR_OUT_OF_MEMORY;
+		}
+
+		pir->context = context;
+		if (context->arena_enabled)
+		{
+			if (!context->arena)
+				context->arena = std::make_shared<MemoryArena>(context->arena_allocate_cb, context->arena_free_cb,
+				                                               context->arena_userdata);
+			pir->parsed.set_memory_arena(context->arena);
+		}
+		deserialize_parsed_ir(pir->parsed, data, size, borrow != SPVC_FALSE);
+		*parsed_ir = pir.get();
+		context->allocations.push_back(std::move(pir));
+	}
+	SPVC_END_SAFE_SCOPE(context, SPVC_ERROR_INVALID_ARGUMENT)
+	return SPVC_SUCCESS;
+}
+
+spvc_result spvc_parsed_ir_serialize(spvc_parsed_ir parsed_ir, const unsigned char **data, size_t *size)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		auto blob = serialize_parsed_ir(parsed_ir->parsed);
+		auto ptr = spvc_allocate<TemporaryBuffer<unsigned char>>();
+		ptr->buffer.insert(ptr->buffer.end(), blob.data(), blob.data() + blob.size());
+		*data = ptr->buffer.data();
+		*size = ptr->buffer.size();
+		parsed_ir->context->allocations.push_back(std::move(ptr));
+	}
+	SPVC_END_SAFE_SCOPE(parsed_ir->context, SPVC_ERROR_INVALID_ARGUMENT)
+	return SPVC_SUCCESS;
+}
+
 spvc_result spvc_context_create_compiler(spvc_context context, spvc_backend backend, spvc_parsed_ir parsed_ir,
                                          spvc_capture_mode mode, spvc_compiler *compiler)
 {
@@ -280,6 +884,18 @@ spvc_result spvc_context_create_compiler(spvc_context context, spvc_backend back
 			return SPVC_ERROR_INVALID_ARGUMENT;
 		}
 
+		if (!context->cache_directory.empty())
+		{
+			unsigned major, minor, patch;
+			spvc_get_version(&major, &minor, &patch);
+			comp->base_key.add_string(spvc_get_commit_revision_and_timestamp())
+			    .add_value(major)
+			    .add_value(minor)
+			    .add_value(patch)
+			    .add_value(backend);
+			comp->cacheable = true;
+		}
+
 		switch (backend)
 		{
 		case SPVC_BACKEND_NONE:
@@ -339,6 +955,11 @@ spvc_result spvc_context_create_compiler(spvc_context context, spvc_backend back
 			return SPVC_ERROR_INVALID_ARGUMENT;
 		}
 
+
+		CompileBudget budget;
+		budget.cancel = &comp->cancelled;
+		comp->compiler->set_compile_budget(budget);
+
 		*compiler = comp.get();
 		context->allocations.push_back(std::move(comp));
 	}
@@ -359,12 +980,14 @@ spvc_result spvc_compiler_create_compiler_options(spvc_compiler compiler, spvc_c
 
 		opt->context = compiler->context;
 		opt->backend_flags = 0;
+		opt->option_values = compiler->option_values;
 		switch (compiler->backend)
 		{
 #if SPIRV_CROSS_C_API_MSL
 		case SPVC_BACKEND_MSL:
 			opt->backend_flags |= SPVC_COMPILER_OPTION_MSL_BIT | SPVC_COMPILER_OPTION_COMMON_BIT;
-			opt->glsl = static_cast<CompilerMSL *>(compiler->compiler.get())->get_common_options();
+			opt->glsl = convert_common_options<CompilerGLSL::Options>(
+			    static_cast<CompilerMSL *>(compiler->compiler.get())->get_common_options());
 			opt->msl = static_cast<CompilerMSL *>(compiler->compiler.get())->get_msl_options();
 			break;
 #endif
@@ -372,7 +995,8 @@ spvc_result spvc_compiler_create_compiler_options(spvc_compiler compiler, spvc_c
 #if SPIRV_CROSS_C_API_HLSL
 		case SPVC_BACKEND_HLSL:
 			opt->backend_flags |= SPVC_COMPILER_OPTION_HLSL_BIT | SPVC_COMPILER_OPTION_COMMON_BIT;
-			opt->glsl = static_cast<CompilerHLSL *>(compiler->compiler.get())->get_common_options();
+			opt->glsl = convert_common_options<CompilerGLSL::Options>(
+			    static_cast<CompilerHLSL *>(compiler->compiler.get())->get_common_options());
 			opt->hlsl = static_cast<CompilerHLSL *>(compiler->compiler.get())->get_hlsl_options();
 			break;
 #endif
@@ -479,13 +1103,34 @@ spvc_result spvc_compiler_options_set_uint(spvc_compiler_options options, spvc_c
 	case SPVC_COMPILER_OPTION_RELAX_NAN_CHECKS:
 		options->glsl.relax_nan_checks = value != 0;
 		break;
+	case SPVC_COMPILER_OPTION_COMMON_SUBEXPRESSION_MIN_COST:
+		options->glsl.common_subexpression_min_cost = value;
+		break;
 	case SPVC_COMPILER_OPTION_GLSL_ENABLE_ROW_MAJOR_LOAD_WORKAROUND:
 		options->glsl.enable_row_major_load_workaround = value != 0;
 		break;
-#endif
-
-#if SPIRV_CROSS_C_API_HLSL
-	case SPVC_COMPILER_OPTION_HLSL_SHADER_MODEL:
+	case SPVC_COMPILER_OPTION_GLSL_MINIFY:
+		options->glsl.minify = value != 0;
+		break;
+	case SPVC_COMPILER_OPTION_GLSL_DESCRIPTOR_HEAP_INDEXING:
+		options->glsl.descriptor_heap_indexing = value != 0;
+		break;
+	case SPVC_COMPILER_OPTION_GLSL_DESCRIPTOR_HEAP_SET:
+		options->glsl.descriptor_heap_set = value;
+		break;
+	case SPVC_COMPILER_OPTION_GLSL_LUT_BUFFER_MIN_SIZE:
+		options->glsl.lut_buffer_min_size = value;
+		break;
+	case SPVC_COMPILER_OPTION_GLSL_LUT_BUFFER_SET:
+		options->glsl.lut_buffer_set = value;
+		break;
+	case SPVC_COMPILER_OPTION_GLSL_LUT_BUFFER_BINDING:
+		options->glsl.lut_buffer_binding = value;
+		break;
+#endif
+
+#if SPIRV_CROSS_C_API_HLSL
+	case SPVC_COMPILER_OPTION_HLSL_SHADER_MODEL:
 		options->hlsl.shader_model = value;
 		break;
 
@@ -516,6 +1161,38 @@ spvc_result spvc_compiler_options_set_uint(spvc_compiler_options options, spvc_c
 	case SPVC_COMPILER_OPTION_HLSL_FLATTEN_MATRIX_VERTEX_INPUT_SEMANTICS:
 		options->hlsl.flatten_matrix_vertex_input_semantics = value != 0;
 		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_RELAXED_PRECISION_AS_16BIT:
+		options->hlsl.relaxed_precision_as_16bit = value != 0;
+		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_ROOT_CONSTANT_PROMOTION_DWORD_BUDGET:
+		options->hlsl.root_constant_promotion_dword_budget = value;
+		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_DESCRIPTOR_HEAP_INDEXING:
+		options->hlsl.descriptor_heap_indexing = value != 0;
+		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_DESCRIPTOR_HEAP_INDEX_REGISTER:
+		options->hlsl.descriptor_heap_index_register = value;
+		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_DESCRIPTOR_HEAP_INDEX_SPACE:
+		options->hlsl.descriptor_heap_index_space = value;
+		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_LUT_BUFFER_MIN_SIZE:
+		options->hlsl.lut_buffer_min_size = value;
+		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_LUT_BUFFER_REGISTER:
+		options->hlsl.lut_buffer_register = value;
+		break;
+
+	case SPVC_COMPILER_OPTION_HLSL_LUT_BUFFER_SPACE:
+		options->hlsl.lut_buffer_space = value;
+		break;
 #endif
 
 #if SPIRV_CROSS_C_API_MSL
@@ -679,6 +1356,14 @@ spvc_result spvc_compiler_options_set_uint(spvc_compiler_options options, spvc_c
 		options->msl.vertex_for_tessellation = value != 0;
 		break;
 
+	case SPVC_COMPILER_OPTION_MSL_PACK_TESSELLATION_BUFFERS:
+		options->msl.pack_tessellation_buffers = value != 0;
+		break;
+
+	case SPVC_COMPILER_OPTION_MSL_PACK_TESSELLATION_BUFFERS_RELAXED_PRECISION_AS_HALF:
+		options->msl.pack_tessellation_buffers_relaxed_precision_as_half = value != 0;
+		break;
+
 	case SPVC_COMPILER_OPTION_MSL_VERTEX_INDEX_TYPE:
 		options->msl.vertex_index_type = static_cast<CompilerMSL::Options::IndexType>(value);
 		break;
@@ -742,6 +1427,14 @@ spvc_result spvc_compiler_options_set_uint(spvc_compiler_options options, spvc_c
 	case SPVC_COMPILER_OPTION_MSL_SAMPLE_DREF_LOD_ARRAY_AS_GRAD:
 		options->msl.sample_dref_lod_array_as_grad = value != 0;
 		break;
+
+	case SPVC_COMPILER_OPTION_MSL_RELAXED_PRECISION_AS_16BIT:
+		options->msl.relaxed_precision_as_16bit = value != 0;
+		break;
+
+	case SPVC_COMPILER_OPTION_MSL_ARGUMENT_BUFFERS_STABLE_LAYOUT:
+		options->msl.argument_buffers_stable_layout = value != 0;
+		break;
 #endif
 
 	default:
@@ -749,12 +1442,14 @@ spvc_result spvc_compiler_options_set_uint(spvc_compiler_options options, spvc_c
 		return SPVC_ERROR_INVALID_ARGUMENT;
 	}
 
+	options->option_values[option] = value;
 	return SPVC_SUCCESS;
 }
 
 spvc_result spvc_compiler_install_compiler_options(spvc_compiler compiler, spvc_compiler_options options)
 {
 	(void)options;
+	compiler->option_values = options->option_values;
 	switch (compiler->backend)
 	{
 #if SPIRV_CROSS_C_API_GLSL
@@ -765,14 +1460,16 @@ spvc_result spvc_compiler_install_compiler_options(spvc_compiler compiler, spvc_
 
 #if SPIRV_CROSS_C_API_HLSL
 	case SPVC_BACKEND_HLSL:
-		static_cast<CompilerHLSL &>(*compiler->compiler).set_common_options(options->glsl);
+		static_cast<CompilerHLSL &>(*compiler->compiler)
+		    .set_common_options(convert_common_options<CompilerHLSL::OptionsGLSL>(options->glsl));
 		static_cast<CompilerHLSL &>(*compiler->compiler).set_hlsl_options(options->hlsl);
 		break;
 #endif
 
 #if SPIRV_CROSS_C_API_MSL
 	case SPVC_BACKEND_MSL:
-		static_cast<CompilerMSL &>(*compiler->compiler).set_common_options(options->glsl);
+		static_cast<CompilerMSL &>(*compiler->compiler)
+		    .set_common_options(convert_common_options<CompilerMSL::GLSLOptions>(options->glsl));
 		static_cast<CompilerMSL &>(*compiler->compiler).set_msl_options(options->msl);
 		break;
 #endif
@@ -786,6 +1483,7 @@ spvc_result spvc_compiler_install_compiler_options(spvc_compiler compiler, spvc_
 
 spvc_result spvc_compiler_add_header_line(spvc_compiler compiler, const char *line)
 {
+	compiler->remap_key.add_string(__func__).add_string(line);
 #if SPIRV_CROSS_C_API_GLSL
 	if (compiler->backend == SPVC_BACKEND_NONE)
 	{
@@ -804,6 +1502,7 @@ spvc_result spvc_compiler_add_header_line(spvc_compiler compiler, const char *li
 
 spvc_result spvc_compiler_require_extension(spvc_compiler compiler, const char *line)
 {
+	compiler->remap_key.add_string(__func__).add_string(line);
 #if SPIRV_CROSS_C_API_GLSL
 	if (compiler->backend == SPVC_BACKEND_NONE)
 	{
@@ -859,6 +1558,7 @@ const char *spvc_compiler_get_required_extension(spvc_compiler compiler, size_t
 
 spvc_result spvc_compiler_flatten_buffer_block(spvc_compiler compiler, spvc_variable_id id)
 {
+	compiler->remap_key.add_string(__func__).add_value(id);
 #if SPIRV_CROSS_C_API_GLSL
 	if (compiler->backend == SPVC_BACKEND_NONE)
 	{
@@ -895,39 +1595,67 @@ spvc_bool spvc_compiler_variable_is_depth_or_compare(spvc_compiler compiler, spv
 spvc_result spvc_compiler_mask_stage_output_by_location(spvc_compiler compiler,
                                                         unsigned location, unsigned component)
 {
-#if SPIRV_CROSS_C_API_GLSL
+	compiler->remap_key.add_string(__func__).add_value(location).add_value(component);
 	if (compiler->backend == SPVC_BACKEND_NONE)
 	{
 		compiler->context->report_error("Cross-compilation related option used on NONE backend which only supports reflection.");
 		return SPVC_ERROR_INVALID_ARGUMENT;
 	}
 
-	static_cast<CompilerGLSL *>(compiler->compiler.get())->mask_stage_output_by_location(location, component);
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		compiler->compiler->mask_stage_output_by_location(location, component);
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_INVALID_ARGUMENT)
 	return SPVC_SUCCESS;
-#else
-	(void)location;
-	(void)component;
-	compiler->context->report_error("Cross-compilation related option used on NONE backend which only supports reflection.");
-	return SPVC_ERROR_INVALID_ARGUMENT;
-#endif
 }
 
 spvc_result spvc_compiler_mask_stage_output_by_builtin(spvc_compiler compiler, SpvBuiltIn builtin)
 {
-#if SPIRV_CROSS_C_API_GLSL
+	compiler->remap_key.add_string(__func__).add_value(builtin);
 	if (compiler->backend == SPVC_BACKEND_NONE)
 	{
 		compiler->context->report_error("Cross-compilation related option used on NONE backend which only supports reflection.");
 		return SPVC_ERROR_INVALID_ARGUMENT;
 	}
 
-	static_cast<CompilerGLSL *>(compiler->compiler.get())->mask_stage_output_by_builtin(spv::BuiltIn(builtin));
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		compiler->compiler->mask_stage_output_by_builtin(spv::BuiltIn(builtin));
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_INVALID_ARGUMENT)
+	return SPVC_SUCCESS;
+}
+
+spvc_result spvc_compiler_link_stage_outputs(spvc_compiler compiler, spvc_compiler downstream, spvc_bool pack_locations)
+{
+	if (compiler->backend == SPVC_BACKEND_NONE || downstream->backend == SPVC_BACKEND_NONE)
+	{
+		compiler->context->report_error("Cross-compilation related option used on NONE backend which only supports reflection.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		// The interface of either stage now depends on the other one, as it is before linking.
+		spvc_cache_key upstream_key, downstream_key;
+		if (spvc_compiler_get_cache_key(compiler, upstream_key) && spvc_compiler_get_cache_key(downstream, downstream_key))
+		{
+			compiler->remap_key.add_string(__func__).add_value(pack_locations);
+			compiler->remap_key.add_value(downstream_key.h0).add_value(downstream_key.h1);
+			downstream->remap_key.add_string(__func__).add_value(pack_locations);
+			downstream->remap_key.add_value(upstream_key.h0).add_value(upstream_key.h1);
+		}
+		else
+		{
+			compiler->cacheable = false;
+			downstream->cacheable = false;
+		}
+
+		compiler->compiler->link_stage_outputs(*downstream->compiler, pack_locations != SPVC_FALSE);
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_INVALID_ARGUMENT)
 	return SPVC_SUCCESS;
-#else
-	(void)builtin;
-	compiler->context->report_error("Cross-compilation related option used on NONE backend which only supports reflection.");
-	return SPVC_ERROR_INVALID_ARGUMENT;
-#endif
 }
 
 spvc_result spvc_compiler_hlsl_set_root_constants_layout(spvc_compiler compiler,
@@ -941,6 +1669,8 @@ spvc_result spvc_compiler_hlsl_set_root_constants_layout(spvc_compiler compiler,
 		return SPVC_ERROR_INVALID_ARGUMENT;
 	}
 
+	compiler->remap_key.add_string(__func__).add_array(constant_info, count);
+
 	auto &hlsl = *static_cast<CompilerHLSL *>(compiler->compiler.get());
 	vector<RootConstants> roots;
 	roots.reserve(count);
@@ -977,8 +1707,10 @@ spvc_result spvc_compiler_hlsl_add_vertex_attribute_remap(spvc_compiler compiler
 
 	HLSLVertexAttributeRemap re;
 	auto &hlsl = *static_cast<CompilerHLSL *>(compiler->compiler.get());
+	compiler->remap_key.add_string(__func__).add_value(count);
 	for (size_t i = 0; i < count; i++)
 	{
+		compiler->remap_key.add_value(remap[i].location).add_string(remap[i].semantic);
 		re.location = remap[i].location;
 		re.semantic = remap[i].semantic;
 		hlsl.add_vertex_attribute_remap(re);
@@ -995,6 +1727,7 @@ spvc_result spvc_compiler_hlsl_add_vertex_attribute_remap(spvc_compiler compiler
 
 spvc_variable_id spvc_compiler_hlsl_remap_num_workgroups_builtin(spvc_compiler compiler)
 {
+	compiler->remap_key.add_string(__func__);
 #if SPIRV_CROSS_C_API_HLSL
 	if (compiler->backend != SPVC_BACKEND_HLSL)
 	{
@@ -1013,6 +1746,7 @@ spvc_variable_id spvc_compiler_hlsl_remap_num_workgroups_builtin(spvc_compiler c
 spvc_result spvc_compiler_hlsl_set_resource_binding_flags(spvc_compiler compiler,
                                                           spvc_hlsl_binding_flags flags)
 {
+	compiler->remap_key.add_string(__func__).add_value(flags);
 #if SPIRV_CROSS_C_API_HLSL
 	if (compiler->backend != SPVC_BACKEND_HLSL)
 	{
@@ -1030,9 +1764,29 @@ spvc_result spvc_compiler_hlsl_set_resource_binding_flags(spvc_compiler compiler
 #endif
 }
 
+#if SPIRV_CROSS_C_API_HLSL
+static void add_hlsl_resource_binding(CompilerHLSL &hlsl, const spvc_hlsl_resource_binding &binding)
+{
+	HLSLResourceBinding bind;
+	bind.binding = binding.binding;
+	bind.desc_set = binding.desc_set;
+	bind.stage = static_cast<spv::ExecutionModel>(binding.stage);
+	bind.cbv.register_binding = binding.cbv.register_binding;
+	bind.cbv.register_space = binding.cbv.register_space;
+	bind.uav.register_binding = binding.uav.register_binding;
+	bind.uav.register_space = binding.uav.register_space;
+	bind.srv.register_binding = binding.srv.register_binding;
+	bind.srv.register_space = binding.srv.register_space;
+	bind.sampler.register_binding = binding.sampler.register_binding;
+	bind.sampler.register_space = binding.sampler.register_space;
+	hlsl.add_hlsl_resource_binding(bind);
+}
+#endif
+
 spvc_result spvc_compiler_hlsl_add_resource_binding(spvc_compiler compiler,
                                                     const spvc_hlsl_resource_binding *binding)
 {
+	compiler->remap_key.add_string(__func__).add_pointee(binding);
 #if SPIRV_CROSS_C_API_HLSL
 	if (compiler->backend != SPVC_BACKEND_HLSL)
 	{
@@ -1041,19 +1795,7 @@ spvc_result spvc_compiler_hlsl_add_resource_binding(spvc_compiler compiler,
 	}
 
 	auto &hlsl = *static_cast<CompilerHLSL *>(compiler->compiler.get());
-	HLSLResourceBinding bind;
-	bind.binding = binding->binding;
-	bind.desc_set = binding->desc_set;
-	bind.stage = static_cast<spv::ExecutionModel>(binding->stage);
-	bind.cbv.register_binding = binding->cbv.register_binding;
-	bind.cbv.register_space = binding->cbv.register_space;
-	bind.uav.register_binding = binding->uav.register_binding;
-	bind.uav.register_space = binding->uav.register_space;
-	bind.srv.register_binding = binding->srv.register_binding;
-	bind.srv.register_space = binding->srv.register_space;
-	bind.sampler.register_binding = binding->sampler.register_binding;
-	bind.sampler.register_space = binding->sampler.register_space;
-	hlsl.add_hlsl_resource_binding(bind);
+	add_hlsl_resource_binding(hlsl, *binding);
 	return SPVC_SUCCESS;
 #else
 	(void)binding;
@@ -1062,6 +1804,29 @@ spvc_result spvc_compiler_hlsl_add_resource_binding(spvc_compiler compiler,
 #endif
 }
 
+spvc_result spvc_compiler_hlsl_add_resource_bindings(spvc_compiler compiler,
+                                                     const spvc_hlsl_resource_binding *bindings, size_t count)
+{
+	compiler->remap_key.add_string(__func__).add_array(bindings, count);
+#if SPIRV_CROSS_C_API_HLSL
+	if (compiler->backend != SPVC_BACKEND_HLSL)
+	{
+		compiler->context->report_error("HLSL function used on a non-HLSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &hlsl = *static_cast<CompilerHLSL *>(compiler->compiler.get());
+	for (size_t i = 0; i < count; i++)
+		add_hlsl_resource_binding(hlsl, bindings[i]);
+	return SPVC_SUCCESS;
+#else
+	(void)bindings;
+	(void)count;
+	compiler->context->report_error("HLSL function used on a non-HLSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
 spvc_bool spvc_compiler_hlsl_is_resource_used(spvc_compiler compiler, SpvExecutionModel model, unsigned set,
                                               unsigned binding)
 {
@@ -1084,6 +1849,72 @@ spvc_bool spvc_compiler_hlsl_is_resource_used(spvc_compiler compiler, SpvExecuti
 #endif
 }
 
+spvc_result spvc_compiler_hlsl_get_promoted_root_constants(spvc_compiler compiler,
+                                                           const spvc_hlsl_promoted_root_constants **root_constants,
+                                                           size_t *num_root_constants)
+{
+#if SPIRV_CROSS_C_API_HLSL
+	if (compiler->backend != SPVC_BACKEND_HLSL)
+	{
+		compiler->context->report_error("HLSL function used on a non-HLSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		auto &hlsl = *static_cast<CompilerHLSL *>(compiler->compiler.get());
+		auto ptr = spvc_allocate<TemporaryBuffer<spvc_hlsl_promoted_root_constants>>();
+		for (auto &root : hlsl.get_promoted_root_constants())
+		{
+			spvc_hlsl_promoted_root_constants translated;
+			translated.id = root.id;
+			translated.desc_set = root.desc_set;
+			translated.binding = root.binding;
+			translated.register_space = root.register_space;
+			translated.register_binding = root.register_binding;
+			translated.num_dwords = root.num_dwords;
+			ptr->buffer.push_back(translated);
+		}
+
+		*root_constants = ptr->buffer.data();
+		*num_root_constants = ptr->buffer.size();
+		compiler->context->allocations.push_back(std::move(ptr));
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_OUT_OF_MEMORY)
+	return SPVC_SUCCESS;
+#else
+	(void)root_constants;
+	(void)num_root_constants;
+	compiler->context->report_error("HLSL function used on a non-HLSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+spvc_result spvc_compiler_hlsl_get_promoted_root_constants_root_signature(spvc_compiler compiler,
+                                                                          const char **signature)
+{
+#if SPIRV_CROSS_C_API_HLSL
+	if (compiler->backend != SPVC_BACKEND_HLSL)
+	{
+		compiler->context->report_error("HLSL function used on a non-HLSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &hlsl = *static_cast<CompilerHLSL *>(compiler->compiler.get());
+	*signature = compiler->context->allocate_name(hlsl.get_promoted_root_constants_root_signature());
+	if (!*signature)
+	{
+		compiler->context->report_error("Out of memory.");
+		return SPVC_ERROR_OUT_OF_MEMORY;
+	}
+	return SPVC_SUCCESS;
+#else
+	(void)signature;
+	compiler->context->report_error("HLSL function used on a non-HLSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
 spvc_bool spvc_compiler_msl_is_rasterization_disabled(spvc_compiler compiler)
 {
 #if SPIRV_CROSS_C_API_MSL
@@ -1191,8 +2022,22 @@ spvc_bool spvc_compiler_msl_needs_input_threadgroup_mem(spvc_compiler compiler)
 #endif
 }
 
+#if SPIRV_CROSS_C_API_MSL
+static MSLShaderInterfaceVariable translate_msl_shader_interface_var(const spvc_msl_shader_interface_var_2 &var)
+{
+	MSLShaderInterfaceVariable translated;
+	translated.location = var.location;
+	translated.format = static_cast<MSLShaderVariableFormat>(var.format);
+	translated.builtin = static_cast<spv::BuiltIn>(var.builtin);
+	translated.vecsize = var.vecsize;
+	translated.rate = static_cast<MSLShaderVariableRate>(var.rate);
+	return translated;
+}
+#endif
+
 spvc_result spvc_compiler_msl_add_vertex_attribute(spvc_compiler compiler, const spvc_msl_vertex_attribute *va)
 {
+	compiler->remap_key.add_string(__func__).add_pointee(va);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1216,6 +2061,7 @@ spvc_result spvc_compiler_msl_add_vertex_attribute(spvc_compiler compiler, const
 
 spvc_result spvc_compiler_msl_add_shader_input(spvc_compiler compiler, const spvc_msl_shader_interface_var *si)
 {
+	compiler->remap_key.add_string(__func__).add_pointee(si);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1240,6 +2086,7 @@ spvc_result spvc_compiler_msl_add_shader_input(spvc_compiler compiler, const spv
 
 spvc_result spvc_compiler_msl_add_shader_input_2(spvc_compiler compiler, const spvc_msl_shader_interface_var_2 *si)
 {
+	compiler->remap_key.add_string(__func__).add_pointee(si);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1248,13 +2095,7 @@ spvc_result spvc_compiler_msl_add_shader_input_2(spvc_compiler compiler, const s
 	}
 
 	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	MSLShaderInterfaceVariable input;
-	input.location = si->location;
-	input.format = static_cast<MSLShaderVariableFormat>(si->format);
-	input.builtin = static_cast<spv::BuiltIn>(si->builtin);
-	input.vecsize = si->vecsize;
-	input.rate = static_cast<MSLShaderVariableRate>(si->rate);
-	msl.add_msl_shader_input(input);
+	msl.add_msl_shader_input(translate_msl_shader_interface_var(*si));
 	return SPVC_SUCCESS;
 #else
 	(void)si;
@@ -1263,8 +2104,32 @@ spvc_result spvc_compiler_msl_add_shader_input_2(spvc_compiler compiler, const s
 #endif
 }
 
+spvc_result spvc_compiler_msl_add_shader_inputs_2(spvc_compiler compiler,
+                                                  const spvc_msl_shader_interface_var_2 *inputs, size_t count)
+{
+	compiler->remap_key.add_string(__func__).add_array(inputs, count);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	for (size_t i = 0; i < count; i++)
+		msl.add_msl_shader_input(translate_msl_shader_interface_var(inputs[i]));
+	return SPVC_SUCCESS;
+#else
+	(void)inputs;
+	(void)count;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
 spvc_result spvc_compiler_msl_add_shader_output(spvc_compiler compiler, const spvc_msl_shader_interface_var *so)
 {
+	compiler->remap_key.add_string(__func__).add_pointee(so);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1289,6 +2154,7 @@ spvc_result spvc_compiler_msl_add_shader_output(spvc_compiler compiler, const sp
 
 spvc_result spvc_compiler_msl_add_shader_output_2(spvc_compiler compiler, const spvc_msl_shader_interface_var_2 *so)
 {
+	compiler->remap_key.add_string(__func__).add_pointee(so);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1297,13 +2163,7 @@ spvc_result spvc_compiler_msl_add_shader_output_2(spvc_compiler compiler, const
 	}
 
 	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	MSLShaderInterfaceVariable output;
-	output.location = so->location;
-	output.format = static_cast<MSLShaderVariableFormat>(so->format);
-	output.builtin = static_cast<spv::BuiltIn>(so->builtin);
-	output.vecsize = so->vecsize;
-	output.rate = static_cast<MSLShaderVariableRate>(so->rate);
-	msl.add_msl_shader_output(output);
+	msl.add_msl_shader_output(translate_msl_shader_interface_var(*so));
 	return SPVC_SUCCESS;
 #else
 	(void)so;
@@ -1312,9 +2172,10 @@ spvc_result spvc_compiler_msl_add_shader_output_2(spvc_compiler compiler, const
 #endif
 }
 
-spvc_result spvc_compiler_msl_add_resource_binding(spvc_compiler compiler,
-                                                   const spvc_msl_resource_binding *binding)
+spvc_result spvc_compiler_msl_add_shader_outputs_2(spvc_compiler compiler,
+                                                   const spvc_msl_shader_interface_var_2 *outputs, size_t count)
 {
+	compiler->remap_key.add_string(__func__).add_array(outputs, count);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1323,14 +2184,44 @@ spvc_result spvc_compiler_msl_add_resource_binding(spvc_compiler compiler,
 	}
 
 	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	for (size_t i = 0; i < count; i++)
+		msl.add_msl_shader_output(translate_msl_shader_interface_var(outputs[i]));
+	return SPVC_SUCCESS;
+#else
+	(void)outputs;
+	(void)count;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+#if SPIRV_CROSS_C_API_MSL
+static void add_msl_resource_binding(CompilerMSL &msl, const spvc_msl_resource_binding &binding)
+{
 	MSLResourceBinding bind;
-	bind.binding = binding->binding;
-	bind.desc_set = binding->desc_set;
-	bind.stage = static_cast<spv::ExecutionModel>(binding->stage);
-	bind.msl_buffer = binding->msl_buffer;
-	bind.msl_texture = binding->msl_texture;
-	bind.msl_sampler = binding->msl_sampler;
+	bind.binding = binding.binding;
+	bind.desc_set = binding.desc_set;
+	bind.stage = static_cast<spv::ExecutionModel>(binding.stage);
+	bind.msl_buffer = binding.msl_buffer;
+	bind.msl_texture = binding.msl_texture;
+	bind.msl_sampler = binding.msl_sampler;
 	msl.add_msl_resource_binding(bind);
+}
+#endif
+
+spvc_result spvc_compiler_msl_add_resource_binding(spvc_compiler compiler,
+                                                   const spvc_msl_resource_binding *binding)
+{
+	compiler->remap_key.add_string(__func__).add_pointee(binding);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	add_msl_resource_binding(msl, *binding);
 	return SPVC_SUCCESS;
 #else
 	(void)binding;
@@ -1339,8 +2230,32 @@ spvc_result spvc_compiler_msl_add_resource_binding(spvc_compiler compiler,
 #endif
 }
 
+spvc_result spvc_compiler_msl_add_resource_bindings(spvc_compiler compiler,
+                                                    const spvc_msl_resource_binding *bindings, size_t count)
+{
+	compiler->remap_key.add_string(__func__).add_array(bindings, count);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	for (size_t i = 0; i < count; i++)
+		add_msl_resource_binding(msl, bindings[i]);
+	return SPVC_SUCCESS;
+#else
+	(void)bindings;
+	(void)count;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
 spvc_result spvc_compiler_msl_add_dynamic_buffer(spvc_compiler compiler, unsigned desc_set, unsigned binding, unsigned index)
 {
+	compiler->remap_key.add_string(__func__).add_value(desc_set).add_value(binding).add_value(index);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1362,6 +2277,7 @@ spvc_result spvc_compiler_msl_add_dynamic_buffer(spvc_compiler compiler, unsigne
 
 spvc_result spvc_compiler_msl_add_inline_uniform_block(spvc_compiler compiler, unsigned desc_set, unsigned binding)
 {
+	compiler->remap_key.add_string(__func__).add_value(desc_set).add_value(binding);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1382,6 +2298,7 @@ spvc_result spvc_compiler_msl_add_inline_uniform_block(spvc_compiler compiler, u
 
 spvc_result spvc_compiler_msl_add_discrete_descriptor_set(spvc_compiler compiler, unsigned desc_set)
 {
+	compiler->remap_key.add_string(__func__).add_value(desc_set);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1401,6 +2318,7 @@ spvc_result spvc_compiler_msl_add_discrete_descriptor_set(spvc_compiler compiler
 
 spvc_result spvc_compiler_msl_set_argument_buffer_device_address_space(spvc_compiler compiler, unsigned desc_set, spvc_bool device_address)
 {
+	compiler->remap_key.add_string(__func__).add_value(desc_set).add_value(device_address);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1484,6 +2402,7 @@ spvc_bool spvc_compiler_msl_is_resource_used(spvc_compiler compiler, SpvExecutio
 
 spvc_result spvc_compiler_msl_set_combined_sampler_suffix(spvc_compiler compiler, const char *suffix)
 {
+	compiler->remap_key.add_string(__func__).add_string(suffix);
 #if SPIRV_CROSS_C_API_MSL
 	if (compiler->backend != SPVC_BACKEND_MSL)
 	{
@@ -1553,187 +2472,757 @@ static void spvc_convert_msl_sampler_ycbcr_conversion(MSLConstexprSampler &samp,
 	samp.ycbcr_range = static_cast<MSLSamplerYCbCrRange>(conv->ycbcr_range);
 	samp.bpc = conv->bpc;
 }
-#endif
+#endif
+
+spvc_result spvc_compiler_msl_remap_constexpr_sampler(spvc_compiler compiler, spvc_variable_id id,
+                                                      const spvc_msl_constexpr_sampler *sampler)
+{
+	compiler->remap_key.add_string(__func__).add_value(id).add_pointee(sampler);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	MSLConstexprSampler samp;
+	spvc_convert_msl_sampler(samp, sampler);
+	msl.remap_constexpr_sampler(id, samp);
+	return SPVC_SUCCESS;
+#else
+	(void)id;
+	(void)sampler;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+spvc_result spvc_compiler_msl_remap_constexpr_sampler_by_binding(spvc_compiler compiler,
+                                                                 unsigned desc_set, unsigned binding,
+                                                                 const spvc_msl_constexpr_sampler *sampler)
+{
+	compiler->remap_key.add_string(__func__).add_value(desc_set).add_value(binding).add_pointee(sampler);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	MSLConstexprSampler samp;
+	spvc_convert_msl_sampler(samp, sampler);
+	msl.remap_constexpr_sampler_by_binding(desc_set, binding, samp);
+	return SPVC_SUCCESS;
+#else
+	(void)desc_set;
+	(void)binding;
+	(void)sampler;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+spvc_result spvc_compiler_msl_remap_constexpr_sampler_ycbcr(spvc_compiler compiler, spvc_variable_id id,
+                                                            const spvc_msl_constexpr_sampler *sampler,
+                                                            const spvc_msl_sampler_ycbcr_conversion *conv)
+{
+	compiler->remap_key.add_string(__func__).add_value(id).add_pointee(sampler).add_pointee(conv);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	MSLConstexprSampler samp;
+	spvc_convert_msl_sampler(samp, sampler);
+	spvc_convert_msl_sampler_ycbcr_conversion(samp, conv);
+	msl.remap_constexpr_sampler(id, samp);
+	return SPVC_SUCCESS;
+#else
+	(void)id;
+	(void)sampler;
+	(void)conv;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+spvc_result spvc_compiler_msl_remap_constexpr_sampler_by_binding_ycbcr(spvc_compiler compiler,
+                                                                       unsigned desc_set, unsigned binding,
+                                                                       const spvc_msl_constexpr_sampler *sampler,
+                                                                       const spvc_msl_sampler_ycbcr_conversion *conv)
+{
+	compiler->remap_key.add_string(__func__).add_value(desc_set).add_value(binding).add_pointee(sampler)
+	    .add_pointee(conv);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	MSLConstexprSampler samp;
+	spvc_convert_msl_sampler(samp, sampler);
+	spvc_convert_msl_sampler_ycbcr_conversion(samp, conv);
+	msl.remap_constexpr_sampler_by_binding(desc_set, binding, samp);
+	return SPVC_SUCCESS;
+#else
+	(void)desc_set;
+	(void)binding;
+	(void)sampler;
+	(void)conv;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+spvc_result spvc_compiler_msl_set_fragment_output_components(spvc_compiler compiler, unsigned location,
+                                                             unsigned components)
+{
+	compiler->remap_key.add_string(__func__).add_value(location).add_value(components);
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	msl.set_fragment_output_components(location, components);
+	return SPVC_SUCCESS;
+#else
+	(void)location;
+	(void)components;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+unsigned spvc_compiler_msl_get_automatic_resource_binding(spvc_compiler compiler, spvc_variable_id id)
+{
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return uint32_t(-1);
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	return msl.get_automatic_msl_resource_binding(id);
+#else
+	(void)id;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return uint32_t(-1);
+#endif
+}
+
+unsigned spvc_compiler_msl_get_automatic_resource_binding_secondary(spvc_compiler compiler, spvc_variable_id id)
+{
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return uint32_t(-1);
+	}
+
+	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+	return msl.get_automatic_msl_resource_binding_secondary(id);
+#else
+	(void)id;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return uint32_t(-1);
+#endif
+}
+
+spvc_result spvc_compiler_msl_get_argument_buffer_layout(spvc_compiler compiler, unsigned desc_set,
+                                                         const spvc_msl_argument_buffer_member **members,
+                                                         size_t *num_members, unsigned *size)
+{
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+		MSLArgumentBufferLayout layout;
+		if (!msl.get_argument_buffer_layout(desc_set, layout))
+		{
+			compiler->context->report_error("Descriptor set is not a Tier 2 argument buffer.");
+			return SPVC_ERROR_INVALID_ARGUMENT;
+		}
+
+		SmallVector<spvc_msl_argument_buffer_member> translated;
+		translated.reserve(layout.members.size());
+		for (auto &member : layout.members)
+		{
+			spvc_msl_argument_buffer_member m;
+			m.kind = static_cast<spvc_msl_argument_buffer_member_kind>(member.kind);
+			m.msl_index = member.msl_index;
+			m.offset = member.offset;
+			m.size = member.size;
+			m.array_size = member.array_size;
+			m.var_id = member.var_id;
+			translated.push_back(m);
+		}
+
+		auto ptr = spvc_allocate<TemporaryBuffer<spvc_msl_argument_buffer_member>>();
+		ptr->buffer = std::move(translated);
+		*members = ptr->buffer.data();
+		*num_members = ptr->buffer.size();
+		*size = layout.size;
+		compiler->context->allocations.push_back(std::move(ptr));
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_OUT_OF_MEMORY)
+	return SPVC_SUCCESS;
+#else
+	(void)desc_set;
+	(void)members;
+	(void)num_members;
+	(void)size;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+spvc_result spvc_compiler_msl_get_tessellation_buffer_layout(spvc_compiler compiler, SpvStorageClass storage,
+                                                             spvc_bool patch,
+                                                             const spvc_msl_tessellation_buffer_member **members,
+                                                             size_t *num_members, unsigned *stride)
+{
+#if SPIRV_CROSS_C_API_MSL
+	if (compiler->backend != SPVC_BACKEND_MSL)
+	{
+		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
+		MSLTessellationBufferLayout layout;
+		if (!msl.get_tessellation_buffer_layout(static_cast<spv::StorageClass>(storage), patch != SPVC_FALSE, layout))
+		{
+			compiler->context->report_error("Stage does not use a tessellation buffer for this storage.");
+			return SPVC_ERROR_INVALID_ARGUMENT;
+		}
+
+		SmallVector<spvc_msl_tessellation_buffer_member> translated;
+		translated.reserve(layout.members.size());
+		for (auto &member : layout.members)
+		{
+			spvc_msl_tessellation_buffer_member m;
+			m.location = member.location;
+			m.component = member.component;
+			m.builtin = static_cast<SpvBuiltIn>(member.builtin);
+			m.format = static_cast<spvc_msl_shader_variable_format>(member.format);
+			m.vecsize = member.vecsize;
+			m.offset = member.offset;
+			m.size = member.size;
+			translated.push_back(m);
+		}
+
+		auto ptr = spvc_allocate<TemporaryBuffer<spvc_msl_tessellation_buffer_member>>();
+		ptr->buffer = std::move(translated);
+		*members = ptr->buffer.data();
+		*num_members = ptr->buffer.size();
+		*stride = layout.stride;
+		compiler->context->allocations.push_back(std::move(ptr));
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_OUT_OF_MEMORY)
+	return SPVC_SUCCESS;
+#else
+	(void)storage;
+	(void)patch;
+	(void)members;
+	(void)num_members;
+	(void)stride;
+	compiler->context->report_error("MSL function used on a non-MSL backend.");
+	return SPVC_ERROR_INVALID_ARGUMENT;
+#endif
+}
+
+static std::string spvc_compiler_get_cache_path(spvc_compiler compiler)
+{
+	spvc_cache_key key;
+	if (!spvc_compiler_get_cache_key(compiler, key))
+		return {};
+	return compiler->context->cache_directory + "/" + key.to_string() + ".spvc";
+}
+
+// Compiles, or reads the source from cache_path if it is not empty. Only touches the compiler,
+// so that jobs can run it while other compilers of the same context are in use.
+static spvc_result spvc_compiler_compile_to_string(spvc_compiler compiler, const std::string &cache_path,
+                                                   std::string &source)
+{
+	if (!cache_path.empty() && read_cache_file(cache_path, source))
+	{
+		compiler->compiler.defer_compile();
+		return SPVC_SUCCESS;
+	}
+
+	compiler->cacheable = false;
+	source = compiler->compiler.skip_deferred_compile().compile();
+	if (source.empty())
+		return SPVC_ERROR_UNSUPPORTED_SPIRV;
+
+	if (!cache_path.empty())
+		write_cache_file(cache_path, source);
+	return SPVC_SUCCESS;
+}
+
+spvc_result spvc_compiler_compile(spvc_compiler compiler, const char **source)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		string result;
+		if (spvc_compiler_compile_to_string(compiler, spvc_compiler_get_cache_path(compiler), result) != SPVC_SUCCESS)
+		{
+			compiler->context->report_error("Unsupported SPIR-V.");
+			return SPVC_ERROR_UNSUPPORTED_SPIRV;
+		}
+
+		*source = compiler->context->allocate_name(result);
+		if (!*source)
+		{
+			compiler->context->report_error("Out of memory.");
+			return SPVC_ERROR_OUT_OF_MEMORY;
+		}
+		return SPVC_SUCCESS;
+	}
+	SPVC_END_COMPILE_SCOPE(compiler->context)
+}
+
+static spvc_result spvc_job_compile(spvc_job job)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		auto ret = spvc_compiler_compile_to_string(job->compiler, job->cache_path, job->source);
+		if (ret != SPVC_SUCCESS)
+			job->report_error("Unsupported SPIR-V.");
+		return ret;
+	}
+	SPVC_END_COMPILE_SCOPE(job)
+}
+
+static void spvc_job_run(void *task_data)
+{
+	auto *job = static_cast<spvc_job>(task_data);
+	job->result = spvc_job_compile(job);
+	job->finished.store(true, std::memory_order_release);
+
+	if (job->callback)
+		job->callback(job->userdata, job);
+
+	// Notify under the lock, the context may be destroyed as soon as it is released.
+	auto *context = job->context;
+	std::lock_guard<std::mutex> holder{ context->job_lock };
+	job->complete = true;
+	job->compiler->compiling.store(false, std::memory_order_relaxed);
+	context->running_jobs--;
+	context->job_cond.notify_all();
+}
+
+spvc_result spvc_compiler_compile_async(spvc_compiler compiler, spvc_job_callback callback, void *userdata,
+                                        spvc_job *job)
+{
+	auto *context = compiler->context;
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		auto ptr = spvc_allocate<spvc_job_s>();
+		ptr->context = context;
+		ptr->compiler = compiler;
+		ptr->callback = callback;
+		ptr->userdata = userdata;
+		auto *new_job = ptr.get();
+
+		// Claimed under the lock, so that of two threads starting a job on the same compiler, only one does.
+		bool already_compiling;
+		{
+			std::lock_guard<std::mutex> holder{ context->job_lock };
+			already_compiling = compiler->compiling.exchange(true, std::memory_order_relaxed);
+		}
+
+		if (already_compiling)
+		{
+			context->report_error("Compiler is already compiling.");
+			return SPVC_ERROR_INVALID_ARGUMENT;
+		}
+
+		// While the job counts as running, the scheduler cannot be changed, so it can be used outside the lock.
+		// The scheduler may run the job right away, which takes the lock itself.
+		spvc_job_scheduler scheduler;
+		void *scheduler_userdata;
+		WorkerPool *pool;
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+		try
+#endif
+		{
+			ptr->cache_path = spvc_compiler_get_cache_path(compiler);
+
+			// Other threads may start jobs too, so the job is added to the allocations of the context under the lock.
+			std::lock_guard<std::mutex> holder{ context->job_lock };
+			if (!context->job_scheduler && !context->worker_pool)
+				context->worker_pool.reset(new WorkerPool(std::max(std::thread::hardware_concurrency(), 1u)));
+			context->allocations.emplace_back(std::move(ptr));
+			context->running_jobs++;
+			scheduler = context->job_scheduler;
+			scheduler_userdata = context->job_scheduler_userdata;
+			pool = context->worker_pool.get();
+		}
+#ifndef SPIRV_CROSS_EXCEPTIONS_TO_ASSERTIONS
+		catch (...)
+		{
+			compiler->compiling.store(false, std::memory_order_relaxed);
+			throw;
+		}
+#endif
+
+		if (scheduler)
+			scheduler(scheduler_userdata, spvc_job_run, new_job);
+		else
+			pool->schedule(spvc_job_run, new_job);
+
+		*job = new_job;
+		return SPVC_SUCCESS;
+	}
+	SPVC_END_SAFE_SCOPE(context, SPVC_ERROR_OUT_OF_MEMORY)
+}
+
+spvc_bool spvc_job_is_complete(spvc_job job)
+{
+	std::lock_guard<std::mutex> holder{ job->context->job_lock };
+	return job->complete ? SPVC_TRUE : SPVC_FALSE;
+}
+
+void spvc_job_wait(spvc_job job)
+{
+	std::unique_lock<std::mutex> holder{ job->context->job_lock };
+	job->context->job_cond.wait(holder, [job] { return job->complete; });
+}
+
+spvc_result spvc_job_get_result(spvc_job job, const char **source)
+{
+	if (!job->finished.load(std::memory_order_acquire))
+	{
+		job->context->report_error("Job has not compiled yet.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (job->result == SPVC_SUCCESS)
+		*source = job->source.c_str();
+	return job->result;
+}
+
+const char *spvc_job_get_error_string(spvc_job job)
+{
+	if (!job->finished.load(std::memory_order_acquire))
+		return "";
+	return job->error.c_str();
+}
+
+namespace
+{
+struct CallbackOutputSink : OutputSink
+{
+	CallbackOutputSink(spvc_output_callback callback_, void *userdata_)
+	    : callback(callback_)
+	    , userdata(userdata_)
+	{
+	}
+
+	void write(const char *data, size_t size) override
+	{
+		callback(userdata, data, size);
+		written += size;
+	}
+
+	spvc_output_callback callback;
+	void *userdata;
+	size_t written = 0;
+};
+} // namespace
+
+spvc_result spvc_compiler_compile_to_callback(spvc_compiler compiler, spvc_output_callback callback, void *userdata)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		// The cache needs the whole source, so go through the string in that case.
+		if (compiler->cacheable)
+		{
+			const char *source = nullptr;
+			auto ret = spvc_compiler_compile(compiler, &source);
+			if (ret == SPVC_SUCCESS)
+				callback(userdata, source, strlen(source));
+			return ret;
+		}
+
+		CallbackOutputSink sink(callback, userdata);
+		compiler->compiler.skip_deferred_compile().compile_to(sink);
+		if (sink.written == 0)
+		{
+			compiler->context->report_error("Unsupported SPIR-V.");
+			return SPVC_ERROR_UNSUPPORTED_SPIRV;
+		}
+		return SPVC_SUCCESS;
+	}
+	SPVC_END_COMPILE_SCOPE(compiler->context)
+}
+
+spvc_result spvc_compiler_compile_all_entry_points(spvc_compiler compiler, spvc_entry_point_setup_callback setup,
+                                                   spvc_entry_point_output_callback output, void *userdata)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		compiler->cacheable = false;
+		auto &comp = compiler->compiler.skip_deferred_compile();
+
+		const auto translate = [](const EntryPoint &entry) {
+			spvc_entry_point translated;
+			translated.execution_model = static_cast<SpvExecutionModel>(entry.execution_model);
+			translated.name = entry.name.c_str();
+			return translated;
+		};
+
+		bool unsupported = false;
+		std::function<void(const EntryPoint &)> setup_entry;
+		if (setup)
+		{
+			setup_entry = [&](const EntryPoint &entry) {
+				auto translated = translate(entry);
+				setup(userdata, compiler, &translated);
+			};
+		}
+
+		// Each source is handed over as soon as its entry point has compiled, and released right after.
+		comp.compile_all_entry_points_to(setup_entry, [&](const EntryPoint &entry, string &source) {
+			if (unsupported || source.empty())
+			{
+				unsupported = true;
+				return;
+			}
+			auto translated = translate(entry);
+			output(userdata, &translated, source.c_str());
+		});
+
+		if (unsupported)
+		{
+			compiler->context->report_error("Unsupported SPIR-V.");
+			return SPVC_ERROR_UNSUPPORTED_SPIRV;
+		}
+		return SPVC_SUCCESS;
+	}
+	SPVC_END_COMPILE_SCOPE(compiler->context)
+}
 
-spvc_result spvc_compiler_msl_remap_constexpr_sampler(spvc_compiler compiler, spvc_variable_id id,
-                                                      const spvc_msl_constexpr_sampler *sampler)
+spvc_result spvc_compiler_reset(spvc_compiler compiler)
 {
-#if SPIRV_CROSS_C_API_MSL
-	if (compiler->backend != SPVC_BACKEND_MSL)
+	SPVC_BEGIN_SAFE_SCOPE
 	{
-		compiler->context->report_error("MSL function used on a non-MSL backend.");
-		return SPVC_ERROR_INVALID_ARGUMENT;
+		compiler->compiler.skip_deferred_compile().reset_for_recompile();
 	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_INVALID_ARGUMENT)
 
-	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	MSLConstexprSampler samp;
-	spvc_convert_msl_sampler(samp, sampler);
-	msl.remap_constexpr_sampler(id, samp);
+	// Remapping state is reset, but the key cannot drop what was added to it before.
+	compiler->cacheable = false;
 	return SPVC_SUCCESS;
-#else
-	(void)id;
-	(void)sampler;
-	compiler->context->report_error("MSL function used on a non-MSL backend.");
-	return SPVC_ERROR_INVALID_ARGUMENT;
-#endif
 }
 
-spvc_result spvc_compiler_msl_remap_constexpr_sampler_by_binding(spvc_compiler compiler,
-                                                                 unsigned desc_set, unsigned binding,
-                                                                 const spvc_msl_constexpr_sampler *sampler)
+spvc_result spvc_compiler_reset_for_hot_reload(spvc_compiler compiler, spvc_parsed_ir parsed_ir)
 {
-#if SPIRV_CROSS_C_API_MSL
-	if (compiler->backend != SPVC_BACKEND_MSL)
+	// Another compiler may have taken ownership of the IR.
+	if (parsed_ir->parsed.ids.empty())
 	{
-		compiler->context->report_error("MSL function used on a non-MSL backend.");
+		compiler->context->report_error("Parsed IR is no longer available.");
 		return SPVC_ERROR_INVALID_ARGUMENT;
 	}
 
-	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	MSLConstexprSampler samp;
-	spvc_convert_msl_sampler(samp, sampler);
-	msl.remap_constexpr_sampler_by_binding(desc_set, binding, samp);
-	return SPVC_SUCCESS;
-#else
-	(void)desc_set;
-	(void)binding;
-	(void)sampler;
-	compiler->context->report_error("MSL function used on a non-MSL backend.");
-	return SPVC_ERROR_INVALID_ARGUMENT;
-#endif
-}
-
-spvc_result spvc_compiler_msl_remap_constexpr_sampler_ycbcr(spvc_compiler compiler, spvc_variable_id id,
-                                                            const spvc_msl_constexpr_sampler *sampler,
-                                                            const spvc_msl_sampler_ycbcr_conversion *conv)
-{
-#if SPIRV_CROSS_C_API_MSL
-	if (compiler->backend != SPVC_BACKEND_MSL)
+	SPVC_BEGIN_SAFE_SCOPE
 	{
-		compiler->context->report_error("MSL function used on a non-MSL backend.");
-		return SPVC_ERROR_INVALID_ARGUMENT;
+		compiler->compiler.skip_deferred_compile().reset_for_hot_reload(parsed_ir->parsed);
 	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_INVALID_ARGUMENT)
 
-	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	MSLConstexprSampler samp;
-	spvc_convert_msl_sampler(samp, sampler);
-	spvc_convert_msl_sampler_ycbcr_conversion(samp, conv);
-	msl.remap_constexpr_sampler(id, samp);
+	compiler->cacheable = false;
 	return SPVC_SUCCESS;
-#else
-	(void)id;
-	(void)sampler;
-	(void)conv;
-	compiler->context->report_error("MSL function used on a non-MSL backend.");
-	return SPVC_ERROR_INVALID_ARGUMENT;
-#endif
 }
 
-spvc_result spvc_compiler_msl_remap_constexpr_sampler_by_binding_ycbcr(spvc_compiler compiler,
-                                                                       unsigned desc_set, unsigned binding,
-                                                                       const spvc_msl_constexpr_sampler *sampler,
-                                                                       const spvc_msl_sampler_ycbcr_conversion *conv)
+spvc_result spvc_compiler_get_resource_cost_report(spvc_compiler compiler, spvc_resource_cost_report *report)
 {
-#if SPIRV_CROSS_C_API_MSL
-	if (compiler->backend != SPVC_BACKEND_MSL)
+	SPVC_BEGIN_SAFE_SCOPE
 	{
-		compiler->context->report_error("MSL function used on a non-MSL backend.");
-		return SPVC_ERROR_INVALID_ARGUMENT;
-	}
+		ResourceCostReport costs = compiler->compiler->get_resource_cost_report();
 
-	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	MSLConstexprSampler samp;
-	spvc_convert_msl_sampler(samp, sampler);
-	spvc_convert_msl_sampler_ycbcr_conversion(samp, conv);
-	msl.remap_constexpr_sampler_by_binding(desc_set, binding, samp);
+		auto ptr = spvc_allocate<TemporaryBuffer<const char *>>();
+		ptr->buffer.reserve(costs.helper_functions.size());
+		for (auto &name : costs.helper_functions)
+		{
+			auto *allocated = compiler->context->allocate_name(name);
+			if (!allocated)
+			{
+				compiler->context->report_error("Out of memory.");
+				return SPVC_ERROR_OUT_OF_MEMORY;
+			}
+			ptr->buffer.push_back(allocated);
+		}
+
+		report->workgroup_memory_size = costs.workgroup_memory_size;
+		report->backend_workgroup_memory_size = costs.backend_workgroup_memory_size;
+		report->local_array_size = costs.local_array_size;
+		report->hoisted_temporary_count = costs.hoisted_temporary_count;
+		report->forced_temporary_count = costs.forced_temporary_count;
+		report->loop_count = costs.loop_count;
+		report->helper_functions = ptr->buffer.data();
+		report->num_helper_functions = ptr->buffer.size();
+		compiler->context->allocations.push_back(std::move(ptr));
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_OUT_OF_MEMORY)
 	return SPVC_SUCCESS;
-#else
-	(void)desc_set;
-	(void)binding;
-	(void)sampler;
-	(void)conv;
-	compiler->context->report_error("MSL function used on a non-MSL backend.");
-	return SPVC_ERROR_INVALID_ARGUMENT;
-#endif
 }
 
-spvc_result spvc_compiler_msl_set_fragment_output_components(spvc_compiler compiler, unsigned location,
-                                                             unsigned components)
+void spvc_compiler_set_compile_budget(spvc_compiler compiler, double max_seconds, unsigned long long max_work)
 {
-#if SPIRV_CROSS_C_API_MSL
-	if (compiler->backend != SPVC_BACKEND_MSL)
-	{
-		compiler->context->report_error("MSL function used on a non-MSL backend.");
-		return SPVC_ERROR_INVALID_ARGUMENT;
-	}
+	CompileBudget budget;
+	budget.max_seconds = max_seconds;
+	budget.max_work = max_work;
+	budget.cancel = &compiler->cancelled;
+	compiler->compiler->set_compile_budget(budget);
+}
 
-	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	msl.set_fragment_output_components(location, components);
-	return SPVC_SUCCESS;
-#else
-	(void)location;
-	(void)components;
-	compiler->context->report_error("MSL function used on a non-MSL backend.");
-	return SPVC_ERROR_INVALID_ARGUMENT;
-#endif
+void spvc_compiler_set_cancelled(spvc_compiler compiler, spvc_bool cancelled)
+{
+	compiler->cancelled.store(cancelled != SPVC_FALSE, std::memory_order_relaxed);
 }
 
-unsigned spvc_compiler_msl_get_automatic_resource_binding(spvc_compiler compiler, spvc_variable_id id)
+static void spvc_translate_memory_statistics(const IRMemoryStatistics &ir_stats, spvc_memory_statistics *stats)
 {
-#if SPIRV_CROSS_C_API_MSL
-	if (compiler->backend != SPVC_BACKEND_MSL)
+	static_assert(int(SPVC_MEMORY_POOL_COUNT) == int(TypeCount), "Pool indices must match Types.");
+	for (int i = 0; i < TypeCount; i++)
 	{
-		compiler->context->report_error("MSL function used on a non-MSL backend.");
-		return uint32_t(-1);
+		stats->pools[i].live_objects = ir_stats.pools[i].live_objects;
+		stats->pools[i].live_bytes = ir_stats.pools[i].live_bytes;
+		stats->pools[i].reserved_bytes = ir_stats.pools[i].reserved_bytes;
 	}
 
-	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	return msl.get_automatic_msl_resource_binding(id);
-#else
-	(void)id;
-	compiler->context->report_error("MSL function used on a non-MSL backend.");
-	return uint32_t(-1);
-#endif
+	stats->meta_count = ir_stats.meta_count;
+	stats->meta_bytes = ir_stats.meta_bytes;
+	stats->spirv_bytes = ir_stats.spirv_bytes;
+	stats->spirv_borrowed = ir_stats.spirv_borrowed ? SPVC_TRUE : SPVC_FALSE;
+	stats->expression_string_bytes = ir_stats.expression_string_bytes;
+	stats->output_block_count = 0;
 }
 
-unsigned spvc_compiler_msl_get_automatic_resource_binding_secondary(spvc_compiler compiler, spvc_variable_id id)
+void spvc_parsed_ir_get_memory_statistics(spvc_parsed_ir parsed_ir, spvc_memory_statistics *stats)
 {
-#if SPIRV_CROSS_C_API_MSL
-	if (compiler->backend != SPVC_BACKEND_MSL)
-	{
-		compiler->context->report_error("MSL function used on a non-MSL backend.");
-		return uint32_t(-1);
-	}
+	spvc_translate_memory_statistics(parsed_ir->parsed.get_memory_statistics(), stats);
+}
 
-	auto &msl = *static_cast<CompilerMSL *>(compiler->compiler.get());
-	return msl.get_automatic_msl_resource_binding_secondary(id);
-#else
-	(void)id;
-	compiler->context->report_error("MSL function used on a non-MSL backend.");
-	return uint32_t(-1);
-#endif
+void spvc_compiler_get_memory_statistics(spvc_compiler compiler, spvc_memory_statistics *stats)
+{
+	auto compiler_stats = compiler->compiler->get_memory_statistics();
+	spvc_translate_memory_statistics(compiler_stats, stats);
+	stats->output_block_count = compiler_stats.output_block_count;
 }
 
-spvc_result spvc_compiler_compile(spvc_compiler compiler, const char **source)
+spvc_result spvc_compiler_get_descriptor_heap_slots(spvc_compiler compiler, const spvc_descriptor_heap_slot **slots,
+                                                    size_t *num_slots)
 {
 	SPVC_BEGIN_SAFE_SCOPE
 	{
-		auto result = compiler->compiler->compile();
-		if (result.empty())
+		auto ptr = spvc_allocate<TemporaryBuffer<spvc_descriptor_heap_slot>>();
+		for (auto &slot : compiler->compiler->get_descriptor_heap_slots())
 		{
-			compiler->context->report_error("Unsupported SPIR-V.");
-			return SPVC_ERROR_UNSUPPORTED_SPIRV;
+			spvc_descriptor_heap_slot translated;
+			translated.id = slot.id;
+			translated.desc_set = slot.desc_set;
+			translated.binding = slot.binding;
+			translated.sampler_heap = slot.sampler_heap ? SPVC_TRUE : SPVC_FALSE;
+			translated.heap_binding = slot.heap_binding;
+			translated.index = slot.index;
+			ptr->buffer.push_back(translated);
 		}
 
-		*source = compiler->context->allocate_name(result);
-		if (!*source)
+		*slots = ptr->buffer.data();
+		*num_slots = ptr->buffer.size();
+		compiler->context->allocations.push_back(std::move(ptr));
+	}
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_OUT_OF_MEMORY)
+	return SPVC_SUCCESS;
+}
+
+spvc_result spvc_compiler_get_lowered_luts(spvc_compiler compiler, const spvc_lowered_lut **luts, size_t *num_luts)
+{
+	SPVC_BEGIN_SAFE_SCOPE
+	{
+		auto ptr = spvc_allocate<TemporaryBuffer<spvc_lowered_lut>>();
+		for (auto &lut : compiler->compiler->get_lowered_luts())
 		{
-			compiler->context->report_error("Out of memory.");
-			return SPVC_ERROR_OUT_OF_MEMORY;
+			spvc_lowered_lut translated;
+			translated.id = lut.constant;
+			translated.desc_set = lut.desc_set;
+			translated.binding = lut.binding;
+			translated.data = lut.data.data();
+			translated.size = lut.data.size();
+			ptr->buffer.push_back(translated);
 		}
-		return SPVC_SUCCESS;
+
+		*luts = ptr->buffer.data();
+		*num_luts = ptr->buffer.size();
+		compiler->context->allocations.push_back(std::move(ptr));
 	}
-	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_UNSUPPORTED_SPIRV)
+	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_OUT_OF_MEMORY)
+	return SPVC_SUCCESS;
+}
+
+void spvc_compiler_set_profile_callback(spvc_compiler compiler, spvc_profile_callback cb, void *userdata)
+{
+	if (!cb)
+	{
+		compiler->compiler->set_profile_callback(nullptr);
+		return;
+	}
+
+	compiler->compiler->set_profile_callback([cb, userdata](const CompilerPassProfile &profile) {
+		spvc_pass_profile p;
+		p.name = profile.name;
+		p.seconds = profile.seconds;
+		p.allocations = size_t(profile.allocations);
+		p.passes = profile.passes;
+		p.force_recompiles = profile.force_recompiles;
+		cb(userdata, &p);
+	});
+}
+
+const char *spvc_resources_s::copy_name(const std::string &name)
+{
+	char *ret = names.get() + names_offset;
+	memcpy(ret, name.c_str(), name.size() + 1);
+	names_offset += name.size() + 1;
+	return ret;
+}
+
+static size_t get_names_size(const SmallVector<Resource> &resources)
+{
+	size_t size = 0;
+	for (auto &r : resources)
+		size += r.name.size() + 1;
+	return size;
+}
+
+static size_t get_names_size(const SmallVector<BuiltInResource> &resources)
+{
+	size_t size = 0;
+	for (auto &r : resources)
+		size += r.resource.name.size() + 1;
+	return size;
 }
 
 bool spvc_resources_s::copy_resources(SmallVector<spvc_reflected_resource> &outputs,
@@ -1745,10 +3234,7 @@ bool spvc_resources_s::copy_resources(SmallVector<spvc_reflected_resource> &outp
 		r.base_type_id = i.base_type_id;
 		r.type_id = i.type_id;
 		r.id = i.id;
-		r.name = context->allocate_name(i.name);
-		if (!r.name)
-			return false;
-
+		r.name = copy_name(i.name);
 		outputs.push_back(r);
 	}
 
@@ -1769,10 +3255,7 @@ bool spvc_resources_s::copy_resources(SmallVector<spvc_reflected_builtin_resourc
 		r.base_type_id = i.resource.base_type_id;
 		r.type_id = i.resource.type_id;
 		r.id = i.resource.id;
-		r.name = context->allocate_name(i.resource.name);
-		if (!r.name)
-			return false;
-
+		r.name = copy_name(i.resource.name);
 		outputs.push_back(br);
 	}
 
@@ -1781,6 +3264,21 @@ bool spvc_resources_s::copy_resources(SmallVector<spvc_reflected_builtin_resourc
 
 bool spvc_resources_s::copy_resources(const ShaderResources &resources)
 {
+	size_t names_size =
+	    get_names_size(resources.uniform_buffers) + get_names_size(resources.storage_buffers) +
+	    get_names_size(resources.stage_inputs) + get_names_size(resources.stage_outputs) +
+	    get_names_size(resources.subpass_inputs) + get_names_size(resources.storage_images) +
+	    get_names_size(resources.sampled_images) + get_names_size(resources.atomic_counters) +
+	    get_names_size(resources.push_constant_buffers) + get_names_size(resources.shader_record_buffers) +
+	    get_names_size(resources.separate_images) + get_names_size(resources.separate_samplers) +
+	    get_names_size(resources.acceleration_structures) + get_names_size(resources.builtin_inputs) +
+	    get_names_size(resources.builtin_outputs);
+
+	names.reset(new (std::nothrow) char[names_size ? names_size : 1]);
+	if (!names)
+		return false;
+	names_offset = 0;
+
 	if (!copy_resources(uniform_buffers, resources.uniform_buffers))
 		return false;
 	if (!copy_resources(storage_buffers, resources.storage_buffers))
@@ -1839,6 +3337,12 @@ spvc_result spvc_compiler_set_enabled_interface_variables(spvc_compiler compiler
 {
 	SPVC_BEGIN_SAFE_SCOPE
 	{
+		SmallVector<uint32_t> ids;
+		for (auto &id : set->set)
+			ids.push_back(id);
+		sort(ids.begin(), ids.end());
+		compiler->remap_key.add_string(__func__).add_value(ids.size()).add(ids.data(), ids.size() * sizeof(uint32_t));
+
 		compiler->compiler->set_enabled_interface_variables(set->set);
 	}
 	SPVC_END_SAFE_SCOPE(compiler->context, SPVC_ERROR_INVALID_ARGUMENT)
@@ -1899,9 +3403,8 @@ spvc_result spvc_compiler_create_shader_resources(spvc_compiler compiler, spvc_r
 	return SPVC_SUCCESS;
 }
 
-spvc_result spvc_resources_get_resource_list_for_type(spvc_resources resources, spvc_resource_type type,
-                                                      const spvc_reflected_resource **resource_list,
-                                                      size_t *resource_size)
+static const SmallVector<spvc_reflected_resource> *get_resource_list(spvc_resources resources,
+                                                                    spvc_resource_type type)
 {
 	const SmallVector<spvc_reflected_resource> *list = nullptr;
 	switch (type)
@@ -1963,20 +3466,49 @@ spvc_result spvc_resources_get_resource_list_for_type(spvc_resources resources,
 	}
 
 	if (!list)
-	{
 		resources->context->report_error("Invalid argument.");
+	return list;
+}
+
+spvc_result spvc_resources_get_resource_list_for_type(spvc_resources resources, spvc_resource_type type,
+                                                      const spvc_reflected_resource **resource_list,
+                                                      size_t *resource_size)
+{
+	auto *list = get_resource_list(resources, type);
+	if (!list)
 		return SPVC_ERROR_INVALID_ARGUMENT;
-	}
 
 	*resource_size = list->size();
 	*resource_list = list->data();
 	return SPVC_SUCCESS;
 }
 
-spvc_result spvc_resources_get_builtin_resource_list_for_type(
-		spvc_resources resources, spvc_builtin_resource_type type,
-		const spvc_reflected_builtin_resource **resource_list,
-		size_t *resource_size)
+spvc_result spvc_resources_copy_resource_list_for_type(spvc_resources resources, spvc_resource_type type,
+                                                       spvc_reflected_resource *resource_list,
+                                                       size_t *resource_size)
+{
+	auto *list = get_resource_list(resources, type);
+	if (!list)
+		return SPVC_ERROR_INVALID_ARGUMENT;
+
+	size_t capacity = *resource_size;
+	*resource_size = list->size();
+	if (!resource_list)
+		return SPVC_SUCCESS;
+
+	if (capacity < list->size())
+	{
+		resources->context->report_error("Resource list does not fit in the provided memory.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!list->empty())
+		memcpy(resource_list, list->data(), list->size() * sizeof(spvc_reflected_resource));
+	return SPVC_SUCCESS;
+}
+
+static const SmallVector<spvc_reflected_builtin_resource> *get_builtin_resource_list(spvc_resources resources,
+                                                                                   spvc_builtin_resource_type type)
 {
 	const SmallVector<spvc_reflected_builtin_resource> *list = nullptr;
 	switch (type)
@@ -1994,16 +3526,49 @@ spvc_result spvc_resources_get_builtin_resource_list_for_type(
 	}
 
 	if (!list)
-	{
 		resources->context->report_error("Invalid argument.");
+	return list;
+}
+
+spvc_result spvc_resources_get_builtin_resource_list_for_type(
+		spvc_resources resources, spvc_builtin_resource_type type,
+		const spvc_reflected_builtin_resource **resource_list,
+		size_t *resource_size)
+{
+	auto *list = get_builtin_resource_list(resources, type);
+	if (!list)
 		return SPVC_ERROR_INVALID_ARGUMENT;
-	}
 
 	*resource_size = list->size();
 	*resource_list = list->data();
 	return SPVC_SUCCESS;
 }
 
+spvc_result spvc_resources_copy_builtin_resource_list_for_type(spvc_resources resources,
+                                                               spvc_builtin_resource_type type,
+                                                               spvc_reflected_builtin_resource *resource_list,
+                                                               size_t *resource_size)
+{
+	auto *list = get_builtin_resource_list(resources, type);
+	if (!list)
+		return SPVC_ERROR_INVALID_ARGUMENT;
+
+	size_t capacity = *resource_size;
+	*resource_size = list->size();
+	if (!resource_list)
+		return SPVC_SUCCESS;
+
+	if (capacity < list->size())
+	{
+		resources->context->report_error("Resource list does not fit in the provided memory.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (!list->empty())
+		memcpy(resource_list, list->data(), list->size() * sizeof(spvc_reflected_builtin_resource));
+	return SPVC_SUCCESS;
+}
+
 void spvc_compiler_set_decoration(spvc_compiler compiler, SpvId id, SpvDecoration decoration, unsigned argument)
 {
 	compiler->compiler->set_decoration(id, static_cast<spv::Decoration>(decoration), argument);
@@ -2072,6 +3637,13 @@ unsigned spvc_compiler_get_decoration(spvc_compiler compiler, SpvId id, SpvDecor
 	return compiler->compiler->get_decoration(id, static_cast<spv::Decoration>(decoration));
 }
 
+void spvc_compiler_get_decorations(spvc_compiler compiler, const SpvId *ids, size_t count, SpvDecoration decoration,
+                                   unsigned *values)
+{
+	for (size_t i = 0; i < count; i++)
+		values[i] = compiler->compiler->get_decoration(ids[i], static_cast<spv::Decoration>(decoration));
+}
+
 const char *spvc_compiler_get_decoration_string(spvc_compiler compiler, SpvId id, SpvDecoration decoration)
 {
 	return compiler->compiler->get_decoration_string(id, static_cast<spv::Decoration>(decoration)).c_str();
@@ -2394,6 +3966,7 @@ spvc_result spvc_compiler_type_struct_member_matrix_stride(spvc_compiler compile
 
 spvc_result spvc_compiler_build_dummy_sampler_for_combined_images(spvc_compiler compiler, spvc_variable_id *id)
 {
+	compiler->remap_key.add_string(__func__);
 	SPVC_BEGIN_SAFE_SCOPE
 	{
 		*id = compiler->compiler->build_dummy_sampler_for_combined_images();
@@ -2404,6 +3977,7 @@ spvc_result spvc_compiler_build_dummy_sampler_for_combined_images(spvc_compiler
 
 spvc_result spvc_compiler_build_combined_image_samplers(spvc_compiler compiler)
 {
+	compiler->remap_key.add_string(__func__);
 	SPVC_BEGIN_SAFE_SCOPE
 	{
 		compiler->compiler->build_combined_image_samplers();
@@ -2471,6 +4045,24 @@ spvc_constant spvc_compiler_get_constant_handle(spvc_compiler compiler, spvc_var
 	SPVC_END_SAFE_SCOPE(compiler->context, nullptr)
 }
 
+spvc_result spvc_compiler_set_specialization_constant_value(spvc_compiler compiler, unsigned constant_id,
+                                                            const void *data, size_t size)
+{
+	if (size != 1 && size != 2 && size != 4 && size != 8)
+	{
+		compiler->context->report_error("Specialization constant size must be 1, 2, 4 or 8 bytes.");
+		return SPVC_ERROR_INVALID_ARGUMENT;
+	}
+
+	// Specialization data does not need to be aligned. Assumes a little-endian host, like the rest of the API.
+	uint64_t value = 0;
+	memcpy(&value, data, size);
+
+	compiler->remap_key.add_string(__func__).add_value(constant_id).add_value(value);
+	compiler->compiler->set_specialization_constant_value(constant_id, value);
+	return SPVC_SUCCESS;
+}
+
 spvc_constant_id spvc_compiler_get_work_group_size_specialization_constants(spvc_compiler compiler,
                                                                             spvc_specialization_constant *x,
                                                                             spvc_specialization_constant *y,
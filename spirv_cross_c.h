@@ -40,7 +40,7 @@ extern "C" {
 /* Bumped if ABI or API breaks backwards compatibility. */
 #define SPVC_C_API_VERSION_MAJOR 0
 /* Bumped if APIs or enumerations are added in a backwards compatible way. */
-#define SPVC_C_API_VERSION_MINOR 57
+#define SPVC_C_API_VERSION_MINOR 82
 /* Bumped if internal implementation details change. */
 #define SPVC_C_API_VERSION_PATCH 0
 
@@ -79,6 +79,7 @@ typedef const struct spvc_type_s *spvc_type;
 typedef struct spvc_constant_s *spvc_constant;
 struct spvc_set_s;
 typedef const struct spvc_set_s *spvc_set;
+typedef struct spvc_job_s *spvc_job;
 
 /*
  * Shallow typedefs. All SPIR-V IDs are plain 32-bit numbers, but this helps communicate which data is used.
@@ -113,6 +114,29 @@ typedef struct spvc_entry_point
 	const char *name;
 } spvc_entry_point;
 
+/* See C++ API. */
+typedef struct spvc_pass_profile
+{
+	const char *name;
+	double seconds;
+	size_t allocations;
+	unsigned passes;
+	unsigned force_recompiles;
+} spvc_pass_profile;
+
+/* See C++ API. */
+typedef struct spvc_resource_cost_report
+{
+	unsigned workgroup_memory_size;
+	unsigned backend_workgroup_memory_size;
+	unsigned local_array_size;
+	unsigned hoisted_temporary_count;
+	unsigned forced_temporary_count;
+	unsigned loop_count;
+	const char **helper_functions;
+	size_t num_helper_functions;
+} spvc_resource_cost_report;
+
 /* See C++ API. */
 typedef struct spvc_combined_image_sampler
 {
@@ -145,6 +169,17 @@ typedef struct spvc_hlsl_root_constants
 	unsigned space;
 } spvc_hlsl_root_constants;
 
+/* See C++ API. */
+typedef struct spvc_hlsl_promoted_root_constants
+{
+	spvc_variable_id id;
+	unsigned desc_set;
+	unsigned binding;
+	unsigned register_space;
+	unsigned register_binding;
+	unsigned num_dwords;
+} spvc_hlsl_promoted_root_constants;
+
 /* See C++ API. */
 typedef struct spvc_hlsl_vertex_attribute_remap
 {
@@ -161,6 +196,68 @@ typedef unsigned char spvc_bool;
 #define SPVC_TRUE ((spvc_bool)1)
 #define SPVC_FALSE ((spvc_bool)0)
 
+/* See C++ API. */
+typedef struct spvc_descriptor_heap_slot
+{
+	spvc_variable_id id;
+	unsigned desc_set;
+	unsigned binding;
+	spvc_bool sampler_heap;
+	unsigned heap_binding;
+	unsigned index;
+} spvc_descriptor_heap_slot;
+
+/* See C++ API. */
+typedef struct spvc_lowered_lut
+{
+	spvc_constant_id id;
+	unsigned desc_set;
+	unsigned binding;
+	const void *data;
+	size_t size;
+} spvc_lowered_lut;
+
+/* Indexes spvc_memory_statistics::pools. Mirrors the Types enum of the C++ API. */
+typedef enum spvc_memory_pool
+{
+	SPVC_MEMORY_POOL_NONE = 0,
+	SPVC_MEMORY_POOL_TYPE = 1,
+	SPVC_MEMORY_POOL_VARIABLE = 2,
+	SPVC_MEMORY_POOL_CONSTANT = 3,
+	SPVC_MEMORY_POOL_FUNCTION = 4,
+	SPVC_MEMORY_POOL_FUNCTION_PROTOTYPE = 5,
+	SPVC_MEMORY_POOL_BLOCK = 6,
+	SPVC_MEMORY_POOL_EXTENSION = 7,
+	SPVC_MEMORY_POOL_EXPRESSION = 8,
+	SPVC_MEMORY_POOL_CONSTANT_OP = 9,
+	SPVC_MEMORY_POOL_COMBINED_IMAGE_SAMPLER = 10,
+	SPVC_MEMORY_POOL_ACCESS_CHAIN = 11,
+	SPVC_MEMORY_POOL_UNDEF = 12,
+	SPVC_MEMORY_POOL_STRING = 13,
+	SPVC_MEMORY_POOL_COUNT = 14,
+	SPVC_MEMORY_POOL_INT_MAX = 0x7fffffff
+} spvc_memory_pool;
+
+/* See C++ API. */
+typedef struct spvc_memory_pool_statistics
+{
+	unsigned long long live_objects;
+	size_t live_bytes;
+	size_t reserved_bytes;
+} spvc_memory_pool_statistics;
+
+/* See C++ API. */
+typedef struct spvc_memory_statistics
+{
+	spvc_memory_pool_statistics pools[SPVC_MEMORY_POOL_COUNT];
+	size_t meta_count;
+	size_t meta_bytes;
+	size_t spirv_bytes;
+	spvc_bool spirv_borrowed;
+	size_t expression_string_bytes;
+	size_t output_block_count;
+} spvc_memory_statistics;
+
 typedef enum spvc_result
 {
 	/* Success. */
@@ -178,6 +275,9 @@ typedef enum spvc_result
 	/* Invalid API argument. */
 	SPVC_ERROR_INVALID_ARGUMENT = -4,
 
+	/* Compilation ran out of its budget or was cancelled, see spvc_compiler_set_compile_budget. */
+	SPVC_ERROR_CANCELLED = -5,
+
 	SPVC_ERROR_INT_MAX = 0x7fffffff
 } spvc_result;
 
@@ -397,6 +497,40 @@ typedef struct spvc_msl_resource_binding
  */
 SPVC_PUBLIC_API void spvc_msl_resource_binding_init(spvc_msl_resource_binding *binding);
 
+/* Maps to C++ API. */
+typedef enum spvc_msl_argument_buffer_member_kind
+{
+	SPVC_MSL_ARGUMENT_BUFFER_MEMBER_KIND_BUFFER = 0,
+	SPVC_MSL_ARGUMENT_BUFFER_MEMBER_KIND_TEXTURE = 1,
+	SPVC_MSL_ARGUMENT_BUFFER_MEMBER_KIND_SAMPLER = 2,
+	SPVC_MSL_ARGUMENT_BUFFER_MEMBER_KIND_ACCELERATION_STRUCTURE = 3,
+	SPVC_MSL_ARGUMENT_BUFFER_MEMBER_KIND_INLINE_DATA = 4,
+	SPVC_MSL_ARGUMENT_BUFFER_MEMBER_KIND_INT_MAX = 0x7fffffff
+} spvc_msl_argument_buffer_member_kind;
+
+/* Maps to C++ API. */
+typedef struct spvc_msl_argument_buffer_member
+{
+	spvc_msl_argument_buffer_member_kind kind;
+	unsigned msl_index;
+	unsigned offset;
+	unsigned size;
+	unsigned array_size;
+	spvc_variable_id var_id;
+} spvc_msl_argument_buffer_member;
+
+/* Maps to C++ API. builtin is SpvBuiltInMax for members at a location. */
+typedef struct spvc_msl_tessellation_buffer_member
+{
+	unsigned location;
+	unsigned component;
+	SpvBuiltIn builtin;
+	spvc_msl_shader_variable_format format;
+	unsigned vecsize;
+	unsigned offset;
+	unsigned size;
+} spvc_msl_tessellation_buffer_member;
+
 #define SPVC_MSL_PUSH_CONSTANT_DESC_SET (~(0u))
 #define SPVC_MSL_PUSH_CONSTANT_BINDING (0)
 #define SPVC_MSL_SWIZZLE_BUFFER_BINDING (~(1u))
@@ -726,6 +860,33 @@ typedef enum spvc_compiler_option
 	SPVC_COMPILER_OPTION_MSL_ARGUMENT_BUFFERS_TIER = 84 | SPVC_COMPILER_OPTION_MSL_BIT,
 	SPVC_COMPILER_OPTION_MSL_SAMPLE_DREF_LOD_ARRAY_AS_GRAD = 85 | SPVC_COMPILER_OPTION_MSL_BIT,
 
+	SPVC_COMPILER_OPTION_COMMON_SUBEXPRESSION_MIN_COST = 86 | SPVC_COMPILER_OPTION_COMMON_BIT,
+
+	SPVC_COMPILER_OPTION_HLSL_RELAXED_PRECISION_AS_16BIT = 87 | SPVC_COMPILER_OPTION_HLSL_BIT,
+	SPVC_COMPILER_OPTION_MSL_RELAXED_PRECISION_AS_16BIT = 88 | SPVC_COMPILER_OPTION_MSL_BIT,
+
+	SPVC_COMPILER_OPTION_GLSL_MINIFY = 89 | SPVC_COMPILER_OPTION_GLSL_BIT,
+
+	SPVC_COMPILER_OPTION_MSL_ARGUMENT_BUFFERS_STABLE_LAYOUT = 90 | SPVC_COMPILER_OPTION_MSL_BIT,
+
+	SPVC_COMPILER_OPTION_HLSL_ROOT_CONSTANT_PROMOTION_DWORD_BUDGET = 91 | SPVC_COMPILER_OPTION_HLSL_BIT,
+
+	SPVC_COMPILER_OPTION_HLSL_DESCRIPTOR_HEAP_INDEXING = 92 | SPVC_COMPILER_OPTION_HLSL_BIT,
+	SPVC_COMPILER_OPTION_HLSL_DESCRIPTOR_HEAP_INDEX_REGISTER = 93 | SPVC_COMPILER_OPTION_HLSL_BIT,
+	SPVC_COMPILER_OPTION_HLSL_DESCRIPTOR_HEAP_INDEX_SPACE = 94 | SPVC_COMPILER_OPTION_HLSL_BIT,
+	SPVC_COMPILER_OPTION_GLSL_DESCRIPTOR_HEAP_INDEXING = 95 | SPVC_COMPILER_OPTION_GLSL_BIT,
+	SPVC_COMPILER_OPTION_GLSL_DESCRIPTOR_HEAP_SET = 96 | SPVC_COMPILER_OPTION_GLSL_BIT,
+
+	SPVC_COMPILER_OPTION_GLSL_LUT_BUFFER_MIN_SIZE = 97 | SPVC_COMPILER_OPTION_GLSL_BIT,
+	SPVC_COMPILER_OPTION_GLSL_LUT_BUFFER_SET = 98 | SPVC_COMPILER_OPTION_GLSL_BIT,
+	SPVC_COMPILER_OPTION_GLSL_LUT_BUFFER_BINDING = 99 | SPVC_COMPILER_OPTION_GLSL_BIT,
+	SPVC_COMPILER_OPTION_HLSL_LUT_BUFFER_MIN_SIZE = 100 | SPVC_COMPILER_OPTION_HLSL_BIT,
+	SPVC_COMPILER_OPTION_HLSL_LUT_BUFFER_REGISTER = 101 | SPVC_COMPILER_OPTION_HLSL_BIT,
+	SPVC_COMPILER_OPTION_HLSL_LUT_BUFFER_SPACE = 102 | SPVC_COMPILER_OPTION_HLSL_BIT,
+
+	SPVC_COMPILER_OPTION_MSL_PACK_TESSELLATION_BUFFERS = 103 | SPVC_COMPILER_OPTION_MSL_BIT,
+	SPVC_COMPILER_OPTION_MSL_PACK_TESSELLATION_BUFFERS_RELAXED_PRECISION_AS_HALF = 104 | SPVC_COMPILER_OPTION_MSL_BIT,
+
 	SPVC_COMPILER_OPTION_INT_MAX = 0x7fffffff
 } spvc_compiler_option;
 
@@ -744,6 +905,9 @@ SPVC_PUBLIC_API void spvc_context_destroy(spvc_context context);
 /* Frees all memory allocations and objects associated with the context and its child objects, but keeps the context alive. */
 SPVC_PUBLIC_API void spvc_context_release_allocations(spvc_context context);
 
+/* Number of allocations the context holds until spvc_context_release_allocations, including parsed IR and compilers. */
+SPVC_PUBLIC_API size_t spvc_context_get_allocation_count(spvc_context context);
+
 /* Get the string for the last error which was logged. */
 SPVC_PUBLIC_API const char *spvc_context_get_last_error_string(spvc_context context);
 
@@ -751,10 +915,87 @@ SPVC_PUBLIC_API const char *spvc_context_get_last_error_string(spvc_context cont
 typedef void (*spvc_error_callback)(void *userdata, const char *error);
 SPVC_PUBLIC_API void spvc_context_set_error_callback(spvc_context context, spvc_error_callback cb, void *userdata);
 
+/*
+ * Makes the IR objects of any SPIR-V parsed with this context afterwards, including the copies held by compilers,
+ * come from a bump arena owned by the context rather than from individual heap allocations.
+ * The arena requests large chunks from allocate_cb, or malloc() if allocate_cb is NULL,
+ * and all chunks are handed back to free_cb at once when spvc_context_release_allocations
+ * or spvc_context_destroy is called. Memory returned by allocate_cb must be aligned to at least 16 bytes.
+ * free_cb may be NULL if the application reclaims the memory by other means.
+ */
+typedef void *(*spvc_allocate_callback)(void *userdata, size_t size);
+typedef void (*spvc_free_callback)(void *userdata, void *ptr);
+SPVC_PUBLIC_API spvc_result spvc_context_enable_memory_arena(spvc_context context, spvc_allocate_callback allocate_cb,
+                                                             spvc_free_callback free_cb, void *userdata);
+
+/*
+ * Enables a persistent, content-addressed cache of compiled output in an existing directory. Pass NULL to disable.
+ * Only compilers created after this call use the cache. spvc_compiler_compile for such a compiler first looks
+ * for an entry keyed by the backend, the SPIRV-Cross revision, the IR with every name, decoration and constant
+ * set on it, the installed options and every remap and binding set on the compiler through this API.
+ * On a hit, the cached source is returned without compiling. Compiling again without changes hits again.
+ * Any other call on the compiler after a hit first compiles for real, so that queries about compilation results,
+ * e.g. spvc_compiler_msl_is_resource_used, answer as if the compile had not been served from the cache.
+ * Only the first compile of a compiler is cached. Once it has compiled for real, been reset,
+ * or compiled all entry points, the cache is no longer used for it.
+ * The directory may be shared by several processes.
+ */
+SPVC_PUBLIC_API void spvc_context_set_compilation_cache(spvc_context context, const char *directory);
+
+/*
+ * Decides where spvc_compiler_compile_async runs jobs. scheduler must arrange for task(task_data) to be called
+ * exactly once, on any thread, and may call it directly. If scheduler is NULL, which is the default,
+ * jobs run on a pool of worker threads owned by the context, one per hardware thread,
+ * which is started by the first job. Cannot be changed while jobs are running.
+ */
+typedef void (*spvc_job_task)(void *task_data);
+typedef void (*spvc_job_scheduler)(void *userdata, spvc_job_task task, void *task_data);
+SPVC_PUBLIC_API spvc_result spvc_context_set_job_scheduler(spvc_context context, spvc_job_scheduler scheduler,
+                                                           void *userdata);
+
 /* SPIR-V parsing interface. Maps to Parser which then creates a ParsedIR, and that IR is extracted into the handle. */
 SPVC_PUBLIC_API spvc_result spvc_context_parse_spirv(spvc_context context, const SpvId *spirv, size_t word_count,
                                                      spvc_parsed_ir *parsed_ir);
 
+/*
+ * Like spvc_context_parse_spirv, but the SPIR-V is not copied. The parsed IR and any compiler created from it
+ * keep referring to the spirv buffer, which must stay alive and unmodified until they are no longer used.
+ * Useful if the SPIR-V is memory-mapped.
+ */
+SPVC_PUBLIC_API spvc_result spvc_context_parse_spirv_borrowed(spvc_context context, const SpvId *spirv,
+                                                              size_t word_count, spvc_parsed_ir *parsed_ir);
+
+/*
+ * Parses a later version of the module previous was parsed from, e.g. when a shader is hot reloaded.
+ * Maps to Parser::parse_incremental, so only functions which changed are parsed if nothing else did.
+ * The result is the same as spvc_context_parse_spirv gives. previous is copied, and has to be available,
+ * i.e. not moved into a compiler with SPVC_CAPTURE_MODE_TAKE_OWNERSHIP.
+ */
+SPVC_PUBLIC_API spvc_result spvc_context_parse_spirv_incremental(spvc_context context, const SpvId *spirv,
+                                                                 size_t word_count, spvc_parsed_ir previous,
+                                                                 spvc_parsed_ir *parsed_ir);
+
+/*
+ * Memory held by the parsed IR. Maps to ParsedIR::get_memory_statistics. output_block_count is always 0.
+ * Once a compiler took ownership of the IR, this reports an empty IR.
+ */
+SPVC_PUBLIC_API void spvc_parsed_ir_get_memory_statistics(spvc_parsed_ir parsed_ir, spvc_memory_statistics *stats);
+
+/*
+ * Serializes the parsed IR to a blob which spvc_context_parse_serialized_ir loads without parsing the SPIR-V again.
+ * Maps to serialize_parsed_ir. The blob is owned by the context. Has to be called before a compiler takes ownership of the IR.
+ */
+SPVC_PUBLIC_API spvc_result spvc_parsed_ir_serialize(spvc_parsed_ir parsed_ir, const unsigned char **data, size_t *size);
+
+/*
+ * Loads IR serialized with spvc_parsed_ir_serialize, instead of parsing SPIR-V. Maps to deserialize_parsed_ir.
+ * If borrow is true, the SPIR-V words are referenced in the blob, like spvc_context_parse_spirv_borrowed does,
+ * so it must be 4-byte aligned and stay alive and unmodified until the IR and its compilers are no longer used.
+ * Fails with SPVC_ERROR_INVALID_ARGUMENT if the blob is malformed or from another version of SPIRV-Cross.
+ */
+SPVC_PUBLIC_API spvc_result spvc_context_parse_serialized_ir(spvc_context context, const void *data, size_t size,
+                                                             spvc_bool borrow, spvc_parsed_ir *parsed_ir);
+
 /*
  * Create a compiler backend. Capture mode controls if we construct by copy or move semantics.
  * It is always recommended to use SPVC_CAPTURE_MODE_TAKE_OWNERSHIP if you only intend to cross-compile the IR once.
@@ -781,6 +1022,135 @@ SPVC_PUBLIC_API spvc_result spvc_compiler_install_compiler_options(spvc_compiler
 /* Compile IR into a string. *source is owned by the context, and caller must not free it themselves. */
 SPVC_PUBLIC_API spvc_result spvc_compiler_compile(spvc_compiler compiler, const char **source);
 
+/*
+ * Like spvc_compiler_compile, but the source is passed to callback in pieces, in order, instead of being copied
+ * into memory owned by the context. The pieces are not NUL-terminated and are only valid during the callback.
+ * The callback is only called once compilation has succeeded. Maps to Compiler::compile_to.
+ */
+typedef void (*spvc_output_callback)(void *userdata, const char *data, size_t size);
+SPVC_PUBLIC_API spvc_result spvc_compiler_compile_to_callback(spvc_compiler compiler, spvc_output_callback callback,
+                                                              void *userdata);
+
+/*
+ * Compiles every entry point of the module, in the order of spvc_compiler_get_entry_points.
+ * Maps to Compiler::compile_all_entry_points. Has to be called instead of spvc_compiler_compile.
+ * State set on the compiler beforehand applies to every entry point, except backend specific remapping
+ * such as resource bindings, which is reset for each entry point and can be set up again in setup.
+ * setup may be NULL, and is called once the entry point is selected. output is called with the source as soon as
+ * each entry point has compiled, before the next one is compiled, and the source is released once output returns.
+ * Only control flow graphs of functions shared between entry points are reused, everything else is compiled
+ * again for each entry point. The entry point and the source are only valid during the callbacks.
+ * If an entry point fails to compile, output is not called for it or any later entry point.
+ * The compilation cache is not used, and is disabled for the compiler afterwards.
+ */
+typedef void (*spvc_entry_point_setup_callback)(void *userdata, spvc_compiler compiler,
+                                                const spvc_entry_point *entry_point);
+typedef void (*spvc_entry_point_output_callback)(void *userdata, const spvc_entry_point *entry_point,
+                                                 const char *source);
+SPVC_PUBLIC_API spvc_result spvc_compiler_compile_all_entry_points(spvc_compiler compiler,
+                                                                   spvc_entry_point_setup_callback setup,
+                                                                   spvc_entry_point_output_callback output,
+                                                                   void *userdata);
+
+/*
+ * Like spvc_compiler_compile, but returns right away, and the compiler compiles on another thread,
+ * see spvc_context_set_job_scheduler. The compiler must not be used until the job is complete,
+ * but other compilers of the same context can be used and compiled meanwhile.
+ * callback may be NULL, and is called on the thread of the job once it has compiled, before it is complete.
+ * As the context is not synchronized, callback must not call any function of this API other than
+ * spvc_job_is_complete, spvc_job_get_result and spvc_job_get_error_string. Starting a job on a compiler
+ * which is already compiling fails, also if another thread starts it at the same time.
+ * The job is owned by the context, and holds the source and the error, which are not reported to the context.
+ * spvc_context_release_allocations and spvc_context_destroy wait for all jobs to complete.
+ */
+typedef void (*spvc_job_callback)(void *userdata, spvc_job job);
+SPVC_PUBLIC_API spvc_result spvc_compiler_compile_async(spvc_compiler compiler, spvc_job_callback callback,
+                                                        void *userdata, spvc_job *job);
+
+/* Whether the job is complete, i.e. it has compiled and its callback has returned. Does not block. */
+SPVC_PUBLIC_API spvc_bool spvc_job_is_complete(spvc_job job);
+
+/* Blocks until the job is complete. Must not be called from its callback. */
+SPVC_PUBLIC_API void spvc_job_wait(spvc_job job);
+
+/*
+ * The result of spvc_compiler_compile for the job, and the source if it succeeded. *source is owned by the job.
+ * Can be called from the callback, or once the job is complete.
+ */
+SPVC_PUBLIC_API spvc_result spvc_job_get_result(spvc_job job, const char **source);
+
+/* The error of the job, if it failed, or an empty string. Same rules as spvc_job_get_result. */
+SPVC_PUBLIC_API const char *spvc_job_get_error_string(spvc_job job);
+
+/*
+ * Returns the compiler to the state it had when it was first compiled, so it can be compiled again,
+ * e.g. after installing different options. Maps to Compiler::reset_for_recompile.
+ * Options, the profile callback, the task runner and the compile budget are kept, as are decorations, names
+ * and the entry point set before the first compile. Backend specific remapping, such as resource bindings,
+ * has to be set again.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_reset(spvc_compiler compiler);
+
+/*
+ * Like spvc_compiler_reset, but resets the compiler to parsed_ir, which may be a later version of the module,
+ * e.g. from spvc_context_parse_spirv_incremental. Maps to Compiler::reset_for_hot_reload: what was derived from
+ * functions which did not change is reused, as long as the compiler is set up again exactly as before.
+ * parsed_ir is copied and has to be available. spvc_compiler_reset then resets to the state of the next compile.
+ * The compilation cache is disabled for the compiler afterwards.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_reset_for_hot_reload(spvc_compiler compiler, spvc_parsed_ir parsed_ir);
+
+/*
+ * Estimates the GPU resource costs of the compiled entry point. Maps to Compiler::get_resource_cost_report.
+ * Has to be called after compiling. While spvc_compiler_compile_all_entry_points calls output,
+ * reports the entry point passed to it. The helper function names are owned by the context.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_get_resource_cost_report(spvc_compiler compiler,
+                                                                   spvc_resource_cost_report *report);
+
+/*
+ * Limits how long each compile may run, in wall clock seconds and in units of work, which are roughly
+ * instructions analyzed and emitted. 0 means no limit. Maps to Compiler::set_compile_budget.
+ * When the budget runs out, or the compiler is cancelled, compiling fails with SPVC_ERROR_CANCELLED,
+ * and the compiler has to be reset with spvc_compiler_reset before it can compile again.
+ */
+SPVC_PUBLIC_API void spvc_compiler_set_compile_budget(spvc_compiler compiler, double max_seconds,
+                                                      unsigned long long max_work);
+
+/*
+ * While cancelled is set, compiling fails with SPVC_ERROR_CANCELLED, including a compile which is already running.
+ * Unlike every other function, this can be called from another thread while the compiler is in use.
+ */
+SPVC_PUBLIC_API void spvc_compiler_set_cancelled(spvc_compiler compiler, spvc_bool cancelled);
+
+/*
+ * Memory held by the compiler's IR and output. Maps to Compiler::get_memory_statistics.
+ * Can be called before and after compiling.
+ */
+SPVC_PUBLIC_API void spvc_compiler_get_memory_statistics(spvc_compiler compiler, spvc_memory_statistics *stats);
+
+/*
+ * Resources indexed out of a descriptor heap by the last compile. Maps to Compiler::get_descriptor_heap_slots.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_get_descriptor_heap_slots(spvc_compiler compiler,
+                                                                    const spvc_descriptor_heap_slot **slots,
+                                                                    size_t *num_slots);
+
+/*
+ * Lookup tables the last compile declared as buffers. Maps to Compiler::get_lowered_luts.
+ * The data of each table is owned by the compiler, and is valid until it compiles again.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_get_lowered_luts(spvc_compiler compiler, const spvc_lowered_lut **luts,
+                                                           size_t *num_luts);
+
+/*
+ * Get notified as each pass of spvc_compiler_compile completes. Maps to Compiler::set_profile_callback.
+ * The profile, including its name, is only valid during the callback. Pass NULL to disable profiling.
+ */
+typedef void (*spvc_profile_callback)(void *userdata, const spvc_pass_profile *profile);
+SPVC_PUBLIC_API void spvc_compiler_set_profile_callback(spvc_compiler compiler, spvc_profile_callback cb,
+                                                        void *userdata);
+
 /* Maps to C++ API. */
 SPVC_PUBLIC_API spvc_result spvc_compiler_add_header_line(spvc_compiler compiler, const char *line);
 SPVC_PUBLIC_API spvc_result spvc_compiler_require_extension(spvc_compiler compiler, const char *ext);
@@ -794,6 +1164,15 @@ SPVC_PUBLIC_API spvc_result spvc_compiler_mask_stage_output_by_location(spvc_com
                                                                         unsigned location, unsigned component);
 SPVC_PUBLIC_API spvc_result spvc_compiler_mask_stage_output_by_builtin(spvc_compiler compiler, SpvBuiltIn builtin);
 
+/*
+ * Links the stage outputs of compiler to the stage inputs of downstream, the next stage in the pipeline.
+ * Outputs which downstream does not read are masked, and with pack_locations, the linked varyings
+ * of both stages are moved to the lowest locations.
+ * Both compilers must be set up for the entry points they will compile.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_link_stage_outputs(spvc_compiler compiler, spvc_compiler downstream,
+                                                             spvc_bool pack_locations);
+
 /*
  * HLSL specifics.
  * Maps to C++ API.
@@ -811,11 +1190,24 @@ SPVC_PUBLIC_API spvc_result spvc_compiler_hlsl_set_resource_binding_flags(spvc_c
 
 SPVC_PUBLIC_API spvc_result spvc_compiler_hlsl_add_resource_binding(spvc_compiler compiler,
                                                                     const spvc_hlsl_resource_binding *binding);
+/* Same as calling spvc_compiler_hlsl_add_resource_binding() for each of the count bindings. */
+SPVC_PUBLIC_API spvc_result spvc_compiler_hlsl_add_resource_bindings(spvc_compiler compiler,
+                                                                     const spvc_hlsl_resource_binding *bindings,
+                                                                     size_t count);
 SPVC_PUBLIC_API spvc_bool spvc_compiler_hlsl_is_resource_used(spvc_compiler compiler,
                                                               SpvExecutionModel model,
                                                               unsigned set,
                                                               unsigned binding);
 
+/*
+ * Cbuffers promoted to root constants by SPVC_COMPILER_OPTION_HLSL_ROOT_CONSTANT_PROMOTION_DWORD_BUDGET.
+ * Only valid after compiling. The results are owned by the context.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_hlsl_get_promoted_root_constants(
+    spvc_compiler compiler, const spvc_hlsl_promoted_root_constants **root_constants, size_t *num_root_constants);
+SPVC_PUBLIC_API spvc_result spvc_compiler_hlsl_get_promoted_root_constants_root_signature(spvc_compiler compiler,
+                                                                                          const char **signature);
+
 /*
  * MSL specifics.
  * Maps to C++ API.
@@ -834,16 +1226,29 @@ SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_vertex_attribute(spvc_compiler
                                                                    const spvc_msl_vertex_attribute *attrs);
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_resource_binding(spvc_compiler compiler,
                                                                    const spvc_msl_resource_binding *binding);
+/* Same as calling spvc_compiler_msl_add_resource_binding() for each of the count elements. */
+SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_resource_bindings(spvc_compiler compiler,
+                                                                    const spvc_msl_resource_binding *bindings,
+                                                                    size_t count);
 /* Deprecated; use spvc_compiler_msl_add_shader_input_2(). */
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_shader_input(spvc_compiler compiler,
                                                                const spvc_msl_shader_interface_var *input);
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_shader_input_2(spvc_compiler compiler,
                                                                  const spvc_msl_shader_interface_var_2 *input);
+/* Same as calling spvc_compiler_msl_add_shader_input_2() for each of the count elements.
+ * Vertex attributes are shader inputs of vertex shaders. */
+SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_shader_inputs_2(spvc_compiler compiler,
+                                                                  const spvc_msl_shader_interface_var_2 *inputs,
+                                                                  size_t count);
 /* Deprecated; use spvc_compiler_msl_add_shader_output_2(). */
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_shader_output(spvc_compiler compiler,
                                                                 const spvc_msl_shader_interface_var *output);
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_shader_output_2(spvc_compiler compiler,
                                                                   const spvc_msl_shader_interface_var_2 *output);
+/* Same as calling spvc_compiler_msl_add_shader_output_2() for each of the count elements. */
+SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_shader_outputs_2(spvc_compiler compiler,
+                                                                   const spvc_msl_shader_interface_var_2 *outputs,
+                                                                   size_t count);
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_discrete_descriptor_set(spvc_compiler compiler, unsigned desc_set);
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_set_argument_buffer_device_address_space(spvc_compiler compiler, unsigned desc_set, spvc_bool device_address);
 
@@ -865,6 +1270,16 @@ SPVC_PUBLIC_API spvc_result spvc_compiler_msl_set_fragment_output_components(spv
 SPVC_PUBLIC_API unsigned spvc_compiler_msl_get_automatic_resource_binding(spvc_compiler compiler, spvc_variable_id id);
 SPVC_PUBLIC_API unsigned spvc_compiler_msl_get_automatic_resource_binding_secondary(spvc_compiler compiler, spvc_variable_id id);
 
+/* Returns SPVC_ERROR_INVALID_ARGUMENT if desc_set is not a Tier 2 argument buffer. */
+SPVC_PUBLIC_API spvc_result spvc_compiler_msl_get_argument_buffer_layout(spvc_compiler compiler, unsigned desc_set,
+                                                                         const spvc_msl_argument_buffer_member **members,
+                                                                         size_t *num_members, unsigned *size);
+
+/* Returns SPVC_ERROR_INVALID_ARGUMENT if the stage does not read or write that data through a buffer. */
+SPVC_PUBLIC_API spvc_result spvc_compiler_msl_get_tessellation_buffer_layout(
+    spvc_compiler compiler, SpvStorageClass storage, spvc_bool patch,
+    const spvc_msl_tessellation_buffer_member **members, size_t *num_members, unsigned *stride);
+
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_dynamic_buffer(spvc_compiler compiler, unsigned desc_set, unsigned binding, unsigned index);
 
 SPVC_PUBLIC_API spvc_result spvc_compiler_msl_add_inline_uniform_block(spvc_compiler compiler, unsigned desc_set, unsigned binding);
@@ -885,11 +1300,27 @@ SPVC_PUBLIC_API spvc_result spvc_compiler_create_shader_resources_for_active_var
 SPVC_PUBLIC_API spvc_result spvc_resources_get_resource_list_for_type(spvc_resources resources, spvc_resource_type type,
                                                                       const spvc_reflected_resource **resource_list,
                                                                       size_t *resource_size);
+/*
+ * Copies the list into caller-provided memory instead.
+ * *resource_size is the capacity of resource_list on input, and is always set to the number of resources.
+ * If resource_list is NULL, only the count is returned.
+ * If the resources do not fit, nothing is copied and SPVC_ERROR_INVALID_ARGUMENT is returned.
+ * Names still point into memory owned by resources.
+ */
+SPVC_PUBLIC_API spvc_result spvc_resources_copy_resource_list_for_type(spvc_resources resources,
+                                                                       spvc_resource_type type,
+                                                                       spvc_reflected_resource *resource_list,
+                                                                       size_t *resource_size);
 
 SPVC_PUBLIC_API spvc_result spvc_resources_get_builtin_resource_list_for_type(
 		spvc_resources resources, spvc_builtin_resource_type type,
 		const spvc_reflected_builtin_resource **resource_list,
 		size_t *resource_size);
+/* Same as spvc_resources_copy_resource_list_for_type(), for builtin resources. */
+SPVC_PUBLIC_API spvc_result spvc_resources_copy_builtin_resource_list_for_type(
+		spvc_resources resources, spvc_builtin_resource_type type,
+		spvc_reflected_builtin_resource *resource_list,
+		size_t *resource_size);
 
 /*
  * Decorations.
@@ -916,6 +1347,9 @@ SPVC_PUBLIC_API spvc_bool spvc_compiler_has_member_decoration(spvc_compiler comp
                                                               unsigned member_index, SpvDecoration decoration);
 SPVC_PUBLIC_API const char *spvc_compiler_get_name(spvc_compiler compiler, SpvId id);
 SPVC_PUBLIC_API unsigned spvc_compiler_get_decoration(spvc_compiler compiler, SpvId id, SpvDecoration decoration);
+/* Writes the decoration of each of the count ids to values, which must have room for count elements. */
+SPVC_PUBLIC_API void spvc_compiler_get_decorations(spvc_compiler compiler, const SpvId *ids, size_t count,
+                                                   SpvDecoration decoration, unsigned *values);
 SPVC_PUBLIC_API const char *spvc_compiler_get_decoration_string(spvc_compiler compiler, SpvId id,
                                                                 SpvDecoration decoration);
 SPVC_PUBLIC_API unsigned spvc_compiler_get_member_decoration(spvc_compiler compiler, spvc_type_id id,
@@ -1024,6 +1458,15 @@ SPVC_PUBLIC_API spvc_constant_id spvc_compiler_get_work_group_size_specializatio
                                                                                             spvc_specialization_constant *y,
                                                                                             spvc_specialization_constant *z);
 
+/*
+ * Supplies the final value of a specialization constant, like a VkSpecializationMapEntry does.
+ * size is 1, 2, 4 or 8 bytes. Compiled source no longer depends on the specialization constant.
+ * Maps to C++ API.
+ */
+SPVC_PUBLIC_API spvc_result spvc_compiler_set_specialization_constant_value(spvc_compiler compiler,
+                                                                            unsigned constant_id,
+                                                                            const void *data, size_t size);
+
 /*
  * Buffer ranges
  * Maps to C++ API.
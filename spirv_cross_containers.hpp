@@ -31,6 +31,7 @@
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <stack>
 #include <stddef.h>
 #include <stdint.h>
@@ -547,6 +548,84 @@ using VectorView = std::vector<T>;
 
 #endif // SPIRV_CROSS_FORCE_STL_TYPES
 
+// A bump allocator which can back the object pools of a ParsedIR.
+// Individual allocations are never freed; every chunk is returned at once when the arena is destroyed,
+// so a long-running process does not fragment its heap with short-lived slabs.
+// Chunks come from malloc() unless allocation callbacks are supplied.
+// Callbacks must return memory aligned to at least 16 bytes.
+class MemoryArena
+{
+public:
+	typedef void *(*AllocateCallback)(void *userdata, size_t size);
+	typedef void (*FreeCallback)(void *userdata, void *ptr);
+
+	explicit MemoryArena(AllocateCallback allocate_cb_ = nullptr, FreeCallback free_cb_ = nullptr,
+	                     void *userdata_ = nullptr, size_t chunk_size_ = 64 * 1024)
+	    : allocate_cb(allocate_cb_)
+	    , free_cb(free_cb_)
+	    , userdata(userdata_)
+	    , chunk_size(chunk_size_)
+	{
+	}
+
+	~MemoryArena()
+	{
+		for (auto *chunk : chunks)
+		{
+			if (allocate_cb)
+			{
+				if (free_cb)
+					free_cb(userdata, chunk);
+			}
+			else
+				::free(chunk);
+		}
+	}
+
+	MemoryArena(const MemoryArena &) = delete;
+	void operator=(const MemoryArena &) = delete;
+
+	// Copies of a ParsedIR share the arena, so allocation must be safe from multiple threads.
+	void *allocate(size_t size)
+	{
+		std::lock_guard<std::mutex> holder{ lock };
+
+		size = (size + Alignment - 1) & ~(Alignment - 1);
+		if (size > remaining)
+		{
+			size_t alloc_size = size > chunk_size ? size : chunk_size;
+			void *chunk = allocate_cb ? allocate_cb(userdata, alloc_size) : malloc(alloc_size);
+			if (!chunk)
+				return nullptr;
+
+			chunks.push_back(chunk);
+			current = static_cast<uint8_t *>(chunk);
+			remaining = alloc_size;
+		}
+
+		void *ret = current;
+		current += size;
+		remaining -= size;
+		return ret;
+	}
+
+private:
+	enum
+	{
+		Alignment = 16
+	};
+
+	AllocateCallback allocate_cb;
+	FreeCallback free_cb;
+	void *userdata;
+	size_t chunk_size;
+
+	std::mutex lock;
+	std::vector<void *> chunks;
+	uint8_t *current = nullptr;
+	size_t remaining = 0;
+};
+
 // An object pool which we use for allocating IVariant-derived objects.
 // We know we are going to allocate a bunch of objects of each type,
 // so amortize the mallocs.
@@ -555,12 +634,54 @@ class ObjectPoolBase
 public:
 	virtual ~ObjectPoolBase() = default;
 	virtual void deallocate_opaque(void *ptr) = 0;
+
+	// Slabs allocated after this call come from the arena instead of malloc().
+	void set_arena(std::shared_ptr<MemoryArena> arena_)
+	{
+		arena = std::move(arena_);
+	}
+
+	const std::shared_ptr<MemoryArena> &get_arena() const
+	{
+		return arena;
+	}
+
+	// Total number of objects allocated from the pool, for profiling.
+	uint64_t get_allocation_count() const
+	{
+		return allocation_count;
+	}
+
+	// Number of objects currently alive in the pool.
+	uint64_t get_live_count() const
+	{
+		return live_count;
+	}
+
+	// Bytes of slab storage taken by the pool, whether from malloc() or the arena.
+	size_t get_reserved_bytes() const
+	{
+		return reserved_bytes;
+	}
+
+	virtual size_t get_object_size() const = 0;
+
+protected:
+	std::shared_ptr<MemoryArena> arena;
+	uint64_t allocation_count = 0;
+	uint64_t live_count = 0;
+	size_t reserved_bytes = 0;
 };
 
+// Objects are carved out of geometrically growing slabs, so pointers stay stable for the lifetime of the pool.
+// Freed objects are threaded onto an intrusive free list stored in their own storage,
+// so the pool does not keep a separate pointer per object.
 template <typename T>
 class ObjectPool : public ObjectPoolBase
 {
 public:
+	static_assert(sizeof(T) >= sizeof(void *), "Object too small to hold a free list link.");
+
 	explicit ObjectPool(unsigned start_object_count_ = 16)
 	    : start_object_count(start_object_count_)
 	{
@@ -569,29 +690,46 @@ public:
 	template <typename... P>
 	T *allocate(P &&... p)
 	{
-		if (vacants.empty())
+		T *ptr;
+		if (free_list)
 		{
-			unsigned num_objects = start_object_count << memory.size();
-			T *ptr = static_cast<T *>(malloc(num_objects * sizeof(T)));
-			if (!ptr)
-				return nullptr;
-
-			for (unsigned i = 0; i < num_objects; i++)
-				vacants.push_back(&ptr[i]);
+			ptr = free_list;
+			memcpy(&free_list, static_cast<void *>(ptr), sizeof(free_list));
+		}
+		else
+		{
+			if (slab_used == slab_size)
+			{
+				unsigned num_objects = start_object_count << slab_count;
+				T *slab = static_cast<T *>(arena ? arena->allocate(num_objects * sizeof(T)) : malloc(num_objects * sizeof(T)));
+				if (!slab)
+					return nullptr;
+
+				// Arena memory is owned by the arena.
+				if (!arena)
+					memory.emplace_back(slab);
+				slab_count++;
+				reserved_bytes += num_objects * sizeof(T);
+				current_slab = slab;
+				slab_used = 0;
+				slab_size = num_objects;
+			}
 
-			memory.emplace_back(ptr);
+			ptr = current_slab + slab_used++;
 		}
 
-		T *ptr = vacants.back();
-		vacants.pop_back();
 		new (ptr) T(std::forward<P>(p)...);
+		allocation_count++;
+		live_count++;
 		return ptr;
 	}
 
 	void deallocate(T *ptr)
 	{
 		ptr->~T();
-		vacants.push_back(ptr);
+		live_count--;
+		memcpy(static_cast<void *>(ptr), &free_list, sizeof(free_list));
+		free_list = ptr;
 	}
 
 	void deallocate_opaque(void *ptr) override
@@ -599,14 +737,28 @@ public:
 		deallocate(static_cast<T *>(ptr));
 	}
 
+	size_t get_object_size() const override
+	{
+		return sizeof(T);
+	}
+
 	void clear()
 	{
-		vacants.clear();
+		live_count = 0;
+		reserved_bytes = 0;
+		free_list = nullptr;
+		current_slab = nullptr;
+		slab_used = 0;
+		slab_size = 0;
 		memory.clear();
+		slab_count = 0;
 	}
 
 protected:
-	Vector<T *> vacants;
+	T *free_list = nullptr;
+	T *current_slab = nullptr;
+	unsigned slab_used = 0;
+	unsigned slab_size = 0;
 
 	struct MallocDeleter
 	{
@@ -618,6 +770,7 @@ protected:
 
 	SmallVector<std::unique_ptr<T, MallocDeleter>> memory;
 	unsigned start_object_count;
+	unsigned slab_count = 0;
 };
 
 template <size_t StackSize = 4096, size_t BlockSize = 4096>
@@ -634,10 +787,34 @@ public:
 		reset();
 	}
 
-	// Disable copies and moves. Makes it easier to implement, and we don't need it.
+	// Disable copies. Makes it easier to implement, and we don't need it.
 	StringStream(const StringStream &) = delete;
 	void operator=(const StringStream &) = delete;
 
+	// Heap blocks change owner, anything in the stack buffer is copied.
+	StringStream &operator=(StringStream &&other) SPIRV_CROSS_NOEXCEPT
+	{
+		if (this == &other)
+			return *this;
+
+		reset();
+		memcpy(stack_buffer, other.stack_buffer, sizeof(stack_buffer));
+		saved_buffers = std::move(other.saved_buffers);
+		current_buffer = other.current_buffer;
+
+		for (auto &saved : saved_buffers)
+			if (saved.buffer == other.stack_buffer)
+				saved.buffer = stack_buffer;
+		if (current_buffer.buffer == other.stack_buffer)
+			current_buffer.buffer = stack_buffer;
+
+		other.saved_buffers.clear();
+		other.current_buffer.buffer = other.stack_buffer;
+		other.current_buffer.offset = 0;
+		other.current_buffer.size = sizeof(other.stack_buffer);
+		return *this;
+	}
+
 	template <typename T, typename std::enable_if<!std::is_floating_point<T>::value, int>::type = 0>
 	StringStream &operator<<(const T &t)
 	{
@@ -694,6 +871,58 @@ public:
 		return ret;
 	}
 
+	// Number of characters written since the last reset().
+	size_t size() const
+	{
+		size_t total = current_buffer.offset;
+		for (auto &saved : saved_buffers)
+			total += saved.offset;
+		return total;
+	}
+
+	// Number of heap blocks holding what was written, not counting the stack buffer.
+	size_t get_block_count() const
+	{
+		size_t count = current_buffer.buffer != stack_buffer ? 1 : 0;
+		for (auto &saved : saved_buffers)
+			if (saved.buffer != stack_buffer)
+				count++;
+		return count;
+	}
+
+	// Calls op(data, size) for each contiguous piece of what was written since the last reset(), in order.
+	template <typename Op>
+	void for_each_chunk(const Op &op) const
+	{
+		for (auto &saved : saved_buffers)
+			if (saved.offset)
+				op(saved.buffer, saved.offset);
+		if (current_buffer.offset)
+			op(current_buffer.buffer, current_buffer.offset);
+	}
+
+	// Returns everything written after the first offset characters.
+	std::string str(size_t offset) const
+	{
+		std::string ret;
+		ret.reserve(size() - offset);
+
+		auto append_from = [&](const Buffer &buf) {
+			if (offset >= buf.offset)
+			{
+				offset -= buf.offset;
+				return;
+			}
+			ret.insert(ret.end(), buf.buffer + offset, buf.buffer + buf.offset);
+			offset = 0;
+		};
+
+		for (auto &saved : saved_buffers)
+			append_from(saved);
+		append_from(current_buffer);
+		return ret;
+	}
+
 	void reset()
 	{
 		for (auto &saved : saved_buffers)
@@ -58,6 +58,7 @@ report_and_abort(const std::string &msg)
 }
 
 #define SPIRV_CROSS_THROW(x) report_and_abort(x)
+#define SPIRV_CROSS_CANCEL(x) report_and_abort(x)
 #else
 class CompilerError : public std::runtime_error
 {
@@ -68,6 +69,18 @@ public:
 	}
 };
 
+// Thrown by Compiler::compile() when it runs out of its CompileBudget or is cancelled.
+class CompilerCancelledError : public CompilerError
+{
+public:
+	explicit CompilerCancelledError(const std::string &str)
+	    : CompilerError(str)
+	{
+	}
+};
+
+#define SPIRV_CROSS_CANCEL(x) throw CompilerCancelledError(x)
+
 #ifdef SPIRV_CROSS_WEBMIN
 #ifdef SPIRV_CROSS_WEBMIN_DEVEL
 #define SPIRV_CROSS_THROW(x) throw CompilerError(x)
@@ -30,6 +30,133 @@ using namespace spv;
 
 namespace SPIRV_CROSS_NAMESPACE
 {
+uint32_t *SPIRVWords::mutable_data()
+{
+	if (is_borrowed())
+	{
+		owned = std::make_shared<std::vector<uint32_t>>(words, words + word_count);
+		words = owned->data();
+	}
+	else if (owned && owned.use_count() > 1)
+	{
+		shared_origin = owned;
+		owned = std::make_shared<std::vector<uint32_t>>(*shared_origin);
+		words = owned->data();
+	}
+	return owned ? owned->data() : nullptr;
+}
+
+void SPIRVWords::append(const uint32_t *words_, size_t word_count_)
+{
+	mutable_data();
+	if (!owned)
+		owned = std::make_shared<std::vector<uint32_t>>();
+	owned->insert(owned->end(), words_, words_ + word_count_);
+	words = owned->data();
+	word_count = owned->size();
+}
+
+bool find_spirv_function_ranges(const SPIRVWords &spirv, size_t &global_end, SmallVector<SPIRVFunctionRange> &ranges)
+{
+	ranges.clear();
+	global_end = spirv.size();
+	if (spirv.size() < 5)
+		return false;
+
+	size_t len = spirv.size();
+	size_t offset = 5;
+	bool in_function = false;
+
+	while (offset < len)
+	{
+		auto op = static_cast<Op>(spirv[offset] & 0xffff);
+		uint32_t count = (spirv[offset] >> 16) & 0xffff;
+		if (count == 0 || offset + count > len)
+			return false;
+
+		if (op == OpFunction)
+		{
+			if (in_function || count < 3)
+				return false;
+			if (ranges.empty())
+				global_end = offset;
+			ranges.push_back({ spirv[offset + 2], uint32_t(offset), 0 });
+			in_function = true;
+		}
+		else if (op == OpFunctionEnd)
+		{
+			if (!in_function)
+				return false;
+			ranges.back().end = uint32_t(offset + count);
+			in_function = false;
+		}
+		else if (!in_function && !ranges.empty())
+		{
+			// Debug instructions such as OpLine may appear between functions, but belong to neither,
+			// so nothing which splits a module by function could account for them.
+			return false;
+		}
+
+		offset += count;
+	}
+
+	return !in_function;
+}
+
+bool diff_spirv_modules(const SPIRVWords &previous, const SPIRVWords &current, SPIRVModuleDiff &diff)
+{
+	diff = {};
+	size_t previous_global_end, current_global_end;
+	SmallVector<SPIRVFunctionRange> previous_functions;
+	if (!find_spirv_function_ranges(previous, previous_global_end, previous_functions) ||
+	    !find_spirv_function_ranges(current, current_global_end, diff.functions))
+	{
+		diff.functions.clear();
+		return false;
+	}
+
+	// Word 3 is the ID bound, which changes with the number of IDs any function needs.
+	const auto words_match = [](const uint32_t *a, const uint32_t *b, size_t count) {
+		return equal(a, a + count, b);
+	};
+	if (previous_global_end != current_global_end || !words_match(previous.data(), current.data(), 3) ||
+	    previous[4] != current[4] ||
+	    !words_match(previous.data() + 5, current.data() + 5, current_global_end - 5))
+	{
+		diff.functions.clear();
+		return false;
+	}
+
+	unordered_map<uint32_t, const SPIRVFunctionRange *> previous_by_id;
+	for (auto &range : previous_functions)
+		previous_by_id[range.id] = &range;
+
+	unordered_set<uint32_t> unchanged;
+	diff.previous_begin.reserve(diff.functions.size());
+	for (auto &range : diff.functions)
+	{
+		auto itr = previous_by_id.find(range.id);
+		uint32_t begin = 0;
+		if (itr != end(previous_by_id))
+		{
+			auto &prev = *itr->second;
+			if (prev.end - prev.begin == range.end - range.begin &&
+			    words_match(previous.data() + prev.begin, current.data() + range.begin, range.end - range.begin))
+			{
+				begin = prev.begin;
+				unchanged.insert(range.id);
+			}
+		}
+		diff.previous_begin.push_back(begin);
+	}
+
+	for (auto &range : previous_functions)
+		if (!unchanged.count(range.id))
+			diff.replaced.push_back(range);
+
+	return true;
+}
+
 ParsedIR::ParsedIR()
 {
 	// If we move ParsedIR, we need to make sure the pointer stays fixed since the child Variant objects consume a pointer to this group,
@@ -61,6 +188,8 @@ ParsedIR &ParsedIR::operator=(ParsedIR &&other) SPIRV_CROSS_NOEXCEPT
 {
 	if (this != &other)
 	{
+		// Existing IDs are owned by our current pools, so release them before replacing the pools.
+		ids.clear();
 		pool_group = std::move(other.pool_group);
 		spirv = std::move(other.spirv);
 		meta = std::move(other.meta);
@@ -77,6 +206,7 @@ ParsedIR &ParsedIR::operator=(ParsedIR &&other) SPIRV_CROSS_NOEXCEPT
 		addressing_model = other.addressing_model;
 		memory_model = other.memory_model;
 
+
 		default_entry_point = other.default_entry_point;
 		source = other.source;
 		loop_iteration_depth_hard = other.loop_iteration_depth_hard;
@@ -84,6 +214,7 @@ ParsedIR &ParsedIR::operator=(ParsedIR &&other) SPIRV_CROSS_NOEXCEPT
 
 		meta_needing_name_fixup = std::move(other.meta_needing_name_fixup);
 		load_type_width = std::move(other.load_type_width);
+		invalidate_type_layouts();
 	}
 	return *this;
 }
@@ -91,9 +222,57 @@ ParsedIR &ParsedIR::operator=(ParsedIR &&other) SPIRV_CROSS_NOEXCEPT
 ParsedIR::ParsedIR(const ParsedIR &other)
     : ParsedIR()
 {
+	set_memory_arena(other.get_memory_arena());
 	*this = other;
 }
 
+void ParsedIR::set_memory_arena(std::shared_ptr<MemoryArena> arena)
+{
+	for (auto &pool : pool_group->pools)
+		if (pool)
+			pool->set_arena(arena);
+}
+
+const std::shared_ptr<MemoryArena> &ParsedIR::get_memory_arena() const
+{
+	return pool_group->pools[TypeType]->get_arena();
+}
+
+uint64_t ParsedIR::get_allocation_count() const
+{
+	uint64_t count = 0;
+	for (auto &pool : pool_group->pools)
+		if (pool)
+			count += pool->get_allocation_count();
+	return count;
+}
+
+IRMemoryStatistics ParsedIR::get_memory_statistics() const
+{
+	IRMemoryStatistics stats;
+	for (int i = 0; i < TypeCount; i++)
+	{
+		auto &pool = pool_group->pools[i];
+		if (!pool)
+			continue;
+
+		stats.pools[i].live_objects = pool->get_live_count();
+		stats.pools[i].live_bytes = size_t(pool->get_live_count()) * pool->get_object_size();
+		stats.pools[i].reserved_bytes = pool->get_reserved_bytes();
+	}
+
+	stats.meta_count = meta.size();
+	stats.meta_bytes = meta.get_reserved_bytes();
+	stats.spirv_bytes = spirv.size() * sizeof(uint32_t);
+	stats.spirv_borrowed = spirv.is_borrowed();
+
+	for (auto &id : ids)
+		if (id.get_type() == TypeExpression)
+			stats.expression_string_bytes += variant_get<SPIRExpression>(id).expression.size();
+
+	return stats;
+}
+
 ParsedIR &ParsedIR::operator=(const ParsedIR &other)
 {
 	if (this != &other)
@@ -116,15 +295,19 @@ ParsedIR &ParsedIR::operator=(const ParsedIR &other)
 		addressing_model = other.addressing_model;
 		memory_model = other.memory_model;
 
-
 		meta_needing_name_fixup = other.meta_needing_name_fixup;
 		load_type_width = other.load_type_width;
+		invalidate_type_layouts();
 
 		// Very deliberate copying of IDs. There is no default copy constructor, nor a simple default constructor.
 		// Construct object first so we have the correct allocator set-up, then we can copy object into our new pool group.
-		ids.clear();
+		// IDs we already hold are copied into, which keeps their objects if the type matches.
+		if (ids.size() > other.ids.size())
+			ids.clear();
 		ids.reserve(other.ids.size());
-		for (size_t i = 0; i < other.ids.size(); i++)
+		for (size_t i = 0; i < ids.size(); i++)
+			ids[i] = other.ids[i];
+		for (size_t i = ids.size(); i < other.ids.size(); i++)
 		{
 			ids.emplace_back(pool_group.get());
 			ids.back() = other.ids[i];
@@ -135,11 +318,22 @@ ParsedIR &ParsedIR::operator=(const ParsedIR &other)
 
 void ParsedIR::set_id_bounds(uint32_t bounds)
 {
+	if (ids.size() > bounds)
+	{
+		// Variants cannot be default constructed, which resize() needs in case it grows.
+		SmallVector<Variant> kept;
+		kept.reserve(bounds);
+		for (uint32_t i = 0; i < bounds; i++)
+			kept.push_back(std::move(ids[i]));
+		ids = std::move(kept);
+	}
+
 	ids.reserve(bounds);
 	while (ids.size() < bounds)
 		ids.emplace_back(pool_group.get());
 
 	block_meta.resize(bounds);
+	meta.reserve(bounds);
 }
 
 // Roll our own versions of these functions to avoid potential locale shenanigans.
@@ -379,8 +573,27 @@ void ParsedIR::set_decoration_string(ID id, Decoration decoration, const string
 	}
 }
 
+static bool decoration_affects_layout(Decoration decoration)
+{
+	switch (decoration)
+	{
+	case DecorationOffset:
+	case DecorationArrayStride:
+	case DecorationMatrixStride:
+	case DecorationRowMajor:
+	case DecorationColMajor:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
 void ParsedIR::set_decoration(ID id, Decoration decoration, uint32_t argument)
 {
+	if (decoration_affects_layout(decoration))
+		invalidate_type_layouts();
+
 	auto &dec = meta[id].decoration;
 	dec.decoration_flags.set(decoration);
 
@@ -459,6 +672,9 @@ void ParsedIR::set_decoration(ID id, Decoration decoration, uint32_t argument)
 
 void ParsedIR::set_member_decoration(TypeID id, uint32_t index, Decoration decoration, uint32_t argument)
 {
+	if (decoration_affects_layout(decoration))
+		invalidate_type_layouts();
+
 	auto &m = meta[id];
 	m.members.resize(max(m.members.size(), size_t(index) + 1));
 	auto &dec = m.members[index];
@@ -673,6 +889,9 @@ const string &ParsedIR::get_decoration_string(ID id, Decoration decoration) cons
 
 void ParsedIR::unset_decoration(ID id, Decoration decoration)
 {
+	if (decoration_affects_layout(decoration))
+		invalidate_type_layouts();
+
 	auto &dec = meta[id].decoration;
 	dec.decoration_flags.clear(decoration);
 	switch (decoration)
@@ -845,6 +1064,9 @@ const string &ParsedIR::get_member_decoration_string(TypeID id, uint32_t index,
 
 void ParsedIR::unset_member_decoration(TypeID id, uint32_t index, Decoration decoration)
 {
+	if (decoration_affects_layout(decoration))
+		invalidate_type_layouts();
+
 	auto &m = meta[id];
 	if (index >= m.members.size())
 		return;
@@ -935,57 +1157,79 @@ void ParsedIR::add_typed_id(Types type, ID id)
 		return;
 	}
 
-	if (ids[id].empty() || ids[id].get_type() != type)
+	if (ids[id].empty())
 	{
-		switch (type)
-		{
-		case TypeConstant:
-			ids_for_constant_or_variable.push_back(id);
-			ids_for_constant_undef_or_type.push_back(id);
-			break;
+		append_typed_id(type, id);
+	}
+	else if (ids[id].get_type() != type)
+	{
+		remove_typed_id(ids[id].get_type(), id);
+		append_typed_id(type, id);
+	}
+}
 
-		case TypeVariable:
-			ids_for_constant_or_variable.push_back(id);
-			break;
+void ParsedIR::append_typed_id(Types type, ID id)
+{
+	switch (type)
+	{
+	case TypeConstant:
+		ids_for_constant_or_variable.push_back(id);
+		ids_for_constant_undef_or_type.push_back(id);
+		break;
 
-		case TypeType:
-		case TypeConstantOp:
-		case TypeUndef:
-			ids_for_constant_undef_or_type.push_back(id);
-			break;
+	case TypeVariable:
+		ids_for_constant_or_variable.push_back(id);
+		break;
 
-		default:
-			break;
-		}
-	}
+	case TypeType:
+	case TypeConstantOp:
+	case TypeUndef:
+		ids_for_constant_undef_or_type.push_back(id);
+		break;
 
-	if (ids[id].empty())
-	{
-		ids_for_type[type].push_back(id);
+	default:
+		break;
 	}
-	else if (ids[id].get_type() != type)
+
+	ids_for_type[type].push_back(id);
+}
+
+void ParsedIR::remove_ids(const SmallVector<ID> &removed)
+{
+	if (loop_iteration_depth_hard != 0 || loop_iteration_depth_soft != 0)
+		SPIRV_CROSS_THROW("Cannot remove IDs while looping over them.");
+
+	if (removed.empty())
+		return;
+
+	vector<bool> is_removed(ids.size());
+	for (auto id : removed)
 	{
-		remove_typed_id(ids[id].get_type(), id);
-		ids_for_type[type].push_back(id);
+		ids[id].reset();
+		is_removed[id] = true;
 	}
+
+	const auto prune = [&](SmallVector<ID> &list) {
+		list.erase(remove_if(begin(list), end(list), [&](ID id) { return is_removed[id]; }), end(list));
+	};
+
+	for (auto &list : ids_for_type)
+		prune(list);
+	prune(ids_for_constant_undef_or_type);
+	prune(ids_for_constant_or_variable);
+
+	// Struct sizes are cached by ID.
+	invalidate_type_layouts();
 }
 
 const Meta *ParsedIR::find_meta(ID id) const
 {
-	auto itr = meta.find(id);
-	if (itr != end(meta))
-		return &itr->second;
-	else
-		return nullptr;
+	return meta.maybe_get(id);
 }
 
 Meta *ParsedIR::find_meta(ID id)
 {
-	auto itr = meta.find(id);
-	if (itr != end(meta))
-		return &itr->second;
-	else
-		return nullptr;
+	return meta.maybe_get(id);
 }
 
 ParsedIR::LoopLock ParsedIR::create_loop_hard_lock() const
@@ -1078,4 +1322,359 @@ void ParsedIR::make_constant_null(uint32_t id, uint32_t type, bool add_to_typed_
 	}
 }
 
+static bool type_is_scalar(const SPIRType &type)
+{
+	return type.basetype != SPIRType::Struct && type.vecsize == 1 && type.columns == 1;
+}
+
+uint32_t ParsedIR::type_struct_member_offset(const SPIRType &type, uint32_t index) const
+{
+	auto *type_meta = find_meta(type.self);
+	if (type_meta)
+	{
+		// Decoration must be set in valid SPIR-V, otherwise throw.
+		auto &dec = type_meta->members[index];
+		if (dec.decoration_flags.get(DecorationOffset))
+			return dec.offset;
+		else
+			SPIRV_CROSS_THROW("Struct member does not have Offset set.");
+	}
+	else
+		SPIRV_CROSS_THROW("Struct member does not have Offset set.");
+}
+
+uint32_t ParsedIR::type_struct_member_array_stride(const SPIRType &type, uint32_t index) const
+{
+	auto *type_meta = find_meta(type.member_types[index]);
+	if (type_meta)
+	{
+		// Decoration must be set in valid SPIR-V, otherwise throw.
+		// ArrayStride is part of the array type not OpMemberDecorate.
+		auto &dec = type_meta->decoration;
+		if (dec.decoration_flags.get(DecorationArrayStride))
+			return dec.array_stride;
+		else
+			SPIRV_CROSS_THROW("Struct member does not have ArrayStride set.");
+	}
+	else
+		SPIRV_CROSS_THROW("Struct member does not have ArrayStride set.");
+}
+
+uint32_t ParsedIR::type_struct_member_matrix_stride(const SPIRType &type, uint32_t index) const
+{
+	auto *type_meta = find_meta(type.self);
+	if (type_meta)
+	{
+		// Decoration must be set in valid SPIR-V, otherwise throw.
+		// MatrixStride is part of OpMemberDecorate.
+		auto &dec = type_meta->members[index];
+		if (dec.decoration_flags.get(DecorationMatrixStride))
+			return dec.matrix_stride;
+		else
+			SPIRV_CROSS_THROW("Struct member does not have MatrixStride set.");
+	}
+	else
+		SPIRV_CROSS_THROW("Struct member does not have MatrixStride set.");
+}
+
+size_t ParsedIR::get_declared_struct_size(const SPIRType &type) const
+{
+	bool cacheable;
+	return get_declared_struct_size(type, cacheable);
+}
+
+size_t ParsedIR::get_declared_struct_size(const SPIRType &type, bool &cacheable) const
+{
+	if (type.member_types.empty())
+		SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
+
+	// Only the type owned by the IR can be cached, not a modified copy of it.
+	cacheable = maybe_get<SPIRType>(type.self) == &type;
+	if (cacheable)
+	{
+		std::lock_guard<std::mutex> holder{ struct_size_cache_lock };
+		if (struct_size_cache_version != type_layout_version)
+		{
+			struct_size_cache.clear();
+			struct_size_cache_version = type_layout_version;
+		}
+
+		auto itr = struct_size_cache.find(type.self);
+		if (itr != end(struct_size_cache) && itr->second.member_count == type.member_types.size())
+			return itr->second.size;
+	}
+
+	// Offsets can be declared out of order, so we need to deduce the actual size
+	// based on last member instead.
+	uint32_t member_index = 0;
+	size_t highest_offset = 0;
+	for (uint32_t i = 0; i < uint32_t(type.member_types.size()); i++)
+	{
+		size_t offset = type_struct_member_offset(type, i);
+		if (offset > highest_offset)
+		{
+			highest_offset = offset;
+			member_index = i;
+		}
+	}
+
+	bool member_cacheable;
+	size_t size = highest_offset + get_declared_struct_member_size(type, member_index, member_cacheable);
+
+	// Sizes which depend on specialization constants can change without the type changing.
+	cacheable = cacheable && member_cacheable;
+	if (cacheable)
+	{
+		std::lock_guard<std::mutex> holder{ struct_size_cache_lock };
+		if (struct_size_cache_version == type_layout_version)
+			struct_size_cache[type.self] = { size, type.member_types.size() };
+	}
+
+	return size;
+}
+
+size_t ParsedIR::get_declared_struct_size_runtime_array(const SPIRType &type, size_t array_size) const
+{
+	if (type.member_types.empty())
+		SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
+
+	size_t size = get_declared_struct_size(type);
+	auto &last_type = get<SPIRType>(type.member_types.back());
+	if (!last_type.array.empty() && last_type.array_size_literal[0] && last_type.array[0] == 0) // Runtime array
+		size += array_size * type_struct_member_array_stride(type, uint32_t(type.member_types.size() - 1));
+
+	return size;
+}
+
+uint32_t ParsedIR::evaluate_spec_constant_u32(const SPIRConstantOp &spec) const
+{
+	auto &result_type = get<SPIRType>(spec.basetype);
+	if (result_type.basetype != SPIRType::UInt && result_type.basetype != SPIRType::Int &&
+	    result_type.basetype != SPIRType::Boolean)
+	{
+		SPIRV_CROSS_THROW(
+		    "Only 32-bit integers and booleans are currently supported when evaluating specialization constants.\n");
+	}
+
+	if (!type_is_scalar(result_type))
+		SPIRV_CROSS_THROW("Spec constant evaluation must be a scalar.\n");
+
+	uint32_t value = 0;
+
+	const auto eval_u32 = [&](uint32_t id) -> uint32_t {
+		auto *c = maybe_get<SPIRConstant>(id);
+		auto &type = get<SPIRType>(c ? c->constant_type : get<SPIRConstantOp>(id).basetype);
+		if (type.basetype != SPIRType::UInt && type.basetype != SPIRType::Int && type.basetype != SPIRType::Boolean)
+		{
+			SPIRV_CROSS_THROW("Only 32-bit integers and booleans are currently supported when evaluating "
+			                  "specialization constants.\n");
+		}
+
+		if (!type_is_scalar(type))
+			SPIRV_CROSS_THROW("Spec constant evaluation must be a scalar.\n");
+		if (c)
+			return c->scalar();
+		else
+			return evaluate_spec_constant_u32(get<SPIRConstantOp>(id));
+	};
+
+#define binary_spec_op(op, binary_op)                                              \
+	case Op##op:                                                                   \
+		value = eval_u32(spec.arguments[0]) binary_op eval_u32(spec.arguments[1]); \
+		break
+#define binary_spec_op_cast(op, binary_op, type)                                                         \
+	case Op##op:                                                                                         \
+		value = uint32_t(type(eval_u32(spec.arguments[0])) binary_op type(eval_u32(spec.arguments[1]))); \
+		break
+
+	// Support the basic opcodes which are typically used when computing array sizes.
+	switch (spec.opcode)
+	{
+		binary_spec_op(IAdd, +);
+		binary_spec_op(ISub, -);
+		binary_spec_op(IMul, *);
+		binary_spec_op(BitwiseAnd, &);
+		binary_spec_op(BitwiseOr, |);
+		binary_spec_op(BitwiseXor, ^);
+		binary_spec_op(LogicalAnd, &);
+		binary_spec_op(LogicalOr, |);
+		binary_spec_op(ShiftLeftLogical, <<);
+		binary_spec_op(ShiftRightLogical, >>);
+		binary_spec_op_cast(ShiftRightArithmetic, >>, int32_t);
+		binary_spec_op(LogicalEqual, ==);
+		binary_spec_op(LogicalNotEqual, !=);
+		binary_spec_op(IEqual, ==);
+		binary_spec_op(INotEqual, !=);
+		binary_spec_op(ULessThan, <);
+		binary_spec_op(ULessThanEqual, <=);
+		binary_spec_op(UGreaterThan, >);
+		binary_spec_op(UGreaterThanEqual, >=);
+		binary_spec_op_cast(SLessThan, <, int32_t);
+		binary_spec_op_cast(SLessThanEqual, <=, int32_t);
+		binary_spec_op_cast(SGreaterThan, >, int32_t);
+		binary_spec_op_cast(SGreaterThanEqual, >=, int32_t);
+#undef binary_spec_op
+#undef binary_spec_op_cast
+
+	case OpLogicalNot:
+		value = uint32_t(!eval_u32(spec.arguments[0]));
+		break;
+
+	case OpNot:
+		value = ~eval_u32(spec.arguments[0]);
+		break;
+
+	case OpSNegate:
+		value = uint32_t(-int32_t(eval_u32(spec.arguments[0])));
+		break;
+
+	case OpSelect:
+		value = eval_u32(spec.arguments[0]) ? eval_u32(spec.arguments[1]) : eval_u32(spec.arguments[2]);
+		break;
+
+	case OpUMod:
+	{
+		uint32_t a = eval_u32(spec.arguments[0]);
+		uint32_t b = eval_u32(spec.arguments[1]);
+		if (b == 0)
+			SPIRV_CROSS_THROW("Undefined behavior in UMod, b == 0.\n");
+		value = a % b;
+		break;
+	}
+
+	case OpSRem:
+	{
+		auto a = int32_t(eval_u32(spec.arguments[0]));
+		auto b = int32_t(eval_u32(spec.arguments[1]));
+		if (b == 0)
+			SPIRV_CROSS_THROW("Undefined behavior in SRem, b == 0.\n");
+		value = a % b;
+		break;
+	}
+
+	case OpSMod:
+	{
+		auto a = int32_t(eval_u32(spec.arguments[0]));
+		auto b = int32_t(eval_u32(spec.arguments[1]));
+		if (b == 0)
+			SPIRV_CROSS_THROW("Undefined behavior in SMod, b == 0.\n");
+		auto v = a % b;
+
+		// Makes sure we match the sign of b, not a.
+		if ((b < 0 && v > 0) || (b > 0 && v < 0))
+			v += b;
+		value = v;
+		break;
+	}
+
+	case OpUDiv:
+	{
+		uint32_t a = eval_u32(spec.arguments[0]);
+		uint32_t b = eval_u32(spec.arguments[1]);
+		if (b == 0)
+			SPIRV_CROSS_THROW("Undefined behavior in UDiv, b == 0.\n");
+		value = a / b;
+		break;
+	}
+
+	case OpSDiv:
+	{
+		auto a = int32_t(eval_u32(spec.arguments[0]));
+		auto b = int32_t(eval_u32(spec.arguments[1]));
+		if (b == 0)
+			SPIRV_CROSS_THROW("Undefined behavior in SDiv, b == 0.\n");
+		value = a / b;
+		break;
+	}
+
+	default:
+		SPIRV_CROSS_THROW("Unsupported spec constant opcode for evaluation.\n");
+	}
+
+	return value;
+}
+
+uint32_t ParsedIR::evaluate_constant_u32(uint32_t id) const
+{
+	if (const auto *c = maybe_get<SPIRConstant>(id))
+		return c->scalar();
+	else
+		return evaluate_spec_constant_u32(get<SPIRConstantOp>(id));
+}
+
+size_t ParsedIR::get_declared_struct_member_size(const SPIRType &struct_type, uint32_t index) const
+{
+	bool cacheable;
+	return get_declared_struct_member_size(struct_type, index, cacheable);
+}
+
+size_t ParsedIR::get_declared_struct_member_size(const SPIRType &struct_type, uint32_t index, bool &cacheable) const
+{
+	cacheable = true;
+	if (struct_type.member_types.empty())
+		SPIRV_CROSS_THROW("Declared struct in block cannot be empty.");
+
+	auto &flags = get_member_decoration_bitset(struct_type.self, index);
+	auto &type = get<SPIRType>(struct_type.member_types[index]);
+
+	switch (type.basetype)
+	{
+	case SPIRType::Unknown:
+	case SPIRType::Void:
+	case SPIRType::Boolean: // Bools are purely logical, and cannot be used for externally visible types.
+	case SPIRType::AtomicCounter:
+	case SPIRType::Image:
+	case SPIRType::SampledImage:
+	case SPIRType::Sampler:
+		SPIRV_CROSS_THROW("Querying size for object with opaque size.");
+
+	default:
+		break;
+	}
+
+	if (type.pointer && type.storage == StorageClassPhysicalStorageBuffer)
+	{
+		// Check if this is a top-level pointer type, and not an array of pointers.
+		if (type.pointer_depth > get<SPIRType>(type.parent_type).pointer_depth)
+			return 8;
+	}
+
+	if (!type.array.empty())
+	{
+		// For arrays, we can use ArrayStride to get an easy check.
+		bool array_size_literal = type.array_size_literal.back();
+		uint32_t array_size = array_size_literal ? type.array.back() : evaluate_constant_u32(type.array.back());
+		cacheable = array_size_literal;
+		return type_struct_member_array_stride(struct_type, index) * array_size;
+	}
+	else if (type.basetype == SPIRType::Struct)
+	{
+		return get_declared_struct_size(type, cacheable);
+	}
+	else
+	{
+		unsigned vecsize = type.vecsize;
+		unsigned columns = type.columns;
+
+		// Vectors.
+		if (columns == 1)
+		{
+			size_t component_size = type.width / 8;
+			return vecsize * component_size;
+		}
+		else
+		{
+			uint32_t matrix_stride = type_struct_member_matrix_stride(struct_type, index);
+
+			// Per SPIR-V spec, matrices must be tightly packed and aligned up for vec3 accesses.
+			if (flags.get(DecorationRowMajor))
+				return matrix_stride * vecsize;
+			else if (flags.get(DecorationColMajor))
+				return matrix_stride * columns;
+			else
+				SPIRV_CROSS_THROW("Either row-major or column-major must be declared for matrices.");
+		}
+	}
+}
+
 } // namespace SPIRV_CROSS_NAMESPACE
@@ -25,12 +25,231 @@
 #define SPIRV_CROSS_PARSED_IR_HPP
 
 #include "spirv_common.hpp"
+#include <deque>
+#include <mutex>
 #include <stdint.h>
 #include <unordered_map>
 
 namespace SPIRV_CROSS_NAMESPACE
 {
 
+// Runs task(0) through task(count - 1) and returns once all of them have completed,
+// see Compiler::set_task_runner() and Parser::set_task_runner(). The tasks are independent and may run concurrently.
+// If a task throws, the runner must wait for the others and rethrow on the calling thread.
+using CompilerTaskRunner = std::function<void(uint32_t count, const std::function<void(uint32_t index)> &task)>;
+
+// Holds the raw SPIR-V words of a module.
+// Copies of a ParsedIR share the same words, since compilers only ever read them, with one exception:
+// anything which rewrites words in place must go through mutable_data(), which makes a private copy first
+// if the words are shared with another ParsedIR, or borrowed from the caller.
+class SPIRVWords
+{
+public:
+	SPIRVWords() = default;
+	SPIRVWords(const SPIRVWords &) = default;
+	SPIRVWords &operator=(const SPIRVWords &) = default;
+
+	SPIRVWords(SPIRVWords &&other) SPIRV_CROSS_NOEXCEPT
+	{
+		*this = std::move(other);
+	}
+
+	SPIRVWords &operator=(SPIRVWords &&other) SPIRV_CROSS_NOEXCEPT
+	{
+		if (this != &other)
+		{
+			words = other.words;
+			word_count = other.word_count;
+			owned = std::move(other.owned);
+			shared_origin = std::move(other.shared_origin);
+			other.words = nullptr;
+			other.word_count = 0;
+		}
+		return *this;
+	}
+
+	SPIRVWords &operator=(std::vector<uint32_t> words_)
+	{
+		owned = std::make_shared<std::vector<uint32_t>>(std::move(words_));
+		shared_origin.reset();
+		words = owned->data();
+		word_count = owned->size();
+		return *this;
+	}
+
+	// References caller-owned memory without copying it.
+	// The memory must outlive every ParsedIR (and Compiler) these words end up in.
+	void borrow(const uint32_t *words_, size_t word_count_)
+	{
+		owned.reset();
+		shared_origin.reset();
+		words = words_;
+		word_count = word_count_;
+	}
+
+	bool is_borrowed() const
+	{
+		return words && !owned;
+	}
+
+	const uint32_t *data() const
+	{
+		return words;
+	}
+
+	size_t size() const
+	{
+		return word_count;
+	}
+
+	bool empty() const
+	{
+		return word_count == 0;
+	}
+
+	const uint32_t &operator[](size_t index) const
+	{
+		return words[index];
+	}
+
+	const uint32_t *begin() const
+	{
+		return words;
+	}
+
+	const uint32_t *end() const
+	{
+		return words + word_count;
+	}
+
+	uint32_t *mutable_data();
+
+	// Appends words to a private copy.
+	// Pointers obtained through data() before appending are invalidated.
+	void append(const uint32_t *words_, size_t word_count_);
+
+private:
+	const uint32_t *words = nullptr;
+	size_t word_count = 0;
+	std::shared_ptr<std::vector<uint32_t>> owned;
+
+	// After making a private copy, keep the shared words alive for as long as we are,
+	// so pointers obtained through data() before the copy remain valid.
+	std::shared_ptr<std::vector<uint32_t>> shared_origin;
+};
+
+// Where a function is defined in a module, from its OpFunction up to and including its OpFunctionEnd, in words.
+struct SPIRVFunctionRange
+{
+	FunctionID id;
+	uint32_t begin;
+	uint32_t end;
+};
+
+// Finds where the global section, which is everything before the first OpFunction, ends,
+// and where each function is defined.
+// Returns false if anything appears between function definitions, even debug instructions,
+// or if the module ends in the middle of an instruction or function.
+bool find_spirv_function_ranges(const SPIRVWords &spirv, size_t &global_end, SmallVector<SPIRVFunctionRange> &ranges);
+
+// Compares two versions of a module function by function, e.g. to reuse what was parsed or compiled
+// from the previous version when a shader is hot reloaded.
+struct SPIRVModuleDiff
+{
+	// Functions of the current version, in module order.
+	SmallVector<SPIRVFunctionRange> functions;
+	// For each of functions, where the previous version defines it with exactly the same words, or 0 if it does not.
+	SmallVector<uint32_t> previous_begin;
+	// Functions of the previous version which the current version changes or no longer defines.
+	SmallVector<SPIRVFunctionRange> replaced;
+};
+
+// Functions are matched by ID. Everything outside function definitions must be identical in both versions,
+// apart from the ID bound in the header. Returns false otherwise, or if either version is not laid out
+// as find_spirv_function_ranges() expects, e.g. has debug instructions between functions.
+bool diff_spirv_modules(const SPIRVWords &previous, const SPIRVWords &current, SPIRVModuleDiff &diff);
+
+// Meta data for IDs, indexed directly by ID so lookups never need to hash.
+// Only IDs which have been given meta data own a Meta object,
+// and references to a Meta stay valid as more IDs are added.
+class MetaStorage
+{
+public:
+	// Creates empty meta data for the ID if it has none yet.
+	Meta &operator[](ID id)
+	{
+		if (id >= slots.size())
+			slots.resize(id + 1, 0);
+
+		auto &slot = slots[id];
+		if (!slot)
+		{
+			metas.emplace_back();
+			slot = uint32_t(metas.size());
+		}
+		return metas[slot - 1];
+	}
+
+	Meta *maybe_get(ID id)
+	{
+		return id < slots.size() && slots[id] ? &metas[slots[id] - 1] : nullptr;
+	}
+
+	const Meta *maybe_get(ID id) const
+	{
+		return id < slots.size() && slots[id] ? &metas[slots[id] - 1] : nullptr;
+	}
+
+	void reserve(size_t id_bound)
+	{
+		slots.reserve(id_bound);
+	}
+
+	// Number of IDs which own meta data.
+	size_t size() const
+	{
+		return metas.size();
+	}
+
+	// Bytes of the slot table and Meta objects, not counting what their strings and vectors point to.
+	size_t get_reserved_bytes() const
+	{
+		return slots.capacity() * sizeof(uint32_t) + metas.size() * sizeof(Meta);
+	}
+
+private:
+	// 0 means no meta data, otherwise the index into metas plus one.
+	std::vector<uint32_t> slots;
+	std::deque<Meta> metas;
+};
+
+// Where the memory of a ParsedIR goes, see ParsedIR::get_memory_statistics().
+struct IRMemoryStatistics
+{
+	struct Pool
+	{
+		// Objects currently alive, and the bytes they take inside the slabs.
+		uint64_t live_objects = 0;
+		size_t live_bytes = 0;
+		// Bytes of slabs the pool has taken, including freed and not yet used objects.
+		size_t reserved_bytes = 0;
+	};
+
+	// Indexed by Types.
+	Pool pools[TypeCount];
+
+	// IDs which own meta data, and the bytes of the meta table itself.
+	size_t meta_count = 0;
+	size_t meta_bytes = 0;
+
+	// Size of the raw SPIR-V. Borrowed words belong to the caller.
+	size_t spirv_bytes = 0;
+	bool spirv_borrowed = false;
+
+	// Characters held by the strings of all live SPIRExpressions.
+	size_t expression_string_bytes = 0;
+};
+
 // This data structure holds all information needed to perform cross-compilation and reflection.
 // It is the output of the Parser, but any implementation could create this structure.
 // It is intentionally very "open" and struct-like with some helper functions to deal with decorations.
@@ -46,6 +265,8 @@ public:
 	ParsedIR();
 
 	// Due to custom allocations from object pools, we cannot use a default copy constructor.
+	// Copying only reads from other, so many threads can copy the same ParsedIR concurrently,
+	// e.g. to compile one parsed module with several backends in parallel.
 	ParsedIR(const ParsedIR &other);
 	ParsedIR &operator=(const ParsedIR &other);
 
@@ -54,17 +275,30 @@ public:
 	ParsedIR(ParsedIR &&other) SPIRV_CROSS_NOEXCEPT;
 	ParsedIR &operator=(ParsedIR &&other) SPIRV_CROSS_NOEXCEPT;
 
-	// Resizes ids, meta and block_meta.
+	// Makes the object pools take their slabs from arena rather than malloc().
+	// Must be called before any IDs are created, e.g. on Parser::get_parsed_ir() before Parser::parse().
+	// Copies of this ParsedIR, such as the one held by a Compiler, share the same arena,
+	// which stays alive until every IR referencing it is destroyed.
+	void set_memory_arena(std::shared_ptr<MemoryArena> arena);
+	const std::shared_ptr<MemoryArena> &get_memory_arena() const;
+
+	// Number of objects allocated from the object pools so far.
+	uint64_t get_allocation_count() const;
+
+	// Takes a snapshot of the memory held by this IR. Cheap enough to call after every compile.
+	IRMemoryStatistics get_memory_statistics() const;
+
+	// Resizes ids, meta and block_meta. IDs past the new bound must not be in use.
 	void set_id_bounds(uint32_t bounds);
 
 	// The raw SPIR-V, instructions and opcodes refer to this by offset + count.
-	std::vector<uint32_t> spirv;
+	SPIRVWords spirv;
 
 	// Holds various data structures which inherit from IVariant.
 	SmallVector<Variant> ids;
 
 	// Various meta data for IDs, decorations, names, etc.
-	std::unordered_map<ID, Meta> meta;
+	MetaStorage meta;
 
 	// Holds all IDs which have a certain type.
 	// This is needed so we can iterate through a specific kind of resource quickly,
@@ -155,8 +389,36 @@ public:
 	Bitset get_buffer_block_flags(const SPIRVariable &var) const;
 	Bitset get_buffer_block_type_flags(const SPIRType &type) const;
 
+	// Layout queries which only depend on the module, shared by Compiler and ReflectionView.
+	// See the Compiler functions of the same name.
+	uint32_t type_struct_member_offset(const SPIRType &type, uint32_t index) const;
+	uint32_t type_struct_member_array_stride(const SPIRType &type, uint32_t index) const;
+	uint32_t type_struct_member_matrix_stride(const SPIRType &type, uint32_t index) const;
+	size_t get_declared_struct_size(const SPIRType &type) const;
+	size_t get_declared_struct_size_runtime_array(const SPIRType &type, size_t array_size) const;
+	size_t get_declared_struct_member_size(const SPIRType &struct_type, uint32_t index) const;
+	uint32_t evaluate_spec_constant_u32(const SPIRConstantOp &spec) const;
+	uint32_t evaluate_constant_u32(uint32_t id) const;
+
+	// Struct layouts are cached per type, and every layout cache is discarded when this version changes.
+	// Setting or unsetting a decoration which affects layout invalidates them,
+	// but code which modifies types in place must call invalidate_type_layouts() itself.
+	void invalidate_type_layouts()
+	{
+		type_layout_version++;
+	}
+
+	uint32_t get_type_layout_version() const
+	{
+		return type_layout_version;
+	}
+
 	void add_typed_id(Types type, ID id);
 	void remove_typed_id(Types type, ID id);
+	// Records an ID which was set to a new variant without add_typed_id(), as add_typed_id() would have.
+	void append_typed_id(Types type, ID id);
+	// Resets the IDs and drops them from every list of typed IDs. Nothing may refer to them afterwards.
+	void remove_ids(const SmallVector<ID> &removed);
 
 	class LoopLock
 	{
@@ -225,21 +487,43 @@ public:
 
 	void fixup_reserved_names();
 
+	// IDs with names which fixup_reserved_names() has yet to sanitize. Only for serializing IR.
+	const std::unordered_set<uint32_t> &get_ids_needing_name_fixup() const
+	{
+		return meta_needing_name_fixup;
+	}
+
+	void set_ids_needing_name_fixup(std::unordered_set<uint32_t> ids_)
+	{
+		meta_needing_name_fixup = std::move(ids_);
+	}
+
 	static void sanitize_underscores(std::string &str);
 	static void sanitize_identifier(std::string &str, bool member, bool allow_reserved_prefixes);
 	static bool is_globally_reserved_identifier(std::string &str, bool allow_reserved_prefixes);
 
 	uint32_t get_spirv_version() const;
 
-private:
 	template <typename T>
-	T &get(uint32_t id)
+	const T &get(uint32_t id) const
 	{
 		return variant_get<T>(ids[id]);
 	}
 
 	template <typename T>
-	const T &get(uint32_t id) const
+	const T *maybe_get(uint32_t id) const
+	{
+		if (id >= ids.size())
+			return nullptr;
+		else if (ids[id].get_type() == static_cast<Types>(T::type))
+			return &get<T>(id);
+		else
+			return nullptr;
+	}
+
+private:
+	template <typename T>
+	T &get(uint32_t id)
 	{
 		return variant_get<T>(ids[id]);
 	}
@@ -247,6 +531,21 @@ private:
 	mutable uint32_t loop_iteration_depth_hard = 0;
 	mutable uint32_t loop_iteration_depth_soft = 0;
 	std::string empty_string;
+
+	// Declared sizes of structs by type ID, valid for one type layout version.
+	// Const queries may run concurrently on a shared IR, so the cache has its own lock.
+	struct CachedStructSize
+	{
+		size_t size;
+		size_t member_count;
+	};
+	uint32_t type_layout_version = 0;
+	mutable std::mutex struct_size_cache_lock;
+	mutable std::unordered_map<uint32_t, CachedStructSize> struct_size_cache;
+	mutable uint32_t struct_size_cache_version = 0;
+
+	size_t get_declared_struct_size(const SPIRType &type, bool &cacheable) const;
+	size_t get_declared_struct_member_size(const SPIRType &struct_type, uint32_t index, bool &cacheable) const;
 	Bitset cleared_bitset;
 
 	std::unordered_set<uint32_t> meta_needing_name_fixup;
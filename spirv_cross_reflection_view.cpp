@@ -0,0 +1,130 @@
+/*
+ * Copyright 2019-2021 Hans-Kristian Arntzen
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * At your option, you may choose to accept this material under either:
+ *  1. The Apache License, Version 2.0, found at <http://www.apache.org/licenses/LICENSE-2.0>, or
+ *  2. The MIT License, found at <http://opensource.org/licenses/MIT>.
+ */
+
+#include "spirv_cross_reflection_view.hpp"
+#include <algorithm>
+
+using namespace std;
+using namespace spv;
+
+namespace SPIRV_CROSS_NAMESPACE
+{
+ReflectionView::ReflectionView(const ParsedIR &ir_)
+    : ir(ir_)
+    , entry_point(ir_.default_entry_point)
+{
+}
+
+void ReflectionView::set_entry_point(const std::string &name, ExecutionModel model)
+{
+	auto itr = find_if(begin(ir.entry_points), end(ir.entry_points),
+	                   [&](const std::pair<const uint32_t, SPIREntryPoint> &entry) -> bool {
+		                   return entry.second.orig_name == name && entry.second.model == model;
+	                   });
+
+	if (itr == end(ir.entry_points))
+		SPIRV_CROSS_THROW("Entry point does not exist.");
+
+	entry_point = itr->first;
+}
+
+const SPIREntryPoint &ReflectionView::get_entry_point() const
+{
+	auto itr = ir.entry_points.find(entry_point);
+	if (itr == end(ir.entry_points))
+		SPIRV_CROSS_THROW("Module has no entry point.");
+	return itr->second;
+}
+
+const Compiler::GlobalVariableIndex &ReflectionView::get_variable_index() const
+{
+	variable_index.build(ir);
+	return variable_index;
+}
+
+SmallVector<EntryPoint> ReflectionView::get_entry_points_and_stages() const
+{
+	SmallVector<EntryPoint> entries;
+	for (auto &entry : ir.entry_points)
+		entries.push_back({ entry.second.orig_name, entry.second.model });
+	return entries;
+}
+
+SmallVector<SpecializationConstant> ReflectionView::get_specialization_constants() const
+{
+	SmallVector<SpecializationConstant> spec_consts;
+	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, const SPIRConstant &c) {
+		if (c.specialization && ir.has_decoration(c.self, DecorationSpecId))
+			spec_consts.push_back({ c.self, ir.get_decoration(c.self, DecorationSpecId) });
+	});
+	return spec_consts;
+}
+
+std::string ReflectionView::get_block_name(const SPIRVariable &var, bool prefer_instance_name) const
+{
+	auto &name = ir.get_name(var.self);
+
+	if (prefer_instance_name)
+		return name.empty() ? join("_", var.self) : name;
+
+	auto &type = ir.get<SPIRType>(var.basetype);
+	auto *type_meta = ir.find_meta(type.self);
+	if (type_meta && !type_meta->decoration.alias.empty())
+		return type_meta->decoration.alias;
+
+	return name.empty() ? join("_", type.self, "_", var.self) : name;
+}
+
+unordered_set<VariableID> ReflectionView::get_active_interface_variables() const
+{
+	unordered_set<VariableID> variables;
+	Compiler::collect_active_interface_variables(ir, get_entry_point(), &get_variable_index(), variables, nullptr);
+	return variables;
+}
+
+ShaderResources ReflectionView::get_shader_resources() const
+{
+	return get_shader_resources(nullptr);
+}
+
+ShaderResources ReflectionView::get_shader_resources(const unordered_set<VariableID> &active_variables) const
+{
+	return get_shader_resources(&active_variables);
+}
+
+ShaderResources ReflectionView::get_shader_resources(const unordered_set<VariableID> *active_variables) const
+{
+	return Compiler::get_shader_resources(ir, get_entry_point(), &get_variable_index(), active_variables,
+	                                      [this](const SPIRVariable &var, bool prefer_instance_name) {
+		                                      return get_block_name(var, prefer_instance_name);
+	                                      });
+}
+
+SmallVector<BufferRange> ReflectionView::get_active_buffer_ranges(VariableID id) const
+{
+	SmallVector<BufferRange> ranges;
+	Compiler::BufferAccessHandler handler(ir, ranges, id);
+	Compiler::traverse_all_reachable_opcodes(ir, ir.get<SPIRFunction>(get_entry_point().self), handler);
+	return ranges;
+}
+} // namespace SPIRV_CROSS_NAMESPACE
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2019-2021 Hans-Kristian Arntzen
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * At your option, you may choose to accept this material under either:
+ *  1. The Apache License, Version 2.0, found at <http://www.apache.org/licenses/LICENSE-2.0>, or
+ *  2. The MIT License, found at <http://opensource.org/licenses/MIT>.
+ */
+
+#ifndef SPIRV_CROSS_REFLECTION_VIEW_HPP
+#define SPIRV_CROSS_REFLECTION_VIEW_HPP
+
+#include "spirv_cross.hpp"
+
+namespace SPIRV_CROSS_NAMESPACE
+{
+// Answers the common reflection queries directly from a ParsedIR.
+// Constructing a Compiler copies the IR and sets up state which is only needed for code generation,
+// which is wasted work if all that's needed is e.g. the resource bindings of a module.
+// Results match the queries of the same name on a freshly constructed Compiler.
+// The view only references the IR, which must outlive it and must not be modified while the view is in use.
+// Indices are built lazily on first use, so a view must not be shared between threads.
+class ReflectionView
+{
+public:
+	explicit ReflectionView(const ParsedIR &ir);
+
+	// Selects the entry point which interface and traversal queries apply to,
+	// see Compiler::set_entry_point(). Defaults to the default entry point of the module.
+	void set_entry_point(const std::string &name, spv::ExecutionModel model);
+
+	SmallVector<EntryPoint> get_entry_points_and_stages() const;
+	SmallVector<SpecializationConstant> get_specialization_constants() const;
+
+	std::unordered_set<VariableID> get_active_interface_variables() const;
+	ShaderResources get_shader_resources() const;
+	ShaderResources get_shader_resources(const std::unordered_set<VariableID> &active_variables) const;
+
+	SmallVector<BufferRange> get_active_buffer_ranges(VariableID id) const;
+
+private:
+	const ParsedIR &ir;
+	uint32_t entry_point = 0;
+
+	mutable Compiler::GlobalVariableIndex variable_index;
+	const Compiler::GlobalVariableIndex &get_variable_index() const;
+
+	const SPIREntryPoint &get_entry_point() const;
+	std::string get_block_name(const SPIRVariable &var, bool prefer_instance_name) const;
+	ShaderResources get_shader_resources(const std::unordered_set<VariableID> *active_variables) const;
+};
+} // namespace SPIRV_CROSS_NAMESPACE
+
+#endif
@@ -0,0 +1,799 @@
+/*
+ * Copyright 2019-2021 Hans-Kristian Arntzen
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * At your option, you may choose to accept this material under either:
+ *  1. The Apache License, Version 2.0, found at <http://www.apache.org/licenses/LICENSE-2.0>, or
+ *  2. The MIT License, found at <http://opensource.org/licenses/MIT>.
+ */
+
+#include "spirv_cross_serialized_ir.hpp"
+#include <algorithm>
+#include <string.h>
+
+using namespace std;
+using namespace spv;
+
+namespace SPIRV_CROSS_NAMESPACE
+{
+// 'SCIR' in host byte order, which also tells the endianness of the blob apart.
+static const uint32_t SerializedIRMagic = 0x52494353u;
+
+// Magic, version, SPIR-V word count and the size of the IR which follows the words.
+static const size_t SerializedIRHeaderSize = 4 * sizeof(uint32_t);
+
+// Both directions visit the IR through the same transfer() functions, so the layouts cannot drift apart.
+// The writer only reads from what it visits.
+class BlobWriter
+{
+public:
+	enum
+	{
+		reading = false
+	};
+
+	template <typename T>
+	void value(T &v)
+	{
+		append(&v, sizeof(T));
+	}
+
+	void value(bool &v)
+	{
+		uint8_t b = v ? 1 : 0;
+		append(&b, sizeof(b));
+	}
+
+	void string(std::string &s)
+	{
+		uint32_t count = uint32_t(s.size());
+		value(count);
+		append(s.data(), count);
+	}
+
+	template <typename Vec, typename Op>
+	void array(Vec &v, const Op &op)
+	{
+		uint32_t count = uint32_t(v.size());
+		value(count);
+		for (auto &elem : v)
+			op(elem);
+	}
+
+	template <typename T, size_t N>
+	void array(SmallVector<T, N> &v)
+	{
+		array(v, [this](T &elem) { value(elem); });
+	}
+
+	void bitset(Bitset &bits)
+	{
+		uint64_t lower = bits.get_lower();
+		value(lower);
+
+		SmallVector<uint32_t> higher;
+		bits.for_each_bit([&](uint32_t bit) {
+			if (bit >= 64)
+				higher.push_back(bit);
+		});
+		array(higher);
+	}
+
+	// Sorted by key, so the blob does not depend on the hash table layout.
+	template <typename Map>
+	void map(Map &m)
+	{
+		SmallVector<std::pair<uint32_t, uint32_t>> pairs;
+		pairs.reserve(m.size());
+		for (auto &elem : m)
+			pairs.push_back({ uint32_t(elem.first), uint32_t(elem.second) });
+		sort(begin(pairs), end(pairs));
+
+		array(pairs, [this](std::pair<uint32_t, uint32_t> &elem) {
+			value(elem.first);
+			value(elem.second);
+		});
+	}
+
+	void require(size_t) const
+	{
+	}
+
+	std::vector<uint8_t> data;
+
+private:
+	void append(const void *ptr, size_t size)
+	{
+		auto *bytes = static_cast<const uint8_t *>(ptr);
+		data.insert(data.end(), bytes, bytes + size);
+	}
+};
+
+class BlobReader
+{
+public:
+	enum
+	{
+		reading = true
+	};
+
+	BlobReader(const uint8_t *data_, size_t size_)
+	    : data(data_)
+	    , size(size_)
+	{
+	}
+
+	template <typename T>
+	void value(T &v)
+	{
+		read(&v, sizeof(T));
+	}
+
+	void value(bool &v)
+	{
+		uint8_t b;
+		read(&b, sizeof(b));
+		v = b != 0;
+	}
+
+	void string(std::string &s)
+	{
+		uint32_t count;
+		value(count);
+		require(count);
+		s.assign(reinterpret_cast<const char *>(data + offset), count);
+		offset += count;
+	}
+
+	template <typename Vec, typename Op>
+	void array(Vec &v, const Op &op)
+	{
+		uint32_t count;
+		value(count);
+		// Every element takes at least one byte, which bounds what a corrupt count can allocate.
+		require(count);
+		v.clear();
+		v.resize(count);
+		for (auto &elem : v)
+			op(elem);
+	}
+
+	template <typename T, size_t N>
+	void array(SmallVector<T, N> &v)
+	{
+		array(v, [this](T &elem) { value(elem); });
+	}
+
+	void bitset(Bitset &bits)
+	{
+		uint64_t lower;
+		value(lower);
+		bits = Bitset(lower);
+
+		SmallVector<uint32_t> higher;
+		array(higher);
+		for (auto bit : higher)
+			bits.set(bit);
+	}
+
+	template <typename Map>
+	void map(Map &m)
+	{
+		SmallVector<std::pair<uint32_t, uint32_t>> pairs;
+		array(pairs, [this](std::pair<uint32_t, uint32_t> &elem) {
+			value(elem.first);
+			value(elem.second);
+		});
+
+		m.clear();
+		for (auto &elem : pairs)
+			m[typename Map::key_type(elem.first)] = typename Map::mapped_type(elem.second);
+	}
+
+	size_t remaining() const
+	{
+		return size - offset;
+	}
+
+	void require(size_t count) const
+	{
+		if (count > remaining())
+			SPIRV_CROSS_THROW("Serialized IR is truncated.");
+	}
+
+private:
+	const uint8_t *data;
+	size_t size;
+	size_t offset = 0;
+
+	void read(void *ptr, size_t count)
+	{
+		require(count);
+		memcpy(ptr, data + offset, count);
+		offset += count;
+	}
+};
+
+template <typename Archive>
+static void transfer(Archive &ar, Instruction &instr)
+{
+	ar.value(instr.op);
+	ar.value(instr.length);
+	ar.value(instr.offset);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRUndef &undef)
+{
+	ar.value(undef.basetype);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRString &str)
+{
+	ar.string(str.str);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRCombinedImageSampler &combined)
+{
+	ar.value(combined.combined_type);
+	ar.value(combined.image);
+	ar.value(combined.sampler);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRConstantOp &op)
+{
+	ar.value(op.opcode);
+	ar.array(op.arguments);
+	ar.value(op.basetype);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRType &type)
+{
+	ar.value(type.basetype);
+	ar.value(type.width);
+	ar.value(type.vecsize);
+	ar.value(type.columns);
+	ar.array(type.array);
+	ar.array(type.array_size_literal);
+	ar.value(type.pointer_depth);
+	ar.value(type.pointer);
+	ar.value(type.forward_pointer);
+	ar.value(type.storage);
+	ar.array(type.member_types);
+	ar.array(type.member_type_index_redirection);
+	ar.value(type.image.type);
+	ar.value(type.image.dim);
+	ar.value(type.image.depth);
+	ar.value(type.image.arrayed);
+	ar.value(type.image.ms);
+	ar.value(type.image.sampled);
+	ar.value(type.image.format);
+	ar.value(type.image.access);
+	ar.value(type.type_alias);
+	ar.value(type.parent_type);
+	// member_name_cache only lives while a backend emits code.
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRExtension &ext)
+{
+	ar.value(ext.ext);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRExpression &expr)
+{
+	ar.value(expr.base_expression);
+	ar.string(expr.expression);
+	ar.value(expr.expression_type);
+	ar.value(expr.loaded_from);
+	ar.value(expr.immutable);
+	ar.value(expr.need_transpose);
+	ar.value(expr.access_chain);
+	ar.value(expr.access_meshlet_position_y);
+	ar.array(expr.expression_dependencies);
+	ar.array(expr.implied_read_expressions);
+	ar.value(expr.emitted_loop_level);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRFunctionPrototype &proto)
+{
+	ar.value(proto.return_type);
+	ar.array(proto.parameter_types);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRBlock &block)
+{
+	ar.value(block.terminator);
+	ar.value(block.merge);
+	ar.value(block.hint);
+	ar.value(block.next_block);
+	ar.value(block.merge_block);
+	ar.value(block.continue_block);
+	ar.value(block.return_value);
+	ar.value(block.condition);
+	ar.value(block.true_block);
+	ar.value(block.false_block);
+	ar.value(block.default_block);
+	for (auto &group : block.mesh.groups)
+		ar.value(group);
+	ar.value(block.mesh.payload);
+
+	ar.array(block.ops, [&](Instruction &instr) { transfer(ar, instr); });
+	ar.array(block.phi_variables, [&](SPIRBlock::Phi &phi) {
+		ar.value(phi.local_variable);
+		ar.value(phi.parent);
+		ar.value(phi.function_variable);
+	});
+
+	auto transfer_temporary = [&](std::pair<TypeID, ID> &temporary) {
+		ar.value(temporary.first);
+		ar.value(temporary.second);
+	};
+	ar.array(block.declare_temporary, transfer_temporary);
+	ar.array(block.potential_declare_temporary, transfer_temporary);
+
+	auto transfer_case = [&](SPIRBlock::Case &c) {
+		ar.value(c.value);
+		ar.value(c.block);
+	};
+	ar.array(block.cases_32bit, transfer_case);
+	ar.array(block.cases_64bit, transfer_case);
+
+	ar.value(block.disable_block_optimization);
+	ar.value(block.complex_continue);
+	ar.value(block.need_ladder_break);
+	ar.value(block.ignore_phi_from_block);
+	ar.value(block.loop_dominator);
+	ar.array(block.dominated_variables);
+	ar.array(block.loop_variables);
+	ar.array(block.invalidate_expressions);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRFunction &func)
+{
+	if (!Archive::reading && (!func.fixup_hooks_in.empty() || !func.fixup_hooks_out.empty()))
+		SPIRV_CROSS_THROW("Cannot serialize IR with fixup hooks, it has been modified by a compiler.");
+
+	auto transfer_parameter = [&](SPIRFunction::Parameter &param) {
+		ar.value(param.type);
+		ar.value(param.id);
+		ar.value(param.read_count);
+		ar.value(param.write_count);
+		ar.value(param.alias_global_variable);
+	};
+
+	ar.value(func.return_type);
+	ar.value(func.function_type);
+	ar.array(func.arguments, transfer_parameter);
+	ar.array(func.shadow_arguments, transfer_parameter);
+	ar.array(func.local_variables);
+	ar.value(func.entry_block);
+	ar.array(func.blocks);
+	ar.array(func.combined_parameters, [&](SPIRFunction::CombinedImageSamplerParameter &param) {
+		ar.value(param.id);
+		ar.value(param.image_id);
+		ar.value(param.sampler_id);
+		ar.value(param.global_image);
+		ar.value(param.global_sampler);
+		ar.value(param.depth);
+	});
+	ar.value(func.entry_line.file_id);
+	ar.value(func.entry_line.line_literal);
+	ar.array(func.constant_arrays_needed_on_stack);
+	ar.value(func.active);
+	ar.value(func.flush_undeclared);
+	ar.value(func.do_combined_parameters);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRAccessChain &chain)
+{
+	ar.value(chain.basetype);
+	ar.value(chain.storage);
+	ar.string(chain.base);
+	ar.string(chain.dynamic_index);
+	ar.value(chain.static_index);
+	ar.value(chain.loaded_from);
+	ar.value(chain.matrix_stride);
+	ar.value(chain.array_stride);
+	ar.value(chain.row_major_matrix);
+	ar.value(chain.immutable);
+	ar.array(chain.implied_read_expressions);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRVariable &var)
+{
+	if (!Archive::reading && var.parameter)
+		SPIRV_CROSS_THROW("Cannot serialize IR with variables bound to parameters, it has been modified by a compiler.");
+
+	ar.value(var.basetype);
+	ar.value(var.storage);
+	ar.value(var.decoration);
+	ar.value(var.initializer);
+	ar.value(var.basevariable);
+	ar.array(var.dereference_chain);
+	ar.value(var.compat_builtin);
+	ar.value(var.statically_assigned);
+	ar.value(var.static_expression);
+	ar.array(var.dependees);
+	ar.value(var.deferred_declaration);
+	ar.value(var.phi_variable);
+	ar.value(var.allocate_temporary_copy);
+	ar.value(var.remapped_variable);
+	ar.value(var.remapped_components);
+	ar.value(var.dominator);
+	ar.value(var.loop_variable);
+	ar.value(var.loop_variable_enable);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIRConstant &c)
+{
+	ar.value(c.constant_type);
+	for (auto &col : c.m.c)
+	{
+		for (auto &r : col.r)
+			ar.value(r);
+		for (auto &id : col.id)
+			ar.value(id);
+		ar.value(col.vecsize);
+	}
+	for (auto &id : c.m.id)
+		ar.value(id);
+	ar.value(c.m.columns);
+	ar.value(c.specialization);
+	ar.value(c.is_used_as_array_length);
+	ar.value(c.is_used_as_lut);
+	ar.array(c.subconstants);
+	ar.string(c.specialization_constant_macro_name);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, Meta::Decoration &dec)
+{
+	ar.string(dec.alias);
+	ar.string(dec.qualified_alias);
+	ar.string(dec.hlsl_semantic);
+	ar.string(dec.user_type);
+	ar.bitset(dec.decoration_flags);
+	ar.value(dec.builtin_type);
+	ar.value(dec.location);
+	ar.value(dec.component);
+	ar.value(dec.set);
+	ar.value(dec.binding);
+	ar.value(dec.offset);
+	ar.value(dec.xfb_buffer);
+	ar.value(dec.xfb_stride);
+	ar.value(dec.stream);
+	ar.value(dec.array_stride);
+	ar.value(dec.matrix_stride);
+	ar.value(dec.input_attachment);
+	ar.value(dec.spec_id);
+	ar.value(dec.index);
+	ar.value(dec.fp_rounding_mode);
+	ar.value(dec.builtin);
+	ar.bitset(dec.extended.flags);
+	for (auto &v : dec.extended.values)
+		ar.value(v);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, Meta &meta)
+{
+	transfer(ar, meta.decoration);
+	ar.array(meta.members, [&](Meta::Decoration &dec) { transfer(ar, dec); });
+	ar.map(meta.decoration_word_offset);
+	ar.value(meta.hlsl_is_magic_counter_buffer);
+	ar.value(meta.hlsl_magic_counter_buffer);
+}
+
+template <typename Archive>
+static void transfer(Archive &ar, SPIREntryPoint &entry)
+{
+	ar.value(entry.self);
+	ar.string(entry.name);
+	ar.string(entry.orig_name);
+	ar.array(entry.interface_variables);
+	ar.bitset(entry.flags);
+	ar.value(entry.workgroup_size.x);
+	ar.value(entry.workgroup_size.y);
+	ar.value(entry.workgroup_size.z);
+	ar.value(entry.workgroup_size.id_x);
+	ar.value(entry.workgroup_size.id_y);
+	ar.value(entry.workgroup_size.id_z);
+	ar.value(entry.workgroup_size.constant);
+	ar.value(entry.invocations);
+	ar.value(entry.output_vertices);
+	ar.value(entry.output_primitives);
+	ar.value(entry.model);
+	ar.value(entry.geometry_passthrough);
+}
+
+// The writer visits existing objects, the reader allocates them first.
+// Constructor arguments only have to be valid, every member is overwritten.
+template <typename T, typename Archive, typename... P>
+static void transfer_variant(Archive &ar, Variant &var, P &&... args)
+{
+	T *obj = Archive::reading ? &variant_set<T>(var, std::forward<P>(args)...) : &variant_get<T>(var);
+	// Not always the ID, forward pointer types take the ID of their pointee.
+	ar.value(obj->self);
+	transfer(ar, *obj);
+}
+
+template <typename Archive>
+static void transfer_variant(Archive &ar, Variant &var)
+{
+	Types type = var.get_type();
+	ar.value(type);
+
+	switch (type)
+	{
+	case TypeNone:
+		break;
+	case TypeType:
+		transfer_variant<SPIRType>(ar, var);
+		break;
+	case TypeVariable:
+		transfer_variant<SPIRVariable>(ar, var);
+		break;
+	case TypeConstant:
+		transfer_variant<SPIRConstant>(ar, var);
+		break;
+	case TypeFunction:
+		transfer_variant<SPIRFunction>(ar, var, TypeID(0), TypeID(0));
+		break;
+	case TypeFunctionPrototype:
+		transfer_variant<SPIRFunctionPrototype>(ar, var, TypeID(0));
+		break;
+	case TypeBlock:
+		transfer_variant<SPIRBlock>(ar, var);
+		break;
+	case TypeExtension:
+		transfer_variant<SPIRExtension>(ar, var, SPIRExtension::Unsupported);
+		break;
+	case TypeExpression:
+		transfer_variant<SPIRExpression>(ar, var, std::string(), TypeID(0), false);
+		break;
+	case TypeConstantOp:
+		transfer_variant<SPIRConstantOp>(ar, var, TypeID(0), OpNop, nullptr, 0u);
+		break;
+	case TypeCombinedImageSampler:
+		transfer_variant<SPIRCombinedImageSampler>(ar, var, TypeID(0), VariableID(0), VariableID(0));
+		break;
+	case TypeAccessChain:
+		transfer_variant<SPIRAccessChain>(ar, var, TypeID(0), StorageClassGeneric, std::string(), std::string(), 0);
+		break;
+	case TypeUndef:
+		transfer_variant<SPIRUndef>(ar, var, TypeID(0));
+		break;
+	case TypeString:
+		transfer_variant<SPIRString>(ar, var, std::string());
+		break;
+	default:
+		SPIRV_CROSS_THROW("Serialized IR contains an invalid ID type.");
+	}
+}
+
+// Parser inserts entry points in the order of their OpEntryPoint instructions.
+// Writing them in that order makes iterating entry_points after loading visit them in the same order as after parsing.
+static SmallVector<FunctionID> get_entry_point_order(const ParsedIR &ir)
+{
+	SmallVector<FunctionID> order;
+	size_t offset = 5;
+	while (offset < ir.spirv.size())
+	{
+		uint32_t word = ir.spirv[offset];
+		uint32_t count = word >> 16;
+		if (count == 0 || offset + count > ir.spirv.size())
+			break;
+		if ((word & 0xffff) == OpEntryPoint && count > 2)
+		{
+			FunctionID func = ir.spirv[offset + 2];
+			if (ir.entry_points.count(func) && find(begin(order), end(order), func) == end(order))
+				order.push_back(func);
+		}
+		offset += count;
+	}
+
+	// Entry points which were not parsed from the module go last, by ID.
+	SmallVector<FunctionID> remaining;
+	for (auto &entry : ir.entry_points)
+		if (find(begin(order), end(order), entry.first) == end(order))
+			remaining.push_back(entry.first);
+	sort(begin(remaining), end(remaining));
+	order.insert(end(order), begin(remaining), end(remaining));
+	return order;
+}
+
+template <typename Archive>
+static void transfer_ir(Archive &ar, ParsedIR &ir)
+{
+	uint32_t bound = uint32_t(ir.ids.size());
+	ar.value(bound);
+	if (Archive::reading)
+	{
+		ar.require(bound);
+		ir.set_id_bounds(bound);
+	}
+
+	for (auto &var : ir.ids)
+		transfer_variant(ar, var);
+
+	for (uint32_t id = 0; id < bound; id++)
+	{
+		const Meta *m = ir.find_meta(id);
+		bool has_meta = m != nullptr;
+		ar.value(has_meta);
+		if (!has_meta)
+			continue;
+
+		auto &meta = Archive::reading ? ir.meta[id] : *const_cast<Meta *>(m);
+		transfer(ar, meta);
+	}
+
+	// Names are only sanitized by the compiler, and may need it even though the current alias is valid,
+	// e.g. if a backend later restores the name of an entry point.
+	SmallVector<uint32_t> name_fixups;
+	if (!Archive::reading)
+	{
+		for (auto id : ir.get_ids_needing_name_fixup())
+			name_fixups.push_back(id);
+		sort(begin(name_fixups), end(name_fixups));
+	}
+	ar.array(name_fixups);
+	if (Archive::reading)
+		ir.set_ids_needing_name_fixup(std::unordered_set<uint32_t>(name_fixups.begin(), name_fixups.end()));
+
+	SmallVector<FunctionID> entry_order;
+	if (!Archive::reading)
+		entry_order = get_entry_point_order(ir);
+	ar.array(entry_order, [&](FunctionID &func) {
+		ar.value(func);
+		if (Archive::reading)
+		{
+			auto &entry = ir.entry_points[func];
+			transfer(ar, entry);
+		}
+		else
+			transfer(ar, ir.entry_points[func]);
+	});
+	ar.value(ir.default_entry_point);
+
+	for (auto &ids : ir.ids_for_type)
+		ar.array(ids);
+	ar.array(ir.ids_for_constant_undef_or_type);
+	ar.array(ir.ids_for_constant_or_variable);
+	ar.map(ir.load_type_width);
+	ar.array(ir.declared_capabilities);
+	ar.array(ir.declared_extensions, [&](std::string &ext) { ar.string(ext); });
+	ar.array(ir.block_meta);
+	ar.map(ir.continue_block_to_loop_header);
+
+	ar.value(ir.source.version);
+	ar.value(ir.source.es);
+	ar.value(ir.source.known);
+	ar.value(ir.source.hlsl);
+	ar.value(ir.addressing_model);
+	ar.value(ir.memory_model);
+
+	if (Archive::reading && ir.block_meta.size() != bound)
+		SPIRV_CROSS_THROW("Serialized IR is corrupt.");
+}
+
+std::vector<uint8_t> serialize_parsed_ir(const ParsedIR &ir)
+{
+	if (ir.spirv.size() > 0xffffffffu)
+		SPIRV_CROSS_THROW("SPIR-V module is too large to serialize.");
+
+	BlobWriter writer;
+	size_t payload_offset = SerializedIRHeaderSize + ir.spirv.size() * sizeof(uint32_t);
+	writer.data.resize(payload_offset);
+	if (!ir.spirv.empty())
+		memcpy(writer.data.data() + SerializedIRHeaderSize, ir.spirv.data(), ir.spirv.size() * sizeof(uint32_t));
+
+	// Nothing is modified, the archive only reads through the reference.
+	transfer_ir(writer, const_cast<ParsedIR &>(ir));
+
+	size_t payload_size = writer.data.size() - payload_offset;
+	if (payload_size > 0xffffffffu)
+		SPIRV_CROSS_THROW("IR is too large to serialize.");
+
+	uint32_t header[4] = { SerializedIRMagic, SerializedIRVersion, uint32_t(ir.spirv.size()), uint32_t(payload_size) };
+	memcpy(writer.data.data(), header, sizeof(header));
+	writer.data.resize((writer.data.size() + 3) & ~size_t(3));
+	return std::move(writer.data);
+}
+
+bool is_serialized_ir(const void *data, size_t size)
+{
+	uint32_t magic;
+	if (size < sizeof(magic))
+		return false;
+	memcpy(&magic, data, sizeof(magic));
+	return magic == SerializedIRMagic;
+}
+
+void deserialize_parsed_ir(ParsedIR &ir, const void *data, size_t size, bool borrow_spirv)
+{
+	if (!ir.ids.empty())
+		SPIRV_CROSS_THROW("Serialized IR must be loaded into empty IR.");
+
+	auto *bytes = static_cast<const uint8_t *>(data);
+	uint32_t header[4];
+	if (size < sizeof(header))
+		SPIRV_CROSS_THROW("Serialized IR is truncated.");
+	memcpy(header, bytes, sizeof(header));
+
+	if (header[0] != SerializedIRMagic)
+		SPIRV_CROSS_THROW("Not serialized IR, or serialized on a host of different endianness.");
+	if (header[1] != SerializedIRVersion)
+		SPIRV_CROSS_THROW("Serialized IR is of an incompatible version.");
+
+	size_t word_count = header[2];
+	if (word_count > (size - SerializedIRHeaderSize) / sizeof(uint32_t))
+		SPIRV_CROSS_THROW("Serialized IR is truncated.");
+
+	auto *words = bytes + SerializedIRHeaderSize;
+	if (borrow_spirv)
+	{
+		if (reinterpret_cast<uintptr_t>(words) % alignof(uint32_t))
+			SPIRV_CROSS_THROW("Borrowed serialized IR must be 4-byte aligned.");
+		ir.spirv.borrow(reinterpret_cast<const uint32_t *>(words), word_count);
+	}
+	else
+	{
+		std::vector<uint32_t> copy(word_count);
+		if (word_count)
+			memcpy(copy.data(), words, word_count * sizeof(uint32_t));
+		ir.spirv = std::move(copy);
+	}
+
+	size_t payload_offset = SerializedIRHeaderSize + word_count * sizeof(uint32_t);
+	size_t payload_size = header[3];
+	if (payload_size > size - payload_offset)
+		SPIRV_CROSS_THROW("Serialized IR is truncated.");
+
+	BlobReader reader(bytes + payload_offset, payload_size);
+	transfer_ir(reader, ir);
+	if (reader.remaining() != 0)
+		SPIRV_CROSS_THROW("Serialized IR is corrupt.");
+
+	// A truncated or stale blob can hold instructions which point past the words, or which claim to be embedded.
+	// Reject it here rather than read out of bounds once a compiler streams the instructions.
+	for (auto &var : ir.ids)
+	{
+		if (var.get_type() != TypeBlock)
+			continue;
+
+		for (auto &instr : var.get<SPIRBlock>().ops)
+		{
+			bool valid = instr.is_embedded() ? instr.length == 0 : size_t(instr.offset) + instr.length <= ir.spirv.size();
+			if (!valid)
+				SPIRV_CROSS_THROW("Serialized IR refers to SPIR-V words it does not contain.");
+		}
+	}
+}
+} // namespace SPIRV_CROSS_NAMESPACE
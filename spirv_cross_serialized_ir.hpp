@@ -0,0 +1,56 @@
+/*
+ * Copyright 2019-2021 Hans-Kristian Arntzen
+ * SPDX-License-Identifier: Apache-2.0 OR MIT
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * At your option, you may choose to accept this material under either:
+ *  1. The Apache License, Version 2.0, found at <http://www.apache.org/licenses/LICENSE-2.0>, or
+ *  2. The MIT License, found at <http://opensource.org/licenses/MIT>.
+ */
+
+#ifndef SPIRV_CROSS_SERIALIZED_IR_HPP
+#define SPIRV_CROSS_SERIALIZED_IR_HPP
+
+#include "spirv_cross_parsed_ir.hpp"
+#include <stdint.h>
+
+namespace SPIRV_CROSS_NAMESPACE
+{
+// Bumped whenever the layout of serialized IR changes. Blobs of other versions are rejected.
+static const uint32_t SerializedIRVersion = 1;
+
+// Writes the IR to a self-contained blob, so a module which is compiled over and over
+// only has to be parsed once. The blob holds the SPIR-V words followed by every ID, meta data and entry point.
+// It contains no pointers, so it can be stored to disk and memory-mapped.
+// Blobs are in host byte order, and are rejected on hosts of the other endianness.
+// They are padded to a multiple of 4 bytes, so they can be stored and loaded like SPIR-V words.
+// Throws if the IR holds state which cannot be serialized, i.e. it has been modified by a compiler.
+std::vector<uint8_t> serialize_parsed_ir(const ParsedIR &ir);
+
+// Rebuilds IR which is identical to the one given to serialize_parsed_ir() into ir, replacing Parser::parse().
+// ir must not contain any IDs yet, but may have been given a memory arena.
+// If borrow_spirv is true, the SPIR-V words are referenced in the blob rather than copied,
+// see Parser(const uint32_t *, size_t, bool). The blob must then be 4-byte aligned,
+// and stay alive and unmodified for as long as the IR, or any Compiler created from it, is in use.
+// Throws if the blob is truncated or of another version. Beyond that, blobs are not validated
+// like SPIR-V is by the parser, so they should only be loaded from a trusted cache.
+void deserialize_parsed_ir(ParsedIR &ir, const void *data, size_t size, bool borrow_spirv = false);
+
+// True if data starts like a blob written by serialize_parsed_ir(), of any version.
+bool is_serialized_ir(const void *data, size_t size);
+} // namespace SPIRV_CROSS_NAMESPACE
+
+#endif
@@ -310,6 +310,15 @@ void CompilerGLSL::reset(uint32_t iteration_count)
 	if (iteration_count >= options.force_recompile_max_debug_iterations && !is_force_recompile_forward_progress)
 		SPIRV_CROSS_THROW("Maximum compilation loops detected and no forward progress was made. Must be a SPIRV-Cross bug!");
 
+	// Output from the previous pass can only be kept if nothing but function-local state was invalidated.
+	if (iteration_count == 0 || is_forcing_full_recompilation())
+	{
+		emission_cache.functions.clear();
+		emission_cache.has_resources = false;
+	}
+	emission_requests.clear();
+	reused_functions.clear();
+
 	// We do some speculative optimizations which should pretty much always work out,
 	// but just in case the SPIR-V is rather weird, recompile until it's happy.
 	// This typically only means one extra pass.
@@ -398,7 +407,16 @@ bool CompilerGLSL::location_is_non_coherent_framebuffer_fetch(uint32_t location)
 
 void CompilerGLSL::find_static_extensions()
 {
-	ir.for_each_typed_id<SPIRType>([&](uint32_t, const SPIRType &type) {
+	// Folding specialization constants can leave types behind which nothing refers to any more.
+	unordered_set<uint32_t> referenced_types;
+	bool specialized = !specialization_constant_values.empty();
+	if (specialized)
+		referenced_types = get_types_referenced_after_specialization();
+
+	ir.for_each_typed_id<SPIRType>([&](uint32_t self, const SPIRType &type) {
+		if (specialized && !referenced_types.count(self))
+			return;
+
 		if (type.basetype == SPIRType::Double)
 		{
 			if (options.es)
@@ -639,6 +657,7 @@ void CompilerGLSL::find_static_extensions()
 
 void CompilerGLSL::require_polyfill(Polyfill polyfill, bool relaxed)
 {
+	record_emission_request(relaxed ? EmissionRequest::RelaxedPolyfill : EmissionRequest::Polyfill, polyfill);
 	uint32_t &polyfills = (relaxed && options.es) ? required_polyfills_relaxed : required_polyfills;
 
 	if ((polyfills & polyfill) == 0)
@@ -648,6 +667,11 @@ void CompilerGLSL::require_polyfill(Polyfill polyfill, bool relaxed)
 	}
 }
 
+void CompilerGLSL::append_backend_resource_costs(ResourceCostReport &report) const
+{
+	append_polyfill_costs(report, required_polyfills, required_polyfills_relaxed);
+}
+
 void CompilerGLSL::ray_tracing_khr_fixup_locations()
 {
 	uint32_t location = 0;
@@ -662,8 +686,139 @@ void CompilerGLSL::ray_tracing_khr_fixup_locations()
 	});
 }
 
+void CompilerGLSL::reset_for_recompile()
+{
+	CompilerGLSL fresh{ ParsedIR() };
+	fresh.options = options;
+	bool hot_reload = hot_reload_ir != nullptr;
+	fresh.keep_state_for_recompile(*this);
+
+	if (hot_reload)
+	{
+		fresh.reusable_emission.resources = std::move(reusable_emission.resources);
+		for (auto &emitted : reusable_emission.functions)
+			if (fresh.hot_reload_unchanged_functions.count(emitted.first))
+				fresh.reusable_emission.functions.insert(std::move(emitted));
+	}
+
+	*this = std::move(fresh);
+}
+
+static bool is_minify_identifier_character(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.';
+}
+
+// Whether dropping the whitespace between two characters would merge them into a different token.
+static bool minify_needs_separator(char a, char b)
+{
+	if (is_minify_identifier_character(a) && is_minify_identifier_character(b))
+		return true;
+
+	static const char *const operators[] = {
+		"++", "--", "&&", "||", "^^", "<<", ">>", "==", "!=", "<=", ">=",
+		"+=", "-=", "*=", "/=", "%=", "&=", "|=", "^=", "//", "/*",
+	};
+
+	for (auto *op : operators)
+		if (op[0] == a && op[1] == b)
+			return true;
+	return false;
+}
+
+// Removes indentation, comments and any whitespace which does not separate tokens.
+// Preprocessor directives keep a line of their own.
+static string minify_source(const string &source)
+{
+	string result;
+	result.reserve(source.size());
+
+	bool directive_continues = false;
+	bool in_block_comment = false;
+	size_t pos = 0;
+	while (pos < source.size())
+	{
+		size_t end = source.find('\n', pos);
+		if (end == string::npos)
+			end = source.size();
+
+		size_t begin = pos;
+		pos = end + 1;
+		while (begin < end && (source[begin] == ' ' || source[begin] == '\t'))
+			begin++;
+		while (end > begin && (source[end - 1] == ' ' || source[end - 1] == '\t' || source[end - 1] == '\r'))
+			end--;
+
+		if (begin == end)
+			continue;
+
+		const char *line = source.data() + begin;
+		size_t length = end - begin;
+		bool at_line_start = result.empty() || result.back() == '\n';
+
+		if (!in_block_comment && (line[0] == '#' || directive_continues))
+		{
+			if (!at_line_start)
+				result += '\n';
+			result.append(line, length);
+			result += '\n';
+			directive_continues = line[length - 1] == '\\';
+			continue;
+		}
+
+		// A comment separates tokens like whitespace does, so both are dropped the same way.
+		bool separate = !at_line_start;
+		bool in_string = false;
+		for (size_t i = 0; i < length; i++)
+		{
+			char c = line[i];
+			if (in_block_comment)
+			{
+				if (c == '*' && i + 1 < length && line[i + 1] == '/')
+				{
+					in_block_comment = false;
+					i++;
+				}
+			}
+			else if (in_string)
+			{
+				result += c;
+				if (c == '\\' && i + 1 < length)
+					result += line[++i];
+				else if (c == '"')
+					in_string = false;
+			}
+			else if (c == '/' && i + 1 < length && line[i + 1] == '/')
+				break;
+			else if (c == '/' && i + 1 < length && line[i + 1] == '*')
+			{
+				in_block_comment = true;
+				separate = !result.empty() && result.back() != '\n';
+				i++;
+			}
+			else if (c == ' ' || c == '\t')
+				separate = !result.empty() && result.back() != '\n';
+			else
+			{
+				if (separate && minify_needs_separator(result.back(), c))
+					result += ' ';
+				separate = false;
+				result += c;
+				if (c == '"')
+					in_string = true;
+			}
+		}
+	}
+
+	if (!result.empty() && result.back() != '\n')
+		result += '\n';
+	return result;
+}
+
 string CompilerGLSL::compile()
 {
+	CompileBudgetTracker::Scope budget_scope(compile_budget);
+	save_recompile_snapshot();
 	ir.fixup_reserved_names();
 
 	if (!options.vulkan_semantics)
@@ -684,24 +839,38 @@ string CompilerGLSL::compile()
 	if (is_legacy_es())
 		backend.support_case_fallthrough = false;
 
+	profile_pass("specialize_constants", [&] { specialize_constants(); });
 	// Scan the SPIR-V to find trivial uses of extensions.
-	fixup_anonymous_struct_names();
-	fixup_type_alias();
-	reorder_type_alias();
-	build_function_control_flow_graphs_and_analyze();
-	find_static_extensions();
-	fixup_image_load_store_access();
-	update_active_builtins();
-	analyze_image_and_sampler_usage();
-	analyze_interlocked_resource_usage();
+	profile_pass("fixup_anonymous_struct_names", [&] { fixup_anonymous_struct_names(); });
+	profile_pass("fixup_type_alias", [&] { fixup_type_alias(); });
+	profile_pass("reorder_type_alias", [&] { reorder_type_alias(); });
+	if (options.common_subexpression_min_cost)
+		profile_pass("eliminate_common_subexpressions",
+		             [&] { eliminate_common_subexpressions(options.common_subexpression_min_cost); });
+	profile_pass("build_function_control_flow_graphs_and_analyze",
+	             [&] { build_function_control_flow_graphs_and_analyze(); });
+	bool supports_lut_buffers = options.vulkan_semantics || (options.es ? options.version >= 310 : options.version >= 430);
+	lower_luts_to_buffers(supports_lut_buffers ? options.lut_buffer_min_size : 0, options.lut_buffer_set,
+	                      options.lut_buffer_binding);
+	profile_pass("find_static_extensions", [&] { find_static_extensions(); });
+	profile_pass("fixup_image_load_store_access", [&] { fixup_image_load_store_access(); });
+	profile_pass("update_active_builtins_and_analyze_image_and_sampler_usage",
+	             [&] { update_active_builtins_and_analyze_image_and_sampler_usage(); });
+	profile_pass("analyze_interlocked_resource_usage", [&] { analyze_interlocked_resource_usage(); });
+	if (options.descriptor_heap_indexing)
+		profile_pass("analyze_descriptor_heap_indexing", [&] { analyze_descriptor_heap_indexing(); });
 	if (!inout_color_attachments.empty())
 		emit_inout_fragment_outputs_copy_to_subpass_inputs();
 
 	// Shaders might cast unrelated data to pointers of non-block types.
 	// Find all such instances and make sure we can cast the pointers to a synthesized block type.
 	if (ir.addressing_model == AddressingModelPhysicalStorageBuffer64EXT)
-		analyze_non_block_pointer_types();
+		profile_pass("analyze_non_block_pointer_types", [&] { analyze_non_block_pointer_types(); });
+
+	if (options.minify)
+		profile_pass("minify_names", [&] { minify_names(); });
 
+	PassProfiler emit_profiler(*this, "emit");
 	uint32_t pass_count = 0;
 	do
 	{
@@ -709,19 +878,44 @@ string CompilerGLSL::compile()
 
 		buffer.reset();
 
-		emit_header();
-		emit_resources();
-		emit_extension_workarounds(get_execution_model());
+		if (emission_cache.has_resources)
+			restore_resource_emission();
+		else
+		{
+			emit_header();
+			emit_resources();
+			emit_extension_workarounds(get_execution_model());
 
-		if (required_polyfills != 0)
-			emit_polyfills(required_polyfills, false);
-		if (options.es && required_polyfills_relaxed != 0)
-			emit_polyfills(required_polyfills_relaxed, true);
+			if (required_polyfills != 0)
+				emit_polyfills(required_polyfills, false);
+			if (options.es && required_polyfills_relaxed != 0)
+				emit_polyfills(required_polyfills_relaxed, true);
+
+			if (!is_forcing_recompilation())
+				save_resource_emission();
+		}
 
 		emit_function(get<SPIRFunction>(ir.default_entry_point), Bitset());
 
+		// Reused code is only known to fit declarations which are emitted exactly as before.
+		if (!is_forcing_recompilation() && !reusable_emission.functions.empty() &&
+		    emission_cache.resources != reusable_emission.resources)
+		{
+			reusable_emission.functions.clear();
+			force_recompile_guarantee_forward_progress();
+		}
+
 		pass_count++;
 	} while (is_forcing_recompilation());
+	emit_profiler.finish(pass_count);
+
+	// Keep what was emitted for reset_for_hot_reload().
+	reusable_emission.resources = std::move(emission_cache.resources);
+	reusable_emission.functions.clear();
+	for (auto &emitted : emission_cache.functions)
+		if (!emission_cache.functions_allocating_ids.count(emitted.first))
+			reusable_emission.functions.insert(std::move(emitted));
+	emission_cache = {};
 
 	// Implement the interlocked wrapper function at the end.
 	// The body was implemented in lieu of main().
@@ -739,7 +933,10 @@ string CompilerGLSL::compile()
 	// Entry point in GLSL is always main().
 	get_entry_point().name = "main";
 
-	return buffer.str();
+	if (options.minify)
+		return finish_output(minify_source(buffer.str()));
+
+	return finish_output(buffer);
 }
 
 std::string CompilerGLSL::get_partial_source()
@@ -793,6 +990,7 @@ void CompilerGLSL::build_workgroup_size(SmallVector<string> &arguments, const Sp
 
 void CompilerGLSL::request_subgroup_feature(ShaderSubgroupSupportHelper::Feature feature)
 {
+	record_emission_request(EmissionRequest::SubgroupFeature, feature);
 	if (options.vulkan_semantics)
 	{
 		auto khr_extension = ShaderSubgroupSupportHelper::get_KHR_extension_for_feature(feature);
@@ -2746,9 +2944,14 @@ void CompilerGLSL::emit_interface_block(const SPIRVariable &var)
 		// ESSL earlier than 310 and GLSL earlier than 150 did not support
 		// I/O variables which are struct types.
 		// To support this, flatten the struct into separate varyings instead.
-		if (type.basetype == SPIRType::Struct &&
-		    (options.force_flattened_io_blocks || (options.es && options.version < 310) ||
-		     (!options.es && options.version < 150)))
+		if (is_stage_output_variable_declared_private(var))
+		{
+			add_resource_name(var.self);
+			statement(variable_decl(type, to_name(var.self), var.self), ";");
+		}
+		else if (type.basetype == SPIRType::Struct &&
+		         (options.force_flattened_io_blocks || (options.es && options.version < 310) ||
+		          (!options.es && options.version < 150)))
 		{
 			emit_flattened_io_block(var, qual);
 		}
@@ -2860,6 +3063,21 @@ void CompilerGLSL::emit_constant(const SPIRConstant &constant)
 	add_resource_name(constant.self);
 	auto name = to_name(constant.self);
 
+	if (auto *lut = find_lowered_lut(constant.self))
+	{
+		// The table is read from a buffer, whose only member takes the name of the constant.
+		if (options.vulkan_semantics)
+			statement("layout(set = ", lut->desc_set, ", binding = ", lut->binding,
+			          ", std430) readonly buffer SPIRV_Cross_LUT", lut->binding);
+		else
+			statement("layout(binding = ", lut->binding, ", std430) readonly buffer SPIRV_Cross_LUT", lut->binding);
+		begin_scope();
+		statement(variable_decl(type, name), ";");
+		end_scope_decl();
+		statement("");
+		return;
+	}
+
 	// Only scalars have constant IDs.
 	if (has_decoration(constant.self, DecorationSpecId))
 	{
@@ -2930,7 +3148,8 @@ void CompilerGLSL::replace_illegal_names(const unordered_set<string> &keywords)
 	});
 }
 
-void CompilerGLSL::replace_illegal_names()
+// Builtin functions and reserved words, which no declared name may shadow.
+static const unordered_set<string> &glsl_reserved_names()
 {
 	// clang-format off
 	static const unordered_set<string> keywords = {
@@ -2984,7 +3203,12 @@ void CompilerGLSL::replace_illegal_names()
 	};
 	// clang-format on
 
-	replace_illegal_names(keywords);
+	return keywords;
+}
+
+void CompilerGLSL::replace_illegal_names()
+{
+	replace_illegal_names(glsl_reserved_names());
 }
 
 void CompilerGLSL::replace_fragment_output(SPIRVariable &var)
@@ -3712,7 +3936,7 @@ void CompilerGLSL::emit_resources()
 		                       ir.meta[type.self].decoration.decoration_flags.get(DecorationBufferBlock);
 
 		if (var.storage != StorageClassFunction && type.pointer && is_block_storage && !is_hidden_variable(var) &&
-		    has_block_flags)
+		    has_block_flags && !descriptor_heap_slot_indices.count(var.self))
 		{
 			emit_buffer_block(var);
 		}
@@ -3750,7 +3974,7 @@ void CompilerGLSL::emit_resources()
 		     type.storage == StorageClassRayPayloadKHR || type.storage == StorageClassIncomingRayPayloadKHR ||
 		     type.storage == StorageClassCallableDataKHR || type.storage == StorageClassIncomingCallableDataKHR ||
 		     type.storage == StorageClassHitAttributeKHR) &&
-		    !is_hidden_variable(var))
+		    !is_hidden_variable(var) && !descriptor_heap_slot_indices.count(var.self))
 		{
 			emit_uniform(var);
 			emitted = true;
@@ -4802,9 +5026,9 @@ void CompilerGLSL::force_temporary_and_recompile(uint32_t id)
 
 	// Forcing new temporaries guarantees forward progress.
 	if (res.second)
-		force_recompile_guarantee_forward_progress();
+		force_function_recompile_guarantee_forward_progress();
 	else
-		force_recompile();
+		force_function_recompile();
 }
 
 uint32_t CompilerGLSL::consume_temporary_in_precision_context(uint32_t type_id, uint32_t id, Options::Precision precision)
@@ -4828,7 +5052,7 @@ uint32_t CompilerGLSL::consume_temporary_in_precision_context(uint32_t type_id,
 		// otherwise we have no way of controlling the precision later.
 		auto itr = forced_temporaries.insert(id);
 		if (itr.second)
-			force_recompile_guarantee_forward_progress();
+			force_function_recompile_guarantee_forward_progress();
 		return id;
 	}
 
@@ -4864,7 +5088,7 @@ uint32_t CompilerGLSL::consume_temporary_in_precision_context(uint32_t type_id,
 		temporary_to_mirror_precision_alias[id] = alias_id;
 		forced_temporaries.insert(id);
 		forced_temporaries.insert(alias_id);
-		force_recompile_guarantee_forward_progress();
+		force_function_recompile_guarantee_forward_progress();
 		id = alias_id;
 	}
 	else
@@ -5358,6 +5582,13 @@ string CompilerGLSL::to_expression(uint32_t id, bool register_expression_read)
 		{
 			return load_flattened_struct(to_name(id), get<SPIRType>(var.basetype));
 		}
+		else if (descriptor_heap_slot_indices.count(id))
+		{
+			auto &slot = descriptor_heap_slots[descriptor_heap_slot_indices[id]];
+			auto &index_var = get<SPIRVariable>(descriptor_heap_index_variable);
+			return join(to_name(descriptor_heap_variables[slot.heap_binding]), "[", to_name(index_var.self), ".",
+			            to_member_name(get_variable_data_type(index_var), slot.index), "]");
+		}
 		else
 		{
 			auto &dec = ir.meta[var.self].decoration;
@@ -5781,10 +6012,19 @@ string CompilerGLSL::constant_expression(const SPIRConstant &c,
 			res = type_to_glsl_constructor(type) + "(";
 		}
 
+		// Large tables are mostly flat arrays of scalars, which are formatted directly.
+		bool scalar_table = constant_is_scalar_table(c);
+		if (scalar_table)
+			res.reserve(res.size() + c.subconstants.size() * 8);
+
 		uint32_t subconstant_index = 0;
 		for (auto &elem : c.subconstants)
 		{
-			if (auto *op = maybe_get<SPIRConstantOp>(elem))
+			if (scalar_table)
+			{
+				res += constant_expression_vector(get<SPIRConstant>(elem), 0);
+			}
+			else if (auto *op = maybe_get<SPIRConstantOp>(elem))
 			{
 				res += constant_op_expression(*op);
 			}
@@ -6494,7 +6734,7 @@ void CompilerGLSL::emit_uninitialized_temporary(uint32_t result_type, uint32_t r
 		{
 			header.declare_temporary.emplace_back(result_type, result_id);
 			hoisted_temporaries.insert(result_id);
-			force_recompile();
+			force_function_recompile();
 		}
 	}
 	else if (hoisted_temporaries.count(result_id) == 0)
@@ -6529,7 +6769,7 @@ string CompilerGLSL::declare_temporary(uint32_t result_type, uint32_t result_id)
 		{
 			header.declare_temporary.emplace_back(result_type, result_id);
 			hoisted_temporaries.insert(result_id);
-			force_recompile_guarantee_forward_progress();
+			force_function_recompile_guarantee_forward_progress();
 		}
 
 		return join(to_name(result_id), " = ");
@@ -11374,6 +11614,7 @@ void CompilerGLSL::emit_block_instructions(SPIRBlock &block)
 
 	for (auto &op : block.ops)
 	{
+		compile_budget.check();
 		auto temporary_copy = handle_instruction_precision(op);
 		emit_instruction(op);
 		if (temporary_copy.dst_id)
@@ -11996,7 +12237,7 @@ void CompilerGLSL::emit_instruction(const Instruction &instruction)
 		auto *var = maybe_get<SPIRVariable>(ops[0]);
 
 		if (var && var->statically_assigned)
-			var->static_expression = ops[1];
+			var->static_expression = get_canonical_constant(ops[1]);
 		else if (var && var->loop_variable && !var->loop_variable_enable)
 			var->static_expression = ops[1];
 		else if (var && var->remapped_variable && var->static_expression)
@@ -12502,6 +12743,11 @@ void CompilerGLSL::emit_instruction(const Instruction &instruction)
 			auto &e = set<SPIRCombinedImageSampler>(id, *imgsamp);
 			e.self = id;
 		}
+		else if (common_subexpressions.count(id))
+		{
+			// Computes the same value as rhs, which is bound to a temporary, so just refer to it.
+			emit_op(result_type, id, to_expression(rhs), true, true);
+		}
 		else if (expression_is_lvalue(rhs) && !pointer)
 		{
 			// Need a copy.
@@ -13770,19 +14016,9 @@ void CompilerGLSL::emit_instruction(const Instruction &instruction)
 	case OpImageRead:
 	case OpImageSparseRead:
 	{
-		// We added Nonreadable speculatively to the OpImage variable due to glslangValidator
-		// not adding the proper qualifiers.
-		// If it turns out we need to read the image after all, remove the qualifier and recompile.
 		auto *var = maybe_get_backing_variable(ops[2]);
 		if (var)
-		{
-			auto &flags = get_decoration_bitset(var->self);
-			if (flags.get(DecorationNonReadable))
-			{
-				unset_decoration(var->self, DecorationNonReadable);
-				force_recompile();
-			}
-		}
+			require_image_access(var->self, DecorationNonReadable);
 
 		uint32_t result_type = ops[0];
 		uint32_t id = ops[1];
@@ -13966,18 +14202,9 @@ void CompilerGLSL::emit_instruction(const Instruction &instruction)
 
 	case OpImageWrite:
 	{
-		// We added Nonwritable speculatively to the OpImage variable due to glslangValidator
-		// not adding the proper qualifiers.
-		// If it turns out we need to write to the image after all, remove the qualifier and recompile.
 		auto *var = maybe_get_backing_variable(ops[0]);
 		if (var)
-		{
-			if (has_decoration(var->self, DecorationNonWritable))
-			{
-				unset_decoration(var->self, DecorationNonWritable);
-				force_recompile();
-			}
-		}
+			require_image_access(var->self, DecorationNonWritable);
 
 		auto &type = expression_type(ops[0]);
 		auto &value_type = expression_type(ops[2]);
@@ -15688,8 +15915,7 @@ string CompilerGLSL::type_to_glsl(const SPIRType &type, uint32_t id)
 	}
 }
 
-void CompilerGLSL::add_variable(unordered_set<string> &variables_primary,
-                                const unordered_set<string> &variables_secondary, string &name)
+void CompilerGLSL::add_variable(NameCache &variables_primary, const NameCache &variables_secondary, string &name)
 {
 	if (name.empty())
 		return;
@@ -15738,6 +15964,7 @@ const SmallVector<std::string> &CompilerGLSL::get_required_extensions() const
 
 void CompilerGLSL::require_extension_internal(const string &ext)
 {
+	record_emission_request(EmissionRequest::Extension, 0, ext);
 	if (backend.supports_extensions && !has_extension(ext))
 	{
 		forced_extensions.push_back(ext);
@@ -15769,6 +15996,57 @@ bool CompilerGLSL::builtin_translates_to_nonarray(spv::BuiltIn /*builtin*/) cons
 	return false; // GLSL itself does not need to translate array builtin types to non-array builtin types
 }
 
+void CompilerGLSL::record_emission_request(EmissionRequest::Kind kind, uint32_t value, const string &extension)
+{
+	emission_requests.push_back({ kind, value, extension });
+}
+
+void CompilerGLSL::replay_emission_request(const EmissionRequest &request)
+{
+	switch (request.kind)
+	{
+	case EmissionRequest::Extension:
+		require_extension_internal(request.extension);
+		break;
+
+	case EmissionRequest::Polyfill:
+	case EmissionRequest::RelaxedPolyfill:
+		require_polyfill(static_cast<Polyfill>(request.value), request.kind == EmissionRequest::RelaxedPolyfill);
+		break;
+
+	case EmissionRequest::SubgroupFeature:
+		request_subgroup_feature(static_cast<ShaderSubgroupSupportHelper::Feature>(request.value));
+		break;
+
+	case EmissionRequest::WorkaroundOverload:
+		request_workaround_wrapper_overload(request.value);
+		break;
+
+	case EmissionRequest::ReadableImage:
+		require_image_access(request.value, DecorationNonReadable);
+		break;
+
+	case EmissionRequest::WritableImage:
+		require_image_access(request.value, DecorationNonWritable);
+		break;
+	}
+}
+
+void CompilerGLSL::require_image_access(uint32_t var_id, Decoration qualifier)
+{
+	// We added NonReadable and NonWritable speculatively to image variables due to glslangValidator
+	// not adding the proper qualifiers.
+	// If it turns out we need to access the image that way after all, remove the qualifier and recompile.
+	record_emission_request(qualifier == DecorationNonReadable ? EmissionRequest::ReadableImage :
+	                                                             EmissionRequest::WritableImage,
+	                        var_id);
+	if (has_decoration(var_id, qualifier))
+	{
+		unset_decoration(var_id, qualifier);
+		force_recompile();
+	}
+}
+
 bool CompilerGLSL::is_user_type_structured(uint32_t /*id*/) const
 {
 	return false; // GLSL itself does not have structured user type, but HLSL does with StructuredBuffer and RWStructuredBuffer resources.
@@ -15785,12 +16063,8 @@ bool CompilerGLSL::check_atomic_image(uint32_t id)
 		auto *var = maybe_get_backing_variable(id);
 		if (var)
 		{
-			if (has_decoration(var->self, DecorationNonWritable) || has_decoration(var->self, DecorationNonReadable))
-			{
-				unset_decoration(var->self, DecorationNonWritable);
-				unset_decoration(var->self, DecorationNonReadable);
-				force_recompile();
-			}
+			require_image_access(var->self, DecorationNonWritable);
+			require_image_access(var->self, DecorationNonReadable);
 		}
 		return true;
 	}
@@ -15798,7 +16072,7 @@ bool CompilerGLSL::check_atomic_image(uint32_t id)
 		return false;
 }
 
-void CompilerGLSL::add_function_overload(const SPIRFunction &func)
+uint64_t CompilerGLSL::hash_function_overload(const SPIRFunction &func) const
 {
 	Hasher hasher;
 	for (auto &arg : func.arguments)
@@ -15824,8 +16098,12 @@ void CompilerGLSL::add_function_overload(const SPIRFunction &func)
 
 		hasher.u32(type_id);
 	}
-	uint64_t types_hash = hasher.get();
+	return hasher.get();
+}
 
+void CompilerGLSL::add_function_overload(const SPIRFunction &func)
+{
+	uint64_t types_hash = hash_function_overload(func);
 	auto function_name = to_name(func.self);
 	auto itr = function_overloads.find(function_name);
 	if (itr != end(function_overloads))
@@ -15951,6 +16229,45 @@ void CompilerGLSL::emit_function(SPIRFunction &func, const Bitset &return_flags)
 		}
 	}
 
+	// A function which was fully emitted in an earlier pass is unaffected by function-local recompiles elsewhere.
+	// Its overload still has to be claimed so that name resolution of later functions stays the same.
+	auto cache_itr = emission_cache.functions.find(func.self);
+	if (cache_itr != end(emission_cache.functions))
+	{
+		if (func.self != ir.default_entry_point)
+			add_function_overload(func);
+		reused_functions[func.self] = cache_itr->second.info;
+		current_function = &func;
+		buffer << cache_itr->second.code;
+		return;
+	}
+
+	// Code which the compile before reset_for_hot_reload() emitted for this function is reused
+	// as long as it would be emitted the same way. Once it is not, neither is the code of its callers.
+	auto reuse_itr = reusable_emission.functions.find(func.self);
+	if (reuse_itr != end(reusable_emission.functions))
+	{
+		auto &emitted = reuse_itr->second;
+		if (can_reuse_function_emission(func, return_flags, emitted))
+		{
+			if (func.self != ir.default_entry_point)
+				add_function_overload(func);
+			for (auto &request : emitted.requests)
+				replay_emission_request(request);
+			reused_functions[func.self] = emitted.info;
+			current_function = &func;
+			buffer << emitted.code;
+			if (!is_forcing_recompilation())
+				emission_cache.functions[func.self] = emitted;
+			return;
+		}
+		reusable_emission.functions.erase(reuse_itr);
+	}
+
+	size_t function_offset = buffer.size();
+	size_t request_offset = emission_requests.size();
+	uint32_t id_bound = uint32_t(ir.ids.size());
+
 	if (func.entry_line.file_id != 0)
 		emit_line_directive(func.entry_line.file_id, func.entry_line.line_literal);
 	emit_function_prototype(func, return_flags);
@@ -16071,6 +16388,59 @@ void CompilerGLSL::emit_function(SPIRFunction &func, const Bitset &return_flags)
 		auto &var = get<SPIRVariable>(v);
 		var.deferred_declaration = false;
 	}
+
+	if (ir.ids.size() != id_bound)
+		emission_cache.functions_allocating_ids.insert(func.self);
+
+	// If a recompile was requested at any point before this, some statements will have been dropped.
+	if (!is_forcing_recompilation())
+	{
+		auto &emitted = emission_cache.functions[func.self];
+		emitted.code = buffer.str(function_offset);
+		emitted.name = to_name(func.self);
+		emitted.return_flags = return_flags;
+		emitted.requests.clear();
+		emitted.requests.insert(emitted.requests.end(), emission_requests.begin() + request_offset,
+		                        emission_requests.end());
+
+		// Callers need these once the expressions of this function have been reset, see reused_functions.
+		emitted.info = {};
+		if (func.self != ir.default_entry_point)
+		{
+			emitted.info.pure = function_is_pure(func);
+			collect_global_reads(func, emitted.info.global_reads);
+		}
+	}
+}
+
+bool CompilerGLSL::can_reuse_function_emission(const SPIRFunction &func, const Bitset &return_flags,
+                                               const EmittedFunction &emitted) const
+{
+	if (return_flags != emitted.return_flags || to_name(func.self) != emitted.name)
+		return false;
+
+	// Claiming the overload must not rename the function.
+	if (func.self != ir.default_entry_point)
+	{
+		auto itr = function_overloads.find(emitted.name);
+		if (itr != end(function_overloads) && itr->second.count(hash_function_overload(func)))
+			return false;
+	}
+
+	// Callees have been emitted already, and are still reusable if their code was reused.
+	for (auto block : func.blocks)
+	{
+		for (auto &i : get<SPIRBlock>(block).ops)
+		{
+			if (static_cast<Op>(i.op) == OpFunctionCall &&
+			    !reusable_emission.functions.count(stream(i)[2]))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
 }
 
 void CompilerGLSL::emit_fixup()
@@ -16127,7 +16497,7 @@ void CompilerGLSL::flush_phi(BlockID from, BlockID to)
 					if (!var.allocate_temporary_copy)
 					{
 						var.allocate_temporary_copy = true;
-						force_recompile();
+						force_function_recompile();
 					}
 					statement("_", phi.function_variable, "_copy", " = ", to_name(phi.function_variable), ";");
 					temporary_phi_variables.insert(phi.function_variable);
@@ -16247,7 +16617,7 @@ void CompilerGLSL::branch(BlockID from, BlockID to)
 				{
 					if (!current_emitting_switch->need_ladder_break)
 					{
-						force_recompile();
+						force_function_recompile();
 						current_emitting_switch->need_ladder_break = true;
 					}
 
@@ -16573,7 +16943,7 @@ bool CompilerGLSL::attempt_emit_loop_header(SPIRBlock &block, SPIRBlock::Method
 
 			default:
 				block.disable_block_optimization = true;
-				force_recompile();
+				force_function_recompile();
 				begin_scope(); // We'll see an end_scope() later.
 				return false;
 			}
@@ -16584,7 +16954,7 @@ bool CompilerGLSL::attempt_emit_loop_header(SPIRBlock &block, SPIRBlock::Method
 		else
 		{
 			block.disable_block_optimization = true;
-			force_recompile();
+			force_function_recompile();
 			begin_scope(); // We'll see an end_scope() later.
 			return false;
 		}
@@ -16650,7 +17020,7 @@ bool CompilerGLSL::attempt_emit_loop_header(SPIRBlock &block, SPIRBlock::Method
 
 			default:
 				block.disable_block_optimization = true;
-				force_recompile();
+				force_function_recompile();
 				begin_scope(); // We'll see an end_scope() later.
 				return false;
 			}
@@ -16662,7 +17032,7 @@ bool CompilerGLSL::attempt_emit_loop_header(SPIRBlock &block, SPIRBlock::Method
 		else
 		{
 			block.disable_block_optimization = true;
-			force_recompile();
+			force_function_recompile();
 			begin_scope(); // We'll see an end_scope() later.
 			return false;
 		}
@@ -16875,7 +17245,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 	// as writes to said loop variables might have been masked out, we need a recompile.
 	if (!emitted_loop_header_variables && !block.loop_variables.empty())
 	{
-		force_recompile_guarantee_forward_progress();
+		force_function_recompile_guarantee_forward_progress();
 		for (auto var : block.loop_variables)
 			get<SPIRVariable>(var).loop_variable = false;
 		block.loop_variables.clear();
@@ -17418,7 +17788,7 @@ void CompilerGLSL::emit_block_chain(SPIRBlock &block)
 			{
 				// The DoWhile block has side effects, force ComplexLoop pattern next pass.
 				get<SPIRBlock>(block.continue_block).complex_continue = true;
-				force_recompile();
+				force_function_recompile();
 			}
 
 			// Might have to invert the do-while test here.
@@ -17847,6 +18217,42 @@ void CompilerGLSL::preserve_alias_on_reset(uint32_t id)
 	preserved_aliases[id] = get_name(id);
 }
 
+void CompilerGLSL::save_resource_emission()
+{
+	auto &cache = emission_cache;
+	cache.resources = buffer.str();
+	cache.resource_names = resource_names;
+	cache.block_input_names = block_input_names;
+	cache.block_output_names = block_output_names;
+	cache.block_ubo_names = block_ubo_names;
+	cache.block_ssbo_names = block_ssbo_names;
+	cache.block_names = block_names;
+	cache.preserved_aliases = preserved_aliases;
+
+	// reset_name_caches() will roll these back, so remember what emit_resources() ended up with.
+	cache.resolved_aliases.clear();
+	for (auto &preserved : preserved_aliases)
+		cache.resolved_aliases[preserved.first] = get_name(preserved.first);
+
+	cache.has_resources = true;
+}
+
+void CompilerGLSL::restore_resource_emission()
+{
+	auto &cache = emission_cache;
+	buffer << cache.resources;
+	resource_names = cache.resource_names;
+	block_input_names = cache.block_input_names;
+	block_output_names = cache.block_output_names;
+	block_ubo_names = cache.block_ubo_names;
+	block_ssbo_names = cache.block_ssbo_names;
+	block_names = cache.block_names;
+	preserved_aliases = cache.preserved_aliases;
+
+	for (auto &resolved : cache.resolved_aliases)
+		set_name(resolved.first, resolved.second);
+}
+
 void CompilerGLSL::reset_name_caches()
 {
 	for (auto &preserved : preserved_aliases)
@@ -17908,6 +18314,217 @@ void CompilerGLSL::fixup_anonymous_struct_names()
 	});
 }
 
+// Maps an index to a unique identifier, using the shortest names first.
+static string minified_name(uint32_t index)
+{
+	static const char characters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	string name(1, characters[index % 52]);
+	index /= 52;
+	while (index)
+	{
+		index--;
+		name += characters[index % 62];
+		index /= 62;
+	}
+	return name;
+}
+
+void CompilerGLSL::analyze_descriptor_heap_indexing()
+{
+	if (!options.vulkan_semantics)
+		SPIRV_CROSS_THROW("Indexing descriptor heaps requires Vulkan GLSL.");
+
+	// Only set up the heaps once.
+	if (descriptor_heap_index_variable)
+		return;
+
+	// Separate images and samplers are not declared when they are combined.
+	bool skip_separate_image_sampler = !combined_image_samplers.empty();
+
+	// Resources share a runtime array if they have the same type and qualifiers.
+	const Decoration qualifiers[] = { DecorationNonWritable, DecorationNonReadable, DecorationCoherent,
+		                              DecorationVolatile, DecorationRestrict };
+	struct HeapGroup
+	{
+		uint32_t type_id;
+		uint32_t qualifier_mask;
+		VariableID example;
+	};
+	SmallVector<HeapGroup> groups;
+	SmallVector<std::string> member_names;
+
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
+		auto &type = get<SPIRType>(var.basetype);
+		if (var.storage == StorageClassPushConstant && !is_hidden_variable(var))
+			SPIRV_CROSS_THROW("Indexing descriptor heaps needs the push constant block for the heap indices, "
+			                  "but the shader declares push constants.");
+
+		if (!type.pointer || !type.array.empty() || is_hidden_variable(var) ||
+		    !has_decoration(var.self, DecorationBinding))
+		{
+			return;
+		}
+
+		bool has_block_flags = has_decoration(type.self, DecorationBlock) || has_decoration(type.self, DecorationBufferBlock);
+		bool is_buffer =
+		    (var.storage == StorageClassUniform || var.storage == StorageClassStorageBuffer) && has_block_flags;
+
+		bool is_resource = false;
+		if (var.storage == StorageClassUniformConstant)
+		{
+			switch (type.basetype)
+			{
+			case SPIRType::Image:
+				is_resource = !skip_separate_image_sampler || type.image.dim == DimBuffer || type.image.sampled != 1;
+				break;
+			case SPIRType::Sampler:
+				is_resource = !skip_separate_image_sampler;
+				break;
+			case SPIRType::SampledImage:
+			case SPIRType::AccelerationStructure:
+				is_resource = true;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (!is_buffer && !is_resource)
+			return;
+
+		uint32_t qualifier_mask = 0;
+		for (uint32_t i = 0; i < uint32_t(sizeof(qualifiers) / sizeof(qualifiers[0])); i++)
+			if (has_decoration(var.self, qualifiers[i]))
+				qualifier_mask |= 1u << i;
+
+		uint32_t type_id = get_variable_data_type_id(var);
+		auto group_itr = find_if(begin(groups), end(groups), [&](const HeapGroup &group) {
+			return group.type_id == type_id && group.qualifier_mask == qualifier_mask &&
+			       get<SPIRVariable>(group.example).storage == var.storage;
+		});
+
+		if (group_itr == end(groups))
+		{
+			groups.push_back({ type_id, qualifier_mask, var.self });
+			group_itr = end(groups) - 1;
+		}
+
+		DescriptorHeapSlot slot = {};
+		slot.id = var.self;
+		slot.desc_set = get_decoration(var.self, DecorationDescriptorSet);
+		slot.binding = get_decoration(var.self, DecorationBinding);
+		slot.heap_binding = uint32_t(group_itr - begin(groups));
+		slot.index = uint32_t(member_names.size());
+		descriptor_heap_slot_indices[var.self] = uint32_t(descriptor_heap_slots.size());
+		descriptor_heap_slots.push_back(slot);
+		member_names.push_back(to_name(var.self));
+	});
+
+	if (descriptor_heap_slots.empty())
+		return;
+
+	// One runtime array of each resource type.
+	for (uint32_t heap_binding = 0; heap_binding < uint32_t(groups.size()); heap_binding++)
+	{
+		auto &group = groups[heap_binding];
+		auto &example = get<SPIRVariable>(group.example);
+
+		uint32_t offset = ir.increase_bound_by(3);
+		uint32_t array_type_id = offset;
+		uint32_t pointer_type_id = offset + 1;
+		uint32_t variable_id = offset + 2;
+
+		auto &array_type = set<SPIRType>(array_type_id);
+		array_type = get<SPIRType>(group.type_id);
+		array_type.array.push_back(0);
+		array_type.array_size_literal.push_back(true);
+		array_type.parent_type = group.type_id;
+
+		auto &pointer_type = set<SPIRType>(pointer_type_id);
+		pointer_type = get<SPIRType>(array_type_id);
+		pointer_type.pointer = true;
+		pointer_type.pointer_depth++;
+		pointer_type.storage = example.storage;
+		pointer_type.parent_type = array_type_id;
+
+		set<SPIRVariable>(variable_id, pointer_type_id, example.storage);
+		ir.meta[variable_id].decoration.alias = join("SPIRV_Cross_DescriptorHeap", heap_binding);
+		set_decoration(variable_id, DecorationDescriptorSet, options.descriptor_heap_set);
+		set_decoration(variable_id, DecorationBinding, heap_binding);
+		for (uint32_t i = 0; i < uint32_t(sizeof(qualifiers) / sizeof(qualifiers[0])); i++)
+			if (group.qualifier_mask & (1u << i))
+				set_decoration(variable_id, qualifiers[i]);
+		add_active_interface_variable(variable_id);
+		descriptor_heap_variables.push_back(variable_id);
+	}
+
+	descriptor_heap_index_variable =
+	    add_uint_block_variable("SPIRV_Cross_DescriptorHeapIndices", member_names, StorageClassPushConstant);
+
+	// Declaring runtime arrays of descriptors needs the extension, even though the indices are dynamically uniform.
+	require_extension_internal("GL_EXT_nonuniform_qualifier");
+}
+
+void CompilerGLSL::minify_names()
+{
+	minified_names.clear();
+
+	// Locals, function parameters, temporaries and non-entry functions are renamed.
+	SmallVector<uint32_t> renamed;
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t id, const SPIRFunction &func) {
+		if (ID(id) != ir.default_entry_point)
+			renamed.push_back(id);
+		for (auto &arg : func.arguments)
+			renamed.push_back(arg.id);
+		for (auto var : func.local_variables)
+			renamed.push_back(var);
+
+		for (auto block_id : func.blocks)
+		{
+			for (auto &i : get<SPIRBlock>(block_id).ops)
+			{
+				bool has_result, has_result_type;
+				HasResultAndType(static_cast<Op>(i.op), &has_result, &has_result_type);
+				if (has_result && i.length > (has_result_type ? 1u : 0u))
+					renamed.push_back(stream(i)[has_result_type ? 1 : 0]);
+			}
+		}
+	});
+
+	// Global variables which are not resources or builtins are not visible through reflection.
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t id, const SPIRVariable &var) {
+		if ((var.storage == StorageClassPrivate || var.storage == StorageClassWorkgroup) &&
+		    !has_decoration(id, DecorationBuiltIn))
+			renamed.push_back(id);
+	});
+
+	sort(begin(renamed), end(renamed));
+	renamed.erase(unique(begin(renamed), end(renamed)), end(renamed));
+
+	// Everything else keeps its name, so none of those may be reused.
+	auto &reserved = glsl_reserved_names();
+	unordered_set<string> used;
+	for (uint32_t id = 0; id < uint32_t(ir.ids.size()); id++)
+		if (!binary_search(begin(renamed), end(renamed), id) && ir.find_meta(id))
+			used.insert(get_name(id));
+
+	uint32_t index = 0;
+	for (auto id : renamed)
+	{
+		string name;
+		do
+			name = minified_name(index++);
+		while (used.count(name) || reserved.count(name));
+
+		auto original_itr = minify_original_names.find(id);
+		if (original_itr == end(minify_original_names))
+			original_itr = minify_original_names.emplace(id, get_name(id)).first;
+		auto &original = original_itr->second;
+		minified_names[name] = original.empty() ? join("_", id) : original;
+		set_name(id, name);
+	}
+}
+
 void CompilerGLSL::fixup_type_alias()
 {
 	// Due to how some backends work, the "master" type of type_alias must be a block-like type if it exists.
@@ -18386,6 +19003,7 @@ CompilerGLSL::ShaderSubgroupSupportHelper::Result::Result()
 
 void CompilerGLSL::request_workaround_wrapper_overload(TypeID id)
 {
+	record_emission_request(EmissionRequest::WorkaroundOverload, id);
 	// Must be ordered to maintain deterministic output, so vector is appropriate.
 	if (find(begin(workaround_ubo_load_overload_types), end(workaround_ubo_load_overload_types), id) ==
 	    end(workaround_ubo_load_overload_types))
@@ -18486,6 +19104,20 @@ bool CompilerGLSL::is_stage_output_variable_masked(const SPIRVariable &var) cons
 	}
 }
 
+bool CompilerGLSL::is_stage_output_variable_declared_private(const SPIRVariable &var) const
+{
+	// Fragment outputs may be renamed to legacy builtins, and the per-vertex outputs of tessellation control shaders
+	// can be read by other invocations, so those remain outputs.
+	auto model = get_execution_model();
+	if (var.storage != StorageClassOutput || model == ExecutionModelFragment ||
+	    (model == ExecutionModelTessellationControl && !has_decoration(var.self, DecorationPatch)))
+	{
+		return false;
+	}
+
+	return is_stage_output_variable_masked(var);
+}
+
 bool CompilerGLSL::is_stage_output_block_member_masked(const SPIRVariable &var, uint32_t index, bool strip_array) const
 {
 	auto &type = get<SPIRType>(var.basetype);
@@ -145,6 +145,11 @@ public:
 		// compares.
 		bool relax_nan_checks = false;
 
+		// If non-zero, pure expressions which a block computes more than once from the same operands are computed
+		// once into a temporary, which the later copies read instead of inlining the expression again.
+		// Expressions made of fewer operations than this are still inlined at every use.
+		uint32_t common_subexpression_min_cost = 0;
+
 		// Loading row-major matrices from UBOs on older AMD Windows OpenGL drivers is problematic.
 		// To load these types correctly, we must generate a wrapper. them in a dummy function which only purpose is to
 		// ensure row_major decoration is actually respected.
@@ -154,6 +159,27 @@ public:
 		// If non-zero, controls layout(num_views = N) in; in GL_OVR_multiview2.
 		uint32_t ovr_multiview_view_count = 0;
 
+		// Emits compact source for size-sensitive targets such as WebGL.
+		// Indentation, comments and redundant whitespace are dropped, and locals, temporaries and
+		// functions other than the entry point get the shortest unused names.
+		// Resources, types and members keep their names, so reflection is unaffected.
+		bool minify = false;
+
+		// Vulkan GLSL only. Indexes images, samplers, acceleration structures and buffers which are not arrays
+		// out of runtime arrays in descriptor set descriptor_heap_set instead of binding them,
+		// with one array for each distinct resource type. The indices are read from a push constant block,
+		// so the shader must not declare push constants itself. See Compiler::get_descriptor_heap_slots().
+		bool descriptor_heap_indexing = false;
+		uint32_t descriptor_heap_set = 0;
+
+		// Constant lookup tables of 32-bit scalars which are at least this many bytes are declared as
+		// readonly std430 buffers in lut_buffer_set from lut_buffer_binding onwards instead of inline literals.
+		// The contents to upload are returned by Compiler::get_lowered_luts(). 0 disables this.
+		// Ignored for targets without storage buffers.
+		uint32_t lut_buffer_min_size = 0;
+		uint32_t lut_buffer_set = 0;
+		uint32_t lut_buffer_binding = 0;
+
 		enum Precision
 		{
 			DontCare,
@@ -237,11 +263,19 @@ public:
 	}
 
 	std::string compile() override;
+	void reset_for_recompile() override;
 
 	// Returns the current string held in the conversion buffer. Useful for
 	// capturing what has been converted so far when compile() throws an error.
 	std::string get_partial_source();
 
+	// After compile() with Options::minify, maps each minified name back to the name it replaced.
+	// IDs without a name in the SPIR-V map to the _<id> name they would otherwise have been emitted with.
+	const std::unordered_map<std::string, std::string> &get_minified_names() const
+	{
+		return minified_names;
+	}
+
 	// Adds a line to be added right after #version in GLSL backend.
 	// This is useful for enabling custom extensions which are outside the scope of SPIRV-Cross.
 	// This can be combined with variable remapping.
@@ -282,12 +316,16 @@ public:
 	// which plagues MSL and HLSL in certain scenarios.
 	// An output which matches one of these will not be emitted in stage output interfaces, but rather treated as a private
 	// variable.
-	// This option is only meaningful for MSL and HLSL, since GLSL matches by location directly.
+	// GLSL matches by location directly, so there this only saves the varying. It only applies to plain variables,
+	// except for fragment outputs and per-vertex outputs of tessellation control shaders, and not to builtins.
 	// Masking builtins only takes effect if the builtin in question is part of the stage output interface.
-	void mask_stage_output_by_location(uint32_t location, uint32_t component);
-	void mask_stage_output_by_builtin(spv::BuiltIn builtin);
+	void mask_stage_output_by_location(uint32_t location, uint32_t component) override;
+	void mask_stage_output_by_builtin(spv::BuiltIn builtin) override;
 
 protected:
+	// Only move-assigned by reset_for_recompile().
+	CompilerGLSL &operator=(CompilerGLSL &&other) = default;
+
 	struct ShaderSubgroupSupportHelper
 	{
 		// lower enum value = greater priority
@@ -568,6 +606,7 @@ protected:
 	void add_resource_name(uint32_t id);
 	void add_member_name(SPIRType &type, uint32_t name);
 	void add_function_overload(const SPIRFunction &func);
+	uint64_t hash_function_overload(const SPIRFunction &func) const;
 
 	virtual bool is_non_native_row_major_matrix(uint32_t id);
 	virtual bool member_is_non_native_row_major_matrix(const SPIRType &type, uint32_t index);
@@ -577,18 +616,89 @@ protected:
 	                                             uint32_t physical_type_id, bool is_packed,
 	                                             bool relaxed = false);
 
-	std::unordered_set<std::string> local_variable_names;
-	std::unordered_set<std::string> resource_names;
-	std::unordered_set<std::string> block_input_names;
-	std::unordered_set<std::string> block_output_names;
-	std::unordered_set<std::string> block_ubo_names;
-	std::unordered_set<std::string> block_ssbo_names;
-	std::unordered_set<std::string> block_names; // A union of all block_*_names.
+	NameCache local_variable_names;
+	NameCache resource_names;
+	NameCache block_input_names;
+	NameCache block_output_names;
+	NameCache block_ubo_names;
+	NameCache block_ssbo_names;
+	NameCache block_names; // A union of all block_*_names.
 	std::unordered_map<std::string, std::unordered_set<uint64_t>> function_overloads;
 	std::unordered_map<uint32_t, std::string> preserved_aliases;
 	void preserve_alias_on_reset(uint32_t id);
 	void reset_name_caches();
 
+	// Something emitting a function asked of the rest of the output, e.g. an extension to enable,
+	// so that reusing the code of the function can ask for it again.
+	struct EmissionRequest
+	{
+		enum Kind
+		{
+			Extension,
+			Polyfill,
+			RelaxedPolyfill,
+			SubgroupFeature,
+			WorkaroundOverload,
+			ReadableImage,
+			WritableImage
+		};
+
+		Kind kind;
+		uint32_t value;
+		std::string extension;
+	};
+	// Every request of the current pass, in order.
+	SmallVector<EmissionRequest> emission_requests;
+	void record_emission_request(EmissionRequest::Kind kind, uint32_t value, const std::string &extension = "");
+	void replay_emission_request(const EmissionRequest &request);
+	void require_image_access(uint32_t var_id, spv::Decoration qualifier);
+
+	struct EmittedFunction
+	{
+		std::string code;
+		// After claiming its overload.
+		std::string name;
+		Bitset return_flags;
+		SmallVector<EmissionRequest> requests;
+		ReusedFunction info;
+	};
+
+	// Output from an earlier pass which is still valid if a recompile only invalidated function-local state,
+	// e.g. forced temporaries or loop variables. Any other kind of recompile discards everything.
+	struct EmissionCache
+	{
+		// Header and resource declarations, and the name caches they leave behind.
+		std::string resources;
+		NameCache resource_names;
+		NameCache block_input_names;
+		NameCache block_output_names;
+		NameCache block_ubo_names;
+		NameCache block_ssbo_names;
+		NameCache block_names;
+		std::unordered_map<uint32_t, std::string> preserved_aliases;
+		std::unordered_map<uint32_t, std::string> resolved_aliases;
+		bool has_resources = false;
+
+		// Functions which were fully emitted before any recompile was requested in their pass.
+		std::unordered_map<uint32_t, EmittedFunction> functions;
+		// Functions which allocated IDs while being emitted in any pass. Their code refers to those IDs by name.
+		std::unordered_set<uint32_t> functions_allocating_ids;
+	};
+	EmissionCache emission_cache;
+	void save_resource_emission();
+	void restore_resource_emission();
+
+	// What the last compile() emitted. After reset_for_hot_reload(), what the previous compile() emitted
+	// for functions which did not change, until compile() replaces it.
+	struct ReusableEmission
+	{
+		std::string resources;
+		std::unordered_map<uint32_t, EmittedFunction> functions;
+	};
+	ReusableEmission reusable_emission;
+	bool can_reuse_function_emission(const SPIRFunction &func, const Bitset &return_flags,
+	                                 const EmittedFunction &emitted) const;
+
 	bool processing_entry_point = false;
 
 	// Can be overriden by subclass backends for trivial things which
@@ -928,6 +1038,11 @@ protected:
 	uint32_t required_polyfills = 0;
 	uint32_t required_polyfills_relaxed = 0;
 	void require_polyfill(Polyfill polyfill, bool relaxed);
+	void append_backend_resource_costs(ResourceCostReport &report) const override;
+	size_t get_output_block_count() const override
+	{
+		return buffer.get_block_count();
+	}
 
 	bool ray_tracing_is_khr = false;
 	bool barycentric_is_nv = false;
@@ -959,8 +1074,7 @@ protected:
 	// A variant which takes two sets of name. The secondary is only used to verify there are no collisions,
 	// but the set is not updated when we have found a new name.
 	// Used primarily when adding block interface names.
-	void add_variable(std::unordered_set<std::string> &variables_primary,
-	                  const std::unordered_set<std::string> &variables_secondary, std::string &name);
+	void add_variable(NameCache &variables_primary, const NameCache &variables_secondary, std::string &name);
 
 	void check_function_call_constraints(const uint32_t *args, uint32_t length);
 	void handle_invalid_expression(uint32_t id);
@@ -1018,11 +1132,24 @@ protected:
 	void fixup_anonymous_struct_names();
 	void fixup_anonymous_struct_names(std::unordered_set<uint32_t> &visited, const SPIRType &type);
 
+	void minify_names();
+	std::unordered_map<std::string, std::string> minified_names;
+	// Names minify_names() replaced, so that compiling again maps the short names to these rather than to themselves.
+	std::unordered_map<uint32_t, std::string> minify_original_names;
+
+	void analyze_descriptor_heap_indexing();
+	// Maps resources to their entry in descriptor_heap_slots.
+	std::unordered_map<uint32_t, uint32_t> descriptor_heap_slot_indices;
+	// Runtime arrays declared for the heap, indexed by DescriptorHeapSlot::heap_binding.
+	SmallVector<VariableID> descriptor_heap_variables;
+	uint32_t descriptor_heap_index_variable = 0;
+
 	static const char *vector_swizzle(int vecsize, int index);
 
 	bool is_stage_output_location_masked(uint32_t location, uint32_t component) const;
 	bool is_stage_output_builtin_masked(spv::BuiltIn builtin) const;
 	bool is_stage_output_variable_masked(const SPIRVariable &var) const;
+	bool is_stage_output_variable_declared_private(const SPIRVariable &var) const;
 	bool is_stage_output_block_member_masked(const SPIRVariable &var, uint32_t index, bool strip_array) const;
 	bool is_per_primitive_variable(const SPIRVariable &var) const;
 	uint32_t get_accumulated_member_location(const SPIRVariable &var, uint32_t mbr_idx, bool strip_array) const;
@@ -26,6 +26,7 @@
 #include "GLSL.std.450.h"
 #include <algorithm>
 #include <assert.h>
+#include <cmath>
 
 using namespace spv;
 using namespace SPIRV_CROSS_NAMESPACE;
@@ -125,29 +126,29 @@ static ImageFormatNormalizedState image_format_to_normalized_state(ImageFormat f
 	return ImageFormatNormalizedState::None;
 }
 
-static uint32_t pls_format_to_components(PlsFormat format)
+static uint32_t pls_format_to_components(CompilerHLSL::PlsFormat format)
 {
 	switch (format)
 	{
 	default:
-	case PlsR32F:
-	case PlsR32UI:
+	case CompilerHLSL::PlsFormat::PlsR32F:
+	case CompilerHLSL::PlsFormat::PlsR32UI:
 		return 1;
 
-	case PlsRG16F:
-	case PlsRG16:
-	case PlsRG16UI:
-	case PlsRG16I:
+	case CompilerHLSL::PlsFormat::PlsRG16F:
+	case CompilerHLSL::PlsFormat::PlsRG16:
+	case CompilerHLSL::PlsFormat::PlsRG16UI:
+	case CompilerHLSL::PlsFormat::PlsRG16I:
 		return 2;
 
-	case PlsR11FG11FB10F:
+	case CompilerHLSL::PlsFormat::PlsR11FG11FB10F:
 		return 3;
 
-	case PlsRGB10A2:
-	case PlsRGBA8:
-	case PlsRGBA8I:
-	case PlsRGB10A2UI:
-	case PlsRGBA8UI:
+	case CompilerHLSL::PlsFormat::PlsRGB10A2:
+	case CompilerHLSL::PlsFormat::PlsRGBA8:
+	case CompilerHLSL::PlsFormat::PlsRGBA8I:
+	case CompilerHLSL::PlsFormat::PlsRGB10A2UI:
+	case CompilerHLSL::PlsFormat::PlsRGBA8UI:
 		return 4;
 	}
 }
@@ -957,6 +958,8 @@ void CompilerHLSL::emit_builtin_outputs_in_struct()
 		const char *type = nullptr;
 		const char *semantic = nullptr;
 		auto builtin = static_cast<BuiltIn>(i);
+		if (is_stage_output_builtin_masked(builtin))
+			return;
 		switch (builtin)
 		{
 		case BuiltInPosition:
@@ -1702,7 +1705,7 @@ void CompilerHLSL::emit_composite_constants()
 	bool emitted = false;
 
 	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, SPIRConstant &c) {
-		if (c.specialization)
+		if (c.specialization || constant_is_duplicate(c.self))
 			return;
 
 		auto &type = this->get<SPIRType>(c.constant_type);
@@ -1714,7 +1717,18 @@ void CompilerHLSL::emit_composite_constants()
 		{
 			add_resource_name(c.self);
 			auto name = to_name(c.self);
-			statement("static const ", variable_decl(type, name), " = ", constant_expression(c), ";");
+
+			if (auto *lut = find_lowered_lut(c.self))
+			{
+				// The table is indexed out of a buffer of the same name instead.
+				string space;
+				if (hlsl_options.shader_model >= 51)
+					space = join(", space", lut->desc_set);
+				statement("StructuredBuffer<", type_to_glsl(get<SPIRType>(type.parent_type)), "> ", name,
+				          " : register(t", lut->binding, space, ");");
+			}
+			else
+				statement("static const ", variable_decl(type, name), " = ", constant_expression(c), ";");
 			emitted = true;
 		}
 	});
@@ -1884,6 +1898,7 @@ void CompilerHLSL::emit_resources()
 	emit_specialization_constants_and_structs();
 	emit_composite_constants();
 
+	descriptor_heap_declarations.clear();
 	bool emitted = false;
 
 	// Output UBOs and SSBOs
@@ -1898,7 +1913,9 @@ void CompilerHLSL::emit_resources()
 		    has_block_flags)
 		{
 			emit_buffer_block(var);
-			emitted = true;
+			// Heap resources are declared in the functions using them, and the heap index cbuffer ends with an empty line.
+			if (var.self != descriptor_heap_index_variable && !find_descriptor_heap_slot(var.self, false))
+				emitted = true;
 		}
 	});
 
@@ -1942,7 +1959,8 @@ void CompilerHLSL::emit_resources()
 		    !is_hidden_variable(var))
 		{
 			emit_uniform(var);
-			emitted = true;
+			if (!find_descriptor_heap_slot(var.self, type.basetype == SPIRType::Sampler))
+				emitted = true;
 		}
 	});
 
@@ -2006,7 +2024,7 @@ void CompilerHLSL::emit_resources()
 					uint32_t location = get_declared_member_location(var, i, false);
 					if (var.storage == StorageClassInput)
 						input_variables.push_back({ &var, location, i, true });
-					else
+					else if (execution.model == ExecutionModelMeshEXT || !is_stage_output_block_member_masked(var, i, false))
 						output_variables.push_back({ &var, location, i, true });
 				}
 			}
@@ -2015,7 +2033,7 @@ void CompilerHLSL::emit_resources()
 				uint32_t location = get_decoration(var.self, DecorationLocation);
 				if (var.storage == StorageClassInput)
 					input_variables.push_back({ &var, location, 0, false });
-				else
+				else if (execution.model == ExecutionModelMeshEXT || !is_stage_output_variable_masked(var))
 					output_variables.push_back({ &var, location, 0, false });
 			}
 		}
@@ -2762,12 +2780,16 @@ void CompilerHLSL::emit_buffer_block(const SPIRVariable &var)
 			type_name = is_readonly ? "ByteAddressBuffer" : is_interlocked ? "RasterizerOrderedByteAddressBuffer" : "RWByteAddressBuffer";
 
 		add_resource_name(var.self);
+		auto *old_redirect = redirect_statement;
+		redirect_statement = descriptor_heap_redirect(var.self);
 		statement(is_coherent ? "globallycoherent " : "", type_name, " ", to_name(var.self), type_to_array_glsl(type),
 		          to_resource_binding(var), ";");
+		redirect_statement = old_redirect;
 	}
 	else
 	{
-		if (type.array.empty())
+		// Descriptor heap resources are declared as locals, which cannot be cbuffers.
+		if (type.array.empty() && !find_descriptor_heap_slot(var.self, false))
 		{
 			// Flatten the top-level struct so we can use packoffset,
 			// this restriction is similar to GLSL where layout(offset) is not possible on sub-structs.
@@ -2813,9 +2835,19 @@ void CompilerHLSL::emit_buffer_block(const SPIRVariable &var)
 			statement("cbuffer ", buffer_name, to_resource_binding(var));
 			begin_scope();
 
+			// Root constants only hold the values up to the last accessed member.
+			auto *root = find_promoted_root_constants(var.self);
+			uint32_t member_end = root ? root->num_dwords * 4 : UINT32_MAX;
+
 			uint32_t i = 0;
 			for (auto &member : type.member_types)
 			{
+				if (type_struct_member_offset(type, i) >= member_end)
+				{
+					i++;
+					continue;
+				}
+
 				add_member_name(type, i);
 				auto backup_name = get_member_name(type.self, i);
 				auto member_name = to_member_name(type, i);
@@ -2849,8 +2881,11 @@ void CompilerHLSL::emit_buffer_block(const SPIRVariable &var)
 			}
 
 			emit_struct(get<SPIRType>(type.self));
+			auto *old_redirect = redirect_statement;
+			redirect_statement = descriptor_heap_redirect(var.self);
 			statement("ConstantBuffer<", to_name(type.self), "> ", to_name(var.self), type_to_array_glsl(type),
 			          to_resource_binding(var), ";");
+			redirect_statement = old_redirect;
 		}
 	}
 }
@@ -3348,7 +3383,7 @@ void CompilerHLSL::emit_hlsl_entry_point()
 		// Copy builtins from globals to return struct.
 		active_output_builtins.for_each_bit([&](uint32_t i) {
 			// PointSize doesn't exist in HLSL SM 4+.
-			if (i == BuiltInPointSize && !legacy)
+			if ((i == BuiltInPointSize && !legacy) || is_stage_output_builtin_masked(BuiltIn(i)))
 				return;
 
 			switch (static_cast<BuiltIn>(i))
@@ -3392,12 +3427,15 @@ void CompilerHLSL::emit_hlsl_entry_point()
 					auto var_name = to_name(var.self);
 					for (uint32_t mbr_idx = 0; mbr_idx < uint32_t(type.member_types.size()); mbr_idx++)
 					{
+						if (is_stage_output_block_member_masked(var, mbr_idx, false))
+							continue;
+
 						auto mbr_name = to_member_name(type, mbr_idx);
 						auto flat_name = join(type_name, "_", mbr_name);
 						statement("stage_output.", flat_name, " = ", var_name, ".", mbr_name, ";");
 					}
 				}
-				else
+				else if (!is_stage_output_variable_masked(var))
 				{
 					auto name = to_name(var.self);
 
@@ -3920,6 +3958,10 @@ string CompilerHLSL::to_resource_binding(const SPIRVariable &var)
 {
 	const auto &type = get<SPIRType>(var.basetype);
 
+	bool is_sampler = type.basetype == SPIRType::Sampler;
+	if (find_descriptor_heap_slot(var.self, is_sampler))
+		return to_descriptor_heap_load(var, is_sampler);
+
 	// We can remap push constant blocks, even if they don't have any binding decoration.
 	if (type.storage != StorageClassPushConstant && !has_decoration(var.self, DecorationBinding))
 		return "";
@@ -4021,6 +4063,9 @@ string CompilerHLSL::to_resource_binding(const SPIRVariable &var)
 
 string CompilerHLSL::to_resource_binding_sampler(const SPIRVariable &var)
 {
+	if (find_descriptor_heap_slot(var.self, true))
+		return to_descriptor_heap_load(var, true);
+
 	// For combined image samplers.
 	if (!has_decoration(var.self, DecorationBinding))
 		return "";
@@ -4131,10 +4176,14 @@ void CompilerHLSL::emit_modern_uniform(const SPIRVariable &var)
 void CompilerHLSL::emit_uniform(const SPIRVariable &var)
 {
 	add_resource_name(var.self);
+
+	auto *old_redirect = redirect_statement;
+	redirect_statement = descriptor_heap_redirect(var.self);
 	if (hlsl_options.shader_model >= 40)
 		emit_modern_uniform(var);
 	else
 		emit_legacy_uniform(var);
+	redirect_statement = old_redirect;
 }
 
 bool CompilerHLSL::emit_complex_bitcast(uint32_t, uint32_t, uint32_t)
@@ -5774,6 +5823,235 @@ void CompilerHLSL::set_root_constant_layouts(std::vector<RootConstants> layout)
 	root_constants_layout = std::move(layout);
 }
 
+const std::vector<HLSLPromotedRootConstants> &CompilerHLSL::get_promoted_root_constants() const
+{
+	return promoted_root_constants;
+}
+
+string CompilerHLSL::get_promoted_root_constants_root_signature() const
+{
+	string signature;
+	for (auto &root : promoted_root_constants)
+	{
+		if (!signature.empty())
+			signature += ", ";
+		signature += join("RootConstants(num32BitConstants=", root.num_dwords, ", b", root.register_binding,
+		                  ", space=", root.register_space, ")");
+	}
+	return signature;
+}
+
+const HLSLPromotedRootConstants *CompilerHLSL::find_promoted_root_constants(uint32_t id) const
+{
+	for (auto &root : promoted_root_constants)
+		if (root.id == id)
+			return &root;
+	return nullptr;
+}
+
+void CompilerHLSL::analyze_root_constant_promotion()
+{
+	promoted_root_constants.clear();
+	if (hlsl_options.root_constant_promotion_dword_budget == 0)
+		return;
+
+	if (hlsl_options.shader_model < 51)
+		SPIRV_CROSS_THROW("Promoting cbuffers to root constants requires SM 5.1.");
+
+	// Without an explicit register, the root signature cannot refer to the cbuffer.
+	if (resource_binding_flags & HLSL_BINDING_AUTO_CBV_BIT)
+		return;
+
+	SmallVector<HLSLPromotedRootConstants> candidates;
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
+		auto &type = get<SPIRType>(var.basetype);
+		if (var.storage != StorageClassUniform || !has_decoration(type.self, DecorationBlock) ||
+		    !type.array.empty() || is_hidden_variable(var) || flattened_buffer_blocks.count(var.self) ||
+		    !has_decoration(var.self, DecorationBinding) || find_descriptor_heap_slot(var.self, false))
+		{
+			return;
+		}
+
+		uint32_t used_size = 0;
+		for (auto &range : get_active_buffer_ranges(var.self))
+			used_size = max(used_size, uint32_t(range.offset + range.range));
+		if (used_size == 0)
+			return;
+
+		HLSLPromotedRootConstants root = {};
+		root.id = var.self;
+		root.desc_set = get_decoration(var.self, DecorationDescriptorSet);
+		root.binding = get_decoration(var.self, DecorationBinding);
+		root.register_space = root.desc_set;
+		root.register_binding = root.binding;
+		remap_hlsl_resource_binding(HLSL_BINDING_AUTO_CBV_BIT, root.register_space, root.register_binding);
+		root.num_dwords = (used_size + 3) / 4;
+		candidates.push_back(root);
+	});
+
+	sort(begin(candidates), end(candidates),
+	     [](const HLSLPromotedRootConstants &a, const HLSLPromotedRootConstants &b) {
+		     return a.num_dwords != b.num_dwords ? a.num_dwords < b.num_dwords : a.id < b.id;
+	     });
+
+	uint32_t budget = hlsl_options.root_constant_promotion_dword_budget;
+	for (auto &root : candidates)
+	{
+		if (root.num_dwords > budget)
+			break;
+		budget -= root.num_dwords;
+		promoted_root_constants.push_back(root);
+	}
+}
+
+const DescriptorHeapSlot *CompilerHLSL::find_descriptor_heap_slot(uint32_t id, bool sampler_heap) const
+{
+	for (auto &slot : descriptor_heap_slots)
+		if (slot.id == id && slot.sampler_heap == sampler_heap)
+			return &slot;
+	return nullptr;
+}
+
+string CompilerHLSL::to_descriptor_heap_load(const SPIRVariable &var, bool sampler_heap)
+{
+	auto &slot = *find_descriptor_heap_slot(var.self, sampler_heap);
+	auto &index_var = get<SPIRVariable>(descriptor_heap_index_variable);
+
+	// Same name as the member of the flattened cbuffer.
+	auto index = join(to_name(index_var.self), "_", to_member_name(get_variable_data_type(index_var), slot.index));
+	ParsedIR::sanitize_underscores(index);
+	return join(" = ", sampler_heap ? "SamplerDescriptorHeap[" : "ResourceDescriptorHeap[", index, "]");
+}
+
+SmallVector<string> *CompilerHLSL::descriptor_heap_redirect(uint32_t id)
+{
+	if (find_descriptor_heap_slot(id, false) || find_descriptor_heap_slot(id, true))
+		return &descriptor_heap_declarations[id];
+	else
+		return redirect_statement;
+}
+
+void CompilerHLSL::analyze_descriptor_heap_indexing()
+{
+	if (!hlsl_options.descriptor_heap_indexing)
+	{
+		descriptor_heap_slots.clear();
+		return;
+	}
+
+	if (hlsl_options.shader_model < 66)
+		SPIRV_CROSS_THROW("Indexing descriptor heaps requires SM 6.6.");
+
+	// Only set up the index cbuffer and function hooks once.
+	if (descriptor_heap_index_variable)
+		return;
+
+	// Separate images and samplers are not declared when they are combined.
+	bool skip_separate_image_sampler = !combined_image_samplers.empty();
+
+	SmallVector<string> member_names;
+	ir.for_each_typed_id<SPIRVariable>([&](uint32_t, const SPIRVariable &var) {
+		auto &type = get<SPIRType>(var.basetype);
+		if (!type.pointer || !type.array.empty() || is_hidden_variable(var) ||
+		    !has_decoration(var.self, DecorationBinding))
+		{
+			return;
+		}
+
+		bool has_block_flags = has_decoration(type.self, DecorationBlock) || has_decoration(type.self, DecorationBufferBlock);
+		bool is_buffer = (var.storage == StorageClassUniform || var.storage == StorageClassStorageBuffer) &&
+		                 has_block_flags && !flattened_buffer_blocks.count(var.self);
+
+		// cbuffers become ConstantBuffer<T>, which does not support packoffset.
+		if (is_buffer && var.storage == StorageClassUniform && has_decoration(type.self, DecorationBlock) &&
+		    !buffer_is_packing_standard(type, BufferPackingHLSLCbuffer))
+		{
+			return;
+		}
+
+		bool is_resource = false;
+		if (var.storage == StorageClassUniformConstant)
+		{
+			switch (type.basetype)
+			{
+			case SPIRType::Image:
+				is_resource = !skip_separate_image_sampler || type.image.dim == DimBuffer || type.image.sampled != 1;
+				break;
+			case SPIRType::Sampler:
+				is_resource = !skip_separate_image_sampler;
+				break;
+			case SPIRType::SampledImage:
+			case SPIRType::AccelerationStructure:
+				is_resource = true;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (!is_buffer && !is_resource)
+			return;
+
+		DescriptorHeapSlot slot = {};
+		slot.id = var.self;
+		slot.desc_set = get_decoration(var.self, DecorationDescriptorSet);
+		slot.binding = get_decoration(var.self, DecorationBinding);
+
+		if (type.basetype != SPIRType::Sampler)
+		{
+			slot.index = uint32_t(member_names.size());
+			descriptor_heap_slots.push_back(slot);
+			member_names.push_back(to_name(var.self));
+		}
+
+		if (type.basetype == SPIRType::Sampler || (type.basetype == SPIRType::SampledImage && type.image.dim != DimBuffer))
+		{
+			slot.sampler_heap = true;
+			slot.index = uint32_t(member_names.size());
+			descriptor_heap_slots.push_back(slot);
+			member_names.push_back(type.basetype == SPIRType::Sampler ? to_name(var.self) : join(to_name(var.self), "_sampler"));
+		}
+	});
+
+	if (descriptor_heap_slots.empty())
+		return;
+
+	descriptor_heap_index_variable =
+	    add_uint_block_variable("SPIRV_Cross_DescriptorHeapIndices", member_names, StorageClassUniform);
+	set_decoration(descriptor_heap_index_variable, DecorationDescriptorSet, hlsl_options.descriptor_heap_index_space);
+	set_decoration(descriptor_heap_index_variable, DecorationBinding, hlsl_options.descriptor_heap_index_register);
+
+	// Each function using a heap resource loads it into a local of the same name as the global it replaces.
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t, SPIRFunction &func) {
+		SmallVector<uint32_t> used_ids;
+		for (auto block : func.blocks)
+		{
+			for (auto &i : get<SPIRBlock>(block).ops)
+			{
+				auto *ops = stream(i);
+				for (uint32_t j = 0; j < i.length; j++)
+				{
+					if ((find_descriptor_heap_slot(ops[j], false) || find_descriptor_heap_slot(ops[j], true)) &&
+					    find(begin(used_ids), end(used_ids), ops[j]) == end(used_ids))
+					{
+						used_ids.push_back(ops[j]);
+					}
+				}
+			}
+		}
+
+		if (used_ids.empty())
+			return;
+
+		sort(begin(used_ids), end(used_ids));
+		func.fixup_hooks_in.push_back([this, used_ids]() {
+			for (auto id : used_ids)
+				for (auto &line : descriptor_heap_declarations[id])
+					statement(line);
+		});
+	});
+}
+
 void CompilerHLSL::add_vertex_attribute_remap(const HLSLVertexAttributeRemap &vertex_attributes)
 {
 	remap_vertex_attributes.push_back(vertex_attributes);
@@ -5810,8 +6088,19 @@ void CompilerHLSL::validate_shader_model()
 		SPIRV_CROSS_THROW("Need at least shader model 6.2 when enabling native 16-bit type support.");
 }
 
+void CompilerHLSL::reset_for_recompile()
+{
+	CompilerHLSL fresh{ ParsedIR() };
+	fresh.options = options;
+	fresh.hlsl_options = hlsl_options;
+	fresh.keep_state_for_recompile(*this);
+	*this = std::move(fresh);
+}
+
 string CompilerHLSL::compile()
 {
+	CompileBudgetTracker::Scope budget_scope(compile_budget);
+	save_recompile_snapshot();
 	ir.fixup_reserved_names();
 
 	// Do not deal with ES-isms like precision, older extensions and such.
@@ -5846,21 +6135,33 @@ string CompilerHLSL::compile()
 	// SM 4.1 does not support precise for some reason.
 	backend.support_precise_qualifier = hlsl_options.shader_model >= 50 || hlsl_options.shader_model == 40;
 
-	fixup_anonymous_struct_names();
-	fixup_type_alias();
-	reorder_type_alias();
-	build_function_control_flow_graphs_and_analyze();
-	validate_shader_model();
-	update_active_builtins();
-	analyze_image_and_sampler_usage();
-	analyze_interlocked_resource_usage();
+	profile_pass("specialize_constants", [&] { specialize_constants(); });
+	profile_pass("fixup_anonymous_struct_names", [&] { fixup_anonymous_struct_names(); });
+	profile_pass("fixup_type_alias", [&] { fixup_type_alias(); });
+	profile_pass("reorder_type_alias", [&] { reorder_type_alias(); });
+	if (hlsl_options.relaxed_precision_as_16bit)
+		profile_pass("lower_relaxed_precision_to_16bit", [&] { lower_relaxed_precision_to_16bit(); });
+	if (options.common_subexpression_min_cost)
+		profile_pass("eliminate_common_subexpressions",
+		             [&] { eliminate_common_subexpressions(options.common_subexpression_min_cost); });
+	profile_pass("build_function_control_flow_graphs_and_analyze",
+	             [&] { build_function_control_flow_graphs_and_analyze(); });
+	lower_luts_to_buffers(hlsl_options.shader_model >= 50 ? hlsl_options.lut_buffer_min_size : 0,
+	                      hlsl_options.lut_buffer_space, hlsl_options.lut_buffer_register);
+	profile_pass("validate_shader_model", [&] { validate_shader_model(); });
+	profile_pass("update_active_builtins_and_analyze_image_and_sampler_usage",
+	             [&] { update_active_builtins_and_analyze_image_and_sampler_usage(); });
+	profile_pass("analyze_interlocked_resource_usage", [&] { analyze_interlocked_resource_usage(); });
+	profile_pass("analyze_descriptor_heap_indexing", [&] { analyze_descriptor_heap_indexing(); });
+	profile_pass("analyze_root_constant_promotion", [&] { analyze_root_constant_promotion(); });
 	if (get_execution_model() == ExecutionModelMeshEXT)
-		analyze_meshlet_writes();
+		profile_pass("analyze_meshlet_writes", [&] { analyze_meshlet_writes(); });
 
 	// Subpass input needs SV_Position.
 	if (need_subpass_input)
 		active_input_builtins.set(BuiltInFragCoord);
 
+	PassProfiler emit_profiler(*this, "emit");
 	uint32_t pass_count = 0;
 	do
 	{
@@ -5877,11 +6178,12 @@ string CompilerHLSL::compile()
 
 		pass_count++;
 	} while (is_forcing_recompilation());
+	emit_profiler.finish(pass_count);
 
 	// Entry point in HLSL is always main() for the time being.
 	get_entry_point().name = "main";
 
-	return buffer.str();
+	return finish_output(buffer);
 }
 
 void CompilerHLSL::emit_block_hints(const SPIRBlock &block)
@@ -6026,10 +6328,19 @@ string CompilerHLSL::constant_expression(const SPIRConstant &c,
 			res = type_to_glsl_constructor(type) + "(";
 		}
 
+		// Large tables are mostly flat arrays of scalars, which are formatted directly.
+		bool scalar_table = constant_is_scalar_table(c);
+		if (scalar_table)
+			res.reserve(res.size() + c.subconstants.size() * 8);
+
 		uint32_t subconstant_index = 0;
 		for (auto &elem : c.subconstants)
 		{
-			if (auto *op = maybe_get<SPIRConstantOp>(elem))
+			if (scalar_table)
+			{
+				res += constant_expression_vector(get<SPIRConstant>(elem), 0);
+			}
+			else if (auto *op = maybe_get<SPIRConstantOp>(elem))
 			{
 				res += constant_op_expression(*op);
 			}
@@ -6282,9 +6593,9 @@ string CompilerHLSL::to_expression(uint32_t id, bool register_expression_read)
 		else if (c.is_used_as_lut)
 			return to_name(id);
 		else if (type.basetype == SPIRType::Struct && !backend.can_declare_struct_inline)
-			return to_name(id);
+			return to_name(get_canonical_constant(id));
 		else if (!type.array.empty() && !backend.can_declare_arrays_inline)
-			return to_name(id);
+			return to_name(get_canonical_constant(id));
 		else
 			return constant_expression(c);
 	}
@@ -6459,6 +6770,49 @@ void CompilerHLSL::emit_struct(SPIRType &type)
 		statement("");
 }
 
+void CompilerHLSL::mask_stage_output_by_location(uint32_t location, uint32_t component)
+{
+	masked_output_locations.insert({ location, component });
+}
+
+void CompilerHLSL::mask_stage_output_by_builtin(BuiltIn builtin)
+{
+	masked_output_builtins.insert(builtin);
+}
+
+bool CompilerHLSL::is_stage_output_location_masked(uint32_t location, uint32_t component) const
+{
+	return masked_output_locations.count({ location, component }) != 0;
+}
+
+bool CompilerHLSL::is_stage_output_builtin_masked(BuiltIn builtin) const
+{
+	return masked_output_builtins.count(builtin) != 0;
+}
+
+bool CompilerHLSL::is_stage_output_variable_masked(const SPIRVariable &var) const
+{
+	// Blocks by themselves are never masked. Must be masked per-member.
+	if (var.storage != StorageClassOutput || has_decoration(get<SPIRType>(var.basetype).self, DecorationBlock) ||
+	    !has_decoration(var.self, DecorationLocation))
+	{
+		return false;
+	}
+
+	return is_stage_output_location_masked(get_decoration(var.self, DecorationLocation),
+	                                       get_decoration(var.self, DecorationComponent));
+}
+
+bool CompilerHLSL::is_stage_output_block_member_masked(const SPIRVariable &var, uint32_t index, bool strip_array) const
+{
+	auto &type = get<SPIRType>(var.basetype);
+	if (var.storage != StorageClassOutput || !has_decoration(type.self, DecorationBlock))
+		return false;
+
+	return is_stage_output_location_masked(get_declared_member_location(var, index, strip_array),
+	                                       get_member_decoration(type.self, index, DecorationComponent));
+}
+
 bool CompilerHLSL::is_per_primitive_variable(const SPIRVariable &var) const
 {
 	if (has_decoration(var.self, DecorationPerPrimitiveEXT))
@@ -6532,8 +6886,7 @@ string CompilerHLSL::to_unpacked_expression(uint32_t id, bool register_expressio
 		return to_expression(id, register_expression_read);
 }
 
-void CompilerHLSL::add_variable(unordered_set<string> &variables_primary,
-                                const unordered_set<string> &variables_secondary, string &name)
+void CompilerHLSL::add_variable(NameCache &variables_primary, const NameCache &variables_secondary, string &name)
 {
 	if (name.empty())
 		return;
@@ -9238,6 +9591,7 @@ void CompilerHLSL::emit_block_instructions(SPIRBlock &block)
 
 	for (auto &op : block.ops)
 	{
+		compile_budget.check();
 		auto temporary_copy = handle_instruction_precision(op);
 		emit_instruction(op);
 		if (temporary_copy.dst_id)
@@ -12326,7 +12680,7 @@ void CompilerHLSL::CompilerGLSL_emit_instruction(const Instruction &instruction)
 		auto *var = maybe_get<SPIRVariable>(ops[0]);
 
 		if (var && var->statically_assigned)
-			var->static_expression = ops[1];
+			var->static_expression = get_canonical_constant(ops[1]);
 		else if (var && var->loop_variable && !var->loop_variable_enable)
 			var->static_expression = ops[1];
 		else if (var && var->remapped_variable && var->static_expression)
@@ -12852,6 +13206,11 @@ void CompilerHLSL::CompilerGLSL_emit_instruction(const Instruction &instruction)
 			auto &e = set<SPIRCombinedImageSampler>(id, *imgsamp);
 			e.self = id;
 		}
+		else if (common_subexpressions.count(id))
+		{
+			// Computes the same value as rhs, which is bound to a temporary, so just refer to it.
+			emit_op(result_type, id, to_expression(rhs), true, true);
+		}
 		else if (expression_is_lvalue(rhs) && !pointer)
 		{
 			// Need a copy.
@@ -16169,6 +16528,25 @@ bool CompilerHLSL::should_suppress_usage_tracking(uint32_t id) const
 	return !expression_is_forwarded(id) || expression_suppresses_usage_tracking(id);
 }
 
+void CompilerHLSL::flatten_buffer_block(VariableID id)
+{
+	auto &var = get<SPIRVariable>(id);
+	auto &type = get<SPIRType>(var.basetype);
+	auto name = to_name(type.self, false);
+	auto &flags = get_decoration_bitset(type.self);
+
+	if (!type.array.empty())
+		SPIRV_CROSS_THROW(name + " is an array of UBOs.");
+	if (type.basetype != SPIRType::Struct)
+		SPIRV_CROSS_THROW(name + " is not a struct.");
+	if (!flags.get(DecorationBlock))
+		SPIRV_CROSS_THROW(name + " is not a block.");
+	if (type.member_types.empty())
+		SPIRV_CROSS_THROW(name + " is an empty struct.");
+
+	flattened_buffer_blocks.insert(id);
+}
+
 #ifndef SPIRV_CROSS_WEBMIN
 CompilerHLSL::ShaderSubgroupSupportHelper::Result::Result()
 {
@@ -16687,6 +17065,36 @@ void CompilerHLSL::read_access_chain_array(const string &lhs, const SPIRAccessCh
 	end_scope();
 }
 
+// Counts how many members starting at index are 32-bit scalars or vectors packed back to back
+// within one 16-byte row, so a single Load2/3/4 or Store2/3/4 can cover all of them.
+uint32_t CompilerHLSL::coalesced_access_chain_member_count(const SPIRType &type, uint32_t index,
+                                                           uint32_t static_index) const
+{
+	uint32_t member_count = uint32_t(type.member_types.size());
+	uint32_t first_offset = static_index + type_struct_member_offset(type, index);
+	uint32_t components = 0;
+	uint32_t count = 0;
+
+	for (uint32_t i = index; i < member_count; i++)
+	{
+		auto &member_type = get<SPIRType>(type.member_types[i]);
+		if (!member_type.array.empty() || member_type.columns != 1 || member_type.width != 32 ||
+		    (member_type.basetype != SPIRType::Float && member_type.basetype != SPIRType::Int &&
+		     member_type.basetype != SPIRType::UInt))
+			break;
+
+		uint32_t offset = static_index + type_struct_member_offset(type, i);
+		if (offset != first_offset + components * 4 || components + member_type.vecsize > 4 ||
+		    (first_offset / 16) != (offset + member_type.vecsize * 4 - 1) / 16)
+			break;
+
+		components += member_type.vecsize;
+		count++;
+	}
+
+	return count;
+}
+
 void CompilerHLSL::read_access_chain_struct(const string &lhs, const SPIRAccessChain &chain)
 {
 	auto &type = get<SPIRType>(chain.basetype);
@@ -16695,6 +17103,43 @@ void CompilerHLSL::read_access_chain_struct(const string &lhs, const SPIRAccessC
 
 	for (uint32_t i = 0; i < member_count; i++)
 	{
+		uint32_t coalesced_count = coalesced_access_chain_member_count(type, i, chain.static_index);
+		if (coalesced_count > 1)
+		{
+			string base = chain.base;
+			if (has_decoration(chain.self, DecorationNonUniform))
+				convert_non_uniform_expression(base, chain.self);
+
+			SPIRType target_type;
+			target_type.basetype = SPIRType::UInt;
+			target_type.vecsize = 0;
+			for (uint32_t j = i; j < i + coalesced_count; j++)
+				target_type.vecsize += get<SPIRType>(type.member_types[j]).vecsize;
+
+			auto ident = get_unique_identifier();
+			statement(type_to_glsl(target_type), " ", ident, " = ", base, ".Load", target_type.vecsize, "(",
+			          chain.dynamic_index, chain.static_index + type_struct_member_offset(type, i), ");");
+
+			uint32_t component = 0;
+			for (uint32_t j = i; j < i + coalesced_count; j++)
+			{
+				auto &member_type = get<SPIRType>(type.member_types[j]);
+				SPIRType member_target_type;
+				member_target_type.basetype = SPIRType::UInt;
+				member_target_type.vecsize = member_type.vecsize;
+
+				auto load_expr = join(ident, ".", string("xyzw").substr(component, member_type.vecsize));
+				auto bitcast_op = bitcast_glsl_op(member_type, member_target_type);
+				if (!bitcast_op.empty())
+					load_expr = join(bitcast_op, "(", load_expr, ")");
+				statement(lhs, ".", to_member_name(type, j), " = ", load_expr, ";");
+				component += member_type.vecsize;
+			}
+
+			i += coalesced_count - 1;
+			continue;
+		}
+
 		uint32_t offset = type_struct_member_offset(type, i);
 		subchain.static_index = chain.static_index + offset;
 		subchain.basetype = type.member_types[i];
@@ -16951,6 +17396,45 @@ void CompilerHLSL::write_access_chain_struct(const SPIRAccessChain &chain, uint3
 
 	for (uint32_t i = 0; i < member_count; i++)
 	{
+		uint32_t coalesced_count = coalesced_access_chain_member_count(type, i, chain.static_index);
+		if (coalesced_count > 1)
+		{
+			auto base = chain.base;
+			if (has_decoration(chain.self, DecorationNonUniform))
+				convert_non_uniform_expression(base, chain.self);
+
+			SPIRType target_type;
+			target_type.basetype = SPIRType::UInt;
+			target_type.vecsize = 0;
+
+			string store_expr;
+			for (uint32_t j = i; j < i + coalesced_count; j++)
+			{
+				auto &member_type = get<SPIRType>(type.member_types[j]);
+				SPIRType member_target_type;
+				member_target_type.basetype = SPIRType::UInt;
+				member_target_type.vecsize = member_type.vecsize;
+				target_type.vecsize += member_type.vecsize;
+
+				subcomposite_chain.back() = j;
+				auto member_expr = write_access_chain_value(value, subcomposite_chain, false);
+				auto bitcast_op = bitcast_glsl_op(member_target_type, member_type);
+				if (!bitcast_op.empty())
+					member_expr = join(bitcast_op, "(", member_expr, ")");
+
+				if (!store_expr.empty())
+					store_expr += ", ";
+				store_expr += member_expr;
+			}
+
+			statement(base, ".Store", target_type.vecsize, "(", chain.dynamic_index,
+			          chain.static_index + type_struct_member_offset(type, i), ", ", type_to_glsl(target_type), "(",
+			          store_expr, "));");
+
+			i += coalesced_count - 1;
+			continue;
+		}
+
 		uint32_t offset = type_struct_member_offset(type, i);
 		subchain.static_index = chain.static_index + offset;
 		subchain.basetype = type.member_types[i];
@@ -18971,6 +19455,34 @@ void CompilerHLSL::require_polyfill(Polyfill polyfill, bool relaxed)
 	}
 }
 
+void CompilerHLSL::append_backend_resource_costs(ResourceCostReport &report) const
+{
+	const pair<bool, const char *> helpers[] = {
+		{ requires_op_fmod, "FMod" },
+		{ requires_fp16_packing, "FP16Packing" },
+		{ requires_uint2_packing, "Uint2Packing" },
+		{ requires_explicit_fp16_packing, "ExplicitFP16Packing" },
+		{ requires_unorm8_packing, "Unorm8Packing" },
+		{ requires_snorm8_packing, "Snorm8Packing" },
+		{ requires_unorm16_packing, "Unorm16Packing" },
+		{ requires_snorm16_packing, "Snorm16Packing" },
+		{ requires_bitfield_insert, "BitfieldInsert" },
+		{ requires_bitfield_extract, "BitfieldExtract" },
+		{ requires_inverse_2x2, "Inverse2x2" },
+		{ requires_inverse_3x3, "Inverse3x3" },
+		{ requires_inverse_4x4, "Inverse4x4" },
+		{ requires_scalar_reflect, "ScalarReflect" },
+		{ requires_scalar_refract, "ScalarRefract" },
+		{ requires_scalar_faceforward, "ScalarFaceForward" },
+	};
+
+	for (auto &helper : helpers)
+		if (helper.first)
+			report.helper_functions.push_back(helper.second);
+
+	append_polyfill_costs(report, required_polyfills, required_polyfills_relaxed);
+}
+
 string CompilerHLSL::load_flattened_struct(const string &basename, const SPIRType &type)
 {
 	auto expr = type_to_glsl_constructor(type);
@@ -20688,6 +21200,12 @@ void CompilerHLSL::require_polyfill(Polyfill, bool)
 	SPIRV_CROSS_THROW("Invalid call.");
 }
 
+void CompilerHLSL::append_backend_resource_costs(ResourceCostReport &) const
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
 string CompilerHLSL::load_flattened_struct(const string &, const SPIRType &)
 {
 	SPIRV_CROSS_INVALID_CALL();
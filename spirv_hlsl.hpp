@@ -51,30 +51,20 @@ struct RootConstants
 	uint32_t space;
 };
 
-enum PlsFormat
+// A cbuffer promoted to root constants by Options::root_constant_promotion_dword_budget.
+// Instead of binding a CBV, the first num_dwords 32-bit values of the buffer are uploaded
+// with SetGraphicsRoot32BitConstants or SetComputeRoot32BitConstants.
+struct HLSLPromotedRootConstants
 {
-	PlsNone = 0,
-
-	PlsR11FG11FB10F,
-	PlsR32F,
-	PlsRG16F,
-	PlsRGB10A2,
-	PlsRGBA8,
-	PlsRG16,
-
-	PlsRGBA8I,
-	PlsRG16I,
-
-	PlsRGB10A2UI,
-	PlsRGBA8UI,
-	PlsRG16UI,
-	PlsR32UI
-};
+	VariableID id;
+	uint32_t desc_set;
+	uint32_t binding;
 
-struct PlsRemap
-{
-	uint32_t id;
-	PlsFormat format;
+	// The b register the cbuffer is declared with.
+	uint32_t register_space;
+	uint32_t register_binding;
+
+	uint32_t num_dwords;
 };
 
 // For finer control, decorations may be removed from specific resources instead with unset_decoration().
@@ -135,6 +125,32 @@ enum HLSLAuxBinding
 class CompilerHLSL : public Compiler
 {
 public:
+	enum PlsFormat
+	{
+		PlsNone = 0,
+
+		PlsR11FG11FB10F,
+		PlsR32F,
+		PlsRG16F,
+		PlsRGB10A2,
+		PlsRGBA8,
+		PlsRG16,
+
+		PlsRGBA8I,
+		PlsRG16I,
+
+		PlsRGB10A2UI,
+		PlsRGBA8UI,
+		PlsRG16UI,
+		PlsR32UI
+	};
+
+	struct PlsRemap
+	{
+		uint32_t id;
+		PlsFormat format;
+	};
+
 	struct Options
 	{
 		uint32_t shader_model = 30; // TODO: map ps_4_0_level_9_0,... somehow
@@ -179,6 +195,32 @@ public:
 		// This relies on UserTypeGOOGLE to encode the buffer type either as "structuredbuffer" or "rwstructuredbuffer"
 		// whereas the type can be extended with an optional subtype, e.g. "structuredbuffer:int".
 		bool preserve_structured_buffers = false;
+
+		// Computes float arithmetic decorated with RelaxedPrecision in 16-bit, including loads of
+		// RelaxedPrecision struct members, using min16float, or half with enable_16bit_types.
+		// Values are converted only where 16-bit and 32-bit expressions meet.
+		bool relaxed_precision_as_16bit = false;
+
+		// Promotes small cbuffers which are not arrays to root constants, until the promoted cbuffers
+		// use up this many 32-bit values. Smaller cbuffers are promoted first. 0 disables promotion. Needs SM 5.1.
+		// A promoted cbuffer only declares its members up to the last one the shader accesses,
+		// so that it fits the root constants. See get_promoted_root_constants().
+		uint32_t root_constant_promotion_dword_budget = 0;
+
+		// Declares images, samplers, acceleration structures and buffers which are not arrays as locals
+		// loaded from ResourceDescriptorHeap and SamplerDescriptorHeap instead of binding them to registers.
+		// The heap indices are read from a cbuffer at descriptor_heap_index_register in
+		// descriptor_heap_index_space, see Compiler::get_descriptor_heap_slots(). Needs SM 6.6.
+		bool descriptor_heap_indexing = false;
+		uint32_t descriptor_heap_index_register = 0;
+		uint32_t descriptor_heap_index_space = 0;
+
+		// Constant lookup tables of 32-bit scalars which are at least this many bytes are declared as
+		// StructuredBuffers from register t lut_buffer_register in lut_buffer_space onwards instead of inline literals.
+		// The contents to upload are returned by Compiler::get_lowered_luts(). 0 disables this. Needs SM 5.0.
+		uint32_t lut_buffer_min_size = 0;
+		uint32_t lut_buffer_register = 0;
+		uint32_t lut_buffer_space = 0;
 	};
 
 	struct OptionsGLSL
@@ -253,6 +295,11 @@ public:
 		// compares.
 		bool relax_nan_checks = false;
 
+		// If non-zero, pure expressions which a block computes more than once from the same operands are computed
+		// once into a temporary, which the later copies read instead of inlining the expression again.
+		// Expressions made of fewer operations than this are still inlined at every use.
+		uint32_t common_subexpression_min_cost = 0;
+
 		// Loading row-major matrices from UBOs on older AMD Windows OpenGL drivers is problematic.
 		// To load these types correctly, we must generate a wrapper. them in a dummy function which only purpose is to
 		// ensure row_major decoration is actually respected.
@@ -329,18 +376,36 @@ public:
 		hlsl_options = opts;
 	}
 
+	const OptionsGLSL &get_common_options() const
+	{
+		return options;
+	}
+
+	void set_common_options(const OptionsGLSL &opts)
+	{
+		options = opts;
+	}
+
 	// Optionally specify a custom root constant layout.
 	//
 	// Push constants ranges will be split up according to the
 	// layout specified.
 	void set_root_constant_layouts(std::vector<RootConstants> layout);
 
+	// After compile(), returns the cbuffers promoted by Options::root_constant_promotion_dword_budget.
+	const std::vector<HLSLPromotedRootConstants> &get_promoted_root_constants() const;
+
+	// After compile(), returns the root signature parameters for get_promoted_root_constants(),
+	// e.g. "RootConstants(num32BitConstants=4, b0, space=0)", separated by ", ".
+	std::string get_promoted_root_constants_root_signature() const;
+
 	// Compiles and remaps vertex attributes at specific locations to a fixed semantic.
 	// The default is TEXCOORD# where # denotes location.
 	// Matrices are unrolled to vectors with notation ${SEMANTIC}_#, where # denotes row.
 	// $SEMANTIC is either TEXCOORD# or a semantic name specified here.
 	void add_vertex_attribute_remap(const HLSLVertexAttributeRemap &vertex_attributes);
 	std::string compile() override;
+	void reset_for_recompile() override;
 
 	// This is a special HLSL workaround for the NumWorkGroups builtin.
 	// This does not exist in HLSL, so the calling application must create a dummy cbuffer in
@@ -373,7 +438,23 @@ public:
 	void unset_hlsl_aux_buffer_binding(HLSLAuxBinding binding);
 	bool is_hlsl_aux_buffer_binding_used(HLSLAuxBinding binding) const;
 
+	// Legacy GLSL compatibility method.
+	// Takes a uniform or push constant variable and flattens it into a (i|u)vec4 array[N]; array instead.
+	// For this to work, all types in the block must be the same basic type, e.g. mixing vec2 and vec4 is fine, but
+	// mixing int and float is not.
+	// The name of the uniform array will be the same as the interface block name.
+	void flatten_buffer_block(VariableID id);
+
+	// Masks a stage output so that it is not part of the output struct, either by location and component,
+	// or by builtin. It is still declared as a static variable. Should only be used with stage outputs
+	// which are not consumed by the next stage.
+	void mask_stage_output_by_location(uint32_t location, uint32_t component) override;
+	void mask_stage_output_by_builtin(spv::BuiltIn builtin) override;
+
 private:
+	// Only move-assigned by reset_for_recompile().
+	CompilerHLSL &operator=(CompilerHLSL &&other) = default;
+
 	std::string type_to_glsl(const SPIRType &type, uint32_t id = 0);
 	std::string image_type_hlsl(const SPIRType &type, uint32_t id);
 	std::string image_type_hlsl_modern(const SPIRType &type, uint32_t id);
@@ -424,6 +505,7 @@ private:
 	void write_access_chain_array(const SPIRAccessChain &chain, uint32_t value,
 	                              const SmallVector<uint32_t> &composite_chain);
 	std::string write_access_chain_value(uint32_t value, const SmallVector<uint32_t> &composite_chain, bool enclose);
+	uint32_t coalesced_access_chain_member_count(const SPIRType &type, uint32_t index, uint32_t static_index) const;
 	void emit_store(const Instruction &instruction);
 	void emit_atomic(const uint32_t *ops, uint32_t length, spv::Op op);
 	void emit_subgroup_op(const Instruction &i);
@@ -528,6 +610,18 @@ private:
 	// Custom root constant layout, which should be emitted
 	// when translating push constant ranges.
 	std::vector<RootConstants> root_constants_layout;
+	std::vector<HLSLPromotedRootConstants> promoted_root_constants;
+	void analyze_root_constant_promotion();
+	const HLSLPromotedRootConstants *find_promoted_root_constants(uint32_t id) const;
+
+	// Declarations of the descriptor heap resources, as emitted by emit_resources(),
+	// which are repeated at the start of each function using them.
+	std::unordered_map<uint32_t, SmallVector<std::string>> descriptor_heap_declarations;
+	uint32_t descriptor_heap_index_variable = 0;
+	void analyze_descriptor_heap_indexing();
+	const DescriptorHeapSlot *find_descriptor_heap_slot(uint32_t id, bool sampler_heap) const;
+	std::string to_descriptor_heap_load(const SPIRVariable &var, bool sampler_heap);
+	SmallVector<std::string> *descriptor_heap_redirect(uint32_t id);
 
 	void validate_shader_model();
 
@@ -725,19 +819,19 @@ private:
 
 	std::unordered_set<uint32_t> flattened_buffer_blocks;
 	std::unordered_map<uint32_t, bool> flattened_structs;
-	std::unordered_set<std::string> resource_names;
-	std::unordered_set<std::string> block_names; // A union of all block_*_names.
-	std::unordered_set<std::string> local_variable_names;
+	NameCache resource_names;
+	NameCache block_names; // A union of all block_*_names.
+	NameCache local_variable_names;
 	std::unordered_map<uint32_t, uint32_t> extra_sub_expressions;
 	std::unordered_map<uint32_t, std::string> preserved_aliases;
 	std::unordered_map<std::string, std::unordered_set<uint64_t>> function_overloads;
 	std::unordered_map<uint32_t, uint32_t> expression_usage_counts;
 	std::unordered_set<uint32_t> composite_insert_overwritten;
 	SmallVector<SPIRBlock *> current_emitting_switch_stack;
-	std::unordered_set<std::string> block_input_names;
-	std::unordered_set<std::string> block_output_names;
-	std::unordered_set<std::string> block_ubo_names;
-	std::unordered_set<std::string> block_ssbo_names;
+	NameCache block_input_names;
+	NameCache block_output_names;
+	NameCache block_ubo_names;
+	NameCache block_ssbo_names;
 	std::unordered_map<uint32_t, uint32_t> temporary_to_mirror_precision_alias;
 	std::vector<std::pair<uint32_t, uint32_t>> subpass_to_framebuffer_fetch_attachment;
 	const SPIRBlock *current_continue_block = nullptr;
@@ -856,14 +950,19 @@ private:
 	void fixup_implicit_builtin_block_names(spv::ExecutionModel model);
 	uint32_t get_declared_member_location(const SPIRVariable &var, uint32_t mbr_idx, bool strip_array) const;
 	bool is_per_primitive_variable(const SPIRVariable &var) const;
+	bool is_stage_output_location_masked(uint32_t location, uint32_t component) const;
+	bool is_stage_output_builtin_masked(spv::BuiltIn builtin) const;
+	bool is_stage_output_variable_masked(const SPIRVariable &var) const;
+	bool is_stage_output_block_member_masked(const SPIRVariable &var, uint32_t index, bool strip_array) const;
+	std::unordered_set<LocationComponentPair, InternalHasher> masked_output_locations;
+	std::unordered_set<uint32_t> masked_output_builtins;
 	bool variable_is_lut(const SPIRVariable &var) const;
 	void flush_variable_declaration(uint32_t id);
 	SPIRExpression &emit_op(uint32_t result_type, uint32_t result_id, const std::string &rhs, bool forward_rhs,
 	                        bool suppress_usage_tracking = false);
 	std::string to_unpacked_expression(uint32_t id, bool register_expression_read = true);
 	void emit_buffer_block_flattened(const SPIRVariable &type);
-	void add_variable(std::unordered_set<std::string> &variables_primary,
-	                  const std::unordered_set<std::string> &variables_secondary, std::string &name);
+	void add_variable(NameCache &variables_primary, const NameCache &variables_secondary, std::string &name);
 
 	bool buffer_is_packing_standard(const SPIRType &type, BufferPackingStandard packing,
 	                                uint32_t *failed_index = nullptr, uint32_t start_offset = 0,
@@ -995,6 +1094,11 @@ private:
 	uint32_t required_polyfills = 0;
 	uint32_t required_polyfills_relaxed = 0;
 	void require_polyfill(Polyfill polyfill, bool relaxed);
+	void append_backend_resource_costs(ResourceCostReport &report) const override;
+	size_t get_output_block_count() const override
+	{
+		return buffer.get_block_count();
+	}
 	std::string load_flattened_struct(const std::string &basename, const SPIRType &type);
 	std::string to_flattened_struct_member(const std::string &basename, const SPIRType &type, uint32_t index);
 	int get_constant_mapping_to_workgroup_component(const SPIRConstant &constant) const;
@@ -26,6 +26,7 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <cmath>
 #include <numeric>
 
 using namespace spv;
@@ -333,6 +334,22 @@ void CompilerMSL::add_msl_shader_output(const MSLShaderInterfaceVariable &so)
 		outputs_by_builtin[so.builtin] = so;
 }
 
+void CompilerMSL::stage_interface_relocated(StorageClass storage, const unordered_map<uint32_t, uint32_t> &new_locations)
+{
+	auto &by_location = storage == StorageClassInput ? inputs_by_location : outputs_by_location;
+
+	map<LocationComponentPair, MSLShaderInterfaceVariable> relocated;
+	for (auto &entry : by_location)
+	{
+		auto interface_var = entry.second;
+		auto itr = new_locations.find(interface_var.location);
+		if (itr != end(new_locations))
+			interface_var.location = itr->second;
+		relocated[{ interface_var.location, interface_var.component }] = interface_var;
+	}
+	by_location = std::move(relocated);
+}
+
 void CompilerMSL::add_msl_resource_binding(const MSLResourceBinding &binding)
 {
 	StageSetBinding tuple = { binding.stage, binding.desc_set, binding.binding };
@@ -1516,11 +1533,25 @@ void CompilerMSL::emit_entry_point_declarations()
 	}
 }
 
+void CompilerMSL::reset_for_recompile()
+{
+	CompilerMSL fresh{ ParsedIR() };
+	fresh.options = options;
+	fresh.msl_options = msl_options;
+	fresh.keep_state_for_recompile(*this);
+	*this = std::move(fresh);
+}
+
 string CompilerMSL::compile()
 {
+	CompileBudgetTracker::Scope budget_scope(compile_budget);
+	save_recompile_snapshot();
 	replace_illegal_entry_point_names();
 	ir.fixup_reserved_names();
 
+	// Array sizes may depend on specialization constants which changed since the last compile.
+	ir.invalidate_type_layouts();
+
 	// Do not deal with GLES-isms like precision, older extensions and such.
 	options.vulkan_semantics = true;
 	options.es = false;
@@ -1568,18 +1599,25 @@ string CompilerMSL::compile()
 	for (auto &id : next_metal_resource_ids)
 		id = 0;
 
-	fixup_anonymous_struct_names();
-	fixup_type_alias();
-	replace_illegal_names();
-	sync_entry_point_aliases_and_names();
-
-	build_function_control_flow_graphs_and_analyze();
-	update_active_builtins();
-	analyze_image_and_sampler_usage();
-	analyze_sampled_image_usage();
-	analyze_interlocked_resource_usage();
-	preprocess_op_codes();
-	build_implicit_builtins();
+	profile_pass("specialize_constants", [&] { specialize_constants(); });
+	profile_pass("fixup_anonymous_struct_names", [&] { fixup_anonymous_struct_names(); });
+	profile_pass("fixup_type_alias", [&] { fixup_type_alias(); });
+	profile_pass("replace_illegal_names", [&] { replace_illegal_names(); });
+	profile_pass("sync_entry_point_aliases_and_names", [&] { sync_entry_point_aliases_and_names(); });
+
+	if (msl_options.relaxed_precision_as_16bit)
+		profile_pass("lower_relaxed_precision_to_16bit", [&] { lower_relaxed_precision_to_16bit(); });
+	if (options.common_subexpression_min_cost)
+		profile_pass("eliminate_common_subexpressions",
+		             [&] { eliminate_common_subexpressions(options.common_subexpression_min_cost); });
+	profile_pass("build_function_control_flow_graphs_and_analyze",
+	             [&] { build_function_control_flow_graphs_and_analyze(); });
+	profile_pass("update_active_builtins_and_analyze_image_and_sampler_usage",
+	             [&] { update_active_builtins_and_analyze_image_and_sampler_usage(); });
+	profile_pass("analyze_sampled_image_usage", [&] { analyze_sampled_image_usage(); });
+	profile_pass("analyze_interlocked_resource_usage", [&] { analyze_interlocked_resource_usage(); });
+	profile_pass("preprocess_op_codes", [&] { preprocess_op_codes(); });
+	profile_pass("build_implicit_builtins", [&] { build_implicit_builtins(); });
 
 	if (needs_manual_helper_invocation_updates() &&
 	    (active_input_builtins.get(BuiltInHelperInvocation) || needs_helper_invocation))
@@ -1595,7 +1633,7 @@ string CompilerMSL::compile()
 		backend.demote_literal = "discard_fragment()";
 	}
 
-	fixup_image_load_store_access();
+	profile_pass("fixup_image_load_store_access", [&] { fixup_image_load_store_access(); });
 
 	set_enabled_interface_variables(get_active_interface_variables());
 	if (msl_options.force_active_argument_buffer_resources)
@@ -1625,6 +1663,9 @@ string CompilerMSL::compile()
 	if (is_tese_shader())
 		patch_stage_in_var_id = add_interface_block(StorageClassInput, true);
 
+	if (msl_options.pack_tessellation_buffers)
+		pack_tessellation_buffers();
+
 	if (is_tesc_shader())
 		stage_out_ptr_var_id = add_interface_block_pointer(stage_out_var_id, StorageClassOutput);
 	if (is_tessellation_shader())
@@ -1635,16 +1676,17 @@ string CompilerMSL::compile()
 		is_rasterization_disabled = true;
 
 	// Convert the use of global variables to recursively-passed function parameters
-	localize_global_variables();
-	extract_global_variables_from_functions();
+	profile_pass("localize_global_variables", [&] { localize_global_variables(); });
+	profile_pass("extract_global_variables_from_functions", [&] { extract_global_variables_from_functions(); });
+	profile_pass("analyze_read_only_array_copies", [&] { analyze_read_only_array_copies(); });
 
 	// Mark any non-stage-in structs to be tightly packed.
-	mark_packable_structs();
-	reorder_type_alias();
+	profile_pass("mark_packable_structs", [&] { mark_packable_structs(); });
+	profile_pass("reorder_type_alias", [&] { reorder_type_alias(); });
 
 	// Add fixup hooks required by shader inputs and outputs. This needs to happen before
 	// the loop, so the hooks aren't added multiple times.
-	fix_up_shader_inputs_outputs();
+	profile_pass("fix_up_shader_inputs_outputs", [&] { fix_up_shader_inputs_outputs(); });
 
 	// If we are using argument buffers, we create argument buffer structures for them here.
 	// These buffers will be used in the entry point, not the individual resources.
@@ -1652,9 +1694,10 @@ string CompilerMSL::compile()
 	{
 		if (!msl_options.supports_msl_version(2, 0))
 			SPIRV_CROSS_THROW("Argument buffers can only be used with MSL 2.0 and up.");
-		analyze_argument_buffers();
+		profile_pass("analyze_argument_buffers", [&] { analyze_argument_buffers(); });
 	}
 
+	PassProfiler emit_profiler(*this, "emit");
 	uint32_t pass_count = 0;
 	do
 	{
@@ -1669,18 +1712,24 @@ string CompilerMSL::compile()
 
 		// Move constructor for this type is broken on GCC 4.9 ...
 		buffer.reset();
+		multi_patch_workgroup_storage_size = 0;
 
+		add_spv_function_dependencies();
 		emit_header();
-		emit_custom_templates();
-		emit_custom_functions();
+		if (spv_function_library_include.empty())
+		{
+			emit_custom_templates();
+			emit_custom_functions();
+		}
 		emit_specialization_constants_and_structs();
 		emit_resources();
 		emit_function(get<SPIRFunction>(ir.default_entry_point), Bitset());
 
 		pass_count++;
 	} while (is_forcing_recompilation());
+	emit_profiler.finish(pass_count);
 
-	return buffer.str();
+	return finish_output(buffer);
 }
 
 // Register the need to output any custom functions.
@@ -2205,33 +2254,762 @@ void CompilerMSL::extract_global_variables_from_function(uint32_t func_id, std::
 						uint32_t ptr_type_id = next_ids + 0;
 						uint32_t var_id = next_ids + 1;
 
-						// Make sure we have an actual pointer type,
-						// so that we will get the appropriate address space when declaring these builtins.
-						auto &ptr = set<SPIRType>(ptr_type_id, get<SPIRType>(mbr_type_id));
-						ptr.self = mbr_type_id;
-						ptr.storage = var.storage;
-						ptr.pointer = true;
-						ptr.pointer_depth++;
-						ptr.parent_type = mbr_type_id;
+						// Make sure we have an actual pointer type,
+						// so that we will get the appropriate address space when declaring these builtins.
+						auto &ptr = set<SPIRType>(ptr_type_id, get<SPIRType>(mbr_type_id));
+						ptr.self = mbr_type_id;
+						ptr.storage = var.storage;
+						ptr.pointer = true;
+						ptr.pointer_depth++;
+						ptr.parent_type = mbr_type_id;
+
+						func.add_parameter(mbr_type_id, var_id, true);
+						set<SPIRVariable>(var_id, ptr_type_id, StorageClassFunction);
+						ir.meta[var_id].decoration = ir.meta[type_id].members[mbr_idx];
+					}
+					mbr_idx++;
+				}
+			}
+			else
+			{
+				uint32_t next_id = ir.increase_bound_by(1);
+				func.add_parameter(type_id, next_id, true);
+				set<SPIRVariable>(next_id, type_id, StorageClassFunction, 0, arg_id);
+
+				// Ensure the new variable has all the same meta info
+				ir.meta[next_id] = ir.meta[arg_id];
+			}
+		}
+	}
+}
+
+// Arrays which are copied to the stack, but never written afterwards, are indexed and passed to functions
+// where they live instead, i.e. in constant arrays, read-only buffers or read-only array arguments.
+// A function gets an overload for each combination of address spaces its array arguments are passed from.
+void CompilerMSL::analyze_read_only_array_copies()
+{
+	read_only_array_copy_offsets.clear();
+	array_argument_overloads.clear();
+	read_only_array_value_arguments.clear();
+
+	// Arrays of scalars and vectors, which index the same in every address space.
+	const auto is_table = [&](const SPIRType &type) -> bool {
+		if (type.array.empty() || type.pointer)
+			return false;
+		for (uint32_t i = 0; i < uint32_t(type.array.size()); i++)
+			if (!type.array_size_literal[i] || type.array[i] == 0)
+				return false;
+
+		auto *elem = &type;
+		while (!elem->array.empty())
+			elem = &get<SPIRType>(elem->parent_type);
+		return !elem->pointer && elem->columns == 1 && (type_is_floating_point(*elem) || type_is_integral(*elem));
+	};
+
+	const auto constant_space = [&](uint32_t id) -> ArrayArgumentSpace {
+		auto *c = maybe_get<SPIRConstant>(id);
+		if (!c || c->specialization || !is_table(get<SPIRType>(c->constant_type)))
+			return ArrayArgumentThread;
+		return msl_options.force_native_arrays ? ArrayArgumentConstant : ArrayArgumentConstantTemplate;
+	};
+
+	// Everything which references an array argument or function variable, or an access chain into one.
+	struct ArrayUsage
+	{
+		bool escapes = false;
+		uint32_t write_count = 0;
+		const Instruction *write = nullptr;
+		uint32_t write_block = 0;
+		uint32_t write_index = 0;
+		// Block and instruction index of every read.
+		SmallVector<std::pair<uint32_t, uint32_t>> accesses;
+		// Loads of the whole array, or stores of an array passed by value.
+		SmallVector<const Instruction *> whole_loads;
+		// Callee and argument index.
+		SmallVector<std::pair<uint32_t, uint32_t>> calls;
+	};
+
+	unordered_map<uint32_t, ArrayUsage> usages;
+	unordered_set<uint32_t> accepted;
+	unordered_set<uint32_t> value_arguments;
+	// Variables copied from a constant array or buffer, and those copied from other arrays.
+	unordered_map<uint32_t, uint32_t> sources;
+	unordered_map<uint32_t, ArrayArgumentSpace> source_spaces;
+	unordered_map<uint32_t, uint32_t> dependencies;
+	// Instructions which make up each copy, and the load of another array at the start of it.
+	unordered_map<uint32_t, SmallVector<uint32_t>> copy_offsets;
+	unordered_map<uint32_t, uint32_t> claimed_loads;
+
+	// Functions which may write memory outside of their own variables, directly or in their callees,
+	// or wait on barriers. The array a caller passes them could change during the call,
+	// so arrays passed by value and copies of pointer arguments are not indexed where they live.
+	unordered_set<uint32_t> writes_caller_memory;
+	unordered_map<uint32_t, SmallVector<uint32_t>> function_callees;
+
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t func_id, const SPIRFunction &func) {
+		unordered_set<uint32_t> locals(begin(func.local_variables), end(func.local_variables));
+		unordered_map<uint32_t, uint32_t> bases;
+		const auto is_local = [&](uint32_t ptr) -> bool {
+			auto itr = bases.find(ptr);
+			return locals.count(itr != end(bases) ? itr->second : ptr) != 0;
+		};
+
+		bool writes = false;
+		for (auto block_id : func.blocks)
+		{
+			for (auto &instr : get<SPIRBlock>(block_id).ops)
+			{
+				auto *ops = stream(instr);
+				auto op = static_cast<Op>(instr.op);
+
+				switch (op)
+				{
+				case OpAccessChain:
+				case OpInBoundsAccessChain:
+				case OpPtrAccessChain:
+				case OpInBoundsPtrAccessChain:
+					if (instr.length >= 3)
+					{
+						auto itr = bases.find(ops[2]);
+						bases[ops[1]] = itr != end(bases) ? itr->second : ops[2];
+					}
+					break;
+
+				case OpStore:
+				case OpCopyMemory:
+				case OpCopyMemorySized:
+					if (instr.length >= 1 && !is_local(ops[0]))
+						writes = true;
+					break;
+
+				case OpExtInst:
+					// Modf and Frexp write their second result through a pointer.
+					if (instr.length >= 6 && get<SPIRExtension>(ops[2]).ext == SPIRExtension::GLSL &&
+					    (ops[3] == GLSLstd450Modf || ops[3] == GLSLstd450Frexp) && !is_local(ops[5]))
+						writes = true;
+					break;
+
+				case OpFunctionCall:
+					if (instr.length >= 3)
+						function_callees[func_id].push_back(ops[2]);
+					break;
+
+				case OpControlBarrier:
+				case OpMemoryBarrier:
+				case OpAtomicStore:
+				case OpAtomicExchange:
+				case OpAtomicCompareExchange:
+				case OpAtomicCompareExchangeWeak:
+				case OpAtomicIIncrement:
+				case OpAtomicIDecrement:
+				case OpAtomicIAdd:
+				case OpAtomicISub:
+				case OpAtomicSMin:
+				case OpAtomicUMin:
+				case OpAtomicSMax:
+				case OpAtomicUMax:
+				case OpAtomicAnd:
+				case OpAtomicOr:
+				case OpAtomicXor:
+				case OpAtomicFAddEXT:
+				case OpAtomicFMinEXT:
+				case OpAtomicFMaxEXT:
+					writes = true;
+					break;
+
+				default:
+					break;
+				}
+			}
+		}
+
+		if (writes)
+			writes_caller_memory.insert(func_id);
+	});
+
+	bool callers_changed = true;
+	while (callers_changed)
+	{
+		callers_changed = false;
+		for (auto &callees : function_callees)
+		{
+			if (writes_caller_memory.count(callees.first))
+				continue;
+
+			for (auto callee : callees.second)
+			{
+				if (writes_caller_memory.count(callee))
+				{
+					writes_caller_memory.insert(callees.first);
+					callers_changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	ir.for_each_typed_id<SPIRFunction>([&](uint32_t func_id, const SPIRFunction &func) {
+		auto cfg_itr = function_cfgs.find(func_id);
+		if (cfg_itr == end(function_cfgs))
+			return;
+
+		// Pointers to the array they point into.
+		unordered_map<uint32_t, uint32_t> roots;
+		unordered_set<uint32_t> arguments;
+		for (auto &arg : func.arguments)
+		{
+			auto &type = get<SPIRType>(arg.type);
+			if (arg.alias_global_variable)
+				continue;
+
+			if (type.pointer ? is_table(get_pointee_type(type)) : is_table(type))
+			{
+				roots[arg.id] = arg.id;
+				arguments.insert(arg.id);
+				if (!type.pointer)
+					value_arguments.insert(arg.id);
+			}
+		}
+
+		for (auto var_id : func.local_variables)
+		{
+			auto &var = get<SPIRVariable>(var_id);
+			if (var.storage == StorageClassFunction && !var.phi_variable && !var.loop_variable &&
+			    is_table(get_variable_data_type(var)))
+			{
+				roots[var_id] = var_id;
+			}
+		}
+
+		if (roots.empty())
+			return;
+
+		for (auto &root : roots)
+			usages[root.first];
+
+		// Literals which commonly come right after IDs, like composite indices, are skipped.
+		// Others are not told apart from IDs, which only errs on the side of keeping copies.
+		const auto is_literal = [](Op op, uint32_t index) -> bool {
+			switch (op)
+			{
+			case OpLoad:
+			case OpCompositeExtract:
+				return index >= 3;
+			case OpStore:
+			case OpCopyMemory:
+				return index >= 2;
+			case OpCompositeInsert:
+			case OpVectorShuffle:
+				return index >= 4;
+			case OpExtInst:
+				return index == 3;
+			default:
+				return false;
+			}
+		};
+
+		// The defining instruction counts as a use of its result.
+		unordered_map<uint32_t, const Instruction *> defs;
+		unordered_map<uint32_t, uint32_t> use_counts;
+
+		for (auto block_id : func.blocks)
+		{
+			auto &block = get<SPIRBlock>(block_id);
+			for (uint32_t index = 0; index < uint32_t(block.ops.size()); index++)
+			{
+				auto &instr = block.ops[index];
+				auto *ops = stream(instr);
+				auto op = static_cast<Op>(instr.op);
+				uint32_t first = 0;
+
+				for (uint32_t i = 0; i < instr.length; i++)
+					if (!is_literal(op, i))
+						use_counts[ops[i]]++;
+
+				switch (op)
+				{
+				case OpAccessChain:
+				case OpInBoundsAccessChain:
+				{
+					if (instr.length < 3)
+						break;
+					defs[ops[1]] = &instr;
+
+					auto itr = roots.find(ops[2]);
+					if (itr != end(roots))
+					{
+						uint32_t root = itr->second;
+						roots[ops[1]] = root;
+						usages[root].accesses.push_back({ block_id, index });
+						first = 3;
+					}
+					break;
+				}
+
+				case OpLoad:
+				{
+					if (instr.length < 3)
+						break;
+					defs[ops[1]] = &instr;
+
+					auto itr = roots.find(ops[2]);
+					if (itr != end(roots))
+					{
+						auto &usage = usages[itr->second];
+						if (ops[2] == itr->second)
+							usage.whole_loads.push_back(&instr);
+						else if (is_array(get<SPIRType>(ops[0])))
+							usage.escapes = true;
+						usage.accesses.push_back({ block_id, index });
+						first = 3;
+					}
+					break;
+				}
+
+				case OpCompositeExtract:
+				{
+					if (instr.length < 3)
+						break;
+					defs[ops[1]] = &instr;
+
+					// Elements of arrays passed by value.
+					auto itr = roots.find(ops[2]);
+					if (itr != end(roots) && !is_array(get<SPIRType>(ops[0])))
+					{
+						usages[itr->second].accesses.push_back({ block_id, index });
+						first = 3;
+					}
+					break;
+				}
+
+				case OpCompositeConstruct:
+				case OpCopyLogical:
+				case OpCopyObject:
+					if (instr.length >= 2)
+						defs[ops[1]] = &instr;
+					break;
+
+				case OpStore:
+				case OpCopyMemory:
+				{
+					if (instr.length < 2)
+						break;
+
+					auto itr = roots.find(ops[0]);
+					if (itr != end(roots))
+					{
+						auto &usage = usages[itr->second];
+						if (ops[0] == itr->second)
+						{
+							usage.write_count++;
+							usage.write = &instr;
+							usage.write_block = block_id;
+							usage.write_index = index;
+						}
+						else
+							usage.escapes = true;
+						first = 1;
+					}
+
+					// Copies of arrays passed by value.
+					auto value_itr = op == OpStore ? roots.find(ops[1]) : end(roots);
+					if (value_itr != end(roots) && value_arguments.count(ops[1]) && itr != end(roots) && ops[0] == itr->second)
+					{
+						usages[ops[1]].whole_loads.push_back(&instr);
+						first = 2;
+					}
+					break;
+				}
+
+				case OpFunctionCall:
+				{
+					for (uint32_t i = 3; i < instr.length; i++)
+					{
+						auto itr = roots.find(ops[i]);
+						if (itr == end(roots))
+							continue;
+
+						auto &usage = usages[itr->second];
+						if (ops[i] == itr->second)
+							usage.calls.push_back({ ops[2], i - 3 });
+						else
+							usage.escapes = true;
+						usage.accesses.push_back({ block_id, index });
+					}
+					first = instr.length;
+					break;
+				}
+
+				default:
+					break;
+				}
+
+				for (uint32_t i = first; i < instr.length; i++)
+				{
+					auto itr = is_literal(op, i) ? end(roots) : roots.find(ops[i]);
+					if (itr != end(roots))
+						usages[itr->second].escapes = true;
+				}
+			}
+
+			if (block.return_value)
+			{
+				use_counts[block.return_value]++;
+				auto itr = roots.find(block.return_value);
+				if (itr != end(roots))
+					usages[itr->second].escapes = true;
+			}
+
+			for (auto &phi : block.phi_variables)
+			{
+				use_counts[phi.local_variable]++;
+				auto itr = roots.find(phi.local_variable);
+				if (itr != end(roots))
+					usages[itr->second].escapes = true;
+			}
+		}
+
+		// Arrays in buffers which are never written and which are laid out like stack arrays.
+		const auto buffer_space = [&](uint32_t ptr) -> ArrayArgumentSpace {
+			auto itr = defs.find(ptr);
+			if (itr == end(defs) || (itr->second->op != OpAccessChain && itr->second->op != OpInBoundsAccessChain))
+				return ArrayArgumentThread;
+
+			auto &def = *itr->second;
+			auto *ops = stream(def);
+			auto *var = maybe_get<SPIRVariable>(ops[2]);
+			if (!var || (var->storage != StorageClassUniform && var->storage != StorageClassStorageBuffer &&
+			             var->storage != StorageClassPushConstant))
+				return ArrayArgumentThread;
+
+			for (uint32_t i = 3; i < def.length; i++)
+			{
+				auto *c = maybe_get<SPIRConstant>(ops[i]);
+				if (!c || c->specialization)
+					return ArrayArgumentThread;
+			}
+
+			uint32_t type_id = get_pointee_type_id(ops[0]);
+			auto &type = get<SPIRType>(type_id);
+			if (!is_table(type) || type.array.size() != 1)
+				return ArrayArgumentThread;
+
+			auto &elem = get<SPIRType>(type.parent_type);
+			uint32_t elem_size = (elem.vecsize == 3 ? 4 : elem.vecsize) * (elem.width / 8);
+			if (get_decoration(type_id, DecorationArrayStride) != elem_size)
+				return ArrayArgumentThread;
+
+			auto addr_space = get_type_address_space(get<SPIRType>(var->basetype), var->self);
+			if (addr_space == "constant")
+				return ArrayArgumentConstant;
+			else if (addr_space == "const device")
+				return ArrayArgumentConstDevice;
+			else
+				return ArrayArgumentThread;
+		};
+
+		for (auto &root : roots)
+		{
+			uint32_t id = root.first;
+			if (root.second != id)
+				continue;
+
+			auto &usage = usages[id];
+			if (usage.escapes)
+				continue;
+
+			// Arguments only have to be read-only. Arrays passed by value must also not change during the call.
+			if (arguments.count(id))
+			{
+				if (usage.write_count == 0 && (!value_arguments.count(id) || !writes_caller_memory.count(func_id)))
+					accepted.insert(id);
+				continue;
+			}
+
+			auto &var = get<SPIRVariable>(id);
+			if (var.initializer)
+			{
+				auto space = usage.write_count == 0 ? constant_space(var.initializer) : ArrayArgumentThread;
+				if (space != ArrayArgumentThread)
+				{
+					sources[id] = var.initializer;
+					source_spaces[id] = space;
+					accepted.insert(id);
+				}
+				continue;
+			}
+
+			if (usage.write_count != 1)
+				continue;
+
+			// The copy must happen before the array is read anywhere.
+			DominatorBuilder builder(*cfg_itr->second);
+			builder.add_block(usage.write_block);
+			bool ordered = true;
+			for (auto &access : usage.accesses)
+			{
+				if (access.first == usage.write_block && access.second < usage.write_index)
+					ordered = false;
+				builder.add_block(access.first);
+			}
+
+			if (!ordered || builder.get_dominator() != usage.write_block)
+				continue;
+
+			// Follow the stored value back to where it was copied from. Every copy along the way
+			// must not be used for anything else.
+			auto *write_ops = stream(*usage.write);
+			SmallVector<uint32_t> offsets = { usage.write->offset };
+			uint32_t ptr = 0;
+			uint32_t value = 0;
+			uint32_t expected_uses = 1;
+
+			if (usage.write->op == OpCopyMemory)
+				ptr = write_ops[1];
+			else
+				value = write_ops[1];
+
+			while (value)
+			{
+				if (value_arguments.count(value) && roots.count(value))
+				{
+					dependencies[id] = value;
+					claimed_loads[usage.write->offset] = id;
+					break;
+				}
+
+				auto space = constant_space(value);
+				if (space != ArrayArgumentThread)
+				{
+					sources[id] = value;
+					source_spaces[id] = space;
+					break;
+				}
+
+				auto itr = defs.find(value);
+				if (itr == end(defs) || use_counts[value] != expected_uses + 1)
+					break;
+
+				auto &def = *itr->second;
+				auto *ops = stream(def);
+				offsets.push_back(def.offset);
+				value = 0;
+
+				if (def.op == OpLoad)
+					ptr = ops[2];
+				else if (def.op == OpCopyLogical || def.op == OpCopyObject)
+				{
+					value = ops[2];
+					expected_uses = 1;
+				}
+				else if (def.op == OpCompositeConstruct)
+				{
+					// Element-wise copies, as emitted before OpCopyLogical.
+					uint32_t count = def.length - 2;
+					uint32_t composite = 0;
+					bool elementwise = count != 0;
+					for (uint32_t i = 0; i < count && elementwise; i++)
+					{
+						auto elem_itr = defs.find(ops[2 + i]);
+						elementwise = elem_itr != end(defs) && elem_itr->second->op == OpCompositeExtract &&
+						              elem_itr->second->length == 4 && use_counts[ops[2 + i]] == 2;
+						if (!elementwise)
+							break;
+
+						auto *elem_ops = stream(*elem_itr->second);
+						elementwise = elem_ops[3] == i && (i == 0 || elem_ops[2] == composite);
+						composite = elem_ops[2];
+						offsets.push_back(elem_itr->second->offset);
+					}
+
+					auto composite_itr = defs.find(composite);
+					if (elementwise && composite_itr != end(defs))
+					{
+						auto &composite_type = get<SPIRType>(stream(*composite_itr->second)[0]);
+						if (!composite_type.array.empty() && composite_type.array.back() == count)
+						{
+							value = composite;
+							expected_uses = count;
+						}
+					}
+				}
+			}
+
+			if (!ptr)
+			{
+				if (sources.count(id) || dependencies.count(id))
+				{
+					copy_offsets[id] = std::move(offsets);
+					accepted.insert(id);
+				}
+				continue;
+			}
+
+			auto ptr_root = roots.find(ptr);
+			if (ptr_root != end(roots) && ptr_root->second == ptr && usage.write->op == OpStore)
+			{
+				if (arguments.count(ptr) && writes_caller_memory.count(func_id))
+					continue;
+				dependencies[id] = ptr;
+				claimed_loads[offsets.back()] = id;
+			}
+			else
+			{
+				auto space = buffer_space(ptr);
+				if (space == ArrayArgumentThread)
+					continue;
+				sources[id] = ptr;
+				source_spaces[id] = space;
+			}
+
+			copy_offsets[id] = std::move(offsets);
+			accepted.insert(id);
+		}
+	});
+
+	// Drop arrays which are passed to functions which write them, or copied in other ways,
+	// and copies of arrays which were dropped, until nothing changes.
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (auto itr = begin(accepted); itr != end(accepted);)
+		{
+			auto &usage = usages[*itr];
+			bool read_only = true;
+
+			for (auto &call : usage.calls)
+			{
+				auto &callee = get<SPIRFunction>(call.first);
+				if (call.second >= callee.arguments.size() || !accepted.count(callee.arguments[call.second].id))
+					read_only = false;
+			}
+
+			for (auto *load : usage.whole_loads)
+			{
+				auto claim = claimed_loads.find(load->offset);
+				if (claim == end(claimed_loads) || !accepted.count(claim->second))
+					read_only = false;
+			}
+
+			auto dep = dependencies.find(*itr);
+			if (dep != end(dependencies) && !accepted.count(dep->second))
+				read_only = false;
+
+			if (read_only)
+				++itr;
+			else
+			{
+				itr = accepted.erase(itr);
+				changed = true;
+			}
+		}
+	}
+
+	if (accepted.empty())
+		return;
+
+	// The address space an array lives in, given the address spaces of the function's arguments.
+	const auto space_of = [&](uint32_t id, const unordered_map<uint32_t, ArrayArgumentSpace> &argument_spaces) {
+		for (;;)
+		{
+			auto space_itr = source_spaces.find(id);
+			if (space_itr != end(source_spaces))
+				return space_itr->second;
+
+			auto dep = dependencies.find(id);
+			if (dep == end(dependencies))
+				break;
+			id = dep->second;
+		}
+
+		auto arg_itr = argument_spaces.find(id);
+		return arg_itr != end(argument_spaces) ? arg_itr->second : ArrayArgumentThread;
+	};
+
+	// Find the overloads every function needs, starting from the entry point.
+	unordered_map<uint32_t, SmallVector<SmallVector<ArrayArgumentSpace>>> overloads;
+	SmallVector<std::pair<uint32_t, SmallVector<ArrayArgumentSpace>>> pending;
+	pending.push_back({ ir.default_entry_point, {} });
+
+	while (!pending.empty())
+	{
+		auto func_id = pending.back().first;
+		auto spaces = std::move(pending.back().second);
+		pending.pop_back();
+
+		auto &func = get<SPIRFunction>(func_id);
+		unordered_map<uint32_t, ArrayArgumentSpace> argument_spaces;
+		for (uint32_t i = 0; i < uint32_t(spaces.size()); i++)
+			argument_spaces[func.arguments[i].id] = spaces[i];
+
+		for (auto block_id : func.blocks)
+		{
+			for (auto &instr : get<SPIRBlock>(block_id).ops)
+			{
+				if (instr.op != OpFunctionCall || instr.length < 3)
+					continue;
+
+				auto *ops = stream(instr);
+				auto &callee = get<SPIRFunction>(ops[2]);
+				SmallVector<ArrayArgumentSpace> callee_spaces;
+				callee_spaces.resize(callee.arguments.size());
+				for (uint32_t i = 3; i < instr.length && i - 3 < callee.arguments.size(); i++)
+				{
+					if (accepted.count(ops[i]))
+						callee_spaces[i - 3] = space_of(ops[i], argument_spaces);
+					else if (value_arguments.count(callee.arguments[i - 3].id) &&
+					         accepted.count(callee.arguments[i - 3].id))
+						callee_spaces[i - 3] = constant_space(ops[i]);
+				}
 
-						func.add_parameter(mbr_type_id, var_id, true);
-						set<SPIRVariable>(var_id, ptr_type_id, StorageClassFunction);
-						ir.meta[var_id].decoration = ir.meta[type_id].members[mbr_idx];
-					}
-					mbr_idx++;
+				auto &callee_overloads = overloads[callee.self];
+				auto same = [&](const SmallVector<ArrayArgumentSpace> &other) {
+					return equal(begin(other), end(other), begin(callee_spaces));
+				};
+
+				if (find_if(begin(callee_overloads), end(callee_overloads), same) == end(callee_overloads))
+				{
+					callee_overloads.push_back(callee_spaces);
+					pending.push_back({ callee.self, std::move(callee_spaces) });
 				}
 			}
-			else
-			{
-				uint32_t next_id = ir.increase_bound_by(1);
-				func.add_parameter(type_id, next_id, true);
-				set<SPIRVariable>(next_id, type_id, StorageClassFunction, 0, arg_id);
+		}
+	}
 
-				// Ensure the new variable has all the same meta info
-				ir.meta[next_id] = ir.meta[arg_id];
+	for (auto &func_overloads : overloads)
+	{
+		for (auto &spaces : func_overloads.second)
+		{
+			if (find_if(begin(spaces), end(spaces),
+			            [](ArrayArgumentSpace space) { return space != ArrayArgumentThread; }) != end(spaces))
+			{
+				array_argument_overloads.insert(func_overloads);
+				break;
 			}
 		}
 	}
+
+	// Reads of the copies are redirected to where they were copied from, so the copies are never emitted.
+	for (auto id : accepted)
+	{
+		if (value_arguments.count(id))
+			read_only_array_value_arguments.insert(id);
+
+		auto src = sources.find(id);
+		auto dep = dependencies.find(id);
+		if (src == end(sources) && dep == end(dependencies))
+			continue;
+
+		auto &var = get<SPIRVariable>(id);
+		var.static_expression = src != end(sources) ? src->second : dep->second;
+		var.statically_assigned = true;
+		var.remapped_variable = true;
+
+		auto offsets = copy_offsets.find(id);
+		if (offsets != end(copy_offsets))
+			read_only_array_copy_offsets.insert(begin(offsets->second), end(offsets->second));
+	}
 }
 
 // For all variables that are some form of non-input-output interface block, mark that all the structs
@@ -3823,6 +4601,7 @@ uint32_t CompilerMSL::add_interface_block(StorageClass storage, bool patch)
 	// Sort the members of the structure by their locations.
 	MemberSorter member_sorter(ib_type, ir.meta[ib_type_id], MemberSorter::LocationThenBuiltInType);
 	member_sorter.sort();
+	ir.invalidate_type_layouts();
 
 	// The member indices were saved to the original variables, but after the members
 	// were sorted, those indices are now likely incorrect. Fix those up now.
@@ -4057,6 +4836,7 @@ void CompilerMSL::align_struct(SPIRType &ib_type, unordered_set<uint32_t> &align
 	// They should already be sorted per SPIR-V spec anyway.
 	MemberSorter member_sorter(ib_type, ir.meta[ib_type_id], MemberSorter::Offset);
 	member_sorter.sort();
+	ir.invalidate_type_layouts();
 
 	auto mbr_cnt = uint32_t(ib_type.member_types.size());
 
@@ -4340,6 +5120,7 @@ void CompilerMSL::ensure_member_packing_rules_msl(SPIRType &ib_type, uint32_t in
 			}
 		}
 	}
+	ir.invalidate_type_layouts();
 
 	// This better validate now, or we must fail gracefully.
 	if (!validate_member_packing_rules_msl(ib_type, index))
@@ -4580,6 +5361,11 @@ void CompilerMSL::emit_store_statement(uint32_t lhs_expression, uint32_t rhs_exp
 		{
 			string lhs = to_dereferenced_expression(lhs_expression);
 			string rhs = to_pointer_expression(rhs_expression);
+
+			// Narrowing stores, e.g. to half in packed tessellation buffers, are explicit.
+			if (physical_type.basetype != type.basetype || physical_type.width != type.width)
+				rhs = join(type_to_glsl(physical_type), "(", rhs, ")");
+
 			if (!optimize_read_modify_write(expression_type(rhs_expression), lhs, rhs))
 				statement(lhs, " = ", rhs, ";");
 		}
@@ -4615,6 +5401,12 @@ void CompilerMSL::emit_header()
 	statement("using namespace metal;");
 	statement("");
 
+	if (!spv_function_library_include.empty())
+	{
+		statement("#include \"", spv_function_library_include, "\"");
+		statement("");
+	}
+
 	for (auto &td : typedef_lines)
 		statement(td);
 
@@ -4796,10 +5588,8 @@ void CompilerMSL::emit_custom_templates()
 	}
 }
 
-// Emits any needed custom function bodies.
-// Metal helper functions must be static force-inline, i.e. static inline __attribute__((always_inline))
-// otherwise they will cause problems when linked together in a single Metallib.
-void CompilerMSL::emit_custom_functions()
+// Helpers may be implemented in terms of other helpers, so pull those in as well.
+void CompilerMSL::add_spv_function_dependencies()
 {
 	for (uint32_t i = kArrayCopyMultidimMax; i >= 2; i--)
 		if (spv_function_implementations.count(static_cast<SPVFuncImpl>(SPVFuncImplArrayCopyMultidimBase + i)))
@@ -4837,7 +5627,13 @@ void CompilerMSL::emit_custom_functions()
 		spv_function_implementations.insert(SPVFuncImplForwardArgs);
 		spv_function_implementations.insert(SPVFuncImplGetSwizzle);
 	}
+}
 
+// Emits any needed custom function bodies.
+// Metal helper functions must be static force-inline, i.e. static inline __attribute__((always_inline))
+// otherwise they will cause problems when linked together in a single Metallib.
+void CompilerMSL::emit_custom_functions()
+{
 	for (const auto &spv_func : spv_function_implementations)
 	{
 		switch (spv_func)
@@ -6675,6 +7471,135 @@ void CompilerMSL::emit_custom_functions()
 	}
 }
 
+void CompilerMSL::set_spv_function_library_include(const std::string &header)
+{
+	spv_function_library_include = header;
+}
+
+const std::set<CompilerMSL::SPVFuncImpl> &CompilerMSL::get_spv_function_implementations() const
+{
+	return spv_function_implementations;
+}
+
+const char *CompilerMSL::get_spv_function_implementation_name(SPVFuncImpl impl)
+{
+#define SPV_FUNC_IMPL_NAME(name) \
+	case SPVFuncImpl##name:      \
+		return #name
+
+	switch (impl)
+	{
+	SPV_FUNC_IMPL_NAME(Mod);
+	SPV_FUNC_IMPL_NAME(Radians);
+	SPV_FUNC_IMPL_NAME(Degrees);
+	SPV_FUNC_IMPL_NAME(FindILsb);
+	SPV_FUNC_IMPL_NAME(FindSMsb);
+	SPV_FUNC_IMPL_NAME(FindUMsb);
+	SPV_FUNC_IMPL_NAME(SSign);
+	SPV_FUNC_IMPL_NAME(ArrayCopy);
+	SPV_FUNC_IMPL_NAME(ArrayOfArrayCopy2Dim);
+	SPV_FUNC_IMPL_NAME(ArrayOfArrayCopy3Dim);
+	SPV_FUNC_IMPL_NAME(ArrayOfArrayCopy4Dim);
+	SPV_FUNC_IMPL_NAME(ArrayOfArrayCopy5Dim);
+	SPV_FUNC_IMPL_NAME(ArrayOfArrayCopy6Dim);
+	SPV_FUNC_IMPL_NAME(TexelBufferCoords);
+	SPV_FUNC_IMPL_NAME(Image2DAtomicCoords);
+	SPV_FUNC_IMPL_NAME(FMul);
+	SPV_FUNC_IMPL_NAME(FAdd);
+	SPV_FUNC_IMPL_NAME(FSub);
+	SPV_FUNC_IMPL_NAME(QuantizeToF16);
+	SPV_FUNC_IMPL_NAME(CubemapTo2DArrayFace);
+	SPV_FUNC_IMPL_NAME(UnsafeArray);
+	SPV_FUNC_IMPL_NAME(StorageMatrix);
+	SPV_FUNC_IMPL_NAME(Inverse4x4);
+	SPV_FUNC_IMPL_NAME(Inverse3x3);
+	SPV_FUNC_IMPL_NAME(Inverse2x2);
+	SPV_FUNC_IMPL_NAME(ForwardArgs);
+	SPV_FUNC_IMPL_NAME(GetSwizzle);
+	SPV_FUNC_IMPL_NAME(TextureSwizzle);
+	SPV_FUNC_IMPL_NAME(GatherSwizzle);
+	SPV_FUNC_IMPL_NAME(GatherCompareSwizzle);
+	SPV_FUNC_IMPL_NAME(SubgroupBroadcast);
+	SPV_FUNC_IMPL_NAME(SubgroupBroadcastFirst);
+	SPV_FUNC_IMPL_NAME(SubgroupBallot);
+	SPV_FUNC_IMPL_NAME(SubgroupBallotBitExtract);
+	SPV_FUNC_IMPL_NAME(SubgroupBallotFindLSB);
+	SPV_FUNC_IMPL_NAME(SubgroupBallotFindMSB);
+	SPV_FUNC_IMPL_NAME(SubgroupBallotBitCount);
+	SPV_FUNC_IMPL_NAME(SubgroupAllEqual);
+	SPV_FUNC_IMPL_NAME(SubgroupShuffle);
+	SPV_FUNC_IMPL_NAME(SubgroupShuffleXor);
+	SPV_FUNC_IMPL_NAME(SubgroupShuffleUp);
+	SPV_FUNC_IMPL_NAME(SubgroupShuffleDown);
+	SPV_FUNC_IMPL_NAME(QuadBroadcast);
+	SPV_FUNC_IMPL_NAME(QuadSwap);
+	SPV_FUNC_IMPL_NAME(ReflectScalar);
+	SPV_FUNC_IMPL_NAME(RefractScalar);
+	SPV_FUNC_IMPL_NAME(FaceForwardScalar);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructNearest2Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructNearest3Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear422CositedEven2Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear422CositedEven3Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear422Midpoint2Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear422Midpoint3Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XCositedEvenYCositedEven2Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XCositedEvenYCositedEven3Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XMidpointYCositedEven2Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XMidpointYCositedEven3Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XCositedEvenYMidpoint2Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XCositedEvenYMidpoint3Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XMidpointYMidpoint2Plane);
+	SPV_FUNC_IMPL_NAME(ChromaReconstructLinear420XMidpointYMidpoint3Plane);
+	SPV_FUNC_IMPL_NAME(ExpandITUFullRange);
+	SPV_FUNC_IMPL_NAME(ExpandITUNarrowRange);
+	SPV_FUNC_IMPL_NAME(ConvertYCbCrBT709);
+	SPV_FUNC_IMPL_NAME(ConvertYCbCrBT601);
+	SPV_FUNC_IMPL_NAME(ConvertYCbCrBT2020);
+	SPV_FUNC_IMPL_NAME(DynamicImageSampler);
+	SPV_FUNC_IMPL_NAME(RayQueryIntersectionParams);
+	SPV_FUNC_IMPL_NAME(VariableDescriptor);
+	SPV_FUNC_IMPL_NAME(VariableSizedDescriptor);
+	SPV_FUNC_IMPL_NAME(VariableDescriptorArray);
+	default:
+		return "";
+	}
+
+#undef SPV_FUNC_IMPL_NAME
+}
+
+string CompilerMSL::emit_spv_function_library(const std::set<SPVFuncImpl> &funcs)
+{
+	// funcs may alias spv_function_implementations, so copy rather than move.
+	auto saved_implementations = spv_function_implementations;
+	spv_function_implementations = funcs;
+	add_spv_function_dependencies();
+
+	buffer.reset();
+	statement("#pragma once");
+	if (spv_function_implementations.count(SPVFuncImplUnsafeArray) != 0)
+		statement("#pragma clang diagnostic ignored \"-Wmissing-braces\"");
+	statement("");
+	statement("#include <metal_stdlib>");
+	statement("#include <simd/simd.h>");
+	if (spv_function_implementations.count(SPVFuncImplRayQueryIntersectionParams) != 0)
+	{
+		statement("#if __METAL_VERSION__ >= 230");
+		statement("#include <metal_raytracing>");
+		statement("using namespace metal::raytracing;");
+		statement("#endif");
+	}
+	statement("");
+	statement("using namespace metal;");
+	statement("");
+
+	emit_custom_templates();
+	emit_custom_functions();
+
+	auto library = buffer.str();
+	spv_function_implementations = std::move(saved_implementations);
+	return library;
+}
+
 static string inject_top_level_storage_qualifier(const string &expr, const string &qualifier)
 {
 	// Easier to do this through text munging since the qualifier does not exist in the type system at all,
@@ -6708,7 +7633,7 @@ void CompilerMSL::declare_constant_arrays()
 	bool emitted = false;
 
 	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, SPIRConstant &c) {
-		if (c.specialization)
+		if (c.specialization || constant_is_duplicate(c.self))
 			return;
 
 		auto &type = this->get<SPIRType>(c.constant_type);
@@ -6744,7 +7669,7 @@ void CompilerMSL::declare_complex_constant_arrays()
 	bool emitted = false;
 
 	ir.for_each_typed_id<SPIRConstant>([&](uint32_t, SPIRConstant &c) {
-		if (c.specialization)
+		if (c.specialization || constant_is_duplicate(c.self))
 			return;
 
 		auto &type = this->get<SPIRType>(c.constant_type);
@@ -7124,6 +8049,10 @@ void CompilerMSL::emit_instruction(const Instruction &instruction)
 	auto ops = stream(instruction);
 	auto opcode = static_cast<Op>(instruction.op);
 
+	// Read-only arrays are indexed where they were copied from instead.
+	if (read_only_array_copy_offsets.count(instruction.offset))
+		return;
+
 	opcode = get_remapped_spirv_op(opcode);
 
 	// If we need to do implicit bitcasts, make sure we do it with the correct type.
@@ -8607,7 +9536,7 @@ void CompilerMSL::emit_interface_block(uint32_t ib_var_id)
 // If this is the entry point function, Metal-specific return value and function arguments are added.
 void CompilerMSL::emit_function_prototype(SPIRFunction &func, const Bitset &)
 {
-	if (func.self != ir.default_entry_point)
+	if (func.self != ir.default_entry_point && !emitting_array_argument_overload)
 		add_function_overload(func);
 
 	local_variable_names = resource_names;
@@ -9639,7 +10568,8 @@ string CompilerMSL::to_func_call_arg(const SPIRFunction::Parameter &arg, uint32_
 		arg_str = join("spvDynamicImageSampler<", type_to_glsl(get<SPIRType>(type.image.type)), ">(");
 
 	auto *c = maybe_get<SPIRConstant>(id);
-	if (msl_options.force_native_arrays && c && !get<SPIRType>(c->constant_type).array.empty())
+	if (msl_options.force_native_arrays && c && !get<SPIRType>(c->constant_type).array.empty() &&
+	    (c->specialization || !read_only_array_value_arguments.count(arg.id)))
 	{
 		// If we are passing a constant array directly to a function for some reason,
 		// the callee will expect an argument in thread const address space
@@ -11761,6 +12691,30 @@ string CompilerMSL::argument_decl(const SPIRFunction::Parameter &arg)
 	if (arg.alias_global_variable && var.basevariable)
 		name_id = var.basevariable;
 
+	// Read-only arrays which are passed where they live, see analyze_read_only_array_copies().
+	auto space_itr = array_argument_spaces.find(arg.id);
+	if (space_itr != end(array_argument_spaces) && space_itr->second != ArrayArgumentThread)
+	{
+		// Only constant arrays are declared with the array template, arrays in buffers are plain C arrays.
+		is_using_builtin_array = space_itr->second != ArrayArgumentConstantTemplate;
+		string decl = join(space_itr->second == ArrayArgumentConstDevice ? "const device " : "constant ",
+		                   type_to_glsl(type, arg.id));
+		auto array_size_decl = type_to_array_glsl(type);
+		if (array_size_decl.empty())
+			decl += join("& ", to_expression(name_id));
+		else
+			decl += join(" (&", to_expression(name_id), ")", array_size_decl);
+		is_using_builtin_array = false;
+		return decl;
+	}
+
+	if (space_itr != end(array_argument_spaces) && !is_pointer && is_array(type) &&
+	    read_only_array_value_arguments.count(arg.id) && !msl_options.force_native_arrays)
+	{
+		// A copy would be as good a match as the reference in the other overloads.
+		return join("thread const ", type_to_glsl(type, arg.id), "& ", to_expression(name_id));
+	}
+
 	bool constref = !arg.alias_global_variable && is_pointer && arg.write_count == 0;
 	// Framebuffer fetch is plain value, const looks out of place, but it is not wrong.
 	if (type_is_msl_framebuffer_fetch(type))
@@ -11853,6 +12807,18 @@ string CompilerMSL::argument_decl(const SPIRFunction::Parameter &arg)
 			if (*cv_qualifier != '\0')
 				decl += join(" ", cv_qualifier);
 		}
+		else if (arg.alias_global_variable &&
+		         (has_extended_decoration(arg.id, SPIRVCrossDecorationPhysicalTypePacked) ||
+		          has_extended_decoration(arg.id, SPIRVCrossDecorationPhysicalTypeID)))
+		{
+			// Aliases a member of a packed tessellation buffer, see pack_tessellation_buffer().
+			auto *physical_type = &type;
+			if (has_extended_decoration(arg.id, SPIRVCrossDecorationPhysicalTypeID))
+				physical_type = &get<SPIRType>(get_extended_decoration(arg.id, SPIRVCrossDecorationPhysicalTypeID));
+			const char *packed_pfx =
+			    has_extended_decoration(arg.id, SPIRVCrossDecorationPhysicalTypePacked) ? "packed_" : "";
+			decl = join(cv_qualifier, packed_pfx, type_to_glsl(*physical_type, arg.id));
+		}
 		else
 		{
 			decl = join(cv_qualifier, type_to_glsl(type, arg.id));
@@ -13659,10 +14625,17 @@ uint32_t CompilerMSL::get_declared_type_alignment_msl(const SPIRType &type, bool
 
 	case SPIRType::Struct:
 	{
+		auto *layout = find_struct_layout_msl(type);
+		if (layout && layout->alignment)
+			return layout->alignment;
+
 		// In MSL, a struct's alignment is equal to the maximum alignment of any of its members.
 		uint32_t alignment = 1;
 		for (uint32_t i = 0; i < type.member_types.size(); i++)
 			alignment = max(alignment, uint32_t(get_declared_struct_member_alignment_msl(type, i)));
+
+		if (layout)
+			layout->alignment = alignment;
 		return alignment;
 	}
 
@@ -14755,7 +15728,25 @@ void CompilerMSL::emit_function(SPIRFunction &func, const Bitset &return_flags)
 
 	if (func.entry_line.file_id != 0)
 		emit_line_directive(func.entry_line.file_id, func.entry_line.line_literal);
+
+	// Overloads for read-only array arguments in other address spaces share the body.
+	auto overloads_itr = array_argument_overloads.find(func.self);
+	const auto set_array_argument_spaces = [&](const SmallVector<ArrayArgumentSpace> &spaces) {
+		array_argument_spaces.clear();
+		for (size_t i = 0; i < spaces.size(); i++)
+			array_argument_spaces[func.arguments[i].id] = spaces[i];
+	};
+
+	if (overloads_itr != end(array_argument_overloads))
+		set_array_argument_spaces(overloads_itr->second.front());
 	emit_function_prototype(func, return_flags);
+	array_argument_spaces.clear();
+
+	StringStream<> prototype_buffer;
+	bool has_overloads = overloads_itr != end(array_argument_overloads) && overloads_itr->second.size() > 1;
+	if (has_overloads)
+		prototype_buffer = std::move(buffer);
+
 	begin_scope();
 
 	if (func.self == ir.default_entry_point)
@@ -14866,6 +15857,24 @@ void CompilerMSL::emit_function(SPIRFunction &func, const Bitset &return_flags)
 	processing_entry_point = false;
 	statement("");
 
+	if (has_overloads)
+	{
+		auto body = buffer.str();
+		buffer = std::move(prototype_buffer);
+		buffer << body;
+
+		emitting_array_argument_overload = true;
+		for (size_t i = 1; i < overloads_itr->second.size(); i++)
+		{
+			set_array_argument_spaces(overloads_itr->second[i]);
+			emit_function_prototype(func, return_flags);
+			buffer << body;
+		}
+		emitting_array_argument_overload = false;
+		array_argument_spaces.clear();
+		processing_entry_point = false;
+	}
+
 	// Make sure deferred declaration state for local variables is cleared when we are done with function.
 	// We risk declaring Private/Workgroup variables in places we are not supposed to otherwise.
 	for (auto &v : func.local_variables)
@@ -15132,9 +16141,9 @@ string CompilerMSL::to_expression(uint32_t id, bool register_expression_read)
 		else if (c.is_used_as_lut)
 			return to_name(id);
 		else if (type.basetype == SPIRType::Struct && !backend.can_declare_struct_inline)
-			return to_name(id);
+			return to_name(get_canonical_constant(id));
 		else if (!type.array.empty() && !backend.can_declare_arrays_inline)
-			return to_name(id);
+			return to_name(get_canonical_constant(id));
 		else
 			return constant_expression(c);
 	}
@@ -15282,10 +16291,19 @@ string CompilerMSL::constant_expression(const SPIRConstant &c,
 			res = type_to_glsl_constructor(type) + "(";
 		}
 
+		// Large tables are mostly flat arrays of scalars, which are formatted directly.
+		bool scalar_table = constant_is_scalar_table(c);
+		if (scalar_table)
+			res.reserve(res.size() + c.subconstants.size() * 8);
+
 		uint32_t subconstant_index = 0;
 		for (auto &elem : c.subconstants)
 		{
-			if (auto *op = maybe_get<SPIRConstantOp>(elem))
+			if (scalar_table)
+			{
+				res += constant_expression_vector(get<SPIRConstant>(elem), 0);
+			}
+			else if (auto *op = maybe_get<SPIRConstantOp>(elem))
 			{
 				res += constant_op_expression(*op);
 			}
@@ -17309,8 +18327,7 @@ string CompilerMSL::to_array_size(const SPIRType &type, uint32_t index)
 		return "";
 }
 
-void CompilerMSL::add_variable(unordered_set<string> &variables_primary,
-                                const unordered_set<string> &variables_secondary, string &name)
+void CompilerMSL::add_variable(NameCache &variables_primary, const NameCache &variables_secondary, string &name)
 {
 	if (name.empty())
 		return;
@@ -18302,6 +19319,7 @@ void CompilerMSL::emit_block_instructions(SPIRBlock &block)
 
 	for (auto &op : block.ops)
 	{
+		compile_budget.check();
 		auto temporary_copy = handle_instruction_precision(op);
 		emit_instruction(op);
 		if (temporary_copy.dst_id)
@@ -20765,7 +21783,7 @@ void CompilerMSL::GLSL_emit_instruction(const Instruction &instruction)
 		auto *var = maybe_get<SPIRVariable>(ops[0]);
 
 		if (var && var->statically_assigned)
-			var->static_expression = ops[1];
+			var->static_expression = get_canonical_constant(ops[1]);
 		else if (var && var->loop_variable && !var->loop_variable_enable)
 			var->static_expression = ops[1];
 		else if (var && var->remapped_variable && var->static_expression)
@@ -21271,6 +22289,11 @@ void CompilerMSL::GLSL_emit_instruction(const Instruction &instruction)
 			auto &e = set<SPIRCombinedImageSampler>(id, *imgsamp);
 			e.self = id;
 		}
+		else if (common_subexpressions.count(id))
+		{
+			// Computes the same value as rhs, which is bound to a temporary, so just refer to it.
+			emit_op(result_type, id, to_expression(rhs), true, true);
+		}
 		else if (expression_is_lvalue(rhs) && !pointer)
 		{
 			// Need a copy.
@@ -25657,6 +26680,16 @@ void CompilerMSL::require_polyfill(Polyfill polyfill, bool relaxed)
 	}
 }
 
+void CompilerMSL::append_backend_resource_costs(ResourceCostReport &report) const
+{
+	for (auto &impl : spv_function_implementations)
+		report.helper_functions.push_back(get_spv_function_implementation_name(impl));
+
+	append_polyfill_costs(report, required_polyfills, required_polyfills_relaxed);
+
+	report.backend_workgroup_memory_size += multi_patch_workgroup_storage_size;
+}
+
 void CompilerMSL::GLSL_emit_spv_amd_shader_trinary_minmax_op(uint32_t result_type, uint32_t id, uint32_t eop,
                                                          const uint32_t *args, uint32_t)
 {
@@ -26883,6 +27916,11 @@ bool CompilerMSL::has_extension(const std::string &ext) const
 	return itr != end(forced_extensions);
 }
 
+void CompilerMSL::mask_stage_output_by_location(uint32_t location, uint32_t component)
+{
+	masked_output_locations.insert({ location, component });
+}
+
 void CompilerMSL::mask_stage_output_by_builtin(BuiltIn builtin)
 {
 	masked_output_builtins.insert(builtin);
@@ -27413,6 +28451,27 @@ void CompilerMSL::analyze_argument_buffers()
 				// shader is only accesing part, or even one element, of the array.
 				next_arg_buff_index += rez_bind.count;
 			}
+			else if (msl_options.argument_buffers_stable_layout &&
+			         msl_options.argument_buffers_tier >= Options::ArgumentBuffersTier::Tier2 && !resource.descriptor_alias)
+			{
+				if (inline_uniform_blocks.count(SetBindingPair{ desc_set, get_decoration(var.self, DecorationBinding) }))
+					SPIRV_CROSS_THROW("Inline uniform blocks cannot be part of a stable argument buffer layout.");
+
+				// Every slot is 8 bytes in a Tier 2 argument buffer, so any 8-byte type can stand in for unused resources.
+				if (resource.index > next_arg_buff_index)
+				{
+					MSLResourceBinding rez_bind;
+					rez_bind.basetype = SPIRType::UInt;
+					rez_bind.count = resource.index - next_arg_buff_index;
+					add_argument_buffer_padding_buffer_type(buffer_type, member_index, next_arg_buff_index, rez_bind);
+				}
+
+				// The buffer emulating image atomics is a single pointer, even for arrays of images.
+				uint32_t slot_count = 1;
+				if (resource.basetype != SPIRType::Struct || type.basetype == SPIRType::Struct)
+					slot_count = max(get_argument_buffer_member_array_size(type), 1u);
+				next_arg_buff_index = max(next_arg_buff_index, resource.index + slot_count);
+			}
 
 			string mbr_name = ensure_valid_name(resource.name, "m");
 			if (resource.plane > 0)
@@ -27739,6 +28798,11 @@ uint32_t CompilerMSL::get_declared_struct_size_msl(const SPIRType &struct_type,
 	if (struct_type.member_types.empty())
 		return 0;
 
+	auto *layout = find_struct_layout_msl(struct_type);
+	uint32_t variant = uint32_t(ignore_alignment) + 2u * uint32_t(ignore_padding);
+	if (layout && (layout->known_sizes & (1u << variant)) != 0)
+		return layout->size[variant];
+
 	uint32_t mbr_cnt = uint32_t(struct_type.member_types.size());
 
 	// In MSL, a struct's alignment is equal to the maximum alignment of any of its members.
@@ -27758,9 +28822,37 @@ uint32_t CompilerMSL::get_declared_struct_size_msl(const SPIRType &struct_type,
 	uint32_t spirv_offset = type_struct_member_offset(struct_type, mbr_cnt - 1);
 	uint32_t msl_size = spirv_offset + get_declared_struct_member_size_msl(struct_type, mbr_cnt - 1);
 	msl_size = (msl_size + alignment - 1) & ~(alignment - 1);
+
+	if (layout)
+	{
+		layout->size[variant] = msl_size;
+		layout->known_sizes |= 1u << variant;
+	}
 	return msl_size;
 }
 
+CompilerMSL::StructLayoutMSL *CompilerMSL::find_struct_layout_msl(const SPIRType &type) const
+{
+	// Only the type owned by the IR can be cached, not a modified copy of it.
+	if (maybe_get<SPIRType>(type.self) != &type)
+		return nullptr;
+
+	if (struct_layout_cache_version_msl != ir.get_type_layout_version())
+	{
+		struct_layout_cache_msl.clear();
+		struct_layout_cache_version_msl = ir.get_type_layout_version();
+	}
+
+	// Members are appended to interface blocks as they are built.
+	auto &layout = struct_layout_cache_msl[type.self];
+	if (layout.member_count != type.member_types.size())
+	{
+		layout = {};
+		layout.member_count = type.member_types.size();
+	}
+	return &layout;
+}
+
 
 SPIRType CompilerMSL::get_presumed_input_type(const SPIRType &ib_type, uint32_t index) const
 {
@@ -29230,12 +30322,20 @@ bool CompilerMSL::emit_tessellation_io_load(uint32_t result_type_id, uint32_t id
 		expr += type_to_glsl(result_type) + "({ ";
 		uint32_t num_control_points = to_array_size_literal(result_type, uint32_t(result_type.array.size()) - 1);
 
+		// Packed tessellation buffers might hold the control points at a lower precision, see pack_tessellation_buffer().
+		auto &ib_type = get_variable_data_type(get<SPIRVariable>(stage_in_var_id));
+		bool convert = has_extended_member_decoration(ib_type.self, interface_index, SPIRVCrossDecorationPhysicalTypeID);
+
 		for (uint32_t i = 0; i < num_control_points; i++)
 		{
 			const uint32_t indices[2] = { i, interface_index };
 			AccessChainMeta meta;
-			expr += access_chain_internal(stage_in_ptr_var_id, indices, 2,
-			                              ACCESS_CHAIN_INDEX_IS_LITERAL_BIT | ACCESS_CHAIN_PTR_CHAIN_BIT, &meta);
+			auto elem_expr = access_chain_internal(stage_in_ptr_var_id, indices, 2,
+			                                       ACCESS_CHAIN_INDEX_IS_LITERAL_BIT | ACCESS_CHAIN_PTR_CHAIN_BIT, &meta);
+			if (convert)
+				expr += join(type_to_glsl(get<SPIRType>(result_type.parent_type)), "(", elem_expr, ")");
+			else
+				expr += elem_expr;
 			if (i + 1 < num_control_points)
 				expr += ", ";
 		}
@@ -29717,6 +30817,95 @@ uint32_t CompilerMSL::add_interface_block_pointer(uint32_t ib_var_id, StorageCla
 	return ib_ptr_var_id;
 }
 
+// Returns the interface block which this stage reads from or writes to a buffer of vertex, control point or patch data,
+// or 0 if that part of the interface is not held in a buffer.
+uint32_t CompilerMSL::get_tessellation_buffer_var_id(StorageClass storage, bool patch) const
+{
+	if (storage == StorageClassOutput)
+		return capture_output_to_buffer ? uint32_t(patch ? patch_stage_out_var_id : stage_out_var_id) : 0;
+
+	if (storage == StorageClassInput)
+	{
+		if (is_tese_shader() && msl_options.raw_buffer_tese_input)
+			return patch ? patch_stage_in_var_id : stage_in_var_id;
+		if (is_tesc_shader() && msl_options.multi_patch_workgroup && !patch)
+			return stage_in_var_id;
+	}
+
+	return 0;
+}
+
+// This has to run before the interface block pointers copy the layout of the interface blocks,
+// and before global variables are passed to functions, so that the parameters pick up the physical types.
+void CompilerMSL::pack_tessellation_buffers()
+{
+	pack_tessellation_buffer(get_tessellation_buffer_var_id(StorageClassOutput, false), is_tesc_shader());
+	pack_tessellation_buffer(get_tessellation_buffer_var_id(StorageClassOutput, true), false);
+	pack_tessellation_buffer(get_tessellation_buffer_var_id(StorageClassInput, false), true);
+	pack_tessellation_buffer(get_tessellation_buffer_var_id(StorageClassInput, true), false);
+}
+
+void CompilerMSL::pack_tessellation_buffer(uint32_t ib_var_id, bool strip_array)
+{
+	if (!ib_var_id)
+		return;
+
+	auto &ib_type = get_variable_data_type(get<SPIRVariable>(ib_var_id));
+	for (uint32_t i = 0; i < uint32_t(ib_type.member_types.size()); i++)
+	{
+		// Builtins are passed to functions with their regular types, and we cannot pack arrays, matrices or structs.
+		auto &mbr_type = get<SPIRType>(ib_type.member_types[i]);
+		if (is_member_builtin(ib_type, i, nullptr) || is_array(mbr_type) || is_matrix(mbr_type) ||
+		    mbr_type.basetype == SPIRType::Struct)
+			continue;
+
+		// Find out whether the member holds an entire variable, rather than part of a flattened one.
+		uint32_t orig_id = get_extended_member_decoration(ib_type.self, i, SPIRVCrossDecorationInterfaceOrigID);
+		auto *var = maybe_get<SPIRVariable>(orig_id);
+		bool whole_variable = false;
+		if (var)
+		{
+			auto *var_type = &get_variable_data_type(*var);
+			if (strip_array && is_array(*var_type))
+				var_type = &get<SPIRType>(var_type->parent_type);
+			whole_variable = var_type->basetype == mbr_type.basetype && var_type->width == mbr_type.width &&
+			                 var_type->vecsize == mbr_type.vecsize && !is_array(*var_type) &&
+			                 !is_matrix(*var_type);
+		}
+
+		bool packed = !is_scalar(mbr_type);
+		uint32_t physical_type_id = 0;
+		if (msl_options.pack_tessellation_buffers_relaxed_precision_as_half && whole_variable &&
+		    mbr_type.basetype == SPIRType::Float && mbr_type.width == 32 &&
+		    has_decoration(var->self, DecorationRelaxedPrecision))
+		{
+			auto physical_type = mbr_type;
+			physical_type.basetype = SPIRType::Half;
+			physical_type.width = 16;
+			physical_type.parent_type = 0;
+			physical_type_id = ir.increase_bound_by(1);
+			set<SPIRType>(physical_type_id, physical_type);
+		}
+
+		if (packed)
+			set_extended_member_decoration(ib_type.self, i, SPIRVCrossDecorationPhysicalTypePacked);
+		if (physical_type_id)
+			set_extended_member_decoration(ib_type.self, i, SPIRVCrossDecorationPhysicalTypeID, physical_type_id);
+
+		// Variables which are not arrayed by control point are accessed directly through the member,
+		// so loads and stores need to know about the physical type as well.
+		if (whole_variable && !strip_array)
+		{
+			if (packed)
+				set_extended_decoration(var->self, SPIRVCrossDecorationPhysicalTypePacked);
+			if (physical_type_id)
+				set_extended_decoration(var->self, SPIRVCrossDecorationPhysicalTypeID, physical_type_id);
+		}
+	}
+
+	ir.invalidate_type_layouts();
+}
+
 string CompilerMSL::to_tesc_invocation_id()
 {
 	if (msl_options.multi_patch_workgroup)
@@ -29751,6 +30940,7 @@ void CompilerMSL::emit_local_masked_variable(const SPIRVariable &masked_var, boo
 			statement("threadgroup ", type_to_glsl(type), " ",
 			          "spvStorage", to_name(masked_var.self), "[", max_num_instances, "]",
 			          type_to_array_glsl(type), ";");
+			multi_patch_workgroup_storage_size += max_num_instances * get_estimated_type_size(type);
 
 			// Assign a threadgroup slice to each PrimitiveID.
 			// We assume here that workgroup size is rounded to 32,
@@ -30416,6 +31606,112 @@ void CompilerMSL::set_fragment_output_components(uint32_t location, uint32_t com
 {
 	fragment_output_components[location] = components;
 }
+
+// Number of 8-byte entries a resource of this type takes in a Tier 2 argument buffer,
+// or 0 for runtime sized arrays, which are held as a single address.
+uint32_t CompilerMSL::get_argument_buffer_member_array_size(const SPIRType &type) const
+{
+	uint32_t array_size = 1;
+	for (uint32_t i = 0; i < uint32_t(type.array.size()); i++)
+		array_size *= to_array_size_literal(type, i);
+	return array_size;
+}
+
+bool CompilerMSL::get_argument_buffer_layout(uint32_t desc_set, MSLArgumentBufferLayout &layout) const
+{
+	layout = {};
+	if (desc_set >= kMaxArgumentBuffers || !argument_buffer_ids[desc_set] ||
+	    msl_options.argument_buffers_tier < Options::ArgumentBuffersTier::Tier2)
+		return false;
+
+	auto &buffer_type = get_variable_data_type(get<SPIRVariable>(argument_buffer_ids[desc_set]));
+	uint32_t buffer_alignment = 1;
+
+	for (uint32_t i = 0; i < uint32_t(buffer_type.member_types.size()); i++)
+	{
+		auto &type = get<SPIRType>(buffer_type.member_types[i]);
+		MSLArgumentBufferMember member;
+		member.msl_index =
+		    get_extended_member_decoration(buffer_type.self, i, SPIRVCrossDecorationResourceIndexPrimary);
+		member.var_id = get_extended_member_decoration(buffer_type.self, i, SPIRVCrossDecorationInterfaceOrigID);
+
+		uint32_t alignment = 8;
+		if (!type.pointer && type.basetype == SPIRType::Struct)
+		{
+			// Inline uniform blocks are embedded with their regular MSL layout.
+			member.kind = MSL_ARGUMENT_BUFFER_MEMBER_KIND_INLINE_DATA;
+			member.size = get_declared_struct_size_msl(type);
+			alignment = get_declared_type_alignment_msl(type, false, false);
+		}
+		else
+		{
+			if (type.pointer)
+				member.kind = MSL_ARGUMENT_BUFFER_MEMBER_KIND_BUFFER;
+			else if (type.basetype == SPIRType::Image || type.basetype == SPIRType::SampledImage)
+				member.kind = MSL_ARGUMENT_BUFFER_MEMBER_KIND_TEXTURE;
+			else if (type.basetype == SPIRType::Sampler)
+				member.kind = MSL_ARGUMENT_BUFFER_MEMBER_KIND_SAMPLER;
+			else if (type.basetype == SPIRType::AccelerationStructure)
+				member.kind = MSL_ARGUMENT_BUFFER_MEMBER_KIND_ACCELERATION_STRUCTURE;
+			else
+				SPIRV_CROSS_THROW("Unexpected member type in argument buffer.");
+
+			member.array_size = get_argument_buffer_member_array_size(type);
+			member.size = 8 * max(member.array_size, 1u);
+		}
+
+		buffer_alignment = max(buffer_alignment, alignment);
+		member.offset = (layout.size + alignment - 1) & ~(alignment - 1);
+		layout.size = member.offset + member.size;
+		layout.members.push_back(member);
+	}
+
+	layout.size = (layout.size + buffer_alignment - 1) & ~(buffer_alignment - 1);
+	return true;
+}
+
+bool CompilerMSL::get_tessellation_buffer_layout(StorageClass storage, bool patch,
+                                                 MSLTessellationBufferLayout &layout) const
+{
+	layout = {};
+	uint32_t ib_var_id = get_tessellation_buffer_var_id(storage, patch);
+	if (!ib_var_id)
+		return false;
+
+	auto &ib_type = get_variable_data_type(get<SPIRVariable>(ib_var_id));
+	uint32_t buffer_alignment = 1;
+	uint32_t size = 0;
+
+	for (uint32_t i = 0; i < uint32_t(ib_type.member_types.size()); i++)
+	{
+		MSLTessellationBufferMember member;
+		BuiltIn builtin = BuiltInMax;
+		if (is_member_builtin(ib_type, i, &builtin))
+			member.builtin = builtin;
+		else
+		{
+			member.location = get_member_decoration(ib_type.self, i, DecorationLocation);
+			member.component = get_member_decoration(ib_type.self, i, DecorationComponent);
+		}
+
+		auto &physical_type = get_physical_member_type(ib_type, i);
+		if (physical_type.width == 16)
+			member.format = MSL_SHADER_VARIABLE_FORMAT_ANY16;
+		else if (physical_type.width == 32)
+			member.format = MSL_SHADER_VARIABLE_FORMAT_ANY32;
+		member.vecsize = physical_type.vecsize;
+
+		uint32_t alignment = get_declared_struct_member_alignment_msl(ib_type, i);
+		member.size = get_declared_struct_member_size_msl(ib_type, i);
+		member.offset = (size + alignment - 1) & ~(alignment - 1);
+		size = member.offset + member.size;
+		buffer_alignment = max(buffer_alignment, alignment);
+		layout.members.push_back(member);
+	}
+
+	layout.stride = (size + buffer_alignment - 1) & ~(buffer_alignment - 1);
+	return true;
+}
 #else // SPIRV_CROSS_WEBMIN 
 void CompilerMSL::store_flattened_struct(const string &, uint32_t, const SPIRType &,
                                           const SmallVector<uint32_t> &)
@@ -30716,6 +32012,12 @@ void CompilerMSL::require_polyfill(Polyfill, bool)
 	SPIRV_CROSS_THROW("Invalid call.");
 }
 
+void CompilerMSL::append_backend_resource_costs(ResourceCostReport &) const
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
 void CompilerMSL::GLSL_emit_spv_amd_shader_trinary_minmax_op(uint32_t, uint32_t, uint32_t,
                                                          const uint32_t *, uint32_t)
 {
@@ -30978,6 +32280,12 @@ bool CompilerMSL::has_extension(const std::string &) const
 	SPIRV_CROSS_THROW("Invalid call.");
 }
 
+void CompilerMSL::mask_stage_output_by_location(uint32_t, uint32_t)
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
 void CompilerMSL::mask_stage_output_by_builtin(BuiltIn)
 {
 	SPIRV_CROSS_INVALID_CALL();
@@ -31418,6 +32726,24 @@ uint32_t CompilerMSL::add_interface_block_pointer(uint32_t, StorageClass)
 	SPIRV_CROSS_THROW("Invalid call.");
 }
 
+uint32_t CompilerMSL::get_tessellation_buffer_var_id(StorageClass, bool) const
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
+void CompilerMSL::pack_tessellation_buffers()
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
+void CompilerMSL::pack_tessellation_buffer(uint32_t, bool)
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
 string CompilerMSL::to_tesc_invocation_id()
 {
 	SPIRV_CROSS_INVALID_CALL();
@@ -31619,4 +32945,22 @@ void CompilerMSL::set_fragment_output_components(uint32_t, uint32_t)
 	SPIRV_CROSS_INVALID_CALL();
 	SPIRV_CROSS_THROW("Invalid call.");
 }
+
+uint32_t CompilerMSL::get_argument_buffer_member_array_size(const SPIRType &) const
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
+bool CompilerMSL::get_argument_buffer_layout(uint32_t, MSLArgumentBufferLayout &) const
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
+
+bool CompilerMSL::get_tessellation_buffer_layout(StorageClass, bool, MSLTessellationBufferLayout &) const
+{
+	SPIRV_CROSS_INVALID_CALL();
+	SPIRV_CROSS_THROW("Invalid call.");
+}
 #endif // SPIRV_CROSS_WEBMIN
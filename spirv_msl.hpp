@@ -115,6 +115,67 @@ struct MSLResourceBinding
 	uint32_t msl_sampler = 0;
 };
 
+// The kind of resource held by a member of an argument buffer, as reported by get_argument_buffer_layout().
+enum MSLArgumentBufferMemberKind
+{
+	MSL_ARGUMENT_BUFFER_MEMBER_KIND_BUFFER = 0,
+	MSL_ARGUMENT_BUFFER_MEMBER_KIND_TEXTURE = 1,
+	MSL_ARGUMENT_BUFFER_MEMBER_KIND_SAMPLER = 2,
+	MSL_ARGUMENT_BUFFER_MEMBER_KIND_ACCELERATION_STRUCTURE = 3,
+	MSL_ARGUMENT_BUFFER_MEMBER_KIND_INLINE_DATA = 4,
+	MSL_ARGUMENT_BUFFER_MEMBER_KIND_INT_MAX = 0x7fffffff
+};
+
+// Describes where a member of a Tier 2 argument buffer lives, so that buffer addresses and resource IDs
+// can be written into the argument buffer directly instead of going through an MTLArgumentEncoder.
+// Buffers are written as their 64-bit GPU address, and textures, samplers and acceleration structures
+// as their 64-bit MTLResourceID. Inline uniform blocks are written as plain data.
+// Arrays of resources are laid out as array_size consecutive 8-byte entries. A runtime sized array
+// is a single 8-byte address of a separate array of descriptors, and reports an array_size of 0.
+// var_id is the variable the member was declared for, which is 0 for padding members.
+// The image and sampler halves of a combined image sampler, and the planes of a multiplanar image,
+// are separate members with the same var_id.
+struct MSLArgumentBufferMember
+{
+	MSLArgumentBufferMemberKind kind = MSL_ARGUMENT_BUFFER_MEMBER_KIND_BUFFER;
+	uint32_t msl_index = 0;
+	uint32_t offset = 0;
+	uint32_t size = 0;
+	uint32_t array_size = 1;
+	VariableID var_id = 0;
+};
+
+struct MSLArgumentBufferLayout
+{
+	// Members in declaration order, with increasing offsets.
+	SmallVector<MSLArgumentBufferMember> members;
+	// Size of the argument buffer in bytes, rounded up to its alignment.
+	uint32_t size = 0;
+};
+
+// Describes where a member of a buffer which tessellation stages exchange data through lives,
+// so that the buffer can be sized exactly and read by other passes.
+// builtin is BuiltInMax for members at a location. format and vecsize describe the stored type,
+// and can be given to add_msl_shader_input() of the next stage.
+struct MSLTessellationBufferMember
+{
+	uint32_t location = 0;
+	uint32_t component = 0;
+	spv::BuiltIn builtin = spv::BuiltInMax;
+	MSLShaderVariableFormat format = MSL_SHADER_VARIABLE_FORMAT_OTHER;
+	uint32_t vecsize = 0;
+	uint32_t offset = 0;
+	uint32_t size = 0;
+};
+
+struct MSLTessellationBufferLayout
+{
+	// Members in declaration order, with increasing offsets.
+	SmallVector<MSLTessellationBufferMember> members;
+	// Distance in bytes between consecutive vertices, control points or patches.
+	uint32_t stride = 0;
+};
+
 enum MSLSamplerCoord
 {
 	MSL_SAMPLER_COORD_NORMALIZED = 0,
@@ -431,6 +492,14 @@ public:
 		// optionally embedded directly into the argument buffer via add_inline_uniform_block().
 		bool pad_argument_buffer_resources = false;
 
+		// With Tier 2 argument buffers, pads the gaps between resources with 8-byte members, so that the resource
+		// with [[id(N)]] always lives at byte offset 8 * N, no matter which other resources a shader uses.
+		// Unlike pad_argument_buffer_resources, the base type and count of unused resources need not be known.
+		// Shaders sharing a descriptor set then agree on its layout, so one directly written argument buffer
+		// can be reused between pipelines. Inline uniform blocks cannot be part of such a set.
+		// Ignored for Tier 1, and when pad_argument_buffer_resources is enabled.
+		bool argument_buffers_stable_layout = false;
+
 		// Forces the use of plain arrays, which works around certain driver bugs on certain versions
 		// of Intel Macbooks. See https://github.com/KhronosGroup/SPIRV-Cross/issues/1210.
 		// May reduce performance in scenarios where arrays are copied around as value-types.
@@ -455,6 +524,20 @@ public:
 		// to index the output buffer.
 		bool vertex_for_tessellation = false;
 
+		// Lays out the vertex, control point and patch data which tessellation stages exchange through buffers
+		// without padding. This covers output captured with capture_output_to_buffer,
+		// multi_patch_workgroup input and raw_buffer_tese_input input.
+		// Vectors are stored as packed_ types, so every member is only aligned to its components.
+		// Builtins, arrays, matrices and structs keep their regular layout.
+		// Both stages which share a buffer must be compiled with the same setting, see get_tessellation_buffer_layout().
+		bool pack_tessellation_buffers = false;
+
+		// With pack_tessellation_buffers, stores float varyings which are decorated RelaxedPrecision as half.
+		// This only applies to plain scalar and vector variables, not to block members.
+		// The matching variables of the other stage need the same decoration. Locations which the other stage
+		// does not declare need to be given to add_msl_shader_input() with MSL_SHADER_VARIABLE_FORMAT_ANY16.
+		bool pack_tessellation_buffers_relaxed_precision_as_half = false;
+
 		// Assume that SubpassData images have multiple layers. Layered input attachments
 		// are addressed relative to the Layer output from the vertex pipeline. This option
 		// has no effect with multiview, since all input attachments are assumed to be layered
@@ -532,6 +615,10 @@ public:
 		// Note: Only Apple's GPU compiler takes advantage of the lack of coherency, so make sure to test on Apple GPUs if you disable this.
 		bool readwrite_texture_fences = true;
 
+		// Computes float arithmetic decorated with RelaxedPrecision in half, including loads of
+		// RelaxedPrecision struct members. Values are converted only where half and float expressions meet.
+		bool relaxed_precision_as_16bit = false;
+
 		bool is_ios() const
 		{
 			return platform == iOS;
@@ -759,8 +846,21 @@ public:
 	// in which case the third plane's binding is returned instead. For any other resource type, -1 is returned.
 	uint32_t get_automatic_msl_resource_binding_quaternary(uint32_t id) const;
 
+	// This must only be called after a successful call to CompilerMSL::compile().
+	// For a descriptor set emitted as a Tier 2 argument buffer, reports the byte offset, size and kind of
+	// every member. Returns false if the set is not an argument buffer, or the argument buffer tier is Tier 1.
+	bool get_argument_buffer_layout(uint32_t desc_set, MSLArgumentBufferLayout &layout) const;
+
+	// This must only be called after a successful call to CompilerMSL::compile().
+	// Reports the layout of the per-vertex or per-patch data which this stage writes to or reads from a buffer,
+	// see MSLOptions::pack_tessellation_buffers. storage is StorageClassOutput for output captured
+	// with capture_output_to_buffer, and StorageClassInput for multi_patch_workgroup and raw_buffer_tese_input input.
+	// Returns false if there is no such buffer.
+	bool get_tessellation_buffer_layout(spv::StorageClass storage, bool patch, MSLTessellationBufferLayout &layout) const;
+
 	// Compiles the SPIR-V code into Metal Shading Language.
 	std::string compile() override;
+	void reset_for_recompile() override;
 
 	// Remap a sampler with ID to a constexpr sampler.
 	// Older iOS targets must use constexpr samplers in certain cases (PCF),
@@ -782,7 +882,11 @@ public:
 	void set_combined_sampler_suffix(const char *suffix);
 	const char *get_combined_sampler_suffix() const;
 
-protected:
+	// Masks a stage output so that it is not emitted, either by location and component, or by builtin.
+	// Should only be used with stage outputs which are not consumed by the next stage.
+	void mask_stage_output_by_location(uint32_t location, uint32_t component) override;
+	void mask_stage_output_by_builtin(spv::BuiltIn builtin) override;
+
 	// An enum of SPIR-V functions that are implemented in additional
 	// source code that is added to the shader if necessary.
 	enum SPVFuncImpl : uint8_t
@@ -867,6 +971,33 @@ protected:
 		SPVFuncImplVariableDescriptorArray,
 	};
 
+	// Instead of emitting the helper functions and templates a shader needs into its source,
+	// include them from a shared header, i.e. #include "header" is emitted instead.
+	// The header can be generated with emit_spv_function_library(),
+	// using a compiler with the same MSL options as the shaders which include it.
+	// Pass an empty string to emit the helpers into each shader again, which is the default.
+	void set_spv_function_library_include(const std::string &header);
+
+	// Returns the helper functions and templates the shader depends on, including the helpers they in turn depend on.
+	// Only valid after compile(). The union of these sets over a collection of shaders can be passed to
+	// emit_spv_function_library() to build a shared header for set_spv_function_library_include().
+	const std::set<SPVFuncImpl> &get_spv_function_implementations() const;
+
+	// Returns the name of a helper for diagnostics, e.g. "Inverse4x4" for SPVFuncImplInverse4x4.
+	static const char *get_spv_function_implementation_name(SPVFuncImpl impl);
+
+	// Emits standalone MSL source declaring the given helper functions and templates.
+	// The output depends on the MSL options, but not on the shader this compiler was constructed from.
+	std::string emit_spv_function_library(const std::set<SPVFuncImpl> &funcs);
+
+protected:
+	// Only move-assigned by reset_for_recompile().
+	CompilerMSL &operator=(CompilerMSL &&other) = default;
+
+	// Moves the shader inputs or outputs added for the locations which link_stage_outputs() moved.
+	void stage_interface_relocated(spv::StorageClass storage,
+	                               const std::unordered_map<uint32_t, uint32_t> &new_locations) override;
+
 	// If the underlying resource has been used for comparison then duplicate loads of that resource must be too
 	// Use Metal's native frame-buffer fetch API for subpass inputs.
 	void emit_texture_op(const Instruction &i, bool sparse);
@@ -951,6 +1082,7 @@ protected:
 	void preprocess_op_codes();
 	void localize_global_variables();
 	void extract_global_variables_from_functions();
+	void analyze_read_only_array_copies();
 	void mark_packable_structs();
 	void mark_as_packable(SPIRType &type);
 	void mark_as_workgroup_struct(SPIRType &type);
@@ -961,6 +1093,9 @@ protected:
 	                                            std::unordered_set<uint32_t> &processed_func_ids);
 	uint32_t add_interface_block(spv::StorageClass storage, bool patch = false);
 	uint32_t add_interface_block_pointer(uint32_t ib_var_id, spv::StorageClass storage);
+	uint32_t get_tessellation_buffer_var_id(spv::StorageClass storage, bool patch) const;
+	void pack_tessellation_buffers();
+	void pack_tessellation_buffer(uint32_t ib_var_id, bool strip_array);
 
 	struct InterfaceBlockMeta
 	{
@@ -1015,6 +1150,7 @@ protected:
 	                                   uint32_t num_components, bool strip_array);
 
 	void emit_custom_templates();
+	void add_spv_function_dependencies();
 	void emit_custom_functions();
 	void emit_resources();
 	void emit_specialization_constants_and_structs();
@@ -1079,6 +1215,20 @@ protected:
 	uint32_t get_declared_struct_size_msl(const SPIRType &struct_type, bool ignore_alignment = false,
 	                                      bool ignore_padding = false) const;
 
+	// Sizes and alignments of structs owned by the IR, as computed by get_declared_struct_size_msl() and
+	// get_declared_type_alignment_msl(). Discarded whenever the type layout version of the IR changes.
+	struct StructLayoutMSL
+	{
+		size_t member_count = 0;
+		uint32_t alignment = 0;
+		// Indexed by ignore_alignment + 2 * ignore_padding.
+		uint32_t size[4] = {};
+		uint32_t known_sizes = 0;
+	};
+	mutable std::unordered_map<uint32_t, StructLayoutMSL> struct_layout_cache_msl;
+	mutable uint32_t struct_layout_cache_version_msl = 0;
+	StructLayoutMSL *find_struct_layout_msl(const SPIRType &type) const;
+
 	std::string to_component_argument(uint32_t id);
 	void align_struct(SPIRType &ib_type, std::unordered_set<uint32_t> &aligned_structs);
 	void mark_scalar_layout_structs(const SPIRType &ib_type);
@@ -1163,6 +1313,7 @@ protected:
 
 	Options msl_options;
 	std::set<SPVFuncImpl> spv_function_implementations;
+	std::string spv_function_library_include;
 	// Must be ordered to ensure declarations are in a specific order.
 	std::map<LocationComponentPair, MSLShaderInterfaceVariable> inputs_by_location;
 	std::unordered_map<uint32_t, MSLShaderInterfaceVariable> inputs_by_builtin;
@@ -1252,6 +1403,26 @@ protected:
 	std::unordered_set<uint32_t> atomic_image_vars; // Emulate texture2D atomic operations
 	std::unordered_set<uint32_t> pull_model_inputs;
 
+	// How a read-only array argument is declared in an overload of a function.
+	enum ArrayArgumentSpace : uint8_t
+	{
+		ArrayArgumentThread,
+		ArrayArgumentConstantTemplate, // Like constant arrays, unless native arrays are forced.
+		ArrayArgumentConstant, // Like arrays in uniform buffers.
+		ArrayArgumentConstDevice // Like arrays in read-only storage buffers.
+	};
+
+	// Instructions which copy read-only arrays, which are indexed where they live instead.
+	std::unordered_set<uint32_t> read_only_array_copy_offsets;
+	// For each function which is passed read-only arrays in other address spaces,
+	// the address space of every argument in each overload. Overloads share the body.
+	std::unordered_map<uint32_t, SmallVector<SmallVector<ArrayArgumentSpace>>> array_argument_overloads;
+	// Array arguments passed by value which are indexed where the caller's array lives.
+	std::unordered_set<uint32_t> read_only_array_value_arguments;
+	// Address spaces of the arguments in the overload whose prototype is being emitted.
+	std::unordered_map<uint32_t, ArrayArgumentSpace> array_argument_spaces;
+	bool emitting_array_argument_overload = false;
+
 	SmallVector<SPIRVariable *> entry_point_bindings;
 
 	// Must be ordered since array is in a specific order.
@@ -1272,6 +1443,7 @@ protected:
 	void add_argument_buffer_padding_image_type(SPIRType &struct_type, uint32_t &mbr_idx, uint32_t &arg_buff_index, MSLResourceBinding &rez_bind);
 	void add_argument_buffer_padding_sampler_type(SPIRType &struct_type, uint32_t &mbr_idx, uint32_t &arg_buff_index, MSLResourceBinding &rez_bind);
 	void add_argument_buffer_padding_type(uint32_t mbr_type_id, SPIRType &struct_type, uint32_t &mbr_idx, uint32_t &arg_buff_index, uint32_t count);
+	uint32_t get_argument_buffer_member_array_size(const SPIRType &type) const;
 
 	uint32_t get_target_components_for_fragment_location(uint32_t location) const;
 	uint32_t build_extended_vector_type(uint32_t type_id, uint32_t components,
@@ -1364,6 +1536,7 @@ protected:
 	};
 
 	// FROM GLSL
+public:
 	struct GLSLOptions
 	{
 		// The shading language version. Corresponds to #version $VALUE.
@@ -1436,6 +1609,11 @@ protected:
 		// compares.
 		bool relax_nan_checks = false;
 
+		// If non-zero, pure expressions which a block computes more than once from the same operands are computed
+		// once into a temporary, which the later copies read instead of inlining the expression again.
+		// Expressions made of fewer operations than this are still inlined at every use.
+		uint32_t common_subexpression_min_cost = 0;
+
 		// Loading row-major matrices from UBOs on older AMD Windows OpenGL drivers is problematic.
 		// To load these types correctly, we must generate a wrapper. them in a dummy function which only purpose is to
 		// ensure row_major decoration is actually respected.
@@ -1481,6 +1659,17 @@ protected:
 		} fragment;
 	};
 
+	const GLSLOptions &get_common_options() const
+	{
+		return options;
+	}
+
+	void set_common_options(const GLSLOptions &opts)
+	{
+		options = opts;
+	}
+
+protected:
 	GLSLOptions options;
 
 	struct ShaderSubgroupSupportHelper
@@ -1638,8 +1827,8 @@ protected:
 	SmallVector<std::string> header_lines;
 	SmallVector<std::string> forced_extensions;
 	std::unordered_map<uint32_t, uint32_t> extra_sub_expressions;
-	std::unordered_set<std::string> local_variable_names;
-	std::unordered_set<std::string> resource_names;
+	NameCache local_variable_names;
+	NameCache resource_names;
 	std::unordered_set<uint32_t> composite_insert_overwritten;
 	std::unordered_map<uint32_t, uint32_t> expression_usage_counts;
 	std::unordered_set<uint32_t> flushed_phi_variables;
@@ -1651,12 +1840,12 @@ protected:
 	std::unordered_map<std::string, std::unordered_set<uint64_t>> function_overloads;
 	std::unordered_map<uint32_t, uint32_t> temporary_to_mirror_precision_alias;
 	std::unordered_map<uint32_t, SmallVector<ConstantID>> const_composite_insert_ids;
-	std::unordered_set<std::string> block_names; // A union of all block_*_names.
+	NameCache block_names; // A union of all block_*_names.
 	std::unordered_map<uint32_t, std::string> preserved_aliases;
-	std::unordered_set<std::string> block_input_names;
-	std::unordered_set<std::string> block_output_names;
-	std::unordered_set<std::string> block_ubo_names;
-	std::unordered_set<std::string> block_ssbo_names;
+	NameCache block_input_names;
+	NameCache block_output_names;
+	NameCache block_ubo_names;
+	NameCache block_ssbo_names;
 	std::unordered_set<LocationComponentPair, InternalHasher> masked_output_locations;
 	std::vector<std::pair<uint32_t, uint32_t>> subpass_to_framebuffer_fetch_attachment;
 	
@@ -1784,7 +1973,6 @@ protected:
 	std::string convert_double_to_string(const SPIRConstant &value, uint32_t col, uint32_t row);
 	void require_extension_internal(const std::string &ext);
 	bool has_extension(const std::string &ext) const;
-	void mask_stage_output_by_builtin(spv::BuiltIn builtin);
 	std::string to_unpacked_row_major_matrix_expression(uint32_t id);
 	std::string to_unpacked_expression(uint32_t id, bool register_expression_read = true);
 	std::string to_dereferenced_expression(uint32_t id, bool register_expression_read = true);
@@ -1879,8 +2067,7 @@ protected:
 	std::string to_array_size(const SPIRType &type, uint32_t index);
 	std::string to_rerolled_array_expression(const SPIRType &parent_type, const std::string &expr, const SPIRType &type);
 
-	void add_variable(std::unordered_set<std::string> &variables_primary,
-	                  const std::unordered_set<std::string> &variables_secondary, std::string &name);
+	void add_variable(NameCache &variables_primary, const NameCache &variables_secondary, std::string &name);
 	void reset_name_caches();
 	void emit_line_directive(uint32_t file_id, uint32_t line_literal);
 	std::string variable_decl_function_local(SPIRVariable &variable);
@@ -1950,6 +2137,13 @@ protected:
 	uint32_t required_polyfills_relaxed = 0;
 	ShaderSubgroupSupportHelper shader_subgroup_supporter;
 	void require_polyfill(Polyfill polyfill, bool relaxed);
+	void append_backend_resource_costs(ResourceCostReport &report) const override;
+	size_t get_output_block_count() const override
+	{
+		return buffer.get_block_count();
+	}
+	// Threadgroup storage declared for multi_patch_workgroup, in bytes.
+	uint32_t multi_patch_workgroup_storage_size = 0;
 	uint32_t get_sparse_feedback_texel_id(uint32_t id) const;
 	SmallVector<ConstantID> get_composite_constant_ids(ConstantID const_id);
 	void set_composite_constant(ConstantID const_id, TypeID type_id, const SmallVector<ConstantID> &initializers);
@@ -29,16 +29,38 @@ using namespace spv;
 
 namespace SPIRV_CROSS_NAMESPACE
 {
+Parser::Parser()
+    : ir(owned_ir)
+{
+}
+
+Parser::Parser(ParsedIR &parent_ir, FunctionBodyState &state)
+    : ir(parent_ir)
+    , function_body(&state)
+{
+}
+
 Parser::Parser(vector<uint32_t> spirv)
+    : ir(owned_ir)
 {
 	ir.spirv = std::move(spirv);
 }
 
 Parser::Parser(const uint32_t *spirv_data, size_t word_count)
+    : ir(owned_ir)
 {
 	ir.spirv = vector<uint32_t>(spirv_data, spirv_data + word_count);
 }
 
+Parser::Parser(const uint32_t *spirv_data, size_t word_count, bool borrow_words)
+    : ir(owned_ir)
+{
+	if (borrow_words)
+		ir.spirv.borrow(spirv_data, word_count);
+	else
+		ir.spirv = vector<uint32_t>(spirv_data, spirv_data + word_count);
+}
+
 static bool decoration_is_string(Decoration decoration)
 {
 	switch (decoration)
@@ -78,17 +100,80 @@ static bool is_valid_spirv_version(uint32_t version)
 
 void Parser::parse()
 {
-	auto &spirv = ir.spirv;
+	finish();
+}
 
-	auto len = spirv.size();
-	if (len < 5)
-		SPIRV_CROSS_THROW("SPIRV file too small.");
+void Parser::feed(const uint32_t *spirv_data, size_t word_count)
+{
+	size_t offset = ir.spirv.size();
+	ir.spirv.append(spirv_data, word_count);
+
+	if (swap_endianness)
+	{
+		auto *words = ir.spirv.mutable_data();
+		transform(words + offset, words + offset + word_count, words + offset,
+		          [](uint32_t c) { return swap_endian(c); });
+	}
+
+	if (parse_offset == 0 && ir.spirv.size() >= 5)
+		parse_header();
+	// Function bodies are left for finish() if they are to be parsed concurrently.
+	if (parse_offset != 0)
+		parse_instructions(ir.spirv.size(), bool(task_runner));
+}
+
+void Parser::finish()
+{
+	if (parse_offset == 0)
+	{
+		if (ir.spirv.size() < 5)
+			SPIRV_CROSS_THROW("SPIRV file too small.");
+		parse_header();
+	}
+
+	if (task_runner)
+	{
+		parse_instructions(ir.spirv.size(), true);
+		parse_function_bodies_concurrently();
+	}
 
+	// Anything left over, which is everything if function bodies could not be parsed concurrently.
+	parse_instructions(ir.spirv.size(), false);
+	if (parse_offset != ir.spirv.size())
+		SPIRV_CROSS_THROW("SPIR-V instruction goes out of bounds.");
+
+	for (auto &fixup : forward_pointer_fixups)
+	{
+		auto &target = get<SPIRType>(fixup.first);
+		auto &source = get<SPIRType>(fixup.second);
+		target.member_types = source.member_types;
+		target.basetype = source.basetype;
+		target.self = source.self;
+	}
+	forward_pointer_fixups.clear();
+
+	if (current_function)
+		SPIRV_CROSS_THROW("Function was not terminated.");
+	if (current_block)
+		SPIRV_CROSS_THROW("Block was not terminated.");
+	if (ir.default_entry_point == 0)
+		SPIRV_CROSS_THROW("There is no entry point in the SPIR-V module.");
+}
+
+void Parser::parse_header()
+{
+	auto &spirv = ir.spirv;
+	auto len = spirv.size();
 	auto s = spirv.data();
 
 	// Endian-swap if we need to.
 	if (s[0] == swap_endian(MagicNumber))
-		transform(begin(spirv), end(spirv), begin(spirv), [](uint32_t c) { return swap_endian(c); });
+	{
+		auto *words = spirv.mutable_data();
+		transform(words, words + len, words, [](uint32_t c) { return swap_endian(c); });
+		s = words;
+		swap_endianness = true;
+	}
 
 	if (s[0] != MagicNumber || !is_valid_spirv_version(s[1]))
 		SPIRV_CROSS_THROW("Invalid SPIRV format.");
@@ -100,49 +185,218 @@ void Parser::parse()
 		SPIRV_CROSS_THROW("ID bound exceeds limit of 0x3fffff.\n");
 
 	ir.set_id_bounds(bound);
+	parse_offset = 5;
+}
 
-	uint32_t offset = 5;
+void Parser::parse_instructions(size_t end, bool stop_at_function)
+{
+	// Instructions are dispatched as soon as they are decoded, without collecting them first.
+	auto &spirv = ir.spirv;
 
-	SmallVector<Instruction> instructions;
-	while (offset < len)
+	while (parse_offset < end)
 	{
 		Instruction instr = {};
-		instr.op = spirv[offset] & 0xffff;
-		instr.count = (spirv[offset] >> 16) & 0xffff;
+		instr.op = spirv[parse_offset] & 0xffff;
+		uint32_t count = (spirv[parse_offset] >> 16) & 0xffff;
 
-		if (instr.count == 0)
+		if (count == 0)
 			SPIRV_CROSS_THROW("SPIR-V instructions cannot consume 0 words. Invalid SPIR-V file.");
 
-		instr.offset = offset + 1;
-		instr.length = instr.count - 1;
+		// The rest of the instruction has not arrived yet.
+		if (parse_offset + count > end)
+			break;
+		if (stop_at_function && instr.op == OpFunction)
+			break;
+
+		instr.offset = uint32_t(parse_offset + 1);
+		instr.length = uint16_t(count - 1);
+		parse_offset += count;
+
+		parse(instr);
+	}
+}
+
+bool Parser::parse_function_bodies_concurrently()
+{
+	// Find where each function starts and ends. Anything unexpected is left to the serial parse,
+	// so that it fails the same way.
+	size_t global_end;
+	SmallVector<SPIRVFunctionRange> ranges;
+	if (!find_spirv_function_ranges(ir.spirv, global_end, ranges) || global_end != parse_offset || ranges.size() < 2)
+		return false;
+
+	SmallVector<FunctionBodyState> states(ranges.size());
+	std::mutex pool_lock;
+	for (auto &state : states)
+		state.pool_lock = &pool_lock;
 
-		offset += instr.count;
+	task_runner(uint32_t(ranges.size()), [&](uint32_t index) {
+		Parser function_parser(ir, states[index]);
+		function_parser.parse_offset = ranges[index].begin;
+		function_parser.parse_instructions(ranges[index].end, false);
+	});
 
-		if (offset > spirv.size())
-			SPIRV_CROSS_THROW("SPIR-V instruction goes out of bounds.");
+	// Fill in what the function parsers deferred in module order, so IDs are allocated and listed
+	// exactly as when parsing serially.
+	for (auto &state : states)
+	{
+		for (auto &typed_id : state.typed_ids)
+		{
+			if (typed_id.first == TypeNone)
+				get<SPIRBlock>(typed_id.second).condition = create_selector_constant();
+			else
+				ir.append_typed_id(typed_id.first, typed_id.second);
+		}
 
-		instructions.push_back(instr);
+		ir.load_type_width.insert(state.load_type_width.begin(), state.load_type_width.end());
+		for (auto &loop : state.continue_block_to_loop_header)
+			ir.continue_block_to_loop_header[loop.first] = loop.second;
 	}
 
-	for (auto &i : instructions)
-		parse(i);
+	parse_offset = ranges.back().end;
+	return true;
+}
 
-	for (auto &fixup : forward_pointer_fixups)
+bool Parser::parse_incremental(ParsedIR previous)
+{
+	// Only a module which has not been fed in pieces can be compared against previous up front.
+	if (parse_offset == 0 && ir.spirv.size() >= 5)
 	{
-		auto &target = get<SPIRType>(fixup.first);
-		auto &source = get<SPIRType>(fixup.second);
-		target.member_types = source.member_types;
-		target.basetype = source.basetype;
-		target.self = source.self;
+		parse_header();
+		if (parse_changed_functions(previous))
+			return true;
 	}
-	forward_pointer_fixups.clear();
+
+	finish();
+	return false;
+}
+
+template <typename Op>
+static void for_each_result_id(const SPIRVWords &spirv, const SPIRVFunctionRange &range, const Op &op)
+{
+	uint32_t offset = range.begin;
+	while (offset < range.end)
+	{
+		uint32_t count = (spirv[offset] >> 16) & 0xffff;
+		bool has_result, has_result_type;
+		HasResultAndType(static_cast<spv::Op>(spirv[offset] & 0xffff), &has_result, &has_result_type);
+		uint32_t result = offset + (has_result_type ? 2 : 1);
+		if (has_result && result < offset + count)
+			op(spirv[result], offset);
+		offset += count;
+	}
+}
+
+bool Parser::parse_changed_functions(ParsedIR &previous)
+{
+	// The parser allocates IDs past the bound for some workarounds, which would have to be allocated anew.
+	SPIRVModuleDiff diff;
+	if (previous.spirv.size() < 5 || previous.ids.size() != previous.spirv[3] ||
+	    !diff_spirv_modules(previous.spirv, ir.spirv, diff))
+		return false;
+
+	uint32_t bound = ir.spirv[3];
+	auto words = std::move(ir.spirv);
+	ir = std::move(previous);
+
+	// Forget everything the replaced functions defined. Meta data all comes from the global section.
+	SmallVector<ID> removed;
+	for (auto &range : diff.replaced)
+	{
+		for_each_result_id(ir.spirv, range, [&](uint32_t id, uint32_t) {
+			if (id < ir.ids.size())
+				removed.push_back(id);
+		});
+	}
+
+	ir.remove_ids(removed);
+	for (auto id : removed)
+	{
+		ir.block_meta[id] = 0;
+		ir.load_type_width.erase(id);
+		ir.continue_block_to_loop_header.erase(BlockID(id));
+	}
+
+	ir.spirv = std::move(words);
+	ir.set_id_bounds(bound);
+
+	// Functions which did not change may have moved, and their instructions refer to words by offset.
+	for (size_t i = 0; i < diff.functions.size(); i++)
+	{
+		auto &range = diff.functions[i];
+		uint32_t previous_begin = diff.previous_begin[i];
+		if (previous_begin == 0 || previous_begin == range.begin)
+			continue;
+
+		for (auto block : get<SPIRFunction>(range.id).blocks)
+			for (auto &instr : get<SPIRBlock>(block).ops)
+				instr.offset += range.begin - previous_begin;
+	}
+
+	ignore_trailing_block_opcodes = false;
+	for (size_t i = 0; i < diff.functions.size(); i++)
+	{
+		if (diff.previous_begin[i] == 0)
+		{
+			parse_offset = diff.functions[i].begin;
+			parse_instructions(diff.functions[i].end, false);
+		}
+	}
+	parse_offset = ir.spirv.size();
+
+	if (ir.ids.size() != bound)
+	{
+		// Start over, in which case selector constants end up where parse() puts them.
+		auto arena = ir.get_memory_arena();
+		words = std::move(ir.spirv);
+		ir = ParsedIR();
+		if (arena)
+			ir.set_memory_arena(std::move(arena));
+		ir.spirv = std::move(words);
+		parse_offset = 0;
+		return false;
+	}
+
+	// IDs are listed in the order they are declared in, but the functions which were parsed again
+	// have appended theirs at the end. Everything declared globally comes first.
+	SmallVector<uint32_t> declared_at;
+	declared_at.resize(bound);
+	for (auto &range : diff.functions)
+		for_each_result_id(ir.spirv, range, [&](uint32_t id, uint32_t offset) {
+			if (id < bound)
+				declared_at[id] = offset;
+		});
+
+	const auto by_declaration = [&](ID a, ID b) { return declared_at[a] < declared_at[b]; };
+	for (auto &list : ir.ids_for_type)
+		stable_sort(begin(list), end(list), by_declaration);
+	stable_sort(begin(ir.ids_for_constant_undef_or_type), end(ir.ids_for_constant_undef_or_type), by_declaration);
+	stable_sort(begin(ir.ids_for_constant_or_variable), end(ir.ids_for_constant_or_variable), by_declaration);
 
 	if (current_function)
 		SPIRV_CROSS_THROW("Function was not terminated.");
 	if (current_block)
 		SPIRV_CROSS_THROW("Block was not terminated.");
-	if (ir.default_entry_point == 0)
-		SPIRV_CROSS_THROW("There is no entry point in the SPIR-V module.");
+	return true;
+}
+
+uint32_t Parser::create_selector_constant()
+{
+	uint32_t ids = ir.increase_bound_by(2);
+
+	SPIRType type;
+	type.basetype = SPIRType::Int;
+	type.width = 32;
+	set<SPIRType>(ids, type);
+	return set<SPIRConstant>(ids + 1, ids).self;
+}
+
+void Parser::record_load_type_width(ID id, uint32_t width)
+{
+	if (function_body)
+		function_body->load_type_width.insert({ id, width });
+	else
+		ir.load_type_width.insert({ id, width });
 }
 
 const uint32_t *Parser::stream(const Instruction &instr) const
@@ -158,7 +412,7 @@ const uint32_t *Parser::stream(const Instruction &instr) const
 	return &ir.spirv[instr.offset];
 }
 
-static string extract_string(const vector<uint32_t> &spirv, uint32_t offset)
+static string extract_string(const SPIRVWords &spirv, uint32_t offset)
 {
 	string ret;
 	for (uint32_t i = offset; i < spirv.size(); i++)
@@ -314,7 +568,7 @@ void Parser::parse(const Instruction &instruction)
 			{
 				const auto *type = maybe_get<SPIRType>(ops[0]);
 				if (type)
-					ir.load_type_width.insert({ ops[1], type->width });
+					record_load_type_width(ops[1], type->width);
 			}
 		}
 		break;
@@ -1023,15 +1277,11 @@ void Parser::parse(const Instruction &instruction)
 			if (current_block->true_block != current_block->next_block &&
 			    current_block->merge == SPIRBlock::MergeSelection)
 			{
-				uint32_t ids = ir.increase_bound_by(2);
-
-				SPIRType type;
-				type.basetype = SPIRType::Int;
-				type.width = 32;
-				set<SPIRType>(ids, type);
-				auto &c = set<SPIRConstant>(ids + 1, ids);
-
-				current_block->condition = c.self;
+				// IDs cannot be allocated while other functions are being parsed.
+				if (function_body)
+					function_body->typed_ids.push_back({ TypeNone, current_block->self });
+				else
+					current_block->condition = create_selector_constant();
 				current_block->default_block = current_block->true_block;
 				current_block->terminator = SPIRBlock::MultiSelect;
 				ir.block_meta[current_block->next_block] &= ~ParsedIR::BLOCK_META_SELECTION_MERGE_BIT;
@@ -1193,7 +1443,10 @@ void Parser::parse(const Instruction &instruction)
 		ir.block_meta[current_block->self] |= ParsedIR::BLOCK_META_LOOP_HEADER_BIT;
 		ir.block_meta[current_block->merge_block] |= ParsedIR::BLOCK_META_LOOP_MERGE_BIT;
 
-		ir.continue_block_to_loop_header[current_block->continue_block] = BlockID(current_block->self);
+		if (function_body)
+			function_body->continue_block_to_loop_header[current_block->continue_block] = BlockID(current_block->self);
+		else
+			ir.continue_block_to_loop_header[current_block->continue_block] = BlockID(current_block->self);
 
 		// Don't add loop headers to continue blocks,
 		// which would make it impossible branch into the loop header since
@@ -1262,7 +1515,7 @@ void Parser::parse(const Instruction &instruction)
 		{
 			const auto *type = maybe_get<SPIRType>(ops[0]);
 			if (type)
-				ir.load_type_width.insert({ ops[1], type->width });
+				record_load_type_width(ops[1], type->width);
 		}
 
 		if (!current_block)
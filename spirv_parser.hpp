@@ -25,6 +25,7 @@
 #define SPIRV_CROSS_PARSER_HPP
 
 #include "spirv_cross_parsed_ir.hpp"
+#include <mutex>
 #include <stdint.h>
 
 namespace SPIRV_CROSS_NAMESPACE
@@ -35,26 +36,105 @@ public:
 	Parser(const uint32_t *spirv_data, size_t word_count);
 	Parser(std::vector<uint32_t> spirv);
 
+	// If borrow_words is true, the SPIR-V is parsed in place rather than copied,
+	// and the resulting ParsedIR keeps referring to spirv_data.
+	// The caller must keep spirv_data alive and unmodified for as long as the ParsedIR,
+	// or any Compiler created from it, is in use. Words are only copied if they have to be rewritten.
+	Parser(const uint32_t *spirv_data, size_t word_count, bool borrow_words);
+
+	// Parses the whole module. Equivalent to finish() for a parser which has been fed words.
 	void parse();
 
+	// Parses the whole module like parse(), but takes what it can from previous, which has to be the unmodified
+	// result of parsing an earlier version of the same module, e.g. when a shader is hot reloaded.
+	// If nothing but function definitions changed, see diff_spirv_modules(), previous is taken over,
+	// including its memory arena, and only functions which changed are parsed.
+	// Otherwise the module is parsed from scratch. That includes every module with debug instructions between
+	// function definitions, such as OpLine or NonSemantic debug info, even if only a function body changed.
+	// Either way, the IR is identical to what parse() produces. Returns true if previous was taken over.
+	// Function bodies are parsed serially, even if a task runner is set.
+	bool parse_incremental(ParsedIR previous);
+
+	// Creates a parser which receives the module incrementally through feed().
+	Parser();
+
+	Parser(const Parser &) = delete;
+	void operator=(const Parser &) = delete;
+
+	// Appends words to the module, which can end in the middle of an instruction,
+	// and parses every instruction that has been completed.
+	// This allows parsing to overlap with I/O. Words are always copied.
+	void feed(const uint32_t *spirv_data, size_t word_count);
+
+	// Parses what remains and validates that the module is complete.
+	void finish();
+
+	// If set, function bodies are parsed concurrently on the runner once the global section has been parsed.
+	// The resulting IR is identical to parsing serially.
+	// Modules with a single function, or with anything between function definitions, such as OpLine,
+	// are parsed serially.
+	// With feed(), only the global section is parsed as words arrive, and function bodies are parsed by finish().
+	void set_task_runner(CompilerTaskRunner runner)
+	{
+		task_runner = std::move(runner);
+	}
+
 	ParsedIR &get_parsed_ir()
 	{
 		return ir;
 	}
 
 private:
-	ParsedIR ir;
+	// State which a parser for a single function body collects instead of writing it to the shared IR,
+	// so that it can be merged in module order.
+	struct FunctionBodyState
+	{
+		// In order of creation. TypeNone marks a block which still needs a selector constant.
+		SmallVector<std::pair<Types, ID>> typed_ids;
+		std::unordered_map<ID, uint32_t> load_type_width;
+		std::unordered_map<BlockID, BlockID> continue_block_to_loop_header;
+		// Serializes allocations from the object pools of the shared IR.
+		std::mutex *pool_lock = nullptr;
+	};
+
+	// Parses into the IR of parent, which is parsing other function bodies at the same time.
+	Parser(ParsedIR &parent_ir, FunctionBodyState &state);
+
+	ParsedIR owned_ir;
+	ParsedIR &ir;
+	FunctionBodyState *function_body = nullptr;
+	CompilerTaskRunner task_runner;
+
 	SPIRFunction *current_function = nullptr;
 	SPIRBlock *current_block = nullptr;
 	// For workarounds.
 	bool ignore_trailing_block_opcodes = false;
 
+	// Offset of the first word which has not been parsed yet.
+	size_t parse_offset = 0;
+	bool swap_endianness = false;
+
+	void parse_header();
+	void parse_instructions(size_t end, bool stop_at_function);
+	bool parse_function_bodies_concurrently();
+	bool parse_changed_functions(ParsedIR &previous);
+	uint32_t create_selector_constant();
+	void record_load_type_width(ID id, uint32_t width);
 	void parse(const Instruction &instr);
 	const uint32_t *stream(const Instruction &instr) const;
 
 	template <typename T, typename... P>
 	T &set(uint32_t id, P &&... args)
 	{
+		if (function_body)
+		{
+			std::lock_guard<std::mutex> holder{ *function_body->pool_lock };
+			function_body->typed_ids.push_back({ static_cast<Types>(T::type), id });
+			auto &var = variant_set<T>(ir.ids[id], std::forward<P>(args)...);
+			var.self = id;
+			return var;
+		}
+
 		ir.add_typed_id(static_cast<Types>(T::type), id);
 		auto &var = variant_set<T>(ir.ids[id], std::forward<P>(args)...);
 		var.self = id;
@@ -24,6 +24,7 @@
 #include "spirv_reflect.hpp"
 #include "spirv_glsl.hpp"
 #include <iomanip>
+#include <string.h>
 
 using namespace spv;
 using namespace SPIRV_CROSS_NAMESPACE;
@@ -37,6 +38,17 @@ enum class Type
 	Array,
 };
 
+enum class Format
+{
+	// Indented JSON, one value per line.
+	JSON,
+	// JSON without any whitespace.
+	CompactJSON,
+	// RFC 8949 CBOR with the same structure as the JSON output.
+	// Objects and arrays are written with indefinite length, so nothing has to be known up front.
+	CBOR,
+};
+
 using State = std::pair<Type, bool>;
 using Stack = std::stack<State>;
 
@@ -46,6 +58,8 @@ class Stream
 	StringStream<> buffer;
 	uint32_t indent{ 0 };
 	char current_locale_radix_character = '.';
+	Format format = Format::JSON;
+	const CompilerReflection::OutputCallback *sink = nullptr;
 
 public:
 	void set_current_locale_radix_character(char c)
@@ -53,6 +67,20 @@ public:
 		current_locale_radix_character = c;
 	}
 
+	void set_format(Format format_)
+	{
+		format = format_;
+	}
+
+	// If set, the output is handed to the sink in chunks as it's written instead of being kept in memory.
+	void set_sink(const CompilerReflection::OutputCallback *sink_)
+	{
+		sink = sink_;
+	}
+
+	void begin_document();
+	void end_document();
+
 	void begin_json_object();
 	void end_json_object();
 	void emit_json_key(const std::string &key);
@@ -76,12 +104,74 @@ public:
 	}
 
 private:
+	enum
+	{
+		SinkChunkSize = 4096
+	};
+
+	enum CBORMajorType : uint8_t
+	{
+		CBORUnsigned = 0,
+		CBORNegative = 1,
+		CBORText = 3,
+		CBORArray = 4,
+		CBORMap = 5,
+		CBORTag = 6,
+		CBORSimple = 7
+	};
+
+	enum CBORSimpleValue : uint8_t
+	{
+		CBORFalse = 20,
+		CBORTrue = 21,
+		CBORFloat32 = 26,
+		CBORIndefinite = 31
+	};
+
+	bool is_binary() const
+	{
+		return format == Format::CBOR;
+	}
+
+	void flush(bool force);
+	void check_state(Type type) const;
+	void begin_value();
+	void begin_nested(Type type, char open);
+	void end_nested(Type type, char close);
+
+	void emit_value(const std::string &value);
+	void emit_value(uint32_t value);
+	void emit_value(int32_t value);
+	void emit_value(float value);
+	void emit_value(bool value);
+
+	void cbor_head(uint8_t major, uint64_t value);
+	void cbor_byte(uint8_t byte)
+	{
+		buffer << char(byte);
+	}
+
 	inline void statement_indent()
 	{
+		if (format != Format::JSON)
+			return;
+
 		for (uint32_t i = 0; i < indent; i++)
 			buffer << "    ";
 	}
 
+	inline void statement_newline()
+	{
+		if (format == Format::JSON)
+			buffer << '\n';
+	}
+
+	inline void statement_separator()
+	{
+		buffer << ',';
+		statement_newline();
+	}
+
 	template <typename T>
 	inline void statement_inner(T &&t)
 	{
@@ -95,14 +185,6 @@ private:
 		statement_inner(std::forward<Ts>(ts)...);
 	}
 
-	template <typename... Ts>
-	inline void statement(Ts &&... ts)
-	{
-		statement_indent();
-		statement_inner(std::forward<Ts>(ts)...);
-		buffer << '\n';
-	}
-
 	template <typename... Ts>
 	void statement_no_return(Ts &&... ts)
 	{
@@ -116,163 +198,332 @@ using namespace simple_json;
 
 // Hackery to emit JSON without using nlohmann/json C++ library (which requires a
 // higher level of compiler compliance than is required by SPIRV-Cross
-void Stream::begin_json_array()
+void Stream::flush(bool force)
 {
-	if (!stack.empty() && stack.top().second)
+	if (!sink)
+		return;
+
+	if (force || buffer.size() >= SinkChunkSize)
 	{
-		statement_inner(",\n");
+		auto chunk = buffer.str();
+		if (!chunk.empty())
+			(*sink)(chunk.data(), chunk.size());
+		buffer.reset();
 	}
-	statement("[");
-	++indent;
-	stack.emplace(Type::Array, false);
 }
 
-void Stream::end_json_array()
+void Stream::begin_document()
+{
+	// Self-described CBOR tag, so the output can be told apart from JSON by its first bytes.
+	if (is_binary())
+		cbor_head(CBORTag, 55799);
+}
+
+void Stream::end_document()
+{
+	if (!stack.empty())
+		SPIRV_CROSS_THROW("Invalid JSON state");
+	flush(true);
+}
+
+void Stream::check_state(Type type) const
 {
-	if (stack.empty() || stack.top().first != Type::Array)
+	if (stack.empty() || stack.top().first != type)
 		SPIRV_CROSS_THROW("Invalid JSON state");
-	if (stack.top().second)
+}
+
+void Stream::cbor_head(uint8_t major, uint64_t value)
+{
+	uint8_t initial = uint8_t(major << 5);
+	if (value < 24)
 	{
-		statement_inner("\n");
+		cbor_byte(uint8_t(initial | value));
+		return;
 	}
-	--indent;
-	statement_no_return("]");
-	stack.pop();
-	if (!stack.empty())
+
+	uint32_t bytes;
+	if (value <= 0xffu)
 	{
-		stack.top().second = true;
+		cbor_byte(initial | 24);
+		bytes = 1;
+	}
+	else if (value <= 0xffffu)
+	{
+		cbor_byte(initial | 25);
+		bytes = 2;
+	}
+	else if (value <= 0xffffffffu)
+	{
+		cbor_byte(initial | 26);
+		bytes = 4;
+	}
+	else
+	{
+		cbor_byte(initial | 27);
+		bytes = 8;
 	}
+
+	// CBOR is big-endian.
+	for (uint32_t i = bytes; i; i--)
+		cbor_byte(uint8_t(value >> (8 * (i - 1))));
 }
 
-void Stream::emit_json_array_value(const std::string &value)
+void Stream::emit_value(const std::string &value)
 {
-	if (stack.empty() || stack.top().first != Type::Array)
-		SPIRV_CROSS_THROW("Invalid JSON state");
+	if (is_binary())
+	{
+		cbor_head(CBORText, value.size());
+		buffer << value;
+	}
+	else
+		statement_inner("\"", value, "\"");
+}
 
-	if (stack.top().second)
-		statement_inner(",\n");
+void Stream::emit_value(uint32_t value)
+{
+	if (is_binary())
+		cbor_head(CBORUnsigned, value);
+	else
+		statement_inner(value);
+}
 
-	statement_no_return("\"", value, "\"");
-	stack.top().second = true;
+void Stream::emit_value(int32_t value)
+{
+	if (is_binary())
+	{
+		if (value < 0)
+			cbor_head(CBORNegative, uint64_t(-(int64_t(value) + 1)));
+		else
+			cbor_head(CBORUnsigned, uint64_t(value));
+	}
+	else
+		statement_inner(value);
 }
 
-void Stream::emit_json_array_value(uint32_t value)
+void Stream::emit_value(float value)
 {
-	if (stack.empty() || stack.top().first != Type::Array)
-		SPIRV_CROSS_THROW("Invalid JSON state");
-	if (stack.top().second)
-		statement_inner(",\n");
-	statement_no_return(std::to_string(value));
-	stack.top().second = true;
+	if (is_binary())
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		cbor_byte(uint8_t((CBORSimple << 5) | CBORFloat32));
+		for (uint32_t i = 4; i; i--)
+			cbor_byte(uint8_t(bits >> (8 * (i - 1))));
+	}
+	else
+		statement_inner(convert_to_string(value, current_locale_radix_character));
 }
 
-void Stream::emit_json_array_value(bool value)
+void Stream::emit_value(bool value)
 {
-	if (stack.empty() || stack.top().first != Type::Array)
-		SPIRV_CROSS_THROW("Invalid JSON state");
-	if (stack.top().second)
-		statement_inner(",\n");
-	statement_no_return(value ? "true" : "false");
+	if (is_binary())
+		cbor_byte(uint8_t((CBORSimple << 5) | (value ? CBORTrue : CBORFalse)));
+	else
+		statement_inner(value ? "true" : "false");
+}
+
+void Stream::begin_value()
+{
+	if (!is_binary() && stack.top().second)
+		statement_separator();
 	stack.top().second = true;
 }
 
-void Stream::begin_json_object()
+void Stream::begin_nested(Type type, char open)
 {
-	if (!stack.empty() && stack.top().second)
+	if (is_binary())
+		cbor_byte(uint8_t(((type == Type::Object ? CBORMap : CBORArray) << 5) | CBORIndefinite));
+	else
 	{
-		statement_inner(",\n");
+		statement_inner(open);
+		statement_newline();
 	}
-	statement("{");
 	++indent;
-	stack.emplace(Type::Object, false);
+	stack.emplace(type, false);
 }
 
-void Stream::end_json_object()
+void Stream::end_nested(Type type, char close)
 {
-	if (stack.empty() || stack.top().first != Type::Object)
-		SPIRV_CROSS_THROW("Invalid JSON state");
+	check_state(type);
 	if (stack.top().second)
-	{
-		statement_inner("\n");
-	}
+		statement_newline();
 	--indent;
-	statement_no_return("}");
+
+	if (is_binary())
+		cbor_byte(0xff);
+	else
+		statement_no_return(close);
+
 	stack.pop();
 	if (!stack.empty())
 	{
 		stack.top().second = true;
 	}
+	flush(false);
+}
+
+void Stream::begin_json_array()
+{
+	if (!stack.empty() && stack.top().second && !is_binary())
+		statement_separator();
+	statement_indent();
+	begin_nested(Type::Array, '[');
+}
+
+void Stream::end_json_array()
+{
+	end_nested(Type::Array, ']');
+}
+
+void Stream::emit_json_array_value(const std::string &value)
+{
+	check_state(Type::Array);
+	begin_value();
+	statement_indent();
+	emit_value(value);
+}
+
+void Stream::emit_json_array_value(uint32_t value)
+{
+	check_state(Type::Array);
+	begin_value();
+	statement_indent();
+	emit_value(value);
+}
+
+void Stream::emit_json_array_value(bool value)
+{
+	check_state(Type::Array);
+	begin_value();
+	statement_indent();
+	emit_value(value);
+}
+
+void Stream::begin_json_object()
+{
+	if (!stack.empty() && stack.top().second && !is_binary())
+		statement_separator();
+	statement_indent();
+	begin_nested(Type::Object, '{');
+}
+
+void Stream::end_json_object()
+{
+	end_nested(Type::Object, '}');
 }
 
 void Stream::emit_json_key(const std::string &key)
 {
-	if (stack.empty() || stack.top().first != Type::Object)
-		SPIRV_CROSS_THROW("Invalid JSON state");
+	check_state(Type::Object);
+	begin_value();
 
-	if (stack.top().second)
-		statement_inner(",\n");
-	statement_no_return("\"", key, "\" : ");
-	stack.top().second = true;
+	if (is_binary())
+		emit_value(key);
+	else if (format == Format::CompactJSON)
+		statement_inner("\"", key, "\":");
+	else
+		statement_no_return("\"", key, "\" : ");
 }
 
 void Stream::emit_json_key_value(const std::string &key, const std::string &value)
 {
 	emit_json_key(key);
-	statement_inner("\"", value, "\"");
+	emit_value(value);
 }
 
 void Stream::emit_json_key_value(const std::string &key, uint32_t value)
 {
 	emit_json_key(key);
-	statement_inner(value);
+	emit_value(value);
 }
 
 void Stream::emit_json_key_value(const std::string &key, int32_t value)
 {
 	emit_json_key(key);
-	statement_inner(value);
+	emit_value(value);
 }
 
 void Stream::emit_json_key_value(const std::string &key, float value)
 {
 	emit_json_key(key);
-	statement_inner(convert_to_string(value, current_locale_radix_character));
+	emit_value(value);
 }
 
 void Stream::emit_json_key_value(const std::string &key, bool value)
 {
 	emit_json_key(key);
-	statement_inner(value ? "true" : "false");
+	emit_value(value);
 }
 
 void Stream::emit_json_key_object(const std::string &key)
 {
 	emit_json_key(key);
-	statement_inner("{\n");
-	++indent;
-	stack.emplace(Type::Object, false);
+	begin_nested(Type::Object, '{');
 }
 
 void Stream::emit_json_key_array(const std::string &key)
 {
 	emit_json_key(key);
-	statement_inner("[\n");
-	++indent;
-	stack.emplace(Type::Array, false);
+	begin_nested(Type::Array, '[');
 }
 
 void CompilerReflection::set_format(const std::string &format)
 {
-	if (format != "json")
-	{
+	if (format == "json")
+		output_format = OutputFormat::JSON;
+	else if (format == "json-compact")
+		output_format = OutputFormat::CompactJSON;
+	else if (format == "cbor")
+		output_format = OutputFormat::CBOR;
+	else
 		SPIRV_CROSS_THROW("Unsupported format");
-	}
+}
+
+void CompilerReflection::set_output_callback(OutputCallback cb)
+{
+	output_callback = std::move(cb);
+}
+
+void CompilerReflection::set_emit_resource_costs(bool enable)
+{
+	emit_resource_costs = enable;
+}
+
+void CompilerReflection::reset_for_recompile()
+{
+	CompilerReflection fresh{ ParsedIR() };
+	fresh.options = options;
+	fresh.output_format = output_format;
+	fresh.output_callback = std::move(output_callback);
+	fresh.emit_resource_costs = emit_resource_costs;
+	fresh.keep_state_for_recompile(*this);
+	*this = std::move(fresh);
 }
 
 string CompilerReflection::compile()
 {
+	CompileBudgetTracker::Scope budget_scope(compile_budget);
+	save_recompile_snapshot();
 	json_stream = std::make_shared<simple_json::Stream>();
 	json_stream->set_current_locale_radix_character(current_locale_radix_character);
+
+	switch (output_format)
+	{
+	case OutputFormat::CompactJSON:
+		json_stream->set_format(simple_json::Format::CompactJSON);
+		break;
+	case OutputFormat::CBOR:
+		json_stream->set_format(simple_json::Format::CBOR);
+		break;
+	default:
+		json_stream->set_format(simple_json::Format::JSON);
+		break;
+	}
+
+	if (output_callback)
+		json_stream->set_sink(&output_callback);
+
+	json_stream->begin_document();
 	json_stream->begin_json_object();
 	reorder_type_alias();
 	emit_entry_points();
@@ -280,6 +531,7 @@ string CompilerReflection::compile()
 	emit_resources();
 	emit_specialization_constants();
 	json_stream->end_json_object();
+	json_stream->end_document();
 	return json_stream->str();
 }
 
@@ -526,6 +778,17 @@ void CompilerReflection::emit_entry_points()
 				json_stream->emit_json_array_value(spec_z.id != ID(0));
 				json_stream->end_json_array();
 			}
+			if (emit_resource_costs)
+			{
+				ResourceCostReport report;
+				get_module_resource_costs(get_entry_point(e.name, e.execution_model).self, report);
+
+				json_stream->emit_json_key_object("resource_costs");
+				json_stream->emit_json_key_value("workgroup_memory_size", report.workgroup_memory_size);
+				json_stream->emit_json_key_value("local_array_size", report.local_array_size);
+				json_stream->emit_json_key_value("loop_count", report.loop_count);
+				json_stream->end_json_object();
+			}
 			json_stream->end_json_object();
 		}
 		json_stream->end_json_array();
@@ -25,6 +25,7 @@
 #define SPIRV_CROSS_REFLECT_HPP
 
 #include "spirv_glsl.hpp"
+#include <functional>
 #include <utility>
 
 namespace simple_json
@@ -63,10 +64,35 @@ public:
 		options.vulkan_semantics = true;
 	}
 
+	// Receives the output of compile() in chunks, in order.
+	using OutputCallback = std::function<void(const char *data, size_t size)>;
+
+	// Supported formats are "json" (the default), "json-compact", which is JSON without whitespace,
+	// and "cbor", which encodes the same document as binary CBOR (RFC 8949).
 	void set_format(const std::string &format);
+
+	// If set, compile() writes the reflection to the callback as it's generated
+	// and returns an empty string, so the document is never held in memory as a whole.
+	void set_output_callback(OutputCallback cb);
+
+	// If set, each entry point also reports "resource_costs", the parts of get_resource_cost_report()
+	// which do not depend on a compiled backend: workgroup memory, local arrays and loops.
+	void set_emit_resource_costs(bool enable);
+
 	std::string compile() override;
+	void reset_for_recompile() override;
 
 private:
+	// Only move-assigned by reset_for_recompile().
+	CompilerReflection &operator=(CompilerReflection &&other) = default;
+
+	enum class OutputFormat
+	{
+		JSON,
+		CompactJSON,
+		CBOR
+	};
+
 	static std::string execution_model_to_str(spv::ExecutionModel model);
 
 	void emit_entry_points();
@@ -84,6 +110,9 @@ private:
 	std::string to_member_name(const SPIRType &type, uint32_t index) const;
 
 	std::shared_ptr<simple_json::Stream> json_stream;
+	OutputFormat output_format = OutputFormat::JSON;
+	OutputCallback output_callback;
+	bool emit_resource_costs = false;
 };
 
 } // namespace SPIRV_CROSS_NAMESPACE
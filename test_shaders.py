@@ -249,6 +249,10 @@ def cross_compile_msl(shader, spirv, opt, iterations, paths):
     if '.argument-tier-1.' in shader:
         msl_args.append('--msl-argument-buffer-tier')
         msl_args.append('1')
+    if '.argument-stable-layout.' in shader:
+        msl_args.append('--msl-argument-buffer-tier')
+        msl_args.append('2')
+        msl_args.append('--msl-argument-buffers-stable-layout')
     if '.texture-buffer-native.' in shader:
         msl_args.append('--msl-texture-buffer-native')
     if '.framebuffer-fetch.' in shader:
@@ -334,6 +338,11 @@ def cross_compile_msl(shader, spirv, opt, iterations, paths):
         msl_args.append('--msl-raw-buffer-tese-input')
     if '.for-tess.' in shader:
         msl_args.append('--msl-vertex-for-tessellation')
+    if '.packed-tess.' in shader:
+        msl_args.append('--msl-pack-tessellation-buffers')
+    if '.packed-tess-half.' in shader:
+        msl_args.append('--msl-pack-tessellation-buffers')
+        msl_args.append('--msl-pack-tessellation-buffers-half')
     if '.fixed-sample-mask.' in shader:
         msl_args.append('--msl-additional-fixed-sample-mask')
         msl_args.append('0x00000022')
@@ -378,6 +387,13 @@ def cross_compile_msl(shader, spirv, opt, iterations, paths):
         msl_args.append('ClipDistance')
     if '.relax-nan.' in shader:
         msl_args.append('--relax-nan-checks')
+    if '.cse.' in shader:
+        msl_args.append('--eliminate-common-subexpressions')
+        msl_args.append('4')
+    if '.remove-unreachable.' in shader:
+        msl_args.append('--remove-unreachable')
+    if '.relaxed-16bit.' in shader:
+        msl_args.append('--msl-relaxed-precision-as-16bit')
 
     subprocess.check_call(msl_args)
 
@@ -459,7 +475,9 @@ def validate_shader_hlsl(shader, force_no_external_validation, paths):
             raise RuntimeError('Failed compiling HLSL shader')
 
 def shader_to_sm(shader):
-    if '.sm62.' in shader:
+    if '.sm66.' in shader:
+        return '66'
+    elif '.sm62.' in shader:
         return '62'
     elif '.sm60.' in shader:
         return '60'
@@ -520,6 +538,19 @@ def cross_compile_hlsl(shader, spirv, opt, force_no_external_validation, iterati
         hlsl_args.append('--hlsl-flatten-matrix-vertex-input-semantics')
     if '.relax-nan.' in shader:
         hlsl_args.append('--relax-nan-checks')
+    if '.cse.' in shader:
+        hlsl_args.append('--eliminate-common-subexpressions')
+        hlsl_args.append('4')
+    if '.remove-unreachable.' in shader:
+        hlsl_args.append('--remove-unreachable')
+    if '.relaxed-16bit.' in shader:
+        hlsl_args.append('--hlsl-relaxed-precision-as-16bit')
+    if '.lut-buffer.' in shader:
+        hlsl_args += ['--hlsl-lut-buffer', '16', '0', '0']
+    if '.root-constants.' in shader:
+        hlsl_args += ['--hlsl-root-constant-promotion-budget', '8']
+    if '.descriptor-heap.' in shader:
+        hlsl_args += ['--hlsl-descriptor-heap', '0', '1']
     if '.structured.' in shader:
         hlsl_args.append('--hlsl-preserve-structured-buffers')
     if '.flip-vert-y.' in shader:
@@ -633,10 +664,22 @@ def cross_compile(shader, vulkan, spirv, invalid_spirv, eliminate, is_legacy, fo
         extra_args += ['--glsl-ext-framebuffer-fetch-noncoherent']
     if '.zero-initialize.' in shader:
         extra_args += ['--force-zero-initialized-variables']
+    if '.minify.' in shader:
+        extra_args += ['--glsl-minify']
     if '.force-flattened-io.' in shader:
         extra_args += ['--glsl-force-flattened-io-blocks']
     if '.relax-nan.' in shader:
         extra_args.append('--relax-nan-checks')
+    if '.cse.' in shader:
+        extra_args += ['--eliminate-common-subexpressions', '4']
+    if '.remove-unreachable.' in shader:
+        extra_args.append('--remove-unreachable')
+    if '.specialize.' in shader:
+        extra_args += ['--specialize-constant', '0', '4', '--specialize-constant', '1', '3']
+    if '.lut-buffer.' in shader:
+        extra_args += ['--glsl-lut-buffer', '16', '0', '0']
+    if '.descriptor-heap.' in shader:
+        extra_args += ['--glsl-descriptor-heap', '2']
 
     spirv_cross_path = paths.spirv_cross
 
@@ -904,6 +947,8 @@ def test_shader_reflect(stats, shader, args, paths):
     noopt = shader_is_noopt(shader[1])
     spirv, reflect = cross_compile_reflect(joined_path, is_spirv, args.opt and (not noopt), args.iterations, paths)
     regression_check_reflect(shader, reflect, args)
+    if args.reflection_view_test:
+        subprocess.check_call([args.reflection_view_test, spirv])
     remove_file(spirv)
 
 def test_shader_file(relpath, stats, args, backend):
@@ -1019,6 +1064,8 @@ def main():
             default = 1,
             type = int,
             help = 'Number of iterations to run SPIRV-Cross (benchmarking)')
+    parser.add_argument('--reflection-view-test',
+            help = 'Path to a test which compares ReflectionView with Compiler reflection for each shader')
 
     args = parser.parse_args()
     if not args.folder:
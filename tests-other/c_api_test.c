@@ -80,8 +80,129 @@ static void dump_resource_list(spvc_compiler compiler, spvc_resources resources,
 	}
 }
 
+static void check_resource_list_copy(spvc_compiler compiler, spvc_resources resources, spvc_resource_type type)
+{
+	const spvc_reflected_resource *list = NULL;
+	spvc_reflected_resource copied[16];
+	SpvId ids[16];
+	unsigned bindings[16];
+	size_t count = 0;
+	size_t copied_count = 0;
+	size_t i;
+
+	SPVC_CHECKED_CALL(spvc_resources_get_resource_list_for_type(resources, type, &list, &count));
+	SPVC_CHECKED_CALL(spvc_resources_copy_resource_list_for_type(resources, type, NULL, &copied_count));
+	if (copied_count != count)
+	{
+		fprintf(stderr, "Resource count mismatch!\n");
+		exit(1);
+	}
+
+	if (count > 16)
+	{
+		fprintf(stderr, "Too many resources for the test!\n");
+		exit(1);
+	}
+
+	if (count > 0)
+	{
+		copied_count = count - 1;
+		SPVC_CHECKED_CALL_NEGATIVE(spvc_resources_copy_resource_list_for_type(resources, type, copied, &copied_count));
+		if (copied_count != count)
+		{
+			fprintf(stderr, "Truncated resource list did not report the required count!\n");
+			exit(1);
+		}
+	}
+
+	copied_count = 16;
+	SPVC_CHECKED_CALL(spvc_resources_copy_resource_list_for_type(resources, type, copied, &copied_count));
+	if (copied_count != count)
+	{
+		fprintf(stderr, "Copied resource count mismatch!\n");
+		exit(1);
+	}
+
+	for (i = 0; i < copied_count; i++)
+	{
+		if (copied[i].id != list[i].id || strcmp(copied[i].name, list[i].name) != 0)
+		{
+			fprintf(stderr, "Copied resource mismatch!\n");
+			exit(1);
+		}
+		ids[i] = copied[i].id;
+	}
+
+	spvc_compiler_get_decorations(compiler, ids, copied_count, SpvDecorationBinding, bindings);
+	for (i = 0; i < copied_count; i++)
+	{
+		if (bindings[i] != spvc_compiler_get_decoration(compiler, ids[i], SpvDecorationBinding))
+		{
+			fprintf(stderr, "Batched decoration mismatch!\n");
+			exit(1);
+		}
+	}
+}
+
+static void check_builtin_resource_list_copy(spvc_resources resources, spvc_builtin_resource_type type)
+{
+	const spvc_reflected_builtin_resource *list = NULL;
+	spvc_reflected_builtin_resource copied[16];
+	size_t count = 0;
+	size_t copied_count = 0;
+	size_t i;
+
+	SPVC_CHECKED_CALL(spvc_resources_get_builtin_resource_list_for_type(resources, type, &list, &count));
+	SPVC_CHECKED_CALL(spvc_resources_copy_builtin_resource_list_for_type(resources, type, NULL, &copied_count));
+	if (copied_count != count)
+	{
+		fprintf(stderr, "Builtin resource count mismatch!\n");
+		exit(1);
+	}
+
+	if (count > 16)
+	{
+		fprintf(stderr, "Too many builtin resources for the test!\n");
+		exit(1);
+	}
+
+	if (count > 0)
+	{
+		copied_count = count - 1;
+		SPVC_CHECKED_CALL_NEGATIVE(spvc_resources_copy_builtin_resource_list_for_type(resources, type, copied, &copied_count));
+		if (copied_count != count)
+		{
+			fprintf(stderr, "Truncated builtin resource list did not report the required count!\n");
+			exit(1);
+		}
+	}
+
+	copied_count = 16;
+	SPVC_CHECKED_CALL(spvc_resources_copy_builtin_resource_list_for_type(resources, type, copied, &copied_count));
+	if (copied_count != count)
+	{
+		fprintf(stderr, "Copied builtin resource count mismatch!\n");
+		exit(1);
+	}
+
+	for (i = 0; i < copied_count; i++)
+	{
+		if (copied[i].builtin != list[i].builtin || copied[i].resource.id != list[i].resource.id)
+		{
+			fprintf(stderr, "Copied builtin resource mismatch!\n");
+			exit(1);
+		}
+	}
+}
+
 static void dump_resources(spvc_compiler compiler, spvc_resources resources)
 {
+	check_builtin_resource_list_copy(resources, SPVC_BUILTIN_RESOURCE_TYPE_STAGE_INPUT);
+	check_builtin_resource_list_copy(resources, SPVC_BUILTIN_RESOURCE_TYPE_STAGE_OUTPUT);
+	check_resource_list_copy(compiler, resources, SPVC_RESOURCE_TYPE_UNIFORM_BUFFER);
+	check_resource_list_copy(compiler, resources, SPVC_RESOURCE_TYPE_STORAGE_BUFFER);
+	check_resource_list_copy(compiler, resources, SPVC_RESOURCE_TYPE_SAMPLED_IMAGE);
+
 	dump_resource_list(compiler, resources, SPVC_RESOURCE_TYPE_UNIFORM_BUFFER, "UBO");
 	dump_resource_list(compiler, resources, SPVC_RESOURCE_TYPE_STORAGE_BUFFER, "SSBO");
 	dump_resource_list(compiler, resources, SPVC_RESOURCE_TYPE_PUSH_CONSTANT, "Push");
@@ -94,12 +215,396 @@ static void dump_resources(spvc_compiler compiler, spvc_resources resources)
 	dump_resource_list(compiler, resources, SPVC_RESOURCE_TYPE_SUBPASS_INPUT, "Subpass input");
 }
 
-static void compile(spvc_compiler compiler, const char *tag)
+static int g_arena_chunks;
+
+static void *arena_allocate(void *userdata, size_t size)
+{
+	(void)userdata;
+	g_arena_chunks++;
+	return malloc(size);
+}
+
+static void arena_free(void *userdata, void *ptr)
+{
+	(void)userdata;
+	g_arena_chunks--;
+	free(ptr);
+}
+
+static int g_profiled_passes;
+
+static void profile_callback(void *userdata, const spvc_pass_profile *profile)
+{
+	(void)userdata;
+	if (profile->name && profile->passes != 0)
+		g_profiled_passes++;
+}
+
+static const char *compile(spvc_compiler compiler, const char *tag)
 {
 	const char *result = NULL;
 	SPVC_CHECKED_CALL(spvc_compiler_compile(compiler, &result));
 	printf("\n%s\n=======\n", tag);
 	printf("%s\n=======\n", result);
+	return result;
+}
+
+/* Options are kept across a reset, so recompiling must reproduce the first output.
+ * Nothing else from the previous compile may stick, so options changed after a reset must take effect. */
+static void check_reset(spvc_compiler compiler, const char *expected)
+{
+	spvc_compiler_options original = NULL;
+	spvc_compiler_options changed = NULL;
+	const char *result = NULL;
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+	SPVC_CHECKED_CALL(spvc_compiler_compile(compiler, &result));
+	if (strcmp(result, expected) != 0)
+	{
+		fprintf(stderr, "Mismatch after reset!\n");
+		exit(1);
+	}
+
+	SPVC_CHECKED_CALL(spvc_compiler_create_compiler_options(compiler, &original));
+	SPVC_CHECKED_CALL(spvc_compiler_create_compiler_options(compiler, &changed));
+	SPVC_CHECKED_CALL(spvc_compiler_options_set_uint(changed, SPVC_COMPILER_OPTION_GLSL_VERSION, 460));
+
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+	SPVC_CHECKED_CALL(spvc_compiler_install_compiler_options(compiler, changed));
+	SPVC_CHECKED_CALL(spvc_compiler_compile(compiler, &result));
+	if (strcmp(result, expected) == 0 || strncmp(result, "#version 460", 12) != 0)
+	{
+		fprintf(stderr, "Option changed after reset was not applied!\n");
+		exit(1);
+	}
+
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+	SPVC_CHECKED_CALL(spvc_compiler_install_compiler_options(compiler, original));
+	SPVC_CHECKED_CALL(spvc_compiler_compile(compiler, &result));
+	if (strcmp(result, expected) != 0)
+	{
+		fprintf(stderr, "Mismatch after restoring options!\n");
+		exit(1);
+	}
+}
+
+/* Parsing the same module incrementally and hot reloading the compiler with it must reproduce the first output. */
+static void check_hot_reload(spvc_context context, spvc_compiler compiler, spvc_parsed_ir previous,
+                             const SpvId *buffer, size_t word_count, const char *expected)
+{
+	spvc_parsed_ir ir = NULL;
+	const char *result = NULL;
+	SPVC_CHECKED_CALL(spvc_context_parse_spirv_incremental(context, buffer, word_count, previous, &ir));
+	SPVC_CHECKED_CALL(spvc_compiler_reset_for_hot_reload(compiler, ir));
+	SPVC_CHECKED_CALL(spvc_compiler_compile(compiler, &result));
+	if (strcmp(result, expected) != 0)
+	{
+		fprintf(stderr, "Mismatch after hot reload!\n");
+		exit(1);
+	}
+}
+
+static int g_completed_jobs;
+
+static void job_callback(void *userdata, spvc_job job)
+{
+	const char *result = NULL;
+	if (spvc_job_get_result(job, &result) != SPVC_SUCCESS || strcmp(result, (const char *)userdata) != 0)
+	{
+		fprintf(stderr, "Mismatch in job callback!\n");
+		exit(1);
+	}
+	g_completed_jobs++;
+}
+
+static void inline_job_scheduler(void *userdata, spvc_job_task task, void *task_data)
+{
+	(void)userdata;
+	task(task_data);
+}
+
+static spvc_job_task g_deferred_task;
+static void *g_deferred_task_data;
+
+static void deferred_job_scheduler(void *userdata, spvc_job_task task, void *task_data)
+{
+	(void)userdata;
+	g_deferred_task = task;
+	g_deferred_task_data = task_data;
+}
+
+/* Compiling asynchronously, on the worker pool and through a scheduler, must reproduce the first output.
+ * A second job on a compiler which is still compiling must be rejected. */
+static void check_compile_async(spvc_context context, spvc_compiler compiler, const char *expected)
+{
+	spvc_job job = NULL;
+	spvc_job second_job = NULL;
+	const char *result = NULL;
+	int pass;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		if (pass == 1)
+			SPVC_CHECKED_CALL(spvc_context_set_job_scheduler(context, inline_job_scheduler, NULL));
+
+		g_completed_jobs = 0;
+		SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+		SPVC_CHECKED_CALL(spvc_compiler_compile_async(compiler, job_callback, (void *)expected, &job));
+		spvc_job_wait(job);
+		if (!spvc_job_is_complete(job) || g_completed_jobs != 1)
+		{
+			fprintf(stderr, "Job did not complete!\n");
+			exit(1);
+		}
+
+		SPVC_CHECKED_CALL(spvc_job_get_result(job, &result));
+		if (strcmp(result, expected) != 0 || *spvc_job_get_error_string(job) != '\0')
+		{
+			fprintf(stderr, "Mismatch after compiling asynchronously!\n");
+			exit(1);
+		}
+	}
+
+	SPVC_CHECKED_CALL(spvc_context_set_job_scheduler(context, deferred_job_scheduler, NULL));
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+	SPVC_CHECKED_CALL(spvc_compiler_compile_async(compiler, NULL, NULL, &job));
+	SPVC_CHECKED_CALL_NEGATIVE(spvc_compiler_compile_async(compiler, NULL, NULL, &second_job));
+	g_deferred_task(g_deferred_task_data);
+	spvc_job_wait(job);
+	SPVC_CHECKED_CALL(spvc_job_get_result(job, &result));
+	if (second_job != NULL || strcmp(result, expected) != 0)
+	{
+		fprintf(stderr, "Second job on a compiling compiler was not rejected!\n");
+		exit(1);
+	}
+
+	SPVC_CHECKED_CALL(spvc_context_set_job_scheduler(context, NULL, NULL));
+}
+
+#define NUM_CONCURRENT_JOBS 6
+
+/* Several compilers compiling on the worker pool at the same time must each reproduce their own output. */
+static void check_concurrent_compile_async(spvc_context context, spvc_parsed_ir ir)
+{
+	static const spvc_backend backends[NUM_CONCURRENT_JOBS] = {
+		SPVC_BACKEND_GLSL, SPVC_BACKEND_HLSL, SPVC_BACKEND_MSL,
+		SPVC_BACKEND_GLSL, SPVC_BACKEND_HLSL, SPVC_BACKEND_MSL,
+	};
+	spvc_compiler compilers[NUM_CONCURRENT_JOBS];
+	const char *expected[NUM_CONCURRENT_JOBS];
+	spvc_job jobs[NUM_CONCURRENT_JOBS];
+	spvc_compiler_options options = NULL;
+	const char *result = NULL;
+	int i;
+
+	for (i = 0; i < NUM_CONCURRENT_JOBS; i++)
+	{
+		SPVC_CHECKED_CALL(spvc_context_create_compiler(context, backends[i], ir, SPVC_CAPTURE_MODE_COPY, &compilers[i]));
+		if (backends[i] == SPVC_BACKEND_HLSL)
+		{
+			SPVC_CHECKED_CALL(spvc_compiler_create_compiler_options(compilers[i], &options));
+			SPVC_CHECKED_CALL(spvc_compiler_options_set_uint(options, SPVC_COMPILER_OPTION_HLSL_SHADER_MODEL, 50));
+			SPVC_CHECKED_CALL(spvc_compiler_install_compiler_options(compilers[i], options));
+		}
+		SPVC_CHECKED_CALL(spvc_compiler_compile(compilers[i], &expected[i]));
+		SPVC_CHECKED_CALL(spvc_compiler_reset(compilers[i]));
+	}
+
+	/* All jobs are in flight before any is waited for. */
+	for (i = 0; i < NUM_CONCURRENT_JOBS; i++)
+		SPVC_CHECKED_CALL(spvc_compiler_compile_async(compilers[i], NULL, NULL, &jobs[i]));
+
+	for (i = 0; i < NUM_CONCURRENT_JOBS; i++)
+	{
+		spvc_job_wait(jobs[i]);
+		SPVC_CHECKED_CALL(spvc_job_get_result(jobs[i], &result));
+		if (strcmp(result, expected[i]) != 0)
+		{
+			fprintf(stderr, "Mismatch after compiling concurrently!\n");
+			exit(1);
+		}
+	}
+}
+
+static char g_streamed_source[1 << 16];
+static size_t g_streamed_size;
+
+static void output_callback(void *userdata, const char *data, size_t size)
+{
+	(void)userdata;
+	if (g_streamed_size + size <= sizeof(g_streamed_source))
+		memcpy(g_streamed_source + g_streamed_size, data, size);
+	g_streamed_size += size;
+}
+
+/* Streaming the output must give the same source as compiling to a string. */
+static void check_compile_to_callback(spvc_compiler compiler, const char *expected)
+{
+	g_streamed_size = 0;
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+	SPVC_CHECKED_CALL(spvc_compiler_compile_to_callback(compiler, output_callback, NULL));
+	if (g_streamed_size != strlen(expected) || memcmp(g_streamed_source, expected, g_streamed_size) != 0)
+	{
+		fprintf(stderr, "Mismatch with streamed output!\n");
+		exit(1);
+	}
+}
+
+static unsigned g_entry_point_setups;
+static unsigned g_entry_point_outputs;
+static const char *g_entry_point_expected;
+
+static void entry_point_setup_callback(void *userdata, spvc_compiler compiler, const spvc_entry_point *entry_point)
+{
+	(void)userdata;
+	(void)compiler;
+	(void)entry_point;
+	/* Every output is passed on before the next entry point compiles. */
+	if (g_entry_point_outputs != g_entry_point_setups)
+	{
+		fprintf(stderr, "Entry point compiled before the previous output was passed on!\n");
+		exit(1);
+	}
+	g_entry_point_setups++;
+}
+
+static void entry_point_output_callback(void *userdata, const spvc_entry_point *entry_point, const char *source)
+{
+	spvc_resource_cost_report report;
+	(void)entry_point;
+	if (strcmp(source, g_entry_point_expected) != 0)
+	{
+		fprintf(stderr, "Mismatch when compiling all entry points!\n");
+		exit(1);
+	}
+	/* The compiler reports about the entry point which just compiled. */
+	SPVC_CHECKED_CALL(spvc_compiler_get_resource_cost_report((spvc_compiler)userdata, &report));
+	g_entry_point_outputs++;
+}
+
+/* The test module has a single entry point, so compiling all of them must give the same source again. */
+static void check_compile_all_entry_points(spvc_compiler compiler, const char *expected)
+{
+	const spvc_entry_point *entry_points = NULL;
+	size_t num_entry_points = 0;
+
+	g_entry_point_setups = 0;
+	g_entry_point_outputs = 0;
+	g_entry_point_expected = expected;
+	SPVC_CHECKED_CALL(spvc_compiler_get_entry_points(compiler, &entry_points, &num_entry_points));
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+	SPVC_CHECKED_CALL(spvc_compiler_compile_all_entry_points(compiler, entry_point_setup_callback,
+	                                                         entry_point_output_callback, compiler));
+	if (g_entry_point_setups != num_entry_points || g_entry_point_outputs != num_entry_points)
+	{
+		fprintf(stderr, "Not every entry point was compiled!\n");
+		exit(1);
+	}
+}
+
+/* The compile budget only bounds compiling, not reflection queries made after the compile returned. */
+static void check_compile_budget(spvc_context context, spvc_parsed_ir ir)
+{
+	spvc_compiler compiler = NULL;
+	spvc_set active = NULL;
+	const char *result = NULL;
+	unsigned long long max_work = 1;
+	spvc_result res;
+
+	SPVC_CHECKED_CALL(spvc_context_create_compiler(context, SPVC_BACKEND_GLSL, ir, SPVC_CAPTURE_MODE_COPY, &compiler));
+
+	/* With the smallest budget the compile fits in, any work counted after it would run out. */
+	g_fail_on_error = SPVC_FALSE;
+	for (;;)
+	{
+		spvc_compiler_set_compile_budget(compiler, 0.0, max_work);
+		res = spvc_compiler_compile(compiler, &result);
+		if (res == SPVC_SUCCESS)
+			break;
+
+		if (res != SPVC_ERROR_CANCELLED)
+		{
+			fprintf(stderr, "Budgeted compile failed without being cancelled!\n");
+			exit(1);
+		}
+
+		SPVC_CHECKED_CALL(spvc_compiler_reset(compiler));
+		max_work++;
+	}
+	g_fail_on_error = SPVC_TRUE;
+
+	SPVC_CHECKED_CALL(spvc_compiler_get_active_interface_variables(compiler, &active));
+}
+
+/* A compile served from the compilation cache must still report the extensions the compile requires.
+ * State changed through the API, like a name or an option, must change the key. */
+static void check_compilation_cache(spvc_context context, spvc_parsed_ir ir, const char *directory)
+{
+	spvc_compiler compilers[4];
+	spvc_compiler_options options = NULL;
+	spvc_resources resources = NULL;
+	const spvc_reflected_resource *list = NULL;
+	size_t count = 0;
+	const char *results[4];
+	int profiled[4];
+	size_t num_exts[2];
+	const char *ext = NULL;
+	int i;
+
+	spvc_context_set_compilation_cache(context, directory);
+	for (i = 0; i < 4; i++)
+	{
+		SPVC_CHECKED_CALL(spvc_context_create_compiler(context, SPVC_BACKEND_GLSL, ir, SPVC_CAPTURE_MODE_COPY, &compilers[i]));
+		SPVC_CHECKED_CALL(spvc_compiler_create_compiler_options(compilers[i], &options));
+		SPVC_CHECKED_CALL(spvc_compiler_options_set_uint(options, SPVC_COMPILER_OPTION_GLSL_VERSION, i == 3 ? 450 : 330));
+		SPVC_CHECKED_CALL(spvc_compiler_install_compiler_options(compilers[i], options));
+		if (i == 2)
+		{
+			SPVC_CHECKED_CALL(spvc_compiler_create_shader_resources(compilers[i], &resources));
+			SPVC_CHECKED_CALL(spvc_resources_get_resource_list_for_type(resources, SPVC_RESOURCE_TYPE_UNIFORM_BUFFER, &list, &count));
+			if (count == 0)
+			{
+				fprintf(stderr, "No uniform buffer to rename!\n");
+				exit(1);
+			}
+			spvc_compiler_set_name(compilers[i], list[0].base_type_id, "RenamedUBO");
+		}
+		spvc_compiler_set_profile_callback(compilers[i], profile_callback, NULL);
+		g_profiled_passes = 0;
+		SPVC_CHECKED_CALL(spvc_compiler_compile(compilers[i], &results[i]));
+		profiled[i] = g_profiled_passes;
+	}
+	spvc_context_set_compilation_cache(context, NULL);
+
+	if (profiled[1] != 0 || strcmp(results[0], results[1]) != 0)
+	{
+		fprintf(stderr, "Second compile was not served from the cache!\n");
+		exit(1);
+	}
+
+	if (profiled[2] == 0 || profiled[3] == 0 || strcmp(results[0], results[2]) == 0 || strcmp(results[0], results[3]) == 0)
+	{
+		fprintf(stderr, "Compile with other state was served from the cache!\n");
+		exit(1);
+	}
+
+	for (i = 0; i < 2; i++)
+		num_exts[i] = spvc_compiler_get_num_required_extensions(compilers[i]);
+
+	if (num_exts[0] == 0 || num_exts[0] != num_exts[1])
+	{
+		fprintf(stderr, "num_exts mismatch after cached compile!\n");
+		exit(1);
+	}
+
+	for (i = 0; i < (int)num_exts[0]; i++)
+	{
+		ext = spvc_compiler_get_required_extension(compilers[1], i);
+		if (!ext || strcmp(ext, spvc_compiler_get_required_extension(compilers[0], i)) != 0)
+		{
+			fprintf(stderr, "extension mismatch after cached compile!\n");
+			exit(1);
+		}
+	}
 }
 
 int main(int argc, char **argv)
@@ -116,6 +621,8 @@ int main(int argc, char **argv)
 	spvc_compiler compiler_none = NULL;
 	spvc_compiler_options options = NULL;
 	spvc_resources resources = NULL;
+	const char *glsl_source = NULL;
+	unsigned spec_value = 1;
 	SpvId *buffer = NULL;
 	size_t word_count = 0;
 
@@ -125,7 +632,7 @@ int main(int argc, char **argv)
 
 	printf("Revision: %s\n", rev);
 
-	if (argc != 5)
+	if (argc != 6)
 		return 1;
 
 	if (read_file(argv[1], &buffer, &word_count) < 0)
@@ -190,8 +697,30 @@ int main(int argc, char **argv)
 		ext_idx += 1;
 	}
 
+	spvc_msl_resource_binding msl_bindings[2];
+	spvc_msl_resource_binding_init(&msl_bindings[0]);
+	spvc_msl_resource_binding_init(&msl_bindings[1]);
+	msl_bindings[0].stage = SpvExecutionModelFragment;
+	msl_bindings[1].stage = SpvExecutionModelFragment;
+	msl_bindings[1].binding = 1;
+	SPVC_CHECKED_CALL(spvc_compiler_msl_add_resource_bindings(compiler_msl, msl_bindings, 2));
+	SPVC_CHECKED_CALL_NEGATIVE(spvc_compiler_msl_add_resource_bindings(compiler_hlsl, msl_bindings, 2));
+
+	spvc_msl_shader_interface_var_2 msl_inputs[2];
+	spvc_msl_shader_interface_var_init_2(&msl_inputs[0]);
+	spvc_msl_shader_interface_var_init_2(&msl_inputs[1]);
+	msl_inputs[1].location = 1;
+	msl_inputs[1].vecsize = 4;
+	SPVC_CHECKED_CALL(spvc_compiler_msl_add_shader_inputs_2(compiler_msl, msl_inputs, 2));
+	SPVC_CHECKED_CALL(spvc_compiler_msl_add_shader_outputs_2(compiler_msl, msl_inputs, 2));
+	SPVC_CHECKED_CALL_NEGATIVE(spvc_compiler_msl_add_shader_inputs_2(compiler_hlsl, msl_inputs, 2));
+	SPVC_CHECKED_CALL_NEGATIVE(spvc_compiler_msl_add_shader_outputs_2(compiler_hlsl, msl_inputs, 2));
+
 	SPVC_CHECKED_CALL(spvc_compiler_create_shader_resources(compiler_none, &resources));
 	dump_resources(compiler_none, resources);
+	SPVC_CHECKED_CALL(spvc_compiler_set_specialization_constant_value(compiler_hlsl, 0, &spec_value, sizeof(spec_value)));
+	SPVC_CHECKED_CALL_NEGATIVE(spvc_compiler_set_specialization_constant_value(compiler_hlsl, 0, &spec_value, 3));
+
 	compile(compiler_glsl, "GLSL");
 	compile(compiler_hlsl, "HLSL");
 	compile(compiler_msl, "MSL");
@@ -216,7 +745,45 @@ int main(int argc, char **argv)
 		}
 		ext_idx += 1;
 	}
-	
+
+	/* Compilers restore what their first compile saved, so it does not matter that compiler_none took the IR. */
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler_hlsl));
+	SPVC_CHECKED_CALL(spvc_compiler_reset(compiler_none));
+
+	spvc_context_release_allocations(context);
+	SPVC_CHECKED_CALL(spvc_context_enable_memory_arena(context, arena_allocate, arena_free, NULL));
+	SPVC_CHECKED_CALL(spvc_context_parse_spirv(context, buffer, word_count, &ir));
+	SPVC_CHECKED_CALL(spvc_context_create_compiler(context, SPVC_BACKEND_GLSL, ir, SPVC_CAPTURE_MODE_COPY, &compiler_glsl));
+	spvc_compiler_set_profile_callback(compiler_glsl, profile_callback, NULL);
+	glsl_source = compile(compiler_glsl, "GLSL (arena)");
+	check_reset(compiler_glsl, glsl_source);
+	check_compile_to_callback(compiler_glsl, glsl_source);
+	check_compile_all_entry_points(compiler_glsl, glsl_source);
+	check_hot_reload(context, compiler_glsl, ir, buffer, word_count, glsl_source);
+	check_compile_async(context, compiler_glsl, glsl_source);
+	check_concurrent_compile_async(context, ir);
+	check_compile_budget(context, ir);
+	if (g_profiled_passes == 0)
+	{
+		fprintf(stderr, "No passes were profiled!\n");
+		return 1;
+	}
+
+	check_compilation_cache(context, ir, argv[5]);
+
+	if (g_arena_chunks == 0)
+	{
+		fprintf(stderr, "Arena was not used!\n");
+		return 1;
+	}
+
+	spvc_context_release_allocations(context);
+	if (g_arena_chunks != 0)
+	{
+		fprintf(stderr, "Arena chunks were leaked!\n");
+		return 1;
+	}
+
 	spvc_context_destroy(context);
 	free(buffer);
 	return 0;
@@ -0,0 +1,267 @@
+// Parses edited versions of a module incrementally, as when a shader is hot reloaded,
+// and checks the IR matches parsing from scratch, and that hot reloading compilers
+// gives the same output as compiling the edited module with a new compiler.
+// Also checks that minified GLSL comes out the same when compiled again.
+
+#include "spirv_cross_serialized_ir.hpp"
+#include "spirv_glsl.hpp"
+#include "spirv_hlsl.hpp"
+#include "spirv_msl.hpp"
+#include "spirv_parser.hpp"
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace SPIRV_CROSS_NAMESPACE;
+
+static std::vector<uint32_t> read_file(const char *path)
+{
+	long len;
+	FILE *file = fopen(path, "rb");
+
+	if (!file)
+		return {};
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	rewind(file);
+
+	std::vector<uint32_t> buffer(len / sizeof(uint32_t));
+	if (fread(buffer.data(), 1, len, file) != (size_t)len)
+	{
+		fclose(file);
+		return {};
+	}
+
+	fclose(file);
+	return buffer;
+}
+
+static ParsedIR parse(const std::vector<uint32_t> &words)
+{
+	Parser parser(words);
+	parser.parse();
+	return std::move(parser.get_parsed_ir());
+}
+
+static SmallVector<SPIRVFunctionRange> find_functions(const std::vector<uint32_t> &words, size_t &global_end)
+{
+	SPIRVWords spirv;
+	spirv = words;
+	SmallVector<SPIRVFunctionRange> ranges;
+	if (!find_spirv_function_ranges(spirv, global_end, ranges))
+		return {};
+	return ranges;
+}
+
+// Turns the first OpFAdd of a function into an OpFSub.
+static std::vector<uint32_t> edit_function(std::vector<uint32_t> words, size_t index)
+{
+	size_t global_end;
+	auto ranges = find_functions(words, global_end);
+	for (uint32_t offset = ranges[index].begin; offset < ranges[index].end; offset += words[offset] >> 16)
+	{
+		if ((words[offset] & 0xffff) == spv::OpFAdd)
+		{
+			words[offset] = (words[offset] & 0xffff0000u) | spv::OpFSub;
+			break;
+		}
+	}
+	return words;
+}
+
+// Defines the functions in reverse order.
+static std::vector<uint32_t> reverse_functions(const std::vector<uint32_t> &words)
+{
+	size_t global_end;
+	auto ranges = find_functions(words, global_end);
+	std::vector<uint32_t> reversed(words.begin(), words.begin() + global_end);
+	for (size_t i = ranges.size(); i > 0; i--)
+		reversed.insert(reversed.end(), words.begin() + ranges[i - 1].begin, words.begin() + ranges[i - 1].end);
+	return reversed;
+}
+
+// Changes the first float constant.
+static std::vector<uint32_t> edit_global(std::vector<uint32_t> words)
+{
+	size_t global_end;
+	find_functions(words, global_end);
+	for (size_t offset = 5; offset < global_end; offset += words[offset] >> 16)
+	{
+		if ((words[offset] & 0xffff) == spv::OpConstant && words[offset + 3] == 0x40000000u)
+		{
+			words[offset + 3] = 0x40400000u;
+			break;
+		}
+	}
+	return words;
+}
+
+// Inserts an OpNoLine between the first two functions, which no function range accounts for.
+static std::vector<uint32_t> add_debug_info_between_functions(std::vector<uint32_t> words)
+{
+	size_t global_end;
+	auto ranges = find_functions(words, global_end);
+	words.insert(words.begin() + ranges[0].end, (1u << 16) | spv::OpNoLine);
+	return words;
+}
+
+static std::unique_ptr<Compiler> create_compiler(const ParsedIR &ir, int backend)
+{
+	switch (backend)
+	{
+	case 0:
+	{
+		std::unique_ptr<CompilerGLSL> compiler(new CompilerGLSL(ir));
+		auto opts = compiler->get_common_options();
+		opts.vulkan_semantics = true;
+		compiler->set_common_options(opts);
+		return std::unique_ptr<Compiler>(std::move(compiler));
+	}
+
+	case 1:
+	{
+		std::unique_ptr<CompilerHLSL> compiler(new CompilerHLSL(ir));
+		auto opts = compiler->get_hlsl_options();
+		opts.shader_model = 50;
+		compiler->set_hlsl_options(opts);
+		return std::unique_ptr<Compiler>(std::move(compiler));
+	}
+
+	default:
+		return std::unique_ptr<Compiler>(new CompilerMSL(ir));
+	}
+}
+
+static bool check_minify_recompile(const ParsedIR &ir)
+{
+	CompilerGLSL compiler(ir);
+	auto opts = compiler.get_common_options();
+	opts.vulkan_semantics = true;
+	opts.minify = true;
+	compiler.set_common_options(opts);
+	compiler.add_header_line("/* Spans\n   lines. */");
+
+	auto result = compiler.compile();
+	auto names = compiler.get_minified_names();
+	if (result.find("/*") != std::string::npos || result.find("Spans") != std::string::npos)
+	{
+		fprintf(stderr, "Minified GLSL keeps a block comment.\n");
+		return false;
+	}
+
+	if (names.empty())
+	{
+		fprintf(stderr, "Nothing was minified.\n");
+		return false;
+	}
+
+	for (auto &name : names)
+	{
+		if (name.first == name.second)
+		{
+			fprintf(stderr, "%s is mapped to itself.\n", name.first.c_str());
+			return false;
+		}
+	}
+
+	compiler.reset_for_recompile();
+	compiler.add_header_line("/* Spans\n   lines. */");
+	if (compiler.compile() != result || compiler.get_minified_names() != names)
+	{
+		fprintf(stderr, "Mismatch after recompiling minified GLSL.\n");
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+		return EXIT_FAILURE;
+
+	auto buffer = read_file(argv[1]);
+	if (buffer.empty())
+		return EXIT_FAILURE;
+
+	size_t global_end;
+	if (find_functions(buffer, global_end).size() < 3)
+	{
+		fprintf(stderr, "Test module needs more functions.\n");
+		return EXIT_FAILURE;
+	}
+
+	struct Version
+	{
+		const char *name;
+		std::vector<uint32_t> words;
+		bool reuses_previous;
+	};
+
+	const Version versions[] = {
+		{ "unchanged", buffer, true },
+		{ "edited leaf function", edit_function(buffer, 0), true },
+		{ "edited entry point", edit_function(buffer, 3), true },
+		{ "reordered functions", reverse_functions(buffer), true },
+		{ "edited global", edit_global(buffer), false },
+		{ "debug info between functions", add_debug_info_between_functions(buffer), false },
+	};
+
+	const ParsedIR previous = parse(buffer);
+	const int num_backends = 3;
+
+	if (!check_minify_recompile(previous))
+		return EXIT_FAILURE;
+
+	for (auto &version : versions)
+	{
+		if (&version != &versions[0] && version.words == buffer)
+		{
+			fprintf(stderr, "Version \"%s\" is not edited.\n", version.name);
+			return EXIT_FAILURE;
+		}
+
+		Parser parser(version.words);
+		if (parser.parse_incremental(previous) != version.reuses_previous)
+		{
+			fprintf(stderr, "Unexpected parse for \"%s\".\n", version.name);
+			return EXIT_FAILURE;
+		}
+
+		const ParsedIR &ir = parser.get_parsed_ir();
+		const ParsedIR expected_ir = parse(version.words);
+		if (serialize_parsed_ir(ir) != serialize_parsed_ir(expected_ir))
+		{
+			fprintf(stderr, "IR mismatch for \"%s\".\n", version.name);
+			return EXIT_FAILURE;
+		}
+
+		for (int i = 0; i < num_backends; i++)
+		{
+			auto compiler = create_compiler(previous, i);
+			compiler->compile();
+
+			// Options are kept, and nothing else was set up.
+			compiler->reset_for_hot_reload(ir);
+			auto result = compiler->compile();
+			if (result != create_compiler(expected_ir, i)->compile())
+			{
+				fprintf(stderr, "Mismatch after hot reload of \"%s\" for backend %d.\n", version.name, i);
+				return EXIT_FAILURE;
+			}
+
+			// Reloading again reuses what the reload itself emitted.
+			compiler->reset_for_hot_reload(ir);
+			if (compiler->compile() != result)
+			{
+				fprintf(stderr, "Mismatch after second hot reload of \"%s\" for backend %d.\n", version.name, i);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
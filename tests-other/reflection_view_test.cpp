@@ -0,0 +1,237 @@
+// Checks that a ReflectionView over a parsed module answers every query the same way
+// as a freshly constructed Compiler, for each entry point of each module on the command line.
+
+#include "spirv_cross_reflection_view.hpp"
+#include "spirv_parser.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace SPIRV_CROSS_NAMESPACE;
+
+static std::vector<uint32_t> read_file(const char *path)
+{
+	long len;
+	FILE *file = fopen(path, "rb");
+
+	if (!file)
+		return {};
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	rewind(file);
+
+	std::vector<uint32_t> buffer(len / sizeof(uint32_t));
+	if (fread(buffer.data(), 1, len, file) != (size_t)len)
+	{
+		fclose(file);
+		return {};
+	}
+
+	fclose(file);
+	return buffer;
+}
+
+static bool resources_match(const SmallVector<Resource> &a, const SmallVector<Resource> &b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].id != b[i].id || a[i].type_id != b[i].type_id || a[i].base_type_id != b[i].base_type_id ||
+		    a[i].name != b[i].name)
+			return false;
+	}
+
+	return true;
+}
+
+static bool builtin_resources_match(const SmallVector<BuiltInResource> &a, const SmallVector<BuiltInResource> &b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].builtin != b[i].builtin || a[i].value_type_id != b[i].value_type_id ||
+		    !resources_match({ a[i].resource }, { b[i].resource }))
+			return false;
+	}
+
+	return true;
+}
+
+static bool shader_resources_match(const ShaderResources &a, const ShaderResources &b)
+{
+	return resources_match(a.uniform_buffers, b.uniform_buffers) &&
+	       resources_match(a.storage_buffers, b.storage_buffers) &&
+	       resources_match(a.stage_inputs, b.stage_inputs) && resources_match(a.stage_outputs, b.stage_outputs) &&
+	       resources_match(a.subpass_inputs, b.subpass_inputs) &&
+	       resources_match(a.storage_images, b.storage_images) &&
+	       resources_match(a.sampled_images, b.sampled_images) &&
+	       resources_match(a.atomic_counters, b.atomic_counters) &&
+	       resources_match(a.acceleration_structures, b.acceleration_structures) &&
+	       resources_match(a.gl_plain_uniforms, b.gl_plain_uniforms) &&
+	       resources_match(a.push_constant_buffers, b.push_constant_buffers) &&
+	       resources_match(a.shader_record_buffers, b.shader_record_buffers) &&
+	       resources_match(a.separate_images, b.separate_images) &&
+	       resources_match(a.separate_samplers, b.separate_samplers) &&
+	       builtin_resources_match(a.builtin_inputs, b.builtin_inputs) &&
+	       builtin_resources_match(a.builtin_outputs, b.builtin_outputs);
+}
+
+static bool buffer_ranges_match(const SmallVector<BufferRange> &a, const SmallVector<BufferRange> &b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].index != b[i].index || a[i].offset != b[i].offset || a[i].range != b[i].range)
+			return false;
+
+	return true;
+}
+
+// Buffer ranges cannot be computed for every buffer, e.g. runtime arrays of blocks.
+// Where the compiler throws, the view must throw as well.
+static bool buffer_ranges_match(const Compiler &compiler, const ReflectionView &view, VariableID id)
+{
+	SmallVector<BufferRange> expected, ranges;
+	bool expected_threw = false, threw = false;
+
+	try
+	{
+		expected = compiler.get_active_buffer_ranges(id);
+	}
+	catch (const CompilerError &)
+	{
+		expected_threw = true;
+	}
+
+	try
+	{
+		ranges = view.get_active_buffer_ranges(id);
+	}
+	catch (const CompilerError &)
+	{
+		threw = true;
+	}
+
+	if (expected_threw || threw)
+		return expected_threw == threw;
+	return buffer_ranges_match(expected, ranges);
+}
+
+static bool entry_point_matches(const ParsedIR &ir, const EntryPoint &entry)
+{
+	Compiler compiler(ir);
+	compiler.set_entry_point(entry.name, entry.execution_model);
+	ReflectionView view(ir);
+	view.set_entry_point(entry.name, entry.execution_model);
+
+	auto active = compiler.get_active_interface_variables();
+	if (view.get_active_interface_variables() != active)
+	{
+		fprintf(stderr, "Active interface variables differ.\n");
+		return false;
+	}
+
+	auto expected = compiler.get_shader_resources();
+	if (!shader_resources_match(expected, view.get_shader_resources()))
+	{
+		fprintf(stderr, "Shader resources differ.\n");
+		return false;
+	}
+
+	if (!shader_resources_match(compiler.get_shader_resources(active), view.get_shader_resources(active)))
+	{
+		fprintf(stderr, "Active shader resources differ.\n");
+		return false;
+	}
+
+	auto buffers = expected.uniform_buffers;
+	buffers.insert(buffers.end(), expected.storage_buffers.begin(), expected.storage_buffers.end());
+	buffers.insert(buffers.end(), expected.push_constant_buffers.begin(), expected.push_constant_buffers.end());
+	for (auto &buffer : buffers)
+	{
+		if (!buffer_ranges_match(compiler, view, buffer.id))
+		{
+			fprintf(stderr, "Active buffer ranges of %s differ.\n", buffer.name.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool module_matches(const ParsedIR &ir)
+{
+	Compiler compiler(ir);
+	ReflectionView view(ir);
+
+	auto expected_entries = compiler.get_entry_points_and_stages();
+	auto entries = view.get_entry_points_and_stages();
+	if (entries.size() != expected_entries.size())
+	{
+		fprintf(stderr, "Entry points differ.\n");
+		return false;
+	}
+
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].name != expected_entries[i].name ||
+		    entries[i].execution_model != expected_entries[i].execution_model)
+		{
+			fprintf(stderr, "Entry points differ.\n");
+			return false;
+		}
+	}
+
+	auto expected_constants = compiler.get_specialization_constants();
+	auto constants = view.get_specialization_constants();
+	if (constants.size() != expected_constants.size())
+	{
+		fprintf(stderr, "Specialization constants differ.\n");
+		return false;
+	}
+
+	for (size_t i = 0; i < constants.size(); i++)
+	{
+		if (constants[i].id != expected_constants[i].id ||
+		    constants[i].constant_id != expected_constants[i].constant_id)
+		{
+			fprintf(stderr, "Specialization constants differ.\n");
+			return false;
+		}
+	}
+
+	for (auto &entry : entries)
+		if (!entry_point_matches(ir, entry))
+			return false;
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+		return EXIT_FAILURE;
+
+	for (int i = 1; i < argc; i++)
+	{
+		auto buffer = read_file(argv[i]);
+		if (buffer.empty())
+			return EXIT_FAILURE;
+
+		Parser parser(std::move(buffer));
+		parser.parse();
+		if (!module_matches(parser.get_parsed_ir()))
+		{
+			fprintf(stderr, "ReflectionView mismatch in %s.\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
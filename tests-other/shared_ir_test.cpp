@@ -0,0 +1,335 @@
+// Compiles one parsed module with several backends on separate threads,
+// sharing a single ParsedIR, and checks the output matches compiling serially.
+// Also checks that parsing with borrowed words never writes to the caller's buffer,
+// that running per-function work on a task runner does not change the output,
+// that a ReflectionView over the shared IR agrees with the compiler's reflection,
+// that feeding the words to the parser in pieces or parsing function bodies
+// on a task runner gives the same result, also with debug info between functions, and that serialized IR loads back to the same result.
+
+#include "spirv_cross_reflection_view.hpp"
+#include "spirv_cross_serialized_ir.hpp"
+#include "spirv_glsl.hpp"
+#include "spirv_hlsl.hpp"
+#include "spirv_msl.hpp"
+#include "spirv_parser.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace SPIRV_CROSS_NAMESPACE;
+
+static std::vector<uint32_t> read_file(const char *path)
+{
+	long len;
+	FILE *file = fopen(path, "rb");
+
+	if (!file)
+		return {};
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	rewind(file);
+
+	std::vector<uint32_t> buffer(len / sizeof(uint32_t));
+	if (fread(buffer.data(), 1, len, file) != (size_t)len)
+	{
+		fclose(file);
+		return {};
+	}
+
+	fclose(file);
+	return buffer;
+}
+
+static void run_tasks_on_threads(uint32_t count, const std::function<void(uint32_t)> &task)
+{
+	std::vector<std::thread> threads;
+	for (uint32_t i = 0; i < count; i++)
+		threads.emplace_back(task, i);
+	for (auto &t : threads)
+		t.join();
+}
+
+static std::string compile(const ParsedIR &ir, int backend, const CompilerTaskRunner *task_runner = nullptr)
+{
+	switch (backend)
+	{
+	case 0:
+	{
+		CompilerGLSL compiler(ir);
+		if (task_runner)
+			compiler.set_task_runner(*task_runner);
+		auto opts = compiler.get_common_options();
+		// Vulkan semantics enable precision analysis, which rewrites SPIR-V words in place.
+		opts.vulkan_semantics = true;
+		compiler.set_common_options(opts);
+		return compiler.compile();
+	}
+
+	case 1:
+	{
+		CompilerHLSL compiler(ir);
+		auto opts = compiler.get_hlsl_options();
+		opts.shader_model = 50;
+		compiler.set_hlsl_options(opts);
+		return compiler.compile();
+	}
+
+	default:
+	{
+		CompilerMSL compiler(ir);
+		return compiler.compile();
+	}
+	}
+}
+
+// Inserts an OpNoLine after the first function definition, if the module has more than one.
+static std::vector<uint32_t> add_debug_info_between_functions(const std::vector<uint32_t> &words)
+{
+	SPIRVWords spirv;
+	spirv = words;
+	size_t global_end;
+	SmallVector<SPIRVFunctionRange> ranges;
+	if (!find_spirv_function_ranges(spirv, global_end, ranges) || ranges.size() < 2)
+		return {};
+
+	auto result = words;
+	result.insert(result.begin() + ranges[0].end, (1u << 16) | spv::OpNoLine);
+	return result;
+}
+
+static bool resources_match(const SmallVector<Resource> &a, const SmallVector<Resource> &b)
+{
+	if (a.size() != b.size())
+		return false;
+
+	for (size_t i = 0; i < a.size(); i++)
+		if (a[i].id != b[i].id || a[i].type_id != b[i].type_id || a[i].name != b[i].name)
+			return false;
+
+	return true;
+}
+
+static bool reflection_matches(const ParsedIR &ir)
+{
+	Compiler compiler(ir);
+	ReflectionView view(ir);
+
+	auto active = compiler.get_active_interface_variables();
+	if (view.get_active_interface_variables() != active)
+		return false;
+
+	auto expected = compiler.get_shader_resources(active);
+	auto res = view.get_shader_resources(active);
+	return resources_match(expected.uniform_buffers, res.uniform_buffers) &&
+	       resources_match(expected.storage_buffers, res.storage_buffers) &&
+	       resources_match(expected.stage_inputs, res.stage_inputs) &&
+	       resources_match(expected.stage_outputs, res.stage_outputs) &&
+	       resources_match(expected.sampled_images, res.sampled_images) &&
+	       resources_match(expected.push_constant_buffers, res.push_constant_buffers) &&
+	       compiler.get_specialization_constants().size() == view.get_specialization_constants().size();
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+		return EXIT_FAILURE;
+
+	auto buffer = read_file(argv[1]);
+	if (buffer.empty())
+		return EXIT_FAILURE;
+
+	Parser parser(buffer);
+	parser.parse();
+	const ParsedIR &ir = parser.get_parsed_ir();
+	auto original_words = std::vector<uint32_t>(ir.spirv.begin(), ir.spirv.end());
+
+	const int num_backends = 3;
+	std::string expected[num_backends];
+	for (int i = 0; i < num_backends; i++)
+		expected[i] = compile(ir, i);
+
+	const int num_threads = 8;
+	std::string results[num_threads];
+	std::vector<std::thread> threads;
+	for (int i = 0; i < num_threads; i++)
+		threads.emplace_back([&, i]() { results[i] = compile(ir, i % num_backends); });
+	for (auto &t : threads)
+		t.join();
+
+	for (int i = 0; i < num_threads; i++)
+	{
+		if (results[i] != expected[i % num_backends])
+		{
+			fprintf(stderr, "Mismatch in thread %d.\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (std::vector<uint32_t>(ir.spirv.begin(), ir.spirv.end()) != original_words)
+	{
+		fprintf(stderr, "Shared SPIR-V was modified.\n");
+		return EXIT_FAILURE;
+	}
+
+	uint32_t compile_tasks = 0;
+	const CompilerTaskRunner count_compile_tasks = [&](uint32_t count, const std::function<void(uint32_t)> &task) {
+		compile_tasks += count;
+		run_tasks_on_threads(count, task);
+	};
+
+	if (compile(ir, 0, &count_compile_tasks) != expected[0])
+	{
+		fprintf(stderr, "Mismatch with threaded task runner.\n");
+		return EXIT_FAILURE;
+	}
+
+	// The CFG of each function is built as one task, unless there is only one function.
+	if (ir.ids_for_type[TypeFunction].size() > 1 && !compile_tasks)
+	{
+		fprintf(stderr, "CFGs were not built on the task runner.\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!reflection_matches(ir))
+	{
+		fprintf(stderr, "Mismatch with ReflectionView.\n");
+		return EXIT_FAILURE;
+	}
+
+	Parser borrowed_parser(buffer.data(), buffer.size(), true);
+	borrowed_parser.parse();
+	for (int i = 0; i < num_backends; i++)
+	{
+		if (compile(borrowed_parser.get_parsed_ir(), i) != expected[i])
+		{
+			fprintf(stderr, "Mismatch with borrowed SPIR-V for backend %d.\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (buffer != original_words)
+	{
+		fprintf(stderr, "Borrowed SPIR-V was modified.\n");
+		return EXIT_FAILURE;
+	}
+
+	// Chunks which do not line up with instructions, starting inside the header.
+	Parser streamed_parser;
+	const size_t chunk_size = 3;
+	for (size_t i = 0; i < buffer.size(); i += chunk_size)
+		streamed_parser.feed(buffer.data() + i, std::min(chunk_size, buffer.size() - i));
+	streamed_parser.finish();
+	for (int i = 0; i < num_backends; i++)
+	{
+		if (compile(streamed_parser.get_parsed_ir(), i) != expected[i])
+		{
+			fprintf(stderr, "Mismatch with streamed SPIR-V for backend %d.\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	uint32_t parse_tasks = 0;
+	const auto count_parse_tasks = [&](uint32_t count, const std::function<void(uint32_t)> &task) {
+		parse_tasks += count;
+		run_tasks_on_threads(count, task);
+	};
+
+	Parser threaded_parser(buffer);
+	threaded_parser.set_task_runner(count_parse_tasks);
+	threaded_parser.parse();
+	for (int i = 0; i < num_backends; i++)
+	{
+		if (compile(threaded_parser.get_parsed_ir(), i) != expected[i])
+		{
+			fprintf(stderr, "Mismatch with threaded parsing for backend %d.\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Modules with more than one function are split up. Debug instructions between functions
+	// belong to no function, so such modules are parsed serially.
+	auto debug_info_words = add_debug_info_between_functions(buffer);
+	if (!debug_info_words.empty())
+	{
+		if (!parse_tasks)
+		{
+			fprintf(stderr, "Function bodies were not parsed on the task runner.\n");
+			return EXIT_FAILURE;
+		}
+
+		parse_tasks = 0;
+		Parser debug_info_parser(debug_info_words);
+		debug_info_parser.set_task_runner(count_parse_tasks);
+		debug_info_parser.parse();
+		if (parse_tasks)
+		{
+			fprintf(stderr, "Debug info between functions was not parsed serially.\n");
+			return EXIT_FAILURE;
+		}
+
+		for (int i = 0; i < num_backends; i++)
+		{
+			if (compile(debug_info_parser.get_parsed_ir(), i) != expected[i])
+			{
+				fprintf(stderr, "Mismatch with debug info between functions for backend %d.\n", i);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	auto blob = serialize_parsed_ir(ir);
+	for (int borrow = 0; borrow < 2; borrow++)
+	{
+		ParsedIR loaded_ir;
+		deserialize_parsed_ir(loaded_ir, blob.data(), blob.size(), borrow != 0);
+		if (serialize_parsed_ir(loaded_ir) != blob)
+		{
+			fprintf(stderr, "Serialized IR does not round-trip.\n");
+			return EXIT_FAILURE;
+		}
+
+		for (int i = 0; i < num_backends; i++)
+		{
+			if (compile(loaded_ir, i) != expected[i])
+			{
+				fprintf(stderr, "Mismatch with serialized IR for backend %d.\n", i);
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	// Drop the second half of the words, as a stale cache entry would, and the load must fail.
+	uint32_t header[4];
+	memcpy(header, blob.data(), sizeof(header));
+	uint32_t kept_words = header[2] / 2;
+	size_t payload_offset = sizeof(header) + header[2] * sizeof(uint32_t);
+	std::vector<uint8_t> truncated(blob.begin(), blob.begin() + sizeof(header) + kept_words * sizeof(uint32_t));
+	truncated.insert(truncated.end(), blob.begin() + payload_offset, blob.end());
+	header[2] = kept_words;
+	memcpy(truncated.data(), header, sizeof(header));
+
+	bool rejected = false;
+	try
+	{
+		ParsedIR loaded_ir;
+		deserialize_parsed_ir(loaded_ir, truncated.data(), truncated.size(), false);
+	}
+	catch (const CompilerError &)
+	{
+		rejected = true;
+	}
+
+	if (!rejected)
+	{
+		fprintf(stderr, "Serialized IR with truncated words was loaded.\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
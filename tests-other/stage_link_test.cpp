@@ -0,0 +1,128 @@
+// Links a vertex shader to a fragment shader which does not read all of its outputs,
+// and checks that the unread outputs are dropped, and that packing moves the rest
+// to matching locations in both stages, for every backend.
+
+#include "spirv_glsl.hpp"
+#include "spirv_hlsl.hpp"
+#include "spirv_msl.hpp"
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+using namespace SPIRV_CROSS_NAMESPACE;
+
+static std::vector<uint32_t> read_file(const char *path)
+{
+	long len;
+	FILE *file = fopen(path, "rb");
+
+	if (!file)
+		return {};
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	rewind(file);
+
+	std::vector<uint32_t> buffer(len / sizeof(uint32_t));
+	if (fread(buffer.data(), 1, len, file) != (size_t)len)
+	{
+		fclose(file);
+		return {};
+	}
+
+	fclose(file);
+	return buffer;
+}
+
+static std::unique_ptr<Compiler> create_compiler(const std::vector<uint32_t> &words, int backend)
+{
+	switch (backend)
+	{
+	case 0:
+	{
+		std::unique_ptr<CompilerGLSL> compiler(new CompilerGLSL(words));
+		auto opts = compiler->get_common_options();
+		opts.vulkan_semantics = true;
+		compiler->set_common_options(opts);
+		return std::unique_ptr<Compiler>(std::move(compiler));
+	}
+
+	case 1:
+	{
+		std::unique_ptr<CompilerHLSL> compiler(new CompilerHLSL(words));
+		auto opts = compiler->get_hlsl_options();
+		opts.shader_model = 50;
+		compiler->set_hlsl_options(opts);
+		return std::unique_ptr<Compiler>(std::move(compiler));
+	}
+
+	default:
+		return std::unique_ptr<Compiler>(new CompilerMSL(words));
+	}
+}
+
+struct Expectation
+{
+	const char *vertex_has;
+	const char *vertex_lacks[2];
+	const char *fragment_has;
+};
+
+static bool check(const std::string &source, const char *text, bool expected, const char *stage, int backend)
+{
+	if ((source.find(text) != std::string::npos) == expected)
+		return true;
+
+	fprintf(stderr, "%s output of backend %d %s \"%s\":\n%s\n", stage, backend,
+	        expected ? "lacks" : "has", text, source.c_str());
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc != 3)
+		return EXIT_FAILURE;
+
+	auto vertex = read_file(argv[1]);
+	auto fragment = read_file(argv[2]);
+	if (vertex.empty() || fragment.empty())
+		return EXIT_FAILURE;
+
+	// The fragment shader reads locations 0 and 2, but not 1.
+	const Expectation packed[] = {
+		{ "layout(location = 1) out vec2 uv;", { "out vec4 unused;", "location = 2" },
+		  "layout(location = 1) in vec2 uv;" },
+		{ "float2 uv : TEXCOORD1;", { "unused : TEXCOORD", "stage_output.unused" }, "float2 uv : TEXCOORD1;" },
+		{ "float2 uv [[user(locn1)]];", { "unused [[user", "out.unused" }, "float2 uv [[user(locn1)]];" },
+	};
+
+	const Expectation unpacked[] = {
+		{ "layout(location = 2) out vec2 uv;", { "out vec4 unused;", "location = 1" },
+		  "layout(location = 2) in vec2 uv;" },
+		{ "float2 uv : TEXCOORD2;", { "unused : TEXCOORD", "stage_output.unused" }, "float2 uv : TEXCOORD2;" },
+		{ "float2 uv [[user(locn2)]];", { "unused [[user", "out.unused" }, "float2 uv [[user(locn2)]];" },
+	};
+
+	for (int pack = 0; pack < 2; pack++)
+	{
+		for (int backend = 0; backend < 3; backend++)
+		{
+			auto upstream = create_compiler(vertex, backend);
+			auto downstream = create_compiler(fragment, backend);
+			upstream->link_stage_outputs(*downstream, pack != 0);
+
+			auto &expected = pack ? packed[backend] : unpacked[backend];
+			auto vertex_source = upstream->compile();
+			auto fragment_source = downstream->compile();
+			if (!check(vertex_source, expected.vertex_has, true, "Vertex", backend) ||
+			    !check(vertex_source, expected.vertex_lacks[0], false, "Vertex", backend) ||
+			    !check(vertex_source, expected.vertex_lacks[1], false, "Vertex", backend) ||
+			    !check(fragment_source, expected.fragment_has, true, "Fragment", backend))
+				return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}